@@ -57,6 +57,8 @@ void __init native_pv_lock_init(void)
 {
 	if (boot_cpu_has(X86_FEATURE_HYPERVISOR))
 		static_branch_enable(&virt_spin_lock_key);
+	else
+		cna_configure_spin_lock_slowpath();
 }
 
 struct static_key paravirt_steal_enabled;
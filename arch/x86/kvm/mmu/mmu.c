@@ -7510,10 +7510,41 @@ static int set_nx_huge_pages_recovery_param(const char *val, const struct kernel
 	return err;
 }
 
+/*
+ * Unaccount and do not attempt to recover any NX Huge Pages that are being
+ * dirty tracked, as they would just be faulted back in as 4KiB pages. The NX
+ * Huge Pages in this slot will be recovered, along with all the other huge
+ * pages in the slot, when dirty logging is disabled.
+ *
+ * Since gfn_to_memslot() is relatively expensive, it helps to skip it if it
+ * the test cannot possibly return true.  On the other hand, if any memslot has
+ * logging enabled, chances are good that all of them do, in which case
+ * unaccount_nx_huge_page() is much cheaper than zapping the page.
+ *
+ * If a memslot update is in progress, reading an incorrect value of
+ * kvm->nr_memslots_dirty_logging is not a problem: if it is becoming zero,
+ * gfn_to_memslot() will be done unnecessarily; if it is becoming nonzero, the
+ * page will be zapped unnecessarily.  Either way, this only affects efficiency
+ * in racy situations, and not correctness.
+ */
+bool nx_huge_page_is_dirty_logged(struct kvm *kvm, struct kvm_mmu_page *sp)
+{
+	struct kvm_memory_slot *slot;
+	struct kvm_memslots *slots;
+
+	if (!atomic_read(&kvm->nr_memslots_dirty_logging))
+		return false;
+
+	slots = kvm_memslots_for_spte_role(kvm, sp->role);
+	slot = __gfn_to_memslot(slots, sp->gfn);
+	WARN_ON_ONCE(!slot);
+
+	return slot && kvm_slot_dirty_track_enabled(slot);
+}
+
 static void kvm_recover_nx_huge_pages(struct kvm *kvm)
 {
 	unsigned long nx_lpage_splits = kvm->stat.nx_lpage_splits;
-	struct kvm_memory_slot *slot;
 	int rcu_idx;
 	struct kvm_mmu_page *sp;
 	unsigned int ratio;
@@ -7522,6 +7553,24 @@ static void kvm_recover_nx_huge_pages(struct kvm *kvm)
 	ulong to_zap;
 
 	rcu_idx = srcu_read_lock(&kvm->srcu);
+
+	ratio = READ_ONCE(nx_huge_pages_recovery_ratio);
+	to_zap = ratio ? DIV_ROUND_UP(nx_lpage_splits, ratio) : 0;
+
+	/*
+	 * TDP MMU pages can be zapped with mmu_lock held for read, which keeps
+	 * vCPUs from stalling on faults while recovery runs. Whatever is left
+	 * once a shadow MMU page reaches the head of the list is handled below.
+	 */
+	if (tdp_mmu_enabled && to_zap) {
+		read_lock(&kvm->mmu_lock);
+		to_zap = kvm_tdp_mmu_recover_nx_huge_pages(kvm, to_zap);
+		read_unlock(&kvm->mmu_lock);
+	}
+
+	if (!to_zap)
+		goto out;
+
 	write_lock(&kvm->mmu_lock);
 
 	/*
@@ -7531,8 +7580,6 @@ static void kvm_recover_nx_huge_pages(struct kvm *kvm)
 	 */
 	rcu_read_lock();
 
-	ratio = READ_ONCE(nx_huge_pages_recovery_ratio);
-	to_zap = ratio ? DIV_ROUND_UP(nx_lpage_splits, ratio) : 0;
 	for ( ; to_zap; --to_zap) {
 		if (list_empty(&kvm->arch.possible_nx_huge_pages))
 			break;
@@ -7550,36 +7597,7 @@ static void kvm_recover_nx_huge_pages(struct kvm *kvm)
 		WARN_ON_ONCE(!sp->nx_huge_page_disallowed);
 		WARN_ON_ONCE(!sp->role.direct);
 
-		/*
-		 * Unaccount and do not attempt to recover any NX Huge Pages
-		 * that are being dirty tracked, as they would just be faulted
-		 * back in as 4KiB pages. The NX Huge Pages in this slot will be
-		 * recovered, along with all the other huge pages in the slot,
-		 * when dirty logging is disabled.
-		 *
-		 * Since gfn_to_memslot() is relatively expensive, it helps to
-		 * skip it if it the test cannot possibly return true.  On the
-		 * other hand, if any memslot has logging enabled, chances are
-		 * good that all of them do, in which case unaccount_nx_huge_page()
-		 * is much cheaper than zapping the page.
-		 *
-		 * If a memslot update is in progress, reading an incorrect value
-		 * of kvm->nr_memslots_dirty_logging is not a problem: if it is
-		 * becoming zero, gfn_to_memslot() will be done unnecessarily; if
-		 * it is becoming nonzero, the page will be zapped unnecessarily.
-		 * Either way, this only affects efficiency in racy situations,
-		 * and not correctness.
-		 */
-		slot = NULL;
-		if (atomic_read(&kvm->nr_memslots_dirty_logging)) {
-			struct kvm_memslots *slots;
-
-			slots = kvm_memslots_for_spte_role(kvm, sp->role);
-			slot = __gfn_to_memslot(slots, sp->gfn);
-			WARN_ON_ONCE(!slot);
-		}
-
-		if (slot && kvm_slot_dirty_track_enabled(slot))
+		if (nx_huge_page_is_dirty_logged(kvm, sp))
 			unaccount_nx_huge_page(kvm, sp);
 		else if (is_tdp_mmu_page(sp))
 			flush |= kvm_tdp_mmu_zap_sp(kvm, sp);
@@ -7602,6 +7620,7 @@ static void kvm_recover_nx_huge_pages(struct kvm *kvm)
 	rcu_read_unlock();
 
 	write_unlock(&kvm->mmu_lock);
+out:
 	srcu_read_unlock(&kvm->srcu, rcu_idx);
 }
 
@@ -946,6 +946,103 @@ bool kvm_tdp_mmu_zap_sp(struct kvm *kvm, struct kvm_mmu_page *sp)
 	return true;
 }
 
+static bool tdp_mmu_zap_possible_nx_huge_page(struct kvm *kvm,
+					      struct kvm_mmu_page *sp)
+{
+	struct tdp_iter iter = {
+		.sptep = sp->ptep,
+		.level = sp->role.level + 1,
+		.gfn = sp->gfn,
+		.as_id = kvm_mmu_page_as_id(sp),
+	};
+
+	if (WARN_ON_ONCE(!sp->ptep))
+		return false;
+
+	/*
+	 * With mmu_lock held for read, the parent SPTE may have been zapped or
+	 * replaced since @sp was picked from the list, in which case whoever
+	 * did it also takes care of unlinking @sp. Only zap the SPTE if it
+	 * still points at @sp; the cmpxchg fails if that changes afterwards.
+	 */
+	iter.old_spte = kvm_tdp_mmu_read_spte(sp->ptep);
+	if (!is_shadow_present_pte(iter.old_spte) ||
+	    is_last_spte(iter.old_spte, iter.level) ||
+	    spte_to_child_sp(iter.old_spte) != sp)
+		return false;
+
+	return !tdp_mmu_set_spte_atomic(kvm, &iter, SHADOW_NONPRESENT_VALUE);
+}
+
+/*
+ * Zap up to @to_zap TDP MMU shadow pages from the head of the list of possible
+ * NX huge pages, with mmu_lock held for read so that vCPUs can keep handling
+ * faults in the meantime. Stop at the first shadow MMU or mirror page, those
+ * need mmu_lock held for write.
+ *
+ * Returns the number of pages that are left to zap.
+ */
+ulong kvm_tdp_mmu_recover_nx_huge_pages(struct kvm *kvm, ulong to_zap)
+{
+	struct list_head *nx_huge_pages = &kvm->arch.possible_nx_huge_pages;
+	struct kvm_mmu_page *sp;
+	bool flush = false;
+
+	lockdep_assert_held_read(&kvm->mmu_lock);
+
+	/*
+	 * Zapping TDP MMU shadow pages, including the remote TLB flush, must
+	 * be done under RCU protection, because the pages are freed via RCU
+	 * callback.
+	 */
+	rcu_read_lock();
+
+	for ( ; to_zap; --to_zap) {
+		spin_lock(&kvm->arch.tdp_mmu_pages_lock);
+		sp = list_first_entry_or_null(nx_huge_pages, struct kvm_mmu_page,
+					      possible_nx_huge_page_link);
+		if (!sp || !is_tdp_mmu_page(sp) || is_mirror_sp(sp)) {
+			spin_unlock(&kvm->arch.tdp_mmu_pages_lock);
+			break;
+		}
+
+		WARN_ON_ONCE(!sp->nx_huge_page_disallowed);
+
+		if (nx_huge_page_is_dirty_logged(kvm, sp)) {
+			sp->nx_huge_page_disallowed = false;
+			untrack_possible_nx_huge_page(kvm, sp);
+			spin_unlock(&kvm->arch.tdp_mmu_pages_lock);
+			continue;
+		}
+
+		/*
+		 * Rotate @sp so that the loop makes progress even if a racing
+		 * task zapped its parent SPTE but hasn't unlinked it yet.
+		 */
+		list_move_tail(&sp->possible_nx_huge_page_link, nx_huge_pages);
+		spin_unlock(&kvm->arch.tdp_mmu_pages_lock);
+
+		flush |= tdp_mmu_zap_possible_nx_huge_page(kvm, sp);
+
+		if (need_resched() || rwlock_needbreak(&kvm->mmu_lock)) {
+			if (flush)
+				kvm_flush_remote_tlbs(kvm);
+			flush = false;
+
+			rcu_read_unlock();
+			cond_resched_rwlock_read(&kvm->mmu_lock);
+			rcu_read_lock();
+		}
+	}
+
+	if (flush)
+		kvm_flush_remote_tlbs(kvm);
+
+	rcu_read_unlock();
+
+	return to_zap;
+}
+
 /*
  * If can_yield is true, will release the MMU lock and reschedule if the
  * scheduler needs the CPU or there is contention on the MMU lock. If this
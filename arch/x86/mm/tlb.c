@@ -527,6 +527,7 @@ static void broadcast_tlb_flush(struct flush_tlb_info *info)
 
 	/* Wait for the INVLPGBs kicked off above to finish. */
 	__tlbsync();
+	count_vm_tlb_event(NR_TLB_BROADCAST_FLUSH);
 }
 
 /*
@@ -1400,14 +1401,15 @@ static void do_flush_tlb_all(void *info)
 
 void flush_tlb_all(void)
 {
-	count_vm_tlb_event(NR_TLB_REMOTE_FLUSH);
-
 	/* First try (faster) hardware-assisted TLB invalidation. */
-	if (cpu_feature_enabled(X86_FEATURE_INVLPGB))
+	if (cpu_feature_enabled(X86_FEATURE_INVLPGB)) {
+		count_vm_tlb_event(NR_TLB_BROADCAST_FLUSH);
 		invlpgb_flush_all();
-	else
+	} else {
 		/* Fall back to the IPI-based invalidation. */
+		count_vm_tlb_event(NR_TLB_REMOTE_FLUSH);
 		on_each_cpu(do_flush_tlb_all, NULL, 1);
+	}
 }
 
 /* Flush an arbitrarily large range of memory with INVLPGB. */
@@ -1427,6 +1429,7 @@ static void invlpgb_kernel_range_flush(struct flush_tlb_info *info)
 		invlpgb_flush_addr_nosync(addr, nr);
 	}
 	__tlbsync();
+	count_vm_tlb_event(NR_TLB_BROADCAST_FLUSH);
 }
 
 static void do_kernel_range_flush(void *info)
@@ -1441,10 +1444,12 @@ static void do_kernel_range_flush(void *info)
 
 static void kernel_tlb_flush_all(struct flush_tlb_info *info)
 {
-	if (cpu_feature_enabled(X86_FEATURE_INVLPGB))
+	if (cpu_feature_enabled(X86_FEATURE_INVLPGB)) {
+		count_vm_tlb_event(NR_TLB_BROADCAST_FLUSH);
 		invlpgb_flush_all();
-	else
+	} else {
 		on_each_cpu(do_flush_tlb_all, NULL, 1);
+	}
 }
 
 static void kernel_tlb_flush_range(struct flush_tlb_info *info)
@@ -1649,6 +1654,7 @@ void arch_tlbbatch_flush(struct arch_tlbflush_unmap_batch *batch)
 	 * flush_tlb_func_local() directly in this case.
 	 */
 	if (cpu_feature_enabled(X86_FEATURE_INVLPGB) && batch->unmapped_pages) {
+		count_vm_tlb_event(NR_TLB_BROADCAST_FLUSH);
 		invlpgb_flush_all_nonglobals();
 		batch->unmapped_pages = false;
 	} else if (cpumask_any_but(&batch->cpumask, cpu) < nr_cpu_ids) {
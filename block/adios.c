@@ -16,14 +16,20 @@
 #include <linux/slab.h>
 #include <linux/timekeeping.h>
 #include <linux/percpu.h>
+#include <linux/percpu_counter.h>
 #include <linux/string.h>
 
 #include "elevator.h"
 #include "blk.h"
+#include "blk-cgroup.h"
 #include "blk-mq.h"
+#include "blk-mq-debugfs.h"
 #include "blk-mq-sched.h"
 
-#define ADIOS_VERSION "2.3.1"
+#define CREATE_TRACE_POINTS
+#include <trace/events/adios.h>
+
+#define ADIOS_VERSION "2.6.0"
 
 // Define operation types supported by ADIOS
 enum adios_op_type {
@@ -69,6 +75,22 @@ static u32 default_dl_prio[2] = {7, 0};
 #define LM_OUTLIER_PERCENTILE     99
 #define LM_LAT_BUCKET_COUNT       64
 
+// Piecewise corrections of the linear model, in fixed point (1024 = 1.0)
+#define LM_SCALE_SHIFT            10
+#define LM_SCALE_ONE              (1U << LM_SCALE_SHIFT)
+#define LM_SCALE_MIN              (LM_SCALE_ONE / 4)
+#define LM_SCALE_MAX              (LM_SCALE_ONE * 8)
+#define LM_SCALE_EWMA_SHIFT        4
+
+// Size classes: <= 4K, <= 16K, <= 64K, larger
+#define LM_SIZE_CLASSES            4
+
+// Write background levels: recent write volume < 64M, < 256M, < 1G, larger
+#define LM_BG_LEVELS               4
+#define LM_BG_LEVEL0_BYTES        (64ULL << 20)
+#define LM_BG_INTERVAL           100
+#define LM_BG_STALE             1000
+
 // Structure to hold latency bucket data for small requests
 struct latency_bucket_small {
 	u64 sum_latency;
@@ -102,16 +124,38 @@ struct latency_model {
 	// Per-CPU buckets to avoid lock contention on the completion path
 	struct lm_buckets __percpu *pcpu_buckets;
 
+	// Learned ratio of measured to linear latency per size class and
+	// write background level, updated locklessly from completions
+	u32 size_scale[LM_SIZE_CLASSES];
+	u32 bg_scale[LM_BG_LEVELS];
+
 	u32 lm_shrink_at_kreqs;
 	u32 lm_shrink_at_gbytes;
 	u8  lm_shrink_resist;
 };
 
 #define ADIOS_BQ_PAGES 2
+#define ADIOS_PRED_LAT_ERR_DIV 8
 #define ADIOS_MAX_INSERTS_PER_LOCK 16
 
-// Adios scheduler data
-struct adios_data {
+// Prediction error histogram: < 1us, then one bucket per power of two
+#define ADIOS_HIST_BUCKETS 24
+#define ADIOS_HIST_SHIFT   10
+
+// Per-CPU instrumentation of the completion path
+struct adios_stats {
+	// [early/late][bucket] of |actual - predicted| latency
+	u64 lat_err[ADIOS_OPTYPES][2][ADIOS_HIST_BUCKETS];
+	u64 completed[ADIOS_OPTYPES];
+	u64 dl_misses[ADIOS_OPTYPES];
+	// Time spent in the deadline tree and in the batch queues
+	u64 dl_time[ADIOS_OPTYPES];
+	u64 bq_time[ADIOS_OPTYPES];
+	u64 timed[ADIOS_OPTYPES];
+};
+
+// Per hardware queue dispatch state
+struct adios_hctx_data {
 	spinlock_t pq_lock;
 	struct list_head prio_queue;
 
@@ -119,6 +163,26 @@ struct adios_data {
 	spinlock_t lock;
 	u8  dl_queued;
 	s64 dl_bias;
+	// Earliest queued deadline, read locklessly by the other hctxs
+	u64 dl_first;
+
+	bool bq_page;
+	bool more_bq_ready;
+	struct list_head batch_queue[ADIOS_BQ_PAGES][ADIOS_OPTYPES];
+	u32 batch_count[ADIOS_BQ_PAGES][ADIOS_OPTYPES];
+	spinlock_t bq_lock;
+
+	unsigned int index;
+} ____cacheline_aligned_in_smp;
+
+// Adios scheduler data
+struct adios_data {
+	// Dispatch state of each hardware queue, indexed by hctx->queue_num
+	struct adios_hctx_data **hds;
+	unsigned int nr_hds;
+	// Elevator merging, only with a single hardware queue
+	bool merge;
+
 	s32 dl_prio[2];
 
 	u64 global_latency_window;
@@ -129,18 +193,29 @@ struct adios_data {
 	u32 async_depth;
 	u8  bq_refill_below_ratio;
 
-	bool bq_page;
-	bool more_bq_ready;
-	struct list_head batch_queue[ADIOS_BQ_PAGES][ADIOS_OPTYPES];
-	u32 batch_count[ADIOS_BQ_PAGES][ADIOS_OPTYPES];
-	spinlock_t bq_lock;
-
 	struct lm_buckets *aggr_buckets;
 
 	struct latency_model latency_model[ADIOS_OPTYPES];
 	struct timer_list update_timer;
 
-	atomic64_t total_pred_lat;
+	// Recent write volume, sampled by the update timer
+	bool lm_bg;
+	u8  bg_level;
+	atomic64_t bg_bytes;
+	u64 bg_volume;
+	unsigned long bg_stamp;
+
+	/*
+	 * Predicted latency of the dispatched but not completed requests.
+	 * Per-CPU deltas fold into the global value once they exceed
+	 * pred_lat_batch, so a plain read is off by less than
+	 * num_online_cpus() * pred_lat_batch, which is kept at
+	 * global_latency_window / ADIOS_PRED_LAT_ERR_DIV.
+	 */
+	struct percpu_counter total_pred_lat;
+	s32 pred_lat_batch;
+
+	struct adios_stats __percpu *stats;
 
 	struct kmem_cache *rq_data_pool;
 	struct kmem_cache *dl_group_pool;
@@ -163,6 +238,8 @@ struct adios_rq_data {
 	struct request *rq;
 	u64 deadline;
 	u64 pred_lat;
+	// When the request was moved to a batch queue
+	u64 bq_time;
 	u32 block_size;
 } __attribute__((aligned(64)));
 
@@ -321,6 +398,13 @@ static bool lm_update_large_buckets(struct latency_model *model,
 static void reset_buckets(struct lm_buckets *buckets)
 { memset(buckets, 0, sizeof(*buckets)); }
 
+static void lm_reset_scales(struct latency_model *model) {
+	for (u8 i = 0; i < LM_SIZE_CLASSES; i++)
+		WRITE_ONCE(model->size_scale[i], LM_SCALE_ONE);
+	for (u8 i = 0; i < LM_BG_LEVELS; i++)
+		WRITE_ONCE(model->bg_scale[i], LM_SCALE_ONE);
+}
+
 static void lm_reset_pcpu_buckets(struct latency_model *model) {
 	int cpu;
 	for_each_possible_cpu(cpu)
@@ -418,6 +502,98 @@ static u8 lm_input_bucket_index(u64 measured, u64 predicted) {
 	return bucket_index;
 }
 
+// Determine the size class of a request
+static u8 lm_size_class(u32 block_size) {
+	if (block_size <= LM_BLOCK_SIZE_THRESHOLD)
+		return 0;
+	if (block_size <= 4 * LM_BLOCK_SIZE_THRESHOLD)
+		return 1;
+	if (block_size <= 16 * LM_BLOCK_SIZE_THRESHOLD)
+		return 2;
+	return 3;
+}
+
+// Current write background level, 0 if the sample is stale
+static u8 lm_bg_level(struct adios_data *ad) {
+	if (time_after(jiffies, READ_ONCE(ad->bg_stamp) +
+			msecs_to_jiffies(LM_BG_STALE)))
+		return 0;
+	return READ_ONCE(ad->bg_level);
+}
+
+// Sample the recent write volume into a background level
+static void lm_update_bg(struct adios_data *ad) {
+	unsigned long now = jiffies;
+	u8 level = 0;
+
+	if (time_before(now, ad->bg_stamp + msecs_to_jiffies(LM_BG_INTERVAL)))
+		return;
+
+	// Halve the volume at each sample, so it covers the last few intervals
+	ad->bg_volume = (ad->bg_volume >> 1) + atomic64_xchg(&ad->bg_bytes, 0);
+	while (level < LM_BG_LEVELS - 1 &&
+			ad->bg_volume >= (LM_BG_LEVEL0_BYTES << (2 * level)))
+		level++;
+
+	WRITE_ONCE(ad->bg_level, level);
+	WRITE_ONCE(ad->bg_stamp, now);
+}
+
+// Predict the latency for a given block size using the linear model only
+static u64 latency_model_predict_linear(struct latency_model *model,
+		u32 block_size) {
+	u64 result, base, slope;
+	unsigned int seq;
+
+	do {
+		seq = read_seqbegin(&model->lock);
+		base = model->base;
+		slope = model->slope;
+	} while (read_seqretry(&model->lock, seq));
+
+	result = base;
+	if (block_size > LM_BLOCK_SIZE_THRESHOLD)
+		result += slope *
+			DIV_ROUND_UP_ULL(block_size - LM_BLOCK_SIZE_THRESHOLD, 1024);
+
+	return result;
+}
+
+// Move a correction towards the measured to predicted latency ratio
+static void lm_scale_learn(u32 *scale, u64 measured, u64 predicted) {
+	s32 cur = READ_ONCE(*scale), ratio;
+
+	if (!predicted)
+		return;
+
+	ratio = clamp_t(u64, div64_u64(measured << LM_SCALE_SHIFT, predicted),
+			LM_SCALE_MIN, LM_SCALE_MAX);
+	WRITE_ONCE(*scale, cur + (ratio - cur) / (1 << LM_SCALE_EWMA_SHIFT));
+}
+
+/*
+ * Learn the piecewise corrections of the linear model. Small requests are
+ * what the base is fitted on, so only larger size classes get a size
+ * correction; the background correction applies to all of them.
+ */
+static void lm_learn_scales(struct adios_data *ad,
+		struct latency_model *model, u32 block_size, u64 latency) {
+	u64 linear = latency_model_predict_linear(model, block_size);
+	u8 class = lm_size_class(block_size), level = lm_bg_level(ad);
+	u32 size_scale = READ_ONCE(model->size_scale[class]);
+	u32 bg_scale = ad->lm_bg ? READ_ONCE(model->bg_scale[level]) : LM_SCALE_ONE;
+
+	if (!linear)
+		return;
+
+	if (class)
+		lm_scale_learn(&model->size_scale[class], latency,
+			(linear * bg_scale) >> LM_SCALE_SHIFT);
+	if (ad->lm_bg)
+		lm_scale_learn(&model->bg_scale[level], latency,
+			(linear * size_scale) >> LM_SCALE_SHIFT);
+}
+
 // Input latency data into the latency model
 static void latency_model_input(struct adios_data *ad,
 		struct latency_model *model, u32 block_size, u64 latency, u64 pred_lat) {
@@ -425,6 +601,9 @@ static void latency_model_input(struct adios_data *ad,
 	u8 bucket_index;
 	struct lm_buckets *buckets;
 
+	if (model->base)
+		lm_learn_scales(ad, model, block_size, latency);
+
 	local_irq_save(flags);
 	buckets = per_cpu_ptr(model->pcpu_buckets, __smp_processor_id());
 
@@ -465,20 +644,15 @@ static void latency_model_input(struct adios_data *ad,
 }
 
 // Predict the latency for a given block size using the latency model
-static u64 latency_model_predict(struct latency_model *model, u32 block_size) {
-	u64 result, base, slope;
-	unsigned int seq;
-
-	do {
-		seq = read_seqbegin(&model->lock);
-		base = model->base;
-		slope = model->slope;
-	} while (read_seqretry(&model->lock, seq));
+static u64 latency_model_predict(struct adios_data *ad,
+		struct latency_model *model, u32 block_size) {
+	u64 result = latency_model_predict_linear(model, block_size);
 
-	result = base;
-	if (block_size > LM_BLOCK_SIZE_THRESHOLD)
-		result += slope *
-			DIV_ROUND_UP_ULL(block_size - LM_BLOCK_SIZE_THRESHOLD, 1024);
+	result = (result * READ_ONCE(model->size_scale[lm_size_class(block_size)]))
+		>> LM_SCALE_SHIFT;
+	if (ad->lm_bg)
+		result = (result * READ_ONCE(model->bg_scale[lm_bg_level(ad)]))
+			>> LM_SCALE_SHIFT;
 
 	return result;
 }
@@ -506,10 +680,176 @@ static inline struct adios_rq_data *get_rq_data(struct request *rq) {
 	return rq->elv.priv[0];
 }
 
+// Helper function to retrieve the dispatch state a request is queued on
+static inline struct adios_hctx_data *get_rq_hd(struct request *rq) {
+	return rq->mq_hctx->sched_data;
+}
+
+static struct adios_rq_data *get_dl_first_rd(
+		struct adios_hctx_data *hd, bool idx) {
+	struct rb_root_cached *root = &hd->dl_tree[idx];
+	struct rb_node *first = rb_first_cached(root);
+	struct dl_group *dl_group = rb_entry(first, struct dl_group, node);
+
+	return list_first_entry(&dl_group->rqs, struct adios_rq_data, dl_node);
+}
+
+// Publish the earliest deadline queued on a hctx for dispatch arbitration
+static void update_dl_first(struct adios_hctx_data *hd) {
+	u64 dl_first = U64_MAX;
+
+	for (u8 i = 0; i < 2; i++)
+		if (hd->dl_queued & (1 << i))
+			dl_first = min(dl_first, get_dl_first_rd(hd, i)->deadline);
+
+	WRITE_ONCE(hd->dl_first, dl_first);
+}
+
+#ifdef CONFIG_BLK_CGROUP
+static struct blkcg_policy blkcg_policy_adios;
+
+/*
+ * Per cgroup deadline parameters: the latency target of a request is
+ * either the cgroup override or the queue one, scaled by
+ * CGROUP_WEIGHT_DFL / weight.
+ */
+struct adios_blkcg {
+	struct blkcg_policy_data cpd;
+	u32 weight;
+	u64 lat_target[ADIOS_OPTYPES];
+};
+
+static struct adios_blkcg *blkcg_to_adios_blkcg(struct blkcg *blkcg) {
+	struct blkcg_policy_data *cpd = blkcg_to_cpd(blkcg, &blkcg_policy_adios);
+
+	return cpd ? container_of(cpd, struct adios_blkcg, cpd) : NULL;
+}
+
+static struct adios_blkcg *adios_blkcg_from_css(
+		struct cgroup_subsys_state *css) {
+	return blkcg_to_adios_blkcg(css_to_blkcg(css));
+}
+
+static int adios_blkcg_weight_show(struct seq_file *sf, void *v) {
+	struct adios_blkcg *abg = adios_blkcg_from_css(seq_css(sf));
+
+	seq_printf(sf, "%u\n", READ_ONCE(abg->weight));
+	return 0;
+}
+
+static ssize_t adios_blkcg_weight_write(struct kernfs_open_file *of,
+		char *buf, size_t nbytes, loff_t off) {
+	struct adios_blkcg *abg = adios_blkcg_from_css(of_css(of));
+	u32 weight;
+	int ret;
+
+	ret = kstrtou32(strstrip(buf), 0, &weight);
+	if (ret)
+		return ret;
+	if (weight < CGROUP_WEIGHT_MIN || weight > CGROUP_WEIGHT_MAX)
+		return -ERANGE;
+
+	WRITE_ONCE(abg->weight, weight);
+	return nbytes;
+}
+
+static int adios_blkcg_lat_target_show(struct seq_file *sf, void *v) {
+	struct adios_blkcg *abg = adios_blkcg_from_css(seq_css(sf));
+
+	seq_printf(sf, "%llu %llu %llu\n",
+		READ_ONCE(abg->lat_target[ADIOS_READ]),
+		READ_ONCE(abg->lat_target[ADIOS_WRITE]),
+		READ_ONCE(abg->lat_target[ADIOS_DISCARD]));
+	return 0;
+}
+
+// "R W D" latency targets in ns, 0 uses the target of the queue
+static ssize_t adios_blkcg_lat_target_write(struct kernfs_open_file *of,
+		char *buf, size_t nbytes, loff_t off) {
+	struct adios_blkcg *abg = adios_blkcg_from_css(of_css(of));
+	u64 target[3];
+
+	if (sscanf(buf, "%llu %llu %llu",
+			&target[ADIOS_READ], &target[ADIOS_WRITE],
+			&target[ADIOS_DISCARD]) != 3)
+		return -EINVAL;
+
+	for (u8 i = ADIOS_READ; i <= ADIOS_DISCARD; i++)
+		WRITE_ONCE(abg->lat_target[i], target[i]);
+	return nbytes;
+}
+
+static struct cftype adios_blkcg_files[] = {
+	{
+		.name		= "adios.weight",
+		.flags		= CFTYPE_NOT_ON_ROOT,
+		.seq_show	= adios_blkcg_weight_show,
+		.write		= adios_blkcg_weight_write,
+	},
+	{
+		.name		= "adios.lat_target",
+		.flags		= CFTYPE_NOT_ON_ROOT,
+		.seq_show	= adios_blkcg_lat_target_show,
+		.write		= adios_blkcg_lat_target_write,
+	},
+	{ } /* sentinel */
+};
+
+static struct blkcg_policy_data *adios_cpd_alloc(gfp_t gfp) {
+	struct adios_blkcg *abg;
+
+	abg = kzalloc(sizeof(*abg), gfp);
+	if (!abg)
+		return NULL;
+	abg->weight = CGROUP_WEIGHT_DFL;
+	return &abg->cpd;
+}
+
+static void adios_cpd_free(struct blkcg_policy_data *cpd) {
+	kfree(container_of(cpd, struct adios_blkcg, cpd));
+}
+
+static struct blkcg_policy blkcg_policy_adios = {
+	.dfl_cftypes	= adios_blkcg_files,
+	.legacy_cftypes	= adios_blkcg_files,
+
+	.cpd_alloc_fn	= adios_cpd_alloc,
+	.cpd_free_fn	= adios_cpd_free,
+};
+
+// Latency target of a request, weighted by the cgroup that issued it
+static u64 adios_rq_lat_target(struct adios_data *ad, struct request *rq,
+		u8 optype) {
+	u64 target = ad->latency_target[optype];
+	struct adios_blkcg *abg;
+	u32 weight;
+
+	if (!rq->bio || !rq->bio->bi_blkg)
+		return target;
+
+	abg = blkcg_to_adios_blkcg(rq->bio->bi_blkg->blkcg);
+	if (!abg)
+		return target;
+
+	target = READ_ONCE(abg->lat_target[optype]) ?: target;
+	weight = READ_ONCE(abg->weight);
+	if (weight != CGROUP_WEIGHT_DFL)
+		target = div_u64(target * CGROUP_WEIGHT_DFL, weight);
+
+	return target;
+}
+#else
+static u64 adios_rq_lat_target(struct adios_data *ad, struct request *rq,
+		u8 optype) {
+	return ad->latency_target[optype];
+}
+#endif
+
 // Add a request to the deadline-sorted red-black tree
 static void add_to_dl_tree(
 		struct adios_data *ad, bool dl_idx, struct request *rq) {
-	struct rb_root_cached *root = &ad->dl_tree[dl_idx];
+	struct adios_hctx_data *hd = get_rq_hd(rq);
+	struct rb_root_cached *root = &hd->dl_tree[dl_idx];
 	struct rb_node **link = &(root->rb_root.rb_node), *parent = NULL;
 	bool leftmost = true;
 	struct adios_rq_data *rd = get_rq_data(rq);
@@ -518,9 +858,10 @@ static void add_to_dl_tree(
 	rd->block_size = blk_rq_bytes(rq);
 	u8 optype = adios_optype(rq);
 	rd->pred_lat =
-		latency_model_predict(&ad->latency_model[optype], rd->block_size);
-	rd->deadline =
-		rq->start_time_ns + ad->latency_target[optype] + rd->pred_lat;
+		latency_model_predict(ad, &ad->latency_model[optype], rd->block_size);
+	rd->deadline = rq->start_time_ns +
+		adios_rq_lat_target(ad, rq, optype) + rd->pred_lat;
+	trace_adios_insert(rq, optype, rd->deadline, rd->pred_lat);
 
 	while (*link) {
 		dlg = rb_entry(*link, struct dl_group, node);
@@ -550,13 +891,16 @@ static void add_to_dl_tree(
 found:
 	list_add_tail(&rd->dl_node, &dlg->rqs);
 	rd->dl_group = &dlg->rqs;
-	ad->dl_queued |= 1 << dl_idx;
+	hd->dl_queued |= 1 << dl_idx;
+	if (rd->deadline < hd->dl_first)
+		WRITE_ONCE(hd->dl_first, rd->deadline);
 }
 
 // Remove a request from the deadline-sorted red-black tree
 static void del_from_dl_tree(
 		struct adios_data *ad, bool dl_idx, struct request *rq) {
-	struct rb_root_cached *root = &ad->dl_tree[dl_idx];
+	struct adios_hctx_data *hd = get_rq_hd(rq);
+	struct rb_root_cached *root = &hd->dl_tree[dl_idx];
 	struct adios_rq_data *rd = get_rq_data(rq);
 	struct dl_group *dlg = container_of(rd->dl_group, struct dl_group, rqs);
 
@@ -567,8 +911,9 @@ static void del_from_dl_tree(
 	}
 	rd->dl_group = NULL;
 
-	if (RB_EMPTY_ROOT(&ad->dl_tree[dl_idx].rb_root))
-		ad->dl_queued &= ~(1 << dl_idx);
+	if (RB_EMPTY_ROOT(&hd->dl_tree[dl_idx].rb_root))
+		hd->dl_queued &= ~(1 << dl_idx);
+	update_dl_first(hd);
 }
 
 // Remove a request from the scheduler
@@ -634,7 +979,7 @@ static void adios_merged_requests(struct request_queue *q, struct request *req,
 				   struct request *next) {
 	struct adios_data *ad = q->elevator->elevator_data;
 
-	lockdep_assert_held(&ad->lock);
+	lockdep_assert_held(&get_rq_hd(next)->lock);
 
 	// kill knowledge of next, this one is a goner
 	remove_request(ad, next);
@@ -647,7 +992,14 @@ static bool adios_bio_merge(struct request_queue *q, struct bio *bio,
 	struct request *free = NULL;
 	bool ret;
 
-	scoped_guard(spinlock_irqsave, &ad->lock)
+	/*
+	 * The elevator hash is queue wide, so it can only be used when all
+	 * requests sit behind the lock of the single hctx.
+	 */
+	if (!ad->merge)
+		return false;
+
+	scoped_guard(spinlock_irqsave, &ad->hds[0]->lock)
 		ret = blk_mq_sched_try_merge(q, bio, nr_segs, &free);
 
 	if (free)
@@ -662,19 +1014,22 @@ static void insert_request(struct blk_mq_hw_ctx *hctx, struct request *rq,
 	bool dl_idx = adios_optype_not_read(rq);
 	struct request_queue *q = hctx->queue;
 	struct adios_data *ad = q->elevator->elevator_data;
+	struct adios_hctx_data *hd = hctx->sched_data;
+
+	get_rq_data(rq)->bq_time = 0;
 
 	if (insert_flags & BLK_MQ_INSERT_AT_HEAD) {
-		scoped_guard(spinlock_irqsave, &ad->pq_lock)
-			list_add_tail(&rq->queuelist, &ad->prio_queue);
+		scoped_guard(spinlock_irqsave, &hd->pq_lock)
+			list_add_tail(&rq->queuelist, &hd->prio_queue);
 		return;
 	}
 
-	if (blk_mq_sched_try_insert_merge(q, rq, free))
+	if (ad->merge && blk_mq_sched_try_insert_merge(q, rq, free))
 		return;
 
 	add_to_dl_tree(ad, dl_idx, rq);
 
-	if (rq_mergeable(rq)) {
+	if (ad->merge && rq_mergeable(rq)) {
 		elv_rqhash_add(q, rq);
 		if (!q->last_merge)
 			q->last_merge = rq;
@@ -685,14 +1040,13 @@ static void insert_request(struct blk_mq_hw_ctx *hctx, struct request *rq,
 static void adios_insert_requests(struct blk_mq_hw_ctx *hctx,
 				   struct list_head *list,
 				   blk_insert_t insert_flags) {
-	struct request_queue *q = hctx->queue;
-	struct adios_data *ad = q->elevator->elevator_data;
+	struct adios_hctx_data *hd = hctx->sched_data;
 	struct request *rq;
 	bool stop = false;
 	LIST_HEAD(free);
 
 	do {
-	scoped_guard(spinlock_irqsave, &ad->lock)
+	scoped_guard(spinlock_irqsave, &hd->lock)
 		for (int i = 0; i < ADIOS_MAX_INSERTS_PER_LOCK; i++) {
 			if (list_empty(list)) {
 				stop = true;
@@ -724,41 +1078,59 @@ static void adios_prepare_request(struct request *rq) {
 	rq->elv.priv[0] = rd;
 }
 
-static struct adios_rq_data *get_dl_first_rd(struct adios_data *ad, bool idx) {
-	struct rb_root_cached *root = &ad->dl_tree[idx];
-	struct rb_node *first = rb_first_cached(root);
-	struct dl_group *dl_group = rb_entry(first, struct dl_group, node);
+// Earliest deadline queued on any hctx other than @hd
+static u64 foreign_dl_first(struct adios_data *ad, struct adios_hctx_data *hd) {
+	u64 dl_first = U64_MAX;
 
-	return list_first_entry(&dl_group->rqs, struct adios_rq_data, dl_node);
+	for (unsigned int i = 0; i < ad->nr_hds; i++) {
+		struct adios_hctx_data *other = READ_ONCE(ad->hds[i]);
+
+		if (other && other != hd)
+			dl_first = min(dl_first, READ_ONCE(other->dl_first));
+	}
+	return dl_first;
 }
 
 // Fill the batch queues with requests from the deadline-sorted red-black tree
-static bool fill_batch_queues(struct adios_data *ad, u64 current_lat) {
+static bool fill_batch_queues(struct adios_data *ad,
+		struct adios_hctx_data *hd, u64 current_lat) {
 	struct adios_rq_data *rd;
 	struct request *rq;
 	u32 optype_count[ADIOS_OPTYPES] = {0};
 	u32 count = 0;
 	u8 optype;
-	bool page = !ad->bq_page, dl_idx, bias_idx, reduce_bias;
+	bool page = !hd->bq_page, dl_idx, bias_idx, reduce_bias;
+	u64 refill_lat, others_first = U64_MAX, start_lat = current_lat;
+	u64 now = blk_time_get_ns();
+
+	/*
+	 * All hctxs share the global latency window. Past the refill threshold,
+	 * only take requests that are due before everything queued elsewhere,
+	 * so that a busy hctx does not fill the window ahead of more urgent
+	 * requests on the other ones.
+	 */
+	refill_lat = div_u64(ad->global_latency_window * ad->bq_refill_below_ratio, 100);
+	if (ad->nr_hds > 1)
+		others_first = foreign_dl_first(ad, hd);
 
 	// Reset batch queue counts for the back page
-	memset(&ad->batch_count[page], 0, sizeof(ad->batch_count[page]));
+	memset(&hd->batch_count[page], 0, sizeof(hd->batch_count[page]));
 
-	scoped_guard(spinlock_irqsave, &ad->lock)
+	scoped_guard(spinlock_irqsave, &hd->lock)
 		while (true) {
 
 			// Check if there are any requests queued in the deadline tree
-			if (!ad->dl_queued)
+			if (!hd->dl_queued)
 				break;
 
-			dl_idx = ad->dl_queued >> 1;
+			dl_idx = hd->dl_queued >> 1;
 			// Get the first request from the deadline-sorted tree
-			rd = get_dl_first_rd(ad, dl_idx);
-			bias_idx = ad->dl_bias < 0;
+			rd = get_dl_first_rd(hd, dl_idx);
+			bias_idx = hd->dl_bias < 0;
 
 			// If read and write requests are queued, choose one based on bias
-			if (ad->dl_queued == 0x3) {
-				struct adios_rq_data *trd[2] = {get_dl_first_rd(ad, 0), rd};
+			if (hd->dl_queued == 0x3) {
+				struct adios_rq_data *trd[2] = {get_dl_first_rd(hd, 0), rd};
 				rd = trd[bias_idx];
 
 				reduce_bias = (trd[bias_idx]->deadline > trd[!bias_idx]->deadline);
@@ -770,33 +1142,38 @@ static bool fill_batch_queues(struct adios_data *ad, u64 current_lat) {
 
 			// Check batch size and total predicted latency
 			if (count && (!ad->latency_model[optype].base ||
-					ad->batch_count[page][optype] >= ad->batch_limit[optype] ||
-					(current_lat + rd->pred_lat) > ad->global_latency_window))
+					hd->batch_count[page][optype] >= ad->batch_limit[optype] ||
+					(current_lat + rd->pred_lat) > ad->global_latency_window ||
+					(current_lat > refill_lat && rd->deadline > others_first)))
 				break;
 
 			if (reduce_bias) {
 				s64 sign = ((int)bias_idx << 1) - 1;
 				if (unlikely(!rd->pred_lat))
-					ad->dl_bias = sign;
+					hd->dl_bias = sign;
 				else
 					// Adjust the bias based on the predicted latency
-					ad->dl_bias += sign * (s64)((rd->pred_lat *
+					hd->dl_bias += sign * (s64)((rd->pred_lat *
 						adios_prio_to_weight[ad->dl_prio[bias_idx] + 20]) >> 10);
 			}
 
 			remove_request(ad, rq);
 
 			// Add request to the corresponding batch queue
-			list_add_tail(&rq->queuelist, &ad->batch_queue[page][optype]);
-			atomic64_add(rd->pred_lat, &ad->total_pred_lat);
+			list_add_tail(&rq->queuelist, &hd->batch_queue[page][optype]);
+			rd->bq_time = now;
+			percpu_counter_add_batch(&ad->total_pred_lat, rd->pred_lat,
+				ad->pred_lat_batch);
 			current_lat += rd->pred_lat;
-			ad->batch_count[page][optype]++;
+			hd->batch_count[page][optype]++;
 			optype_count[optype]++;
 			count++;
 		}
 
 	if (count) {
-		ad->more_bq_ready = true;
+		trace_adios_fill(ad->queue, hd->index, count,
+			current_lat - start_lat, current_lat);
+		hd->more_bq_ready = true;
 		for (u8 optype = 0; optype < ADIOS_OPTYPES; optype++)
 			if (ad->batch_actual_max_size[optype] < optype_count[optype])
 				ad->batch_actual_max_size[optype] = optype_count[optype];
@@ -806,39 +1183,61 @@ static bool fill_batch_queues(struct adios_data *ad, u64 current_lat) {
 	return count;
 }
 
+/*
+ * Read the in-flight predicted latency. Within the error bound of the
+ * approximate value, the queue may well be drained: fold the per-CPU
+ * deltas then, so that refilling on an empty window is never missed.
+ */
+static u64 read_total_pred_lat(struct adios_data *ad) {
+	s64 tpl = percpu_counter_read(&ad->total_pred_lat);
+
+	if (tpl <= (s64)ad->pred_lat_batch * num_online_cpus())
+		tpl = percpu_counter_sum(&ad->total_pred_lat);
+
+	return max_t(s64, tpl, 0);
+}
+
+// Set the folding batch of total_pred_lat from the global latency window
+static void update_pred_lat_batch(struct adios_data *ad) {
+	u64 batch = div_u64(ad->global_latency_window,
+		ADIOS_PRED_LAT_ERR_DIV * num_possible_cpus());
+
+	WRITE_ONCE(ad->pred_lat_batch, clamp_t(u64, batch, 1, S32_MAX));
+}
+
 // Flip to the next batch queue page
-static void flip_bq_page(struct adios_data *ad) {
-	ad->more_bq_ready = false;
-	ad->bq_page = !ad->bq_page;
+static void flip_bq_page(struct adios_hctx_data *hd) {
+	hd->more_bq_ready = false;
+	hd->bq_page = !hd->bq_page;
 }
 
 // Dispatch a request from the batch queues
-static struct request *dispatch_from_bq(struct adios_data *ad) {
+static struct request *dispatch_from_bq(struct adios_data *ad,
+		struct adios_hctx_data *hd) {
 	struct request *rq = NULL;
-	u64 tpl;
-
-	guard(spinlock_irqsave)(&ad->bq_lock);
+	/* May fold the percpu counter, so don't do it under bq_lock */
+	u64 tpl = read_total_pred_lat(ad);
 
-	tpl = atomic64_read(&ad->total_pred_lat);
+	guard(spinlock_irqsave)(&hd->bq_lock);
 
-	if (!ad->more_bq_ready && (!tpl || tpl < div_u64(
+	if (!hd->more_bq_ready && (!tpl || tpl < div_u64(
 			ad->global_latency_window * ad->bq_refill_below_ratio, 100)))
-		fill_batch_queues(ad, tpl);
+		fill_batch_queues(ad, hd, tpl);
 
 again:
 	// Check if there are any requests in the batch queues
 	for (u8 i = 0; i < ADIOS_OPTYPES; i++) {
-		if (!list_empty(&ad->batch_queue[ad->bq_page][i])) {
+		if (!list_empty(&hd->batch_queue[hd->bq_page][i])) {
 			rq = list_first_entry(
-				&ad->batch_queue[ad->bq_page][i], struct request, queuelist);
+				&hd->batch_queue[hd->bq_page][i], struct request, queuelist);
 			list_del_init(&rq->queuelist);
 			return rq;
 		}
 	}
 
 	// If there's more batch queue page available, flip to it and retry
-	if (ad->more_bq_ready) {
-		flip_bq_page(ad);
+	if (hd->more_bq_ready) {
+		flip_bq_page(hd);
 		goto again;
 	}
 
@@ -846,13 +1245,13 @@ static struct request *dispatch_from_bq(struct adios_data *ad) {
 }
 
 // Dispatch a request from the priority queue
-static struct request *dispatch_from_pq(struct adios_data *ad) {
+static struct request *dispatch_from_pq(struct adios_hctx_data *hd) {
 	struct request *rq = NULL;
 
-	guard(spinlock_irqsave)(&ad->pq_lock);
+	guard(spinlock_irqsave)(&hd->pq_lock);
 
-	if (!list_empty(&ad->prio_queue)) {
-		rq = list_first_entry(&ad->prio_queue, struct request, queuelist);
+	if (!list_empty(&hd->prio_queue)) {
+		rq = list_first_entry(&hd->prio_queue, struct request, queuelist);
 		list_del_init(&rq->queuelist);
 	}
 	return rq;
@@ -861,13 +1260,18 @@ static struct request *dispatch_from_pq(struct adios_data *ad) {
 // Dispatch a request to the hardware queue
 static struct request *adios_dispatch_request(struct blk_mq_hw_ctx *hctx) {
 	struct adios_data *ad = hctx->queue->elevator->elevator_data;
+	struct adios_hctx_data *hd = hctx->sched_data;
 	struct request *rq;
 
-	rq = dispatch_from_pq(ad);
+	bool from_pq = true;
+
+	rq = dispatch_from_pq(hd);
 	if (rq) goto found;
-	rq = dispatch_from_bq(ad);
+	from_pq = false;
+	rq = dispatch_from_bq(ad, hd);
 	if (!rq) return NULL;
 found:
+	trace_adios_dispatch(rq, adios_optype(rq), from_pq);
 	rq->rq_flags |= RQF_STARTED;
 	return rq;
 }
@@ -876,21 +1280,57 @@ static struct request *adios_dispatch_request(struct blk_mq_hw_ctx *hctx) {
 static void update_timer_callback(struct timer_list *t) {
 	struct adios_data *ad = from_timer(ad, t, update_timer);
 
+	lm_update_bg(ad);
 	for (u8 optype = 0; optype < ADIOS_OPTYPES; optype++)
 		latency_model_update(ad, &ad->latency_model[optype]);
 }
 
+// Account a completed request in the instrumentation of the queue
+static void adios_account_completion(struct adios_data *ad,
+		struct request *rq, struct adios_rq_data *rd, u8 optype,
+		u64 now, u64 latency) {
+	bool late = latency > rd->pred_lat;
+	u64 err = late ? latency - rd->pred_lat : rd->pred_lat - latency;
+	bool missed = now > rd->deadline;
+	struct adios_stats *stats;
+	unsigned long flags;
+	u8 bucket = 0;
+
+	if (err >> ADIOS_HIST_SHIFT)
+		bucket = min(ilog2(err) - ADIOS_HIST_SHIFT + 1,
+			ADIOS_HIST_BUCKETS - 1);
+
+	local_irq_save(flags);
+	stats = this_cpu_ptr(ad->stats);
+	stats->lat_err[optype][late][bucket]++;
+	stats->completed[optype]++;
+	stats->dl_misses[optype] += missed;
+	// Requests inserted at head never went through the deadline tree
+	if (rd->bq_time) {
+		stats->dl_time[optype] += rd->bq_time - rq->start_time_ns;
+		stats->bq_time[optype] += rq->io_start_time_ns - rd->bq_time;
+		stats->timed[optype]++;
+	}
+	local_irq_restore(flags);
+
+	trace_adios_complete(rq, optype, latency, rd->pred_lat, missed);
+}
+
 // Handle the completion of a request
 static void adios_completed_request(struct request *rq, u64 now) {
 	struct adios_data *ad = rq->q->elevator->elevator_data;
 	struct adios_rq_data *rd = get_rq_data(rq);
 
-	atomic64_sub(rd->pred_lat, &ad->total_pred_lat);
+	percpu_counter_add_batch(&ad->total_pred_lat, -(s64)rd->pred_lat,
+		ad->pred_lat_batch);
 
 	if (!rq->io_start_time_ns || !rd->block_size)
 		return;
 	u64 latency = now - rq->io_start_time_ns;
 	u8 optype = adios_optype(rq);
+	adios_account_completion(ad, rq, rd, optype, now, latency);
+	if (ad->lm_bg && optype == ADIOS_WRITE)
+		atomic64_add(rd->block_size, &ad->bg_bytes);
 	latency_model_input(ad, &ad->latency_model[optype],
 		rd->block_size, latency, rd->pred_lat);
 	timer_reduce(&ad->update_timer, jiffies + msecs_to_jiffies(100));
@@ -907,45 +1347,83 @@ static void adios_finish_request(struct request *rq) {
 	}
 }
 
-static inline bool pq_has_work(struct adios_data *ad) {
-	guard(spinlock_irqsave)(&ad->pq_lock);
-	return !list_empty(&ad->prio_queue);
+static inline bool pq_has_work(struct adios_hctx_data *hd) {
+	guard(spinlock_irqsave)(&hd->pq_lock);
+	return !list_empty(&hd->prio_queue);
 }
 
-static inline bool bq_has_work(struct adios_data *ad) {
-	guard(spinlock_irqsave)(&ad->bq_lock);
+static inline bool bq_has_work(struct adios_hctx_data *hd) {
+	guard(spinlock_irqsave)(&hd->bq_lock);
 
 	for (u8 i = 0; i < ADIOS_OPTYPES; i++)
-		if (!list_empty(&ad->batch_queue[ad->bq_page][i]))
+		if (!list_empty(&hd->batch_queue[hd->bq_page][i]))
 			return true;
 
-	return ad->more_bq_ready;
+	return hd->more_bq_ready;
 }
 
-static inline bool dl_tree_has_work(struct adios_data *ad) {
-	guard(spinlock_irqsave)(&ad->lock);
-	return ad->dl_queued;
+static inline bool dl_tree_has_work(struct adios_hctx_data *hd) {
+	guard(spinlock_irqsave)(&hd->lock);
+	return hd->dl_queued;
 }
 
 // Check if there are any requests available for dispatch
 static bool adios_has_work(struct blk_mq_hw_ctx *hctx) {
-	struct adios_data *ad = hctx->queue->elevator->elevator_data;
+	struct adios_hctx_data *hd = hctx->sched_data;
 
-	return pq_has_work(ad) || bq_has_work(ad) || dl_tree_has_work(ad);
+	return pq_has_work(hd) || bq_has_work(hd) || dl_tree_has_work(hd);
 }
 
 // Initialize the scheduler-specific data for a hardware queue
 static int adios_init_hctx(struct blk_mq_hw_ctx *hctx, unsigned int hctx_idx) {
+	struct adios_data *ad = hctx->queue->elevator->elevator_data;
+	struct adios_hctx_data *hd;
+
+	hd = kzalloc_node(sizeof(*hd), GFP_KERNEL, hctx->numa_node);
+	if (!hd)
+		return -ENOMEM;
+
+	INIT_LIST_HEAD(&hd->prio_queue);
+	for (u8 i = 0; i < 2; i++)
+		hd->dl_tree[i] = RB_ROOT_CACHED;
+	hd->dl_bias = 0;
+	hd->dl_queued = 0x0;
+	hd->dl_first = U64_MAX;
+
+	for (u8 page = 0; page < ADIOS_BQ_PAGES; page++)
+		for (u8 optype = 0; optype < ADIOS_OPTYPES; optype++)
+			INIT_LIST_HEAD(&hd->batch_queue[page][optype]);
+
+	spin_lock_init(&hd->lock);
+	spin_lock_init(&hd->pq_lock);
+	spin_lock_init(&hd->bq_lock);
+
+	hd->index = hctx_idx;
+	hctx->sched_data = hd;
+	WRITE_ONCE(ad->hds[hctx_idx], hd);
+
 	adios_depth_updated(hctx);
 	return 0;
 }
 
+// Free the scheduler-specific data of a hardware queue
+static void adios_exit_hctx(struct blk_mq_hw_ctx *hctx, unsigned int hctx_idx) {
+	struct adios_data *ad = hctx->queue->elevator->elevator_data;
+	struct adios_hctx_data *hd = hctx->sched_data;
+
+	WARN_ON_ONCE(!list_empty(&hd->prio_queue));
+
+	WRITE_ONCE(ad->hds[hctx_idx], NULL);
+	hctx->sched_data = NULL;
+	kfree(hd);
+}
+
 // Initialize the scheduler-specific data when initializing the request queue
 static int adios_init_sched(struct request_queue *q, struct elevator_type *e) {
 	struct adios_data *ad;
 	struct elevator_queue *eq;
 	int ret = -ENOMEM;
-	u8 optype = 0;
+	int optype = 0;
 
 	eq = elevator_alloc(q, e);
 	if (!eq)
@@ -955,13 +1433,19 @@ static int adios_init_sched(struct request_queue *q, struct elevator_type *e) {
 	if (!ad)
 		goto put_eq;
 
+	ad->nr_hds = q->nr_hw_queues;
+	ad->hds = kcalloc_node(ad->nr_hds, sizeof(*ad->hds), GFP_KERNEL, q->node);
+	if (!ad->hds)
+		goto free_ad;
+	ad->merge = ad->nr_hds == 1;
+
 	// Create a memory pool for adios_rq_data
 	ad->rq_data_pool = kmem_cache_create("rq_data_pool",
 						sizeof(struct adios_rq_data),
 						0, SLAB_HWCACHE_ALIGN, NULL);
 	if (!ad->rq_data_pool) {
 		pr_err("adios: Failed to create rq_data_pool\n");
-		goto free_ad;
+		goto free_hds;
 	}
 
 	/* Create a memory pool for dl_group */
@@ -978,11 +1462,6 @@ static int adios_init_sched(struct request_queue *q, struct elevator_type *e) {
 	ad->global_latency_window = default_global_latency_window;
 	ad->bq_refill_below_ratio = default_bq_refill_below_ratio;
 
-	INIT_LIST_HEAD(&ad->prio_queue);
-	for (u8 i = 0; i < 2; i++)
-		ad->dl_tree[i] = RB_ROOT_CACHED;
-	ad->dl_bias = 0;
-	ad->dl_queued = 0x0;
 	for (u8 i = 0; i < 2; i++)
 		ad->dl_prio[i] = default_dl_prio[i];
 
@@ -1004,22 +1483,27 @@ static int adios_init_sched(struct request_queue *q, struct elevator_type *e) {
 		model->lm_shrink_at_kreqs  = default_lm_shrink_at_kreqs;
 		model->lm_shrink_at_gbytes = default_lm_shrink_at_gbytes;
 		model->lm_shrink_resist    = default_lm_shrink_resist;
+		lm_reset_scales(model);
 
 		ad->latency_target[optype] = default_latency_target[optype];
 		ad->batch_limit[optype] = default_batch_limit[optype];
 	}
-	timer_setup(&ad->update_timer, update_timer_callback, 0);
-	
-	for (u8 page = 0; page < ADIOS_BQ_PAGES; page++)
-		for (u8 optype = 0; optype < ADIOS_OPTYPES; optype++)
-			INIT_LIST_HEAD(&ad->batch_queue[page][optype]);
 
-	spin_lock_init(&ad->lock);
-	spin_lock_init(&ad->pq_lock);
-	spin_lock_init(&ad->bq_lock);
+	ad->stats = alloc_percpu(struct adios_stats);
+	if (!ad->stats)
+		goto free_buckets;
 
-	/* We dispatch from request queue wide instead of hw queue */
-	blk_queue_flag_set(QUEUE_FLAG_SQ_SCHED, q);
+	if (percpu_counter_init(&ad->total_pred_lat, 0, GFP_KERNEL))
+		goto free_stats;
+	update_pred_lat_batch(ad);
+
+	timer_setup(&ad->update_timer, update_timer_callback, 0);
+
+	/*
+	 * Each hw queue dispatches its own requests under its own locks; only
+	 * the latency models and the global latency window are shared.
+	 */
+	blk_queue_flag_clear(QUEUE_FLAG_SQ_SCHED, q);
 
 	ad->queue = q;
 	blk_stat_enable_accounting(q);
@@ -1027,6 +1511,8 @@ static int adios_init_sched(struct request_queue *q, struct elevator_type *e) {
 	q->elevator = eq;
 	return 0;
 
+free_stats:
+	free_percpu(ad->stats);
 free_buckets:
 	pr_err("adios: Failed to allocate per-cpu buckets\n");
 	while (--optype >= 0) {
@@ -1038,6 +1524,8 @@ static int adios_init_sched(struct request_queue *q, struct elevator_type *e) {
 	kmem_cache_destroy(ad->dl_group_pool);
 destroy_rq_data_pool:
 	kmem_cache_destroy(ad->rq_data_pool);
+free_hds:
+	kfree(ad->hds);
 free_ad:
 	kfree(ad);
 put_eq:
@@ -1051,13 +1539,13 @@ static void adios_exit_sched(struct elevator_queue *e) {
 
 	timer_shutdown_sync(&ad->update_timer);
 
-	WARN_ON_ONCE(!list_empty(&ad->prio_queue));
-
 	for (u8 i = 0; i < ADIOS_OPTYPES; i++) {
 		struct latency_model *model = &ad->latency_model[i];
 		free_percpu(model->pcpu_buckets);
 	}
 	kfree(ad->aggr_buckets);
+	free_percpu(ad->stats);
+	percpu_counter_destroy(&ad->total_pred_lat);
 
 	if (ad->rq_data_pool)
 		kmem_cache_destroy(ad->rq_data_pool);
@@ -1067,6 +1555,7 @@ static void adios_exit_sched(struct elevator_queue *e) {
 
 	blk_stat_disable_accounting(ad->queue);
 
+	kfree(ad->hds);
 	kfree(ad);
 }
 
@@ -1086,6 +1575,7 @@ static void load_latency_model(struct latency_model *model, u64 base, u64 slope)
 	model->large_sum_bsize = 1024; /* Corresponds to 1 KiB */
 
 	lm_reset_pcpu_buckets(model);
+	lm_reset_scales(model);
 
 	write_sequnlock_bh(&model->lock);
 }
@@ -1106,6 +1596,14 @@ static ssize_t adios_lat_model_##name##_show( \
 	} while (read_seqretry(&model->lock, seq)); \
 	len += sprintf(page,       "base : %llu ns\n", base); \
 	len += sprintf(page + len, "slope: %llu ns/KiB\n", slope); \
+	len += sprintf(page + len, "scale:"); \
+	for (u8 i = 0; i < LM_SIZE_CLASSES; i++) \
+		len += sprintf(page + len, " %u", READ_ONCE(model->size_scale[i])); \
+	len += sprintf(page + len, " /%u (4K 16K 64K 64K+)\n", LM_SCALE_ONE); \
+	len += sprintf(page + len, "bg   :"); \
+	for (u8 i = 0; i < LM_BG_LEVELS; i++) \
+		len += sprintf(page + len, " %u", READ_ONCE(model->bg_scale[i])); \
+	len += sprintf(page + len, " /%u (64M 256M 1G 1G+)\n", LM_SCALE_ONE); \
 	return len; \
 } \
 static ssize_t adios_lat_model_##name##_store( \
@@ -1113,11 +1611,16 @@ static ssize_t adios_lat_model_##name##_store( \
 	struct adios_data *ad = e->elevator_data; \
 	struct latency_model *model = &ad->latency_model[optype]; \
 	u64 base, slope; \
+	u32 scale[LM_SIZE_CLASSES]; \
 	int ret; \
-	ret = sscanf(page, "%llu %llu", &base, &slope); \
-	if (ret != 2) \
+	ret = sscanf(page, "%llu %llu %u %u %u %u", &base, &slope, \
+		&scale[0], &scale[1], &scale[2], &scale[3]); \
+	if (ret != 2 && ret != 2 + LM_SIZE_CLASSES) \
 		return -EINVAL; \
 	load_latency_model(model, base, slope); \
+	for (u8 i = 0; ret > 2 && i < LM_SIZE_CLASSES; i++) \
+		WRITE_ONCE(model->size_scale[i], \
+			clamp(scale[i], LM_SCALE_MIN, LM_SCALE_MAX)); \
 	reset_buckets(ad->aggr_buckets); \
 	return count; \
 } \
@@ -1187,6 +1690,7 @@ static ssize_t adios_global_latency_window_store(
 		return ret;
 
 	ad->global_latency_window = nsec;
+	update_pred_lat_batch(ad);
 
 	return count;
 }
@@ -1239,9 +1743,15 @@ static ssize_t adios_read_priority_store(
 	if (ret || prio < -20 || prio > 19)
 		return -EINVAL;
 
-	guard(spinlock_irqsave)(&ad->lock);
 	ad->dl_prio[0] = prio;
-	ad->dl_bias = 0;
+	for (unsigned int i = 0; i < ad->nr_hds; i++) {
+		struct adios_hctx_data *hd = ad->hds[i];
+
+		if (!hd)
+			continue;
+		guard(spinlock_irqsave)(&hd->lock);
+		hd->dl_bias = 0;
+	}
 
 	return count;
 }
@@ -1297,6 +1807,7 @@ static ssize_t adios_reset_lat_model_store(
 			model->large_sum_delay = 0ULL;
 			model->large_sum_bsize = 0ULL;
 			lm_reset_pcpu_buckets(model);
+			lm_reset_scales(model);
 			write_sequnlock_bh(&model->lock);
 		}
 	} else {
@@ -1321,6 +1832,170 @@ static ssize_t adios_reset_lat_model_store(
 	return count;
 }
 
+/*
+ * Learned state of the latency models, so that userspace can save it at
+ * shutdown and restore it at probe time, keyed by whatever identifies the
+ * device (e.g. its WWID) in a udev rule. After a version line, there is one
+ * line per operation type:
+ *
+ *   <type> base slope small_sum_delay small_count large_sum_delay
+ *          large_sum_bsize <size scales> <background scales>
+ */
+#define ADIOS_LM_STATE_VERSION 1
+#define ADIOS_LM_STATE_PARAMS  (6 + LM_SIZE_CLASSES + LM_BG_LEVELS)
+
+static const char * const adios_lm_state_names[] = {
+	[ADIOS_READ]    = "read",
+	[ADIOS_WRITE]   = "write",
+	[ADIOS_DISCARD] = "discard",
+};
+
+// Export the learned latency models
+static ssize_t adios_lat_model_state_show(
+		struct elevator_queue *e, char *page) {
+	struct adios_data *ad = e->elevator_data;
+	ssize_t len;
+
+	len = sprintf(page, "version %d\n", ADIOS_LM_STATE_VERSION);
+	for (u8 i = ADIOS_READ; i <= ADIOS_DISCARD; i++) {
+		struct latency_model *model = &ad->latency_model[i];
+		u64 state[6];
+		unsigned int seq;
+
+		do {
+			seq = read_seqbegin(&model->lock);
+			state[0] = model->base;
+			state[1] = model->slope;
+			state[2] = model->small_sum_delay;
+			state[3] = model->small_count;
+			state[4] = model->large_sum_delay;
+			state[5] = model->large_sum_bsize;
+		} while (read_seqretry(&model->lock, seq));
+
+		len += sprintf(page + len, "%s", adios_lm_state_names[i]);
+		for (u8 j = 0; j < ARRAY_SIZE(state); j++)
+			len += sprintf(page + len, " %llu", state[j]);
+		for (u8 j = 0; j < LM_SIZE_CLASSES; j++)
+			len += sprintf(page + len, " %u", READ_ONCE(model->size_scale[j]));
+		for (u8 j = 0; j < LM_BG_LEVELS; j++)
+			len += sprintf(page + len, " %u", READ_ONCE(model->bg_scale[j]));
+		len += sprintf(page + len, "\n");
+	}
+
+	return len;
+}
+
+// Parse one operation type line of the latency model state
+static int adios_parse_lm_state(char *line, u64 *params) {
+	char *tok = strsep(&line, " ");
+	int type = -EINVAL;
+
+	for (u8 i = ADIOS_READ; i <= ADIOS_DISCARD; i++)
+		if (tok && !strcmp(tok, adios_lm_state_names[i]))
+			type = i;
+	if (type < 0)
+		return type;
+
+	for (u8 i = 0; i < ADIOS_LM_STATE_PARAMS; i++) {
+		do {
+			tok = strsep(&line, " ");
+		} while (tok && !*tok);
+		if (!tok || kstrtou64(tok, 10, &params[i]))
+			return -EINVAL;
+	}
+	if (line && *line)
+		return -EINVAL;
+
+	// Scales outside of what could have been learned are rejected
+	for (u8 i = 6; i < ADIOS_LM_STATE_PARAMS; i++)
+		if (params[i] < LM_SCALE_MIN || params[i] > LM_SCALE_MAX)
+			return -EINVAL;
+
+	return type;
+}
+
+// Import learned latency models, all types or none
+static ssize_t adios_lat_model_state_store(
+		struct elevator_queue *e, const char *page, size_t count) {
+	struct adios_data *ad = e->elevator_data;
+	u64 params[ADIOS_OPTYPES][ADIOS_LM_STATE_PARAMS];
+	bool loaded[ADIOS_OPTYPES] = {};
+	char *buf, *pos, *line;
+	int version, type, ret = -EINVAL;
+
+	buf = kstrndup(page, count, GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+	pos = buf;
+
+	line = strsep(&pos, "\n");
+	if (!line || sscanf(line, "version %d", &version) != 1 ||
+			version != ADIOS_LM_STATE_VERSION)
+		goto out;
+
+	while ((line = strsep(&pos, "\n"))) {
+		if (!*line)
+			continue;
+		type = adios_parse_lm_state(line, params[ADIOS_OTHER]);
+		if (type < 0)
+			goto out;
+		memcpy(params[type], params[ADIOS_OTHER], sizeof(params[type]));
+		loaded[type] = true;
+	}
+
+	for (u8 i = ADIOS_READ; i <= ADIOS_DISCARD; i++)
+		if (!loaded[i])
+			goto out;
+
+	for (u8 i = ADIOS_READ; i <= ADIOS_DISCARD; i++) {
+		struct latency_model *model = &ad->latency_model[i];
+		u64 *p = params[i];
+
+		write_seqlock_bh(&model->lock);
+		model->last_update_jiffies = jiffies;
+		model->base = p[0];
+		model->slope = p[1];
+		model->small_sum_delay = p[2];
+		model->small_count = p[3];
+		model->large_sum_delay = p[4];
+		model->large_sum_bsize = p[5];
+		lm_reset_pcpu_buckets(model);
+		for (u8 j = 0; j < LM_SIZE_CLASSES; j++)
+			WRITE_ONCE(model->size_scale[j], p[6 + j]);
+		for (u8 j = 0; j < LM_BG_LEVELS; j++)
+			WRITE_ONCE(model->bg_scale[j], p[6 + LM_SIZE_CLASSES + j]);
+		write_sequnlock_bh(&model->lock);
+	}
+	reset_buckets(ad->aggr_buckets);
+	ret = count;
+out:
+	kfree(buf);
+	return ret;
+}
+
+// Show whether the write background term of the latency model is used
+static ssize_t adios_lat_model_bg_show(
+		struct elevator_queue *e, char *page) {
+	struct adios_data *ad = e->elevator_data;
+	return sprintf(page, "%d\n", ad->lm_bg);
+}
+
+// Enable or disable the write background term of the latency model
+static ssize_t adios_lat_model_bg_store(
+		struct elevator_queue *e, const char *page, size_t count) {
+	struct adios_data *ad = e->elevator_data;
+	bool val;
+	int ret;
+
+	ret = kstrtobool(page, &val);
+	if (ret)
+		return ret;
+
+	ad->lm_bg = val;
+
+	return count;
+}
+
 // Show the ADIOS version
 static ssize_t adios_version_show(struct elevator_queue *e, char *page) {
 	return sprintf(page, "%s\n", ADIOS_VERSION);
@@ -1384,6 +2059,8 @@ static struct elv_fs_entry adios_sched_attrs[] = {
 	AD_ATTR_RW(lat_model_read),
 	AD_ATTR_RW(lat_model_write),
 	AD_ATTR_RW(lat_model_discard),
+	AD_ATTR_RW(lat_model_bg),
+	AD_ATTR_RW(lat_model_state),
 
 	AD_ATTR_RW(lat_target_read),
 	AD_ATTR_RW(lat_target_write),
@@ -1402,6 +2079,97 @@ static struct elv_fs_entry adios_sched_attrs[] = {
 	__ATTR_NULL
 };
 
+#ifdef CONFIG_BLK_DEBUG_FS
+static const char * const adios_optype_names[] = {
+	[ADIOS_READ]    = "read",
+	[ADIOS_WRITE]   = "write",
+	[ADIOS_DISCARD] = "discard",
+	[ADIOS_OTHER]   = "other",
+};
+
+// Sum the per-CPU instrumentation of a queue
+static void adios_stats_sum(struct adios_data *ad, struct adios_stats *sum) {
+	int cpu;
+
+	memset(sum, 0, sizeof(*sum));
+	for_each_possible_cpu(cpu) {
+		struct adios_stats *stats = per_cpu_ptr(ad->stats, cpu);
+		u64 *dst = (u64 *)sum, *src = (u64 *)stats;
+
+		for (size_t i = 0; i < sizeof(*sum) / sizeof(u64); i++)
+			dst[i] += READ_ONCE(src[i]);
+	}
+}
+
+static int adios_lat_err_show(void *data, struct seq_file *m) {
+	struct request_queue *q = data;
+	struct adios_stats *sum;
+
+	sum = kmalloc(sizeof(*sum), GFP_KERNEL);
+	if (!sum)
+		return -ENOMEM;
+	adios_stats_sum(q->elevator->elevator_data, sum);
+
+	seq_printf(m, "# |actual - predicted|: < %u ns, then [2^n, 2^(n+1)) ns from n = %u\n",
+		1U << ADIOS_HIST_SHIFT, ADIOS_HIST_SHIFT);
+	for (u8 i = 0; i < ADIOS_OPTYPES; i++) {
+		for (u8 late = 0; late < 2; late++) {
+			seq_printf(m, "%s %s:", adios_optype_names[i],
+				late ? "late " : "early");
+			for (u8 b = 0; b < ADIOS_HIST_BUCKETS; b++)
+				seq_printf(m, " %llu", sum->lat_err[i][late][b]);
+			seq_putc(m, '\n');
+		}
+	}
+
+	kfree(sum);
+	return 0;
+}
+
+static int adios_deadline_misses_show(void *data, struct seq_file *m) {
+	struct request_queue *q = data;
+	struct adios_stats *sum;
+
+	sum = kmalloc(sizeof(*sum), GFP_KERNEL);
+	if (!sum)
+		return -ENOMEM;
+	adios_stats_sum(q->elevator->elevator_data, sum);
+
+	for (u8 i = 0; i < ADIOS_OPTYPES; i++)
+		seq_printf(m, "%s: %llu/%llu\n", adios_optype_names[i],
+			sum->dl_misses[i], sum->completed[i]);
+
+	kfree(sum);
+	return 0;
+}
+
+static int adios_queue_time_show(void *data, struct seq_file *m) {
+	struct request_queue *q = data;
+	struct adios_stats *sum;
+
+	sum = kmalloc(sizeof(*sum), GFP_KERNEL);
+	if (!sum)
+		return -ENOMEM;
+	adios_stats_sum(q->elevator->elevator_data, sum);
+
+	seq_puts(m, "# average ns in dl_tree, in batch_queue\n");
+	for (u8 i = 0; i < ADIOS_OPTYPES; i++)
+		seq_printf(m, "%s: %llu %llu\n", adios_optype_names[i],
+			sum->timed[i] ? div64_u64(sum->dl_time[i], sum->timed[i]) : 0,
+			sum->timed[i] ? div64_u64(sum->bq_time[i], sum->timed[i]) : 0);
+
+	kfree(sum);
+	return 0;
+}
+
+static const struct blk_mq_debugfs_attr adios_queue_debugfs_attrs[] = {
+	{"lat_err", 0400, adios_lat_err_show},
+	{"deadline_misses", 0400, adios_deadline_misses_show},
+	{"queue_time", 0400, adios_queue_time_show},
+	{},
+};
+#endif
+
 // Define the ADIOS scheduler type
 static struct elevator_type mq_adios = {
 	.ops = {
@@ -1419,9 +2187,13 @@ static struct elevator_type mq_adios = {
 		.finish_request		= adios_finish_request,
 		.has_work			= adios_has_work,
 		.init_hctx			= adios_init_hctx,
+		.exit_hctx			= adios_exit_hctx,
 		.init_sched			= adios_init_sched,
 		.exit_sched			= adios_exit_sched,
 	},
+#ifdef CONFIG_BLK_DEBUG_FS
+	.queue_debugfs_attrs = adios_queue_debugfs_attrs,
+#endif
 	.elevator_attrs = adios_sched_attrs,
 	.elevator_name = "adios",
 	.elevator_owner = THIS_MODULE,
@@ -1433,14 +2205,31 @@ MODULE_ALIAS("mq-adios-iosched");
 
 // Initialize the ADIOS scheduler module
 static int __init adios_init(void) {
+	int ret;
+
 	printk(KERN_INFO "%s %s by %s\n",
 		ADIOS_PROGNAME, ADIOS_VERSION, ADIOS_AUTHOR);
-	return elv_register(&mq_adios);
+
+#ifdef CONFIG_BLK_CGROUP
+	ret = blkcg_policy_register(&blkcg_policy_adios);
+	if (ret)
+		return ret;
+#endif
+
+	ret = elv_register(&mq_adios);
+#ifdef CONFIG_BLK_CGROUP
+	if (ret)
+		blkcg_policy_unregister(&blkcg_policy_adios);
+#endif
+	return ret;
 }
 
 // Exit the ADIOS scheduler module
 static void __exit adios_exit(void) {
 	elv_unregister(&mq_adios);
+#ifdef CONFIG_BLK_CGROUP
+	blkcg_policy_unregister(&blkcg_policy_adios);
+#endif
 }
 
 module_init(adios_init);
@@ -256,6 +256,9 @@ static void blk_free_queue_rcu(struct rcu_head *rcu_head)
 
 static void blk_free_queue(struct request_queue *q)
 {
+#ifdef CONFIG_BLK_DEBUG_FS
+	free_percpu(q->plug_merge_stats);
+#endif
 	blk_free_queue_stats(q->stats);
 	if (queue_is_mq(q))
 		blk_mq_release(q);
@@ -414,6 +417,14 @@ struct request_queue *blk_alloc_queue(struct queue_limits *lim, int node_id)
 		goto fail_id;
 	}
 
+#ifdef CONFIG_BLK_DEBUG_FS
+	q->plug_merge_stats = alloc_percpu(struct blk_plug_merge_stats);
+	if (!q->plug_merge_stats) {
+		error = -ENOMEM;
+		goto fail_stats;
+	}
+#endif
+
 	error = blk_set_default_limits(lim);
 	if (error)
 		goto fail_stats;
@@ -467,6 +478,9 @@ struct request_queue *blk_alloc_queue(struct queue_limits *lim, int node_id)
 	return q;
 
 fail_stats:
+#ifdef CONFIG_BLK_DEBUG_FS
+	free_percpu(q->plug_merge_stats);
+#endif
 	blk_free_queue_stats(q->stats);
 fail_id:
 	ida_free(&blk_queue_ida, q->id);
@@ -1133,6 +1147,7 @@ void blk_start_plug_nr_ios(struct blk_plug *plug, unsigned short nr_ios)
 	plug->rq_count = 0;
 	plug->multiple_queues = false;
 	plug->has_elevator = false;
+	blk_plug_merge_hash_init(plug);
 	INIT_LIST_HEAD(&plug->cb_list);
 
 	/*
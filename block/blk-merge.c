@@ -9,6 +9,7 @@
 #include <linux/blk-integrity.h>
 #include <linux/scatterlist.h>
 #include <linux/part_stat.h>
+#include <linux/hash.h>
 #include <linux/blk-cgroup.h>
 
 #include <trace/events/block.h>
@@ -1098,6 +1099,68 @@ static enum bio_merge_status blk_attempt_bio_merge(struct request_queue *q,
 	return BIO_MERGE_FAILED;
 }
 
+/*
+ * Plugged requests are hashed by queue and by both their start and their end
+ * sector, so that the back and the front merge candidate of a bio can be
+ * found without walking the plug list. The table is a cache: a slot may hold
+ * a request whose range has since grown, so every candidate is checked
+ * against the bio before it is used. Entries only ever point at requests on
+ * the plug list, and the table is cleared whenever that list is flushed.
+ */
+#define BLK_PLUG_MERGE_PROBES	4
+
+static unsigned int blk_plug_merge_slot(struct request_queue *q,
+		sector_t sector)
+{
+	return hash_64((unsigned long)q ^ sector, BLK_PLUG_MERGE_HASH_BITS);
+}
+
+static void blk_plug_merge_hash_insert(struct blk_plug *plug,
+		struct request *rq, sector_t sector)
+{
+	unsigned int slot = blk_plug_merge_slot(rq->q, sector);
+	unsigned int i;
+
+	for (i = 0; i < BLK_PLUG_MERGE_PROBES; i++) {
+		struct request **entry = &plug->merge_hash[(slot + i) &
+			(ARRAY_SIZE(plug->merge_hash) - 1)];
+
+		if (!*entry || *entry == rq) {
+			*entry = rq;
+			return;
+		}
+	}
+	/* All probes taken, evict the home slot. */
+	plug->merge_hash[slot] = rq;
+}
+
+void blk_plug_merge_hash_add(struct blk_plug *plug, struct request *rq)
+{
+	blk_plug_merge_hash_insert(plug, rq, blk_rq_pos(rq));
+	blk_plug_merge_hash_insert(plug, rq, blk_rq_pos(rq) + blk_rq_sectors(rq));
+}
+
+static struct request *blk_plug_merge_hash_find(struct blk_plug *plug,
+		struct request_queue *q, struct bio *bio)
+{
+	sector_t start = bio->bi_iter.bi_sector, end = bio_end_sector(bio);
+	unsigned int back = blk_plug_merge_slot(q, start);
+	unsigned int front = blk_plug_merge_slot(q, end);
+	unsigned int i, mask = ARRAY_SIZE(plug->merge_hash) - 1;
+	struct request *rq;
+
+	for (i = 0; i < BLK_PLUG_MERGE_PROBES; i++) {
+		rq = plug->merge_hash[(back + i) & mask];
+		if (rq && rq->q == q &&
+		    blk_rq_pos(rq) + blk_rq_sectors(rq) == start)
+			return rq;
+		rq = plug->merge_hash[(front + i) & mask];
+		if (rq && rq->q == q && blk_rq_pos(rq) == end)
+			return rq;
+	}
+	return NULL;
+}
+
 /**
  * blk_attempt_plug_merge - try to merge with %current's plugged list
  * @q: request_queue new bio is being queued at
@@ -1127,22 +1190,28 @@ bool blk_attempt_plug_merge(struct request_queue *q, struct bio *bio,
 	if (!plug || rq_list_empty(&plug->mq_list))
 		return false;
 
+	blk_plug_merge_stat_inc(q, lookups);
+
 	rq = plug->mq_list.tail;
-	if (rq->q == q)
-		return blk_attempt_bio_merge(q, rq, bio, nr_segs, false) ==
-			BIO_MERGE_OK;
-	else if (!plug->multiple_queues)
-		return false;
+	if (rq->q == q &&
+	    blk_attempt_bio_merge(q, rq, bio, nr_segs, false) == BIO_MERGE_OK) {
+		blk_plug_merge_stat_inc(q, tail_hits);
+		goto merged;
+	}
 
-	rq_list_for_each(&plug->mq_list, rq) {
-		if (rq->q != q)
-			continue;
-		if (blk_attempt_bio_merge(q, rq, bio, nr_segs, false) ==
-		    BIO_MERGE_OK)
-			return true;
-		break;
+	rq = blk_plug_merge_hash_find(plug, q, bio);
+	if (rq && blk_attempt_bio_merge(q, rq, bio, nr_segs, false) ==
+	    BIO_MERGE_OK) {
+		blk_plug_merge_stat_inc(q, hash_hits);
+		goto merged;
 	}
+
+	blk_plug_merge_stat_inc(q, misses);
 	return false;
+
+merged:
+	blk_plug_merge_hash_add(plug, rq);
+	return true;
 }
 
 /*
@@ -78,6 +78,25 @@ static int queue_pm_only_show(void *data, struct seq_file *m)
 	return 0;
 }
 
+static int queue_plug_merge_show(void *data, struct seq_file *m)
+{
+	struct request_queue *q = data;
+	struct blk_plug_merge_stats sum = { };
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct blk_plug_merge_stats *s = per_cpu_ptr(q->plug_merge_stats, cpu);
+
+		sum.lookups += s->lookups;
+		sum.tail_hits += s->tail_hits;
+		sum.hash_hits += s->hash_hits;
+		sum.misses += s->misses;
+	}
+	seq_printf(m, "lookups %lu\ntail_hits %lu\nhash_hits %lu\nmisses %lu\n",
+		   sum.lookups, sum.tail_hits, sum.hash_hits, sum.misses);
+	return 0;
+}
+
 #define QUEUE_FLAG_NAME(name) [QUEUE_FLAG_##name] = #name
 static const char *const blk_queue_flag_name[] = {
 	QUEUE_FLAG_NAME(DYING),
@@ -93,6 +112,8 @@ static const char *const blk_queue_flag_name[] = {
 	QUEUE_FLAG_NAME(RQ_ALLOC_TIME),
 	QUEUE_FLAG_NAME(HCTX_ACTIVE),
 	QUEUE_FLAG_NAME(SQ_SCHED),
+	QUEUE_FLAG_NAME(HYBRID_POLL),
+	QUEUE_FLAG_NAME(SAME_NODE),
 };
 #undef QUEUE_FLAG_NAME
 
@@ -147,6 +168,7 @@ static const struct blk_mq_debugfs_attr blk_mq_debugfs_queue_attrs[] = {
 	{ "poll_stat", 0400, queue_poll_stat_show },
 	{ "requeue_list", 0400, .seq_ops = &queue_requeue_list_seq_ops },
 	{ "pm_only", 0600, queue_pm_only_show, NULL },
+	{ "plug_merge", 0400, queue_plug_merge_show, NULL },
 	{ "state", 0600, queue_state_show, queue_state_write },
 	{ "zone_wplugs", 0400, queue_zone_wplugs_show, NULL },
 	{ },
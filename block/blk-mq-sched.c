@@ -390,6 +390,7 @@ static int blk_mq_sched_alloc_map_and_rqs(struct request_queue *q,
 
 	if (!hctx->sched_tags)
 		return -ENOMEM;
+	blk_mq_map_tag_hints(hctx, hctx->sched_tags);
 	return 0;
 }
 
@@ -1259,6 +1259,11 @@ static inline bool blk_mq_complete_need_ipi(struct request *rq)
 	     cpus_equal_capacity(cpu, rq->mq_ctx->cpu)))
 		return false;
 
+	/* rq_affinity=3: any CPU of the submitting node will do */
+	if (test_bit(QUEUE_FLAG_SAME_NODE, &rq->q->queue_flags) &&
+	    cpu_to_node(cpu) == cpu_to_node(rq->mq_ctx->cpu))
+		return false;
+
 	/* don't try to IPI to an offline CPU */
 	return cpu_online(rq->mq_ctx->cpu);
 }
@@ -1355,8 +1360,12 @@ void blk_mq_start_request(struct request *rq)
 	if (blk_integrity_rq(rq) && req_op(rq) == REQ_OP_WRITE)
 		blk_integrity_prepare(rq);
 
-	if (rq->bio && rq->bio->bi_opf & REQ_POLLED)
+	if (rq->bio && rq->bio->bi_opf & REQ_POLLED) {
 	        WRITE_ONCE(rq->bio->bi_cookie, rq->mq_hctx->queue_num);
+		if (blk_queue_hybrid_poll(q) &&
+		    !READ_ONCE(rq->mq_hctx->poll_issue_ns))
+			WRITE_ONCE(rq->mq_hctx->poll_issue_ns, ktime_get_ns());
+	}
 }
 EXPORT_SYMBOL(blk_mq_start_request);
 
@@ -1396,6 +1405,8 @@ static void blk_add_rq_to_plug(struct blk_plug *plug, struct request *rq)
 		plug->has_elevator = true;
 	rq_list_add_tail(&plug->mq_list, rq);
 	plug->rq_count++;
+	if (!blk_queue_nomerges(rq->q))
+		blk_plug_merge_hash_add(plug, rq);
 }
 
 /**
@@ -2886,6 +2897,7 @@ void blk_mq_flush_plug_list(struct blk_plug *plug, bool from_schedule)
 		return;
 	depth = plug->rq_count;
 	plug->rq_count = 0;
+	blk_plug_merge_hash_init(plug);
 
 	if (!plug->multiple_queues && !plug->has_elevator && !from_schedule) {
 		struct request_queue *q;
@@ -3472,6 +3484,44 @@ static int blk_mq_get_hctx_node(struct blk_mq_tag_set *set,
 	return blk_mq_hw_queue_to_node(&set->map[type], hctx_idx);
 }
 
+/*
+ * Nodes of the CPUs mapped to @hctx_idx. When a hardware queue serves CPUs
+ * of several nodes, its tag space is split in one contiguous partition per
+ * node: the requests of a partition are allocated on its node, and the CPUs
+ * of that node start their tag search there (see blk_mq_map_tag_hints()).
+ */
+static unsigned int blk_mq_hctx_nodes(struct blk_mq_tag_set *set,
+		unsigned int hctx_idx, nodemask_t *nodes)
+{
+	enum hctx_type type = hctx_idx_to_type(set, hctx_idx);
+	unsigned int cpu;
+
+	nodes_clear(*nodes);
+	for_each_possible_cpu(cpu) {
+		if (set->map[type].mq_map[cpu] == hctx_idx &&
+		    cpu_to_node(cpu) != NUMA_NO_NODE)
+			node_set(cpu_to_node(cpu), *nodes);
+	}
+	return nodes_weight(*nodes);
+}
+
+/* Index among @nodes of the node whose partition holds bitmap bit @bit. */
+static unsigned int blk_mq_tag_partition(unsigned int bit, unsigned int depth,
+		unsigned int nr_nodes)
+{
+	return depth ? min(bit * nr_nodes / depth, nr_nodes - 1) : 0;
+}
+
+static int blk_mq_nth_node(const nodemask_t *nodes, unsigned int n)
+{
+	int node;
+
+	for_each_node_mask(node, *nodes)
+		if (!n--)
+			return node;
+	return NUMA_NO_NODE;
+}
+
 static struct blk_mq_tags *blk_mq_alloc_rq_map(struct blk_mq_tag_set *set,
 					       unsigned int hctx_idx,
 					       unsigned int nr_tags,
@@ -3529,10 +3579,13 @@ static int blk_mq_alloc_rqs(struct blk_mq_tag_set *set,
 {
 	unsigned int i, j, entries_per_page, max_order = 4;
 	int node = blk_mq_get_hctx_node(set, hctx_idx);
+	unsigned int nr_nodes, reserved = tags->nr_reserved_tags;
 	size_t rq_size, left;
+	nodemask_t nodes;
 
 	if (node == NUMA_NO_NODE)
 		node = set->numa_node;
+	nr_nodes = blk_mq_hctx_nodes(set, hctx_idx, &nodes);
 
 	INIT_LIST_HEAD(&tags->page_list);
 
@@ -3553,6 +3606,16 @@ static int blk_mq_alloc_rqs(struct blk_mq_tag_set *set,
 		while (this_order && left < order_to_size(this_order - 1))
 			this_order--;
 
+		/* Back the partition of the next tag with its node's memory */
+		if (nr_nodes > 1 && depth > reserved) {
+			unsigned int bit = i > reserved ? i - reserved : 0;
+			int part_node = blk_mq_nth_node(&nodes,
+				blk_mq_tag_partition(bit, depth - reserved, nr_nodes));
+
+			if (part_node != NUMA_NO_NODE)
+				node = part_node;
+		}
+
 		do {
 			page = alloc_pages_node(node,
 				GFP_NOIO | __GFP_NOWARN | __GFP_NORETRY | __GFP_ZERO,
@@ -4177,6 +4240,8 @@ static void blk_mq_map_swqueue(struct request_queue *q)
 
 		hctx->tags = set->tags[i];
 		WARN_ON(!hctx->tags);
+		blk_mq_map_tag_hints(hctx, hctx->tags);
+		blk_mq_map_tag_hints(hctx, hctx->sched_tags);
 
 		/*
 		 * Set the map size to the number of mapped software queues.
@@ -4204,6 +4269,42 @@ static void blk_mq_map_swqueue(struct request_queue *q)
 	mutex_unlock(&q->elevator_lock);
 }
 
+/*
+ * Point the tag allocation hint of each CPU of @hctx at the partition of
+ * @tags backed by its node, see blk_mq_hctx_nodes().
+ */
+void blk_mq_map_tag_hints(struct blk_mq_hw_ctx *hctx, struct blk_mq_tags *tags)
+{
+	unsigned int depth, nr_nodes, cpu;
+	struct sbitmap *sb;
+	nodemask_t nodes;
+
+	if (!tags || blk_mq_is_shared_tags(hctx->flags))
+		return;
+	sb = &tags->bitmap_tags.sb;
+	if (!sb->alloc_hint)
+		return;
+
+	nr_nodes = blk_mq_hctx_nodes(hctx->queue->tag_set, hctx->queue_num,
+				     &nodes);
+	if (nr_nodes <= 1)
+		return;
+
+	depth = sb->depth;
+	for_each_cpu(cpu, hctx->cpumask) {
+		int node = cpu_to_node(cpu), n = 0, i;
+
+		for_each_node_mask(i, nodes) {
+			if (i == node)
+				break;
+			n++;
+		}
+		if (n >= nr_nodes)
+			continue;
+		*per_cpu_ptr(sb->alloc_hint, cpu) = DIV_ROUND_UP(n * depth, nr_nodes);
+	}
+}
+
 /*
  * Caller needs to ensure that we're either frozen/quiesced, or that
  * the queue isn't live yet.
@@ -5085,19 +5186,87 @@ void blk_mq_update_nr_hw_queues(struct blk_mq_tag_set *set, int nr_hw_queues)
 }
 EXPORT_SYMBOL_GPL(blk_mq_update_nr_hw_queues);
 
+/*
+ * Hybrid polling sleeps for this fraction (1 / 2^shift) of the learned time
+ * to completion before it starts spinning, and learns with an EWMA weight of
+ * 1 / 2^BLK_POLL_HYBRID_EWMA.
+ */
+#define BLK_POLL_HYBRID_SHIFT	1
+#define BLK_POLL_HYBRID_EWMA	3
+
+static void blk_hctx_poll_hybrid_sleep(struct blk_mq_hw_ctx *hctx)
+{
+	u64 issue = READ_ONCE(hctx->poll_issue_ns);
+	u64 mean = READ_ONCE(hctx->poll_mean_ns);
+	struct hrtimer_sleeper hs;
+	u64 now, until;
+
+	if (!issue || !mean)
+		return;
+
+	now = ktime_get_ns();
+	until = issue + (mean >> BLK_POLL_HYBRID_SHIFT);
+	if (now >= until)
+		return;
+
+	/*
+	 * Oversleeping costs latency directly, so allow the timer to be late
+	 * by at most an eighth of the sleep.
+	 */
+	hrtimer_setup_sleeper_on_stack(&hs, CLOCK_MONOTONIC, HRTIMER_MODE_ABS);
+	hrtimer_set_expires_range_ns(&hs.timer, ns_to_ktime(until),
+				     (until - now) >> 3);
+	set_current_state(TASK_UNINTERRUPTIBLE);
+	hrtimer_sleeper_start_expires(&hs, HRTIMER_MODE_ABS);
+	if (hs.task)
+		io_schedule();
+	hrtimer_cancel(&hs.timer);
+	__set_current_state(TASK_RUNNING);
+	destroy_hrtimer_on_stack(&hs.timer);
+}
+
+/* Learn the issue to completion time from the first completion found. */
+static void blk_hctx_poll_hybrid_learn(struct blk_mq_hw_ctx *hctx)
+{
+	u64 issue = READ_ONCE(hctx->poll_issue_ns);
+	s64 mean = READ_ONCE(hctx->poll_mean_ns), sample;
+
+	if (!issue)
+		return;
+
+	sample = ktime_get_ns() - issue;
+	if (!mean)
+		mean = sample;
+	else
+		mean += (sample - mean) >> BLK_POLL_HYBRID_EWMA;
+	WRITE_ONCE(hctx->poll_mean_ns, max_t(s64, mean, 1));
+	WRITE_ONCE(hctx->poll_issue_ns, 0);
+}
+
 static int blk_hctx_poll(struct request_queue *q, struct blk_mq_hw_ctx *hctx,
 			 struct io_comp_batch *iob, unsigned int flags)
 {
 	long state = get_current_state();
+	bool hybrid = blk_queue_hybrid_poll(q);
 	int ret;
 
 	do {
 		ret = q->mq_ops->poll(hctx, iob);
 		if (ret > 0) {
+			if (hybrid)
+				blk_hctx_poll_hybrid_learn(hctx);
 			__set_current_state(TASK_RUNNING);
 			return ret;
 		}
 
+		/* Nothing completed yet: sleep through most of the wait once. */
+		if (hybrid && ret == 0 && task_is_running(current) &&
+		    !signal_pending(current)) {
+			blk_hctx_poll_hybrid_sleep(hctx);
+			hybrid = false;
+			continue;
+		}
+
 		if (signal_pending_state(state, current))
 			__set_current_state(TASK_RUNNING);
 		if (task_is_running(current))
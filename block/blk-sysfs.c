@@ -339,6 +339,8 @@ static ssize_t queue_rq_affinity_show(struct gendisk *disk, char *page)
 	bool set = test_bit(QUEUE_FLAG_SAME_COMP, &disk->queue->queue_flags);
 	bool force = test_bit(QUEUE_FLAG_SAME_FORCE, &disk->queue->queue_flags);
 
+	if (test_bit(QUEUE_FLAG_SAME_NODE, &disk->queue->queue_flags))
+		return queue_var_show(3, page);
 	return queue_var_show(set << force, page);
 }
 
@@ -362,6 +364,13 @@ queue_rq_affinity_store(struct gendisk *disk, const char *page, size_t count)
 	 * don't grab any lock while updating these flags.
 	 */
 	memflags = blk_mq_freeze_queue(q);
+	if (val == 3) {
+		blk_queue_flag_set(QUEUE_FLAG_SAME_COMP, q);
+		blk_queue_flag_clear(QUEUE_FLAG_SAME_FORCE, q);
+		blk_queue_flag_set(QUEUE_FLAG_SAME_NODE, q);
+	} else if (val <= 2) {
+		blk_queue_flag_clear(QUEUE_FLAG_SAME_NODE, q);
+	}
 	if (val == 2) {
 		blk_queue_flag_set(QUEUE_FLAG_SAME_COMP, q);
 		blk_queue_flag_set(QUEUE_FLAG_SAME_FORCE, q);
@@ -383,6 +392,27 @@ static ssize_t queue_poll_delay_store(struct gendisk *disk, const char *page,
 	return count;
 }
 
+static ssize_t queue_poll_mode_show(struct gendisk *disk, char *page)
+{
+	return sysfs_emit(page, "%s\n",
+		blk_queue_hybrid_poll(disk->queue) ? "hybrid" : "classic");
+}
+
+static ssize_t queue_poll_mode_store(struct gendisk *disk, const char *page,
+				     size_t count)
+{
+	struct request_queue *q = disk->queue;
+
+	if (sysfs_streq(page, "hybrid"))
+		blk_queue_flag_set(QUEUE_FLAG_HYBRID_POLL, q);
+	else if (sysfs_streq(page, "classic"))
+		blk_queue_flag_clear(QUEUE_FLAG_HYBRID_POLL, q);
+	else
+		return -EINVAL;
+
+	return count;
+}
+
 static ssize_t queue_poll_store(struct gendisk *disk, const char *page,
 				size_t count)
 {
@@ -523,6 +553,7 @@ QUEUE_LIM_RW_ENTRY(queue_iostats_passthrough, "iostats_passthrough");
 QUEUE_RW_ENTRY(queue_rq_affinity, "rq_affinity");
 QUEUE_RW_ENTRY(queue_poll, "io_poll");
 QUEUE_RW_ENTRY(queue_poll_delay, "io_poll_delay");
+QUEUE_RW_ENTRY(queue_poll_mode, "io_poll_mode");
 QUEUE_LIM_RW_ENTRY(queue_wc, "write_cache");
 QUEUE_LIM_RO_ENTRY(queue_fua, "fua");
 QUEUE_LIM_RO_ENTRY(queue_dax, "dax");
@@ -702,6 +733,7 @@ static struct attribute *blk_mq_queue_attrs[] = {
 	 */
 	&queue_rq_affinity_entry.attr,
 	&queue_io_timeout_entry.attr,
+	&queue_poll_mode_entry.attr,
 
 	NULL,
 };
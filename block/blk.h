@@ -306,6 +306,7 @@ enum bio_merge_status bio_attempt_back_merge(struct request *req,
 		struct bio *bio, unsigned int nr_segs);
 bool blk_attempt_plug_merge(struct request_queue *q, struct bio *bio,
 		unsigned int nr_segs);
+void blk_plug_merge_hash_add(struct blk_plug *plug, struct request *rq);
 bool blk_bio_list_merge(struct request_queue *q, struct list_head *list,
 			struct bio *bio, unsigned int nr_segs);
 
@@ -315,6 +316,25 @@ bool blk_bio_list_merge(struct request_queue *q, struct list_head *list,
 #define BLK_MAX_REQUEST_COUNT	32
 #define BLK_PLUG_FLUSH_SIZE	(128 * 1024)
 
+static inline void blk_plug_merge_hash_init(struct blk_plug *plug)
+{
+	memset(plug->merge_hash, 0, sizeof(plug->merge_hash));
+}
+
+struct blk_plug_merge_stats {
+	unsigned long		lookups;
+	unsigned long		tail_hits;
+	unsigned long		hash_hits;
+	unsigned long		misses;
+};
+
+#ifdef CONFIG_BLK_DEBUG_FS
+#define blk_plug_merge_stat_inc(q, field)	\
+	this_cpu_inc((q)->plug_merge_stats->field)
+#else
+#define blk_plug_merge_stat_inc(q, field)	do { } while (0)
+#endif
+
 /*
  * Internal elevator interface
  */
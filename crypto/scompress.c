@@ -10,6 +10,7 @@
 #include <crypto/internal/acompress.h>
 #include <crypto/internal/scompress.h>
 #include <crypto/scatterwalk.h>
+#include <linux/completion.h>
 #include <linux/cryptouser.h>
 #include <linux/err.h>
 #include <linux/highmem.h>
@@ -21,6 +22,7 @@
 #include <linux/slab.h>
 #include <linux/string.h>
 #include <linux/vmalloc.h>
+#include <linux/workqueue.h>
 #include <net/netlink.h>
 
 #include "compress.h"
@@ -40,10 +42,21 @@ static DEFINE_PER_CPU(struct scomp_scratch, scomp_scratch) = {
 	.lock = __SPIN_LOCK_UNLOCKED(scomp_scratch.lock),
 };
 
+struct scomp_chain_work {
+	struct work_struct	work;
+	struct acomp_req	*req;
+	int			dir;
+	atomic_t		*pending;
+	struct completion	*done;
+};
+
 static const struct crypto_type crypto_scomp_type;
 static int scomp_scratch_users;
 static DEFINE_MUTEX(scomp_lock);
 
+/* Spreads the requests of a chain over CPUs, see scomp_acomp_chain() */
+static struct workqueue_struct *scomp_wq;
+
 static int __maybe_unused crypto_scomp_report(
 	struct sk_buff *skb, struct crypto_alg *alg)
 {
@@ -165,8 +178,12 @@ static int crypto_scomp_init_tfm(struct crypto_tfm *tfm)
 	}
 	if (!scomp_scratch_users++) {
 		ret = crypto_scomp_alloc_scratches();
-		if (ret)
+		if (ret) {
 			scomp_scratch_users--;
+			goto unlock;
+		}
+		/* Chains are processed serially without it, so not fatal */
+		scomp_wq = alloc_workqueue("scomp", WQ_UNBOUND | WQ_MEM_RECLAIM, 0);
 	}
 unlock:
 	mutex_unlock(&scomp_lock);
@@ -292,11 +309,70 @@ static int scomp_acomp_comp_decomp(struct acomp_req *req, int dir)
 	return ret;
 }
 
+static void scomp_chain_workfn(struct work_struct *work)
+{
+	struct scomp_chain_work *cw = container_of(work, struct scomp_chain_work,
+						   work);
+
+	cw->req->base.err = scomp_acomp_comp_decomp(cw->req, cw->dir);
+	if (atomic_dec_and_test(cw->pending))
+		complete(cw->done);
+}
+
+/*
+ * Hand the chained requests to scomp_wq and process the head request in
+ * the caller's context, so that a batch is compressed by as many CPUs as
+ * are available rather than one request after the other. This is only
+ * done when the caller may sleep; otherwise, or if the work items cannot
+ * be allocated, the chain is processed serially.
+ */
+static bool scomp_acomp_chain_parallel(struct acomp_req *req, int dir, int *err)
+{
+	DECLARE_COMPLETION_ONSTACK(done);
+	struct scomp_chain_work *cw;
+	struct acomp_req *r2;
+	atomic_t pending;
+	size_t n, i = 0;
+
+	if (!(req->base.flags & CRYPTO_TFM_REQ_MAY_SLEEP) || !scomp_wq)
+		return false;
+
+	n = list_count_nodes(&req->base.list);
+	if (!n)
+		return false;
+
+	cw = kmalloc_array(n, sizeof(*cw), GFP_NOWAIT | __GFP_NOWARN);
+	if (!cw)
+		return false;
+
+	atomic_set(&pending, n);
+	list_for_each_entry(r2, &req->base.list, base.list) {
+		INIT_WORK(&cw[i].work, scomp_chain_workfn);
+		cw[i].req = r2;
+		cw[i].dir = dir;
+		cw[i].pending = &pending;
+		cw[i].done = &done;
+		queue_work(scomp_wq, &cw[i].work);
+		i++;
+	}
+
+	*err = scomp_acomp_comp_decomp(req, dir);
+	req->base.err = *err;
+
+	wait_for_completion(&done);
+	kfree(cw);
+
+	return true;
+}
+
 static int scomp_acomp_chain(struct acomp_req *req, int dir)
 {
 	struct acomp_req *r2;
 	int err;
 
+	if (scomp_acomp_chain_parallel(req, dir, &err))
+		return err;
+
 	err = scomp_acomp_comp_decomp(req, dir);
 	req->base.err = err;
 
@@ -323,8 +399,13 @@ static void crypto_exit_scomp_ops_async(struct crypto_tfm *tfm)
 	crypto_free_scomp(*ctx);
 
 	mutex_lock(&scomp_lock);
-	if (!--scomp_scratch_users)
+	if (!--scomp_scratch_users) {
+		if (scomp_wq) {
+			destroy_workqueue(scomp_wq);
+			scomp_wq = NULL;
+		}
 		crypto_scomp_free_scratches();
+	}
 	mutex_unlock(&scomp_lock);
 }
 
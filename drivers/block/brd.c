@@ -15,7 +15,11 @@
 #include <linux/moduleparam.h>
 #include <linux/major.h>
 #include <linux/blkdev.h>
+#include <linux/blk-mq.h>
 #include <linux/bio.h>
+#include <linux/hrtimer.h>
+#include <linux/math64.h>
+#include <linux/random.h>
 #include <linux/highmem.h>
 #include <linux/mutex.h>
 #include <linux/pagemap.h>
@@ -41,6 +45,9 @@ struct brd_device {
 	 */
 	struct xarray	        brd_pages;
 	u64			brd_nr_pages;
+
+	/* Only used with a latency profile, see brd_queue_rq(). */
+	struct blk_mq_tag_set	tag_set;
 };
 
 /*
@@ -286,6 +293,202 @@ static const struct block_device_operations brd_fops = {
 	.submit_bio =		brd_submit_bio,
 };
 
+static const struct block_device_operations brd_mq_fops = {
+	.owner =		THIS_MODULE,
+};
+
+/*
+ * Latency profiles.
+ *
+ * With rd_profile set, the ramdisk is a blk-mq device, so I/O schedulers can
+ * be attached to it, and completes every request from an hrtimer after a
+ * latency drawn from the profile instead of synchronously:
+ *
+ *  fixed:      reads take rd_read_lat_us, writes rd_write_lat_us.
+ *  bimodal:    like fixed, but rd_slow_pct percent of requests take
+ *              rd_slow_lat_us.
+ *  heavytail:  Pareto (alpha 1) distributed above the fixed latency, i.e.
+ *              one request in k takes more than k times as long, capped at
+ *              rd_slow_lat_us.
+ *  flushstall: like fixed, but for rd_stall_ms out of every
+ *              rd_stall_period_ms, writes and flushes stall as if the
+ *              device was draining its write buffer.
+ *
+ * The data itself is still copied synchronously in ->queue_rq.
+ */
+enum brd_profile {
+	BRD_PROFILE_NONE,
+	BRD_PROFILE_FIXED,
+	BRD_PROFILE_BIMODAL,
+	BRD_PROFILE_HEAVY_TAIL,
+	BRD_PROFILE_FLUSH_STALL,
+};
+
+static const char *const brd_profile_names[] = {
+	[BRD_PROFILE_NONE]		= "none",
+	[BRD_PROFILE_FIXED]		= "fixed",
+	[BRD_PROFILE_BIMODAL]		= "bimodal",
+	[BRD_PROFILE_HEAVY_TAIL]	= "heavytail",
+	[BRD_PROFILE_FLUSH_STALL]	= "flushstall",
+};
+
+static enum brd_profile brd_profile;
+static ktime_t brd_stall_epoch;
+
+static char *rd_profile = "none";
+module_param(rd_profile, charp, 0444);
+MODULE_PARM_DESC(rd_profile, "Latency profile: none, fixed, bimodal, heavytail or flushstall");
+
+static unsigned int rd_queue_depth = 64;
+module_param(rd_queue_depth, uint, 0444);
+MODULE_PARM_DESC(rd_queue_depth, "Queue depth with a latency profile");
+
+static unsigned int rd_nr_hw_queues = 1;
+module_param(rd_nr_hw_queues, uint, 0444);
+MODULE_PARM_DESC(rd_nr_hw_queues, "Number of hardware queues with a latency profile");
+
+static unsigned int rd_read_lat_us = 100;
+module_param(rd_read_lat_us, uint, 0444);
+MODULE_PARM_DESC(rd_read_lat_us, "Base read latency in usecs");
+
+static unsigned int rd_write_lat_us = 200;
+module_param(rd_write_lat_us, uint, 0444);
+MODULE_PARM_DESC(rd_write_lat_us, "Base write, flush and discard latency in usecs");
+
+static unsigned int rd_slow_lat_us = 5000;
+module_param(rd_slow_lat_us, uint, 0444);
+MODULE_PARM_DESC(rd_slow_lat_us, "Slow mode latency (bimodal) or latency cap (heavytail) in usecs");
+
+static unsigned int rd_slow_pct = 1;
+module_param(rd_slow_pct, uint, 0444);
+MODULE_PARM_DESC(rd_slow_pct, "Percentage of slow requests (bimodal)");
+
+static unsigned int rd_stall_period_ms = 1000;
+module_param(rd_stall_period_ms, uint, 0444);
+MODULE_PARM_DESC(rd_stall_period_ms, "Write buffer flush period in msecs (flushstall)");
+
+static unsigned int rd_stall_ms = 50;
+module_param(rd_stall_ms, uint, 0444);
+MODULE_PARM_DESC(rd_stall_ms, "Write buffer flush stall in msecs (flushstall)");
+
+struct brd_cmd {
+	struct hrtimer		timer;
+};
+
+static u64 brd_rq_latency(struct request *rq, ktime_t now)
+{
+	bool write = op_is_write(req_op(rq));
+	u64 lat = (write ? rd_write_lat_us : rd_read_lat_us) * NSEC_PER_USEC;
+	u64 slow = (u64)rd_slow_lat_us * NSEC_PER_USEC;
+
+	switch (brd_profile) {
+	case BRD_PROFILE_BIMODAL:
+		if (get_random_u32_below(100) < rd_slow_pct)
+			lat = slow;
+		break;
+	case BRD_PROFILE_HEAVY_TAIL:
+		lat = min(lat * 1024 / get_random_u32_inclusive(1, 1024),
+			  max(lat, slow));
+		break;
+	case BRD_PROFILE_FLUSH_STALL: {
+		u64 period = (u64)rd_stall_period_ms * NSEC_PER_MSEC;
+		u64 stall = (u64)rd_stall_ms * NSEC_PER_MSEC;
+		u64 phase;
+
+		if (!write || !period)
+			break;
+		div64_u64_rem(ktime_to_ns(ktime_sub(now, brd_stall_epoch)),
+			      period, &phase);
+		if (phase < stall)
+			lat += stall - phase;
+		break;
+	}
+	default:
+		break;
+	}
+
+	return lat;
+}
+
+static enum hrtimer_restart brd_cmd_timer(struct hrtimer *timer)
+{
+	struct brd_cmd *cmd = container_of(timer, struct brd_cmd, timer);
+
+	blk_mq_end_request(blk_mq_rq_from_pdu(cmd), BLK_STS_OK);
+	return HRTIMER_NORESTART;
+}
+
+static blk_status_t brd_queue_rq(struct blk_mq_hw_ctx *hctx,
+				 const struct blk_mq_queue_data *bd)
+{
+	struct request *rq = bd->rq;
+	struct brd_device *brd = rq->q->queuedata;
+	struct brd_cmd *cmd = blk_mq_rq_to_pdu(rq);
+	sector_t sector = blk_rq_pos(rq);
+	ktime_t now = ktime_get();
+	struct req_iterator iter;
+	struct bio_vec bvec;
+
+	blk_mq_start_request(rq);
+
+	switch (req_op(rq)) {
+	case REQ_OP_FLUSH:
+		break;
+	case REQ_OP_DISCARD:
+		brd_do_discard(brd, sector, blk_rq_bytes(rq));
+		break;
+	case REQ_OP_READ:
+	case REQ_OP_WRITE:
+		rq_for_each_segment(bvec, rq, iter) {
+			int err;
+
+			err = brd_do_bvec(brd, bvec.bv_page, bvec.bv_len,
+					  bvec.bv_offset, rq->cmd_flags, sector);
+			if (err) {
+				blk_mq_end_request(rq, errno_to_blk_status(err));
+				return BLK_STS_OK;
+			}
+			sector += bvec.bv_len >> SECTOR_SHIFT;
+		}
+		break;
+	default:
+		return BLK_STS_NOTSUPP;
+	}
+
+	hrtimer_start(&cmd->timer, ktime_add_ns(now, brd_rq_latency(rq, now)),
+		      HRTIMER_MODE_ABS);
+	return BLK_STS_OK;
+}
+
+static int brd_init_request(struct blk_mq_tag_set *set, struct request *rq,
+			    unsigned int hctx_idx, unsigned int numa_node)
+{
+	struct brd_cmd *cmd = blk_mq_rq_to_pdu(rq);
+
+	hrtimer_setup(&cmd->timer, brd_cmd_timer, CLOCK_MONOTONIC,
+		      HRTIMER_MODE_ABS);
+	return 0;
+}
+
+static const struct blk_mq_ops brd_mq_ops = {
+	.queue_rq	= brd_queue_rq,
+	.init_request	= brd_init_request,
+};
+
+static int brd_parse_profile(void)
+{
+	int i;
+
+	i = sysfs_match_string(brd_profile_names, rd_profile);
+	if (i < 0) {
+		pr_err("brd: unknown latency profile %s\n", rd_profile);
+		return i;
+	}
+	brd_profile = i;
+	brd_stall_epoch = ktime_get();
+	return 0;
+}
+
 /*
  * And now the modules code and kernel interface.
  */
@@ -388,15 +591,35 @@ static int brd_alloc(int i)
 		debugfs_create_u64(buf, 0444, brd_debugfs_dir,
 				&brd->brd_nr_pages);
 
-	disk = brd->brd_disk = blk_alloc_disk(&lim, NUMA_NO_NODE);
+	if (brd_profile != BRD_PROFILE_NONE) {
+		struct blk_mq_tag_set *set = &brd->tag_set;
+
+		set->ops = &brd_mq_ops;
+		set->nr_hw_queues = clamp(rd_nr_hw_queues, 1U, nr_cpu_ids);
+		set->queue_depth = clamp(rd_queue_depth, 1U, BLK_MQ_MAX_DEPTH);
+		set->numa_node = NUMA_NO_NODE;
+		set->cmd_size = sizeof(struct brd_cmd);
+		/* Backing pages are allocated with GFP_NOIO in ->queue_rq. */
+		set->flags = BLK_MQ_F_BLOCKING;
+		err = blk_mq_alloc_tag_set(set);
+		if (err)
+			goto out_free_dev;
+
+		/* Completions are asynchronous; issue flushes for fsync. */
+		lim.features = BLK_FEAT_WRITE_CACHE;
+		disk = blk_mq_alloc_disk(set, &lim, brd);
+	} else {
+		disk = blk_alloc_disk(&lim, NUMA_NO_NODE);
+	}
+	brd->brd_disk = disk;
 	if (IS_ERR(disk)) {
 		err = PTR_ERR(disk);
-		goto out_free_dev;
+		goto out_free_tag_set;
 	}
 	disk->major		= RAMDISK_MAJOR;
 	disk->first_minor	= i * max_part;
 	disk->minors		= max_part;
-	disk->fops		= &brd_fops;
+	disk->fops		= brd->tag_set.ops ? &brd_mq_fops : &brd_fops;
 	disk->private_data	= brd;
 	strscpy(disk->disk_name, buf, DISK_NAME_LEN);
 	set_capacity(disk, rd_size * 2);
@@ -409,6 +632,9 @@ static int brd_alloc(int i)
 
 out_cleanup_disk:
 	put_disk(disk);
+out_free_tag_set:
+	if (brd->tag_set.ops)
+		blk_mq_free_tag_set(&brd->tag_set);
 out_free_dev:
 	brd_free_device(brd);
 	return err;
@@ -428,6 +654,8 @@ static void brd_cleanup(void)
 	list_for_each_entry_safe(brd, next, &brd_devices, brd_list) {
 		del_gendisk(brd->brd_disk);
 		put_disk(brd->brd_disk);
+		if (brd->tag_set.ops)
+			blk_mq_free_tag_set(&brd->tag_set);
 		brd_free_pages(brd);
 		brd_free_device(brd);
 	}
@@ -473,6 +701,10 @@ static int __init brd_init(void)
 
 	brd_check_and_reset_par();
 
+	err = brd_parse_profile();
+	if (err)
+		return err;
+
 	brd_debugfs_dir = debugfs_create_dir("ramdisk_pages", NULL);
 
 	if (__register_blkdev(RAMDISK_MAJOR, "ramdisk", brd_probe)) {
@@ -64,7 +64,8 @@
 		| UBLK_F_CMD_IOCTL_ENCODE \
 		| UBLK_F_USER_COPY \
 		| UBLK_F_ZONED \
-		| UBLK_F_USER_RECOVERY_FAIL_IO)
+		| UBLK_F_USER_RECOVERY_FAIL_IO \
+		| UBLK_F_AUTO_BUF_REG)
 
 #define UBLK_F_ALL_RECOVERY_FLAGS (UBLK_F_USER_RECOVERY \
 		| UBLK_F_USER_RECOVERY_REISSUE \
@@ -131,6 +132,12 @@ struct ublk_uring_cmd_pdu {
  */
 #define UBLK_IO_FLAG_NEED_GET_DATA 0x08
 
+/*
+ * The request buffer has been registered into the io_uring buffer table of
+ * ublk server by the driver, and has to be unregistered on commit.
+ */
+#define UBLK_IO_FLAG_AUTO_BUF_REG 0x10
+
 /* atomic RW with ubq->cancel_lock */
 #define UBLK_IO_FLAG_CANCELED	0x80000000
 
@@ -140,6 +147,9 @@ struct ublk_io {
 	unsigned int flags;
 	int res;
 
+	/* buffer table index for UBLK_F_AUTO_BUF_REG */
+	struct ublk_auto_buf_reg buf;
+
 	struct io_uring_cmd *cmd;
 };
 
@@ -614,6 +624,11 @@ static inline bool ublk_support_user_copy(const struct ublk_queue *ubq)
 	return ubq->flags & UBLK_F_USER_COPY;
 }
 
+static inline bool ublk_support_auto_buf_reg(const struct ublk_queue *ubq)
+{
+	return ubq->flags & UBLK_F_AUTO_BUF_REG;
+}
+
 static inline bool ublk_need_map_io(const struct ublk_queue *ubq)
 {
 	return !ublk_support_user_copy(ubq) && !ublk_support_zero_copy(ubq);
@@ -1154,6 +1169,41 @@ static inline void __ublk_abort_rq(struct ublk_queue *ubq,
 		blk_mq_end_request(rq, BLK_STS_IOERR);
 }
 
+static void ublk_io_release(void *priv);
+
+/*
+ * Register the request buffer into the io_uring of the fetch command, so
+ * that ublk server can use it for zero copy without issuing
+ * UBLK_U_IO_REGISTER_IO_BUF.  Returns false if the request has been failed
+ * and nothing should be delivered to ublk server.
+ */
+static bool ublk_auto_buf_reg(struct ublk_queue *ubq, struct request *req,
+			      struct ublk_io *io, unsigned int issue_flags)
+{
+	int ret;
+
+	/*
+	 * The registered buffer holds its own request reference, which can't
+	 * fail to be grabbed as the reference has just been initialized.
+	 */
+	ublk_get_req_ref(ubq, req);
+	ret = io_buffer_register_bvec(io->cmd, req, ublk_io_release,
+				      io->buf.index, issue_flags);
+	if (!ret) {
+		io->flags |= UBLK_IO_FLAG_AUTO_BUF_REG;
+		return true;
+	}
+	ublk_put_req_ref(ubq, req);
+
+	if (io->buf.flags & UBLK_AUTO_BUF_REG_FALLBACK) {
+		ublk_get_iod(ubq, req->tag)->op_flags |= UBLK_IO_F_NEED_REG_BUF;
+		return true;
+	}
+
+	blk_mq_end_request(req, BLK_STS_IOERR);
+	return false;
+}
+
 static void ublk_dispatch_req(struct ublk_queue *ubq,
 			      struct request *req,
 			      unsigned int issue_flags)
@@ -1230,6 +1280,9 @@ static void ublk_dispatch_req(struct ublk_queue *ubq,
 	}
 
 	ublk_init_req_ref(ubq, req);
+	if (ublk_support_auto_buf_reg(ubq) && ublk_rq_has_data(req) &&
+	    !ublk_auto_buf_reg(ubq, req, io, issue_flags))
+		return;
 	ubq_complete_io_cmd(io, UBLK_IO_RES_OK, issue_flags);
 }
 
@@ -1992,6 +2045,27 @@ static int ublk_unregister_io_buf(struct io_uring_cmd *cmd,
 	return io_buffer_unregister_bvec(cmd, index, issue_flags);
 }
 
+static int ublk_parse_auto_buf_reg(__u64 addr, struct ublk_auto_buf_reg *buf)
+{
+	*buf = ublk_sqe_addr_to_auto_buf_reg(addr);
+
+	if (buf->reserved0 || buf->reserved1 ||
+	    (buf->flags & ~UBLK_AUTO_BUF_REG_F_MASK))
+		return -EINVAL;
+	return 0;
+}
+
+static void ublk_auto_buf_unreg(struct io_uring_cmd *cmd, struct ublk_io *io,
+				unsigned int issue_flags)
+{
+	if (!(io->flags & UBLK_IO_FLAG_AUTO_BUF_REG))
+		return;
+
+	/* ublk server may have unregistered the buffer by itself */
+	io_buffer_unregister_bvec(cmd, io->buf.index, issue_flags);
+	io->flags &= ~UBLK_IO_FLAG_AUTO_BUF_REG;
+}
+
 static int ublk_fetch(struct io_uring_cmd *cmd, struct ublk_queue *ubq,
 		      struct ublk_io *io, __u64 buf_addr)
 {
@@ -2025,6 +2099,10 @@ static int ublk_fetch(struct io_uring_cmd *cmd, struct ublk_queue *ubq,
 		 */
 		if (!buf_addr && !ublk_need_get_data(ubq))
 			goto out;
+	} else if (ublk_support_auto_buf_reg(ubq)) {
+		ret = ublk_parse_auto_buf_reg(buf_addr, &io->buf);
+		if (ret)
+			goto out;
 	} else if (buf_addr) {
 		/* User copy requires addr to be unset */
 		ret = -EINVAL;
@@ -2043,6 +2121,7 @@ static int __ublk_ch_uring_cmd(struct io_uring_cmd *cmd,
 			       const struct ublksrv_io_cmd *ub_cmd)
 {
 	struct ublk_device *ub = cmd->file->private_data;
+	struct ublk_auto_buf_reg buf = { };
 	struct ublk_queue *ubq;
 	struct ublk_io *io;
 	u32 cmd_op = cmd->cmd_op;
@@ -2112,6 +2191,9 @@ static int __ublk_ch_uring_cmd(struct io_uring_cmd *cmd,
 			if (!ub_cmd->addr && (!ublk_need_get_data(ubq) ||
 						req_op(req) == REQ_OP_READ))
 				goto out;
+		} else if (ublk_support_auto_buf_reg(ubq)) {
+			if (ublk_parse_auto_buf_reg(ub_cmd->addr, &buf))
+				goto out;
 		} else if (req_op(req) != REQ_OP_ZONE_APPEND && ub_cmd->addr) {
 			/*
 			 * User copy requires addr to be unset when command is
@@ -2121,6 +2203,10 @@ static int __ublk_ch_uring_cmd(struct io_uring_cmd *cmd,
 			goto out;
 		}
 
+		if (ublk_support_auto_buf_reg(ubq)) {
+			ublk_auto_buf_unreg(cmd, io, issue_flags);
+			io->buf = buf;
+		}
 		ublk_fill_io_cmd(io, cmd, ub_cmd->addr);
 		ublk_commit_completion(ub, ub_cmd);
 		break;
@@ -2810,6 +2896,18 @@ static int ublk_ctrl_add_dev(const struct ublksrv_ctrl_cmd *header)
 	if (ub->dev_info.flags & (UBLK_F_USER_COPY | UBLK_F_SUPPORT_ZERO_COPY))
 		ub->dev_info.flags &= ~UBLK_F_NEED_GET_DATA;
 
+	/*
+	 * Automatic buffer registration is built on zero copy, and reuses
+	 * `ublksrv_io_cmd->addr`, which zoned devices need for returning
+	 * write_append_lba
+	 */
+	if ((ub->dev_info.flags & UBLK_F_AUTO_BUF_REG) &&
+	    (!(ub->dev_info.flags & UBLK_F_SUPPORT_ZERO_COPY) ||
+	     ublk_dev_is_zoned(ub))) {
+		ret = -EINVAL;
+		goto out_free_dev_number;
+	}
+
 	/*
 	 * Zoned storage support requires reuse `ublksrv_io_cmd->addr` for
 	 * returning write_append_lba, which is only allowed in case of
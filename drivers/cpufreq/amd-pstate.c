@@ -86,6 +86,7 @@ static struct cpufreq_driver amd_pstate_driver;
 static struct cpufreq_driver amd_pstate_epp_driver;
 static int cppc_state = AMD_PSTATE_UNDEFINED;
 static bool amd_pstate_prefcore = true;
+static bool amd_pstate_task_epp;
 static struct quirk_entry *quirks;
 
 /*
@@ -259,6 +260,7 @@ static int msr_update_perf(struct cpufreq_policy *policy, u8 min_perf,
 
 	if (fast_switch) {
 		wrmsrl(MSR_AMD_CPPC_REQ, value);
+		WRITE_ONCE(cpudata->cppc_req_hw, value);
 		return 0;
 	} else {
 		int ret = wrmsrl_on_cpu(cpudata->cpu, MSR_AMD_CPPC_REQ, value);
@@ -267,6 +269,7 @@ static int msr_update_perf(struct cpufreq_policy *policy, u8 min_perf,
 			return ret;
 	}
 
+	WRITE_ONCE(cpudata->cppc_req_hw, value);
 	WRITE_ONCE(cpudata->cppc_req_cached, value);
 
 	return 0;
@@ -316,6 +319,7 @@ static int msr_set_epp(struct cpufreq_policy *policy, u8 epp)
 	}
 
 	/* update both so that msr_update_perf() can effectively check */
+	WRITE_ONCE(cpudata->cppc_req_hw, value);
 	WRITE_ONCE(cpudata->cppc_req_cached, value);
 
 	return ret;
@@ -1416,6 +1420,48 @@ static bool amd_pstate_acpi_pm_profile_undefined(void)
 	return false;
 }
 
+/*
+ * Called by the scheduler on the CPU itself before switching to @next, with
+ * interrupts disabled. Tasks with a minimum utilization request (RT, DL and
+ * uclamp_min boosted ones) get the performance EPP and a min_perf floor
+ * matching their request, so that the CCLK controller ramps up right away
+ * instead of waiting for the governor to notice. SCHED_BATCH and SCHED_IDLE
+ * tasks are biased towards power. Everything else runs with the policy's
+ * request. The MSR is only written when the resulting value changes.
+ */
+static void amd_pstate_task_switch(struct task_switch_data *data,
+				   struct task_struct *next,
+				   unsigned long min_util)
+{
+	struct amd_cpudata *cpudata = container_of(data, struct amd_cpudata,
+						   task_switch);
+	u64 value = READ_ONCE(cpudata->cppc_req_cached);
+	u8 epp = FIELD_GET(AMD_CPPC_EPP_PERF_MASK, value);
+	u8 min_perf = FIELD_GET(AMD_CPPC_MIN_PERF_MASK, value);
+
+	if (min_util) {
+		union perf_cached perf = READ_ONCE(cpudata->perf);
+		u32 hint = (min_util * perf.highest_perf) >> SCHED_CAPACITY_SHIFT;
+
+		hint = min_t(u32, hint, perf.max_limit_perf);
+		min_perf = max_t(u8, min_perf, hint);
+		epp = AMD_CPPC_EPP_PERFORMANCE;
+	} else if ((next->policy == SCHED_BATCH || next->policy == SCHED_IDLE) &&
+		   cpudata->policy != CPUFREQ_POLICY_PERFORMANCE) {
+		epp = max_t(u8, epp, AMD_CPPC_EPP_BALANCE_POWERSAVE);
+	}
+
+	value &= ~(AMD_CPPC_MIN_PERF_MASK | AMD_CPPC_EPP_PERF_MASK);
+	value |= FIELD_PREP(AMD_CPPC_MIN_PERF_MASK, min_perf);
+	value |= FIELD_PREP(AMD_CPPC_EPP_PERF_MASK, epp);
+
+	if (value == cpudata->cppc_req_hw)
+		return;
+
+	wrmsrl(MSR_AMD_CPPC_REQ, value);
+	WRITE_ONCE(cpudata->cppc_req_hw, value);
+}
+
 static int amd_pstate_epp_cpu_init(struct cpufreq_policy *policy)
 {
 	struct amd_cpudata *cpudata;
@@ -1491,11 +1537,16 @@ static int amd_pstate_epp_cpu_init(struct cpufreq_policy *policy)
 		if (ret)
 			return ret;
 		WRITE_ONCE(cpudata->cppc_req_cached, value);
+		WRITE_ONCE(cpudata->cppc_req_hw, value);
 	}
 	ret = amd_pstate_set_epp(policy, cpudata->epp_default);
 	if (ret)
 		return ret;
 
+	if (amd_pstate_task_epp && cpu_feature_enabled(X86_FEATURE_CPPC))
+		cpufreq_add_task_switch_hook(cpudata->cpu, &cpudata->task_switch,
+					     amd_pstate_task_switch);
+
 	current_pstate_driver->adjust_perf = NULL;
 
 	return 0;
@@ -1511,6 +1562,10 @@ static void amd_pstate_epp_cpu_exit(struct cpufreq_policy *policy)
 	struct amd_cpudata *cpudata = policy->driver_data;
 
 	if (cpudata) {
+		if (cpudata->task_switch.func) {
+			cpufreq_remove_task_switch_hook(cpudata->cpu);
+			synchronize_rcu();
+		}
 		kfree(cpudata);
 		policy->driver_data = NULL;
 	}
@@ -1803,8 +1858,17 @@ static int __init amd_prefcore_param(char *str)
 	return 0;
 }
 
+static int __init amd_task_epp_param(char *str)
+{
+	if (!strcmp(str, "enable"))
+		amd_pstate_task_epp = true;
+
+	return 0;
+}
+
 early_param("amd_pstate", amd_pstate_param);
 early_param("amd_prefcore", amd_prefcore_param);
+early_param("amd_task_epp", amd_task_epp_param);
 
 MODULE_AUTHOR("Huang Rui <ray.huang@amd.com>");
 MODULE_DESCRIPTION("AMD Processor P-state Frequency Driver");
@@ -9,6 +9,7 @@
 #define _LINUX_AMD_PSTATE_H
 
 #include <linux/pm_qos.h>
+#include <linux/sched/cpufreq.h>
 
 /*********************************************************************
  *                        AMD P-state INTERFACE                       *
@@ -60,6 +61,8 @@ struct amd_aperf_mperf {
  * @cpu: CPU number
  * @req: constraint request to apply
  * @cppc_req_cached: cached performance request hints
+ * @cppc_req_hw: last value written to MSR_AMD_CPPC_REQ, which differs from
+ *		  @cppc_req_cached while a per-task hint is applied
  * @perf: cached performance-related data
  * @prefcore_ranking: the preferred core ranking, the higher value indicates a higher
  * 		  priority.
@@ -76,6 +79,7 @@ struct amd_aperf_mperf {
  * 		  AMD P-State driver supports preferred core featue.
  * @epp_cached: Cached CPPC energy-performance preference value
  * @policy: Cpufreq policy value
+ * @task_switch: scheduler hook applying per-task EPP hints
  *
  * The amd_cpudata is key private data for each CPU thread in AMD P-State, and
  * represents all the attributes and goals that AMD P-State requests at runtime.
@@ -85,6 +89,7 @@ struct amd_cpudata {
 
 	struct	freq_qos_request req[2];
 	u64	cppc_req_cached;
+	u64	cppc_req_hw;
 
 	union perf_cached perf;
 
@@ -105,6 +110,7 @@ struct amd_cpudata {
 	u32	policy;
 	bool	suspended;
 	u8	epp_default;
+	struct	task_switch_data task_switch;
 };
 
 /*
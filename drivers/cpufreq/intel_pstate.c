@@ -215,6 +215,10 @@ struct global_params {
  *			preference/bias
  * @epp_cached:		Cached HWP energy-performance preference value
  * @hwp_req_cached:	Cached value of the last HWP Request MSR
+ * @hwp_req_hw:		Value last written to the HWP Request MSR, which may
+ *			differ from @hwp_req_cached while boosted
+ * @hwp_req_suppressed:	Number of HWP Request MSR writes skipped because the
+ *			register already held the value (or one close enough)
  * @hwp_cap_cached:	Cached value of the last HWP Capabilities MSR
  * @last_io_update:	Last time when IO wake flag was set
  * @capacity_perf:	Highest perf used for scale invariance
@@ -254,6 +258,8 @@ struct cpudata {
 	s16 epp_default;
 	s16 epp_cached;
 	u64 hwp_req_cached;
+	u64 hwp_req_hw;
+	unsigned long hwp_req_suppressed;
 	u64 hwp_cap_cached;
 	u64 last_io_update;
 	unsigned int capacity_perf;
@@ -299,6 +305,7 @@ static int hwp_mode_bdw __ro_after_init;
 static bool per_cpu_limits __ro_after_init;
 static bool hwp_forced __ro_after_init;
 static bool hwp_boost __read_mostly;
+static unsigned int hwp_req_hysteresis __read_mostly;
 static bool hwp_is_hybrid;
 
 static struct cpufreq_driver *intel_pstate_driver __read_mostly;
@@ -746,6 +753,48 @@ static int intel_pstate_get_energy_pref_index(struct cpudata *cpu_data, int *raw
 	return index;
 }
 
+/*
+ * MSR_HWP_REQUEST writes are expensive, so the value last written is
+ * shadowed in hwp_req_hw and redundant writes from the update_util hot paths
+ * are skipped. To keep the shadow exact, every write is done on the target
+ * CPU itself, where the hot paths run with interrupts disabled.
+ */
+static inline void intel_pstate_hwp_req_write_local(struct cpudata *cpu,
+						    u64 value)
+{
+	if (value == cpu->hwp_req_hw) {
+		WRITE_ONCE(cpu->hwp_req_suppressed, cpu->hwp_req_suppressed + 1);
+		return;
+	}
+
+	wrmsrl(MSR_HWP_REQUEST, value);
+	WRITE_ONCE(cpu->hwp_req_hw, value);
+}
+
+struct hwp_req_write {
+	struct cpudata *cpu;
+	u64 value;
+};
+
+static void __intel_pstate_hwp_req_write(void *data)
+{
+	struct hwp_req_write *req = data;
+
+	wrmsrl(MSR_HWP_REQUEST, req->value);
+	WRITE_ONCE(req->cpu->hwp_req_hw, req->value);
+}
+
+static int intel_pstate_hwp_req_write(struct cpudata *cpu, u64 value)
+{
+	struct hwp_req_write req = {
+		.cpu = cpu,
+		.value = value,
+	};
+
+	return smp_call_function_single(cpu->cpu, __intel_pstate_hwp_req_write,
+					&req, 1);
+}
+
 static int intel_pstate_set_epp(struct cpudata *cpu, u32 epp)
 {
 	int ret;
@@ -765,7 +814,7 @@ static int intel_pstate_set_epp(struct cpudata *cpu, u32 epp)
 	 * function, so it cannot run in parallel with the update below.
 	 */
 	WRITE_ONCE(cpu->hwp_req_cached, value);
-	ret = wrmsrl_on_cpu(cpu->cpu, MSR_HWP_REQUEST, value);
+	ret = intel_pstate_hwp_req_write(cpu, value);
 	if (!ret)
 		cpu->epp_cached = epp;
 
@@ -1212,7 +1261,7 @@ static void intel_pstate_hwp_set(unsigned int cpu)
 	}
 skip_epp:
 	WRITE_ONCE(cpu_data->hwp_req_cached, value);
-	wrmsrl_on_cpu(cpu, MSR_HWP_REQUEST, value);
+	intel_pstate_hwp_req_write(cpu_data, value);
 }
 
 static void intel_pstate_disable_hwp_interrupt(struct cpudata *cpudata);
@@ -1259,7 +1308,7 @@ static void intel_pstate_hwp_offline(struct cpudata *cpu)
 	if (boot_cpu_has(X86_FEATURE_HWP_EPP))
 		value |= HWP_ENERGY_PERF_PREFERENCE(HWP_EPP_POWERSAVE);
 
-	wrmsrl_on_cpu(cpu->cpu, MSR_HWP_REQUEST, value);
+	intel_pstate_hwp_req_write(cpu, value);
 
 	mutex_lock(&hybrid_capacity_lock);
 
@@ -1305,7 +1354,7 @@ static void intel_pstate_hwp_enable(struct cpudata *cpudata);
 static void intel_pstate_hwp_reenable(struct cpudata *cpu)
 {
 	intel_pstate_hwp_enable(cpu);
-	wrmsrl_on_cpu(cpu->cpu, MSR_HWP_REQUEST, READ_ONCE(cpu->hwp_req_cached));
+	intel_pstate_hwp_req_write(cpu, READ_ONCE(cpu->hwp_req_cached));
 }
 
 static int intel_pstate_suspend(struct cpufreq_policy *policy)
@@ -1700,6 +1749,46 @@ static ssize_t store_hwp_dynamic_boost(struct kobject *a,
 	return count;
 }
 
+static ssize_t show_hwp_req_hysteresis(struct kobject *kobj,
+				       struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", hwp_req_hysteresis);
+}
+
+static ssize_t store_hwp_req_hysteresis(struct kobject *a,
+					struct kobj_attribute *b,
+					const char *buf, size_t count)
+{
+	unsigned int input;
+	int ret;
+
+	ret = kstrtouint(buf, 10, &input);
+	if (ret)
+		return ret;
+
+	WRITE_ONCE(hwp_req_hysteresis, min(input, 255U));
+
+	return count;
+}
+
+static ssize_t show_hwp_req_suppressed(struct kobject *kobj,
+				       struct kobj_attribute *attr, char *buf)
+{
+	unsigned long sum = 0;
+	int cpu;
+
+	mutex_lock(&intel_pstate_driver_lock);
+
+	for_each_possible_cpu(cpu) {
+		if (all_cpu_data[cpu])
+			sum += READ_ONCE(all_cpu_data[cpu]->hwp_req_suppressed);
+	}
+
+	mutex_unlock(&intel_pstate_driver_lock);
+
+	return sprintf(buf, "%lu\n", sum);
+}
+
 static ssize_t show_energy_efficiency(struct kobject *kobj, struct kobj_attribute *attr,
 				      char *buf)
 {
@@ -1736,6 +1825,8 @@ define_one_global_rw(min_perf_pct);
 define_one_global_ro(turbo_pct);
 define_one_global_ro(num_pstates);
 define_one_global_rw(hwp_dynamic_boost);
+define_one_global_rw(hwp_req_hysteresis);
+define_one_global_ro(hwp_req_suppressed);
 define_one_global_rw(energy_efficiency);
 
 static struct attribute *intel_pstate_attributes[] = {
@@ -1827,6 +1918,12 @@ static void intel_pstate_sysfs_expose_hwp_dynamic_boost(void)
 
 	rc = sysfs_create_file(intel_pstate_kobject, &hwp_dynamic_boost.attr);
 	WARN_ON_ONCE(rc);
+
+	rc = sysfs_create_file(intel_pstate_kobject, &hwp_req_hysteresis.attr);
+	WARN_ON_ONCE(rc);
+
+	rc = sysfs_create_file(intel_pstate_kobject, &hwp_req_suppressed.attr);
+	WARN_ON_ONCE(rc);
 }
 
 static void intel_pstate_sysfs_hide_hwp_dynamic_boost(void)
@@ -1835,6 +1932,8 @@ static void intel_pstate_sysfs_hide_hwp_dynamic_boost(void)
 		return;
 
 	sysfs_remove_file(intel_pstate_kobject, &hwp_dynamic_boost.attr);
+	sysfs_remove_file(intel_pstate_kobject, &hwp_req_hysteresis.attr);
+	sysfs_remove_file(intel_pstate_kobject, &hwp_req_suppressed.attr);
 }
 
 /************************** sysfs end ************************/
@@ -2354,7 +2453,7 @@ static inline void intel_pstate_hwp_boost_up(struct cpudata *cpu)
 		return;
 
 	hwp_req = (hwp_req & ~GENMASK_ULL(7, 0)) | cpu->hwp_boost_min;
-	wrmsrl(MSR_HWP_REQUEST, hwp_req);
+	intel_pstate_hwp_req_write_local(cpu, hwp_req);
 	cpu->last_update = cpu->sample.time;
 }
 
@@ -2367,7 +2466,7 @@ static inline void intel_pstate_hwp_boost_down(struct cpudata *cpu)
 		expired = time_after64(cpu->sample.time, cpu->last_update +
 				       hwp_boost_hold_time_ns);
 		if (expired) {
-			wrmsrl(MSR_HWP_REQUEST, cpu->hwp_req_cached);
+			intel_pstate_hwp_req_write_local(cpu, cpu->hwp_req_cached);
 			cpu->hwp_boost_min = 0;
 		}
 	}
@@ -3101,11 +3200,29 @@ static void intel_cpufreq_hwp_update(struct cpudata *cpu, u32 min, u32 max,
 	if (value == prev)
 		return;
 
+	/*
+	 * Small changes of the desired performance alone don't buy much, so
+	 * don't pay for an MSR write unless they exceed the hysteresis band.
+	 * Switching to or from autonomous selection (desired = 0) always
+	 * takes effect.
+	 */
+	if (fast_switch && hwp_req_hysteresis &&
+	    !((value ^ prev) & ~HWP_DESIRED_PERF(~0L))) {
+		u32 prev_desired = (prev & HWP_DESIRED_PERF(~0L)) >> 16;
+
+		if (desired && prev_desired &&
+		    abs((int)desired - (int)prev_desired) <= hwp_req_hysteresis) {
+			WRITE_ONCE(cpu->hwp_req_suppressed,
+				   cpu->hwp_req_suppressed + 1);
+			return;
+		}
+	}
+
 	WRITE_ONCE(cpu->hwp_req_cached, value);
 	if (fast_switch)
-		wrmsrl(MSR_HWP_REQUEST, value);
+		intel_pstate_hwp_req_write_local(cpu, value);
 	else
-		wrmsrl_on_cpu(cpu->cpu, MSR_HWP_REQUEST, value);
+		intel_pstate_hwp_req_write(cpu, value);
 }
 
 static void intel_cpufreq_perf_ctl_update(struct cpudata *cpu,
@@ -3261,6 +3378,7 @@ static int intel_cpufreq_cpu_init(struct cpufreq_policy *policy)
 
 		rdmsrl_on_cpu(cpu->cpu, MSR_HWP_REQUEST, &value);
 		WRITE_ONCE(cpu->hwp_req_cached, value);
+		WRITE_ONCE(cpu->hwp_req_hw, value);
 
 		cpu->epp_cached = intel_pstate_get_epp(cpu, value);
 	} else {
@@ -3326,7 +3444,7 @@ static int intel_cpufreq_suspend(struct cpufreq_policy *policy)
 		 * written by it may not be suitable.
 		 */
 		value &= ~HWP_DESIRED_PERF(~0L);
-		wrmsrl_on_cpu(cpu->cpu, MSR_HWP_REQUEST, value);
+		intel_pstate_hwp_req_write(cpu, value);
 		WRITE_ONCE(cpu->hwp_req_cached, value);
 	}
 
@@ -40,6 +40,23 @@ module_param(guest_halt_poll_grow_start, uint, 0644);
 static bool guest_halt_poll_allow_shrink __read_mostly = true;
 module_param(guest_halt_poll_allow_shrink, bool, 0644);
 
+/*
+ * halt without polling after this many consecutive poll windows expired
+ * without a wakeup, until a halt ends within the poll window (0: disabled)
+ */
+static unsigned int guest_halt_poll_miss_limit __read_mostly;
+module_param(guest_halt_poll_miss_limit, uint, 0644);
+
+/* consecutive poll windows that expired without a wakeup */
+static DEFINE_PER_CPU(unsigned int, haltpoll_misses);
+
+static bool haltpoll_skip_poll(struct cpuidle_device *dev)
+{
+	unsigned int limit = READ_ONCE(guest_halt_poll_miss_limit);
+
+	return limit && per_cpu(haltpoll_misses, dev->cpu) >= limit;
+}
+
 /**
  * haltpoll_select - selects the next idle state to enter
  * @drv: cpuidle driver containing state data
@@ -71,6 +88,10 @@ static int haltpoll_select(struct cpuidle_driver *drv,
 		return 0;
 	}
 
+	/* Polling hasn't paid off lately: halt */
+	if (haltpoll_skip_poll(dev))
+		return 1;
+
 	*stop_tick = false;
 	/* Last state was halt: poll */
 	return 0;
@@ -119,10 +140,23 @@ static void adjust_poll_limit(struct cpuidle_device *dev, u64 block_ns)
  */
 static void haltpoll_reflect(struct cpuidle_device *dev, int index)
 {
+	unsigned int *misses = per_cpu_ptr(&haltpoll_misses, dev->cpu);
+
 	dev->last_state_idx = index;
 
-	if (index != 0)
-		adjust_poll_limit(dev, dev->last_residency_ns);
+	if (index == 0) {
+		if (dev->poll_time_limit)
+			(*misses)++;
+		else
+			*misses = 0;
+		return;
+	}
+
+	/* The wakeup would have been caught by polling */
+	if (dev->last_residency_ns <= dev->poll_limit_ns)
+		*misses = 0;
+
+	adjust_poll_limit(dev, dev->last_residency_ns);
 }
 
 /**
@@ -134,6 +168,7 @@ static int haltpoll_enable_device(struct cpuidle_driver *drv,
 				  struct cpuidle_device *dev)
 {
 	dev->poll_limit_ns = 0;
+	per_cpu(haltpoll_misses, dev->cpu) = 0;
 
 	return 0;
 }
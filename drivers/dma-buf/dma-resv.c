@@ -662,6 +662,94 @@ int dma_resv_get_singleton(struct dma_resv *obj, enum dma_resv_usage usage,
 }
 EXPORT_SYMBOL_GPL(dma_resv_get_singleton);
 
+/*
+ * Check without taking fence references whether all fences filtered by @usage
+ * are already flagged as signaled. The fences are freed with RCU, so their
+ * flags can be read while the list is RCU protected. A false return only
+ * means that the slow path, which may call &dma_fence_ops.signaled, is needed.
+ */
+static bool dma_resv_signaled_flag_unlocked(struct dma_resv *obj,
+					    enum dma_resv_usage usage)
+{
+	struct dma_resv_list *list;
+	enum dma_resv_usage fence_usage;
+	struct dma_fence *fence;
+	bool signaled;
+	unsigned int i;
+
+	rcu_read_lock();
+	do {
+		signaled = true;
+		list = dma_resv_fences_list(obj);
+		for (i = 0; list && i < list->num_fences; ++i) {
+			dma_resv_list_entry(list, i, NULL, &fence, &fence_usage);
+			if (fence_usage <= usage &&
+			    !test_bit(DMA_FENCE_FLAG_SIGNALED_BIT, &fence->flags)) {
+				signaled = false;
+				break;
+			}
+		}
+	} while (dma_resv_fences_list(obj) != list);
+	rcu_read_unlock();
+
+	return signaled;
+}
+
+/**
+ * dma_resv_snapshot_points - Snapshot the timeline points of reservation's
+ * objects fences
+ * @obj: the reservation object
+ * @usage: controls which fences to include, see enum dma_resv_usage.
+ * @points: array to store the points in
+ * @max_points: number of entries in @points
+ *
+ * Stores the context and seqno of each fence filtered by @usage that is not
+ * flagged as signaled yet, without taking a lock or fence references. This
+ * is meant for callers that only need to compare timeline points, e.g. to
+ * tell whether the buffer got new fences since the last frame. The snapshot
+ * is racy by nature and may contain points that signaled meanwhile.
+ *
+ * Callers are not required to hold specific locks, but maybe hold
+ * dma_resv_lock() already.
+ *
+ * RETURNS
+ * The number of points stored, or -ENOSPC if @max_points is too small.
+ */
+int dma_resv_snapshot_points(struct dma_resv *obj, enum dma_resv_usage usage,
+			     struct dma_resv_fence_point *points,
+			     unsigned int max_points)
+{
+	struct dma_resv_list *list;
+	enum dma_resv_usage fence_usage;
+	struct dma_fence *fence;
+	unsigned int i;
+	int count;
+
+	rcu_read_lock();
+	do {
+		count = 0;
+		list = dma_resv_fences_list(obj);
+		for (i = 0; list && i < list->num_fences; ++i) {
+			dma_resv_list_entry(list, i, NULL, &fence, &fence_usage);
+			if (fence_usage > usage ||
+			    test_bit(DMA_FENCE_FLAG_SIGNALED_BIT, &fence->flags))
+				continue;
+
+			if (count == max_points) {
+				count = -ENOSPC;
+				break;
+			}
+			points[count].context = fence->context;
+			points[count].seqno = fence->seqno;
+			count++;
+		}
+	} while (dma_resv_fences_list(obj) != list);
+	rcu_read_unlock();
+
+	return count;
+}
+EXPORT_SYMBOL_GPL(dma_resv_snapshot_points);
+
 /**
  * dma_resv_wait_timeout - Wait on reservation's objects fences
  * @obj: the reservation object
@@ -682,6 +770,9 @@ long dma_resv_wait_timeout(struct dma_resv *obj, enum dma_resv_usage usage,
 	struct dma_resv_iter cursor;
 	struct dma_fence *fence;
 
+	if (dma_resv_signaled_flag_unlocked(obj, usage))
+		return ret;
+
 	dma_resv_iter_begin(&cursor, obj, usage);
 	dma_resv_for_each_fence_unlocked(&cursor, fence) {
 
@@ -699,6 +790,47 @@ long dma_resv_wait_timeout(struct dma_resv *obj, enum dma_resv_usage usage,
 }
 EXPORT_SYMBOL_GPL(dma_resv_wait_timeout);
 
+/**
+ * dma_resv_wait_timeout_many - Wait on the fences of many reservation objects
+ * @objs: the reservation objects
+ * @count: number of entries in @objs
+ * @usage: controls which fences to include, see enum dma_resv_usage.
+ * @intr: if true, do interruptible wait
+ * @timeout: timeout value in jiffies or zero to return immediately, shared
+ * by all objects
+ *
+ * Like dma_resv_wait_timeout() for each of @objs, with a single timeout for
+ * all of them. Objects whose fences are all flagged as signaled already, the
+ * common case when committing many buffers at once, are skipped without
+ * taking any fence reference.
+ *
+ * Callers are not required to hold specific locks, but maybe hold
+ * dma_resv_lock() already
+ * RETURNS
+ * Returns -ERESTARTSYS if interrupted, 0 if the wait timed out, or
+ * greater than zero on success.
+ */
+long dma_resv_wait_timeout_many(struct dma_resv **objs, unsigned int count,
+				enum dma_resv_usage usage, bool intr,
+				unsigned long timeout)
+{
+	long ret = timeout ? timeout : 1;
+	unsigned int i;
+
+	for (i = 0; i < count; ++i) {
+		ret = dma_resv_wait_timeout(objs[i], usage, intr, timeout);
+		if (ret <= 0)
+			break;
+
+		/* Even for zero timeout the return value is 1 */
+		if (timeout)
+			timeout = ret;
+	}
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(dma_resv_wait_timeout_many);
+
 /**
  * dma_resv_set_deadline - Set a deadline on reservation's objects fences
  * @obj: the reservation object
@@ -740,6 +872,9 @@ bool dma_resv_test_signaled(struct dma_resv *obj, enum dma_resv_usage usage)
 	struct dma_resv_iter cursor;
 	struct dma_fence *fence;
 
+	if (dma_resv_signaled_flag_unlocked(obj, usage))
+		return true;
+
 	dma_resv_iter_begin(&cursor, obj, usage);
 	dma_resv_for_each_fence_unlocked(&cursor, fence) {
 		dma_resv_iter_end(&cursor);
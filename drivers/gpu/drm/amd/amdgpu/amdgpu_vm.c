@@ -30,6 +30,7 @@
 #include <linux/interval_tree_generic.h>
 #include <linux/idr.h>
 #include <linux/dma-buf.h>
+#include <linux/list_sort.h>
 
 #include <drm/amdgpu_drm.h>
 #include <drm/drm_drv.h>
@@ -1500,6 +1501,19 @@ static void amdgpu_vm_prt_fini(struct amdgpu_device *adev, struct amdgpu_vm *vm)
 	}
 }
 
+static int amdgpu_vm_mapping_cmp_start(void *priv, const struct list_head *a,
+				       const struct list_head *b)
+{
+	struct amdgpu_bo_va_mapping *ma, *mb;
+
+	ma = list_entry(a, struct amdgpu_bo_va_mapping, list);
+	mb = list_entry(b, struct amdgpu_bo_va_mapping, list);
+
+	if (ma->start < mb->start)
+		return -1;
+	return ma->start > mb->start;
+}
+
 /**
  * amdgpu_vm_clear_freed - clear freed BOs in the PT
  *
@@ -1519,7 +1533,7 @@ int amdgpu_vm_clear_freed(struct amdgpu_device *adev,
 			  struct amdgpu_vm *vm,
 			  struct dma_fence **fence)
 {
-	struct amdgpu_bo_va_mapping *mapping;
+	struct amdgpu_bo_va_mapping *mapping, *tmp;
 	struct dma_fence *f = NULL;
 	struct amdgpu_sync sync;
 	int r;
@@ -1535,15 +1549,35 @@ int amdgpu_vm_clear_freed(struct amdgpu_device *adev,
 	if (r)
 		goto error_free;
 
+	/*
+	 * Sparse binding unmaps many small neighbouring ranges at once. Clear
+	 * each run of adjacent or overlapping freed ranges with one update,
+	 * which needs one job instead of one per range and can use larger
+	 * fragments.
+	 */
+	list_sort(NULL, &vm->freed, amdgpu_vm_mapping_cmp_start);
 	while (!list_empty(&vm->freed)) {
+		LIST_HEAD(batch);
+		uint64_t start, last;
+
 		mapping = list_first_entry(&vm->freed,
 			struct amdgpu_bo_va_mapping, list);
-		list_del(&mapping->list);
+		start = mapping->start;
+		last = mapping->last;
+		do {
+			list_move_tail(&mapping->list, &batch);
+			last = max(last, mapping->last);
+			mapping = list_first_entry_or_null(&vm->freed,
+				struct amdgpu_bo_va_mapping, list);
+		} while (mapping && mapping->start <= last + 1);
 
 		r = amdgpu_vm_update_range(adev, vm, false, false, true, false,
-					   &sync, mapping->start, mapping->last,
+					   &sync, start, last,
 					   0, 0, 0, NULL, NULL, &f);
-		amdgpu_vm_free_mapping(adev, vm, mapping, f);
+		list_for_each_entry_safe(mapping, tmp, &batch, list) {
+			list_del(&mapping->list);
+			amdgpu_vm_free_mapping(adev, vm, mapping, f);
+		}
 		if (r) {
 			dma_fence_put(f);
 			goto error_free;
@@ -1119,7 +1119,7 @@ int drm_atomic_helper_check(struct drm_device *dev,
 	if (ret)
 		return ret;
 
-	if (state->legacy_cursor_update)
+	if (state->legacy_cursor_update || state->async_plane_update)
 		state->async_update = !drm_atomic_helper_async_check(dev, state);
 
 	drm_self_refresh_helper_alter_state(state);
@@ -2052,6 +2052,18 @@ int drm_atomic_helper_commit(struct drm_device *dev,
 		if (ret)
 			return ret;
 
+		/*
+		 * Unlike cursors, overlays are usually rendered by the GPU, so
+		 * wait for the implicit fences prepare_fb() may have set.
+		 */
+		if (state->async_plane_update) {
+			ret = drm_atomic_helper_wait_for_fences(dev, state, true);
+			if (ret) {
+				drm_atomic_helper_unprepare_planes(dev, state);
+				return ret;
+			}
+		}
+
 		drm_atomic_helper_async_commit(dev, state);
 		drm_atomic_helper_unprepare_planes(dev, state);
 
@@ -3222,6 +3234,8 @@ int drm_atomic_helper_update_plane(struct drm_plane *plane,
 
 	if (plane == crtc->cursor)
 		state->legacy_cursor_update = true;
+	else if (plane->dev->mode_config.async_plane_update)
+		state->async_plane_update = true;
 
 	ret = drm_atomic_commit(state);
 fail:
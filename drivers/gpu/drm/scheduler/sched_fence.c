@@ -178,6 +178,9 @@ static void drm_sched_fence_set_deadline_finished(struct dma_fence *f,
 	parent = smp_load_acquire(&fence->parent);
 	if (parent)
 		dma_fence_set_deadline(parent, deadline);
+	else if (drm_sched_policy == DRM_SCHED_POLICY_DEADLINE)
+		/* The job may run earlier now, let the scheduler re-pick */
+		drm_sched_wakeup(fence->sched);
 }
 
 static const struct dma_fence_ops drm_sched_fence_ops_scheduled = {
@@ -4,11 +4,12 @@
 #define _DRM_GPU_SCHEDULER_INTERNAL_H_
 
 
-/* Used to choose between FIFO and RR job-scheduling */
+/* Used to choose between FIFO, RR and deadline job-scheduling */
 extern int drm_sched_policy;
 
-#define DRM_SCHED_POLICY_RR    0
-#define DRM_SCHED_POLICY_FIFO  1
+#define DRM_SCHED_POLICY_RR       0
+#define DRM_SCHED_POLICY_FIFO     1
+#define DRM_SCHED_POLICY_DEADLINE 2
 
 void drm_sched_wakeup(struct drm_gpu_scheduler *sched);
 
@@ -27,7 +27,8 @@
  * The GPU scheduler provides entities which allow userspace to push jobs
  * into software queues which are then scheduled on a hardware run queue.
  * The software queues have a priority among them. The scheduler selects the entities
- * from the run queue using a FIFO. The scheduler provides dependency handling
+ * from the run queue using a FIFO, round robin or the earliest deadline of their
+ * next job, see the sched_policy parameter. The scheduler provides dependency handling
  * features among jobs. The driver is supposed to provide callback functions for
  * backend operations to the scheduler like submitting a job to hardware run queue,
  * returning the dependencies of a job etc.
@@ -95,9 +96,20 @@ int drm_sched_policy = DRM_SCHED_POLICY_FIFO;
  * DOC: sched_policy (int)
  * Used to override default entities scheduling policy in a run queue.
  */
-MODULE_PARM_DESC(sched_policy, "Specify the scheduling policy for entities on a run-queue, " __stringify(DRM_SCHED_POLICY_RR) " = Round Robin, " __stringify(DRM_SCHED_POLICY_FIFO) " = FIFO (default).");
+MODULE_PARM_DESC(sched_policy, "Specify the scheduling policy for entities on a run-queue, " __stringify(DRM_SCHED_POLICY_RR) " = Round Robin, " __stringify(DRM_SCHED_POLICY_FIFO) " = FIFO (default), " __stringify(DRM_SCHED_POLICY_DEADLINE) " = Earliest deadline.");
 module_param_named(sched_policy, drm_sched_policy, int, 0444);
 
+static unsigned int drm_sched_deadline_guard_ms = 50;
+
+/**
+ * DOC: sched_deadline_guard_ms (uint)
+ * Used by the deadline policy as the deadline of jobs without a deadline
+ * hint, relative to their submission. It also caps the hinted deadlines, so
+ * that no ready job waits much longer than this behind jobs with deadlines.
+ */
+MODULE_PARM_DESC(sched_deadline_guard_ms, "Implicit deadline of jobs after their submission for the deadline policy, in ms (default 50).");
+module_param_named(sched_deadline_guard_ms, drm_sched_deadline_guard_ms, uint, 0644);
+
 static u32 drm_sched_available_credits(struct drm_gpu_scheduler *sched)
 {
 	u32 credits;
@@ -351,6 +363,77 @@ drm_sched_rq_select_entity_fifo(struct drm_gpu_scheduler *sched,
 	return rb ? rb_entry(rb, struct drm_sched_entity, rb_tree_node) : NULL;
 }
 
+/*
+ * The deadline of a job is the earliest deadline hint set on its finished
+ * fence, capped by the starvation guard.
+ */
+static ktime_t drm_sched_job_deadline(struct drm_sched_job *s_job)
+{
+	struct drm_sched_fence *s_fence = s_job->s_fence;
+	ktime_t deadline;
+
+	deadline = ktime_add_ms(s_job->submit_ts,
+				READ_ONCE(drm_sched_deadline_guard_ms));
+	if (test_bit(DRM_SCHED_FENCE_FLAG_HAS_DEADLINE_BIT,
+		     &s_fence->finished.flags) &&
+	    ktime_before(READ_ONCE(s_fence->deadline), deadline))
+		deadline = READ_ONCE(s_fence->deadline);
+
+	return deadline;
+}
+
+/**
+ * drm_sched_rq_select_entity_deadline - Select an entity which provides a job to run
+ *
+ * @sched: the gpu scheduler
+ * @rq: scheduler run queue to check.
+ *
+ * Find the ready entity whose next job has the earliest deadline. The
+ * deadlines can change at any time through dma_fence_set_deadline(), so they
+ * are compared at selection time instead of being kept in the rb tree.
+ *
+ * Return an entity if one is found; return an error-pointer (!NULL) if an
+ * entity was ready, but the scheduler had insufficient credits to accommodate
+ * its job; return NULL, if no ready entity was found.
+ */
+static struct drm_sched_entity *
+drm_sched_rq_select_entity_deadline(struct drm_gpu_scheduler *sched,
+				    struct drm_sched_rq *rq)
+{
+	struct drm_sched_entity *entity, *best = NULL;
+	ktime_t best_deadline = KTIME_MAX;
+
+	spin_lock(&rq->lock);
+	list_for_each_entry(entity, &rq->entities, list) {
+		struct drm_sched_job *s_job;
+		ktime_t deadline;
+
+		if (!drm_sched_entity_is_ready(entity))
+			continue;
+
+		s_job = drm_sched_entity_queue_peek(entity);
+		deadline = drm_sched_job_deadline(s_job);
+		if (!best || ktime_before(deadline, best_deadline)) {
+			best = entity;
+			best_deadline = deadline;
+		}
+	}
+
+	if (best) {
+		/* Wait for credits rather than running a later deadline. */
+		if (!drm_sched_can_queue(sched, best)) {
+			spin_unlock(&rq->lock);
+			return ERR_PTR(-ENOSPC);
+		}
+
+		rq->current_entity = best;
+		reinit_completion(&best->entity_idle);
+	}
+	spin_unlock(&rq->lock);
+
+	return best;
+}
+
 /**
  * drm_sched_run_job_queue - enqueue run-job work
  * @sched: scheduler instance
@@ -1077,9 +1160,17 @@ drm_sched_select_entity(struct drm_gpu_scheduler *sched)
 	/* Start with the highest priority.
 	 */
 	for (i = DRM_SCHED_PRIORITY_KERNEL; i < sched->num_rqs; i++) {
-		entity = drm_sched_policy == DRM_SCHED_POLICY_FIFO ?
-			drm_sched_rq_select_entity_fifo(sched, sched->sched_rq[i]) :
-			drm_sched_rq_select_entity_rr(sched, sched->sched_rq[i]);
+		switch (drm_sched_policy) {
+		case DRM_SCHED_POLICY_FIFO:
+			entity = drm_sched_rq_select_entity_fifo(sched, sched->sched_rq[i]);
+			break;
+		case DRM_SCHED_POLICY_DEADLINE:
+			entity = drm_sched_rq_select_entity_deadline(sched, sched->sched_rq[i]);
+			break;
+		default:
+			entity = drm_sched_rq_select_entity_rr(sched, sched->sched_rq[i]);
+			break;
+		}
 		if (entity)
 			break;
 	}
@@ -1187,41 +1278,25 @@ static void drm_sched_free_job_work(struct work_struct *w)
 	drm_sched_run_job_queue(sched);
 }
 
-/**
- * drm_sched_run_job_work - worker to call run_job
- *
- * @w: run job work
+/*
+ * Maximum number of jobs run_job work takes from one entity before selecting
+ * again, which bounds how long a batch delays other entities.
  */
-static void drm_sched_run_job_work(struct work_struct *w)
+#define DRM_SCHED_RUN_JOB_BATCH	8
+
+static void drm_sched_run_job(struct drm_gpu_scheduler *sched,
+			      struct drm_sched_entity *entity,
+			      struct drm_sched_job *sched_job)
 {
-	struct drm_gpu_scheduler *sched =
-		container_of(w, struct drm_gpu_scheduler, work_run_job);
-	struct drm_sched_entity *entity;
+	struct drm_sched_fence *s_fence = sched_job->s_fence;
 	struct dma_fence *fence;
-	struct drm_sched_fence *s_fence;
-	struct drm_sched_job *sched_job;
 	int r;
 
-	/* Find entity with a ready job */
-	entity = drm_sched_select_entity(sched);
-	if (!entity)
-		return;	/* No more work */
-
-	sched_job = drm_sched_entity_pop_job(entity);
-	if (!sched_job) {
-		complete_all(&entity->entity_idle);
-		drm_sched_run_job_queue(sched);
-		return;
-	}
-
-	s_fence = sched_job->s_fence;
-
 	atomic_add(sched_job->credits, &sched->credit_count);
 	drm_sched_job_begin(sched_job);
 
 	trace_drm_run_job(sched_job, entity);
 	fence = sched->ops->run_job(sched_job);
-	complete_all(&entity->entity_idle);
 	drm_sched_fence_scheduled(s_fence, fence);
 
 	if (!IS_ERR_OR_NULL(fence)) {
@@ -1238,8 +1313,57 @@ static void drm_sched_run_job_work(struct work_struct *w)
 		drm_sched_job_done(sched_job, IS_ERR(fence) ?
 				   PTR_ERR(fence) : 0);
 	}
+}
+
+/*
+ * Whether run_job work can take the next job of @entity without selecting
+ * again. drm_sched_entity_pop_job() still returns NULL if the job has
+ * dependencies that are not signaled yet.
+ */
+static bool drm_sched_entity_batch_next(struct drm_gpu_scheduler *sched,
+					struct drm_sched_entity *entity)
+{
+	if (READ_ONCE(sched->pause_submit) || READ_ONCE(entity->stopped))
+		return false;
+
+	return drm_sched_entity_is_ready(entity) &&
+	       drm_sched_can_queue(sched, entity);
+}
+
+/**
+ * drm_sched_run_job_work - worker to call run_job
+ *
+ * @w: run job work
+ *
+ * Runs up to %DRM_SCHED_RUN_JOB_BATCH ready jobs of the selected entity, so
+ * that many small submissions to one entity don't cost a work item each.
+ */
+static void drm_sched_run_job_work(struct work_struct *w)
+{
+	struct drm_gpu_scheduler *sched =
+		container_of(w, struct drm_gpu_scheduler, work_run_job);
+	struct drm_sched_entity *entity;
+	struct drm_sched_job *sched_job;
+	unsigned int count = 0;
+
+	/* Find entity with a ready job */
+	entity = drm_sched_select_entity(sched);
+	if (!entity)
+		return;	/* No more work */
+
+	do {
+		sched_job = drm_sched_entity_pop_job(entity);
+		if (!sched_job)
+			break;
+
+		drm_sched_run_job(sched, entity, sched_job);
+	} while (++count < DRM_SCHED_RUN_JOB_BATCH &&
+		 drm_sched_entity_batch_next(sched, entity));
+
+	complete_all(&entity->entity_idle);
 
-	wake_up(&sched->job_scheduled);
+	if (count)
+		wake_up(&sched->job_scheduled);
 	drm_sched_run_job_queue(sched);
 }
 
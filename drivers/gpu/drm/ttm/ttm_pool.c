@@ -271,10 +271,9 @@ static void ttm_pool_unmap(struct ttm_pool *pool, dma_addr_t dma_addr,
 		       DMA_BIDIRECTIONAL);
 }
 
-/* Give pages into a specific pool_type */
-static void ttm_pool_type_give(struct ttm_pool_type *pt, struct page *p)
+static void ttm_pool_clear_pages(struct page *p, unsigned int order)
 {
-	unsigned int i, num_pages = 1 << pt->order;
+	unsigned int i, num_pages = 1 << order;
 
 	for (i = 0; i < num_pages; ++i) {
 		if (PageHighMem(p))
@@ -282,11 +281,79 @@ static void ttm_pool_type_give(struct ttm_pool_type *pt, struct page *p)
 		else
 			clear_page(page_address(p + i));
 	}
+}
 
+static void ttm_pool_type_add(struct ttm_pool_type *pt, struct page *p)
+{
 	spin_lock(&pt->lock);
 	list_add(&p->lru, &pt->pages);
 	spin_unlock(&pt->lock);
+}
+
+/* Pages given back to a pool_type, waiting to be cleared in the background */
+struct ttm_pool_clear {
+	struct list_head entry;
+	struct ttm_pool_type *pt;
+	struct page *p;
+};
+
+static LIST_HEAD(ttm_pool_clear_list);
+static DEFINE_SPINLOCK(ttm_pool_clear_lock);
+
+static struct ttm_pool_clear *ttm_pool_clear_pop(void)
+{
+	struct ttm_pool_clear *clear;
+
+	spin_lock(&ttm_pool_clear_lock);
+	clear = list_first_entry_or_null(&ttm_pool_clear_list,
+					 typeof(*clear), entry);
+	if (clear)
+		list_del(&clear->entry);
+	spin_unlock(&ttm_pool_clear_lock);
+
+	return clear;
+}
+
+static void ttm_pool_clear_work_fn(struct work_struct *work)
+{
+	struct ttm_pool_clear *clear;
+
+	while ((clear = ttm_pool_clear_pop())) {
+		ttm_pool_clear_pages(clear->p, clear->pt->order);
+		ttm_pool_type_add(clear->pt, clear->p);
+		kfree(clear);
+		cond_resched();
+	}
+}
+
+static DECLARE_WORK(ttm_pool_clear_work, ttm_pool_clear_work_fn);
+
+/*
+ * Give pages into a specific pool_type. Pages given back are cleared before
+ * they are reused, which is done by a worker to keep clear_page() out of
+ * both the freeing and the next allocating thread. They are accounted in
+ * allocated_pages right away, and ttm_pool_shrink() frees the pending ones
+ * first, so the pool size limit and the shrinker see them too.
+ */
+static void ttm_pool_type_give(struct ttm_pool_type *pt, struct page *p)
+{
+	struct ttm_pool_clear *clear;
+
 	atomic_long_add(1 << pt->order, &allocated_pages);
+
+	clear = kmalloc(sizeof(*clear), GFP_NOWAIT | __GFP_NOWARN);
+	if (!clear) {
+		ttm_pool_clear_pages(p, pt->order);
+		ttm_pool_type_add(pt, p);
+		return;
+	}
+
+	clear->pt = pt;
+	clear->p = p;
+	spin_lock(&ttm_pool_clear_lock);
+	list_add_tail(&clear->entry, &ttm_pool_clear_list);
+	spin_unlock(&ttm_pool_clear_lock);
+	queue_work(system_unbound_wq, &ttm_pool_clear_work);
 }
 
 /* Take pages from a specific pool_type, return NULL when nothing available */
@@ -329,6 +396,9 @@ static void ttm_pool_type_fini(struct ttm_pool_type *pt)
 	list_del(&pt->shrinker_list);
 	spin_unlock(&shrinker_lock);
 
+	/* Wait for the pages still being cleared to be added back */
+	flush_work(&ttm_pool_clear_work);
+
 	while ((p = ttm_pool_type_take(pt)))
 		ttm_pool_free_page(pt->pool, pt->caching, pt->order, p);
 }
@@ -370,11 +440,25 @@ static struct ttm_pool_type *ttm_pool_select_type(struct ttm_pool *pool,
 /* Free pages using the global shrinker list */
 static unsigned int ttm_pool_shrink(void)
 {
+	struct ttm_pool_clear *clear;
 	struct ttm_pool_type *pt;
 	unsigned int num_pages;
 	struct page *p;
 
 	down_read(&pool_shrink_rwsem);
+
+	/* Pages not cleared yet are the cheapest to give back */
+	clear = ttm_pool_clear_pop();
+	if (clear) {
+		pt = clear->pt;
+		ttm_pool_free_page(pt->pool, pt->caching, pt->order, clear->p);
+		num_pages = 1 << pt->order;
+		atomic_long_sub(num_pages, &allocated_pages);
+		kfree(clear);
+		up_read(&pool_shrink_rwsem);
+		return num_pages;
+	}
+
 	spin_lock(&shrinker_lock);
 	pt = list_first_entry(&shrinker_list, typeof(*pt), shrinker_list);
 	list_move_tail(&pt->shrinker_list, &shrinker_list);
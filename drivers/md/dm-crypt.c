@@ -142,7 +142,8 @@ struct iv_elephant_private {
 enum flags { DM_CRYPT_SUSPENDED, DM_CRYPT_KEY_VALID,
 	     DM_CRYPT_SAME_CPU, DM_CRYPT_HIGH_PRIORITY,
 	     DM_CRYPT_NO_OFFLOAD, DM_CRYPT_NO_READ_WORKQUEUE,
-	     DM_CRYPT_NO_WRITE_WORKQUEUE, DM_CRYPT_WRITE_INLINE };
+	     DM_CRYPT_NO_WRITE_WORKQUEUE, DM_CRYPT_WRITE_INLINE,
+	     DM_CRYPT_USE_WORKQUEUES };
 
 enum cipher_flags {
 	CRYPT_MODE_INTEGRITY_AEAD,	/* Use authenticated mode for cipher */
@@ -290,6 +291,18 @@ static struct crypto_aead *any_tfm_aead(struct crypt_config *cc)
 	return cc->cipher_tfm.tfms_aead[0];
 }
 
+static bool crypt_cipher_is_async(struct crypt_config *cc)
+{
+	u32 flags;
+
+	if (crypt_integrity_aead(cc))
+		flags = crypto_aead_alg(any_tfm_aead(cc))->base.cra_flags;
+	else
+		flags = crypto_skcipher_alg(any_tfm(cc))->base.cra_flags;
+
+	return flags & CRYPTO_ALG_ASYNC;
+}
+
 /*
  * Different IV generation algorithms:
  *
@@ -3133,7 +3146,7 @@ static int crypt_ctr_optional(struct dm_target *ti, unsigned int argc, char **ar
 	struct crypt_config *cc = ti->private;
 	struct dm_arg_set as;
 	static const struct dm_arg _args[] = {
-		{0, 9, "Invalid number of feature args"},
+		{0, 10, "Invalid number of feature args"},
 	};
 	unsigned int opt_params, val;
 	const char *opt_string, *sval;
@@ -3169,6 +3182,8 @@ static int crypt_ctr_optional(struct dm_target *ti, unsigned int argc, char **ar
 			set_bit(DM_CRYPT_NO_READ_WORKQUEUE, &cc->flags);
 		else if (!strcasecmp(opt_string, "no_write_workqueue"))
 			set_bit(DM_CRYPT_NO_WRITE_WORKQUEUE, &cc->flags);
+		else if (!strcasecmp(opt_string, "use_workqueues"))
+			set_bit(DM_CRYPT_USE_WORKQUEUES, &cc->flags);
 		else if (sscanf(opt_string, "integrity:%u:", &val) == 1) {
 			if (val == 0 || val > MAX_TAG_SIZE) {
 				ti->error = "Invalid integrity arguments";
@@ -3284,13 +3299,24 @@ static int crypt_ctr(struct dm_target *ti, unsigned int argc, char **argv)
 			goto bad;
 	}
 
-	set_bit(DM_CRYPT_NO_READ_WORKQUEUE, &cc->flags);
-	set_bit(DM_CRYPT_NO_WRITE_WORKQUEUE, &cc->flags);
-
 	ret = crypt_ctr_cipher(ti, argv[0], argv[1]);
 	if (ret < 0)
 		goto bad;
 
+	/*
+	 * A synchronous cipher (e.g. AES-NI) processes the bio in the
+	 * submitting or completion context faster than kcryptd can be woken
+	 * up to do it, so bypass the workqueues by default. Asynchronous
+	 * (offload) ciphers keep them unless asked otherwise, so that their
+	 * backlog waits don't stall completion processing. use_workqueues
+	 * keeps them for a synchronous cipher too.
+	 */
+	if (!crypt_cipher_is_async(cc) &&
+	    !test_bit(DM_CRYPT_USE_WORKQUEUES, &cc->flags)) {
+		set_bit(DM_CRYPT_NO_READ_WORKQUEUE, &cc->flags);
+		set_bit(DM_CRYPT_NO_WRITE_WORKQUEUE, &cc->flags);
+	}
+
 	if (crypt_integrity_aead(cc)) {
 		cc->dmreq_start = sizeof(struct aead_request);
 		cc->dmreq_start += crypto_aead_reqsize(any_tfm_aead(cc));
@@ -3584,6 +3610,7 @@ static void crypt_status(struct dm_target *ti, status_type_t type,
 		num_feature_args += test_bit(DM_CRYPT_NO_OFFLOAD, &cc->flags);
 		num_feature_args += test_bit(DM_CRYPT_NO_READ_WORKQUEUE, &cc->flags);
 		num_feature_args += test_bit(DM_CRYPT_NO_WRITE_WORKQUEUE, &cc->flags);
+		num_feature_args += test_bit(DM_CRYPT_USE_WORKQUEUES, &cc->flags);
 		num_feature_args += !!cc->used_tag_size;
 		num_feature_args += cc->sector_size != (1 << SECTOR_SHIFT);
 		num_feature_args += test_bit(CRYPT_IV_LARGE_SECTORS, &cc->cipher_flags);
@@ -3602,6 +3629,8 @@ static void crypt_status(struct dm_target *ti, status_type_t type,
 				DMEMIT(" no_read_workqueue");
 			if (test_bit(DM_CRYPT_NO_WRITE_WORKQUEUE, &cc->flags))
 				DMEMIT(" no_write_workqueue");
+			if (test_bit(DM_CRYPT_USE_WORKQUEUES, &cc->flags))
+				DMEMIT(" use_workqueues");
 			if (cc->used_tag_size)
 				DMEMIT(" integrity:%u:%s", cc->used_tag_size, cc->cipher_auth);
 			if (cc->sector_size != (1 << SECTOR_SHIFT))
@@ -3624,6 +3653,8 @@ static void crypt_status(struct dm_target *ti, status_type_t type,
 		       'y' : 'n');
 		DMEMIT(",no_write_workqueue=%c", test_bit(DM_CRYPT_NO_WRITE_WORKQUEUE, &cc->flags) ?
 		       'y' : 'n');
+		DMEMIT(",use_workqueues=%c", test_bit(DM_CRYPT_USE_WORKQUEUES, &cc->flags) ?
+		       'y' : 'n');
 		DMEMIT(",iv_large_sectors=%c", test_bit(CRYPT_IV_LARGE_SECTORS, &cc->cipher_flags) ?
 		       'y' : 'n');
 
@@ -3737,7 +3768,7 @@ static void crypt_io_hints(struct dm_target *ti, struct queue_limits *limits)
 
 static struct target_type crypt_target = {
 	.name   = "crypt",
-	.version = {1, 28, 0},
+	.version = {1, 29, 0},
 	.module = THIS_MODULE,
 	.ctr    = crypt_ctr,
 	.dtr    = crypt_dtr,
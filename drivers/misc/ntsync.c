@@ -15,7 +15,9 @@
 #include <linux/module.h>
 #include <linux/mutex.h>
 #include <linux/overflow.h>
+#include <linux/poll.h>
 #include <linux/sched.h>
+#include <linux/sched/clock.h>
 #include <linux/sched/signal.h>
 #include <linux/slab.h>
 #include <linux/spinlock.h>
@@ -23,6 +25,16 @@
 
 #define NTSYNC_NAME	"ntsync"
 
+/*
+ * Bounds on how long a waiter spins for its objects to be signaled before
+ * sleeping. Semaphores and mutexes are often released a moment later by a
+ * thread running on another CPU, and spinning for that long is cheaper than
+ * a sleep and a wakeup. The actual spin adapts to how long recent spins on
+ * the same objects took to succeed; see ntsync_spin().
+ */
+#define NTSYNC_SPIN_MIN_NS	(1 * NSEC_PER_USEC)
+#define NTSYNC_SPIN_MAX_NS	(10 * NSEC_PER_USEC)
+
 enum ntsync_type {
 	NTSYNC_TYPE_SEM,
 	NTSYNC_TYPE_MUTEX,
@@ -75,6 +87,15 @@ struct ntsync_obj {
 	struct list_head any_waiters;
 	struct list_head all_waiters;
 
+	/* Woken whenever the object may have become signaled, for poll() */
+	wait_queue_head_t poll_wq;
+
+	/*
+	 * Running average of how long a successful spin on this object took,
+	 * used to size the next spin. Updated racily; it is only a hint.
+	 */
+	unsigned int spin_ns;
+
 	/*
 	 * Hint describing how many tasks are queued on this object in a
 	 * wait-all operation.
@@ -316,6 +337,14 @@ static void try_wake_all_obj(struct ntsync_device *dev, struct ntsync_obj *obj)
 		try_wake_all(dev, entry->q, obj);
 }
 
+static void ntsync_wake_poll(struct ntsync_obj *obj)
+{
+	ntsync_assert_held(obj);
+
+	if (wq_has_sleeper(&obj->poll_wq) && is_signaled(obj, 0))
+		wake_up_interruptible_poll(&obj->poll_wq, EPOLLIN | EPOLLRDNORM);
+}
+
 static void try_wake_any_sem(struct ntsync_obj *sem)
 {
 	struct ntsync_q_entry *entry;
@@ -335,6 +364,8 @@ static void try_wake_any_sem(struct ntsync_obj *sem)
 			wake_up_process(q->task);
 		}
 	}
+
+	ntsync_wake_poll(sem);
 }
 
 static void try_wake_any_mutex(struct ntsync_obj *mutex)
@@ -362,6 +393,8 @@ static void try_wake_any_mutex(struct ntsync_obj *mutex)
 			wake_up_process(q->task);
 		}
 	}
+
+	ntsync_wake_poll(mutex);
 }
 
 static void try_wake_any_event(struct ntsync_obj *event)
@@ -384,6 +417,8 @@ static void try_wake_any_event(struct ntsync_obj *event)
 			wake_up_process(q->task);
 		}
 	}
+
+	ntsync_wake_poll(event);
 }
 
 /*
@@ -693,9 +728,32 @@ static long ntsync_obj_ioctl(struct file *file, unsigned int cmd,
 	}
 }
 
+/*
+ * An object is readable when a wait on it by a thread that does not own it
+ * would be satisfied. This only reports readiness, the object still has to be
+ * acquired with a wait.
+ */
+static __poll_t ntsync_obj_poll(struct file *file, poll_table *wait)
+{
+	struct ntsync_obj *obj = file->private_data;
+	struct ntsync_device *dev = obj->dev;
+	__poll_t mask = 0;
+	bool all;
+
+	poll_wait(file, &obj->poll_wq, wait);
+
+	all = ntsync_lock_obj(dev, obj);
+	if (is_signaled(obj, 0))
+		mask = EPOLLIN | EPOLLRDNORM;
+	ntsync_unlock_obj(dev, obj, all);
+
+	return mask;
+}
+
 static const struct file_operations ntsync_obj_fops = {
 	.owner		= THIS_MODULE,
 	.release	= ntsync_obj_release,
+	.poll		= ntsync_obj_poll,
 	.unlocked_ioctl	= ntsync_obj_ioctl,
 	.compat_ioctl	= compat_ptr_ioctl,
 };
@@ -714,6 +772,7 @@ static struct ntsync_obj *ntsync_alloc_obj(struct ntsync_device *dev,
 	spin_lock_init(&obj->lock);
 	INIT_LIST_HEAD(&obj->any_waiters);
 	INIT_LIST_HEAD(&obj->all_waiters);
+	init_waitqueue_head(&obj->poll_wq);
 	atomic_set(&obj->all_hint, 0);
 
 	return obj;
@@ -834,6 +893,80 @@ static void put_obj(struct ntsync_obj *obj)
 	fput(obj->file);
 }
 
+static u64 ntsync_spin_budget(const struct ntsync_q *q)
+{
+	u64 budget = 0;
+	__u32 i;
+
+	/*
+	 * Only spin on wait-any for semaphores and mutexes. Those are usually
+	 * held for a short time, whereas events are signaled at an arbitrary
+	 * later point, and a wait-all needs every object at once.
+	 */
+	if (q->all)
+		return 0;
+
+	for (i = 0; i < q->count; i++) {
+		const struct ntsync_obj *obj = q->entries[i].obj;
+
+		if (obj->type == NTSYNC_TYPE_EVENT)
+			return 0;
+		budget = max_t(u64, budget, 2ULL * READ_ONCE(obj->spin_ns));
+	}
+
+	return min_t(u64, budget + NTSYNC_SPIN_MIN_NS, NTSYNC_SPIN_MAX_NS);
+}
+
+static void ntsync_spin(const struct ntsync_q *q, const ktime_t *timeout,
+			clockid_t clock)
+{
+	u64 budget, start, now;
+	int signaled = -1;
+	__u32 i;
+
+	if (num_online_cpus() == 1)
+		return;
+
+	budget = ntsync_spin_budget(q);
+	if (!budget)
+		return;
+
+	/* Don't delay polls, which pass a timeout that already expired */
+	if (timeout && ktime_compare(*timeout, clock == CLOCK_REALTIME ?
+				     ktime_get_real() : ktime_get()) <= 0)
+		return;
+
+	start = now = local_clock();
+	while ((signaled = atomic_read(&q->signaled)) == -1) {
+		if (need_resched() || signal_pending(current))
+			return;
+		if (now - start >= budget)
+			break;
+		cpu_relax();
+		now = local_clock();
+	}
+
+	if (signaled >= 0 && (__u32)signaled < q->count) {
+		struct ntsync_obj *obj = q->entries[signaled].obj;
+		int avg = READ_ONCE(obj->spin_ns);
+		int spun = min_t(u64, now - start, NTSYNC_SPIN_MAX_NS);
+
+		/* Move the average an eighth of the way towards this spin */
+		WRITE_ONCE(obj->spin_ns, avg + (spun - avg) / 8);
+	} else if (signaled == -1) {
+		/*
+		 * The spin timed out, so the objects are held for longer than
+		 * we are willing to spin. Back off, down to the minimum spin.
+		 */
+		for (i = 0; i < q->count; i++) {
+			struct ntsync_obj *obj = q->entries[i].obj;
+			unsigned int avg = READ_ONCE(obj->spin_ns);
+
+			WRITE_ONCE(obj->spin_ns, avg - avg / 4);
+		}
+	}
+}
+
 static int ntsync_schedule(const struct ntsync_q *q, const struct ntsync_wait_args *args)
 {
 	ktime_t timeout = ns_to_ktime(args->timeout);
@@ -846,6 +979,8 @@ static int ntsync_schedule(const struct ntsync_q *q, const struct ntsync_wait_ar
 	if (args->flags & NTSYNC_WAIT_REALTIME)
 		clock = CLOCK_REALTIME;
 
+	ntsync_spin(q, timeout_ptr, clock);
+
 	do {
 		if (signal_pending(current)) {
 			ret = -ERESTARTSYS;
@@ -1150,6 +1285,138 @@ static int ntsync_wait_all(struct ntsync_device *dev, void __user *argp)
 	return ret;
 }
 
+struct ntsync_signal_entry {
+	struct ntsync_signal_op op;
+	struct ntsync_obj *obj;
+	/* State before the operation, to undo the batch on failure */
+	typeof_member(struct ntsync_obj, u) saved;
+};
+
+/*
+ * Actually change the state of an object for one operation of a signal batch.
+ */
+static int signal_op_state(struct ntsync_obj *obj, struct ntsync_signal_op *op)
+{
+	struct ntsync_mutex_args mutex_args;
+
+	switch (op->op) {
+	case NTSYNC_SIGNAL_SEM_RELEASE:
+		if (obj->type != NTSYNC_TYPE_SEM)
+			return -EINVAL;
+		op->prev = obj->u.sem.count;
+		return release_sem_state(obj, op->value);
+	case NTSYNC_SIGNAL_MUTEX_UNLOCK:
+		if (obj->type != NTSYNC_TYPE_MUTEX || !op->value)
+			return -EINVAL;
+		op->prev = obj->u.mutex.count;
+		mutex_args.owner = op->value;
+		return unlock_mutex_state(obj, &mutex_args);
+	case NTSYNC_SIGNAL_EVENT_SET:
+	case NTSYNC_SIGNAL_EVENT_PULSE:
+		if (obj->type != NTSYNC_TYPE_EVENT)
+			return -EINVAL;
+		op->prev = obj->u.event.signaled;
+		obj->u.event.signaled = true;
+		return 0;
+	}
+
+	return -EINVAL;
+}
+
+/*
+ * Apply several semaphore releases, mutex unlocks and event sets in one call.
+ * The state changes are atomic: all objects are locked through the
+ * wait_all_lock while they are applied, and any failure undoes the whole
+ * batch. Waiters are then woken object by object, as the single object
+ * ioctls do.
+ */
+static int ntsync_signal(struct ntsync_device *dev, void __user *argp)
+{
+	struct ntsync_signal_op __user *user_ops;
+	struct ntsync_signal_entry *entries;
+	struct ntsync_signal_args args;
+	__u32 i, count = 0;
+	int ret = 0;
+
+	if (copy_from_user(&args, argp, sizeof(args)))
+		return -EFAULT;
+
+	if (!args.count || args.count > NTSYNC_MAX_SIGNAL_COUNT || args.pad)
+		return -EINVAL;
+
+	entries = kmalloc_array(args.count, sizeof(*entries), GFP_KERNEL);
+	if (!entries)
+		return -ENOMEM;
+
+	user_ops = u64_to_user_ptr(args.ops);
+	for (count = 0; count < args.count; count++) {
+		struct ntsync_signal_entry *entry = &entries[count];
+
+		if (copy_from_user(&entry->op, &user_ops[count],
+				   sizeof(entry->op))) {
+			ret = -EFAULT;
+			goto out;
+		}
+
+		entry->obj = get_obj(dev, entry->op.obj);
+		if (!entry->obj) {
+			ret = -EINVAL;
+			goto out;
+		}
+	}
+
+	/*
+	 * Locking an object twice is fine here, dev_locked is only a flag and
+	 * nobody else can change it while we hold the wait_all_lock.
+	 */
+	mutex_lock(&dev->wait_all_lock);
+
+	for (i = 0; i < count; i++)
+		dev_lock_obj(dev, entries[i].obj);
+
+	for (i = 0; i < count; i++) {
+		entries[i].saved = entries[i].obj->u;
+		ret = signal_op_state(entries[i].obj, &entries[i].op);
+		if (ret) {
+			while (i--)
+				entries[i].obj->u = entries[i].saved;
+			break;
+		}
+	}
+
+	for (i = 0; i < count; i++)
+		dev_unlock_obj(dev, entries[i].obj);
+
+	mutex_unlock(&dev->wait_all_lock);
+
+	if (ret)
+		goto out;
+
+	for (i = 0; i < count; i++) {
+		struct ntsync_obj *obj = entries[i].obj;
+		bool all;
+
+		all = ntsync_lock_obj(dev, obj);
+		if (all)
+			try_wake_all_obj(dev, obj);
+		try_wake_any_obj(obj);
+		if (entries[i].op.op == NTSYNC_SIGNAL_EVENT_PULSE)
+			obj->u.event.signaled = false;
+		ntsync_unlock_obj(dev, obj, all);
+	}
+
+	for (i = 0; i < count; i++) {
+		if (put_user(entries[i].op.prev, &user_ops[i].prev))
+			ret = -EFAULT;
+	}
+
+out:
+	while (count--)
+		put_obj(entries[count].obj);
+	kfree(entries);
+	return ret;
+}
+
 static int ntsync_char_open(struct inode *inode, struct file *file)
 {
 	struct ntsync_device *dev;
@@ -1187,6 +1454,8 @@ static long ntsync_char_ioctl(struct file *file, unsigned int cmd,
 		return ntsync_create_mutex(dev, argp);
 	case NTSYNC_IOC_CREATE_SEM:
 		return ntsync_create_sem(dev, argp);
+	case NTSYNC_IOC_SIGNAL:
+		return ntsync_signal(dev, argp);
 	case NTSYNC_IOC_WAIT_ALL:
 		return ntsync_wait_all(dev, argp);
 	case NTSYNC_IOC_WAIT_ANY:
@@ -61,7 +61,8 @@ static unsigned int sgl_threshold = SZ_32K;
 module_param(sgl_threshold, uint, 0644);
 MODULE_PARM_DESC(sgl_threshold,
 		"Use SGLs when average request segment size is larger or equal to "
-		"this size. Use 0 to disable SGLs.");
+		"this size, or when a large request has few segments. "
+		"Use 0 to disable SGLs.");
 
 #define NVME_PCI_MIN_QUEUE_SIZE 2
 #define NVME_PCI_MAX_QUEUE_SIZE 4095
@@ -101,6 +102,22 @@ static unsigned int poll_queues;
 module_param_cb(poll_queues, &io_queue_count_ops, &poll_queues, 0644);
 MODULE_PARM_DESC(poll_queues, "Number of queues to use for polled IO.");
 
+static unsigned int irq_coalesce_iops;
+module_param(irq_coalesce_iops, uint, 0644);
+MODULE_PARM_DESC(irq_coalesce_iops,
+	"Coalesce the interrupts of a queue completing more than this many "
+	"commands per second. Use 0 to disable interrupt coalescing.");
+
+static unsigned int irq_coalesce_time = 1;
+module_param(irq_coalesce_time, uint, 0644);
+MODULE_PARM_DESC(irq_coalesce_time,
+	"Interrupt coalescing aggregation time in 100us units (default 1)");
+
+static unsigned int irq_coalesce_thr = 8;
+module_param(irq_coalesce_thr, uint, 0644);
+MODULE_PARM_DESC(irq_coalesce_thr,
+	"Interrupt coalescing aggregation threshold in completions (default 8)");
+
 static bool noacpi;
 module_param(noacpi, bool, 0444);
 MODULE_PARM_DESC(noacpi, "disable acpi bios quirks");
@@ -108,6 +125,11 @@ MODULE_PARM_DESC(noacpi, "disable acpi bios quirks");
 struct nvme_dev;
 struct nvme_queue;
 
+struct nvme_descriptor_pools {
+	struct dma_pool *large;
+	struct dma_pool *small;
+};
+
 static void nvme_dev_disable(struct nvme_dev *dev, bool shutdown);
 static void nvme_delete_io_queues(struct nvme_dev *dev);
 static void nvme_update_attrs(struct nvme_dev *dev);
@@ -121,8 +143,6 @@ struct nvme_dev {
 	struct blk_mq_tag_set admin_tagset;
 	u32 __iomem *dbs;
 	struct device *dev;
-	struct dma_pool *prp_page_pool;
-	struct dma_pool *prp_small_pool;
 	unsigned online_queues;
 	unsigned max_qid;
 	unsigned io_queues[HCTX_MAX_TYPES];
@@ -162,6 +182,17 @@ struct nvme_dev {
 	unsigned int nr_allocated_queues;
 	unsigned int nr_write_queues;
 	unsigned int nr_poll_queues;
+	bool poll_queues_set;
+
+	/* dynamic interrupt coalescing: */
+	struct delayed_work coalesce_work;
+	unsigned int coalesce_cqes;
+	unsigned int coalesce_thr;
+	unsigned int coalesce_time;
+	bool coalesce_ready;
+
+	/* PRP list and SGL descriptor pools, one pair per NUMA node: */
+	struct nvme_descriptor_pools descriptor_pools[];
 };
 
 static int io_queue_depth_set(const char *val, const struct kernel_param *kp)
@@ -191,6 +222,7 @@ static inline struct nvme_dev *to_nvme_dev(struct nvme_ctrl *ctrl)
  */
 struct nvme_queue {
 	struct nvme_dev *dev;
+	struct nvme_descriptor_pools descriptor_pools;
 	spinlock_t sq_lock;
 	void *sq_cmds;
 	 /* only used for poll queues: */
@@ -203,10 +235,12 @@ struct nvme_queue {
 	u16 cq_vector;
 	u16 sq_tail;
 	u16 last_sq_tail;
+	u32 nr_sqes;
 	u16 cq_head;
 	u16 qid;
 	u8 cq_phase;
 	u8 sqes;
+	u32 nr_cqes;
 	unsigned long flags;
 #define NVMEQ_ENABLED		0
 #define NVMEQ_SQ_CMB		1
@@ -217,6 +251,10 @@ struct nvme_queue {
 	__le32 *dbbuf_sq_ei;
 	__le32 *dbbuf_cq_ei;
 	struct completion delete_done;
+	/* only used by nvme_coalesce_work(): */
+	u32 last_cqes;
+	u32 avg_depth;
+	bool coalesced;
 };
 
 union nvme_descriptor {
@@ -397,28 +435,90 @@ static __always_inline int nvme_pci_npages_prp(void)
 	return DIV_ROUND_UP(8 * nprps, NVME_CTRL_PAGE_SIZE - 8);
 }
 
+static struct nvme_descriptor_pools *
+nvme_setup_descriptor_pools(struct nvme_dev *dev, int numa_node)
+{
+	struct nvme_descriptor_pools *pools;
+	size_t small_align = 256;
+
+	if (numa_node == NUMA_NO_NODE)
+		numa_node = dev_to_node(dev->dev);
+	if (numa_node == NUMA_NO_NODE)
+		numa_node = 0;
+
+	pools = &dev->descriptor_pools[numa_node];
+	if (pools->small)
+		return pools; /* already initialized */
+
+	pools->large = dma_pool_create("nvme descriptor page", dev->dev,
+			NVME_CTRL_PAGE_SIZE, NVME_CTRL_PAGE_SIZE, 0);
+	if (!pools->large)
+		return ERR_PTR(-ENOMEM);
+
+	if (dev->ctrl.quirks & NVME_QUIRK_DMAPOOL_ALIGN_512)
+		small_align = 512;
+
+	/* Optimisation for I/Os between 4k and 128k */
+	pools->small = dma_pool_create("nvme descriptor 256", dev->dev,
+			256, small_align, 0);
+	if (!pools->small) {
+		dma_pool_destroy(pools->large);
+		pools->large = NULL;
+		return ERR_PTR(-ENOMEM);
+	}
+
+	return pools;
+}
+
+static void nvme_release_descriptor_pools(struct nvme_dev *dev)
+{
+	unsigned int i;
+
+	for (i = 0; i < nr_node_ids; i++) {
+		struct nvme_descriptor_pools *pools = &dev->descriptor_pools[i];
+
+		dma_pool_destroy(pools->large);
+		dma_pool_destroy(pools->small);
+	}
+}
+
+/*
+ * The descriptor pools are shared by all the queues whose hardware context is
+ * on the same node, so that the pool locks are not bounced between nodes on
+ * the submission and completion paths.
+ */
+static int nvme_init_hctx_common(struct blk_mq_hw_ctx *hctx,
+		struct nvme_queue *nvmeq)
+{
+	struct nvme_descriptor_pools *pools;
+
+	pools = nvme_setup_descriptor_pools(nvmeq->dev, hctx->numa_node);
+	if (IS_ERR(pools))
+		return PTR_ERR(pools);
+
+	nvmeq->descriptor_pools = *pools;
+	hctx->driver_data = nvmeq;
+	return 0;
+}
+
 static int nvme_admin_init_hctx(struct blk_mq_hw_ctx *hctx, void *data,
 				unsigned int hctx_idx)
 {
 	struct nvme_dev *dev = to_nvme_dev(data);
-	struct nvme_queue *nvmeq = &dev->queues[0];
 
 	WARN_ON(hctx_idx != 0);
 	WARN_ON(dev->admin_tagset.tags[0] != hctx->tags);
 
-	hctx->driver_data = nvmeq;
-	return 0;
+	return nvme_init_hctx_common(hctx, &dev->queues[0]);
 }
 
 static int nvme_init_hctx(struct blk_mq_hw_ctx *hctx, void *data,
 			  unsigned int hctx_idx)
 {
 	struct nvme_dev *dev = to_nvme_dev(data);
-	struct nvme_queue *nvmeq = &dev->queues[hctx_idx + 1];
 
 	WARN_ON(dev->tagset.tags[hctx_idx] != hctx->tags);
-	hctx->driver_data = nvmeq;
-	return 0;
+	return nvme_init_hctx_common(hctx, &dev->queues[hctx_idx + 1]);
 }
 
 static int nvme_pci_init_request(struct blk_mq_tag_set *set,
@@ -497,6 +597,7 @@ static inline void nvme_sq_copy_cmd(struct nvme_queue *nvmeq,
 		absolute_pointer(cmd), sizeof(*cmd));
 	if (++nvmeq->sq_tail == nvmeq->q_depth)
 		nvmeq->sq_tail = 0;
+	WRITE_ONCE(nvmeq->nr_sqes, nvmeq->nr_sqes + 1);
 }
 
 static void nvme_commit_rqs(struct blk_mq_hw_ctx *hctx)
@@ -532,12 +633,22 @@ static inline bool nvme_pci_use_sgls(struct nvme_dev *dev, struct request *req,
 		return false;
 	if (nvme_pci_metadata_use_sgls(dev, req))
 		return true;
-	if (!sgl_threshold || avg_seg_size < sgl_threshold)
+	if (!sgl_threshold)
+		return nvme_req(req)->flags & NVME_REQ_USERCMD;
+	/*
+	 * Large I/O made of a few segments needs a full page for the PRP list,
+	 * but its SGL still fits into a small descriptor.
+	 */
+	if (nseg <= 256 / sizeof(struct nvme_sgl_desc) &&
+	    DIV_ROUND_UP(blk_rq_payload_bytes(req), NVME_CTRL_PAGE_SIZE) >
+	    256 / 8)
+		return true;
+	if (avg_seg_size < sgl_threshold)
 		return nvme_req(req)->flags & NVME_REQ_USERCMD;
 	return true;
 }
 
-static void nvme_free_prps(struct nvme_dev *dev, struct request *req)
+static void nvme_free_prps(struct nvme_queue *nvmeq, struct request *req)
 {
 	const int last_prp = NVME_CTRL_PAGE_SIZE / sizeof(__le64) - 1;
 	struct nvme_iod *iod = blk_mq_rq_to_pdu(req);
@@ -548,13 +659,15 @@ static void nvme_free_prps(struct nvme_dev *dev, struct request *req)
 		__le64 *prp_list = iod->list[i].prp_list;
 		dma_addr_t next_dma_addr = le64_to_cpu(prp_list[last_prp]);
 
-		dma_pool_free(dev->prp_page_pool, prp_list, dma_addr);
+		dma_pool_free(nvmeq->descriptor_pools.large, prp_list,
+				dma_addr);
 		dma_addr = next_dma_addr;
 	}
 }
 
 static void nvme_unmap_data(struct nvme_dev *dev, struct request *req)
 {
+	struct nvme_queue *nvmeq = req->mq_hctx->driver_data;
 	struct nvme_iod *iod = blk_mq_rq_to_pdu(req);
 
 	if (iod->dma_len) {
@@ -568,13 +681,13 @@ static void nvme_unmap_data(struct nvme_dev *dev, struct request *req)
 	dma_unmap_sgtable(dev->dev, &iod->sgt, rq_dma_dir(req), 0);
 
 	if (iod->nr_allocations == 0)
-		dma_pool_free(dev->prp_small_pool, iod->list[0].sg_list,
-			      iod->first_dma);
+		dma_pool_free(nvmeq->descriptor_pools.small,
+			      iod->list[0].sg_list, iod->first_dma);
 	else if (iod->nr_allocations == 1)
-		dma_pool_free(dev->prp_page_pool, iod->list[0].sg_list,
-			      iod->first_dma);
+		dma_pool_free(nvmeq->descriptor_pools.large,
+			      iod->list[0].sg_list, iod->first_dma);
 	else
-		nvme_free_prps(dev, req);
+		nvme_free_prps(nvmeq, req);
 	mempool_free(iod->sgt.sgl, dev->iod_mempool);
 }
 
@@ -595,6 +708,7 @@ static void nvme_print_sgl(struct scatterlist *sgl, int nents)
 static blk_status_t nvme_pci_setup_prps(struct nvme_dev *dev,
 		struct request *req, struct nvme_rw_command *cmnd)
 {
+	struct nvme_queue *nvmeq = req->mq_hctx->driver_data;
 	struct nvme_iod *iod = blk_mq_rq_to_pdu(req);
 	struct dma_pool *pool;
 	int length = blk_rq_payload_bytes(req);
@@ -628,10 +742,10 @@ static blk_status_t nvme_pci_setup_prps(struct nvme_dev *dev,
 
 	nprps = DIV_ROUND_UP(length, NVME_CTRL_PAGE_SIZE);
 	if (nprps <= (256 / 8)) {
-		pool = dev->prp_small_pool;
+		pool = nvmeq->descriptor_pools.small;
 		iod->nr_allocations = 0;
 	} else {
-		pool = dev->prp_page_pool;
+		pool = nvmeq->descriptor_pools.large;
 		iod->nr_allocations = 1;
 	}
 
@@ -673,7 +787,7 @@ static blk_status_t nvme_pci_setup_prps(struct nvme_dev *dev,
 	cmnd->dptr.prp2 = cpu_to_le64(iod->first_dma);
 	return BLK_STS_OK;
 free_prps:
-	nvme_free_prps(dev, req);
+	nvme_free_prps(nvmeq, req);
 	return BLK_STS_RESOURCE;
 bad_sgl:
 	WARN(DO_ONCE(nvme_print_sgl, iod->sgt.sgl, iod->sgt.nents),
@@ -701,6 +815,7 @@ static void nvme_pci_sgl_set_seg(struct nvme_sgl_desc *sge,
 static blk_status_t nvme_pci_setup_sgls(struct nvme_dev *dev,
 		struct request *req, struct nvme_rw_command *cmd)
 {
+	struct nvme_queue *nvmeq = req->mq_hctx->driver_data;
 	struct nvme_iod *iod = blk_mq_rq_to_pdu(req);
 	struct dma_pool *pool;
 	struct nvme_sgl_desc *sg_list;
@@ -718,10 +833,10 @@ static blk_status_t nvme_pci_setup_sgls(struct nvme_dev *dev,
 	}
 
 	if (entries <= (256 / sizeof(struct nvme_sgl_desc))) {
-		pool = dev->prp_small_pool;
+		pool = nvmeq->descriptor_pools.small;
 		iod->nr_allocations = 0;
 	} else {
-		pool = dev->prp_page_pool;
+		pool = nvmeq->descriptor_pools.large;
 		iod->nr_allocations = 1;
 	}
 
@@ -842,6 +957,7 @@ static blk_status_t nvme_map_data(struct nvme_dev *dev, struct request *req,
 static blk_status_t nvme_pci_setup_meta_sgls(struct nvme_dev *dev,
 					     struct request *req)
 {
+	struct nvme_queue *nvmeq = req->mq_hctx->driver_data;
 	struct nvme_iod *iod = blk_mq_rq_to_pdu(req);
 	struct nvme_rw_command *cmnd = &iod->cmd.rw;
 	struct nvme_sgl_desc *sg_list;
@@ -865,7 +981,8 @@ static blk_status_t nvme_pci_setup_meta_sgls(struct nvme_dev *dev,
 	if (rc)
 		goto out_free_sg;
 
-	sg_list = dma_pool_alloc(dev->prp_small_pool, GFP_ATOMIC, &sgl_dma);
+	sg_list = dma_pool_alloc(nvmeq->descriptor_pools.small, GFP_ATOMIC,
+			&sgl_dma);
 	if (!sg_list)
 		goto out_unmap_sg;
 
@@ -1039,6 +1156,7 @@ static void nvme_queue_rqs(struct rq_list *rqlist)
 static __always_inline void nvme_unmap_metadata(struct nvme_dev *dev,
 						struct request *req)
 {
+	struct nvme_queue *nvmeq = req->mq_hctx->driver_data;
 	struct nvme_iod *iod = blk_mq_rq_to_pdu(req);
 
 	if (!iod->meta_sgt.nents) {
@@ -1048,7 +1166,7 @@ static __always_inline void nvme_unmap_metadata(struct nvme_dev *dev,
 		return;
 	}
 
-	dma_pool_free(dev->prp_small_pool, iod->meta_list.sg_list,
+	dma_pool_free(nvmeq->descriptor_pools.small, iod->meta_list.sg_list,
 		      iod->meta_dma);
 	dma_unmap_sgtable(dev->dev, &iod->meta_sgt, rq_dma_dir(req), 0);
 	mempool_free(iod->meta_sgt.sgl, dev->iod_meta_mempool);
@@ -1162,6 +1280,7 @@ static inline bool nvme_poll_cq(struct nvme_queue *nvmeq,
 		dma_rmb();
 		nvme_handle_cqe(nvmeq, iob, nvmeq->cq_head);
 		nvme_update_cq_head(nvmeq);
+		WRITE_ONCE(nvmeq->nr_cqes, nvmeq->nr_cqes + 1);
 	}
 
 	if (found)
@@ -1723,6 +1842,11 @@ static void nvme_init_queue(struct nvme_queue *nvmeq, u16 qid)
 	nvmeq->last_sq_tail = 0;
 	nvmeq->cq_head = 0;
 	nvmeq->cq_phase = 1;
+	nvmeq->nr_sqes = 0;
+	nvmeq->nr_cqes = 0;
+	nvmeq->last_cqes = 0;
+	nvmeq->avg_depth = 0;
+	nvmeq->coalesced = false;
 	nvmeq->q_db = &dev->dbs[qid * 2 * dev->db_stride];
 	memset((void *)nvmeq->cqes, 0, CQ_SIZE(nvmeq));
 	nvme_dbbuf_init(dev, nvmeq, qid);
@@ -2256,6 +2380,126 @@ static int nvme_setup_host_mem(struct nvme_dev *dev)
 	return ret;
 }
 
+/*
+ * Interrupt coalescing is a controller wide setting, but the Interrupt Vector
+ * Configuration feature can opt each vector out of it.  Enable it for the
+ * vectors of the queues that both complete many commands and keep enough
+ * commands in flight to reach the aggregation threshold, so that the latency
+ * of low queue depth I/O doesn't suffer from the aggregation time.
+ */
+#define NVME_COALESCE_INTERVAL	(HZ / 10)
+#define NVME_IRQ_CONFIG_CD	(1 << 16)
+
+static int nvme_set_vector_coalesce(struct nvme_dev *dev,
+		struct nvme_queue *nvmeq, bool coalesce)
+{
+	u32 dword11 = nvmeq->cq_vector;
+
+	if (!coalesce)
+		dword11 |= NVME_IRQ_CONFIG_CD;
+	return nvme_set_features(&dev->ctrl, NVME_FEAT_IRQ_CONFIG, dword11,
+			NULL, 0, NULL);
+}
+
+static int nvme_setup_coalesce(struct nvme_dev *dev)
+{
+	unsigned int i;
+	int ret;
+
+	for (i = 1; i < dev->online_queues; i++) {
+		struct nvme_queue *nvmeq = &dev->queues[i];
+
+		if (test_bit(NVMEQ_POLLED, &nvmeq->flags))
+			continue;
+		ret = nvme_set_vector_coalesce(dev, nvmeq, false);
+		if (ret)
+			return ret;
+	}
+
+	/* the aggregation threshold is a 0's based value */
+	return nvme_set_features(&dev->ctrl, NVME_FEAT_IRQ_COALESCE,
+			(dev->coalesce_time << 8) | (dev->coalesce_thr - 1),
+			NULL, 0, NULL);
+}
+
+static void nvme_coalesce_work(struct work_struct *work)
+{
+	struct nvme_dev *dev = container_of(to_delayed_work(work),
+			struct nvme_dev, coalesce_work);
+	unsigned int i;
+	int ret;
+
+	if (nvme_ctrl_state(&dev->ctrl) != NVME_CTRL_LIVE)
+		return;
+
+	if (!dev->coalesce_ready) {
+		ret = nvme_setup_coalesce(dev);
+		if (ret)
+			goto out_disable;
+		dev->coalesce_ready = true;
+	}
+
+	for (i = 1; i < dev->online_queues; i++) {
+		struct nvme_queue *nvmeq = &dev->queues[i];
+		u32 cqes, depth, rate;
+		bool coalesce;
+
+		if (test_bit(NVMEQ_POLLED, &nvmeq->flags))
+			continue;
+
+		/* read the completions first so that the depth can't underflow */
+		cqes = READ_ONCE(nvmeq->nr_cqes);
+		depth = min(READ_ONCE(nvmeq->nr_sqes) - cqes, nvmeq->q_depth);
+		rate = cqes - nvmeq->last_cqes;
+		nvmeq->last_cqes = cqes;
+		nvmeq->avg_depth = (nvmeq->avg_depth * 3 + depth) / 4;
+
+		/* back off only at half the thresholds to avoid flapping */
+		if (nvmeq->coalesced)
+			coalesce = rate >= dev->coalesce_cqes / 2 &&
+				   nvmeq->avg_depth >= dev->coalesce_thr / 2;
+		else
+			coalesce = rate >= dev->coalesce_cqes &&
+				   nvmeq->avg_depth >= dev->coalesce_thr;
+		if (coalesce == nvmeq->coalesced)
+			continue;
+
+		ret = nvme_set_vector_coalesce(dev, nvmeq, coalesce);
+		if (ret)
+			goto out_disable;
+		nvmeq->coalesced = coalesce;
+	}
+
+	queue_delayed_work(nvme_wq, &dev->coalesce_work,
+			NVME_COALESCE_INTERVAL);
+	return;
+
+out_disable:
+	/* don't retry until the next reset if the controller refused */
+	if (nvme_ctrl_state(&dev->ctrl) == NVME_CTRL_LIVE)
+		dev_warn(dev->ctrl.device,
+			"disabling dynamic interrupt coalescing: %d\n", ret);
+}
+
+static void nvme_start_coalesce(struct nvme_dev *dev)
+{
+	/*
+	 * Sample the module parameters once at reset time, like the queue
+	 * counts.  Vectors that are shared by several queues can't be tuned
+	 * per queue.
+	 */
+	dev->coalesce_cqes = mult_frac(irq_coalesce_iops,
+			NVME_COALESCE_INTERVAL, HZ);
+	if (!dev->coalesce_cqes || dev->num_vecs == 1 ||
+	    (dev->ctrl.quirks & NVME_QUIRK_SINGLE_VECTOR))
+		return;
+	dev->coalesce_thr = clamp(irq_coalesce_thr, 1U, 256U);
+	dev->coalesce_time = min(irq_coalesce_time, 255U);
+	dev->coalesce_ready = false;
+	queue_delayed_work(nvme_wq, &dev->coalesce_work,
+			NVME_COALESCE_INTERVAL);
+}
+
 static ssize_t cmb_show(struct device *dev, struct device_attribute *attr,
 		char *buf)
 {
@@ -2320,6 +2564,42 @@ static ssize_t hmb_store(struct device *dev, struct device_attribute *attr,
 }
 static DEVICE_ATTR_RW(hmb);
 
+static ssize_t poll_queues_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct nvme_dev *ndev = to_nvme_dev(dev_get_drvdata(dev));
+
+	return sysfs_emit(buf, "%u\n", ndev->io_queues[HCTX_TYPE_POLL]);
+}
+
+static ssize_t poll_queues_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct nvme_dev *ndev = to_nvme_dev(dev_get_drvdata(dev));
+	unsigned int n;
+	int ret;
+
+	ret = kstrtouint(buf, 10, &n);
+	if (ret)
+		return ret;
+	/* The queue array was sized at probe time, it can't grow */
+	if (n > num_possible_cpus() || n + 2 > ndev->nr_allocated_queues)
+		return -EINVAL;
+	/* Neither can the number of maps of an existing tag set */
+	if (n && ndev->ctrl.tagset && ndev->tagset.nr_maps <= HCTX_TYPE_POLL)
+		return -EINVAL;
+
+	ndev->nr_poll_queues = n;
+	ndev->poll_queues_set = true;
+
+	/* Recreate the I/O queues and the tag set maps with the new count */
+	ret = nvme_reset_ctrl_sync(&ndev->ctrl);
+	if (ret < 0)
+		return ret;
+	return count;
+}
+static DEVICE_ATTR_RW(poll_queues);
+
 static umode_t nvme_pci_attrs_are_visible(struct kobject *kobj,
 		struct attribute *a, int n)
 {
@@ -2344,6 +2624,7 @@ static struct attribute *nvme_pci_attrs[] = {
 	&dev_attr_cmbloc.attr,
 	&dev_attr_cmbsz.attr,
 	&dev_attr_hmb.attr,
+	&dev_attr_poll_queues.attr,
 	NULL,
 };
 
@@ -2461,10 +2742,12 @@ static int nvme_setup_io_queues(struct nvme_dev *dev)
 
 	/*
 	 * Sample the module parameters once at reset time so that we have
-	 * stable values to work with.
+	 * stable values to work with.  A poll queue count written to sysfs
+	 * overrides the module parameter.
 	 */
 	dev->nr_write_queues = write_queues;
-	dev->nr_poll_queues = poll_queues;
+	if (!dev->poll_queues_set)
+		dev->nr_poll_queues = poll_queues;
 
 	nr_io_queues = dev->nr_allocated_queues - 1;
 	result = nvme_set_queue_count(&dev->ctrl, &nr_io_queues);
@@ -2840,35 +3123,6 @@ static int nvme_disable_prepare_reset(struct nvme_dev *dev, bool shutdown)
 	return 0;
 }
 
-static int nvme_setup_prp_pools(struct nvme_dev *dev)
-{
-	size_t small_align = 256;
-
-	dev->prp_page_pool = dma_pool_create("prp list page", dev->dev,
-						NVME_CTRL_PAGE_SIZE,
-						NVME_CTRL_PAGE_SIZE, 0);
-	if (!dev->prp_page_pool)
-		return -ENOMEM;
-
-	if (dev->ctrl.quirks & NVME_QUIRK_DMAPOOL_ALIGN_512)
-		small_align = 512;
-
-	/* Optimisation for I/Os between 4k and 128k */
-	dev->prp_small_pool = dma_pool_create("prp list 256", dev->dev,
-						256, small_align, 0);
-	if (!dev->prp_small_pool) {
-		dma_pool_destroy(dev->prp_page_pool);
-		return -ENOMEM;
-	}
-	return 0;
-}
-
-static void nvme_release_prp_pools(struct nvme_dev *dev)
-{
-	dma_pool_destroy(dev->prp_page_pool);
-	dma_pool_destroy(dev->prp_small_pool);
-}
-
 static int nvme_pci_alloc_iod_mempool(struct nvme_dev *dev)
 {
 	size_t meta_size = sizeof(struct scatterlist) * (NVME_MAX_META_SEGS + 1);
@@ -3005,6 +3259,7 @@ static void nvme_reset_work(struct work_struct *work)
 	}
 
 	nvme_start_ctrl(&dev->ctrl);
+	nvme_start_coalesce(dev);
 	return;
 
  out_unlock:
@@ -3185,10 +3440,12 @@ static struct nvme_dev *nvme_pci_alloc_dev(struct pci_dev *pdev,
 	struct nvme_dev *dev;
 	int ret = -ENOMEM;
 
-	dev = kzalloc_node(sizeof(*dev), GFP_KERNEL, node);
+	dev = kzalloc_node(struct_size(dev, descriptor_pools, nr_node_ids),
+			GFP_KERNEL, node);
 	if (!dev)
 		return ERR_PTR(-ENOMEM);
 	INIT_WORK(&dev->ctrl.reset_work, nvme_reset_work);
+	INIT_DELAYED_WORK(&dev->coalesce_work, nvme_coalesce_work);
 	mutex_init(&dev->shutdown_lock);
 
 	dev->nr_write_queues = write_queues;
@@ -3260,13 +3517,9 @@ static int nvme_probe(struct pci_dev *pdev, const struct pci_device_id *id)
 	if (result)
 		goto out_uninit_ctrl;
 
-	result = nvme_setup_prp_pools(dev);
-	if (result)
-		goto out_dev_unmap;
-
 	result = nvme_pci_alloc_iod_mempool(dev);
 	if (result)
-		goto out_release_prp_pools;
+		goto out_dev_unmap;
 
 	dev_info(dev->ctrl.device, "pci function %s\n", dev_name(&pdev->dev));
 
@@ -3344,8 +3597,7 @@ static int nvme_probe(struct pci_dev *pdev, const struct pci_device_id *id)
 out_release_iod_mempool:
 	mempool_destroy(dev->iod_mempool);
 	mempool_destroy(dev->iod_meta_mempool);
-out_release_prp_pools:
-	nvme_release_prp_pools(dev);
+	nvme_release_descriptor_pools(dev);
 out_dev_unmap:
 	nvme_dev_unmap(dev);
 out_uninit_ctrl:
@@ -3401,6 +3653,7 @@ static void nvme_remove(struct pci_dev *pdev)
 	}
 
 	flush_work(&dev->ctrl.reset_work);
+	cancel_delayed_work_sync(&dev->coalesce_work);
 	nvme_stop_ctrl(&dev->ctrl);
 	nvme_remove_namespaces(&dev->ctrl);
 	nvme_dev_disable(dev, true);
@@ -3410,7 +3663,7 @@ static void nvme_remove(struct pci_dev *pdev)
 	nvme_free_queues(dev, 0);
 	mempool_destroy(dev->iod_mempool);
 	mempool_destroy(dev->iod_meta_mempool);
-	nvme_release_prp_pools(dev);
+	nvme_release_descriptor_pools(dev);
 	nvme_dev_unmap(dev);
 	nvme_uninit_ctrl(&dev->ctrl);
 }
@@ -16,6 +16,7 @@
 #include <linux/prefetch.h>
 #include <linux/sched/mm.h>
 #include <linux/swap.h>
+#include <linux/vmalloc.h>
 
 #define BTREE_CACHE_NOT_FREED_INCREMENT(counter) \
 do {						 \
@@ -50,14 +51,23 @@ void bch2_recalc_btree_reserve(struct bch_fs *c)
 	c->btree_cache.nr_reserve = reserve;
 }
 
-static inline size_t btree_cache_can_free(struct btree_cache_list *list)
+static inline size_t btree_cache_can_free(struct btree_cache_list *list, int nid)
 {
 	struct btree_cache *bc = container_of(list, struct btree_cache, live[list->idx]);
 
 	size_t can_free = list->nr;
 	if (!list->idx)
 		can_free = max_t(ssize_t, 0, can_free - bc->nr_reserve);
-	return can_free;
+	return min(can_free, bc->shards[nid].nr_live[list->idx]);
+}
+
+static int btree_node_data_nid(struct btree *b)
+{
+	struct page *page = is_vmalloc_addr(b->data)
+		? vmalloc_to_page(b->data)
+		: virt_to_page(b->data);
+
+	return page_to_nid(page);
 }
 
 static void btree_node_to_freedlist(struct btree_cache *bc, struct btree *b)
@@ -226,10 +236,14 @@ void bch2_node_pin(struct bch_fs *c, struct btree *b)
 
 	mutex_lock(&bc->lock);
 	if (b != btree_node_root(c, b) && !btree_node_pinned(b)) {
+		struct btree_cache_shard *shard = &bc->shards[b->nid];
+
 		set_btree_node_pinned(b);
-		list_move(&b->list, &bc->live[1].list);
+		list_move(&b->list, &shard->live[1]);
 		bc->live[0].nr--;
 		bc->live[1].nr++;
+		shard->nr_live[0]--;
+		shard->nr_live[1]++;
 	}
 	mutex_unlock(&bc->lock);
 }
@@ -243,11 +257,17 @@ void bch2_btree_cache_unpin(struct bch_fs *c)
 	c->btree_cache.pinned_nodes_mask[0] = 0;
 	c->btree_cache.pinned_nodes_mask[1] = 0;
 
-	list_for_each_entry_safe(b, n, &bc->live[1].list, list) {
-		clear_btree_node_pinned(b);
-		list_move(&b->list, &bc->live[0].list);
-		bc->live[0].nr++;
-		bc->live[1].nr--;
+	for (unsigned nid = 0; nid < nr_node_ids; nid++) {
+		struct btree_cache_shard *shard = &bc->shards[nid];
+
+		list_for_each_entry_safe(b, n, &shard->live[1], list) {
+			clear_btree_node_pinned(b);
+			list_move(&b->list, &shard->live[0]);
+			bc->live[0].nr++;
+			bc->live[1].nr--;
+			shard->nr_live[0]++;
+			shard->nr_live[1]--;
+		}
 	}
 
 	mutex_unlock(&bc->lock);
@@ -268,6 +288,7 @@ void __bch2_btree_node_hash_remove(struct btree_cache *bc, struct btree *b)
 	if (b->c.btree_id < BTREE_ID_NR)
 		--bc->nr_by_btree[b->c.btree_id];
 	--bc->live[btree_node_pinned(b)].nr;
+	--bc->shards[b->nid].nr_live[btree_node_pinned(b)];
 	list_del_init(&b->list);
 }
 
@@ -294,8 +315,10 @@ int __bch2_btree_node_hash_insert(struct btree_cache *bc, struct btree *b)
 	bool p = __btree_node_pinned(bc, b);
 	mod_bit(BTREE_NODE_pinned, &b->flags, p);
 
-	list_add_tail(&b->list, &bc->live[p].list);
+	b->nid = btree_node_data_nid(b);
+	list_add_tail(&b->list, &bc->shards[b->nid].live[p]);
 	bc->live[p].nr++;
+	bc->shards[b->nid].nr_live[p]++;
 	return 0;
 }
 
@@ -350,6 +373,19 @@ static inline struct btree *btree_cache_find(struct btree_cache *bc,
 	return rhashtable_lookup_fast(&bc->table, &v, bch_btree_cache_params);
 }
 
+/* btree_cache_find(), for lookups accounted in the per shard hit ratio */
+static inline struct btree *btree_cache_lookup(struct btree_cache *bc,
+					       const struct bkey_i *k)
+{
+	struct btree *b = btree_cache_find(bc, k);
+
+	if (likely(b))
+		percpu_counter_inc(&bc->shards[b->nid].hits);
+	else
+		percpu_counter_inc(&bc->shards[numa_node_id()].misses);
+	return b;
+}
+
 /*
  * this version is for btree nodes that have already been freed (we're not
  * reaping a real btree node)
@@ -467,6 +503,7 @@ static unsigned long bch2_btree_cache_scan(struct shrinker *shrink,
 	struct btree_cache_list *list = shrink->private_data;
 	struct btree_cache *bc = container_of(list, struct btree_cache, live[list->idx]);
 	struct bch_fs *c = container_of(bc, struct bch_fs, btree_cache);
+	struct list_head *lru = &bc->shards[sc->nid].live[list->idx];
 	struct btree *b, *t;
 	unsigned long nr = sc->nr_to_scan;
 	unsigned long can_free = 0;
@@ -489,7 +526,7 @@ static unsigned long bch2_btree_cache_scan(struct shrinker *shrink,
 	 * succeed, so that inserting keys into the btree can always succeed and
 	 * IO can always make forward progress:
 	 */
-	can_free = btree_cache_can_free(list);
+	can_free = btree_cache_can_free(list, sc->nid);
 	nr = min_t(unsigned long, nr, can_free);
 
 	i = 0;
@@ -515,7 +552,7 @@ static unsigned long bch2_btree_cache_scan(struct shrinker *shrink,
 		}
 	}
 restart:
-	list_for_each_entry_safe(b, t, &list->list, list) {
+	list_for_each_entry_safe(b, t, lru, list) {
 		touched++;
 
 		if (btree_node_accessed(b)) {
@@ -539,7 +576,7 @@ static unsigned long bch2_btree_cache_scan(struct shrinker *shrink,
 			   !btree_node_will_make_reachable(b) &&
 			   !btree_node_write_blocked(b) &&
 			   six_trylock_read(&b->c.lock)) {
-			list_move(&list->list, &b->list);
+			list_move(lru, &b->list);
 			mutex_unlock(&bc->lock);
 			__bch2_btree_node_write(c, b, BTREE_WRITE_cache_reclaim);
 			six_unlock_read(&b->c.lock);
@@ -553,8 +590,8 @@ static unsigned long bch2_btree_cache_scan(struct shrinker *shrink,
 			break;
 	}
 out_rotate:
-	if (&t->list != &list->list)
-		list_move_tail(&list->list, &t->list);
+	if (&t->list != lru)
+		list_move_tail(lru, &t->list);
 out:
 	mutex_unlock(&bc->lock);
 out_nounlock:
@@ -572,7 +609,7 @@ static unsigned long bch2_btree_cache_count(struct shrinker *shrink,
 	if (bch2_btree_shrinker_disabled)
 		return 0;
 
-	return btree_cache_can_free(list);
+	return btree_cache_can_free(list, sc->nid);
 }
 
 void bch2_fs_btree_cache_exit(struct bch_fs *c)
@@ -589,7 +626,7 @@ void bch2_fs_btree_cache_exit(struct bch_fs *c)
 	mutex_lock(&bc->lock);
 
 	if (c->verify_data)
-		list_move(&c->verify_data->list, &bc->live[0].list);
+		list_move(&c->verify_data->list, btree_node_live_list(bc, c->verify_data));
 
 	kvfree(c->verify_ondisk);
 
@@ -597,13 +634,13 @@ void bch2_fs_btree_cache_exit(struct bch_fs *c)
 		struct btree_root *r = bch2_btree_id_root(c, i);
 
 		if (r->b)
-			list_add(&r->b->list, &bc->live[0].list);
+			list_add(&r->b->list, btree_node_live_list(bc, r->b));
 	}
 
-	list_for_each_entry_safe(b, t, &bc->live[1].list, list)
-		bch2_btree_node_hash_remove(bc, b);
-	list_for_each_entry_safe(b, t, &bc->live[0].list, list)
-		bch2_btree_node_hash_remove(bc, b);
+	for (unsigned nid = 0; bc->shards && nid < nr_node_ids; nid++)
+		for (unsigned i = 0; i < ARRAY_SIZE(bc->live); i++)
+			list_for_each_entry_safe(b, t, &bc->shards[nid].live[i], list)
+				bch2_btree_node_hash_remove(bc, b);
 
 	list_for_each_entry_safe(b, t, &bc->freeable, list) {
 		BUG_ON(btree_node_read_in_flight(b) ||
@@ -635,6 +672,14 @@ void bch2_fs_btree_cache_exit(struct bch_fs *c)
 
 	if (bc->table_init_done)
 		rhashtable_destroy(&bc->table);
+
+	for (unsigned nid = 0; bc->shards && nid < nr_node_ids; nid++) {
+		percpu_counter_destroy(&bc->shards[nid].hits);
+		percpu_counter_destroy(&bc->shards[nid].misses);
+	}
+
+	kfree(bc->shards);
+	bc->shards = NULL;
 }
 
 int bch2_fs_btree_cache_init(struct bch_fs *c)
@@ -644,6 +689,19 @@ int bch2_fs_btree_cache_init(struct bch_fs *c)
 	unsigned i;
 	int ret = 0;
 
+	bc->shards = kcalloc(nr_node_ids, sizeof(*bc->shards), GFP_KERNEL);
+	if (!bc->shards)
+		goto err;
+
+	for (unsigned nid = 0; nid < nr_node_ids; nid++) {
+		for (i = 0; i < ARRAY_SIZE(bc->live); i++)
+			INIT_LIST_HEAD(&bc->shards[nid].live[i]);
+
+		if (percpu_counter_init(&bc->shards[nid].hits, 0, GFP_KERNEL) ||
+		    percpu_counter_init(&bc->shards[nid].misses, 0, GFP_KERNEL))
+			goto err;
+	}
+
 	ret = rhashtable_init(&bc->table, &bch_btree_cache_params);
 	if (ret)
 		goto err;
@@ -656,11 +714,9 @@ int bch2_fs_btree_cache_init(struct bch_fs *c)
 		if (!__bch2_btree_node_mem_alloc(c))
 			goto err;
 
-	list_splice_init(&bc->live[0].list, &bc->freeable);
-
 	mutex_init(&c->verify_lock);
 
-	shrink = shrinker_alloc(0, "%s-btree_cache", c->name);
+	shrink = shrinker_alloc(SHRINKER_NUMA_AWARE, "%s-btree_cache", c->name);
 	if (!shrink)
 		goto err;
 	bc->live[0].shrink	= shrink;
@@ -670,7 +726,7 @@ int bch2_fs_btree_cache_init(struct bch_fs *c)
 	shrink->private_data	= &bc->live[0];
 	shrinker_register(shrink);
 
-	shrink = shrinker_alloc(0, "%s-btree_cache-pinned", c->name);
+	shrink = shrinker_alloc(SHRINKER_NUMA_AWARE, "%s-btree_cache-pinned", c->name);
 	if (!shrink)
 		goto err;
 	bc->live[1].shrink	= shrink;
@@ -688,10 +744,8 @@ int bch2_fs_btree_cache_init(struct bch_fs *c)
 void bch2_fs_btree_cache_init_early(struct btree_cache *bc)
 {
 	mutex_init(&bc->lock);
-	for (unsigned i = 0; i < ARRAY_SIZE(bc->live); i++) {
+	for (unsigned i = 0; i < ARRAY_SIZE(bc->live); i++)
 		bc->live[i].idx = i;
-		INIT_LIST_HEAD(&bc->live[i].list);
-	}
 	INIT_LIST_HEAD(&bc->freeable);
 	INIT_LIST_HEAD(&bc->freed_pcpu);
 	INIT_LIST_HEAD(&bc->freed_nonpcpu);
@@ -754,15 +808,17 @@ static struct btree *btree_node_cannibalize(struct bch_fs *c)
 	struct btree *b;
 
 	for (unsigned i = 0; i < ARRAY_SIZE(bc->live); i++)
-		list_for_each_entry_reverse(b, &bc->live[i].list, list)
-			if (!btree_node_reclaim(c, b, false))
-				return b;
+		for (unsigned nid = 0; nid < nr_node_ids; nid++)
+			list_for_each_entry_reverse(b, &bc->shards[nid].live[i], list)
+				if (!btree_node_reclaim(c, b, false))
+					return b;
 
 	while (1) {
 		for (unsigned i = 0; i < ARRAY_SIZE(bc->live); i++)
-			list_for_each_entry_reverse(b, &bc->live[i].list, list)
-				if (!btree_node_write_and_reclaim(c, b))
-					return b;
+			for (unsigned nid = 0; nid < nr_node_ids; nid++)
+				list_for_each_entry_reverse(b, &bc->shards[nid].live[i], list)
+					if (!btree_node_write_and_reclaim(c, b))
+						return b;
 
 		/*
 		 * Rare case: all nodes were intent-locked.
@@ -1049,7 +1105,7 @@ static struct btree *__bch2_btree_node_get(struct btree_trans *trans, struct btr
 
 	EBUG_ON(level >= BTREE_MAX_DEPTH);
 retry:
-	b = btree_cache_find(bc, k);
+	b = btree_cache_lookup(bc, k);
 	if (unlikely(!b)) {
 		/*
 		 * We must have the parent locked to call bch2_btree_node_fill(),
@@ -1253,7 +1309,7 @@ struct btree *bch2_btree_node_get_noiter(struct btree_trans *trans,
 			goto lock_node;
 	}
 retry:
-	b = btree_cache_find(bc, k);
+	b = btree_cache_lookup(bc, k);
 	if (unlikely(!b)) {
 		if (nofill)
 			goto out;
@@ -1497,6 +1553,26 @@ void bch2_btree_cache_to_text(struct printbuf *out, const struct btree_cache *bc
 	prt_printf(out, "cannibalize lock:\t%p\n",	bc->alloc_lock);
 	prt_newline(out);
 
+	for (unsigned nid = 0; nid < nr_node_ids; nid++) {
+		struct btree_cache_shard *shard = &bc->shards[nid];
+		u64 hits = percpu_counter_sum_positive(&shard->hits);
+		u64 lookups = hits + percpu_counter_sum_positive(&shard->misses);
+
+		if (!node_online(nid) && !lookups)
+			continue;
+
+		prt_printf(out, "node %u:\n", nid);
+		printbuf_indent_add(out, 2);
+		prt_btree_cache_line(out, c, "live:",	shard->nr_live[0]);
+		prt_btree_cache_line(out, c, "pinned:",	shard->nr_live[1]);
+		prt_printf(out, "hits:\t%llu\n", hits);
+		prt_printf(out, "misses:\t%llu\n", lookups - hits);
+		prt_printf(out, "hit ratio:\t%llu%%\n",
+			   lookups ? div64_u64(hits * 100, lookups) : 0);
+		printbuf_indent_sub(out, 2);
+	}
+	prt_newline(out);
+
 	for (unsigned i = 0; i < ARRAY_SIZE(bc->nr_by_btree); i++) {
 		bch2_btree_id_to_text(out, i);
 		prt_printf(out, "\t");
@@ -12,6 +12,12 @@ struct btree_iter;
 
 void bch2_recalc_btree_reserve(struct bch_fs *);
 
+static inline struct list_head *btree_node_live_list(struct btree_cache *bc,
+						     struct btree *b)
+{
+	return &bc->shards[b->nid].live[btree_node_pinned(b)];
+}
+
 void bch2_btree_node_to_freelist(struct bch_fs *, struct btree *);
 
 void __bch2_btree_node_hash_remove(struct btree_cache *, struct btree *);
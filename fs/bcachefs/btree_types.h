@@ -3,6 +3,7 @@
 #define _BCACHEFS_BTREE_TYPES_H
 
 #include <linux/list.h>
+#include <linux/percpu_counter.h>
 #include <linux/rhashtable.h>
 
 #include "bbpos_types.h"
@@ -80,6 +81,8 @@ struct btree {
 	u8			nsets;
 	u8			nr_key_bits;
 	u16			version_ondisk;
+	/* NUMA node of the btree_cache shard we're on, while hashed */
+	u16			nid;
 
 	struct bkey_format	format;
 
@@ -159,10 +162,24 @@ enum bch_btree_cache_not_freed_reasons {
 struct btree_cache_list {
 	unsigned		idx;
 	struct shrinker		*shrink;
-	struct list_head	list;
 	size_t			nr;
 };
 
+/*
+ * Live nodes are kept on per NUMA node LRUs, by the node of their buffer, so
+ * that the (NUMA aware) shrinkers only walk the nodes they can actually free
+ * memory from:
+ */
+struct btree_cache_shard {
+	struct list_head	live[2];
+	size_t			nr_live[2];
+
+	/* lookups in the hash table, by the node of the btree node found */
+	struct percpu_counter	hits;
+	/* and by the node of the thread that missed */
+	struct percpu_counter	misses;
+};
+
 struct btree_cache {
 	struct rhashtable	table;
 	bool			table_init_done;
@@ -184,6 +201,8 @@ struct btree_cache {
 	struct list_head	freed_pcpu;
 	struct list_head	freed_nonpcpu;
 	struct btree_cache_list	live[2];
+	/* nr_node_ids entries */
+	struct btree_cache_shard *shards;
 
 	size_t			nr_freeable;
 	size_t			nr_reserve;
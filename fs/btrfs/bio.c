@@ -256,6 +256,160 @@ static struct btrfs_failed_bio *repair_one_sector(struct btrfs_bio *failed_bbio,
 	return fbio;
 }
 
+/*
+ * Verifying the data checksums of a large read bio with a slow checksum
+ * algorithm is split into chunks that are verified in parallel on the end I/O
+ * workqueue.  The shash tfm can be shared as each digest uses its own
+ * descriptor.  Whoever finishes the last chunk repairs the failed sectors,
+ * which has to be done serially, and ends the bio.
+ */
+#define BTRFS_CSUM_PARALLEL_MIN		SZ_256K
+#define BTRFS_CSUM_MAX_CHUNKS		8
+
+struct btrfs_csum_chunk {
+	struct work_struct work;
+	struct btrfs_csum_verify *verify;
+	u32 offset;
+	u32 len;
+};
+
+struct btrfs_csum_verify {
+	struct btrfs_bio *bbio;
+	struct btrfs_device *dev;
+	atomic_t pending;
+	struct btrfs_csum_chunk chunks[BTRFS_CSUM_MAX_CHUNKS];
+	/* Sectors that failed verification, indexed by bio offset. */
+	unsigned long failed[];
+};
+
+static void btrfs_check_read_bio_done(struct btrfs_bio *bbio,
+				      struct btrfs_failed_bio *fbio)
+{
+	if (bbio->csum != bbio->csum_inline)
+		kfree(bbio->csum);
+
+	if (fbio)
+		btrfs_repair_done(fbio);
+	else
+		btrfs_bio_end_io(bbio, bbio->bio.bi_status);
+}
+
+static void btrfs_verify_csum_chunk(struct btrfs_csum_verify *verify,
+				    struct btrfs_csum_chunk *chunk)
+{
+	struct btrfs_bio *bbio = verify->bbio;
+	struct btrfs_fs_info *fs_info = bbio->fs_info;
+	u32 sectorsize = fs_info->sectorsize;
+	struct bvec_iter iter = bbio->saved_iter;
+	u32 offset = chunk->offset;
+
+	bio_advance_iter(&bbio->bio, &iter, offset);
+	iter.bi_size = chunk->len;
+	while (iter.bi_size) {
+		struct bio_vec bv = bio_iter_iovec(&bbio->bio, iter);
+
+		bv.bv_len = min(bv.bv_len, sectorsize);
+		if (!btrfs_data_csum_ok(bbio, verify->dev, offset, &bv))
+			set_bit(offset >> fs_info->sectorsize_bits,
+				verify->failed);
+
+		bio_advance_iter_single(&bbio->bio, &iter, sectorsize);
+		offset += sectorsize;
+	}
+}
+
+static void btrfs_finish_csum_verify(struct btrfs_csum_verify *verify)
+{
+	struct btrfs_bio *bbio = verify->bbio;
+	struct btrfs_fs_info *fs_info = bbio->fs_info;
+	u32 sectorsize = fs_info->sectorsize;
+	u32 nr_sectors = bbio->saved_iter.bi_size >> fs_info->sectorsize_bits;
+	struct btrfs_failed_bio *fbio = NULL;
+	u32 cur = 0;
+	unsigned long bit;
+
+	/*
+	 * repair_one_sector() takes the logical address of the bad sector
+	 * from saved_iter, so advance it just like the inline loop does.
+	 */
+	for_each_set_bit(bit, verify->failed, nr_sectors) {
+		u32 offset = bit << fs_info->sectorsize_bits;
+		struct bio_vec bv;
+
+		bio_advance_iter(&bbio->bio, &bbio->saved_iter, offset - cur);
+		cur = offset;
+		bv = bio_iter_iovec(&bbio->bio, bbio->saved_iter);
+		bv.bv_len = min(bv.bv_len, sectorsize);
+		fbio = repair_one_sector(bbio, offset, &bv, fbio);
+	}
+
+	kfree(verify);
+	btrfs_check_read_bio_done(bbio, fbio);
+}
+
+static void btrfs_csum_chunk_work(struct work_struct *work)
+{
+	struct btrfs_csum_chunk *chunk =
+		container_of(work, struct btrfs_csum_chunk, work);
+	struct btrfs_csum_verify *verify = chunk->verify;
+
+	btrfs_verify_csum_chunk(verify, chunk);
+	if (atomic_dec_and_test(&verify->pending))
+		btrfs_finish_csum_verify(verify);
+}
+
+/*
+ * Try to verify the checksums of @bbio in parallel.  Return false if the bio
+ * should be verified inline instead.
+ */
+static bool btrfs_check_read_bio_parallel(struct btrfs_bio *bbio,
+					  struct btrfs_device *dev)
+{
+	struct btrfs_fs_info *fs_info = bbio->fs_info;
+	u32 size = bbio->saved_iter.bi_size;
+	u32 nr_sectors = size >> fs_info->sectorsize_bits;
+	struct btrfs_csum_verify *verify;
+	unsigned int nr_chunks;
+	u32 chunk_len, offset = 0;
+	int i;
+
+	if (size < BTRFS_CSUM_PARALLEL_MIN || !bbio->csum ||
+	    test_bit(BTRFS_FS_CSUM_IMPL_FAST, &fs_info->flags) ||
+	    btrfs_is_data_reloc_root(bbio->inode->root))
+		return false;
+
+	nr_chunks = min3(DIV_ROUND_UP(size, BTRFS_CSUM_PARALLEL_MIN / 2),
+			 BTRFS_CSUM_MAX_CHUNKS, num_online_cpus());
+	if (nr_chunks < 2)
+		return false;
+
+	verify = kzalloc(struct_size(verify, failed, BITS_TO_LONGS(nr_sectors)),
+			 GFP_NOFS);
+	if (!verify)
+		return false;
+
+	verify->bbio = bbio;
+	verify->dev = dev;
+	atomic_set(&verify->pending, nr_chunks);
+	chunk_len = round_up(DIV_ROUND_UP(size, nr_chunks), fs_info->sectorsize);
+	for (i = 0; i < nr_chunks; i++) {
+		struct btrfs_csum_chunk *chunk = &verify->chunks[i];
+
+		chunk->verify = verify;
+		chunk->offset = offset;
+		chunk->len = min(chunk_len, size - offset);
+		offset += chunk->len;
+	}
+
+	/* Queue all but the first chunk, which is verified right here. */
+	for (i = 1; i < nr_chunks; i++) {
+		INIT_WORK(&verify->chunks[i].work, btrfs_csum_chunk_work);
+		queue_work(fs_info->endio_workers, &verify->chunks[i].work);
+	}
+	btrfs_csum_chunk_work(&verify->chunks[0].work);
+	return true;
+}
+
 static void btrfs_check_read_bio(struct btrfs_bio *bbio, struct btrfs_device *dev)
 {
 	struct btrfs_inode *inode = bbio->inode;
@@ -281,6 +435,9 @@ static void btrfs_check_read_bio(struct btrfs_bio *bbio, struct btrfs_device *de
 	/* Clear the I/O error. A failed repair will reset it. */
 	bbio->bio.bi_status = BLK_STS_OK;
 
+	if (!status && btrfs_check_read_bio_parallel(bbio, dev))
+		return;
+
 	while (iter->bi_size) {
 		struct bio_vec bv = bio_iter_iovec(&bbio->bio, *iter);
 
@@ -292,13 +449,7 @@ static void btrfs_check_read_bio(struct btrfs_bio *bbio, struct btrfs_device *de
 		offset += sectorsize;
 	}
 
-	if (bbio->csum != bbio->csum_inline)
-		kfree(bbio->csum);
-
-	if (fbio)
-		btrfs_repair_done(fbio);
-	else
-		btrfs_bio_end_io(bbio, bbio->bio.bi_status);
+	btrfs_check_read_bio_done(bbio, fbio);
 }
 
 static void btrfs_log_dev_io_error(struct bio *bio, struct btrfs_device *dev)
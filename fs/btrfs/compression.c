@@ -980,6 +980,74 @@ static int btrfs_compress_set_level(unsigned int type, int level)
 	return level;
 }
 
+/*
+ * Start the adaptive mode from the mounted zstd level, or the default one,
+ * within the adaptive range.
+ */
+void btrfs_compress_adaptive_start(struct btrfs_fs_info *fs_info)
+{
+	int level = 0;
+
+	if (fs_info->compress_type == BTRFS_COMPRESS_ZSTD)
+		level = fs_info->compress_level;
+	level = btrfs_compress_set_level(BTRFS_COMPRESS_ZSTD, level);
+	WRITE_ONCE(fs_info->compress_adaptive_level,
+		   clamp(level, 1, BTRFS_ZSTD_ADAPTIVE_MAX_LEVEL));
+}
+
+/*
+ * Pick the zstd level of the next extent in adaptive mode.
+ *
+ * The level follows the number of async chunks queued for compression but not
+ * started yet.  More of them than online CPUs means that compression can't
+ * keep up with writeback, so the level is lowered.  No backlog at all means
+ * the device or the writer is the bottleneck and there is CPU time left to
+ * compress harder.  The level moves by one step at most every
+ * BTRFS_COMPRESS_ADAPTIVE_INTERVAL.
+ */
+int btrfs_compress_adaptive_level(struct btrfs_fs_info *fs_info)
+{
+	unsigned long next = READ_ONCE(fs_info->compress_adaptive_next);
+	int level = READ_ONCE(fs_info->compress_adaptive_level);
+	int queued;
+
+	if (time_before(jiffies, next) ||
+	    cmpxchg(&fs_info->compress_adaptive_next, next,
+		    jiffies + BTRFS_COMPRESS_ADAPTIVE_INTERVAL) != next)
+		return level;
+
+	queued = atomic_read(&fs_info->compress_queued);
+	if (queued > num_online_cpus())
+		level = max(level - 1, 1);
+	else if (!queued)
+		level = min(level + 1, BTRFS_ZSTD_ADAPTIVE_MAX_LEVEL);
+	WRITE_ONCE(fs_info->compress_adaptive_level, level);
+	return level;
+}
+
+/*
+ * Account one successfully compressed extent in the per-level statistics.
+ * Only the zstd levels from 1 up are tracked.
+ */
+void btrfs_compress_account(struct btrfs_fs_info *fs_info, unsigned int type,
+			    int level, unsigned long bytes_in,
+			    unsigned long bytes_out, u64 ns)
+{
+	struct btrfs_compress_stats *stats;
+
+	if (type != BTRFS_COMPRESS_ZSTD)
+		return;
+	level = btrfs_compress_set_level(type, level);
+	if (level < 1 || level > BTRFS_ZSTD_STATS_LEVELS)
+		return;
+
+	stats = &fs_info->zstd_stats[level - 1];
+	atomic64_inc(&stats->extents);
+	atomic64_add(bytes_in, &stats->bytes_in);
+	atomic64_add(bytes_out, &stats->bytes_out);
+	atomic64_add(ns, &stats->ns);
+}
+
 /*
  * Check whether the @level is within the valid range for the given type.
  */
@@ -40,6 +40,11 @@ static_assert((BTRFS_MAX_COMPRESSED % PAGE_SIZE) == 0);
 
 #define	BTRFS_ZLIB_DEFAULT_LEVEL		3
 
+/* Highest zstd level picked by the adaptive mode. */
+#define BTRFS_ZSTD_ADAPTIVE_MAX_LEVEL		9
+/* Minimum time between two adaptive level changes. */
+#define BTRFS_COMPRESS_ADAPTIVE_INTERVAL	(HZ / 10)
+
 struct compressed_bio {
 	/* Number of compressed folios in the array. */
 	unsigned int nr_folios;
@@ -99,6 +104,11 @@ void btrfs_submit_compressed_write(struct btrfs_ordered_extent *ordered,
 void btrfs_submit_compressed_read(struct btrfs_bio *bbio);
 
 int btrfs_compress_str2level(unsigned int type, const char *str);
+void btrfs_compress_adaptive_start(struct btrfs_fs_info *fs_info);
+int btrfs_compress_adaptive_level(struct btrfs_fs_info *fs_info);
+void btrfs_compress_account(struct btrfs_fs_info *fs_info, unsigned int type,
+			    int level, unsigned long bytes_in,
+			    unsigned long bytes_out, u64 ns);
 
 struct folio *btrfs_alloc_compr_folio(void);
 void btrfs_free_compr_folio(struct folio *folio);
@@ -422,6 +422,16 @@ struct btrfs_commit_stats {
 	u64 total_commit_dur;
 };
 
+/* zstd levels 1..BTRFS_ZSTD_STATS_LEVELS are accounted in zstd_stats. */
+#define BTRFS_ZSTD_STATS_LEVELS		15
+
+struct btrfs_compress_stats {
+	atomic64_t extents;
+	atomic64_t bytes_in;
+	atomic64_t bytes_out;
+	atomic64_t ns;
+};
+
 struct btrfs_fs_info {
 	u8 chunk_tree_uuid[BTRFS_UUID_SIZE];
 	unsigned long flags;
@@ -503,6 +513,17 @@ struct btrfs_fs_info {
 
 	int compress_type;
 	int compress_level;
+	/*
+	 * Adaptive zstd level selection, enabled via sysfs.  The level follows
+	 * the backlog of the compression workers, see
+	 * btrfs_compress_adaptive_level().
+	 */
+	bool compress_adaptive;
+	int compress_adaptive_level;
+	unsigned long compress_adaptive_next;
+	/* Number of async chunks queued for compression but not started. */
+	atomic_t compress_queued;
+	struct btrfs_compress_stats zstd_stats[BTRFS_ZSTD_STATS_LEVELS];
 	u32 commit_interval;
 	/*
 	 * It is a suggestive number, the read side is safe even it gets a
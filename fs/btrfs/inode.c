@@ -878,7 +878,9 @@ static void compress_file_range(struct btrfs_work *work)
 	int i;
 	int compress_type = fs_info->compress_type;
 	int compress_level = fs_info->compress_level;
+	u64 start_ns;
 
+	atomic_dec(&fs_info->compress_queued);
 	inode_should_defrag(inode, start, end, end - start + 1, SZ_16K);
 
 	/*
@@ -966,13 +968,19 @@ static void compress_file_range(struct btrfs_work *work)
 	} else if (inode->prop_compress) {
 		compress_type = inode->prop_compress;
 	}
+	if (!inode->defrag_compress && compress_type == BTRFS_COMPRESS_ZSTD &&
+	    READ_ONCE(fs_info->compress_adaptive))
+		compress_level = btrfs_compress_adaptive_level(fs_info);
 
 	/* Compression level is applied here. */
+	start_ns = ktime_get_ns();
 	ret = btrfs_compress_folios(compress_type, compress_level,
 				    mapping, start, folios, &nr_folios, &total_in,
 				    &total_compressed);
 	if (ret)
 		goto mark_incompressible;
+	btrfs_compress_account(fs_info, compress_type, compress_level, total_in,
+			       total_compressed, ktime_get_ns() - start_ns);
 
 	/*
 	 * Zero the tail end of the last page, as we might be sending it down
@@ -1678,6 +1686,7 @@ static bool run_delalloc_compressed(struct btrfs_inode *inode,
 
 		nr_pages = DIV_ROUND_UP(cur_end - start, PAGE_SIZE);
 		atomic_add(nr_pages, &fs_info->async_delalloc_pages);
+		atomic_inc(&fs_info->compress_queued);
 
 		btrfs_queue_work(fs_info->delalloc_workers, &async_chunk[i].work);
 
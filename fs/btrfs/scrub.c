@@ -49,15 +49,15 @@ struct scrub_ctx;
 #define SCRUB_STRIPES_PER_GROUP		8
 
 /*
- * How many groups we have for each sctx.
+ * How many groups we have for each sctx by default.
  *
  * This would be 8M per device, the same value as the old scrub in-flight bios
- * size limit.
+ * size limit.  It can be changed per device, up to
+ * BTRFS_SCRUB_MAX_QUEUE_DEPTH groups, via
+ * /sys/fs/UUID/devinfo/devid/scrub_queue_depth.
  */
 #define SCRUB_GROUPS_PER_SCTX		16
 
-#define SCRUB_TOTAL_STRIPES		(SCRUB_GROUPS_PER_SCTX * SCRUB_STRIPES_PER_GROUP)
-
 /*
  * The following value times PAGE_SIZE needs to be large enough to match the
  * largest node/leaf/sector size that shall be supported.
@@ -186,7 +186,8 @@ struct scrub_stripe {
 };
 
 struct scrub_ctx {
-	struct scrub_stripe	stripes[SCRUB_TOTAL_STRIPES];
+	struct scrub_stripe	*stripes;
+	int			nr_stripes;
 	struct scrub_stripe	*raid56_data_stripes;
 	struct btrfs_fs_info	*fs_info;
 	struct btrfs_path	extent_path;
@@ -330,10 +331,11 @@ static noinline_for_stack void scrub_free_ctx(struct scrub_ctx *sctx)
 	if (!sctx)
 		return;
 
-	for (i = 0; i < SCRUB_TOTAL_STRIPES; i++)
+	for (i = 0; sctx->stripes && i < sctx->nr_stripes; i++)
 		release_scrub_stripe(&sctx->stripes[i]);
 
-	kvfree(sctx);
+	kvfree(sctx->stripes);
+	kfree(sctx);
 }
 
 static void scrub_put_ctx(struct scrub_ctx *sctx)
@@ -343,17 +345,23 @@ static void scrub_put_ctx(struct scrub_ctx *sctx)
 }
 
 static noinline_for_stack struct scrub_ctx *scrub_setup_ctx(
-		struct btrfs_fs_info *fs_info, int is_dev_replace)
+		struct btrfs_fs_info *fs_info, int is_dev_replace,
+		unsigned int nr_groups)
 {
 	struct scrub_ctx *sctx;
 	int		i;
 
-	/* Since sctx has inline 128 stripes, it can go beyond 64K easily.  Use
-	 * kvzalloc().
-	 */
-	sctx = kvzalloc(sizeof(*sctx), GFP_KERNEL);
+	sctx = kzalloc(sizeof(*sctx), GFP_KERNEL);
 	if (!sctx)
 		goto nomem;
+	if (!nr_groups)
+		nr_groups = SCRUB_GROUPS_PER_SCTX;
+	sctx->nr_stripes = nr_groups * SCRUB_STRIPES_PER_GROUP;
+	/* The stripes can go beyond 64K easily, use kvcalloc(). */
+	sctx->stripes = kvcalloc(sctx->nr_stripes, sizeof(*sctx->stripes),
+				 GFP_KERNEL);
+	if (!sctx->stripes)
+		goto nomem;
 	refcount_set(&sctx->refs, 1);
 	sctx->is_dev_replace = is_dev_replace;
 	sctx->fs_info = fs_info;
@@ -361,7 +369,7 @@ static noinline_for_stack struct scrub_ctx *scrub_setup_ctx(
 	sctx->extent_path.skip_locking = 1;
 	sctx->csum_path.search_commit_root = 1;
 	sctx->csum_path.skip_locking = 1;
-	for (i = 0; i < SCRUB_TOTAL_STRIPES; i++) {
+	for (i = 0; i < sctx->nr_stripes; i++) {
 		int ret;
 
 		ret = init_scrub_stripe(fs_info, &sctx->stripes[i]);
@@ -1842,8 +1850,8 @@ static void submit_initial_group_read(struct scrub_ctx *sctx,
 {
 	struct blk_plug plug;
 
-	ASSERT(first_slot < SCRUB_TOTAL_STRIPES);
-	ASSERT(first_slot + nr_stripes <= SCRUB_TOTAL_STRIPES);
+	ASSERT(first_slot < sctx->nr_stripes);
+	ASSERT(first_slot + nr_stripes <= sctx->nr_stripes);
 
 	scrub_throttle_dev_io(sctx, sctx->stripes[0].dev,
 			      btrfs_stripe_nr_to_offset(nr_stripes));
@@ -1941,7 +1949,7 @@ static int queue_scrub_stripe(struct scrub_ctx *sctx, struct btrfs_block_group *
 	 * There should always be one slot left, as caller filling the last
 	 * slot should flush them all.
 	 */
-	ASSERT(sctx->cur_stripe < SCRUB_TOTAL_STRIPES);
+	ASSERT(sctx->cur_stripe < sctx->nr_stripes);
 
 	/* @found_logical_ret must be specified. */
 	ASSERT(found_logical_ret);
@@ -1965,7 +1973,7 @@ static int queue_scrub_stripe(struct scrub_ctx *sctx, struct btrfs_block_group *
 	}
 
 	/* Last slot used, flush them all. */
-	if (sctx->cur_stripe == SCRUB_TOTAL_STRIPES)
+	if (sctx->cur_stripe == sctx->nr_stripes)
 		return flush_scrub_stripes(sctx);
 	return 0;
 }
@@ -2941,6 +2949,7 @@ int btrfs_scrub_dev(struct btrfs_fs_info *fs_info, u64 devid, u64 start,
 	int ret;
 	struct btrfs_device *dev;
 	unsigned int nofs_flag;
+	unsigned int nr_groups = 0;
 	bool need_commit = false;
 
 	if (btrfs_fs_closing(fs_info))
@@ -2957,8 +2966,15 @@ int btrfs_scrub_dev(struct btrfs_fs_info *fs_info, u64 devid, u64 start,
 	ASSERT(fs_info->nodesize <=
 	       SCRUB_MAX_SECTORS_PER_BLOCK << fs_info->sectorsize_bits);
 
+	/* The queue depth is a hint, it's fine to read it before the checks. */
+	mutex_lock(&fs_info->fs_devices->device_list_mutex);
+	dev = btrfs_find_device(fs_info->fs_devices, &args);
+	if (dev)
+		nr_groups = READ_ONCE(dev->scrub_queue_depth);
+	mutex_unlock(&fs_info->fs_devices->device_list_mutex);
+
 	/* Allocate outside of device_list_mutex */
-	sctx = scrub_setup_ctx(fs_info, is_dev_replace);
+	sctx = scrub_setup_ctx(fs_info, is_dev_replace, nr_groups);
 	if (IS_ERR(sctx))
 		return PTR_ERR(sctx);
 
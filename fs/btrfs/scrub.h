@@ -9,6 +9,9 @@ struct btrfs_fs_info;
 struct btrfs_device;
 struct btrfs_scrub_progress;
 
+/* Maximum scrub queue depth of a device, in groups of 8 64K stripes. */
+#define BTRFS_SCRUB_MAX_QUEUE_DEPTH	64
+
 int btrfs_scrub_dev(struct btrfs_fs_info *fs_info, u64 devid, u64 start,
 		    u64 end, struct btrfs_scrub_progress *progress,
 		    int readonly, int is_dev_replace);
@@ -25,6 +25,8 @@
 #include "misc.h"
 #include "fs.h"
 #include "accessors.h"
+#include "compression.h"
+#include "scrub.h"
 
 /*
  * Structure name                       Path
@@ -1528,6 +1530,60 @@ static ssize_t btrfs_bg_reclaim_threshold_store(struct kobject *kobj,
 BTRFS_ATTR_RW(, bg_reclaim_threshold, btrfs_bg_reclaim_threshold_show,
 	      btrfs_bg_reclaim_threshold_store);
 
+static ssize_t btrfs_compress_adaptive_show(struct kobject *kobj,
+					    struct kobj_attribute *a, char *buf)
+{
+	struct btrfs_fs_info *fs_info = to_fs_info(kobj);
+
+	return sysfs_emit(buf, "%d\n", READ_ONCE(fs_info->compress_adaptive));
+}
+
+static ssize_t btrfs_compress_adaptive_store(struct kobject *kobj,
+					     struct kobj_attribute *a,
+					     const char *buf, size_t len)
+{
+	struct btrfs_fs_info *fs_info = to_fs_info(kobj);
+	bool val;
+	int ret;
+
+	ret = kstrtobool(buf, &val);
+	if (ret)
+		return ret;
+
+	if (val && !READ_ONCE(fs_info->compress_adaptive))
+		btrfs_compress_adaptive_start(fs_info);
+	WRITE_ONCE(fs_info->compress_adaptive, val);
+
+	return len;
+}
+BTRFS_ATTR_RW(, compress_adaptive, btrfs_compress_adaptive_show,
+	      btrfs_compress_adaptive_store);
+
+static ssize_t btrfs_compress_stats_show(struct kobject *kobj,
+					 struct kobj_attribute *a, char *buf)
+{
+	struct btrfs_fs_info *fs_info = to_fs_info(kobj);
+	ssize_t ret;
+	int i;
+
+	ret = sysfs_emit(buf, "adaptive_level %d\n",
+			 READ_ONCE(fs_info->compress_adaptive_level));
+	for (i = 0; i < BTRFS_ZSTD_STATS_LEVELS; i++) {
+		struct btrfs_compress_stats *stats = &fs_info->zstd_stats[i];
+		u64 extents = atomic64_read(&stats->extents);
+
+		if (!extents)
+			continue;
+		ret += sysfs_emit_at(buf, ret,
+			"zstd:%d extents %llu in_bytes %lld out_bytes %lld ms %llu\n",
+			i + 1, extents, atomic64_read(&stats->bytes_in),
+			atomic64_read(&stats->bytes_out),
+			div_u64(atomic64_read(&stats->ns), NSEC_PER_MSEC));
+	}
+	return ret;
+}
+BTRFS_ATTR(, compress_stats, btrfs_compress_stats_show);
+
 #ifdef CONFIG_BTRFS_EXPERIMENTAL
 static ssize_t btrfs_offload_csum_show(struct kobject *kobj,
 				       struct kobj_attribute *a, char *buf)
@@ -1588,6 +1644,8 @@ static const struct attribute *btrfs_attrs[] = {
 	BTRFS_ATTR_PTR(, bg_reclaim_threshold),
 	BTRFS_ATTR_PTR(, commit_stats),
 	BTRFS_ATTR_PTR(, temp_fsid),
+	BTRFS_ATTR_PTR(, compress_adaptive),
+	BTRFS_ATTR_PTR(, compress_stats),
 #ifdef CONFIG_BTRFS_EXPERIMENTAL
 	BTRFS_ATTR_PTR(, offload_csum),
 #endif
@@ -2059,6 +2117,37 @@ static ssize_t btrfs_devinfo_scrub_speed_max_store(struct kobject *kobj,
 BTRFS_ATTR_RW(devid, scrub_speed_max, btrfs_devinfo_scrub_speed_max_show,
 	      btrfs_devinfo_scrub_speed_max_store);
 
+static ssize_t btrfs_devinfo_scrub_queue_depth_show(struct kobject *kobj,
+						    struct kobj_attribute *a,
+						    char *buf)
+{
+	struct btrfs_device *device = container_of(kobj, struct btrfs_device,
+						   devid_kobj);
+
+	return sysfs_emit(buf, "%u\n", READ_ONCE(device->scrub_queue_depth));
+}
+
+/* Applied on the next start of a scrub of the device. */
+static ssize_t btrfs_devinfo_scrub_queue_depth_store(struct kobject *kobj,
+						     struct kobj_attribute *a,
+						     const char *buf, size_t len)
+{
+	struct btrfs_device *device = container_of(kobj, struct btrfs_device,
+						   devid_kobj);
+	u32 depth;
+	int ret;
+
+	ret = kstrtou32(buf, 10, &depth);
+	if (ret)
+		return ret;
+	if (depth > BTRFS_SCRUB_MAX_QUEUE_DEPTH)
+		return -EINVAL;
+	WRITE_ONCE(device->scrub_queue_depth, depth);
+	return len;
+}
+BTRFS_ATTR_RW(devid, scrub_queue_depth, btrfs_devinfo_scrub_queue_depth_show,
+	      btrfs_devinfo_scrub_queue_depth_store);
+
 static ssize_t btrfs_devinfo_writeable_show(struct kobject *kobj,
 					    struct kobj_attribute *a, char *buf)
 {
@@ -2122,6 +2211,7 @@ static struct attribute *devid_attrs[] = {
 	BTRFS_ATTR_PTR(devid, missing),
 	BTRFS_ATTR_PTR(devid, replace_target),
 	BTRFS_ATTR_PTR(devid, scrub_speed_max),
+	BTRFS_ATTR_PTR(devid, scrub_queue_depth),
 	BTRFS_ATTR_PTR(devid, writeable),
 	NULL
 };
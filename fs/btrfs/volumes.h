@@ -201,6 +201,8 @@ struct btrfs_device {
 
 	/* Bandwidth limit for scrub, in bytes */
 	u64 scrub_speed_max;
+	/* Scrub queue depth in groups of stripes, 0 for the default */
+	u32 scrub_queue_depth;
 };
 
 /*
@@ -32,6 +32,9 @@
 #include <linux/bit_spinlock.h>
 #include <linux/rculist_bl.h>
 #include <linux/list_lru.h>
+#include <linux/prefetch.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
 #include "internal.h"
 #include "mount.h"
 
@@ -142,6 +145,13 @@ static DEFINE_PER_CPU(long, nr_dentry_unused);
 static DEFINE_PER_CPU(long, nr_dentry_negative);
 static int dentry_negative_policy;
 
+/*
+ * Maximum number of unused negative dentries per superblock, 0 for no limit.
+ * Above the limit, the negative dentries of the superblock are pruned in the
+ * background, before any positive ones.
+ */
+static unsigned long dentry_negative_limit;
+
 #if defined(CONFIG_SYSCTL) && defined(CONFIG_PROC_FS)
 /* Statistics gathering. */
 static struct dentry_stat_t dentry_stat = {
@@ -214,6 +224,13 @@ static const struct ctl_table fs_dcache_sysctls[] = {
 		.extra1		= SYSCTL_ZERO,
 		.extra2		= SYSCTL_ONE,
 	},
+	{
+		.procname	= "dentry-negative-limit",
+		.data		= &dentry_negative_limit,
+		.maxlen		= sizeof(dentry_negative_limit),
+		.mode		= 0644,
+		.proc_handler	= proc_doulongvec_minmax,
+	},
 };
 
 static const struct ctl_table vm_dcache_sysctls[] = {
@@ -236,6 +253,37 @@ static int __init init_fs_dcache_sysctls(void)
 fs_initcall(init_fs_dcache_sysctls);
 #endif
 
+#ifdef CONFIG_PROC_FS
+static void dentry_state_sb_show_one(struct super_block *sb, void *arg)
+{
+	struct seq_file *m = arg;
+
+	seq_printf(m, "%s %s %lu %lld %ld\n", sb->s_id, sb->s_type->name,
+		   list_lru_count(&sb->s_dentry_lru),
+		   percpu_counter_sum_positive(&sb->s_dentry_negative),
+		   atomic_long_read(&sb->s_dentry_negative_pruned));
+}
+
+/*
+ * Per superblock counterpart of /proc/sys/fs/dentry-state: unused dentries,
+ * unused negative dentries and negative dentries pruned for being above
+ * dentry-negative-limit.
+ */
+static int dentry_state_sb_show(struct seq_file *m, void *v)
+{
+	iterate_supers(dentry_state_sb_show_one, m);
+	return 0;
+}
+
+static int __init init_dentry_state_sb(void)
+{
+	proc_create_single("fs/dentry-state-sb", 0444, NULL,
+			   dentry_state_sb_show);
+	return 0;
+}
+fs_initcall(init_dentry_state_sb);
+#endif
+
 /*
  * Compare 2 name strings, return 0 if they match, otherwise non-zero.
  * The strings are both count bytes long, and count is non-zero.
@@ -401,6 +449,29 @@ static inline void __d_set_inode_and_type(struct dentry *dentry,
 	smp_store_release(&dentry->d_flags, flags);
 }
 
+/*
+ * Account a negative dentry that was put on, or became negative on, the
+ * superblock LRU list, and kick the pruning if there are too many of them.
+ */
+static void dentry_negative_inc(struct dentry *dentry)
+{
+	struct super_block *sb = dentry->d_sb;
+	unsigned long limit = READ_ONCE(dentry_negative_limit);
+
+	this_cpu_inc(nr_dentry_negative);
+	percpu_counter_inc(&sb->s_dentry_negative);
+	if (limit &&
+	    percpu_counter_read_positive(&sb->s_dentry_negative) > limit &&
+	    !work_pending(&sb->s_dentry_negative_work))
+		queue_work(system_unbound_wq, &sb->s_dentry_negative_work);
+}
+
+static void dentry_negative_dec(struct dentry *dentry)
+{
+	this_cpu_dec(nr_dentry_negative);
+	percpu_counter_dec(&dentry->d_sb->s_dentry_negative);
+}
+
 static inline void __d_clear_type_and_inode(struct dentry *dentry)
 {
 	unsigned flags = READ_ONCE(dentry->d_flags);
@@ -413,7 +484,7 @@ static inline void __d_clear_type_and_inode(struct dentry *dentry)
 	 * d_lru is on another list.
 	 */
 	if ((flags & (DCACHE_LRU_LIST|DCACHE_SHRINK_LIST)) == DCACHE_LRU_LIST)
-		this_cpu_inc(nr_dentry_negative);
+		dentry_negative_inc(dentry);
 }
 
 static void dentry_free(struct dentry *dentry)
@@ -468,7 +539,8 @@ static void dentry_unlink_inode(struct dentry * dentry)
  * The per-cpu "nr_dentry_unused" counters are updated with
  * the DCACHE_LRU_LIST bit.
  *
- * The per-cpu "nr_dentry_negative" counters are only updated
+ * The per-cpu "nr_dentry_negative" counters and the per-superblock
+ * "s_dentry_negative" counter are only updated
  * when deleted from or added to the per-superblock LRU list, not
  * from/to the shrink list. That is to avoid an unneeded dec/inc
  * pair when moving from LRU to shrink list in select_collect().
@@ -483,7 +555,7 @@ static void d_lru_add(struct dentry *dentry)
 	dentry->d_flags |= DCACHE_LRU_LIST;
 	this_cpu_inc(nr_dentry_unused);
 	if (d_is_negative(dentry))
-		this_cpu_inc(nr_dentry_negative);
+		dentry_negative_inc(dentry);
 	WARN_ON_ONCE(!list_lru_add_obj(
 			&dentry->d_sb->s_dentry_lru, &dentry->d_lru));
 }
@@ -494,7 +566,7 @@ static void d_lru_del(struct dentry *dentry)
 	dentry->d_flags &= ~DCACHE_LRU_LIST;
 	this_cpu_dec(nr_dentry_unused);
 	if (d_is_negative(dentry))
-		this_cpu_dec(nr_dentry_negative);
+		dentry_negative_dec(dentry);
 	WARN_ON_ONCE(!list_lru_del_obj(
 			&dentry->d_sb->s_dentry_lru, &dentry->d_lru));
 }
@@ -527,7 +599,7 @@ static void d_lru_isolate(struct list_lru_one *lru, struct dentry *dentry)
 	dentry->d_flags &= ~DCACHE_LRU_LIST;
 	this_cpu_dec(nr_dentry_unused);
 	if (d_is_negative(dentry))
-		this_cpu_dec(nr_dentry_negative);
+		dentry_negative_dec(dentry);
 	list_lru_isolate(lru, &dentry->d_lru);
 }
 
@@ -537,7 +609,7 @@ static void d_lru_shrink_move(struct list_lru_one *lru, struct dentry *dentry,
 	D_FLAG_VERIFY(dentry, DCACHE_LRU_LIST);
 	dentry->d_flags |= DCACHE_SHRINK_LIST;
 	if (d_is_negative(dentry))
-		this_cpu_dec(nr_dentry_negative);
+		dentry_negative_dec(dentry);
 	list_lru_isolate_move(lru, &dentry->d_lru, list);
 }
 
@@ -1214,6 +1286,72 @@ long prune_dcache_sb(struct super_block *sb, struct shrink_control *sc)
 	return freed;
 }
 
+static enum lru_status dentry_lru_isolate_negative(struct list_head *item,
+		struct list_lru_one *lru, void *arg)
+{
+	struct list_head *freeable = arg;
+	struct dentry	*dentry = container_of(item, struct dentry, d_lru);
+
+	if (!spin_trylock(&dentry->d_lock))
+		return LRU_SKIP;
+
+	if (dentry->d_lockref.count) {
+		d_lru_isolate(lru, dentry);
+		spin_unlock(&dentry->d_lock);
+		return LRU_REMOVED;
+	}
+
+	/*
+	 * Positive dentries are rotated rather than skipped, so that the
+	 * next batch does not walk them again.
+	 */
+	if (!d_is_negative(dentry) || (dentry->d_flags & DCACHE_REFERENCED)) {
+		dentry->d_flags &= ~DCACHE_REFERENCED;
+		spin_unlock(&dentry->d_lock);
+		return LRU_ROTATE;
+	}
+
+	d_lru_shrink_move(lru, dentry, freeable);
+	spin_unlock(&dentry->d_lock);
+
+	return LRU_REMOVED;
+}
+
+/**
+ * prune_dcache_sb_negative - prune the negative dentries of a superblock
+ * @sb: superblock
+ *
+ * Free unused negative dentries of @sb until there are 7/8 of
+ * dentry-negative-limit of them left, so the pruning does not run again for
+ * each new negative dentry.  At most one pass is made over the LRU list.
+ *
+ * Called with @sb->s_umount held shared.
+ */
+void prune_dcache_sb_negative(struct super_block *sb)
+{
+	unsigned long limit = READ_ONCE(dentry_negative_limit);
+	unsigned long nr_walk;
+
+	if (!limit)
+		return;
+
+	nr_walk = list_lru_count(&sb->s_dentry_lru);
+	while (nr_walk &&
+	       percpu_counter_sum_positive(&sb->s_dentry_negative) >
+	       limit - limit / 8) {
+		unsigned long nr_to_walk = min(nr_walk, 1024UL);
+		LIST_HEAD(dispose);
+
+		nr_walk -= nr_to_walk;
+		list_lru_walk(&sb->s_dentry_lru, dentry_lru_isolate_negative,
+			      &dispose, nr_to_walk);
+		atomic_long_add(list_count_nodes(&dispose),
+				&sb->s_dentry_negative_pruned);
+		shrink_dentry_list(&dispose);
+		cond_resched();
+	}
+}
+
 static enum lru_status dentry_lru_isolate_shrink(struct list_head *item,
 		struct list_lru_one *lru, void *arg)
 {
@@ -1905,7 +2043,7 @@ static void __d_instantiate(struct dentry *dentry, struct inode *inode)
 	 */
 	if ((dentry->d_flags &
 	     (DCACHE_LRU_LIST|DCACHE_SHRINK_LIST)) == DCACHE_LRU_LIST)
-		this_cpu_dec(nr_dentry_negative);
+		dentry_negative_dec(dentry);
 	hlist_add_head(&dentry->d_u.d_alias, &inode->i_dentry);
 	raw_write_seqcount_begin(&dentry->d_seq);
 	__d_set_inode_and_type(dentry, inode, add_flags);
@@ -2414,6 +2552,50 @@ struct dentry *d_hash_and_lookup(struct dentry *dir, struct qstr *name)
 }
 EXPORT_SYMBOL(d_hash_and_lookup);
 
+/* Number of hash buckets to prefetch ahead of the lookup */
+#define D_LOOKUP_MANY_PREFETCH	8
+
+/**
+ * d_lookup_many - hash and search for several names in one directory
+ * @dir: Directory to search in
+ * @names: qstrs of the names we wish to find, their hashes are set
+ * @nr: number of names
+ * @dentries: the dentries found, NULL for the names that are not cached
+ *
+ * Looking up many names in a row mostly waits for the cache misses on the
+ * hash buckets.  Hash all names first, and prefetch the buckets ahead of the
+ * lookups.  The dentries found are referenced, as with d_lookup().
+ *
+ * Returns the number of dentries found, or -error on a bad name.
+ */
+int d_lookup_many(struct dentry *dir, struct qstr *names, unsigned int nr,
+		  struct dentry **dentries)
+{
+	unsigned int i;
+	int found = 0;
+
+	for (i = 0; i < nr; i++) {
+		names[i].hash = full_name_hash(dir, names[i].name,
+					       names[i].len);
+		if (dir->d_flags & DCACHE_OP_HASH) {
+			int err = dir->d_op->d_hash(dir, &names[i]);
+			if (unlikely(err < 0))
+				return err;
+		}
+		if (i < D_LOOKUP_MANY_PREFETCH)
+			prefetch(d_hash(names[i].hash));
+	}
+
+	for (i = 0; i < nr; i++) {
+		if (i + D_LOOKUP_MANY_PREFETCH < nr)
+			prefetch(d_hash(names[i + D_LOOKUP_MANY_PREFETCH].hash));
+		dentries[i] = d_lookup(dir, &names[i]);
+		if (dentries[i])
+			found++;
+	}
+	return found;
+}
+
 /*
  * When a file is deleted, we have two options:
  * - turn this dentry into a negative dentry
@@ -3177,14 +3359,20 @@ static void __init dcache_init_early(void)
 
 static void __init dcache_init(void)
 {
+	struct kmem_cache_args args = {
+		.align = __alignof__(struct dentry),
+		.useroffset = offsetof(struct dentry, d_shortname.string),
+		.usersize = sizeof_field(struct dentry, d_shortname.string),
+		.sheaf_capacity = 32,
+	};
+
 	/*
 	 * A constructor could be added for stable state like the lists,
 	 * but it is probably not worth it because of the cache nature
 	 * of the dcache.
 	 */
-	dentry_cache = KMEM_CACHE_USERCOPY(dentry,
-		SLAB_RECLAIM_ACCOUNT|SLAB_PANIC|SLAB_ACCOUNT,
-		d_shortname.string);
+	dentry_cache = kmem_cache_create("dentry", sizeof(struct dentry), &args,
+		SLAB_RECLAIM_ACCOUNT|SLAB_PANIC|SLAB_ACCOUNT);
 
 	/* Hash may have been set up in dcache_init_early */
 	if (!hashdist)
@@ -56,6 +56,9 @@ enum {
 	EROFS_SYNC_DECOMPRESS_FORCE_OFF
 };
 
+/* default max number of CPUs decompressing pclusters of one I/O together */
+#define EROFS_DEFAULT_DECOMPRESS_JOBS	4
+
 struct erofs_mount_opts {
 	/* current strategy of how to use managed cache */
 	unsigned char cache_strategy;
@@ -63,6 +66,8 @@ struct erofs_mount_opts {
 	unsigned int sync_decompress;
 	/* threshold for decompression synchronously */
 	unsigned int max_sync_decompress_pages;
+	/* max number of parallel decompression jobs for one I/O (1 - off) */
+	unsigned int max_decompress_jobs;
 	unsigned int mount_opt;
 };
 
@@ -123,6 +128,10 @@ struct erofs_sb_info {
 	struct inode *managed_cache;
 
 	struct erofs_sb_lz4_info lz4;
+
+	/* decompressed pclusters and time spent, by compression algorithm */
+	atomic64_t decompress_nr[Z_EROFS_COMPRESSION_MAX];
+	atomic64_t decompress_nsec[Z_EROFS_COMPRESSION_MAX];
 #endif	/* CONFIG_EROFS_FS_ZIP */
 	struct inode *packed_inode;
 	struct erofs_dev_context *devs;
@@ -452,6 +461,7 @@ int z_erofs_gbuf_growsize(unsigned int nrpages);
 int __init z_erofs_gbuf_init(void);
 void z_erofs_gbuf_exit(void);
 int z_erofs_parse_cfgs(struct super_block *sb, struct erofs_super_block *dsb);
+ssize_t z_erofs_decompress_stats_show(struct erofs_sb_info *sbi, char *buf);
 #else
 static inline void erofs_shrinker_register(struct super_block *sb) {}
 static inline void erofs_shrinker_unregister(struct super_block *sb) {}
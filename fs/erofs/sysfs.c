@@ -13,6 +13,7 @@ enum {
 	attr_drop_caches,
 	attr_pointer_ui,
 	attr_pointer_bool,
+	attr_decompress_stats,
 };
 
 enum {
@@ -58,13 +59,17 @@ static struct erofs_attr erofs_attr_##_name = {			\
 
 #ifdef CONFIG_EROFS_FS_ZIP
 EROFS_ATTR_RW_UI(sync_decompress, erofs_mount_opts);
+EROFS_ATTR_RW_UI(max_decompress_jobs, erofs_mount_opts);
 EROFS_ATTR_FUNC(drop_caches, 0200);
+EROFS_ATTR_FUNC(decompress_stats, 0444);
 #endif
 
 static struct attribute *erofs_attrs[] = {
 #ifdef CONFIG_EROFS_FS_ZIP
 	ATTR_LIST(sync_decompress),
+	ATTR_LIST(max_decompress_jobs),
 	ATTR_LIST(drop_caches),
+	ATTR_LIST(decompress_stats),
 #endif
 	NULL,
 };
@@ -128,6 +133,10 @@ static ssize_t erofs_attr_show(struct kobject *kobj,
 		if (!ptr)
 			return 0;
 		return sysfs_emit(buf, "%d\n", *(bool *)ptr);
+#ifdef CONFIG_EROFS_FS_ZIP
+	case attr_decompress_stats:
+		return z_erofs_decompress_stats_show(sbi, buf);
+#endif
 	}
 	return 0;
 }
@@ -155,6 +164,8 @@ static ssize_t erofs_attr_store(struct kobject *kobj, struct attribute *attr,
 		if (!strcmp(a->attr.name, "sync_decompress") &&
 		    (t > EROFS_SYNC_DECOMPRESS_FORCE_OFF))
 			return -EINVAL;
+		if (!strcmp(a->attr.name, "max_decompress_jobs") && !t)
+			return -EINVAL;
 #endif
 		*(unsigned int *)ptr = t;
 		return len;
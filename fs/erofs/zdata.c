@@ -1273,7 +1273,9 @@ static int z_erofs_decompress_pcluster(struct z_erofs_backend *be, int err)
 	err2 = z_erofs_parse_in_bvecs(be, &overlapped);
 	if (err2)
 		err = err2;
-	if (!err)
+	if (!err) {
+		u64 start = ktime_get_ns();
+
 		err = decomp->decompress(&(struct z_erofs_decompress_req) {
 					.sb = be->sb,
 					.in = be->compressed_pages,
@@ -1292,6 +1294,13 @@ static int z_erofs_decompress_pcluster(struct z_erofs_backend *be, int err)
 						GFP_NOWAIT | __GFP_NORETRY
 				 }, be->pagepool);
 
+		if (pcl->algorithmformat < Z_EROFS_COMPRESSION_MAX) {
+			atomic64_inc(&sbi->decompress_nr[pcl->algorithmformat]);
+			atomic64_add(ktime_get_ns() - start,
+				&sbi->decompress_nsec[pcl->algorithmformat]);
+		}
+	}
+
 	/* must handle all compressed pages before actual file pages */
 	if (pcl->from_meta) {
 		page = pcl->compressed_bvecs[0].page;
@@ -1359,20 +1368,22 @@ static int z_erofs_decompress_pcluster(struct z_erofs_backend *be, int err)
 	return err;
 }
 
-static int z_erofs_decompress_queue(const struct z_erofs_decompressqueue *io,
+/* decompress (up to) @nr pclusters of the chain starting at @pcl */
+static int z_erofs_decompress_chain(struct super_block *sb,
+				    struct z_erofs_pcluster *pcl,
+				    unsigned int nr, int err,
 				    struct page **pagepool)
 {
 	struct z_erofs_backend be = {
-		.sb = io->sb,
+		.sb = sb,
 		.pagepool = pagepool,
 		.decompressed_secondary_bvecs =
 			LIST_HEAD_INIT(be.decompressed_secondary_bvecs),
-		.pcl = io->head,
+		.pcl = pcl,
 	};
 	struct z_erofs_pcluster *next;
-	int err = io->eio ? -EIO : 0;
 
-	for (; be.pcl != Z_EROFS_PCLUSTER_TAIL; be.pcl = next) {
+	for (; nr && be.pcl != Z_EROFS_PCLUSTER_TAIL; be.pcl = next, --nr) {
 		DBG_BUGON(!be.pcl);
 		next = READ_ONCE(be.pcl->next);
 		err = z_erofs_decompress_pcluster(&be, err) ?: err;
@@ -1380,6 +1391,159 @@ static int z_erofs_decompress_queue(const struct z_erofs_decompressqueue *io,
 	return err;
 }
 
+/* don't bother other CPUs for less decompressed data than this per job */
+#define Z_EROFS_PARALLEL_MIN_BYTES	SZ_128K
+
+struct z_erofs_decompress_jobs;
+
+struct z_erofs_decompress_job {
+	struct work_struct work;
+	struct z_erofs_decompress_jobs *jobs;
+	struct z_erofs_pcluster *head;
+	unsigned int nr;
+	int err;
+};
+
+/*
+ * Pclusters are independent of each other, so a long chain (e.g. of a large
+ * readahead window) is cut into jobs which are decompressed on multiple CPUs.
+ * The first job is always handled by the caller.
+ */
+struct z_erofs_decompress_jobs {
+	struct super_block *sb;
+	atomic_t pending;
+	/* if set, the caller waits for all jobs and frees them */
+	bool sync;
+	struct completion done;
+	unsigned int nr_jobs;
+	struct z_erofs_decompress_job job[];
+};
+
+static void z_erofs_put_decompress_jobs(struct z_erofs_decompress_jobs *jobs)
+{
+	if (!atomic_dec_and_test(&jobs->pending))
+		return;
+	if (jobs->sync)
+		complete(&jobs->done);
+	else
+		kvfree(jobs);
+}
+
+static void z_erofs_decompress_job_work(struct work_struct *work)
+{
+	struct z_erofs_decompress_job *job =
+		container_of(work, struct z_erofs_decompress_job, work);
+	struct page *pagepool = NULL;
+
+	job->err = z_erofs_decompress_chain(job->jobs->sb, job->head, job->nr,
+					    job->err, &pagepool);
+	erofs_release_pages(&pagepool);
+	z_erofs_put_decompress_jobs(job->jobs);
+}
+
+static struct z_erofs_decompress_jobs *z_erofs_split_queue(
+		const struct z_erofs_decompressqueue *io, int err)
+{
+	struct erofs_sb_info *const sbi = EROFS_SB(io->sb);
+	unsigned int max_jobs = min(READ_ONCE(sbi->opt.max_decompress_jobs),
+				    num_online_cpus());
+	struct z_erofs_decompress_jobs *jobs;
+	struct z_erofs_pcluster *pcl;
+	unsigned int nr = 0, nr_jobs, i;
+	u64 total = 0, done = 0;
+
+	if (max_jobs < 2)
+		return NULL;
+
+	/* lengths are only balancing hints, they can't change much though */
+	for (pcl = io->head; pcl != Z_EROFS_PCLUSTER_TAIL;
+	     pcl = READ_ONCE(pcl->next)) {
+		total += READ_ONCE(pcl->length);
+		++nr;
+	}
+	nr_jobs = min_t(u64, min(max_jobs, nr),
+			div_u64(total, Z_EROFS_PARALLEL_MIN_BYTES));
+	if (nr_jobs < 2)
+		return NULL;
+
+	jobs = kvzalloc(struct_size(jobs, job, nr_jobs),
+			GFP_KERNEL | __GFP_NOWARN);
+	if (!jobs)
+		return NULL;
+
+	/* cut the chain into jobs of about the same decompressed size */
+	i = 0;
+	jobs->job[0].head = io->head;
+	for (pcl = io->head; pcl != Z_EROFS_PCLUSTER_TAIL;
+	     pcl = READ_ONCE(pcl->next)) {
+		if (i + 1 < nr_jobs &&
+		    done >= div_u64(total * (i + 1), nr_jobs))
+			jobs->job[++i].head = pcl;
+		done += READ_ONCE(pcl->length);
+		++jobs->job[i].nr;
+	}
+
+	jobs->sb = io->sb;
+	jobs->sync = io->sync;
+	jobs->nr_jobs = i + 1;
+	atomic_set(&jobs->pending, jobs->nr_jobs);
+	init_completion(&jobs->done);
+	for (i = 0; i < jobs->nr_jobs; ++i) {
+		jobs->job[i].jobs = jobs;
+		jobs->job[i].err = err;
+		INIT_WORK(&jobs->job[i].work, z_erofs_decompress_job_work);
+	}
+	return jobs;
+}
+
+static int z_erofs_decompress_queue(const struct z_erofs_decompressqueue *io,
+				    struct page **pagepool)
+{
+	struct z_erofs_decompress_jobs *jobs;
+	int err = io->eio ? -EIO : 0;
+	unsigned int i;
+	bool sync;
+
+	jobs = z_erofs_split_queue(io, err);
+	if (!jobs)
+		return z_erofs_decompress_chain(io->sb, io->head, UINT_MAX,
+						err, pagepool);
+
+	for (i = 1; i < jobs->nr_jobs; ++i)
+		queue_work(z_erofs_workqueue, &jobs->job[i].work);
+
+	err = z_erofs_decompress_chain(io->sb, jobs->job[0].head,
+				       jobs->job[0].nr, err, pagepool);
+	/* async jobs can be freed by others once our reference is dropped */
+	sync = jobs->sync;
+	z_erofs_put_decompress_jobs(jobs);
+	if (!sync)
+		return err;
+
+	wait_for_completion(&jobs->done);
+	for (i = 1; i < jobs->nr_jobs; ++i)
+		err = err ?: jobs->job[i].err;
+	kvfree(jobs);
+	return err;
+}
+
+ssize_t z_erofs_decompress_stats_show(struct erofs_sb_info *sbi, char *buf)
+{
+	ssize_t len = 0;
+	int i;
+
+	for (i = 0; i < Z_EROFS_COMPRESSION_MAX; ++i) {
+		if (!z_erofs_decomp[i])
+			continue;
+		len += sysfs_emit_at(buf, len, "%s %llu %llu\n",
+				     z_erofs_decomp[i]->name,
+				     atomic64_read(&sbi->decompress_nr[i]),
+				     div_u64(atomic64_read(&sbi->decompress_nsec[i]),
+					     NSEC_PER_USEC));
+	}
+	return len;
+}
+
 static void z_erofs_decompressqueue_work(struct work_struct *work)
 {
 	struct z_erofs_decompressqueue *bgq =
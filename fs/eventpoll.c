@@ -1341,6 +1341,7 @@ static int ep_poll_callback(wait_queue_entry_t *wait, unsigned mode, int sync, v
 	__poll_t pollflags = key_to_poll(key);
 	unsigned long flags;
 	int ewake = 0;
+	bool queued = false;
 
 	read_lock_irqsave(&ep->lock, flags);
 
@@ -1371,17 +1372,32 @@ static int ep_poll_callback(wait_queue_entry_t *wait, unsigned mode, int sync, v
 	 * chained in ep->ovflist and requeued later on.
 	 */
 	if (READ_ONCE(ep->ovflist) != EP_UNACTIVE_PTR) {
-		if (chain_epi_lockless(epi))
+		if (chain_epi_lockless(epi)) {
 			ep_pm_stay_awake_rcu(epi);
+			queued = true;
+		}
 	} else if (!ep_is_linked(epi)) {
 		/* In the usual case, add event to ready list. */
-		if (list_add_tail_lockless(&epi->rdllink, &ep->rdllist))
+		if (list_add_tail_lockless(&epi->rdllink, &ep->rdllist)) {
 			ep_pm_stay_awake_rcu(epi);
+			queued = true;
+		}
 	}
 
 	/*
 	 * Wake up ( if active ) both the eventpoll wait list and the ->poll()
 	 * wait list.
+	 *
+	 * If @epi was already queued, whoever queued it has woken up ep->wq
+	 * and the waiter will see the new events when it harvests @epi, so
+	 * don't take the wait queue lock again.  This matters for a busy fd,
+	 * e.g. a listening socket shared by many threads, which calls us once
+	 * per incoming packet.  EPOLLEXCLUSIVE still reports the wakeup as
+	 * consumed, so that it does not spill over to other epoll instances.
+	 *
+	 * The ->poll() wait list is always woken up: nested epoll instances
+	 * and other pollers of this epoll file may rely on a wakeup for each
+	 * event, e.g. edge triggered nested epoll.
 	 */
 	if (waitqueue_active(&ep->wq)) {
 		if ((epi->event.events & EPOLLEXCLUSIVE) &&
@@ -1400,9 +1416,9 @@ static int ep_poll_callback(wait_queue_entry_t *wait, unsigned mode, int sync, v
 				break;
 			}
 		}
-		if (sync)
+		if (queued && sync)
 			wake_up_sync(&ep->wq);
-		else
+		else if (queued)
 			wake_up(&ep->wq);
 	}
 	if (waitqueue_active(&ep->poll_wait))
@@ -1859,8 +1875,16 @@ static int ep_send_events(struct eventpoll *ep,
 	 * timely exit without the chance of finding more events available and
 	 * fetching repeatedly.
 	 */
-	if (fatal_signal_pending(current))
+	if (fatal_signal_pending(current)) {
+		/*
+		 * We may have consumed the only wakeup for the ready items,
+		 * ep_poll_callback() does not repeat it for items that are
+		 * already queued, so pass it on to the next waiter.
+		 */
+		if (ep_events_available(ep))
+			wake_up(&ep->wq);
 		return -EINTR;
+	}
 
 	init_poll_funcptr(&pt, NULL);
 
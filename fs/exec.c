@@ -1115,6 +1115,9 @@ static int de_thread(struct task_struct *tsk)
 
 		tsk->group_leader = tsk;
 		leader->group_leader = tsk;
+#ifdef CONFIG_SCHED_BORE
+		sched_exec_bore(tsk);
+#endif
 
 		tsk->exit_signal = SIGCHLD;
 		leader->exit_signal = -1;
@@ -1243,6 +1246,9 @@ int begin_new_exec(struct linux_binprm * bprm)
 	 */
 	io_uring_task_cancel();
 
+	/* The new program expects the lowest available descriptors */
+	fd_cache_free(me);
+
 	/* Ensure the files table is not shared. */
 	retval = unshare_files();
 	if (retval)
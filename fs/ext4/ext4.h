@@ -176,6 +176,12 @@ enum criteria {
 	EXT4_MB_NUM_CRS
 };
 
+/*
+ * Number of log2 buckets of the allocation latency histogram. The last
+ * bucket collects all allocations that took 2^30 ns or longer.
+ */
+#define EXT4_MB_LATENCY_BUCKETS	32
+
 /*
  * Flags used in mballoc's allocation_context flags field.
  *
@@ -1588,10 +1594,8 @@ struct ext4_sb_info {
 	struct list_head s_discard_list;
 	struct work_struct s_discard_work;
 	atomic_t s_retry_alloc_pending;
-	struct list_head *s_mb_avg_fragment_size;
-	rwlock_t *s_mb_avg_fragment_size_locks;
-	struct list_head *s_mb_largest_free_orders;
-	rwlock_t *s_mb_largest_free_orders_locks;
+	struct xarray *s_mb_avg_fragment_size;
+	struct xarray *s_mb_largest_free_orders;
 
 	/* tunables */
 	unsigned long s_stripe;
@@ -1603,9 +1607,8 @@ struct ext4_sb_info {
 	unsigned int s_mb_order2_reqs;
 	unsigned int s_mb_group_prealloc;
 	unsigned int s_max_dir_size_kb;
-	/* where last allocation was done - for stream allocation */
-	unsigned long s_mb_last_group;
-	unsigned long s_mb_last_start;
+	/* where last allocation was done on each CPU - for stream allocation */
+	ext4_fsblk_t __percpu *s_mb_last_goal;
 	unsigned int s_mb_prefetch;
 	unsigned int s_mb_prefetch_limit;
 	unsigned int s_mb_best_avail_max_trim_order;
@@ -1635,6 +1638,8 @@ struct ext4_sb_info {
 	atomic_t s_mb_preallocated;
 	atomic_t s_mb_discarded;
 	atomic_t s_lock_busy;
+	/* log2 histogram of regular allocator latencies, in ns */
+	atomic64_t s_bal_latency[EXT4_MB_LATENCY_BUCKETS];
 
 	/* locality groups */
 	struct ext4_locality_group __percpu *s_locality_groups;
@@ -1758,6 +1763,7 @@ struct ext4_sb_info {
 	struct buffer_head *s_fc_bh;
 	struct ext4_fc_stats s_fc_stats;
 	tid_t s_fc_ineligible_tid;
+	int s_fc_ineligible_reason;	/* reason of the latest marking */
 #ifdef CONFIG_EXT4_DEBUG
 	int s_fc_debug_max_replay;
 #endif
@@ -3449,8 +3455,6 @@ struct ext4_group_info {
 	void            *bb_bitmap;
 #endif
 	struct rw_semaphore alloc_sem;
-	struct list_head bb_avg_fragment_size_node;
-	struct list_head bb_largest_free_order_node;
 	ext4_grpblk_t	bb_counters[];	/* Nr of free power-of-two-block
 					 * regions, index is order.
 					 * bb_counters[3] = 5 means
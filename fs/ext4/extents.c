@@ -5322,11 +5322,15 @@ static int ext4_collapse_range(struct file *file, loff_t offset, loff_t len)
 	if (IS_ERR(handle))
 		return PTR_ERR(handle);
 
-	ext4_fc_mark_ineligible(sb, EXT4_FC_REASON_FALLOC_RANGE, handle);
-
 	start_lblk = offset >> inode->i_blkbits;
 	end_lblk = (offset + len) >> inode->i_blkbits;
 
+	/*
+	 * All the extents after the collapsed range move, so let the fast
+	 * commit log the resulting mapping of everything from start_lblk on.
+	 */
+	ext4_fc_track_range(handle, inode, start_lblk, EXT_MAX_BLOCKS - 1);
+
 	down_write(&EXT4_I(inode)->i_data_sem);
 	ext4_discard_preallocations(inode);
 	ext4_es_remove_extent(inode, start_lblk, EXT_MAX_BLOCKS - start_lblk);
@@ -5416,7 +5420,9 @@ static int ext4_insert_range(struct file *file, loff_t offset, loff_t len)
 	if (IS_ERR(handle))
 		return PTR_ERR(handle);
 
-	ext4_fc_mark_ineligible(sb, EXT4_FC_REASON_FALLOC_RANGE, handle);
+	/* See ext4_collapse_range() */
+	ext4_fc_track_range(handle, inode, offset >> inode->i_blkbits,
+			    EXT_MAX_BLOCKS - 1);
 
 	/* Expand file to avoid data loss if there is error while shifting */
 	inode->i_size += len;
@@ -358,8 +358,9 @@ void ext4_fc_mark_ineligible(struct super_block *sb, int reason, handle_t *handl
 	if (has_transaction && (!is_ineligible || tid_gt(tid, sbi->s_fc_ineligible_tid)))
 		sbi->s_fc_ineligible_tid = tid;
 	ext4_set_mount_flag(sb, EXT4_MF_FC_INELIGIBLE);
+	if (!WARN_ON(reason >= EXT4_FC_REASON_MAX))
+		sbi->s_fc_ineligible_reason = reason;
 	spin_unlock(&sbi->s_fc_lock);
-	WARN_ON(reason >= EXT4_FC_REASON_MAX);
 	sbi->s_fc_stats.fc_ineligible_reason_count[reason]++;
 }
 
@@ -1225,6 +1226,8 @@ int ext4_fc_commit(journal_t *journal, tid_t commit_tid)
 	 */
 	if (ext4_test_mount_flag(sb, EXT4_MF_FC_INELIGIBLE)) {
 		status = EXT4_FC_STATUS_INELIGIBLE;
+		sbi->s_fc_stats.fc_fallback_reason_count[
+			READ_ONCE(sbi->s_fc_ineligible_reason)]++;
 		goto fallback;
 	}
 
@@ -2290,10 +2293,17 @@ int ext4_fc_info_show(struct seq_file *seq, void *v)
 		   stats->fc_num_commits, stats->fc_ineligible_commits,
 		   stats->fc_numblks,
 		   div_u64(stats->s_fc_avg_commit_time, 1000));
+	seq_printf(seq, "%ld failed\n%ld skipped\n",
+		   stats->fc_failed_commits, stats->fc_skipped_commits);
 	seq_puts(seq, "Ineligible reasons:\n");
 	for (i = 0; i < EXT4_FC_REASON_MAX; i++)
 		seq_printf(seq, "\"%s\":\t%d\n", fc_ineligible_reasons[i],
 			stats->fc_ineligible_reason_count[i]);
+	/* The reason that was latest marked when a commit had to fall back */
+	seq_puts(seq, "Fallback reasons:\n");
+	for (i = 0; i < EXT4_FC_REASON_MAX; i++)
+		seq_printf(seq, "\"%s\":\t%d\n", fc_ineligible_reasons[i],
+			stats->fc_fallback_reason_count[i]);
 
 	return 0;
 }
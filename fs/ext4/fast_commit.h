@@ -116,6 +116,8 @@ struct ext4_fc_dentry_update {
 
 struct ext4_fc_stats {
 	unsigned int fc_ineligible_reason_count[EXT4_FC_REASON_MAX];
+	/* Full commits done instead of fast commits, by ineligibility reason */
+	unsigned int fc_fallback_reason_count[EXT4_FC_REASON_MAX];
 	unsigned long fc_num_commits;
 	unsigned long fc_ineligible_commits;
 	unsigned long fc_failed_commits;
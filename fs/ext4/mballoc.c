@@ -132,25 +132,31 @@
  * If "mb_optimize_scan" mount option is set, we maintain in memory group info
  * structures in two data structures:
  *
- * 1) Array of largest free order lists (sbi->s_mb_largest_free_orders)
+ * 1) Array of largest free order xarrays (sbi->s_mb_largest_free_orders)
  *
- *    Locking: sbi->s_mb_largest_free_orders_locks(array of rw locks)
+ *    Locking: Updates are done under the group lock of the group being moved,
+ *    the xarray takes its own lock internally. Lookups are lockless (RCU).
  *
- *    This is an array of lists where the index in the array represents the
+ *    This is an array of xarrays where the index in the array represents the
  *    largest free order in the buddy bitmap of the participating group infos of
- *    that list. So, there are exactly MB_NUM_ORDERS(sb) (which means total
- *    number of buddy bitmap orders possible) number of lists. Group-infos are
- *    placed in appropriate lists.
+ *    that xarray. So, there are exactly MB_NUM_ORDERS(sb) (which means total
+ *    number of buddy bitmap orders possible) number of xarrays. Group-infos are
+ *    stored in the appropriate xarray, indexed by their group number.
  *
- * 2) Average fragment size lists (sbi->s_mb_avg_fragment_size)
+ * 2) Average fragment size xarrays (sbi->s_mb_avg_fragment_size)
  *
- *    Locking: sbi->s_mb_avg_fragment_size_locks(array of rw locks)
+ *    Locking: Same as above.
  *
- *    This is an array of lists where in the i-th list there are groups with
+ *    This is an array of xarrays where in the i-th xarray there are groups with
  *    average fragment size >= 2^i and < 2^(i+1). The average fragment size
  *    is computed as ext4_group_info->bb_free / ext4_group_info->bb_fragments.
- *    Note that we don't bother with a special list for completely empty groups
- *    so we only have MB_NUM_ORDERS(sb) lists.
+ *    Note that we don't bother with a special xarray for completely empty
+ *    groups so we only have MB_NUM_ORDERS(sb) xarrays.
+ *
+ * Since the xarrays are indexed by group number, a lookup starts at the goal
+ * group of the allocation and wraps around. Hence allocations with different
+ * goals start from different groups rather than all racing for the first
+ * group of the same list.
  *
  * When "mb_optimize_scan" mount option is set, mballoc consults the above data
  * structures to decide the order in which groups are to be traversed for
@@ -159,21 +165,21 @@
  * At CR_POWER2_ALIGNED , we look for groups which have the largest_free_order
  * >= the order of the request. We directly look at the largest free order list
  * in the data structure (1) above where largest_free_order = order of the
- * request. If that list is empty, we look at remaining list in the increasing
- * order of largest_free_order. This allows us to perform CR_POWER2_ALIGNED
+ * request. If that xarray is empty, we look at remaining xarrays in the
+ * increasing order of largest_free_order. This allows us to perform CR_POWER2_ALIGNED
  * lookup in O(1) time.
  *
  * At CR_GOAL_LEN_FAST, we only consider groups where
  * average fragment size > request size. So, we lookup a group which has average
  * fragment size just above or equal to request size using our average fragment
- * size group lists (data structure 2) in O(1) time.
+ * size group xarrays (data structure 2) in O(1) time.
  *
  * At CR_BEST_AVAIL_LEN, we aim to optimize allocations which can't be satisfied
  * in CR_GOAL_LEN_FAST. The fact that we couldn't find a group in
  * CR_GOAL_LEN_FAST suggests that there is no BG that has avg
  * fragment size > goal length. So before falling to the slower
  * CR_GOAL_LEN_SLOW, in CR_BEST_AVAIL_LEN we proactively trim goal length and
- * then use the same fragment lists as CR_GOAL_LEN_FAST to find a BG with a big
+ * then use the same fragment xarrays as CR_GOAL_LEN_FAST to find a BG with a big
  * enough average fragment size. This increases the chances of finding a
  * suitable block group in O(1) time and results in faster allocation at the
  * cost of reduced size of allocation.
@@ -215,6 +221,16 @@
  * non rotational devices, this value defaults to 0 and for rotational devices
  * this is set to MB_DEFAULT_LINEAR_LIMIT.
  *
+ * Up to CR_GOAL_LEN_SLOW, groups whose lock is held by somebody else are
+ * skipped instead of waited for: the holder is most likely allocating from
+ * that group, so it is cheaper to scan the next one. Many writers scanning
+ * in CR_GOAL_LEN_SLOW thus spread over the groups instead of queueing on the
+ * same group lock. CR_ANY_FREE still waits for every group.
+ *
+ * Stream allocations (see s_mb_stream_request) use the group and block of the
+ * last stream allocation done on the local CPU as their goal, so that streams
+ * written from different CPUs don't fight over a single goal.
+ *
  * Both the prealloc space are getting populated as above. So for the first
  * request we will hit the buddy cache which will result in this prealloc
  * space getting filled. The prealloc space is then later used for the
@@ -850,20 +866,65 @@ mb_update_avg_fragment_size(struct super_block *sb, struct ext4_group_info *grp)
 	if (new_order == grp->bb_avg_fragment_size_order)
 		return;
 
-	if (grp->bb_avg_fragment_size_order != -1) {
-		write_lock(&sbi->s_mb_avg_fragment_size_locks[
-					grp->bb_avg_fragment_size_order]);
-		list_del(&grp->bb_avg_fragment_size_node);
-		write_unlock(&sbi->s_mb_avg_fragment_size_locks[
-					grp->bb_avg_fragment_size_order]);
-	}
+	if (grp->bb_avg_fragment_size_order != -1)
+		xa_erase(&sbi->s_mb_avg_fragment_size[
+					grp->bb_avg_fragment_size_order],
+			 grp->bb_group);
+	/*
+	 * We hold the group lock, so we can't wait for memory. If the insertion
+	 * fails, the group is just not seen by the optimized scan until its
+	 * next update.
+	 */
+	if (xa_is_err(xa_store(&sbi->s_mb_avg_fragment_size[new_order],
+			       grp->bb_group, grp, GFP_ATOMIC)))
+		new_order = -1;
 	grp->bb_avg_fragment_size_order = new_order;
-	write_lock(&sbi->s_mb_avg_fragment_size_locks[
-					grp->bb_avg_fragment_size_order]);
-	list_add_tail(&grp->bb_avg_fragment_size_node,
-		&sbi->s_mb_avg_fragment_size[grp->bb_avg_fragment_size_order]);
-	write_unlock(&sbi->s_mb_avg_fragment_size_locks[
-					grp->bb_avg_fragment_size_order]);
+}
+
+/*
+ * Skip a group whose lock is held by somebody else, unless we are at the last
+ * criteria where every group must be tried. The holder is most likely
+ * allocating from it, so another group is a better bet than waiting.
+ */
+static inline bool ext4_mb_group_busy(struct super_block *sb,
+				      ext4_group_t group, enum criteria cr)
+{
+	return cr < CR_ANY_FREE &&
+		spin_is_locked(ext4_group_lock_ptr(sb, group));
+}
+
+/*
+ * Find a suitable group in the xarray of groups @xa, starting at group
+ * @start and wrapping around to the first group.
+ */
+static struct ext4_group_info *
+ext4_mb_find_good_group_xarray(struct ext4_allocation_context *ac,
+			       struct xarray *xa, ext4_group_t start)
+{
+	struct super_block *sb = ac->ac_sb;
+	struct ext4_sb_info *sbi = EXT4_SB(sb);
+	ext4_group_t end = ext4_get_groups_count(sb);
+	enum criteria cr = ac->ac_criteria;
+	struct ext4_group_info *grp;
+	unsigned long group;
+
+	if (start >= end)
+		start = 0;
+wrap_around:
+	xa_for_each_range(xa, group, grp, start, end - 1) {
+		if (sbi->s_mb_stats)
+			atomic64_inc(&sbi->s_bal_cX_groups_considered[cr]);
+		if (ext4_mb_group_busy(sb, group, cr))
+			continue;
+		if (likely(ext4_mb_good_group(ac, group, cr)))
+			return grp;
+	}
+	if (start) {
+		end = start;
+		start = 0;
+		goto wrap_around;
+	}
+	return NULL;
 }
 
 /*
@@ -874,7 +935,7 @@ static void ext4_mb_choose_next_group_p2_aligned(struct ext4_allocation_context
 			enum criteria *new_cr, ext4_group_t *group)
 {
 	struct ext4_sb_info *sbi = EXT4_SB(ac->ac_sb);
-	struct ext4_group_info *iter;
+	struct ext4_group_info *grp;
 	int i;
 
 	if (ac->ac_status == AC_STATUS_FOUND)
@@ -884,25 +945,13 @@ static void ext4_mb_choose_next_group_p2_aligned(struct ext4_allocation_context
 		atomic_inc(&sbi->s_bal_p2_aligned_bad_suggestions);
 
 	for (i = ac->ac_2order; i < MB_NUM_ORDERS(ac->ac_sb); i++) {
-		if (list_empty(&sbi->s_mb_largest_free_orders[i]))
-			continue;
-		read_lock(&sbi->s_mb_largest_free_orders_locks[i]);
-		if (list_empty(&sbi->s_mb_largest_free_orders[i])) {
-			read_unlock(&sbi->s_mb_largest_free_orders_locks[i]);
-			continue;
-		}
-		list_for_each_entry(iter, &sbi->s_mb_largest_free_orders[i],
-				    bb_largest_free_order_node) {
-			if (sbi->s_mb_stats)
-				atomic64_inc(&sbi->s_bal_cX_groups_considered[CR_POWER2_ALIGNED]);
-			if (likely(ext4_mb_good_group(ac, iter->bb_group, CR_POWER2_ALIGNED))) {
-				*group = iter->bb_group;
-				ac->ac_flags |= EXT4_MB_CR_POWER2_ALIGNED_OPTIMIZED;
-				read_unlock(&sbi->s_mb_largest_free_orders_locks[i]);
-				return;
-			}
+		grp = ext4_mb_find_good_group_xarray(ac,
+				&sbi->s_mb_largest_free_orders[i], *group);
+		if (grp) {
+			*group = grp->bb_group;
+			ac->ac_flags |= EXT4_MB_CR_POWER2_ALIGNED_OPTIMIZED;
+			return;
 		}
-		read_unlock(&sbi->s_mb_largest_free_orders_locks[i]);
 	}
 
 	/* Increment cr and search again if no group is found */
@@ -910,34 +959,17 @@ static void ext4_mb_choose_next_group_p2_aligned(struct ext4_allocation_context
 }
 
 /*
- * Find a suitable group of given order from the average fragments list.
+ * Find a suitable group of given order from the average fragments xarray,
+ * starting at @start.
  */
 static struct ext4_group_info *
-ext4_mb_find_good_group_avg_frag_lists(struct ext4_allocation_context *ac, int order)
+ext4_mb_find_good_group_avg_frag_xarray(struct ext4_allocation_context *ac,
+					int order, ext4_group_t start)
 {
 	struct ext4_sb_info *sbi = EXT4_SB(ac->ac_sb);
-	struct list_head *frag_list = &sbi->s_mb_avg_fragment_size[order];
-	rwlock_t *frag_list_lock = &sbi->s_mb_avg_fragment_size_locks[order];
-	struct ext4_group_info *grp = NULL, *iter;
-	enum criteria cr = ac->ac_criteria;
 
-	if (list_empty(frag_list))
-		return NULL;
-	read_lock(frag_list_lock);
-	if (list_empty(frag_list)) {
-		read_unlock(frag_list_lock);
-		return NULL;
-	}
-	list_for_each_entry(iter, frag_list, bb_avg_fragment_size_node) {
-		if (sbi->s_mb_stats)
-			atomic64_inc(&sbi->s_bal_cX_groups_considered[cr]);
-		if (likely(ext4_mb_good_group(ac, iter->bb_group, cr))) {
-			grp = iter;
-			break;
-		}
-	}
-	read_unlock(frag_list_lock);
-	return grp;
+	return ext4_mb_find_good_group_xarray(ac,
+			&sbi->s_mb_avg_fragment_size[order], start);
 }
 
 /*
@@ -958,7 +990,7 @@ static void ext4_mb_choose_next_group_goal_fast(struct ext4_allocation_context *
 
 	for (i = mb_avg_fragment_size_order(ac->ac_sb, ac->ac_g_ex.fe_len);
 	     i < MB_NUM_ORDERS(ac->ac_sb); i++) {
-		grp = ext4_mb_find_good_group_avg_frag_lists(ac, i);
+		grp = ext4_mb_find_good_group_avg_frag_xarray(ac, i, *group);
 		if (grp) {
 			*group = grp->bb_group;
 			ac->ac_flags |= EXT4_MB_CR_GOAL_LEN_FAST_OPTIMIZED;
@@ -1054,7 +1086,8 @@ static void ext4_mb_choose_next_group_best_avail(struct ext4_allocation_context
 		frag_order = mb_avg_fragment_size_order(ac->ac_sb,
 							ac->ac_g_ex.fe_len);
 
-		grp = ext4_mb_find_good_group_avg_frag_lists(ac, frag_order);
+		grp = ext4_mb_find_good_group_avg_frag_xarray(ac, frag_order,
+							      *group);
 		if (grp) {
 			*group = grp->bb_group;
 			ac->ac_flags |= EXT4_MB_CR_BEST_AVAIL_LEN_OPTIMIZED;
@@ -1161,22 +1194,16 @@ mb_set_largest_free_order(struct super_block *sb, struct ext4_group_info *grp)
 		return;
 	}
 
-	if (grp->bb_largest_free_order >= 0) {
-		write_lock(&sbi->s_mb_largest_free_orders_locks[
-					      grp->bb_largest_free_order]);
-		list_del_init(&grp->bb_largest_free_order_node);
-		write_unlock(&sbi->s_mb_largest_free_orders_locks[
-					      grp->bb_largest_free_order]);
-	}
+	if (grp->bb_largest_free_order >= 0)
+		xa_erase(&sbi->s_mb_largest_free_orders[
+					      grp->bb_largest_free_order],
+			 grp->bb_group);
+	/* See mb_update_avg_fragment_size() for the failure handling */
+	if (i >= 0 && grp->bb_free &&
+	    xa_is_err(xa_store(&sbi->s_mb_largest_free_orders[i],
+			       grp->bb_group, grp, GFP_ATOMIC)))
+		i = -1;
 	grp->bb_largest_free_order = i;
-	if (grp->bb_largest_free_order >= 0 && grp->bb_free) {
-		write_lock(&sbi->s_mb_largest_free_orders_locks[
-					      grp->bb_largest_free_order]);
-		list_add_tail(&grp->bb_largest_free_order_node,
-		      &sbi->s_mb_largest_free_orders[grp->bb_largest_free_order]);
-		write_unlock(&sbi->s_mb_largest_free_orders_locks[
-					      grp->bb_largest_free_order]);
-	}
 }
 
 static noinline_for_stack
@@ -2165,12 +2192,9 @@ static void ext4_mb_use_best_found(struct ext4_allocation_context *ac,
 	ac->ac_buddy_folio = e4b->bd_buddy_folio;
 	folio_get(ac->ac_buddy_folio);
 	/* store last allocated for subsequent stream allocation */
-	if (ac->ac_flags & EXT4_MB_STREAM_ALLOC) {
-		spin_lock(&sbi->s_md_lock);
-		sbi->s_mb_last_group = ac->ac_f_ex.fe_group;
-		sbi->s_mb_last_start = ac->ac_f_ex.fe_start;
-		spin_unlock(&sbi->s_md_lock);
-	}
+	if (ac->ac_flags & EXT4_MB_STREAM_ALLOC)
+		this_cpu_write(*sbi->s_mb_last_goal,
+			       ext4_grp_offs_to_block(ac->ac_sb, &ac->ac_f_ex));
 	/*
 	 * As we've just preallocated more space than
 	 * user requested originally, we store allocated
@@ -2802,10 +2826,13 @@ ext4_mb_regular_allocator(struct ext4_allocation_context *ac)
 	struct ext4_sb_info *sbi;
 	struct super_block *sb;
 	struct ext4_buddy e4b;
+	u64 start_ns = 0;
 	int lost;
 
 	sb = ac->ac_sb;
 	sbi = EXT4_SB(sb);
+	if (sbi->s_mb_stats)
+		start_ns = ktime_get_ns();
 	ngroups = ext4_get_groups_count(sb);
 	/* non-extent files are limited to low blocks/groups */
 	if (!(ext4_test_inode_flag(ac->ac_inode, EXT4_INODE_EXTENTS)))
@@ -2843,11 +2870,13 @@ ext4_mb_regular_allocator(struct ext4_allocation_context *ac)
 
 	/* if stream allocation is enabled, use global goal */
 	if (ac->ac_flags & EXT4_MB_STREAM_ALLOC) {
-		/* TBD: may be hot point */
-		spin_lock(&sbi->s_md_lock);
-		ac->ac_g_ex.fe_group = sbi->s_mb_last_group;
-		ac->ac_g_ex.fe_start = sbi->s_mb_last_start;
-		spin_unlock(&sbi->s_md_lock);
+		ext4_fsblk_t goal = this_cpu_read(*sbi->s_mb_last_goal);
+
+		if (goal < le32_to_cpu(sbi->s_es->s_first_data_block) ||
+		    goal >= ext4_blocks_count(sbi->s_es))
+			goal = le32_to_cpu(sbi->s_es->s_first_data_block);
+		ext4_get_group_no_and_offset(sb, goal, &ac->ac_g_ex.fe_group,
+					     &ac->ac_g_ex.fe_start);
 	}
 
 	/*
@@ -2898,6 +2927,9 @@ ext4_mb_regular_allocator(struct ext4_allocation_context *ac)
 							nr, &prefetch_ios);
 			}
 
+			if (ext4_mb_group_busy(sb, group, cr))
+				continue;
+
 			/* This now checks without needing the buddy page */
 			ret = ext4_mb_good_group_nolock(ac, group, cr);
 			if (ret <= 0) {
@@ -2999,6 +3031,10 @@ ext4_mb_regular_allocator(struct ext4_allocation_context *ac)
 	if (nr)
 		ext4_mb_prefetch_fini(sb, prefetch_grp, nr);
 
+	if (start_ns)
+		atomic64_inc(&sbi->s_bal_latency[min_t(int,
+				fls64(ktime_get_ns() - start_ns),
+				EXT4_MB_LATENCY_BUCKETS - 1)]);
 	return err;
 }
 
@@ -3089,6 +3125,43 @@ const struct seq_operations ext4_mb_seq_groups_ops = {
 	.show   = ext4_mb_seq_groups_show,
 };
 
+/*
+ * Latencies of the regular allocator are counted in log2 buckets: bucket b
+ * holds the allocations that took less than 2^b ns but at least 2^(b-1) ns.
+ * Print the bucket bound below which the 50th, 90th, 99th and 99.9th
+ * percentile allocations fall.
+ */
+static void ext4_mb_seq_latency_show(struct seq_file *seq,
+				     struct ext4_sb_info *sbi)
+{
+	static const unsigned int permille[] = { 500, 900, 990, 999 };
+	static const char * const names[] = { "p50", "p90", "p99", "p999" };
+	u64 count[EXT4_MB_LATENCY_BUCKETS], total = 0, sum = 0;
+	int i, b = 0;
+
+	for (i = 0; i < EXT4_MB_LATENCY_BUCKETS; i++) {
+		count[i] = atomic64_read(&sbi->s_bal_latency[i]);
+		total += count[i];
+	}
+
+	seq_printf(seq, "\tlatency_samples: %llu\n", total);
+	if (!total)
+		return;
+	seq_puts(seq, "\tlatency_ns:\n");
+	for (i = 0; i < ARRAY_SIZE(permille); i++) {
+		u64 target = div_u64(total * permille[i] + 999, 1000);
+
+		while (b < EXT4_MB_LATENCY_BUCKETS - 1 &&
+		       sum + count[b] < target)
+			sum += count[b++];
+		if (b == EXT4_MB_LATENCY_BUCKETS - 1)
+			seq_printf(seq, "\t\t%s: >=%llu\n", names[i],
+				   1ULL << (b - 1));
+		else
+			seq_printf(seq, "\t\t%s: <%llu\n", names[i], 1ULL << b);
+	}
+}
+
 int ext4_seq_mb_stats_show(struct seq_file *seq, void *offset)
 {
 	struct super_block *sb = seq->private;
@@ -3193,6 +3266,7 @@ int ext4_seq_mb_stats_show(struct seq_file *seq, void *offset)
 	seq_printf(seq, "\tpreallocated: %u\n",
 		   atomic_read(&sbi->s_mb_preallocated));
 	seq_printf(seq, "\tdiscarded: %u\n", atomic_read(&sbi->s_mb_discarded));
+	ext4_mb_seq_latency_show(seq, sbi);
 	return 0;
 }
 
@@ -3225,6 +3299,7 @@ static int ext4_mb_seq_structs_summary_show(struct seq_file *seq, void *v)
 	struct ext4_sb_info *sbi = EXT4_SB(sb);
 	unsigned long position = ((unsigned long) v);
 	struct ext4_group_info *grp;
+	unsigned long idx;
 	unsigned int count;
 
 	position--;
@@ -3234,11 +3309,8 @@ static int ext4_mb_seq_structs_summary_show(struct seq_file *seq, void *v)
 			seq_puts(seq, "avg_fragment_size_lists:\n");
 
 		count = 0;
-		read_lock(&sbi->s_mb_avg_fragment_size_locks[position]);
-		list_for_each_entry(grp, &sbi->s_mb_avg_fragment_size[position],
-				    bb_avg_fragment_size_node)
+		xa_for_each(&sbi->s_mb_avg_fragment_size[position], idx, grp)
 			count++;
-		read_unlock(&sbi->s_mb_avg_fragment_size_locks[position]);
 		seq_printf(seq, "\tlist_order_%u_groups: %u\n",
 					(unsigned int)position, count);
 		return 0;
@@ -3250,11 +3322,8 @@ static int ext4_mb_seq_structs_summary_show(struct seq_file *seq, void *v)
 		seq_puts(seq, "max_free_order_lists:\n");
 	}
 	count = 0;
-	read_lock(&sbi->s_mb_largest_free_orders_locks[position]);
-	list_for_each_entry(grp, &sbi->s_mb_largest_free_orders[position],
-			    bb_largest_free_order_node)
+	xa_for_each(&sbi->s_mb_largest_free_orders[position], idx, grp)
 		count++;
-	read_unlock(&sbi->s_mb_largest_free_orders_locks[position]);
 	seq_printf(seq, "\tlist_order_%u_groups: %u\n",
 		   (unsigned int)position, count);
 
@@ -3374,8 +3443,6 @@ int ext4_mb_add_groupinfo(struct super_block *sb, ext4_group_t group,
 	INIT_LIST_HEAD(&meta_group_info[i]->bb_prealloc_list);
 	init_rwsem(&meta_group_info[i]->alloc_sem);
 	meta_group_info[i]->bb_free_root = RB_ROOT;
-	INIT_LIST_HEAD(&meta_group_info[i]->bb_largest_free_order_node);
-	INIT_LIST_HEAD(&meta_group_info[i]->bb_avg_fragment_size_node);
 	meta_group_info[i]->bb_largest_free_order = -1;  /* uninit */
 	meta_group_info[i]->bb_avg_fragment_size_order = -1;  /* uninit */
 	meta_group_info[i]->bb_group = group;
@@ -3585,6 +3652,18 @@ static void ext4_discard_work(struct work_struct *work)
 		ext4_mb_unload_buddy(&e4b);
 }
 
+static void ext4_mb_free_group_xarrays(struct super_block *sb,
+				       struct xarray *xa)
+{
+	int i;
+
+	if (!xa)
+		return;
+	for (i = 0; i < MB_NUM_ORDERS(sb); i++)
+		xa_destroy(&xa[i]);
+	kfree(xa);
+}
+
 int ext4_mb_init(struct super_block *sb)
 {
 	struct ext4_sb_info *sbi = EXT4_SB(sb);
@@ -3630,41 +3709,28 @@ int ext4_mb_init(struct super_block *sb)
 	} while (i < MB_NUM_ORDERS(sb));
 
 	sbi->s_mb_avg_fragment_size =
-		kmalloc_array(MB_NUM_ORDERS(sb), sizeof(struct list_head),
+		kmalloc_array(MB_NUM_ORDERS(sb), sizeof(struct xarray),
 			GFP_KERNEL);
 	if (!sbi->s_mb_avg_fragment_size) {
 		ret = -ENOMEM;
 		goto out;
 	}
-	sbi->s_mb_avg_fragment_size_locks =
-		kmalloc_array(MB_NUM_ORDERS(sb), sizeof(rwlock_t),
-			GFP_KERNEL);
-	if (!sbi->s_mb_avg_fragment_size_locks) {
-		ret = -ENOMEM;
-		goto out;
-	}
-	for (i = 0; i < MB_NUM_ORDERS(sb); i++) {
-		INIT_LIST_HEAD(&sbi->s_mb_avg_fragment_size[i]);
-		rwlock_init(&sbi->s_mb_avg_fragment_size_locks[i]);
-	}
+	for (i = 0; i < MB_NUM_ORDERS(sb); i++)
+		xa_init(&sbi->s_mb_avg_fragment_size[i]);
 	sbi->s_mb_largest_free_orders =
-		kmalloc_array(MB_NUM_ORDERS(sb), sizeof(struct list_head),
+		kmalloc_array(MB_NUM_ORDERS(sb), sizeof(struct xarray),
 			GFP_KERNEL);
 	if (!sbi->s_mb_largest_free_orders) {
 		ret = -ENOMEM;
 		goto out;
 	}
-	sbi->s_mb_largest_free_orders_locks =
-		kmalloc_array(MB_NUM_ORDERS(sb), sizeof(rwlock_t),
-			GFP_KERNEL);
-	if (!sbi->s_mb_largest_free_orders_locks) {
+	for (i = 0; i < MB_NUM_ORDERS(sb); i++)
+		xa_init(&sbi->s_mb_largest_free_orders[i]);
+	sbi->s_mb_last_goal = alloc_percpu(ext4_fsblk_t);
+	if (!sbi->s_mb_last_goal) {
 		ret = -ENOMEM;
 		goto out;
 	}
-	for (i = 0; i < MB_NUM_ORDERS(sb); i++) {
-		INIT_LIST_HEAD(&sbi->s_mb_largest_free_orders[i]);
-		rwlock_init(&sbi->s_mb_largest_free_orders_locks[i]);
-	}
 
 	spin_lock_init(&sbi->s_md_lock);
 	sbi->s_mb_free_pending = 0;
@@ -3737,10 +3803,12 @@ int ext4_mb_init(struct super_block *sb)
 	free_percpu(sbi->s_locality_groups);
 	sbi->s_locality_groups = NULL;
 out:
-	kfree(sbi->s_mb_avg_fragment_size);
-	kfree(sbi->s_mb_avg_fragment_size_locks);
-	kfree(sbi->s_mb_largest_free_orders);
-	kfree(sbi->s_mb_largest_free_orders_locks);
+	ext4_mb_free_group_xarrays(sb, sbi->s_mb_avg_fragment_size);
+	sbi->s_mb_avg_fragment_size = NULL;
+	ext4_mb_free_group_xarrays(sb, sbi->s_mb_largest_free_orders);
+	sbi->s_mb_largest_free_orders = NULL;
+	free_percpu(sbi->s_mb_last_goal);
+	sbi->s_mb_last_goal = NULL;
 	kfree(sbi->s_mb_offsets);
 	sbi->s_mb_offsets = NULL;
 	kfree(sbi->s_mb_maxs);
@@ -3807,10 +3875,9 @@ void ext4_mb_release(struct super_block *sb)
 		kvfree(group_info);
 		rcu_read_unlock();
 	}
-	kfree(sbi->s_mb_avg_fragment_size);
-	kfree(sbi->s_mb_avg_fragment_size_locks);
-	kfree(sbi->s_mb_largest_free_orders);
-	kfree(sbi->s_mb_largest_free_orders_locks);
+	ext4_mb_free_group_xarrays(sb, sbi->s_mb_avg_fragment_size);
+	ext4_mb_free_group_xarrays(sb, sbi->s_mb_largest_free_orders);
+	free_percpu(sbi->s_mb_last_goal);
 	kfree(sbi->s_mb_offsets);
 	kfree(sbi->s_mb_maxs);
 	iput(sbi->s_buddy_cache);
@@ -4152,6 +4152,13 @@ static int ext4_cross_rename(struct inode *old_dir, struct dentry *old_dentry,
 	retval = ext4_mark_inode_dirty(handle, new.inode);
 	if (unlikely(retval))
 		goto end_rename;
+	/*
+	 * The replay code can't change the dot dot dirents of exchanged
+	 * directories, and for other inodes there is no order of the link and
+	 * unlink tags that works: both names are taken, so a link can't come
+	 * first, and an unlink first drops a single-link inode to zero links
+	 * and the replay deletes it.
+	 */
 	ext4_fc_mark_ineligible(new.inode->i_sb,
 				EXT4_FC_REASON_CROSS_RENAME, handle);
 	if (old.dir_bh) {
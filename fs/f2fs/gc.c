@@ -45,6 +45,7 @@ static int gc_thread_func(void *data)
 	set_freezable();
 	do {
 		bool sync_mode, foreground = false;
+		unsigned int nr_bg_secs = 0;
 
 		wait_event_freezable_timeout(*wq,
 				kthread_should_stop() ||
@@ -133,6 +134,8 @@ static int gc_thread_func(void *data)
 			decrease_sleep_time(gc_th, &wait_ms);
 			if (f2fs_sb_has_blkzoned(sbi))
 				gc_control.one_time = true;
+			else
+				nr_bg_secs = gc_th->boost_nr_secs;
 		} else {
 			increase_sleep_time(gc_th, &wait_ms);
 		}
@@ -150,6 +153,7 @@ static int gc_thread_func(void *data)
 		gc_control.init_gc_type = sync_mode ? FG_GC : BG_GC;
 		gc_control.no_bg_gc = foreground;
 		gc_control.nr_free_secs = foreground ? 1 : 0;
+		gc_control.nr_bg_secs = foreground ? 0 : nr_bg_secs;
 
 		/* if return value is not zero, no victim was selected */
 		if (f2fs_gc(sbi, &gc_control)) {
@@ -197,6 +201,7 @@ int f2fs_start_gc_thread(struct f2fs_sb_info *sbi)
 
 	gc_th->urgent_sleep_time = DEF_GC_THREAD_URGENT_SLEEP_TIME;
 	gc_th->valid_thresh_ratio = DEF_GC_THREAD_VALID_THRESH_RATIO;
+	gc_th->boost_nr_secs = DEF_GC_THREAD_BOOST_NR_SECS;
 
 	if (f2fs_sb_has_blkzoned(sbi)) {
 		gc_th->min_sleep_time = DEF_GC_THREAD_MIN_SLEEP_TIME_ZONED;
@@ -1865,7 +1870,7 @@ int f2fs_gc(struct f2fs_sb_info *sbi, struct f2fs_gc_control *gc_control)
 		.ilist = LIST_HEAD_INIT(gc_list.ilist),
 		.iroot = RADIX_TREE_INIT(gc_list.iroot, GFP_NOFS),
 	};
-	unsigned int skipped_round = 0, round = 0;
+	unsigned int skipped_round = 0, round = 0, bg_round = 0;
 	unsigned int upper_secs;
 
 	trace_f2fs_gc_begin(sbi->sb, gc_type, gc_control->no_bg_gc,
@@ -1961,6 +1966,12 @@ int f2fs_gc(struct f2fs_sb_info *sbi, struct f2fs_gc_control *gc_control)
 			goto stop;
 		}
 	} else if (has_enough_free_secs(sbi, 0, 0)) {
+		/*
+		 * Keep up with write bursts by migrating a few more victims
+		 * while we hold gc_lock anyway.
+		 */
+		if (++bg_round < gc_control->nr_bg_secs)
+			goto go_gc_more;
 		goto stop;
 	}
 
@@ -35,6 +35,8 @@
 #define LIMIT_BOOST_ZONED_GC	25 /* percentage over total user space of boosted gc for zoned devices */
 #define DEF_MIGRATION_WINDOW_GRANULARITY_ZONED	3
 #define BOOST_GC_MULTIPLE	5
+#define DEF_GC_THREAD_BOOST_NR_SECS	4	/* victim sections per boosted background GC */
+#define MAX_GC_THREAD_BOOST_NR_SECS	64
 #define ZONED_PIN_SEC_REQUIRED_COUNT	1
 
 #define DEF_GC_FAILED_PINNED_FILES	2048
@@ -68,6 +70,9 @@ struct f2fs_gc_kthread {
 	unsigned int no_zoned_gc_percent;
 	unsigned int boost_zoned_gc_percent;
 	unsigned int valid_thresh_ratio;
+
+	/* # of victim sections per background GC round, if GC is boosted */
+	unsigned int boost_nr_secs;
 };
 
 struct gc_inode_list {
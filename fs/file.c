@@ -382,6 +382,7 @@ struct files_struct *dup_fd(struct files_struct *oldf, struct fd_range *punch_ho
 	newf->resize_in_progress = false;
 	init_waitqueue_head(&newf->resize_wait);
 	newf->next_fd = 0;
+	INIT_LIST_HEAD(&newf->fd_caches);
 	new_fdt = &newf->fdtab;
 	new_fdt->max_fds = NR_OPEN_DEFAULT;
 	new_fdt->close_on_exec = newf->close_on_exec_init;
@@ -504,6 +505,8 @@ void exit_files(struct task_struct *tsk)
 {
 	struct files_struct * files = tsk->files;
 
+	fd_cache_free(tsk);
+
 	if (files) {
 		task_lock(tsk);
 		tsk->files = NULL;
@@ -524,6 +527,7 @@ struct files_struct init_files = {
 	},
 	.file_lock	= __SPIN_LOCK_UNLOCKED(init_files.file_lock),
 	.resize_wait	= __WAIT_QUEUE_HEAD_INITIALIZER(init_files.resize_wait),
+	.fd_caches	= LIST_HEAD_INIT(init_files.fd_caches),
 };
 
 static unsigned int find_next_fd(struct fdtable *fdt, unsigned int start)
@@ -552,14 +556,14 @@ static unsigned int find_next_fd(struct fdtable *fdt, unsigned int start)
 /*
  * allocate a file descriptor, mark it busy.
  */
-static int alloc_fd(unsigned start, unsigned end, unsigned flags)
+static int __alloc_fd(struct files_struct *files,
+		      unsigned start, unsigned end, unsigned flags)
+	__must_hold(&files->file_lock)
 {
-	struct files_struct *files = current->files;
 	unsigned int fd;
 	int error;
 	struct fdtable *fdt;
 
-	spin_lock(&files->file_lock);
 repeat:
 	fdt = files_fdtable(files);
 	fd = start;
@@ -593,20 +597,19 @@ static int alloc_fd(unsigned start, unsigned end, unsigned flags)
 	VFS_BUG_ON(rcu_access_pointer(fdt->fd[fd]) != NULL);
 
 out:
-	spin_unlock(&files->file_lock);
 	return error;
 }
 
-int __get_unused_fd_flags(unsigned flags, unsigned long nofile)
+static int alloc_fd(unsigned start, unsigned end, unsigned flags)
 {
-	return alloc_fd(0, nofile, flags);
-}
+	struct files_struct *files = current->files;
+	int fd;
 
-int get_unused_fd_flags(unsigned flags)
-{
-	return __get_unused_fd_flags(flags, rlimit(RLIMIT_NOFILE));
+	spin_lock(&files->file_lock);
+	fd = __alloc_fd(files, start, end, flags);
+	spin_unlock(&files->file_lock);
+	return fd;
 }
-EXPORT_SYMBOL(get_unused_fd_flags);
 
 static void __put_unused_fd(struct files_struct *files, unsigned int fd)
 {
@@ -626,6 +629,208 @@ void put_unused_fd(unsigned int fd)
 
 EXPORT_SYMBOL(put_unused_fd);
 
+/*
+ * Per-thread cache of descriptors, enabled with PR_SET_FD_CACHE.  The thread
+ * reserves FD_CACHE_SIZE descriptors at a time under ->file_lock and then
+ * hands them out without taking it.  Reserved descriptors are marked open in
+ * the table of @files but have no file installed, so nobody else gets them;
+ * the price is that the lowest available descriptor is no longer returned.
+ * There is one array per O_CLOEXEC state since the close_on_exec bit can
+ * only be set under ->file_lock.
+ *
+ * The counts are only touched by the thread.  A slot may also be taken by
+ * dup2() onto its descriptor, which finds the cache on ->fd_caches under
+ * ->file_lock and replaces the slot with FD_CACHE_TAKEN; the thread takes
+ * slots with xchg() so that each descriptor goes to one of them only.
+ *
+ * The cache must be released before the thread switches to another table,
+ * which happens in exit_files(), unshare_fd() and
+ * close_range(CLOSE_RANGE_UNSHARE), and it is freed on exec, where the new
+ * program expects the lowest available descriptor again.
+ */
+#define FD_CACHE_SIZE	16
+#define FD_CACHE_TAKEN	UINT_MAX
+
+struct fd_cache {
+	struct files_struct *files;
+	struct list_head node;		/* on files->fd_caches if registered */
+	unsigned int nr[2];
+	unsigned int fds[2][FD_CACHE_SIZE];
+};
+
+static int fd_cache_refill(struct fd_cache *cache, bool cloexec,
+			   unsigned int end)
+{
+	struct files_struct *files = cache->files;
+	unsigned int *fds = cache->fds[cloexec];
+	unsigned int new[FD_CACHE_SIZE];
+	int fd = 0, i, j;
+
+	spin_lock(&files->file_lock);
+	for (i = 0; i < FD_CACHE_SIZE; i++) {
+		fd = __alloc_fd(files, 0, end, cloexec ? O_CLOEXEC : 0);
+		if (fd < 0)
+			break;
+		new[i] = fd;
+	}
+	/* Hand out the lowest one first */
+	for (j = 0; j < i; j++)
+		WRITE_ONCE(fds[j], new[i - 1 - j]);
+	if (i && list_empty(&cache->node))
+		list_add(&cache->node, &files->fd_caches);
+	spin_unlock(&files->file_lock);
+
+	cache->nr[cloexec] = i;
+
+	return i ? 0 : fd;
+}
+
+static int fd_cache_get(struct fd_cache *cache, unsigned int end,
+			unsigned int flags)
+{
+	bool cloexec = flags & O_CLOEXEC;
+	unsigned int fd;
+	int error;
+
+	if (unlikely(cache->files != current->files)) {
+		/* The reserved descriptors were released on the switch */
+		WARN_ON_ONCE(!list_empty(&cache->node));
+		cache->nr[0] = cache->nr[1] = 0;
+		cache->files = current->files;
+	}
+
+	do {
+		if (!cache->nr[cloexec]) {
+			error = fd_cache_refill(cache, cloexec, end);
+			if (error)
+				return error;
+		}
+
+		fd = xchg(&cache->fds[cloexec][--cache->nr[cloexec]],
+			  FD_CACHE_TAKEN);
+	} while (fd == FD_CACHE_TAKEN);
+
+	if (unlikely(fd >= end)) {
+		/* RLIMIT_NOFILE was lowered since the refill */
+		put_unused_fd(fd);
+		return alloc_fd(0, end, flags);
+	}
+	return fd;
+}
+
+/*
+ * dup2() onto a descriptor that is reserved but has no file yet.  If a cache
+ * holds it, take it from there, or the caller could never get it.
+ */
+static bool fd_cache_steal(struct files_struct *files, unsigned int fd)
+	__must_hold(&files->file_lock)
+{
+	struct fd_cache *cache;
+	int i, j;
+
+	list_for_each_entry(cache, &files->fd_caches, node)
+		for (i = 0; i < 2; i++)
+			for (j = 0; j < FD_CACHE_SIZE; j++)
+				if (READ_ONCE(cache->fds[i][j]) == fd &&
+				    cmpxchg(&cache->fds[i][j], fd,
+					    FD_CACHE_TAKEN) == fd)
+					return true;
+	return false;
+}
+
+/*
+ * close_range(CLOSE_RANGE_CLOEXEC) sets close_on_exec on a whole range, but
+ * a descriptor still reserved in a !O_CLOEXEC array has no file yet and must
+ * not become close-on-exec once it is handed out.  Clear the bit again for
+ * those.
+ */
+static void fd_cache_skip_cloexec(struct files_struct *files,
+				  unsigned int fd, unsigned int max_fd)
+	__must_hold(&files->file_lock)
+{
+	struct fdtable *fdt = files_fdtable(files);
+	struct fd_cache *cache;
+	unsigned int cached;
+	int j;
+
+	list_for_each_entry(cache, &files->fd_caches, node)
+		for (j = 0; j < FD_CACHE_SIZE; j++) {
+			cached = READ_ONCE(cache->fds[0][j]);
+			if (cached != FD_CACHE_TAKEN &&
+			    cached >= fd && cached <= max_fd)
+				__clear_bit(cached, fdt->close_on_exec);
+		}
+}
+
+void fd_cache_release(struct task_struct *tsk)
+{
+	struct fd_cache *cache = tsk->fd_cache;
+	struct files_struct *files;
+	unsigned int fd;
+	int i;
+
+	if (!cache || list_empty(&cache->node))
+		return;
+
+	files = cache->files;
+	spin_lock(&files->file_lock);
+	for (i = 0; i < 2; i++)
+		while (cache->nr[i]) {
+			fd = xchg(&cache->fds[i][--cache->nr[i]],
+				  FD_CACHE_TAKEN);
+			if (fd != FD_CACHE_TAKEN)
+				__put_unused_fd(files, fd);
+		}
+	list_del_init(&cache->node);
+	spin_unlock(&files->file_lock);
+}
+
+void fd_cache_free(struct task_struct *tsk)
+{
+	fd_cache_release(tsk);
+	kfree(tsk->fd_cache);
+	tsk->fd_cache = NULL;
+}
+
+int set_fd_cache(unsigned long enable)
+{
+	struct fd_cache *cache;
+
+	if (enable > 1)
+		return -EINVAL;
+
+	if (!enable) {
+		fd_cache_free(current);
+		return 0;
+	}
+
+	if (current->fd_cache)
+		return 0;
+
+	cache = kmalloc(sizeof(*cache), GFP_KERNEL_ACCOUNT);
+	if (!cache)
+		return -ENOMEM;
+	cache->files = current->files;
+	INIT_LIST_HEAD(&cache->node);
+	cache->nr[0] = cache->nr[1] = 0;
+	memset(cache->fds, 0xff, sizeof(cache->fds));
+	current->fd_cache = cache;
+	return 0;
+}
+
+int __get_unused_fd_flags(unsigned flags, unsigned long nofile)
+{
+	if (current->fd_cache)
+		return fd_cache_get(current->fd_cache, nofile, flags);
+	return alloc_fd(0, nofile, flags);
+}
+
+int get_unused_fd_flags(unsigned flags)
+{
+	return __get_unused_fd_flags(flags, rlimit(RLIMIT_NOFILE));
+}
+EXPORT_SYMBOL(get_unused_fd_flags);
+
 /**
  * fd_install - install a file pointer in the fd array
  * @fd: file descriptor to install the file in
@@ -730,8 +935,10 @@ static inline void __range_cloexec(struct files_struct *cur_fds,
 	spin_lock(&cur_fds->file_lock);
 	fdt = files_fdtable(cur_fds);
 	max_fd = min(last_fd(fdt), max_fd);
-	if (fd <= max_fd)
+	if (fd <= max_fd) {
 		bitmap_set(fdt->close_on_exec, fd, max_fd - fd + 1);
+		fd_cache_skip_cloexec(cur_fds, fd, max_fd);
+	}
 	spin_unlock(&cur_fds->file_lock);
 }
 
@@ -784,6 +991,9 @@ SYSCALL_DEFINE3(close_range, unsigned int, fd, unsigned int, max_fd,
 	if (fd > max_fd)
 		return -EINVAL;
 
+	if (flags & CLOSE_RANGE_UNSHARE)
+		fd_cache_release(me);
+
 	if ((flags & CLOSE_RANGE_UNSHARE) && atomic_read(&cur_fds->count) > 1) {
 		struct fd_range range = {fd, max_fd}, *punch_hole = &range;
 
@@ -1283,7 +1493,7 @@ __releases(&files->file_lock)
 	fdt = files_fdtable(files);
 	fd = array_index_nospec(fd, fdt->max_fds);
 	tofree = rcu_dereference_raw(fdt->fd[fd]);
-	if (!tofree && fd_is_open(fd, fdt))
+	if (!tofree && fd_is_open(fd, fdt) && !fd_cache_steal(files, fd))
 		goto Ebusy;
 	get_file(file);
 	rcu_assign_pointer(fdt->fd[fd], file);
@@ -587,6 +587,7 @@ void __init files_init(void)
 	struct kmem_cache_args args = {
 		.use_freeptr_offset = true,
 		.freeptr_offset = offsetof(struct file, f_freeptr),
+		.sheaf_capacity = 32,
 	};
 
 	filp_cachep = kmem_cache_create("filp", sizeof(struct file), &args,
@@ -594,6 +595,7 @@ void __init files_init(void)
 				SLAB_ACCOUNT | SLAB_TYPESAFE_BY_RCU);
 
 	args.freeptr_offset = offsetof(struct backing_file, bf_freeptr);
+	args.sheaf_capacity = 0;
 	bfilp_cachep = kmem_cache_create("bfilp", sizeof(struct backing_file),
 				&args, SLAB_HWCACHE_ALIGN | SLAB_PANIC |
 				SLAB_ACCOUNT | SLAB_TYPESAFE_BY_RCU);
@@ -2096,8 +2096,8 @@ static long writeback_inodes_wb(struct bdi_writeback *wb, long nr_pages,
  * dirtied_before takes precedence over nr_to_write.  So we'll only write back
  * all dirty pages if they are all attached to "old" mappings.
  */
-static long wb_writeback(struct bdi_writeback *wb,
-			 struct wb_writeback_work *work)
+static long __wb_writeback(struct bdi_writeback *wb,
+			   struct wb_writeback_work *work)
 {
 	long nr_pages = work->nr_pages;
 	unsigned long dirtied_before = jiffies;
@@ -2196,6 +2196,87 @@ static long wb_writeback(struct bdi_writeback *wb,
 	return nr_pages - work->nr_pages;
 }
 
+/*
+ * A helper runs a copy of a background or kupdate work on the same wb in
+ * parallel with the flusher.  Writers of the same wb already cope with each
+ * other: writeback_sb_inodes() skips inodes under I_SYNC, so each inode on
+ * ->b_io is written by one of them only.
+ *
+ * The flusher waits for its helpers, so they can't run on bdi_wq: a flusher
+ * running in its rescuer would wait for works that need the rescuer too.  They
+ * run on a workqueue of their own, and a flusher in the rescuer, which is
+ * short of memory already, does not use them at all.
+ */
+static struct workqueue_struct *wb_helper_wq;
+
+struct wb_writeback_helper {
+	struct work_struct work;
+	struct bdi_writeback *wb;
+	struct wb_writeback_work wwork;
+	long progress;
+};
+
+static void wb_writeback_helper_fn(struct work_struct *work)
+{
+	struct wb_writeback_helper *helper =
+		container_of(work, struct wb_writeback_helper, work);
+
+	helper->progress = __wb_writeback(helper->wb, &helper->wwork);
+}
+
+static long wb_writeback(struct bdi_writeback *wb,
+			 struct wb_writeback_work *work)
+{
+	unsigned int nr_threads = READ_ONCE(wb->bdi->wb_threads);
+	struct wb_writeback_helper *helpers = NULL;
+	long progress;
+	int i;
+
+	/*
+	 * Only the works that write everything that is dirty are split, they
+	 * are the ones that keep a flusher busy for long and they stop on the
+	 * same wb-wide conditions in every thread.
+	 */
+	if (nr_threads > 1 && (work->for_background || work->for_kupdate) &&
+	    wb_helper_wq && !current_is_workqueue_rescuer())
+		helpers = kcalloc(nr_threads - 1, sizeof(*helpers),
+				  GFP_NOWAIT | __GFP_NOWARN);
+	if (helpers) {
+		for (i = 0; i < nr_threads - 1; i++) {
+			struct wb_writeback_helper *helper = &helpers[i];
+
+			helper->wb = wb;
+			helper->wwork = *work;
+			helper->wwork.auto_free = 0;
+			helper->wwork.done = NULL;
+			INIT_LIST_HEAD(&helper->wwork.list);
+			INIT_WORK(&helper->work, wb_writeback_helper_fn);
+			queue_work(wb_helper_wq, &helper->work);
+		}
+	}
+
+	progress = __wb_writeback(wb, work);
+
+	if (helpers) {
+		for (i = 0; i < nr_threads - 1; i++) {
+			flush_work(&helpers[i].work);
+			progress += helpers[i].progress;
+		}
+		kfree(helpers);
+	}
+
+	return progress;
+}
+
+static int __init wb_writeback_helper_init(void)
+{
+	wb_helper_wq = alloc_workqueue("writeback_helper", WQ_UNBOUND, 0);
+	if (!wb_helper_wq)
+		return -ENOMEM;
+	return 0;
+}
+fs_initcall(wb_writeback_helper_init);
+
 /*
  * Return the next wb_writeback_work struct that hasn't been processed yet.
  */
@@ -79,6 +79,38 @@ static int vfs_parse_sb_flag(struct fs_context *fc, const char *key)
 	return -ENOPARAM;
 }
 
+static const struct constant_table common_pagecache_policy[] = {
+	{ "default",	0 },
+	{ "interleave",	SB_I_PAGECACHE_INTERLEAVE },
+	{ "local",	SB_I_PAGECACHE_LOCAL },
+	{ },
+};
+
+/*
+ * Check for the common mount option that sets the NUMA placement policy of
+ * the page cache of the superblock.
+ */
+static int vfs_parse_pagecache_policy(struct fs_context *fc,
+				      struct fs_parameter *param)
+{
+	int token;
+
+	if (strcmp(param->key, "pagecache_policy"))
+		return -ENOPARAM;
+
+	if (param->type != fs_value_is_string)
+		return invalf(fc, "VFS: pagecache_policy requires a value");
+
+	token = lookup_constant(common_pagecache_policy, param->string, -1);
+	if (token < 0)
+		return invalf(fc, "VFS: Unknown pagecache_policy '%s'",
+			      param->string);
+
+	fc->s_iflags = (fc->s_iflags & ~SB_I_PAGECACHE_MASK) | token;
+	fc->pagecache_policy = true;
+	return 0;
+}
+
 /**
  * vfs_parse_fs_param_source - Handle setting "source" via parameter
  * @fc: The filesystem context to modify
@@ -135,6 +167,10 @@ int vfs_parse_fs_param(struct fs_context *fc, struct fs_parameter *param)
 	if (ret != -ENOPARAM)
 		return ret;
 
+	ret = vfs_parse_pagecache_policy(fc, param);
+	if (ret != -ENOPARAM)
+		return ret;
+
 	ret = security_fs_context_parse_param(fc, param);
 	if (ret != -ENOPARAM)
 		/* Param belongs to the LSM or is disallowed by the LSM; so
@@ -209,7 +209,8 @@ void fuse_uring_destruct(struct fuse_conn *fc)
 static struct fuse_ring *fuse_uring_create(struct fuse_conn *fc)
 {
 	struct fuse_ring *ring;
-	size_t nr_queues = num_possible_cpus();
+	size_t nr_fg_queues = num_possible_cpus();
+	size_t nr_queues = 2 * nr_fg_queues;
 	struct fuse_ring *res = NULL;
 	size_t max_payload_size;
 
@@ -236,6 +237,7 @@ static struct fuse_ring *fuse_uring_create(struct fuse_conn *fc)
 	init_waitqueue_head(&ring->stop_waitq);
 
 	ring->nr_queues = nr_queues;
+	ring->nr_fg_queues = nr_fg_queues;
 	ring->fc = fc;
 	ring->max_payload_sz = max_payload_size;
 	smp_store_release(&fc->ring, ring);
@@ -557,9 +559,28 @@ static int fuse_uring_out_header_has_err(struct fuse_out_header *oh,
 	return err;
 }
 
+/*
+ * A payload in a registered buffer is already pinned, so the copy does not
+ * need to fault in and pin the user pages of every request.
+ */
+static int fuse_uring_import_payload(struct fuse_ring_ent *ent, int dir,
+				     struct iov_iter *iter,
+				     unsigned int issue_flags)
+{
+	struct fuse_ring *ring = ent->queue->ring;
+
+	if (ent->payload_fixed)
+		return io_uring_cmd_import_fixed((u64)(uintptr_t)ent->payload,
+						 ring->max_payload_sz, dir,
+						 iter, ent->cmd, issue_flags);
+
+	return import_ubuf(dir, ent->payload, ring->max_payload_sz, iter);
+}
+
 static int fuse_uring_copy_from_ring(struct fuse_ring *ring,
 				     struct fuse_req *req,
-				     struct fuse_ring_ent *ent)
+				     struct fuse_ring_ent *ent,
+				     unsigned int issue_flags)
 {
 	struct fuse_copy_state cs;
 	struct fuse_args *args = req->args;
@@ -572,8 +593,7 @@ static int fuse_uring_copy_from_ring(struct fuse_ring *ring,
 	if (err)
 		return -EFAULT;
 
-	err = import_ubuf(ITER_SOURCE, ent->payload, ring->max_payload_sz,
-			  &iter);
+	err = fuse_uring_import_payload(ent, ITER_SOURCE, &iter, issue_flags);
 	if (err)
 		return err;
 
@@ -588,7 +608,8 @@ static int fuse_uring_copy_from_ring(struct fuse_ring *ring,
   * Copy data from the req to the ring buffer
   */
 static int fuse_uring_args_to_ring(struct fuse_ring *ring, struct fuse_req *req,
-				   struct fuse_ring_ent *ent)
+				   struct fuse_ring_ent *ent,
+				   unsigned int issue_flags)
 {
 	struct fuse_copy_state cs;
 	struct fuse_args *args = req->args;
@@ -601,7 +622,7 @@ static int fuse_uring_args_to_ring(struct fuse_ring *ring, struct fuse_req *req,
 		.commit_id = req->in.h.unique,
 	};
 
-	err = import_ubuf(ITER_DEST, ent->payload, ring->max_payload_sz, &iter);
+	err = fuse_uring_import_payload(ent, ITER_DEST, &iter, issue_flags);
 	if (err) {
 		pr_info_ratelimited("fuse: Import of user buffer failed\n");
 		return err;
@@ -644,7 +665,8 @@ static int fuse_uring_args_to_ring(struct fuse_ring *ring, struct fuse_req *req,
 }
 
 static int fuse_uring_copy_to_ring(struct fuse_ring_ent *ent,
-				   struct fuse_req *req)
+				   struct fuse_req *req,
+				   unsigned int issue_flags)
 {
 	struct fuse_ring_queue *queue = ent->queue;
 	struct fuse_ring *ring = queue->ring;
@@ -662,7 +684,7 @@ static int fuse_uring_copy_to_ring(struct fuse_ring_ent *ent,
 		return err;
 
 	/* copy the request */
-	err = fuse_uring_args_to_ring(ring, req, ent);
+	err = fuse_uring_args_to_ring(ring, req, ent, issue_flags);
 	if (unlikely(err)) {
 		pr_info_ratelimited("Copy to ring failed: %d\n", err);
 		return err;
@@ -680,11 +702,12 @@ static int fuse_uring_copy_to_ring(struct fuse_ring_ent *ent,
 }
 
 static int fuse_uring_prepare_send(struct fuse_ring_ent *ent,
-				   struct fuse_req *req)
+				   struct fuse_req *req,
+				   unsigned int issue_flags)
 {
 	int err;
 
-	err = fuse_uring_copy_to_ring(ent, req);
+	err = fuse_uring_copy_to_ring(ent, req, issue_flags);
 	if (!err)
 		set_bit(FR_SENT, &req->flags);
 	else
@@ -706,7 +729,7 @@ static int fuse_uring_send_next_to_ring(struct fuse_ring_ent *ent,
 	int err;
 	struct io_uring_cmd *cmd;
 
-	err = fuse_uring_prepare_send(ent, req);
+	err = fuse_uring_prepare_send(ent, req, issue_flags);
 	if (err)
 		return err;
 
@@ -811,7 +834,7 @@ static void fuse_uring_commit(struct fuse_ring_ent *ent, struct fuse_req *req,
 		goto out;
 	}
 
-	err = fuse_uring_copy_from_ring(ring, req, ent);
+	err = fuse_uring_copy_from_ring(ring, req, ent, issue_flags);
 out:
 	fuse_uring_req_end(ent, req, err);
 }
@@ -854,6 +877,18 @@ static int fuse_ring_ent_set_commit(struct fuse_ring_ent *ent)
 	return 0;
 }
 
+/* The command has to use the same payload buffer as the entry registration */
+static bool fuse_uring_cmd_buf_matches(struct io_uring_cmd *cmd,
+				       struct fuse_ring_ent *ent)
+{
+	bool fixed = cmd->flags & IORING_URING_CMD_FIXED;
+
+	if (fixed != ent->payload_fixed)
+		return false;
+
+	return !fixed || READ_ONCE(cmd->sqe->buf_index) == ent->buf_index;
+}
+
 /* FUSE_URING_CMD_COMMIT_AND_FETCH handler */
 static int fuse_uring_commit_fetch(struct io_uring_cmd *cmd, int issue_flags,
 				   struct fuse_conn *fc)
@@ -897,6 +932,13 @@ static int fuse_uring_commit_fetch(struct io_uring_cmd *cmd, int issue_flags,
 		spin_unlock(&queue->lock);
 		return err;
 	}
+
+	/* leave the request to a retry of the commit with the right buffer */
+	if (!fuse_uring_cmd_buf_matches(cmd, req->ring_entry)) {
+		spin_unlock(&queue->lock);
+		return -EINVAL;
+	}
+
 	list_del_init(&req->list);
 	ent = req->ring_entry;
 	req->ring_entry = NULL;
@@ -935,7 +977,8 @@ static bool is_ring_ready(struct fuse_ring *ring, int current_qid)
 	struct fuse_ring_queue *queue;
 	bool ready = true;
 
-	for (qid = 0; qid < ring->nr_queues && ready; qid++) {
+	/* the background queues are optional */
+	for (qid = 0; qid < ring->nr_fg_queues && ready; qid++) {
 		if (current_qid == qid)
 			continue;
 
@@ -971,6 +1014,7 @@ static void fuse_uring_do_register(struct fuse_ring_ent *ent,
 	spin_lock(&queue->lock);
 	ent->cmd = cmd;
 	fuse_uring_ent_avail(ent, queue);
+	WRITE_ONCE(queue->ready, true);
 	spin_unlock(&queue->lock);
 
 	if (!ring->ready) {
@@ -1012,12 +1056,14 @@ static int fuse_uring_get_iovec_from_sqe(const struct io_uring_sqe *sqe,
 
 static struct fuse_ring_ent *
 fuse_uring_create_ring_ent(struct io_uring_cmd *cmd,
-			   struct fuse_ring_queue *queue)
+			   struct fuse_ring_queue *queue,
+			   unsigned int issue_flags)
 {
 	struct fuse_ring *ring = queue->ring;
 	struct fuse_ring_ent *ent;
 	size_t payload_size;
 	struct iovec iov[FUSE_URING_IOV_SEGS];
+	struct iov_iter iter;
 	int err;
 
 	err = fuse_uring_get_iovec_from_sqe(cmd->sqe, iov);
@@ -1040,6 +1086,18 @@ fuse_uring_create_ring_ent(struct io_uring_cmd *cmd,
 		return ERR_PTR(err);
 	}
 
+	/* check once that the payload is within the registered buffer */
+	if (cmd->flags & IORING_URING_CMD_FIXED) {
+		err = io_uring_cmd_import_fixed((u64)(uintptr_t)iov[1].iov_base,
+						ring->max_payload_sz, ITER_DEST,
+						&iter, cmd, issue_flags);
+		if (err) {
+			pr_info_ratelimited("Invalid fixed payload buffer, err=%d\n",
+					    err);
+			return ERR_PTR(err);
+		}
+	}
+
 	err = -ENOMEM;
 	ent = kzalloc(sizeof(*ent), GFP_KERNEL_ACCOUNT);
 	if (!ent)
@@ -1050,6 +1108,10 @@ fuse_uring_create_ring_ent(struct io_uring_cmd *cmd,
 	ent->queue = queue;
 	ent->headers = iov[0].iov_base;
 	ent->payload = iov[1].iov_base;
+	if (cmd->flags & IORING_URING_CMD_FIXED) {
+		ent->payload_fixed = true;
+		ent->buf_index = READ_ONCE(cmd->sqe->buf_index);
+	}
 
 	atomic_inc(&ring->queue_refs);
 	return ent;
@@ -1093,7 +1155,7 @@ static int fuse_uring_register(struct io_uring_cmd *cmd,
 	 * case of entry errors below, will be done at ring destruction time.
 	 */
 
-	ent = fuse_uring_create_ring_ent(cmd, queue);
+	ent = fuse_uring_create_ring_ent(cmd, queue, issue_flags);
 	if (IS_ERR(ent))
 		return PTR_ERR(ent);
 
@@ -1200,7 +1262,7 @@ static void fuse_uring_send_in_task(struct io_uring_cmd *cmd,
 	int err;
 
 	if (!(issue_flags & IO_URING_F_TASK_DEAD)) {
-		err = fuse_uring_prepare_send(ent, ent->fuse_req);
+		err = fuse_uring_prepare_send(ent, ent->fuse_req, issue_flags);
 		if (err) {
 			fuse_uring_next_fuse_req(ent, queue, issue_flags);
 			return;
@@ -1212,18 +1274,30 @@ static void fuse_uring_send_in_task(struct io_uring_cmd *cmd,
 	fuse_uring_send(ent, cmd, err, issue_flags);
 }
 
-static struct fuse_ring_queue *fuse_uring_task_to_queue(struct fuse_ring *ring)
+static struct fuse_ring_queue *fuse_uring_task_to_queue(struct fuse_ring *ring,
+							bool background)
 {
 	unsigned int qid;
 	struct fuse_ring_queue *queue;
 
 	qid = task_cpu(current);
 
-	if (WARN_ONCE(qid >= ring->nr_queues,
+	if (WARN_ONCE(qid >= ring->nr_fg_queues,
 		      "Core number (%u) exceeds nr queues (%zu)\n", qid,
-		      ring->nr_queues))
+		      ring->nr_fg_queues))
 		qid = 0;
 
+	/*
+	 * Keep large readahead and writeback requests from delaying the
+	 * foreground requests of the core, if the daemon serves a separate
+	 * queue for them.
+	 */
+	if (background) {
+		queue = READ_ONCE(ring->queues[ring->nr_fg_queues + qid]);
+		if (queue && READ_ONCE(queue->ready))
+			return queue;
+	}
+
 	queue = ring->queues[qid];
 	WARN_ONCE(!queue, "Missing queue for qid %d\n", qid);
 
@@ -1248,7 +1322,7 @@ void fuse_uring_queue_fuse_req(struct fuse_iqueue *fiq, struct fuse_req *req)
 	int err;
 
 	err = -EINVAL;
-	queue = fuse_uring_task_to_queue(ring);
+	queue = fuse_uring_task_to_queue(ring, false);
 	if (!queue)
 		goto err;
 
@@ -1290,7 +1364,7 @@ bool fuse_uring_queue_bq_req(struct fuse_req *req)
 	struct fuse_ring_queue *queue;
 	struct fuse_ring_ent *ent = NULL;
 
-	queue = fuse_uring_task_to_queue(ring);
+	queue = fuse_uring_task_to_queue(ring, true);
 	if (!queue)
 		return false;
 
@@ -42,6 +42,13 @@ struct fuse_ring_ent {
 	struct fuse_uring_req_header __user *headers;
 	void __user *payload;
 
+	/*
+	 * The payload is in the io-uring registered buffer @buf_index, all
+	 * commands of the entry must use that buffer
+	 */
+	bool payload_fixed;
+	u16 buf_index;
+
 	/* the ring queue that owns the request */
 	struct fuse_ring_queue *queue;
 
@@ -63,7 +70,10 @@ struct fuse_ring_queue {
 	 */
 	struct fuse_ring *ring;
 
-	/* queue id, corresponds to the cpu core */
+	/*
+	 * queue id, corresponds to the cpu core, plus fuse_ring::nr_fg_queues
+	 * for the background queue of the core
+	 */
 	unsigned int qid;
 
 	/*
@@ -99,6 +109,9 @@ struct fuse_ring_queue {
 	unsigned int active_background;
 
 	bool stopped;
+
+	/* an entry was registered, requests can be routed to the queue */
+	bool ready;
 };
 
 /**
@@ -112,6 +125,13 @@ struct fuse_ring {
 	/* number of ring queues */
 	size_t nr_queues;
 
+	/*
+	 * number of foreground queues, one per core. The optional background
+	 * queues follow them, background requests of a core go to its
+	 * background queue once the daemon registered entries on it.
+	 */
+	size_t nr_fg_queues;
+
 	/* maximum payload/arg size */
 	size_t max_payload_sz;
 
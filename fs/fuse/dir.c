@@ -1338,6 +1338,13 @@ static int fuse_update_get_attr(struct mnt_idmap *idmap, struct inode *inode,
 
 	/* FUSE only supports basic stats and possibly btime */
 	request_mask &= STATX_BASIC_STATS | STATX_BTIME;
+
+	if (IS_ENABLED(CONFIG_FUSE_PASSTHROUGH) && stat) {
+		err = fuse_passthrough_getattr(inode, stat, request_mask, flags);
+		if (err != -EOPNOTSUPP)
+			return err;
+		err = 0;
+	}
 retry:
 	if (fc->no_statx)
 		request_mask &= STATX_BASIC_STATS;
@@ -1707,6 +1714,15 @@ static int fuse_dir_open(struct inode *inode, struct file *file)
 		 */
 		if (ff->open_flags & (FOPEN_STREAM | FOPEN_NONSEEKABLE))
 			nonseekable_open(inode, file);
+		if (IS_ENABLED(CONFIG_FUSE_PASSTHROUGH) &&
+		    (ff->open_flags & FOPEN_PASSTHROUGH)) {
+			err = fuse_passthrough_dir_open(file, inode);
+			if (err) {
+				fuse_file_release(inode, ff, file->f_flags,
+						  NULL, true);
+				return err;
+			}
+		}
 		if (!(ff->open_flags & FOPEN_KEEP_CACHE))
 			invalidate_inode_pages2(inode->i_mapping);
 	}
@@ -101,6 +101,12 @@ struct fuse_backing {
 	struct file *file;
 	struct cred *cred;
 
+	/** FUSE_BACKING_* flags of the registration */
+	unsigned int flags;
+
+	/** Metadata passthrough was revoked by the server */
+	bool revoked;
+
 	/** refcount */
 	refcount_t count;
 	struct rcu_head rcu;
@@ -1544,10 +1550,12 @@ void fuse_backing_files_init(struct fuse_conn *fc);
 void fuse_backing_files_free(struct fuse_conn *fc);
 int fuse_backing_open(struct fuse_conn *fc, struct fuse_backing_map *map);
 int fuse_backing_close(struct fuse_conn *fc, int backing_id);
+int fuse_backing_revoke(struct fuse_conn *fc, int backing_id);
 
 struct fuse_backing *fuse_passthrough_open(struct file *file,
 					   struct inode *inode,
 					   int backing_id);
+int fuse_passthrough_dir_open(struct file *file, struct inode *inode);
 void fuse_passthrough_release(struct fuse_file *ff, struct fuse_backing *fb);
 
 static inline struct file *fuse_file_passthrough(struct fuse_file *ff)
@@ -1568,6 +1576,9 @@ ssize_t fuse_passthrough_splice_write(struct pipe_inode_info *pipe,
 				      struct file *out, loff_t *ppos,
 				      size_t len, unsigned int flags);
 ssize_t fuse_passthrough_mmap(struct file *file, struct vm_area_struct *vma);
+int fuse_passthrough_readdir(struct file *file, struct dir_context *ctx);
+int fuse_passthrough_getattr(struct inode *inode, struct kstat *stat,
+			     u32 request_mask, unsigned int flags);
 
 #ifdef CONFIG_SYSCTL
 extern int fuse_sysctl_register(void);
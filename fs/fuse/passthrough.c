@@ -144,6 +144,89 @@ ssize_t fuse_passthrough_mmap(struct file *file, struct vm_area_struct *vma)
 	return backing_file_mmap(backing_file, vma, &ctx);
 }
 
+/*
+ * Iterate the backing directory of a directory opened in passthrough mode.
+ *
+ * The entries, their offsets and inode numbers are those of the backing
+ * directory.  Returns -EOPNOTSUPP if the server revoked the passthrough.
+ */
+int fuse_passthrough_readdir(struct file *file, struct dir_context *ctx)
+{
+	struct fuse_file *ff = file->private_data;
+	struct file *backing_file = fuse_file_passthrough(ff);
+	struct fuse_backing *fb;
+	const struct cred *old_cred;
+	bool revoked;
+	loff_t pos;
+	int ret;
+
+	rcu_read_lock();
+	fb = fuse_inode_backing(get_fuse_inode(file_inode(file)));
+	revoked = !fb || READ_ONCE(fb->revoked);
+	rcu_read_unlock();
+	if (revoked)
+		return -EOPNOTSUPP;
+
+	pr_debug("%s: backing_file=0x%p, pos=%lld\n", __func__,
+		 backing_file, ctx->pos);
+
+	old_cred = override_creds(ff->cred);
+	/* The fuse file may have been seeked since the last iteration */
+	if (backing_file->f_pos != ctx->pos) {
+		pos = vfs_llseek(backing_file, ctx->pos, SEEK_SET);
+		if (pos < 0) {
+			ret = pos;
+			goto out;
+		}
+	}
+	ret = iterate_dir(backing_file, ctx);
+out:
+	revert_creds(old_cred);
+	fuse_invalidate_atime(file_inode(file));
+
+	return ret;
+}
+
+/*
+ * Get the attributes of an inode from its backing file, if the server asked
+ * for it when registering the backing file.
+ *
+ * Returns -EOPNOTSUPP if the attributes should be requested from the server.
+ */
+int fuse_passthrough_getattr(struct inode *inode, struct kstat *stat,
+			     u32 request_mask, unsigned int flags)
+{
+	struct fuse_inode *fi = get_fuse_inode(inode);
+	struct fuse_backing *fb;
+	const struct cred *old_cred;
+	int err;
+
+	rcu_read_lock();
+	fb = fuse_backing_get(fuse_inode_backing(fi));
+	rcu_read_unlock();
+	if (!fb)
+		return -EOPNOTSUPP;
+
+	err = -EOPNOTSUPP;
+	if (!(fb->flags & FUSE_BACKING_PASSTHROUGH_ATTR) ||
+	    READ_ONCE(fb->revoked))
+		goto out;
+
+	old_cred = override_creds(fb->cred);
+	err = vfs_getattr(&fb->file->f_path, stat, request_mask, flags);
+	revert_creds(old_cred);
+	if (!err) {
+		/* Keep the identity of the fuse inode */
+		stat->dev = inode->i_sb->s_dev;
+		stat->ino = fi->orig_ino;
+	}
+out:
+	pr_debug("%s: fb=0x%p, err=%i\n", __func__, fb, err);
+	fuse_backing_put(fb);
+
+	return err;
+}
+
 struct fuse_backing *fuse_backing_get(struct fuse_backing *fb)
 {
 	if (fb && refcount_inc_not_zero(&fb->count))
@@ -229,7 +312,7 @@ int fuse_backing_open(struct fuse_conn *fc, struct fuse_backing_map *map)
 		goto out;
 
 	res = -EINVAL;
-	if (map->flags || map->padding)
+	if ((map->flags & ~FUSE_BACKING_FLAGS) || map->padding)
 		goto out;
 
 	file = fget_raw(map->fd);
@@ -249,6 +332,8 @@ int fuse_backing_open(struct fuse_conn *fc, struct fuse_backing_map *map)
 
 	fb->file = file;
 	fb->cred = prepare_creds();
+	fb->flags = map->flags;
+	fb->revoked = false;
 	refcount_set(&fb->count, 1);
 
 	res = fuse_backing_id_alloc(fc, fb);
@@ -296,6 +381,39 @@ int fuse_backing_close(struct fuse_conn *fc, int backing_id)
 	return err;
 }
 
+/*
+ * Stop passing metadata operations through the backing file.
+ *
+ * The backing id stays registered; files that are already open keep passing
+ * data io through the backing file.
+ */
+int fuse_backing_revoke(struct fuse_conn *fc, int backing_id)
+{
+	struct fuse_backing *fb;
+	int err;
+
+	pr_debug("%s: backing_id=%d\n", __func__, backing_id);
+
+	err = -EPERM;
+	if (!fc->passthrough || !capable(CAP_SYS_ADMIN))
+		goto out;
+
+	err = -EINVAL;
+	if (backing_id <= 0)
+		goto out;
+
+	err = -ENOENT;
+	rcu_read_lock();
+	fb = idr_find(&fc->backing_files_map, backing_id);
+	if (fb) {
+		WRITE_ONCE(fb->revoked, true);
+		err = 0;
+	}
+	rcu_read_unlock();
+out:
+	return err;
+}
+
 /*
  * Setup passthrough to a backing file.
  *
@@ -353,3 +471,57 @@ void fuse_passthrough_release(struct fuse_file *ff, struct fuse_backing *fb)
 	put_cred(ff->cred);
 	ff->cred = NULL;
 }
+
+/*
+ * Setup readdir passthrough to a backing directory.
+ *
+ * The first passthrough open of a directory attaches the backing file to the
+ * fuse inode until the inode is evicted.  Later opens must use the same
+ * backing file, so a revocation stays in effect for the life of the inode.
+ * Readdir cache is not used for the directory, hence FOPEN_CACHE_DIR is not
+ * allowed.
+ */
+#define FOPEN_PASSTHROUGH_DIR_MASK (FOPEN_PASSTHROUGH | FOPEN_KEEP_CACHE)
+
+int fuse_passthrough_dir_open(struct file *file, struct inode *inode)
+{
+	struct fuse_file *ff = file->private_data;
+	struct fuse_inode *fi = get_fuse_inode(inode);
+	struct fuse_conn *fc = get_fuse_conn(inode);
+	struct fuse_backing *fb, *oldfb;
+	int err;
+
+	if (!fc->passthrough || !ff->args ||
+	    (ff->open_flags & ~FOPEN_PASSTHROUGH_DIR_MASK))
+		return -EINVAL;
+
+	fb = fuse_passthrough_open(file, inode,
+				   ff->args->open_outarg.backing_id);
+	if (IS_ERR(fb))
+		return PTR_ERR(fb);
+
+	err = -ENOTDIR;
+	if (!S_ISDIR(file_inode(fb->file)->i_mode))
+		goto fail;
+
+	spin_lock(&fi->lock);
+	oldfb = fuse_inode_backing(fi);
+	if (!oldfb)
+		fuse_inode_backing_set(fi, fb);
+	spin_unlock(&fi->lock);
+
+	if (!oldfb)
+		return 0;
+
+	/* fuse inode holds a single refcount of backing file */
+	err = -EBUSY;
+	if (oldfb == fb) {
+		fuse_backing_put(fb);
+		return 0;
+	}
+fail:
+	fuse_passthrough_release(ff, fb);
+	fuse_backing_put(fb);
+
+	return err;
+}
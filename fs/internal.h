@@ -57,6 +57,7 @@ extern int filename_lookup(int dfd, struct filename *name, unsigned flags,
 int do_rmdir(int dfd, struct filename *name);
 int do_unlinkat(int dfd, struct filename *name);
 int may_linkat(struct mnt_idmap *idmap, const struct path *link);
+void inode_forget_may_exec(struct inode *inode);
 int do_renameat2(int olddfd, struct filename *oldname, int newdfd,
 		 struct filename *newname, unsigned int flags);
 int do_mkdirat(int dfd, struct filename *name, umode_t mode);
@@ -216,6 +217,7 @@ extern long get_nr_dirty_inodes(void);
  */
 extern int d_set_mounted(struct dentry *dentry);
 extern long prune_dcache_sb(struct super_block *sb, struct shrink_control *sc);
+extern void prune_dcache_sb_negative(struct super_block *sb);
 extern struct dentry *d_alloc_cursor(struct dentry *);
 extern struct dentry * d_alloc_pseudo(struct super_block *, const struct qstr *);
 extern char *simple_dname(struct dentry *, char *, int);
@@ -226,6 +228,8 @@ extern struct dentry *__d_lookup(const struct dentry *, const struct qstr *);
 extern struct dentry *__d_lookup_rcu(const struct dentry *parent,
 				const struct qstr *name, unsigned *seq);
 extern void d_genocide(struct dentry *);
+extern int d_lookup_many(struct dentry *dir, struct qstr *names,
+			 unsigned int nr, struct dentry **dentries);
 
 /*
  * pipe.c
@@ -252,6 +256,11 @@ int do_statx(int dfd, struct filename *filename, unsigned int flags,
 	     unsigned int mask, struct statx __user *buffer);
 int do_statx_fd(int fd, unsigned int flags, unsigned int mask,
 		struct statx __user *buffer);
+int do_statx_dirent(struct path *dir, const char *name, unsigned int flags,
+		    unsigned int mask, struct statx __user *buffer);
+int do_statx_dentry(struct path *dir, struct dentry *dentry,
+		    unsigned int flags, unsigned int mask,
+		    struct statx __user *buffer);
 
 /*
  * fs/splice.c:
@@ -52,6 +52,23 @@ static inline bool ifs_block_is_uptodate(struct iomap_folio_state *ifs,
 	return test_bit(block, ifs->state);
 }
 
+/*
+ * Check whether all blocks of the range have their bit set in the uptodate
+ * (@base 0) or the dirty (@base blocks per folio) half of the state bitmap.
+ * This is done without the state_lock, so it can only be used to skip an
+ * update that would not change the bitmap.
+ */
+static inline bool ifs_range_is_set(struct folio *folio,
+		struct iomap_folio_state *ifs, size_t off, size_t len,
+		unsigned int base)
+{
+	struct inode *inode = folio->mapping->host;
+	unsigned int first_blk = base + (off >> inode->i_blkbits);
+	unsigned int end_blk = base + ((off + len - 1) >> inode->i_blkbits) + 1;
+
+	return find_next_zero_bit(ifs->state, end_blk, first_blk) >= end_blk;
+}
+
 static bool ifs_set_range_uptodate(struct folio *folio,
 		struct iomap_folio_state *ifs, size_t off, size_t len)
 {
@@ -72,11 +89,19 @@ static void iomap_set_range_uptodate(struct folio *folio, size_t off,
 	bool uptodate = true;
 
 	if (ifs) {
+		/*
+		 * Uptodate bits are never cleared while the ifs exists, so a
+		 * range that is already uptodate does not need the lock.
+		 */
+		if (ifs_range_is_set(folio, ifs, off, len, 0)) {
+			uptodate = ifs_is_fully_uptodate(folio, ifs);
+			goto out;
+		}
 		spin_lock_irqsave(&ifs->state_lock, flags);
 		uptodate = ifs_set_range_uptodate(folio, ifs, off, len);
 		spin_unlock_irqrestore(&ifs->state_lock, flags);
 	}
-
+out:
 	if (uptodate)
 		folio_mark_uptodate(folio);
 }
@@ -94,25 +119,27 @@ static unsigned ifs_find_dirty_range(struct folio *folio,
 		struct iomap_folio_state *ifs, u64 *range_start, u64 range_end)
 {
 	struct inode *inode = folio->mapping->host;
+	unsigned int blks_per_folio = i_blocks_per_folio(inode, folio);
 	unsigned start_blk =
 		offset_in_folio(folio, *range_start) >> inode->i_blkbits;
 	unsigned end_blk = min_not_zero(
 		offset_in_folio(folio, range_end) >> inode->i_blkbits,
-		i_blocks_per_folio(inode, folio));
-	unsigned nblks = 1;
+		blks_per_folio);
+	unsigned next_blk;
 
-	while (!ifs_block_is_dirty(folio, ifs, start_blk))
-		if (++start_blk == end_blk)
-			return 0;
-
-	while (start_blk + nblks < end_blk) {
-		if (!ifs_block_is_dirty(folio, ifs, start_blk + nblks))
-			break;
-		nblks++;
-	}
+	/*
+	 * Scan the dirty half of the bitmap a word at a time, so that a large
+	 * folio with a few sparse dirty blocks does not test every clean one.
+	 */
+	start_blk = find_next_bit(ifs->state, blks_per_folio + end_blk,
+			blks_per_folio + start_blk) - blks_per_folio;
+	if (start_blk >= end_blk)
+		return 0;
+	next_blk = find_next_zero_bit(ifs->state, blks_per_folio + end_blk,
+			blks_per_folio + start_blk + 1) - blks_per_folio;
 
 	*range_start = folio_pos(folio) + (start_blk << inode->i_blkbits);
-	return nblks << inode->i_blkbits;
+	return (next_blk - start_blk) << inode->i_blkbits;
 }
 
 static unsigned iomap_find_dirty_range(struct folio *folio, u64 *range_start,
@@ -138,6 +165,11 @@ static void ifs_clear_range_dirty(struct folio *folio,
 	unsigned int nr_blks = last_blk - first_blk + 1;
 	unsigned long flags;
 
+	/* Writeback of a folio with no dirty blocks left, nothing to clear */
+	if (find_next_bit(ifs->state, blks_per_folio + last_blk + 1,
+			blks_per_folio + first_blk) > blks_per_folio + last_blk)
+		return;
+
 	spin_lock_irqsave(&ifs->state_lock, flags);
 	bitmap_clear(ifs->state, first_blk + blks_per_folio, nr_blks);
 	spin_unlock_irqrestore(&ifs->state_lock, flags);
@@ -161,6 +193,14 @@ static void ifs_set_range_dirty(struct folio *folio,
 	unsigned int nr_blks = last_blk - first_blk + 1;
 	unsigned long flags;
 
+	/*
+	 * Rewrites of already dirty blocks are the common case for small
+	 * overwrites; dirty bits are only cleared by writeback under the folio
+	 * lock, so skip the lock when there is nothing to set.
+	 */
+	if (ifs_range_is_set(folio, ifs, off, len, blks_per_folio))
+		return;
+
 	spin_lock_irqsave(&ifs->state_lock, flags);
 	bitmap_set(ifs->state, first_blk + blks_per_folio, nr_blks);
 	spin_unlock_irqrestore(&ifs->state_lock, flags);
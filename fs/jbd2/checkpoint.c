@@ -20,8 +20,28 @@
 #include <linux/errno.h>
 #include <linux/slab.h>
 #include <linux/blkdev.h>
+#include <linux/module.h>
+#include <linux/workqueue.h>
 #include <trace/events/jbd2.h>
 
+/*
+ * Number of workers writing back the buffers of a checkpoint batch in
+ * parallel.  With n workers a batch holds up to n * JBD2_NR_BATCH buffers,
+ * and the task doing the checkpoint writes the first JBD2_NR_BATCH itself.
+ */
+static unsigned int jbd2_checkpoint_workers __read_mostly = 1;
+module_param_named(checkpoint_workers, jbd2_checkpoint_workers, uint, 0644);
+MODULE_PARM_DESC(checkpoint_workers,
+		 "Number of parallel checkpoint writeback workers (1-4)");
+
+static struct workqueue_struct *jbd2_checkpoint_wq;
+
+struct jbd2_chkpt_work {
+	struct work_struct	work;
+	struct buffer_head	**bhs;
+	int			nr;
+};
+
 /*
  * Unlink a buffer from a transaction checkpoint list.
  *
@@ -123,16 +143,45 @@ __releases(&journal->j_state_lock)
 	}
 }
 
-static void
-__flush_batch(journal_t *journal, int *batch_count)
+static void __write_batch(struct buffer_head **bhs, int nr)
 {
-	int i;
 	struct blk_plug plug;
+	int i;
 
 	blk_start_plug(&plug);
-	for (i = 0; i < *batch_count; i++)
-		write_dirty_buffer(journal->j_chkpt_bhs[i], REQ_SYNC);
+	for (i = 0; i < nr; i++)
+		write_dirty_buffer(bhs[i], REQ_SYNC);
 	blk_finish_plug(&plug);
+}
+
+static void jbd2_chkpt_workfn(struct work_struct *work)
+{
+	struct jbd2_chkpt_work *cw =
+		container_of(work, struct jbd2_chkpt_work, work);
+
+	__write_batch(cw->bhs, cw->nr);
+}
+
+static void
+__flush_batch(journal_t *journal, int *batch_count)
+{
+	struct jbd2_chkpt_work works[JBD2_MAX_CHECKPOINT_WORKERS - 1];
+	int i, nr_works = 0;
+
+	/* Hand everything past the first JBD2_NR_BATCH buffers to workers */
+	for (i = JBD2_NR_BATCH; i < *batch_count; i += JBD2_NR_BATCH) {
+		struct jbd2_chkpt_work *cw = &works[nr_works++];
+
+		INIT_WORK_ONSTACK(&cw->work, jbd2_chkpt_workfn);
+		cw->bhs = &journal->j_chkpt_bhs[i];
+		cw->nr = min(*batch_count - i, JBD2_NR_BATCH);
+		queue_work(jbd2_checkpoint_wq, &cw->work);
+	}
+	__write_batch(journal->j_chkpt_bhs, min(*batch_count, JBD2_NR_BATCH));
+	for (i = 0; i < nr_works; i++) {
+		flush_work(&works[i].work);
+		destroy_work_on_stack(&works[i].work);
+	}
 
 	for (i = 0; i < *batch_count; i++) {
 		struct buffer_head *bh = journal->j_chkpt_bhs[i];
@@ -158,6 +207,9 @@ int jbd2_log_do_checkpoint(journal_t *journal)
 	transaction_t		*transaction;
 	tid_t			this_tid;
 	int			result, batch_count = 0;
+	int			batch_max = JBD2_NR_BATCH *
+		clamp(READ_ONCE(jbd2_checkpoint_workers), 1U,
+		      JBD2_MAX_CHECKPOINT_WORKERS);
 
 	jbd2_debug(1, "Start checkpoint\n");
 
@@ -273,7 +325,7 @@ int jbd2_log_do_checkpoint(journal_t *journal)
 			transaction->t_checkpoint_list = jh->b_cpnext;
 		}
 
-		if ((batch_count == JBD2_NR_BATCH) ||
+		if ((batch_count == batch_max) ||
 		    need_resched() || spin_needbreak(&journal->j_list_lock) ||
 		    jh2bh(transaction->t_checkpoint_list) == journal->j_chkpt_bhs[0])
 			goto unlock_and_flush;
@@ -715,3 +767,19 @@ void __jbd2_journal_drop_transaction(journal_t *journal, transaction_t *transact
 
 	jbd2_debug(1, "Dropping transaction %d, all done\n", transaction->t_tid);
 }
+
+int __init jbd2_journal_init_checkpoint_wq(void)
+{
+	/* Checkpointing may be needed to make progress under memory pressure */
+	jbd2_checkpoint_wq = alloc_workqueue("jbd2-checkpoint",
+					     WQ_UNBOUND | WQ_MEM_RECLAIM, 0);
+	return jbd2_checkpoint_wq ? 0 : -ENOMEM;
+}
+
+void jbd2_journal_destroy_checkpoint_wq(void)
+{
+	if (jbd2_checkpoint_wq) {
+		destroy_workqueue(jbd2_checkpoint_wq);
+		jbd2_checkpoint_wq = NULL;
+	}
+}
@@ -46,6 +46,81 @@ static void journal_end_buffer_io_sync(struct buffer_head *bh, int uptodate)
 	unlock_buffer(bh);
 }
 
+/*
+ * The log blocks of a transaction are written in bios of up to
+ * JBD2_LOG_BIO_BUFS buffers that are contiguous in the log, instead of one
+ * bio per buffer that the block layer has to merge again.
+ */
+#define JBD2_LOG_BIO_BUFS	32
+
+struct jbd2_log_bio {
+	unsigned int		nr;
+	struct buffer_head	*bhs[JBD2_LOG_BIO_BUFS];
+	struct bio		bio;	/* must be last */
+};
+
+static struct bio_set jbd2_log_bio_set;
+
+static void jbd2_log_bio_end_io(struct bio *bio)
+{
+	struct jbd2_log_bio *lb = container_of(bio, struct jbd2_log_bio, bio);
+	unsigned int i;
+
+	for (i = 0; i < lb->nr; i++)
+		lb->bhs[i]->b_end_io(lb->bhs[i], !bio->bi_status);
+	bio_put(bio);
+}
+
+/*
+ * Submit the locked log buffers @bhs, calling their b_end_io when the write
+ * completes.
+ */
+static void jbd2_submit_log_bhs(struct buffer_head **bhs, int nr,
+				blk_opf_t opf)
+{
+	struct jbd2_log_bio *lb = NULL;
+	struct bio *bio = NULL;
+	int i;
+
+	for (i = 0; i < nr; i++) {
+		struct buffer_head *bh = bhs[i];
+
+		if (bio && (lb->nr == JBD2_LOG_BIO_BUFS ||
+			    bh->b_bdev != bio->bi_bdev ||
+			    bh->b_blocknr != bhs[i - 1]->b_blocknr + 1 ||
+			    !bio_add_folio(bio, bh->b_folio, bh->b_size,
+					   bh_offset(bh)))) {
+			submit_bio(bio);
+			bio = NULL;
+		}
+		if (!bio) {
+			bio = bio_alloc_bioset(bh->b_bdev, JBD2_LOG_BIO_BUFS,
+					       opf, GFP_NOFS, &jbd2_log_bio_set);
+			bio->bi_iter.bi_sector = bh->b_blocknr * (bh->b_size >> 9);
+			bio->bi_end_io = jbd2_log_bio_end_io;
+			bio_add_folio_nofail(bio, bh->b_folio, bh->b_size,
+					     bh_offset(bh));
+			lb = container_of(bio, struct jbd2_log_bio, bio);
+			lb->nr = 0;
+		}
+		lb->bhs[lb->nr++] = bh;
+	}
+	if (bio)
+		submit_bio(bio);
+}
+
+int __init jbd2_journal_init_log_bioset(void)
+{
+	return bioset_init(&jbd2_log_bio_set, 4,
+			   offsetof(struct jbd2_log_bio, bio),
+			   BIOSET_NEED_BVECS);
+}
+
+void jbd2_journal_destroy_log_bioset(void)
+{
+	bioset_exit(&jbd2_log_bio_set);
+}
+
 /*
  * When an ext4 file is truncated, it is possible that some pages are not
  * successfully freed, because they are attached to a committing transaction.
@@ -723,9 +798,9 @@ void jbd2_journal_commit_transaction(journal_t *journal)
 				clear_buffer_dirty(bh);
 				set_buffer_uptodate(bh);
 				bh->b_end_io = journal_end_buffer_io_sync;
-				submit_bh(REQ_OP_WRITE | JBD2_JOURNAL_REQ_FLAGS,
-					  bh);
 			}
+			jbd2_submit_log_bhs(wbuf, bufs,
+				REQ_OP_WRITE | JBD2_JOURNAL_REQ_FLAGS);
 			cond_resched();
 
 			/* Force a new descriptor to be generated next
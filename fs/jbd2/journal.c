@@ -3116,6 +3116,10 @@ static int __init journal_init_caches(void)
 		ret = jbd2_journal_init_inode_cache();
 	if (ret == 0)
 		ret = jbd2_journal_init_transaction_cache();
+	if (ret == 0)
+		ret = jbd2_journal_init_log_bioset();
+	if (ret == 0)
+		ret = jbd2_journal_init_checkpoint_wq();
 	return ret;
 }
 
@@ -3127,6 +3131,8 @@ static void jbd2_journal_destroy_caches(void)
 	jbd2_journal_destroy_handle_cache();
 	jbd2_journal_destroy_inode_cache();
 	jbd2_journal_destroy_transaction_cache();
+	jbd2_journal_destroy_log_bioset();
+	jbd2_journal_destroy_checkpoint_wq();
 	jbd2_journal_destroy_slabs();
 }
 
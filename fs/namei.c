@@ -1836,15 +1836,64 @@ static struct dentry *lookup_slow(const struct qstr *name,
 	return res;
 }
 
+/*
+ * A directory with search permission for owner, group and other, no access
+ * ACL, no ->permission() and no security module checking inode permissions is
+ * searchable by everyone.  inode_permission() cannot say otherwise, so cache
+ * that in IOP_FASTPERM_MAY_EXEC and skip it on the next lookups.
+ *
+ * The mode and the security modules are checked again on every use, so
+ * chmod() and a hook that becomes active later need no invalidation.  ACL
+ * changes clear the flag with inode_forget_may_exec().  Both sides do it under
+ * ->i_lock, which orders the ACL update against the check here.
+ */
+static inline bool inode_may_exec_cached(const struct inode *inode)
+{
+	return (READ_ONCE(inode->i_opflags) & IOP_FASTPERM_MAY_EXEC) &&
+	       (READ_ONCE(inode->i_mode) & S_IXUGO) == S_IXUGO &&
+	       security_inode_permission_cacheable();
+}
+
+static void inode_cache_may_exec(struct inode *inode)
+{
+	if ((inode->i_mode & S_IXUGO) != S_IXUGO ||
+	    !(inode->i_opflags & IOP_FASTPERM))
+		return;
+	if (!security_inode_permission_cacheable())
+		return;
+
+	spin_lock(&inode->i_lock);
+#ifdef CONFIG_FS_POSIX_ACL
+	if (IS_POSIXACL(inode) && inode->i_acl) {
+		spin_unlock(&inode->i_lock);
+		return;
+	}
+#endif
+	inode->i_opflags |= IOP_FASTPERM_MAY_EXEC;
+	spin_unlock(&inode->i_lock);
+}
+
+void inode_forget_may_exec(struct inode *inode)
+{
+	spin_lock(&inode->i_lock);
+	inode->i_opflags &= ~IOP_FASTPERM_MAY_EXEC;
+	spin_unlock(&inode->i_lock);
+}
+
 static inline int may_lookup(struct mnt_idmap *idmap,
 			     struct nameidata *restrict nd)
 {
 	int err, mask;
 
+	if (likely(inode_may_exec_cached(nd->inode)))
+		return 0;
+
 	mask = nd->flags & LOOKUP_RCU ? MAY_NOT_BLOCK : 0;
 	err = inode_permission(idmap, nd->inode, mask | MAY_EXEC);
-	if (likely(!err))
+	if (likely(!err)) {
+		inode_cache_may_exec(nd->inode);
 		return 0;
+	}
 
 	// If we failed, and we weren't in LOOKUP_RCU, it's final
 	if (!(nd->flags & LOOKUP_RCU))
@@ -916,6 +916,48 @@ static void fanotify_insert_event(struct fsnotify_group *group,
 	hlist_add_head(&event->merge_list, hlist);
 }
 
+/*
+ * Merge a path event into the last queued event before allocating it, if
+ * both are about the same object.  Runs of events on the same file, e.g. a
+ * FAN_MODIFY for every write(), are the common case for watchers of whole
+ * mounts and filesystems, and this saves allocating, hashing and freeing an
+ * event that fanotify_merge() would merge anyway.
+ */
+static bool fanotify_merge_last(struct fsnotify_group *group, u32 mask,
+				const void *data, int data_type)
+{
+	const struct path *path = fsnotify_data_path(data, data_type);
+	struct fanotify_event *last;
+	struct pid *pid;
+	bool merged = false;
+
+	if (!path || FAN_GROUP_FLAG(group, FANOTIFY_FID_BITS) ||
+	    fanotify_is_perm_event(mask) || fanotify_is_error_event(mask))
+		return false;
+
+	if (FAN_GROUP_FLAG(group, FAN_REPORT_TID))
+		pid = task_pid(current);
+	else
+		pid = task_tgid(current);
+
+	spin_lock(&group->notification_lock);
+	if (!list_empty(&group->notification_list)) {
+		last = FANOTIFY_E(list_last_entry(&group->notification_list,
+						  struct fsnotify_event, list));
+		/* Same conditions as fanotify_should_merge() for path events */
+		if (last->type == FANOTIFY_EVENT_TYPE_PATH &&
+		    last->pid == pid &&
+		    (last->mask & FS_ISDIR) == (mask & FS_ISDIR) &&
+		    fanotify_path_equal(fanotify_event_path(last), path)) {
+			last->mask |= mask;
+			merged = true;
+		}
+	}
+	spin_unlock(&group->notification_lock);
+
+	return merged;
+}
+
 static int fanotify_handle_event(struct fsnotify_group *group, u32 mask,
 				 const void *data, int data_type,
 				 struct inode *dir,
@@ -970,6 +1012,9 @@ static int fanotify_handle_event(struct fsnotify_group *group, u32 mask,
 			return 0;
 	}
 
+	if (fanotify_merge_last(group, mask, data, data_type))
+		return 0;
+
 	if (FAN_GROUP_FLAG(group, FANOTIFY_FID_BITS))
 		fsid = fanotify_get_fsid(iter_info);
 
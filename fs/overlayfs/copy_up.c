@@ -269,6 +269,7 @@ static int ovl_copy_up_file(struct ovl_fs *ofs, struct dentry *dentry,
 	loff_t data_pos = -1;
 	loff_t hole_len;
 	bool skip_hole = false;
+	bool try_copy_range = true;
 	int error = 0;
 
 	ovl_path_lowerdata(dentry, &datapath);
@@ -346,6 +347,29 @@ static int ovl_copy_up_file(struct ovl_fs *ofs, struct dentry *dentry,
 		if (error)
 			break;
 
+		/*
+		 * Let the filesystem offload the copy if it can (e.g. server
+		 * side copy), so data doesn't have to pass through our page
+		 * cache. Fall back to splice if it doesn't support that.
+		 */
+		if (try_copy_range) {
+			bytes = vfs_copy_file_range(old_file, old_pos,
+						    new_file, new_pos,
+						    this_len, 0);
+			if (bytes > 0) {
+				old_pos += bytes;
+				new_pos += bytes;
+				len -= bytes;
+				continue;
+			}
+			if (bytes != -EOPNOTSUPP && bytes != -EXDEV &&
+			    bytes != -EINVAL) {
+				error = bytes;
+				break;
+			}
+			try_copy_range = false;
+		}
+
 		bytes = do_splice_direct(old_file, &old_pos,
 					 new_file, &new_pos,
 					 this_len, SPLICE_F_MOVE);
@@ -14,6 +14,9 @@
 #include <linux/proc_ns.h>
 #include <linux/pseudo_fs.h>
 #include <linux/ptrace.h>
+#include <linux/sched/cputime.h>
+#include <linux/sched/mm.h>
+#include <linux/sched/signal.h>
 #include <linux/seq_file.h>
 #include <uapi/linux/pidfd.h>
 #include <linux/ipc_namespace.h>
@@ -240,6 +243,73 @@ static inline bool pid_in_current_pidns(const struct pid *pid)
 	return false;
 }
 
+/*
+ * Same sources and the same consistency as do_task_stat(): the counters of
+ * dead threads and the live ones are summed under sig->stats_lock.
+ */
+static void pidfd_info_stats(struct task_struct *task, bool whole,
+			     struct pidfd_info *kinfo)
+{
+	struct signal_struct *sig = task->signal;
+	unsigned long min_flt, maj_flt, nvcsw, nivcsw, flags;
+	struct mm_struct *mm;
+	u64 utime, stime;
+	unsigned int seq = 1;
+
+	if (whole) {
+		do {
+			struct task_struct *t;
+
+			seq++; /* 2 on the 1st/lockless path, otherwise odd */
+			flags = read_seqbegin_or_lock_irqsave(&sig->stats_lock,
+							      &seq);
+			min_flt = sig->min_flt;
+			maj_flt = sig->maj_flt;
+			nvcsw = sig->nvcsw;
+			nivcsw = sig->nivcsw;
+
+			rcu_read_lock();
+			__for_each_thread(sig, t) {
+				min_flt += t->min_flt;
+				maj_flt += t->maj_flt;
+				nvcsw += t->nvcsw;
+				nivcsw += t->nivcsw;
+			}
+			rcu_read_unlock();
+		} while (need_seqretry(&sig->stats_lock, seq));
+		done_seqretry_irqrestore(&sig->stats_lock, seq, flags);
+
+		thread_group_cputime_adjusted(task, &utime, &stime);
+		kinfo->nr_threads = READ_ONCE(sig->nr_threads);
+	} else {
+		task_cputime_adjusted(task, &utime, &stime);
+		min_flt = task->min_flt;
+		maj_flt = task->maj_flt;
+		nvcsw = task->nvcsw;
+		nivcsw = task->nivcsw;
+		kinfo->nr_threads = 1;
+	}
+
+	kinfo->utime = utime;
+	kinfo->stime = stime;
+	kinfo->start_time = task->start_boottime;
+	kinfo->min_flt = min_flt;
+	kinfo->maj_flt = maj_flt;
+	kinfo->nvcsw = nvcsw;
+	kinfo->nivcsw = nivcsw;
+	kinfo->nice = task_nice(task);
+	kinfo->state = task_state_to_char(task);
+	kinfo->processor = task_cpu(task);
+
+	mm = get_task_mm(task);
+	if (mm) {
+		kinfo->vsize = mm->total_vm << PAGE_SHIFT;
+		kinfo->rss = get_mm_rss(mm) << PAGE_SHIFT;
+		mmput(mm);
+	}
+	kinfo->mask |= PIDFD_INFO_STATS;
+}
+
 static long pidfd_info(struct file *file, unsigned int cmd, unsigned long arg)
 {
 	struct pidfd_info __user *uinfo = (struct pidfd_info __user *)arg;
@@ -331,6 +401,9 @@ static long pidfd_info(struct file *file, unsigned int cmd, unsigned long arg)
 	 * the fields are set correctly, or return ESRCH to avoid providing
 	 * incomplete information. */
 
+	if ((mask & PIDFD_INFO_STATS) && usize >= PIDFD_INFO_SIZE_STATS)
+		pidfd_info_stats(task, !(file->f_flags & PIDFD_THREAD), &kinfo);
+
 	kinfo.ppid = task_ppid_nr_ns(task, NULL);
 	kinfo.tgid = task_tgid_vnr(task);
 	kinfo.pid = task_pid_vnr(task);
@@ -880,6 +953,8 @@ struct file *pidfs_alloc_file(struct pid *pid, unsigned int flags)
 	BUILD_BUG_ON(PIDFD_CLONE == PIDFD_THREAD);
 	BUILD_BUG_ON(PIDFD_CLONE == PIDFD_NONBLOCK);
 
+	BUILD_BUG_ON(sizeof(struct pidfd_info) != PIDFD_INFO_SIZE_STATS);
+
 	ret = path_from_stashed(&pid->stashed, pidfs_mnt, get_pid(pid), &path);
 	if (ret < 0)
 		return ERR_PTR(ret);
@@ -112,6 +112,18 @@ void pipe_double_lock(struct pipe_inode_info *pipe1,
 	pipe_lock(pipe2);
 }
 
+/*
+ * Pages released by the reader are kept for the next writes.  Streaming
+ * through a large pipe releases up to a full ring of pages between two
+ * writes, so scale the cache with the pipe size, which also bounds the
+ * memory it pins to what the pipe may hold anyway.
+ */
+static unsigned int anon_pipe_cache_limit(struct pipe_inode_info *pipe)
+{
+	return clamp(pipe->max_usage / 8, 2U,
+		     (unsigned int)ARRAY_SIZE(pipe->tmp_page));
+}
+
 static struct page *anon_pipe_get_page(struct pipe_inode_info *pipe)
 {
 	for (int i = 0; i < ARRAY_SIZE(pipe->tmp_page); i++) {
@@ -129,7 +141,9 @@ static void anon_pipe_put_page(struct pipe_inode_info *pipe,
 			       struct page *page)
 {
 	if (page_count(page) == 1) {
-		for (int i = 0; i < ARRAY_SIZE(pipe->tmp_page); i++) {
+		unsigned int limit = anon_pipe_cache_limit(pipe);
+
+		for (int i = 0; i < limit; i++) {
 			if (!pipe->tmp_page[i]) {
 				pipe->tmp_page[i] = page;
 				return;
@@ -1354,6 +1368,22 @@ int pipe_resize_ring(struct pipe_inode_info *pipe, unsigned int nr_slots)
 	return 0;
 }
 
+/*
+ * Resize a pipe that is internal to the kernel, like current->splice_pipe.
+ * Such a pipe only holds references to pages for the duration of a single
+ * transfer, so, unlike F_SETPIPE_SZ, the new size is not charged to the
+ * pipe buffers of the user.
+ */
+int pipe_resize_internal(struct pipe_inode_info *pipe, unsigned int nr_slots)
+{
+	unsigned int nr_accounted = pipe->nr_accounted;
+	int ret;
+
+	ret = pipe_resize_ring(pipe, nr_slots);
+	pipe->nr_accounted = nr_accounted;
+	return ret;
+}
+
 /*
  * Allocate a new array of pipe buffers and copy the info over. Returns the
  * pipe size if successful, or return -ERROR on error.
@@ -86,6 +86,8 @@ void set_cached_acl(struct inode *inode, int type, struct posix_acl *acl)
 	old = xchg(p, posix_acl_dup(acl));
 	if (!is_uncached_acl(old))
 		posix_acl_release(old);
+	if (type == ACL_TYPE_ACCESS && acl)
+		inode_forget_may_exec(inode);
 }
 EXPORT_SYMBOL(set_cached_acl);
 
@@ -101,6 +103,8 @@ static void __forget_cached_acl(struct posix_acl **p)
 void forget_cached_acl(struct inode *inode, int type)
 {
 	__forget_cached_acl(acl_by_type(inode, type));
+	if (type == ACL_TYPE_ACCESS)
+		inode_forget_may_exec(inode);
 }
 EXPORT_SYMBOL(forget_cached_acl);
 
@@ -108,6 +112,7 @@ void forget_all_cached_acls(struct inode *inode)
 {
 	__forget_cached_acl(&inode->i_acl);
 	__forget_cached_acl(&inode->i_default_acl);
+	inode_forget_may_exec(inode);
 }
 EXPORT_SYMBOL(forget_all_cached_acls);
 
@@ -92,6 +92,7 @@
 #include <linux/sched/coredump.h>
 #include <linux/sched/debug.h>
 #include <linux/sched/stat.h>
+#include <linux/sched/numa_balancing.h>
 #include <linux/posix-timers.h>
 #include <linux/time_namespace.h>
 #include <linux/resctrl.h>
@@ -523,6 +524,27 @@ static int proc_pid_schedstat(struct seq_file *m, struct pid_namespace *ns,
 }
 #endif
 
+#ifdef CONFIG_NUMA_BALANCING
+/*
+ * Provides /proc/PID/numa_vma_stats
+ */
+static int proc_pid_numa_vma_stats(struct seq_file *m, struct pid_namespace *ns,
+				   struct pid *pid, struct task_struct *task)
+{
+	struct mm_struct *mm;
+	int ret;
+
+	mm = mm_access(task, PTRACE_MODE_READ_FSCREDS);
+	if (IS_ERR_OR_NULL(mm))
+		return PTR_ERR_OR_ZERO(mm);
+
+	ret = proc_numa_vma_stats_show(m, mm);
+	mmput(mm);
+
+	return ret;
+}
+#endif
+
 #ifdef CONFIG_LATENCYTOP
 static int lstats_show_proc(struct seq_file *m, void *v)
 {
@@ -2623,6 +2645,7 @@ static ssize_t timerslack_ns_write(struct file *file, const char __user *buf,
 	else if (slack_ns == 0)
 		slack_ns = p->default_timer_slack_ns;
 	p->timer_slack_ns = slack_ns;
+	p->saved_timer_slack_ns = 0;
 	task_unlock(p);
 
 out:
@@ -3337,6 +3360,9 @@ static const struct pid_entry tgid_base_stuff[] = {
 	REG("maps",       S_IRUGO, proc_pid_maps_operations),
 #ifdef CONFIG_NUMA
 	REG("numa_maps",  S_IRUGO, proc_pid_numa_maps_operations),
+#endif
+#ifdef CONFIG_NUMA_BALANCING
+	ONE("numa_vma_stats", S_IRUSR, proc_pid_numa_vma_stats),
 #endif
 	REG("mem",        S_IRUSR|S_IWUSR, proc_mem_operations),
 	LNK("cwd",        proc_cwd_link),
@@ -3685,6 +3711,9 @@ static const struct pid_entry tid_base_stuff[] = {
 #endif
 #ifdef CONFIG_NUMA
 	REG("numa_maps", S_IRUGO, proc_pid_numa_maps_operations),
+#endif
+#ifdef CONFIG_NUMA_BALANCING
+	ONE("numa_vma_stats", S_IRUSR, proc_pid_numa_vma_stats),
 #endif
 	REG("mem",       S_IRUSR|S_IWUSR, proc_mem_operations),
 	LNK("cwd",       proc_cwd_link),
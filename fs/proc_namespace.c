@@ -58,6 +58,11 @@ static int show_sb_opts(struct seq_file *m, struct super_block *sb)
 			seq_puts(m, fs_infop->str);
 	}
 
+	if (sb->s_iflags & SB_I_PAGECACHE_INTERLEAVE)
+		seq_puts(m, ",pagecache_policy=interleave");
+	else if (sb->s_iflags & SB_I_PAGECACHE_LOCAL)
+		seq_puts(m, ",pagecache_policy=local");
+
 	return security_sb_show_options(m, sb);
 }
 
@@ -230,6 +235,11 @@ static int show_vfsstat(struct seq_file *m, struct vfsmount *mnt)
 		err = sb->s_op->show_stats(m, mnt_path.dentry);
 	}
 
+	seq_printf(m, "\n\treadahead: windows %lld hits %lld wasted %lld",
+		   percpu_counter_sum_positive(&sb->s_ra_windows),
+		   percpu_counter_sum_positive(&sb->s_ra_hits),
+		   percpu_counter_sum_positive(&sb->s_ra_wasted));
+
 	seq_putc(m, '\n');
 out:
 	return err;
@@ -14,6 +14,7 @@
 #include <linux/stat.h>
 #include <linux/file.h>
 #include <linux/fs.h>
+#include <linux/mount.h>
 #include <linux/fsnotify.h>
 #include <linux/dirent.h>
 #include <linux/security.h>
@@ -22,6 +23,8 @@
 #include <linux/compat.h>
 #include <linux/uaccess.h>
 
+#include "internal.h"
+
 /*
  * Some filesystems were never converted to '->iterate_shared()'
  * and their directory iterators want the inode lock held for
@@ -416,6 +419,217 @@ SYSCALL_DEFINE3(getdents64, unsigned int, fd,
 	return error;
 }
 
+struct getdents_statx_callback {
+	struct dir_context ctx;
+	struct linux_dirent64_statx __user *current_dir;
+	int prev_reclen;
+	int count;
+	int error;
+};
+
+static bool filldir64_statx(struct dir_context *ctx, const char *name,
+			    int namlen, loff_t offset, u64 ino,
+			    unsigned int d_type)
+{
+	struct linux_dirent64_statx __user *dirent, *prev;
+	struct getdents_statx_callback *buf =
+		container_of(ctx, struct getdents_statx_callback, ctx);
+	int reclen = ALIGN(offsetof(struct linux_dirent64_statx, d_name) +
+			   namlen + 1, sizeof(u64));
+	int prev_reclen;
+
+	buf->error = verify_dirent_name(name, namlen);
+	if (unlikely(buf->error))
+		return false;
+	buf->error = -EINVAL;	/* only used if we fail.. */
+	if (reclen > buf->count)
+		return false;
+	prev_reclen = buf->prev_reclen;
+	if (prev_reclen && signal_pending(current))
+		return false;
+	dirent = buf->current_dir;
+	prev = (void __user *)dirent - prev_reclen;
+	if (!user_write_access_begin(prev, reclen + prev_reclen))
+		goto efault;
+
+	/* This might be 'dirent->d_off', but if so it will get overwritten */
+	unsafe_put_user(offset, &prev->d_off, efault_end);
+	unsafe_put_user(ino, &dirent->d_ino, efault_end);
+	unsafe_put_user(reclen, &dirent->d_reclen, efault_end);
+	unsafe_put_user(d_type, &dirent->d_type, efault_end);
+	unsafe_put_user(0, &dirent->d_error, efault_end);
+	unsafe_copy_dirent_name(dirent->d_name, name, namlen, efault_end);
+	user_write_access_end();
+
+	buf->prev_reclen = reclen;
+	buf->current_dir = (void __user *)dirent + reclen;
+	buf->count -= reclen;
+	return true;
+
+efault_end:
+	user_write_access_end();
+efault:
+	buf->error = -EFAULT;
+	return false;
+}
+
+/* Names looked up together in the dcache, as many as fit in a __getname() */
+#define GETDENTS_STATX_BATCH	(PATH_MAX / (NAME_MAX + 1))
+
+static int getdents_statx_put_error(struct linux_dirent64_statx __user *d,
+				    int error)
+{
+	if (put_user(error, &d->d_error) ||
+	    clear_user(&d->d_stx, sizeof(d->d_stx)))
+		return -EFAULT;
+	return 0;
+}
+
+/*
+ * Fill in the statx of the entries returned by iterate_dir().  This can't be
+ * done from the actor, which runs under the lock of the directory that the
+ * lookup of the entries would take again.  The names are read back from the
+ * records just written, a batch at a time.  Each batch is looked up in the
+ * dcache with d_lookup_many(), and the statx of the entries found there is
+ * filled in without a path walk.
+ */
+static int getdents_statx_fill(struct file *file, void __user *dirent,
+			       int len, unsigned int mask, unsigned int flags)
+{
+	struct linux_dirent64_statx __user *d[GETDENTS_STATX_BATCH];
+	struct dentry *dentries[GETDENTS_STATX_BATCH] = {};
+	struct qstr names[GETDENTS_STATX_BATCH];
+	struct path *dir = &file->f_path;
+	bool cached;
+	char *buf;
+	int off = 0, error = 0;
+
+	buf = __getname();
+	if (!buf)
+		return -ENOMEM;
+
+	/* The path walk checks it for each entry, the dcache lookup doesn't */
+	cached = !inode_permission(mnt_idmap(dir->mnt), d_inode(dir->dentry),
+				   MAY_EXEC);
+
+	while (off < len) {
+		unsigned int i, nr = 0;
+
+		while (off < len && nr < GETDENTS_STATX_BATCH) {
+			struct linux_dirent64_statx __user *de = dirent + off;
+			char *name = buf + nr * (NAME_MAX + 1);
+			unsigned short reclen;
+			long namlen;
+
+			if (get_user(reclen, &de->d_reclen) || unlikely(!reclen)) {
+				error = -EFAULT;
+				goto out;
+			}
+			off += reclen;
+			namlen = strncpy_from_user(name, de->d_name, NAME_MAX + 1);
+			if (namlen < 0) {
+				error = namlen;
+				goto out;
+			}
+
+			if (namlen == NAME_MAX + 1 || memchr(name, '/', namlen)) {
+				error = getdents_statx_put_error(de, -EINVAL);
+				if (error)
+					goto out;
+				continue;
+			}
+			d[nr] = de;
+			names[nr] = (struct qstr)QSTR_INIT(name, namlen);
+			nr++;
+		}
+
+		if (cached && d_lookup_many(dir->dentry, names, nr, dentries) < 0)
+			memset(dentries, 0, nr * sizeof(*dentries));
+
+		for (i = 0; i < nr; i++) {
+			int err = -EAGAIN;
+
+			if (dentries[i]) {
+				err = do_statx_dentry(dir, dentries[i], flags,
+						      mask, &d[i]->d_stx);
+				dput(dentries[i]);
+				dentries[i] = NULL;
+			}
+			if (err == -EAGAIN)
+				err = do_statx_dirent(dir,
+						(const char *)names[i].name,
+						flags, mask, &d[i]->d_stx);
+			if (err) {
+				error = getdents_statx_put_error(d[i], err);
+				if (error)
+					goto out;
+			}
+		}
+
+		if (fatal_signal_pending(current)) {
+			error = -EINTR;
+			goto out;
+		}
+		cond_resched();
+	}
+out:
+	/* Left over by an error in the middle of a batch */
+	for (unsigned int i = 0; i < GETDENTS_STATX_BATCH; i++)
+		dput(dentries[i]);
+	__putname(buf);
+	return error;
+}
+
+/**
+ * sys_getdents64_statx - read directory entries along with their statx
+ * @fd: directory to read
+ * @dirent: buffer of struct linux_dirent64_statx records
+ * @count: size of @dirent
+ * @mask: STATX_* fields wanted for every entry
+ * @flags: AT_STATX_SYNC_TYPE and AT_NO_AUTOMOUNT
+ *
+ * Like getdents64() followed by an fstatat(AT_SYMLINK_NOFOLLOW) of every
+ * entry returned, in one call.
+ */
+SYSCALL_DEFINE5(getdents64_statx, unsigned int, fd,
+		struct linux_dirent64_statx __user *, dirent,
+		unsigned int, count, unsigned int, mask, unsigned int, flags)
+{
+	CLASS(fd_pos, f)(fd);
+	struct getdents_statx_callback buf = {
+		.ctx.actor = filldir64_statx,
+		.count = count,
+		.current_dir = dirent
+	};
+	int error;
+
+	if (mask & STATX__RESERVED)
+		return -EINVAL;
+	if (flags & ~(AT_STATX_SYNC_TYPE | AT_NO_AUTOMOUNT))
+		return -EINVAL;
+	if ((flags & AT_STATX_SYNC_TYPE) == AT_STATX_SYNC_TYPE)
+		return -EINVAL;
+	if (fd_empty(f))
+		return -EBADF;
+
+	error = iterate_dir(fd_file(f), &buf.ctx);
+	if (error >= 0)
+		error = buf.error;
+	if (buf.prev_reclen) {
+		struct linux_dirent64_statx __user *lastdirent;
+		typeof(lastdirent->d_off) d_off = buf.ctx.pos;
+
+		lastdirent = (void __user *) buf.current_dir - buf.prev_reclen;
+		if (put_user(d_off, &lastdirent->d_off))
+			return -EFAULT;
+		error = getdents_statx_fill(fd_file(f), dirent,
+					    count - buf.count, mask, flags);
+		if (!error)
+			error = count - buf.count;
+	}
+	return error;
+}
+
 #ifdef CONFIG_COMPAT
 struct compat_old_linux_dirent {
 	compat_ulong_t	d_ino;
@@ -33,12 +33,20 @@
 #include <linux/fsnotify.h>
 #include <linux/security.h>
 #include <linux/gfp.h>
+#include <linux/log2.h>
 #include <linux/net.h>
 #include <linux/socket.h>
 #include <linux/sched/signal.h>
 
 #include "internal.h"
 
+/*
+ * Maximum number of slots the internal pipe of splice_direct_to_actor() is
+ * grown to, so that large sendfile() and copy_file_range() calls move more
+ * than PIPE_DEF_BUFFERS pages per round trip through the actor.
+ */
+#define SPLICE_DIRECT_MAX_SLOTS	256
+
 /*
  * Splice doesn't support FMODE_NOWAIT. Since pipes may set this flag to
  * indicate they support non-blocking reads or writes, we must clear it
@@ -1063,6 +1071,17 @@ ssize_t splice_direct_to_actor(struct file *in, struct splice_desc *sd,
 	bytes = 0;
 	len = sd->total_len;
 
+	/*
+	 * Every round reads at most a pipe-full and then calls the actor, so
+	 * grow the pipe for large transfers.  This is only an optimisation,
+	 * on failure keep going with the current size.
+	 */
+	if (len > (size_t)pipe->max_usage * PAGE_SIZE &&
+	    pipe->ring_size < SPLICE_DIRECT_MAX_SLOTS)
+		pipe_resize_internal(pipe, roundup_pow_of_two(
+				min_t(size_t, DIV_ROUND_UP(len, PAGE_SIZE),
+				      SPLICE_DIRECT_MAX_SLOTS)));
+
 	/* Don't block on output, we have to drain the direct pipe. */
 	flags = sd->flags;
 	sd->flags &= ~SPLICE_F_NONBLOCK;
@@ -10,6 +10,7 @@
 #include <linux/mm.h>
 #include <linux/errno.h>
 #include <linux/file.h>
+#include <linux/fs_struct.h>
 #include <linux/highuid.h>
 #include <linux/fs.h>
 #include <linux/namei.h>
@@ -788,6 +789,109 @@ int do_statx_fd(int fd, unsigned int flags, unsigned int mask,
 	return cp_statx(&stat, buffer);
 }
 
+/*
+ * Find the parent of @dir the way a ".." path walk step does: stay at the
+ * process root, and go up through the mounts @dir is the root of.
+ */
+static int statx_dirent_dotdot(struct path *dir, struct path *path)
+{
+	struct path root;
+	int error;
+
+	error = inode_permission(mnt_idmap(dir->mnt), d_inode(dir->dentry),
+				 MAY_EXEC);
+	if (error)
+		return error;
+
+	get_fs_root(current->fs, &root);
+	*path = *dir;
+	path_get(path);
+	while (!path_equal(path, &root)) {
+		if (path->dentry != path->mnt->mnt_root) {
+			struct dentry *parent = dget_parent(path->dentry);
+
+			dput(path->dentry);
+			path->dentry = parent;
+			break;
+		}
+		if (!follow_up(path))
+			break;
+	}
+	path_put(&root);
+	return 0;
+}
+
+/*
+ * Fast path of do_statx_dirent() for a cached child of @dir, which the path
+ * walk would reach without calling into the filesystem.  The caller checked
+ * the search permission of @dir.  Returns -EAGAIN when @dentry needs the full
+ * lookup: it is negative, may need revalidation, or is a mount point or an
+ * automount point.
+ */
+int do_statx_dentry(struct path *dir, struct dentry *dentry,
+		    unsigned int flags, unsigned int mask,
+		    struct statx __user *buffer)
+{
+	struct path path = { .mnt = dir->mnt, .dentry = dentry };
+	struct kstat stat;
+	int error;
+
+	if (d_is_negative(dentry) || d_managed(dentry) ||
+	    (dentry->d_flags & (DCACHE_OP_REVALIDATE |
+				DCACHE_OP_WEAK_REVALIDATE)))
+		return -EAGAIN;
+
+	error = vfs_statx_path(&path, flags | AT_SYMLINK_NOFOLLOW, &stat,
+			       mask & ~STATX_CHANGE_COOKIE);
+	if (error)
+		return error;
+
+	return cp_statx(&stat, buffer);
+}
+
+/*
+ * statx() of an entry of the directory @dir for getdents64_statx(), @name has
+ * no '/'.  The lookup starts from @dir itself rather than from a descriptor,
+ * which the caller's process could have closed or reused meanwhile.
+ */
+int do_statx_dirent(struct path *dir, const char *name, unsigned int flags,
+		    unsigned int mask, struct statx __user *buffer)
+{
+	unsigned int lookup_flags;
+	struct filename *filename;
+	struct kstat stat;
+	struct path path;
+	int error;
+
+	flags |= AT_SYMLINK_NOFOLLOW;
+	lookup_flags = statx_lookup_flags(flags);
+	mask &= ~STATX_CHANGE_COOKIE;
+
+	filename = getname_kernel(name);
+	if (IS_ERR(filename))
+		return PTR_ERR(filename);
+retry:
+	/* With @dir as the root of the walk, ".." would not leave it */
+	if (strcmp(name, ".."))
+		error = filename_lookup(AT_FDCWD, filename, lookup_flags, &path,
+					dir);
+	else
+		error = statx_dirent_dotdot(dir, &path);
+	if (!error) {
+		error = vfs_statx_path(&path, flags, &stat, mask);
+		path_put(&path);
+		if (retry_estale(error, lookup_flags)) {
+			lookup_flags |= LOOKUP_REVAL;
+			goto retry;
+		}
+	}
+	putname(filename);
+	if (error)
+		return error;
+
+	return cp_statx(&stat, buffer);
+}
+
 /**
  * sys_statx - System call to get enhanced stats
  * @dfd: Base directory to pathwalk from *or* fd to stat.
@@ -270,10 +270,25 @@ static unsigned long super_cache_count(struct shrinker *shrink,
 	return total_objects;
 }
 
+static void super_dentry_negative_work(struct work_struct *work)
+{
+	struct super_block *sb = container_of(work, struct super_block,
+					      s_dentry_negative_work);
+
+	if (!super_trylock_shared(sb))
+		return;
+	prune_dcache_sb_negative(sb);
+	super_unlock_shared(sb);
+}
+
 static void destroy_super_work(struct work_struct *work)
 {
 	struct super_block *s = container_of(work, struct super_block,
 							destroy_work);
+	percpu_counter_destroy(&s->s_dentry_negative);
+	percpu_counter_destroy(&s->s_ra_windows);
+	percpu_counter_destroy(&s->s_ra_hits);
+	percpu_counter_destroy(&s->s_ra_wasted);
 	fsnotify_sb_free(s);
 	security_sb_free(s);
 	put_user_ns(s->s_user_ns);
@@ -389,6 +404,13 @@ static struct super_block *alloc_super(struct file_system_type *type, int flags,
 		goto fail;
 	if (list_lru_init_memcg(&s->s_inode_lru, s->s_shrink))
 		goto fail;
+	if (percpu_counter_init(&s->s_dentry_negative, 0, GFP_KERNEL))
+		goto fail;
+	if (percpu_counter_init(&s->s_ra_windows, 0, GFP_KERNEL) ||
+	    percpu_counter_init(&s->s_ra_hits, 0, GFP_KERNEL) ||
+	    percpu_counter_init(&s->s_ra_wasted, 0, GFP_KERNEL))
+		goto fail;
+	INIT_WORK(&s->s_dentry_negative_work, super_dentry_negative_work);
 	return s;
 
 fail:
@@ -474,6 +496,12 @@ void deactivate_locked_super(struct super_block *s)
 
 		kill_super_notify(s);
 
+		/*
+		 * All dentries are gone, so the negative dentry pruning cannot
+		 * be queued again.
+		 */
+		cancel_work_sync(&s->s_dentry_negative_work);
+
 		/*
 		 * Since list_lru_destroy() may sleep, we cannot call it from
 		 * put_super(), where we hold the sb_lock. Therefore we destroy
@@ -1013,6 +1041,37 @@ struct super_block *user_get_super(dev_t dev, bool excl)
 	return NULL;
 }
 
+/*
+ * Apply a pagecache_policy= mount option to a superblock that already exists.
+ * Without the option the superblock keeps its current policy, "default" sets
+ * it back to none.
+ *
+ * Other s_iflags can change under us, so only our bits are touched, with
+ * atomic bit operations. The old bit is cleared before the new one is set:
+ * a concurrent allocation may see no policy for a moment, but never both.
+ */
+static void sb_set_pagecache_policy(struct super_block *sb,
+				    struct fs_context *fc)
+{
+	unsigned int policy = fc->s_iflags & SB_I_PAGECACHE_MASK;
+
+	BUILD_BUG_ON(SB_I_PAGECACHE_INTERLEAVE !=
+		     BIT(SB_I_PAGECACHE_INTERLEAVE_BIT));
+	BUILD_BUG_ON(SB_I_PAGECACHE_LOCAL != BIT(SB_I_PAGECACHE_LOCAL_BIT));
+
+	if (!fc->pagecache_policy)
+		return;
+
+	if (!(policy & SB_I_PAGECACHE_INTERLEAVE))
+		clear_bit(SB_I_PAGECACHE_INTERLEAVE_BIT, &sb->s_iflags);
+	if (!(policy & SB_I_PAGECACHE_LOCAL))
+		clear_bit(SB_I_PAGECACHE_LOCAL_BIT, &sb->s_iflags);
+	if (policy & SB_I_PAGECACHE_INTERLEAVE)
+		set_bit(SB_I_PAGECACHE_INTERLEAVE_BIT, &sb->s_iflags);
+	if (policy & SB_I_PAGECACHE_LOCAL)
+		set_bit(SB_I_PAGECACHE_LOCAL_BIT, &sb->s_iflags);
+}
+
 /**
  * reconfigure_super - asks filesystem to change superblock parameters
  * @fc: The superblock and configuration
@@ -1092,6 +1151,7 @@ int reconfigure_super(struct fs_context *fc)
 
 	WRITE_ONCE(sb->s_flags, ((sb->s_flags & ~fc->sb_flags_mask) |
 				 (fc->sb_flags & fc->sb_flags_mask)));
+	sb_set_pagecache_policy(sb, fc);
 	sb_end_ro_state_change(sb);
 
 	/*
@@ -1772,6 +1832,12 @@ int vfs_get_tree(struct fs_context *fc)
 	sb = fc->root->d_sb;
 	WARN_ON(!sb->s_bdi);
 
+	/*
+	 * Legacy filesystems and superblocks that are shared with an existing
+	 * mount did not see fc->s_iflags in sget_fc().
+	 */
+	sb_set_pagecache_policy(sb, fc);
+
 	/*
 	 * super_wake() contains a memory barrier which also care of
 	 * ordering for super_cache_count(). We place it before setting
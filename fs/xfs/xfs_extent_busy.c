@@ -20,8 +20,14 @@
 #include "xfs_ag.h"
 #include "xfs_rtgroup.h"
 
+/*
+ * The tree is modified under eb_lock.  Each modification, including the in
+ * place trimming of an entry, is also covered by eb_seq, so that lookups can
+ * walk the tree under RCU and retry if they raced with a writer.
+ */
 struct xfs_extent_busy_tree {
 	spinlock_t		eb_lock;
+	seqcount_spinlock_t	eb_seq;
 	struct rb_root		eb_tree;
 	unsigned int		eb_gen;
 	wait_queue_head_t	eb_wait;
@@ -53,6 +59,7 @@ xfs_extent_busy_insert_list(
 	trace_xfs_extent_busy(xg, bno, len);
 
 	spin_lock(&eb->eb_lock);
+	write_seqcount_begin(&eb->eb_seq);
 	rbp = &eb->eb_tree.rb_node;
 	while (*rbp) {
 		parent = *rbp;
@@ -69,8 +76,9 @@ xfs_extent_busy_insert_list(
 		}
 	}
 
-	rb_link_node(&new->rb_node, parent, rbp);
+	rb_link_node_rcu(&new->rb_node, parent, rbp);
 	rb_insert_color(&new->rb_node, &eb->eb_tree);
+	write_seqcount_end(&eb->eb_seq);
 
 	/* always process discard lists in fifo order */
 	list_add_tail(&new->list, busy_list);
@@ -99,48 +107,71 @@ xfs_extent_busy_insert_discard(
 			busy_list);
 }
 
-/*
- * Search for a busy extent within the range of the extent we are about to
- * allocate.  You need to be holding the busy extent tree lock when calling
- * xfs_extent_busy_search(). This function returns 0 for no overlapping busy
- * extent, -1 for an overlapping but not exact busy extent, and 1 for an exact
- * match. This is done so that a non-zero return indicates an overlap that
- * will require a synchronous transaction, but it can still be
- * used to distinguish between a partial or exact match.
- */
-int
-xfs_extent_busy_search(
-	struct xfs_group	*xg,
+static int
+__xfs_extent_busy_search(
+	struct xfs_extent_busy_tree *eb,
 	xfs_agblock_t		bno,
 	xfs_extlen_t		len)
 {
-	struct xfs_extent_busy_tree *eb = xg->xg_busy_extents;
 	struct rb_node		*rbp;
 	struct xfs_extent_busy	*busyp;
 	int			match = 0;
 
 	/* find closest start bno overlap */
-	spin_lock(&eb->eb_lock);
-	rbp = eb->eb_tree.rb_node;
+	rbp = rcu_dereference_raw(eb->eb_tree.rb_node);
 	while (rbp) {
+		xfs_agblock_t	bbno, blen;
+
 		busyp = rb_entry(rbp, struct xfs_extent_busy, rb_node);
-		if (bno < busyp->bno) {
+		bbno = READ_ONCE(busyp->bno);
+		blen = READ_ONCE(busyp->length);
+		if (bno < bbno) {
 			/* may overlap, but exact start block is lower */
-			if (bno + len > busyp->bno)
+			if (bno + len > bbno)
 				match = -1;
-			rbp = rbp->rb_left;
-		} else if (bno > busyp->bno) {
+			rbp = rcu_dereference_raw(rbp->rb_left);
+		} else if (bno > bbno) {
 			/* may overlap, but exact start block is higher */
-			if (bno < busyp->bno + busyp->length)
+			if (bno < bbno + blen)
 				match = -1;
-			rbp = rbp->rb_right;
+			rbp = rcu_dereference_raw(rbp->rb_right);
 		} else {
 			/* bno matches busyp, length determines exact match */
-			match = (busyp->length == len) ? 1 : -1;
+			match = (blen == len) ? 1 : -1;
 			break;
 		}
 	}
-	spin_unlock(&eb->eb_lock);
+	return match;
+}
+
+/*
+ * Search for a busy extent within the range of the extent we are about to
+ * allocate.  This function returns 0 for no overlapping busy extent, -1 for an
+ * overlapping but not exact busy extent, and 1 for an exact match. This is
+ * done so that a non-zero return indicates an overlap that will require a
+ * synchronous transaction, but it can still be used to distinguish between a
+ * partial or exact match.
+ *
+ * The search does not take the busy extent tree lock.  A walk that raced with
+ * a tree modification can miss entries, so it is retried until it completed
+ * without a concurrent writer.
+ */
+int
+xfs_extent_busy_search(
+	struct xfs_group	*xg,
+	xfs_agblock_t		bno,
+	xfs_extlen_t		len)
+{
+	struct xfs_extent_busy_tree *eb = xg->xg_busy_extents;
+	unsigned int		seq;
+	int			match;
+
+	rcu_read_lock();
+	do {
+		seq = read_seqcount_begin(&eb->eb_seq);
+		match = __xfs_extent_busy_search(eb, bno, len);
+	} while (read_seqcount_retry(&eb->eb_seq, seq));
+	rcu_read_unlock();
 	return match;
 }
 
@@ -251,8 +282,10 @@ xfs_extent_busy_update_extent(
 		 * tree root, because erasing the node can rearrange the
 		 * tree topology.
 		 */
+		write_seqcount_begin(&eb->eb_seq);
 		rb_erase(&busyp->rb_node, &eb->eb_tree);
 		busyp->length = 0;
+		write_seqcount_end(&eb->eb_seq);
 		return false;
 	} else if (fend < bend) {
 		/*
@@ -269,8 +302,10 @@ xfs_extent_busy_update_extent(
 		 *    fbno            fend
 		 *
 		 */
-		busyp->bno = fend;
-		busyp->length = bend - fend;
+		write_seqcount_begin(&eb->eb_seq);
+		WRITE_ONCE(busyp->bno, fend);
+		WRITE_ONCE(busyp->length, bend - fend);
+		write_seqcount_end(&eb->eb_seq);
 	} else if (bbno < fbno) {
 		/*
 		 * Case 8:
@@ -285,7 +320,9 @@ xfs_extent_busy_update_extent(
 		 *        +----------------------+
 		 *        fbno                fend
 		 */
-		busyp->length = fbno - busyp->bno;
+		write_seqcount_begin(&eb->eb_seq);
+		WRITE_ONCE(busyp->length, fbno - busyp->bno);
+		write_seqcount_end(&eb->eb_seq);
 	} else {
 		ASSERT(0);
 	}
@@ -368,6 +405,15 @@ xfs_extent_busy_trim(
 
 	ASSERT(*len > 0);
 
+	/*
+	 * Busy extents are inserted with the AGF (or rtgroup bitmap) locked,
+	 * and so is the free extent we are trimming, so nothing can be added
+	 * to an empty tree behind our back.  This is the common case, so skip
+	 * the lock for it.
+	 */
+	if (RB_EMPTY_ROOT(&eb->eb_tree))
+		return false;
+
 	spin_lock(&eb->eb_lock);
 	fbno = *bno;
 	flen = *len;
@@ -544,12 +590,14 @@ xfs_extent_busy_clear_one(
 		}
 		trace_xfs_extent_busy_clear(busyp->group, busyp->bno,
 				busyp->length);
+		write_seqcount_begin(&eb->eb_seq);
 		rb_erase(&busyp->rb_node, &eb->eb_tree);
+		write_seqcount_end(&eb->eb_seq);
 	}
 
 	list_del_init(&busyp->list);
 	xfs_group_put(busyp->group);
-	kfree(busyp);
+	kfree_rcu(busyp, rcu);
 	return true;
 }
 
@@ -722,6 +770,7 @@ xfs_extent_busy_alloc(void)
 	if (!eb)
 		return NULL;
 	spin_lock_init(&eb->eb_lock);
+	seqcount_spinlock_init(&eb->eb_seq, &eb->eb_lock);
 	init_waitqueue_head(&eb->eb_wait);
 	eb->eb_tree = RB_ROOT;
 	return eb;
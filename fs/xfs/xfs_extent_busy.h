@@ -15,6 +15,8 @@ struct xfs_trans;
 /*
  * Busy block/extent entry.  Indexed by a rbtree in the group to mark blocks
  * that have been freed but whose transactions aren't committed to disk yet.
+ * Entries are freed after a RCU grace period so that the tree can be searched
+ * without the lock.
  */
 struct xfs_extent_busy {
 	struct rb_node	rb_node;	/* group by-bno indexed search tree */
@@ -23,6 +25,7 @@ struct xfs_extent_busy {
 	xfs_agblock_t	bno;
 	xfs_extlen_t	length;
 	unsigned int	flags;
+	struct rcu_head	rcu;
 #define XFS_EXTENT_BUSY_DISCARDED	0x01	/* undergoing a discard op. */
 #define XFS_EXTENT_BUSY_SKIP_DISCARD	0x02	/* do not discard */
 };
@@ -3,7 +3,7 @@
 
 struct mcs_spinlock {
 	struct mcs_spinlock *next;
-	int locked; /* 1 if lock acquired */
+	unsigned int locked; /* 1 if lock acquired, or CNA secondary queue tail */
 	int count;  /* nesting count, see qspinlock.c */
 };
 
@@ -443,6 +443,17 @@ struct drm_atomic_state {
 	 */
 	bool legacy_cursor_update : 1;
 
+	/**
+	 * @async_plane_update:
+	 *
+	 * Set by drm_atomic_helper_update_plane() for planes other than the
+	 * cursor when &drm_mode_config.async_plane_update is set.
+	 * drm_atomic_helper_check() then tries to commit the update through
+	 * the &drm_plane_helper_funcs.atomic_async_update hook, like legacy
+	 * cursor updates.
+	 */
+	bool async_plane_update : 1;
+
 	/**
 	 * @async_update: hint for asynchronous plane update
 	 */
@@ -912,6 +912,17 @@ struct drm_mode_config {
 	 */
 	bool async_page_flip;
 
+	/**
+	 * @async_plane_update:
+	 *
+	 * Legacy SETPLANE updates of any plane, not only of the cursor, are
+	 * committed through &drm_plane_helper_funcs.atomic_async_update when
+	 * &drm_plane_helper_funcs.atomic_async_check accepts them. Drivers
+	 * should only set this if their async hooks latch the update at the
+	 * next vblank, so overlays get cursor-like latency without tearing.
+	 */
+	bool async_plane_update;
+
 	/**
 	 * @fb_modifiers_not_supported:
 	 *
@@ -160,6 +160,9 @@ struct bdi_writeback {
 #endif
 };
 
+/* Maximum number of threads background writeback of a wb is split over */
+#define BDI_MAX_WB_THREADS	16
+
 struct backing_dev_info {
 	u64 id;
 	struct rb_node rb_node; /* keyed by ->id */
@@ -171,6 +174,7 @@ struct backing_dev_info {
 	unsigned int capabilities; /* Device capabilities */
 	unsigned int min_ratio;
 	unsigned int max_ratio, max_prop_frac;
+	unsigned int wb_threads; /* threads for background writeback */
 
 	/*
 	 * Sum of avg_write_bw of wbs with dirty inodes.  > 0 if there are
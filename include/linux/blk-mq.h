@@ -419,6 +419,17 @@ struct blk_mq_hw_ctx {
 	 */
 	atomic_t		nr_active;
 
+	/**
+	 * @poll_issue_ns: Issue time of the oldest polled request not yet seen
+	 * completing by the poller, 0 if none. Only used for hybrid polling.
+	 */
+	u64			poll_issue_ns;
+	/**
+	 * @poll_mean_ns: EWMA of the time from issue to the first completion
+	 * found by polling. Only used for hybrid polling.
+	 */
+	u64			poll_mean_ns;
+
 	/** @cpuhp_online: List to store request if CPU is going to die */
 	struct hlist_node	cpuhp_online;
 	/** @cpuhp_dead: List to store request if some CPU die. */
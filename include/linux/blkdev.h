@@ -39,6 +39,7 @@ struct kiocb;
 struct pr_ops;
 struct rq_qos;
 struct blk_queue_stats;
+struct blk_plug_merge_stats;
 struct blk_stat_callback;
 struct blk_crypto_profile;
 
@@ -524,6 +525,9 @@ struct request_queue {
 	atomic_t		pm_only;
 
 	struct blk_queue_stats	*stats;
+#ifdef CONFIG_BLK_DEBUG_FS
+	struct blk_plug_merge_stats __percpu *plug_merge_stats;
+#endif
 	struct rq_qos		*rq_qos;
 	struct mutex		rq_qos_mutex;
 
@@ -649,6 +653,8 @@ enum {
 	QUEUE_FLAG_RQ_ALLOC_TIME,	/* record rq->alloc_time_ns */
 	QUEUE_FLAG_HCTX_ACTIVE,		/* at least one blk-mq hctx is active */
 	QUEUE_FLAG_SQ_SCHED,		/* single queue style io dispatch */
+	QUEUE_FLAG_HYBRID_POLL,		/* sleep before busy polling */
+	QUEUE_FLAG_SAME_NODE,		/* complete on same NUMA node */
 	QUEUE_FLAG_MAX
 };
 
@@ -683,6 +689,8 @@ void blk_queue_flag_clear(unsigned int flag, struct request_queue *q);
 #define blk_queue_pm_only(q)	atomic_read(&(q)->pm_only)
 #define blk_queue_registered(q)	test_bit(QUEUE_FLAG_REGISTERED, &(q)->queue_flags)
 #define blk_queue_sq_sched(q)	test_bit(QUEUE_FLAG_SQ_SCHED, &(q)->queue_flags)
+#define blk_queue_hybrid_poll(q)	\
+	test_bit(QUEUE_FLAG_HYBRID_POLL, &(q)->queue_flags)
 #define blk_queue_skip_tagset_quiesce(q) \
 	((q)->limits.features & BLK_FEAT_SKIP_TAGSET_QUIESCE)
 
@@ -1081,6 +1089,8 @@ struct rq_list {
  * or when attempting a merge. For details, please see schedule() where
  * blk_flush_plug() is called.
  */
+#define BLK_PLUG_MERGE_HASH_BITS	4
+
 struct blk_plug {
 	struct rq_list mq_list; /* blk-mq requests */
 
@@ -1094,6 +1104,12 @@ struct blk_plug {
 	bool multiple_queues;
 	bool has_elevator;
 
+	/*
+	 * Merge candidates for blk_attempt_plug_merge(), hashed by queue and
+	 * by both the start and the end sector of each plugged request.
+	 */
+	struct request *merge_hash[1 << BLK_PLUG_MERGE_HASH_BITS];
+
 	struct list_head cb_list; /* md requires an unplug callback */
 };
 
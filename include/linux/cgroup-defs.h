@@ -696,6 +696,8 @@ struct cftype {
 	__poll_t (*poll)(struct kernfs_open_file *of,
 			 struct poll_table_struct *pt);
 
+	int (*mmap)(struct kernfs_open_file *of, struct vm_area_struct *vma);
+
 	struct lock_class_key	lockdep_key;
 };
 
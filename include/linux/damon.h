@@ -399,6 +399,7 @@ struct damos_filter {
 };
 
 struct damon_ctx;
+struct damon_worker;
 struct damos;
 
 /**
@@ -527,12 +528,15 @@ struct damos {
  * @DAMON_OPS_FVADDR:	Monitoring operations for only fixed ranges of virtual
  *			address spaces
  * @DAMON_OPS_PADDR:	Monitoring operations for the physical address space
+ * @DAMON_OPS_PADDR_HW:	Monitoring operations for the physical address space
+ *			using hardware access samples
  * @NR_DAMON_OPS:	Number of monitoring operations implementations
  */
 enum damon_ops_id {
 	DAMON_OPS_VADDR,
 	DAMON_OPS_FVADDR,
 	DAMON_OPS_PADDR,
+	DAMON_OPS_PADDR_HW,
 	NR_DAMON_OPS,
 };
 
@@ -544,6 +548,8 @@ enum damon_ops_id {
  * @update:			Update operations-related data structures.
  * @prepare_access_checks:	Prepare next access check of target regions.
  * @check_accesses:		Check the accesses to target regions.
+ * @prepare_access_checks_shard: Prepare one shard of the target regions.
+ * @check_accesses_shard:	Check the accesses to one shard of the regions.
  * @get_scheme_score:		Get the score of a region for a scheme.
  * @apply_scheme:		Apply a DAMON-based operation scheme.
  * @target_valid:		Determine if the target is valid.
@@ -570,6 +576,11 @@ enum damon_ops_id {
  * last preparation and update the number of observed accesses of each region.
  * It should also return max number of observed accesses that made as a result
  * of its update.  The value will be used for regions adjustment threshold.
+ * @prepare_access_checks_shard and @check_accesses_shard are optional.  They
+ * do the same as @prepare_access_checks and @check_accesses, but only for the
+ * regions that damon_shard_bounds() gives for the shard.  If both are set,
+ * @kdamond uses them to split the access checks among &damon_ctx.nr_workers
+ * threads, calling them for different shards concurrently.
  * @get_scheme_score should return the priority score of a region for a scheme
  * as an integer in [0, &DAMOS_MAX_SCORE].
  * @apply_scheme is called from @kdamond when a region for user provided
@@ -587,6 +598,10 @@ struct damon_operations {
 	void (*update)(struct damon_ctx *context);
 	void (*prepare_access_checks)(struct damon_ctx *context);
 	unsigned int (*check_accesses)(struct damon_ctx *context);
+	void (*prepare_access_checks_shard)(struct damon_ctx *context,
+			unsigned int shard, unsigned int nr_shards);
+	unsigned int (*check_accesses_shard)(struct damon_ctx *context,
+			unsigned int shard, unsigned int nr_shards);
 	int (*get_scheme_score)(struct damon_ctx *context,
 			struct damon_target *t, struct damon_region *r,
 			struct damos *scheme);
@@ -740,6 +755,14 @@ struct damon_attrs {
  * @ops:	Set of monitoring operations for given use cases.
  * @callback:	Set of callbacks for monitoring events notifications.
  *
+ * @nr_workers:		Number of threads doing the access checks.
+ * @workers_cpumask:	CPUs the worker threads may run on.
+ *
+ * If @ops supports sharded access checks, @kdamond starts @nr_workers - 1
+ * worker threads that each do the access checks of one shard of the regions,
+ * while @kdamond does the first shard.  The workers are bound to
+ * @workers_cpumask, unless it is empty.  Both are read when @kdamond starts.
+ *
  * @adaptive_targets:	Head of monitoring targets (&damon_target) list.
  * @schemes:		Head of schemes (&damos) list.
  */
@@ -775,6 +798,16 @@ struct damon_ctx {
 	struct damos_walk_control *walk_control;
 	struct mutex walk_control_lock;
 
+	/* threads sharing the access checks, and the number of shards */
+	struct damon_worker *workers;
+	unsigned int nr_shards;
+	/* for handing one access check step to the workers */
+	unsigned long workers_seq;
+	bool workers_check;
+	atomic_t workers_pending;
+	struct completion workers_done;
+	wait_queue_head_t workers_wait;
+
 /* public: */
 	struct task_struct *kdamond;
 	struct mutex kdamond_lock;
@@ -784,6 +817,9 @@ struct damon_ctx {
 
 	struct list_head adaptive_targets;
 	struct list_head schemes;
+
+	unsigned int nr_workers;
+	struct cpumask workers_cpumask;
 };
 
 static inline struct damon_region *damon_next_region(struct damon_region *r)
@@ -901,6 +937,9 @@ bool damon_targets_empty(struct damon_ctx *ctx);
 void damon_free_target(struct damon_target *t);
 void damon_destroy_target(struct damon_target *t);
 unsigned int damon_nr_regions(struct damon_target *t);
+void damon_shard_bounds(struct damon_ctx *ctx, unsigned int shard,
+		unsigned int nr_shards, unsigned long *start,
+		unsigned long *end);
 
 struct damon_ctx *damon_new_ctx(void);
 void damon_destroy_ctx(struct damon_ctx *ctx);
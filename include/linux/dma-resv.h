@@ -464,6 +464,16 @@ static inline void dma_resv_unlock(struct dma_resv *obj)
 	ww_mutex_unlock(&obj->lock);
 }
 
+/**
+ * struct dma_resv_fence_point - timeline point of a fence in a dma_resv
+ * @context: the fence context, see &dma_fence.context
+ * @seqno: the point on the context's timeline, see &dma_fence.seqno
+ */
+struct dma_resv_fence_point {
+	u64 context;
+	u64 seqno;
+};
+
 void dma_resv_init(struct dma_resv *obj);
 void dma_resv_fini(struct dma_resv *obj);
 int dma_resv_reserve_fences(struct dma_resv *obj, unsigned int num_fences);
@@ -479,6 +489,12 @@ int dma_resv_get_singleton(struct dma_resv *obj, enum dma_resv_usage usage,
 int dma_resv_copy_fences(struct dma_resv *dst, struct dma_resv *src);
 long dma_resv_wait_timeout(struct dma_resv *obj, enum dma_resv_usage usage,
 			   bool intr, unsigned long timeout);
+long dma_resv_wait_timeout_many(struct dma_resv **objs, unsigned int count,
+				enum dma_resv_usage usage, bool intr,
+				unsigned long timeout);
+int dma_resv_snapshot_points(struct dma_resv *obj, enum dma_resv_usage usage,
+			     struct dma_resv_fence_point *points,
+			     unsigned int max_points);
 void dma_resv_set_deadline(struct dma_resv *obj, enum dma_resv_usage usage,
 			   ktime_t deadline);
 bool dma_resv_test_signaled(struct dma_resv *obj, enum dma_resv_usage usage);
@@ -10,6 +10,7 @@
 
 #include <uapi/linux/eventpoll.h>
 #include <uapi/linux/kcmp.h>
+#include <linux/uaccess.h>
 
 
 /* Forward declarations to avoid compiler errors */
@@ -82,11 +83,18 @@ static inline struct epoll_event __user *
 epoll_put_uevent(__poll_t revents, __u64 data,
 		 struct epoll_event __user *uevent)
 {
-	if (__put_user(revents, &uevent->events) ||
-	    __put_user(data, &uevent->data))
+	/* One user access window for both fields instead of two */
+	if (!user_access_begin(uevent, sizeof(*uevent)))
 		return NULL;
+	unsafe_put_user(revents, &uevent->events, efault);
+	unsafe_put_user(data, &uevent->data, efault);
+	user_access_end();
 
 	return uevent+1;
+
+efault:
+	user_access_end();
+	return NULL;
 }
 #endif
 
@@ -50,6 +50,7 @@ struct files_struct {
    */
 	spinlock_t file_lock ____cacheline_aligned_in_smp;
 	unsigned int next_fd;
+	struct list_head fd_caches;	/* caches of PR_SET_FD_CACHE threads */
 	unsigned long close_on_exec_init[1];
 	unsigned long open_fds_init[1];
 	unsigned long full_fds_bits_init[1];
@@ -101,6 +102,9 @@ struct task_struct;
 
 void put_files_struct(struct files_struct *fs);
 int unshare_files(void);
+void fd_cache_release(struct task_struct *tsk);
+void fd_cache_free(struct task_struct *tsk);
+int set_fd_cache(unsigned long enable);
 struct fd_range {
 	unsigned int from, to;
 };
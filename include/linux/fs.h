@@ -32,6 +32,7 @@
 #include <linux/uidgid.h>
 #include <linux/lockdep.h>
 #include <linux/percpu-rwsem.h>
+#include <linux/percpu_counter.h>
 #include <linux/workqueue.h>
 #include <linux/delayed_call.h>
 #include <linux/uuid.h>
@@ -663,6 +664,7 @@ is_uncached_acl(struct posix_acl *acl)
 #define IOP_DEFAULT_READLINK	0x0010
 #define IOP_MGTIME	0x0020
 #define IOP_CACHED_LINK	0x0040
+#define IOP_FASTPERM_MAY_EXEC	0x0080
 
 /*
  * Keep mostly read-only and often accessed (especially for
@@ -1033,6 +1035,11 @@ struct fown_struct {
  * @ra_pages: Maximum size of a readahead request, copied from the bdi.
  * @mmap_miss: How many mmap accesses missed in the page cache.
  * @prev_pos: The last byte in the most recent read request.
+ * @stride_prev: Where the most recent small read, or the most recent window
+ *      predicted for one, started.
+ * @stride: Distance in pages between the two most recent small reads, may be
+ *      negative for a backward scan.
+ * @stride_hits: How many times in a row the small reads were @stride apart.
  *
  * When this structure is passed to ->readahead(), the "most recent"
  * readahead means the current readahead.
@@ -1044,6 +1051,9 @@ struct file_ra_state {
 	unsigned int ra_pages;
 	unsigned int mmap_miss;
 	loff_t prev_pos;
+	pgoff_t stride_prev;
+	int stride;
+	unsigned int stride_hits;
 };
 
 /*
@@ -1290,6 +1300,11 @@ extern int send_sigurg(struct file *file);
 #define SB_I_NOUMASK	0x00001000	/* VFS does not apply umask */
 #define SB_I_NOIDMAP	0x00002000	/* No idmapped mounts on this superblock */
 #define SB_I_ALLOW_HSM	0x00004000	/* Allow HSM events on this superblock */
+#define SB_I_PAGECACHE_INTERLEAVE 0x00008000 /* Spread page cache over nodes */
+#define SB_I_PAGECACHE_LOCAL	0x00010000 /* Page cache on the local node */
+#define SB_I_PAGECACHE_INTERLEAVE_BIT	15
+#define SB_I_PAGECACHE_LOCAL_BIT	16
+#define SB_I_PAGECACHE_MASK	(SB_I_PAGECACHE_INTERLEAVE | SB_I_PAGECACHE_LOCAL)
 
 /* Possible states of 'frozen' field */
 enum {
@@ -1413,6 +1428,14 @@ struct super_block {
 	/* Read-only state of the superblock is being changed */
 	int s_readonly_remount;
 
+	/*
+	 * Readahead windows submitted for files on this sb, windows whose
+	 * PG_readahead marker got hit, and ones evicted before that.
+	 */
+	struct percpu_counter	s_ra_windows;
+	struct percpu_counter	s_ra_hits;
+	struct percpu_counter	s_ra_wasted;
+
 	/* per-sb errseq_t for reporting writeback errors via syncfs */
 	errseq_t s_wb_err;
 
@@ -1437,6 +1460,11 @@ struct super_block {
 	struct rcu_head		rcu;
 	struct work_struct	destroy_work;
 
+	/* Unused negative dentries on s_dentry_lru, see dentry-negative-limit */
+	struct percpu_counter	s_dentry_negative;
+	struct work_struct	s_dentry_negative_work;
+	atomic_long_t		s_dentry_negative_pruned;
+
 	struct mutex		s_sync_lock;	/* sync serialisation lock */
 
 	/*
@@ -386,6 +386,11 @@ struct io_ring_ctx {
 
 	struct wait_queue_head	sqo_sq_wait;
 	struct list_head	sqd_list;
+	/* SQPOLL thread time spent on this ring and its DRR deficit, in ns */
+	u64			sq_work_time;
+	s64			sq_deficit;
+	/* jiffies until which this ring keeps the SQPOLL thread spinning */
+	unsigned long		sq_idle_until;
 
 	unsigned int		file_alloc_start;
 	unsigned int		file_alloc_end;
@@ -394,7 +399,14 @@ struct io_ring_ctx {
 	struct wait_queue_head		poll_wq;
 	struct io_restriction		restrictions;
 
-	struct io_zcrx_ifq		*ifq;
+	/* zero copy rx interface queues, indexed by zcrx_id */
+	struct xarray			zcrx_ctxs;
+	/* coalesced zero copy send notifications, indexed by buf_index */
+	struct xarray			notif_streams;
+
+	/* IORING_REGISTER_LAT_STATS, stays allocated once enabled */
+	struct io_lat_stats		*lat_stats;
+	bool				lat_stats_on;
 
 	u32			pers_next;
 	struct xarray		personalities;
@@ -429,6 +441,8 @@ struct io_ring_ctx {
 	/* napi busy poll default timeout */
 	ktime_t			napi_busy_poll_dt;
 	bool			napi_prefer_busy_poll;
+	/* only spin on napi ids with an arrival expected, see napi.c */
+	bool			napi_adaptive;
 	u8			napi_track_mode;
 
 	DECLARE_HASHTABLE(napi_ht, 4);
@@ -448,8 +462,6 @@ struct io_ring_ctx {
 	struct io_mapped_region		ring_region;
 	/* used for optimised request parameter and wait argument passing  */
 	struct io_mapped_region		param_region;
-	/* just one zcrx per ring for now, will move to io_zcrx_ifq eventually */
-	struct io_mapped_region		zcrx_region;
 };
 
 /*
@@ -504,6 +516,9 @@ enum {
 	REQ_F_BUF_NODE_BIT,
 	REQ_F_HAS_METADATA_BIT,
 	REQ_F_IMPORT_BUFFER_BIT,
+	REQ_F_LINK_FD_BIT,
+	REQ_F_LINK_LEN_BIT,
+	REQ_F_LAT_STATS_BIT,
 
 	/* not a real bit, just to check we're not overflowing the space */
 	__REQ_F_LAST_BIT,
@@ -593,6 +608,12 @@ enum {
 	 * For SEND_ZC, whether to import buffers (i.e. the first issue).
 	 */
 	REQ_F_IMPORT_BUFFER	= IO_REQ_FLAG(REQ_F_IMPORT_BUFFER_BIT),
+	/* fd is IORING_FD_LINK_RES, filled in from an earlier link */
+	REQ_F_LINK_FD		= IO_REQ_FLAG(REQ_F_LINK_FD_BIT),
+	/* len is IORING_LEN_LINK_RES, passed in cqe.res by the previous link */
+	REQ_F_LINK_LEN		= IO_REQ_FLAG(REQ_F_LINK_LEN_BIT),
+	/* account latency, lat_start is valid */
+	REQ_F_LAT_STATS		= IO_REQ_FLAG(REQ_F_LAT_STATS_BIT),
 };
 
 typedef void (*io_req_tw_func_t)(struct io_kiocb *req, io_tw_token_t tw);
@@ -714,6 +735,8 @@ struct io_kiocb {
 	/* custom credentials, valid IFF REQ_F_CREDS is set */
 	const struct cred		*creds;
 	struct io_wq_work		work;
+	/* submission time in ns, valid IFF REQ_F_LAT_STATS is set */
+	u64				lat_start;
 
 	struct {
 		u64			extra1;
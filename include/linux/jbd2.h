@@ -729,6 +729,8 @@ jbd2_time_diff(unsigned long start, unsigned long end)
 }
 
 #define JBD2_NR_BATCH	64
+/* Maximum number of workers writing back one checkpoint batch */
+#define JBD2_MAX_CHECKPOINT_WORKERS	4
 
 enum passtype {PASS_SCAN, PASS_REVOKE, PASS_REPLAY};
 
@@ -862,10 +864,12 @@ struct journal_s
 	 *
 	 * List of buffer heads used by the checkpoint routine.  This
 	 * was moved from jbd2_log_do_checkpoint() to reduce stack
-	 * usage.  Access to this array is controlled by the
+	 * usage.  Each checkpoint worker writes up to JBD2_NR_BATCH of
+	 * them.  Access to this array is controlled by the
 	 * @j_checkpoint_mutex.  [j_checkpoint_mutex]
 	 */
-	struct buffer_head	*j_chkpt_bhs[JBD2_NR_BATCH];
+	struct buffer_head	*j_chkpt_bhs[JBD2_NR_BATCH *
+					     JBD2_MAX_CHECKPOINT_WORKERS];
 
 	/**
 	 * @j_shrinker:
@@ -1470,6 +1474,12 @@ extern int jbd2_journal_write_metadata_buffer(transaction_t *transaction,
 /* Transaction cache support */
 extern void jbd2_journal_destroy_transaction_cache(void);
 extern int __init jbd2_journal_init_transaction_cache(void);
+
+/* Log bio and checkpoint worker support */
+extern int __init jbd2_journal_init_log_bioset(void);
+extern void jbd2_journal_destroy_log_bioset(void);
+extern int __init jbd2_journal_init_checkpoint_wq(void);
+extern void jbd2_journal_destroy_checkpoint_wq(void);
 extern void jbd2_journal_free_transaction(transaction_t *);
 
 /*
@@ -15,6 +15,10 @@ extern void khugepaged_enter_vma(struct vm_area_struct *vma,
 				 unsigned long vm_flags);
 extern void khugepaged_min_free_kbytes_update(void);
 extern bool current_is_khugepaged(void);
+extern void khugepaged_hot_range(struct vm_area_struct *vma,
+				 unsigned long addr, unsigned int heat);
+extern void khugepaged_fault_fallback(struct vm_area_struct *vma,
+				      unsigned long addr);
 #ifdef CONFIG_SHMEM
 extern int collapse_pte_mapped_thp(struct mm_struct *mm, unsigned long addr,
 				   bool install_pmd);
@@ -62,6 +66,16 @@ static inline bool current_is_khugepaged(void)
 {
 	return false;
 }
+
+static inline void khugepaged_hot_range(struct vm_area_struct *vma,
+					unsigned long addr, unsigned int heat)
+{
+}
+
+static inline void khugepaged_fault_fallback(struct vm_area_struct *vma,
+					     unsigned long addr)
+{
+}
 #endif /* CONFIG_TRANSPARENT_HUGEPAGE */
 
 #endif /* _LINUX_KHUGEPAGED_H */
@@ -55,6 +55,19 @@ enum memcg_memory_event {
 	MEMCG_NR_MEMORY_EVENTS,
 };
 
+/* Phases of the direct reclaim and compaction stalls in memory.reclaim_stat */
+enum memcg_stall_phase {
+	MEMCG_STALL_RECLAIM,	/* a whole direct reclaim invocation */
+	MEMCG_STALL_LRU,	/* scanning and reclaiming the LRU lists */
+	MEMCG_STALL_SHRINKER,	/* running the slab shrinkers */
+	MEMCG_STALL_THROTTLE,	/* waiting for writeback or other reclaimers */
+	MEMCG_STALL_COMPACT,	/* a direct compaction run */
+	MEMCG_NR_STALL_PHASES,
+};
+
+/* Stalls shorter than 16us, 64us, ... 1s, and longer */
+#define MEMCG_NR_STALL_BUCKETS	10
+
 struct mem_cgroup_reclaim_cookie {
 	pg_data_t *pgdat;
 	int generation;
@@ -236,6 +249,10 @@ struct mem_cgroup {
 	atomic_long_t		memory_events[MEMCG_NR_MEMORY_EVENTS];
 	atomic_long_t		memory_events_local[MEMCG_NR_MEMORY_EVENTS];
 
+	/* memory.reclaim_stat */
+	atomic64_t		stall_time[MEMCG_NR_STALL_PHASES];
+	atomic_long_t		stall_hist[MEMCG_NR_STALL_PHASES][MEMCG_NR_STALL_BUCKETS];
+
 	/*
 	 * Hint of reclaim pressure for socket memroy management. Note
 	 * that this indicator should NOT be used in legacy cgroup mode
@@ -903,6 +920,8 @@ struct mem_cgroup *mem_cgroup_get_oom_group(struct task_struct *victim,
 					    struct mem_cgroup *oom_domain);
 void mem_cgroup_print_oom_group(struct mem_cgroup *memcg);
 
+void mem_cgroup_account_stall(const u64 stall_ns[MEMCG_NR_STALL_PHASES]);
+
 void __mod_memcg_state(struct mem_cgroup *memcg, enum memcg_stat_item idx,
 		       int val);
 
@@ -1374,6 +1393,11 @@ static inline void mem_cgroup_print_oom_group(struct mem_cgroup *memcg)
 {
 }
 
+static inline void
+mem_cgroup_account_stall(const u64 stall_ns[MEMCG_NR_STALL_PHASES])
+{
+}
+
 static inline void __mod_memcg_state(struct mem_cgroup *memcg,
 				     enum memcg_stat_item idx,
 				     int nr)
@@ -56,6 +56,22 @@ void mt_put_memory_types(struct list_head *memory_types);
 int next_demotion_node(int node);
 void node_get_allowed_targets(pg_data_t *pgdat, nodemask_t *targets);
 bool node_is_toptier(int node);
+#ifdef CONFIG_NUMA_BALANCING
+/* Promotion state of a (source, target) node pair */
+struct memtier_promote_pair {
+	struct numa_promote_ctl ctl;
+	/* promote rate limit in MB/s, 0 to use the sysctl */
+	unsigned int rate_limit;
+	/* number of promote candidate pages */
+	atomic_long_t nr_cand;
+	/* number of pages promoted */
+	atomic_long_t nr_promoted;
+};
+
+struct memtier_promote_pair *memtier_promote_pair(int src, int dst);
+void memtier_count_promoted(int src, int dst, unsigned long nr);
+void memtier_reset_promote_pairs(void);
+#endif
 #else
 static inline int next_demotion_node(int node)
 {
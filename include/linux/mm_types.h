@@ -762,6 +762,28 @@ struct vma_numab_state {
 	 * A VMA is not eligible for scanning if prev_scan_seq == numa_scan_seq
 	 */
 	int prev_scan_seq;
+
+	/*
+	 * MM scan sequence ID before which the VMA is not scanned again.
+	 * VMAs whose hinting faults are mostly local get scanned only every
+	 * 1 << scan_shift sequences:
+	 */
+	int next_scan_seq;
+	unsigned int scan_shift;
+
+	/* Mostly remote faults, scan regardless of PID activity */
+	bool remote_hot;
+
+	/*
+	 * Hinting fault statistics, updated racily by the faulting tasks:
+	 *
+	 *   faults[0/1]	remote/local since the VMA is tracked
+	 *   faults_priv[0/1]	shared/private since the VMA is tracked
+	 *   scan_faults[0/1]	remote/local since the last completed scan
+	 */
+	unsigned long faults[2];
+	unsigned long faults_priv[2];
+	unsigned long scan_faults[2];
 };
 
 /*
@@ -1123,6 +1145,10 @@ struct mm_struct {
 #ifdef CONFIG_PREEMPT_RT
 		struct rcu_head delayed_drop;
 #endif
+#ifdef CONFIG_FUTEX
+		/* Hash table for the PRIVATE futexes, see futex_hash() */
+		struct futex_private_hash *futex_phash;
+#endif
 #ifdef CONFIG_HUGETLB_PAGE
 		atomic_long_t hugetlb_usage;
 #endif
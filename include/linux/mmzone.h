@@ -503,6 +503,8 @@ struct lru_gen_mm_state {
 	struct list_head *tail;
 	/* Bloom filters flip after each iteration */
 	unsigned long *filters[NR_BLOOM_FILTERS];
+	/* how many iterations PMD tables stayed cold, kept across iterations */
+	u8 *cold_filter;
 	/* the mm stats for debugging */
 	unsigned long stats[NR_HIST_GENS][NR_MM_STATS];
 };
@@ -522,6 +524,8 @@ struct lru_gen_mm_walk {
 	int batched;
 	int swappiness;
 	bool force_scan;
+	/* only the VMA being walked is locked, not mmap_lock */
+	bool vma_locked;
 };
 
 /*
@@ -681,11 +685,14 @@ enum zone_watermarks {
 
 /*
  * One per migratetype for each PAGE_ALLOC_COSTLY_ORDER. Two additional lists
- * are added for THP. One PCP list is used by GPF_MOVABLE, and the other PCP list
- * is used by GFP_UNMOVABLE and GFP_RECLAIMABLE.
+ * are added for THP and for each of the NR_PCP_MTHP_ORDERS mTHP orders that
+ * can be selected with pcp_mthp_orders=. One PCP list is used by GPF_MOVABLE,
+ * and the other PCP list is used by GFP_UNMOVABLE and GFP_RECLAIMABLE.
  */
 #ifdef CONFIG_TRANSPARENT_HUGEPAGE
-#define NR_PCP_THP 2
+#define NR_PCP_MTHP_ORDERS 2
+#define NR_PCP_HUGE_ORDERS (1 + NR_PCP_MTHP_ORDERS)
+#define NR_PCP_THP (2 * NR_PCP_HUGE_ORDERS)
 #else
 #define NR_PCP_THP 0
 #endif
@@ -723,6 +730,15 @@ struct per_cpu_pages {
 
 	/* Lists of pages, one per migrate type stored on the pcp-lists */
 	struct list_head lists[NR_PCP_LISTS];
+
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE
+	/* Per mTHP order share of count, and its own high watermark */
+	int mthp_count[NR_PCP_MTHP_ORDERS];
+	int mthp_high[NR_PCP_MTHP_ORDERS];
+	/* THP and mTHP allocations served from, or missing, the lists */
+	unsigned long huge_hit[NR_PCP_HUGE_ORDERS];
+	unsigned long huge_miss[NR_PCP_HUGE_ORDERS];
+#endif
 } ____cacheline_aligned_in_smp;
 
 struct per_cpu_zonestat {
@@ -1305,6 +1321,28 @@ struct deferred_split {
 };
 #endif
 
+#ifdef CONFIG_NUMA_BALANCING
+/*
+ * Memory tiering promotion rate limit and hot threshold state, of a node or
+ * of a (source, target) node pair.
+ */
+struct numa_promote_ctl {
+	/* start time in ms of current promote rate limit period */
+	unsigned int rl_start;
+	/* number of promote candidate pages at start time of current rate limit period */
+	unsigned long rl_nr_cand;
+	/* promote threshold in ms */
+	unsigned int threshold;
+	/* start time in ms of current promote threshold adjustment period */
+	unsigned int th_start;
+	/*
+	 * number of promote candidate pages at start time of current promote
+	 * threshold adjustment period
+	 */
+	unsigned long th_nr_cand;
+};
+#endif
+
 #ifdef CONFIG_MEMORY_FAILURE
 /*
  * Per NUMA node memory failure handling statistics.
@@ -1404,6 +1442,9 @@ typedef struct pglist_data {
 	wait_queue_head_t kcompactd_wait;
 	struct task_struct *kcompactd;
 	bool proactive_compact_trigger;
+	/* Failed target order allocations since the last proactive check */
+	atomic_t proactive_alloc_failures;
+	unsigned int proactive_boost;
 #endif
 	/*
 	 * This is a per-node reserve of pages that are not available
@@ -1435,19 +1476,7 @@ typedef struct pglist_data {
 #endif
 
 #ifdef CONFIG_NUMA_BALANCING
-	/* start time in ms of current promote rate limit period */
-	unsigned int nbp_rl_start;
-	/* number of promote candidate pages at start time of current rate limit period */
-	unsigned long nbp_rl_nr_cand;
-	/* promote threshold in ms */
-	unsigned int nbp_threshold;
-	/* start time in ms of current promote threshold adjustment period */
-	unsigned int nbp_th_start;
-	/*
-	 * number of promote candidate pages at start time of current promote
-	 * threshold adjustment period
-	 */
-	unsigned long nbp_th_nr_cand;
+	struct numa_promote_ctl nbp;
 #endif
 	/* Fields commonly accessed by the page reclaim scanner */
 
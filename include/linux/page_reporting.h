@@ -21,6 +21,15 @@ struct page_reporting_dev_info {
 
 	/* Minimal order of page reporting */
 	unsigned int order;
+
+	/* Delay before the next pass, adapted to the cost of the reports */
+	unsigned long delay;
+
+	/* Time spent in @report during the current pass */
+	u64 report_ns;
+
+	/* Next pass also reports free pages below page_reporting_order */
+	bool idle_pass;
 };
 
 /* Tear-down and bring-up for page reporting devices */
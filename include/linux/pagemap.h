@@ -210,6 +210,8 @@ enum mapping_flags {
 	AS_STABLE_WRITES = 7,	/* must wait for writeback before modifying
 				   folio contents */
 	AS_INACCESSIBLE = 8,	/* Do not attempt direct R/W access to the mapping */
+	AS_PLACE_INTERLEAVE = 9, /* Spread page cache over the allowed nodes */
+	AS_PLACE_LOCAL = 10,	/* Allocate page cache on the local node */
 	/* Bits 16-25 are used for FOLIO_ORDER */
 	AS_FOLIO_ORDER_BITS = 5,
 	AS_FOLIO_ORDER_MIN = 16,
@@ -335,6 +337,23 @@ static inline bool mapping_inaccessible(struct address_space *mapping)
 	return test_bit(AS_INACCESSIBLE, &mapping->flags);
 }
 
+/*
+ * NUMA placement of the page cache of a mapping, as set by fadvise(). The
+ * mapping flags take precedence over the placement policy of the superblock.
+ */
+static inline void mapping_set_placement(struct address_space *mapping,
+		bool interleave, bool local)
+{
+	if (interleave)
+		set_bit(AS_PLACE_INTERLEAVE, &mapping->flags);
+	else
+		clear_bit(AS_PLACE_INTERLEAVE, &mapping->flags);
+	if (local)
+		set_bit(AS_PLACE_LOCAL, &mapping->flags);
+	else
+		clear_bit(AS_PLACE_LOCAL, &mapping->flags);
+}
+
 static inline gfp_t mapping_gfp_mask(struct address_space * mapping)
 {
 	return mapping->gfp_mask;
@@ -637,15 +656,26 @@ static inline void *detach_page_private(struct page *page)
 
 #ifdef CONFIG_NUMA
 struct folio *filemap_alloc_folio_noprof(gfp_t gfp, unsigned int order);
+struct folio *mapping_alloc_folio_noprof(struct address_space *mapping,
+		pgoff_t index, gfp_t gfp, unsigned int order);
 #else
 static inline struct folio *filemap_alloc_folio_noprof(gfp_t gfp, unsigned int order)
 {
 	return folio_alloc_noprof(gfp, order);
 }
+
+static inline struct folio *mapping_alloc_folio_noprof(
+		struct address_space *mapping, pgoff_t index, gfp_t gfp,
+		unsigned int order)
+{
+	return folio_alloc_noprof(gfp, order);
+}
 #endif
 
 #define filemap_alloc_folio(...)				\
 	alloc_hooks(filemap_alloc_folio_noprof(__VA_ARGS__))
+#define mapping_alloc_folio(...)				\
+	alloc_hooks(mapping_alloc_folio_noprof(__VA_ARGS__))
 
 static inline struct page *__page_cache_alloc(gfp_t gfp)
 {
@@ -157,6 +157,9 @@ struct psi_trigger {
 
 	/* Trigger type - PSI_AVGS for unprivileged, PSI_POLL for RT */
 	enum psi_aggregators aggregator;
+
+	/* Optional mmap'able event ring */
+	struct psi_ring_header *ring;
 };
 
 struct psi_group {
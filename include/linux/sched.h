@@ -58,6 +58,7 @@ struct bpf_run_ctx;
 struct bpf_net_context;
 struct capture_control;
 struct cfs_rq;
+struct fd_cache;
 struct fs_struct;
 struct futex_pi_state;
 struct io_context;
@@ -566,11 +567,38 @@ struct sched_statistics {
 #endif /* CONFIG_SCHEDSTATS */
 } ____cacheline_aligned;
 
+enum sched_wake_hist_type {
+	SCHED_WAKE_HIST_SELECT,		/* select_task_rq() */
+	SCHED_WAKE_HIST_IPI,		/* wakelist queueing to activation */
+	SCHED_WAKE_HIST_WAIT,		/* activation to running */
+	NR_SCHED_WAKE_HIST,
+};
+
+#ifdef CONFIG_SCHEDSTATS
+/*
+ * Wakeup latency histograms, filled while kernel.sched_wake_hist is set.
+ * Bucket 0 counts latencies below 512ns, bucket i those within
+ * [2^(i+8), 2^(i+9)) ns and the last bucket everything longer.
+ */
+#define SCHED_WAKE_HIST_SHIFT		9
+#define SCHED_WAKE_HIST_BUCKETS		20
+
+struct sched_wake_hist {
+	u32				count[NR_SCHED_WAKE_HIST][SCHED_WAKE_HIST_BUCKETS];
+};
+
+struct sched_wake_stats {
+	u64				queued;
+	u64				enqueued;
+	struct sched_wake_hist		hist;
+};
+#endif
+
 #ifdef CONFIG_SCHED_BORE
-struct sched_burst_cache {
-	u32				value;
-	u32				count;
-	u64				timestamp;
+/* Running sum and count of the burst penalties of a task family. */
+struct sched_burst_aggr {
+	atomic_long_t			sum;
+	atomic_t			count;
 };
 #endif
 
@@ -598,10 +626,11 @@ struct sched_entity {
 	u32				prev_burst_penalty;
 	u32				curr_burst_penalty;
 	u32				burst_penalty;
+	u32				burst_contrib;
 	u8				burst_score;
 	u8				burst_count;
-	struct sched_burst_cache	child_burst;
-	struct sched_burst_cache	group_burst;
+	struct sched_burst_aggr		child_burst;
+	struct sched_burst_aggr		group_burst;
 #endif
 	s64				vlag;
 	u64				slice;
@@ -915,6 +944,9 @@ struct task_struct {
 #endif
 
 	struct sched_statistics         stats;
+#ifdef CONFIG_SCHEDSTATS
+	struct sched_wake_stats		wake_stats;
+#endif
 
 #ifdef CONFIG_PREEMPT_NOTIFIERS
 	/* List of struct preempt_notifier: */
@@ -1199,6 +1231,8 @@ struct task_struct {
 
 	/* Open file information: */
 	struct files_struct		*files;
+	/* Per-thread reserved file descriptors, see PR_SET_FD_CACHE: */
+	struct fd_cache			*fd_cache;
 
 #ifdef CONFIG_IO_URING
 	struct io_uring_task		*io_uring;
@@ -1468,6 +1502,9 @@ struct task_struct {
 	int				nr_dirtied_pause;
 	/* Start of a write-and-pause period: */
 	unsigned long			dirty_paused_when;
+	/* Pages dirtied in the dirty budget interval starting at dirty_budget_when: */
+	int				nr_dirtied_budget;
+	unsigned long			dirty_budget_when;
 
 #ifdef CONFIG_LATENCYTOP
 	int				latency_record_count;
@@ -1479,6 +1516,8 @@ struct task_struct {
 	 */
 	u64				timer_slack_ns;
 	u64				default_timer_slack_ns;
+	/* Slack to restore when cpu.timer_slack stops applying, or 0: */
+	u64				saved_timer_slack_ns;
 
 #if defined(CONFIG_KASAN_GENERIC) || defined(CONFIG_KASAN_SW_TAGS)
 	unsigned int			kasan_depth;
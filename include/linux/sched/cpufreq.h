@@ -23,6 +23,19 @@ void cpufreq_add_update_util_hook(int cpu, struct update_util_data *data,
 void cpufreq_remove_update_util_hook(int cpu);
 bool cpufreq_this_cpu_can_update(struct cpufreq_policy *policy);
 
+struct task_struct;
+
+struct task_switch_data {
+	void (*func)(struct task_switch_data *data, struct task_struct *next,
+		     unsigned long min_util);
+};
+
+void cpufreq_add_task_switch_hook(int cpu, struct task_switch_data *data,
+			void (*func)(struct task_switch_data *data,
+				     struct task_struct *next,
+				     unsigned long min_util));
+void cpufreq_remove_task_switch_hook(int cpu);
+
 static inline unsigned long map_util_freq(unsigned long util,
 					unsigned long freq, unsigned long cap)
 {
@@ -30,6 +30,10 @@ enum scx_public_consts {
  *    B: 1 for IDs for built-in DSQs, 0 for ops-created user DSQs
  *   ID: 63 bit ID
  *
+ * A user DSQ whose ID has %SCX_DSQ_FLAG_LLC set is a domain DSQ. It is backed
+ * by one queue per LLC and tasks inserted into it are queued on the LLC of
+ * their target CPU. See scx_bpf_create_dsq().
+ *
  * Built-in IDs:
  *
  *   Bits: [63] [62] [61..32] [31 ..  0]
@@ -42,6 +46,7 @@ enum scx_public_consts {
 enum scx_dsq_id_flags {
 	SCX_DSQ_FLAG_BUILTIN	= 1LLU << 63,
 	SCX_DSQ_FLAG_LOCAL_ON	= 1LLU << 62,
+	SCX_DSQ_FLAG_LLC	= 1LLU << 61,
 
 	SCX_DSQ_INVALID		= SCX_DSQ_FLAG_BUILTIN | 0,
 	SCX_DSQ_GLOBAL		= SCX_DSQ_FLAG_BUILTIN | 1,
@@ -66,6 +71,7 @@ struct scx_dispatch_q {
 	struct rhash_head	hash_node;
 	struct llist_node	free_node;
 	struct rcu_head		rcu;
+	struct scx_llc_dsqs	*llc;	/* per-LLC queues of a domain DSQ */
 };
 
 /* scx_entity.flags */
@@ -23,18 +23,23 @@ enum numa_vmaskip_reason {
 	NUMAB_SKIP_PID_INACTIVE,
 	NUMAB_SKIP_IGNORE_PID,
 	NUMAB_SKIP_SEQ_COMPLETED,
+	NUMAB_SKIP_CONVERGED,
 };
 
+struct seq_file;
+
 #ifdef CONFIG_NUMA_BALANCING
-extern void task_numa_fault(int last_node, int node, int pages, int flags);
+extern void task_numa_fault(struct vm_area_struct *vma, int last_node,
+			    int node, int pages, int flags);
+extern int proc_numa_vma_stats_show(struct seq_file *m, struct mm_struct *mm);
 extern pid_t task_numa_group_id(struct task_struct *p);
 extern void set_numabalancing_state(bool enabled);
 extern void task_numa_free(struct task_struct *p, bool final);
 bool should_numa_migrate_memory(struct task_struct *p, struct folio *folio,
 				int src_nid, int dst_cpu);
 #else
-static inline void task_numa_fault(int last_node, int node, int pages,
-				   int flags)
+static inline void task_numa_fault(struct vm_area_struct *vma, int last_node,
+				   int node, int pages, int flags)
 {
 }
 static inline pid_t task_numa_group_id(struct task_struct *p)
@@ -69,6 +69,14 @@ extern void sched_cancel_fork(struct task_struct *p);
 extern void sched_post_fork(struct task_struct *p);
 extern void sched_dead(struct task_struct *p);
 
+#ifdef CONFIG_SCHED_BORE
+extern void sched_clone_bore(struct task_struct *p, struct task_struct *parent,
+			     u64 clone_flags, u64 now);
+extern void sched_exit_bore(struct task_struct *p);
+extern void sched_reparent_bore(struct task_struct *p, struct task_struct *reaper);
+extern void sched_exec_bore(struct task_struct *p);
+#endif
+
 void __noreturn do_task_dead(void);
 void __noreturn make_task_dead(int signr);
 
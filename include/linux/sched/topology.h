@@ -78,6 +78,10 @@ struct sched_domain_shared {
 	atomic_t	nr_busy_cpus;
 	int		has_idle_cores;
 	int		nr_idle_scan;
+#ifdef CONFIG_SCHED_SSS
+	long		sss_spare_cap;
+	int		sss_spare_cpu;
+#endif
 };
 
 struct sched_domain {
@@ -424,6 +424,19 @@ int security_inode_readlink(struct dentry *dentry);
 int security_inode_follow_link(struct dentry *dentry, struct inode *inode,
 			       bool rcu);
 int security_inode_permission(struct inode *inode, int mask);
+
+DECLARE_STATIC_KEY_FALSE(security_inode_permission_hooked);
+
+/*
+ * Without an inode_permission hook, permission depends only on the inode and
+ * the credentials, so the VFS may cache permission granted to everyone.  This
+ * is checked on every use of the cache, as a hook can become active later.
+ */
+static inline bool security_inode_permission_cacheable(void)
+{
+	return !static_branch_unlikely(&security_inode_permission_hooked);
+}
+
 int security_inode_setattr(struct mnt_idmap *idmap,
 			   struct dentry *dentry, struct iattr *attr);
 void security_inode_post_setattr(struct mnt_idmap *idmap, struct dentry *dentry,
@@ -971,6 +984,11 @@ static inline int security_inode_permission(struct inode *inode, int mask)
 	return 0;
 }
 
+static inline bool security_inode_permission_cacheable(void)
+{
+	return true;
+}
+
 static inline int security_inode_setattr(struct mnt_idmap *idmap,
 					 struct dentry *dentry,
 					 struct iattr *attr)
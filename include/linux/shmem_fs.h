@@ -73,6 +73,11 @@ struct shmem_sb_info {
 	struct list_head shrinklist;  /* List of shinkable inodes */
 	unsigned long shrinklist_len; /* Length of shrinklist */
 	struct shmem_quota_limits qlimits; /* Default quota limits */
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE
+	atomic_long_t folio_alloc[NR_PAGE_ORDERS];    /* Large folios allocated */
+	atomic_long_t folio_fallback[NR_PAGE_ORDERS]; /* Failed large allocations */
+	atomic_long_t folio_split;    /* Large folios split */
+#endif
 };
 
 static inline struct shmem_inode_info *SHMEM_I(struct inode *inode)
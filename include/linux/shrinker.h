@@ -112,6 +112,11 @@ struct shrinker {
 	int debugfs_id;
 	const char *name;
 	struct dentry *debugfs_entry;
+	/* cost of the reclaim calls, shown in the "cost" debugfs file */
+	atomic_long_t debugfs_nr_calls;
+	atomic_long_t debugfs_nr_freed;
+	atomic64_t debugfs_time_ns;
+	u64 debugfs_max_ns;
 #endif
 	/* objs pending delete, per node */
 	atomic_long_t *nr_deferred;
@@ -335,6 +335,19 @@ struct kmem_cache_args {
 	 * %NULL means no constructor.
 	 */
 	void (*ctor)(void *);
+	/**
+	 * @sheaf_capacity: Enable percpu sheaves of this many objects.
+	 *
+	 * Sheaves are per-cpu arrays of objects that allocations and frees
+	 * are served from, refilled and flushed in bulk through per-node
+	 * barns of full and empty sheaves. They make frees cheap for caches
+	 * with a high rate of objects freed on a different cpu than the one
+	 * that allocated them, at the cost of memory tied up in the sheaves.
+	 * Ignored for caches with debugging enabled and with CONFIG_SLUB_TINY.
+	 *
+	 * %0 means no sheaves.
+	 */
+	unsigned int sheaf_capacity;
 };
 
 struct kmem_cache *__kmem_cache_create_args(const char *name,
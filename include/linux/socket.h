@@ -17,6 +17,7 @@ struct socket;
 struct sock;
 struct sk_buff;
 struct proto_accept_arg;
+struct msg_rx_batch;
 
 #define __sockaddr_check_size(size)	\
 	BUILD_BUG_ON(((size) > sizeof(struct __kernel_sockaddr_storage)))
@@ -78,6 +79,7 @@ struct msghdr {
 	struct ubuf_info *msg_ubuf;
 	int (*sg_from_iter)(struct sk_buff *skb,
 			    struct iov_iter *from, size_t length);
+	struct msg_rx_batch *msg_rx_batch; /* recvmmsg() read-ahead */
 };
 
 struct user_msghdr {
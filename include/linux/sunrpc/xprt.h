@@ -292,7 +292,8 @@ struct rpc_xprt {
 		unsigned long long	req_u,		/* average requests on the wire */
 					bklog_u,	/* backlog queue utilization */
 					sending_u,	/* send q utilization */
-					pending_u;	/* pend q utilization */
+					pending_u,	/* pend q utilization */
+					rtt_u;		/* total reply RTT (usecs) */
 	} stat;
 
 	struct net		*xprt_net;
@@ -47,6 +47,7 @@ struct stat64;
 struct statfs;
 struct statfs64;
 struct statx;
+struct linux_dirent64_statx;
 struct sysinfo;
 struct timespec;
 struct __kernel_old_timeval;
@@ -467,6 +468,10 @@ asmlinkage long sys_quotactl_fd(unsigned int fd, unsigned int cmd, qid_t id,
 asmlinkage long sys_getdents64(unsigned int fd,
 				struct linux_dirent64 __user *dirent,
 				unsigned int count);
+asmlinkage long sys_getdents64_statx(unsigned int fd,
+				struct linux_dirent64_statx __user *dirent,
+				unsigned int count, unsigned int mask,
+				unsigned int flags);
 asmlinkage long sys_llseek(unsigned int fd, unsigned long offset_high,
 			unsigned long offset_low, loff_t __user *result,
 			unsigned int whence);
@@ -370,6 +370,12 @@ struct tcp_sock {
 		   dsack_seen:1, /* Whether DSACK seen after last adj */
 		   advanced:1;	 /* mstamp advanced since last lost marking */
 	} rack;
+	/* Hints of the ACK being processed, for TCP_CONG_WANTS_ACK_HINTS */
+	struct tcp_ack_hints {
+		u64 rx_hwtstamp; /* NIC receive time of the ACK, 0 if none */
+		u64 tx_hwtstamp; /* NIC send time of the newest acked skb */
+		u32 prior_delivered_ce; /* tp->delivered_ce before the ACK */
+	} ack_hints;
 	u8	compressed_ack;
 	u8	dup_ack_counter:2,
 		tlp_retrans:1,	/* TLP is a retransmission */
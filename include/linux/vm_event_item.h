@@ -36,6 +36,10 @@ enum vm_event_item { PGPGIN, PGPGOUT, PSWPIN, PSWPOUT,
 		PGFREE, PGACTIVATE, PGDEACTIVATE, PGLAZYFREE,
 		PGFAULT, PGMAJFAULT,
 		PGLAZYFREED,
+		MADVISE_FLUSH_SAVED,
+#ifdef CONFIG_MEMCG
+		MEMCG_FLUSH_AVOIDED,
+#endif
 		PGREFILL,
 		PGREUSE,
 		PGSTEAL_KSWAPD,
@@ -60,6 +64,8 @@ enum vm_event_item { PGPGIN, PGPGOUT, PSWPIN, PSWPOUT,
 		PAGEOUTRUN, PGROTATED,
 		DROP_PAGECACHE, DROP_SLAB,
 		OOM_KILL,
+		DIRTY_THROTTLE_10MS, DIRTY_THROTTLE_50MS, DIRTY_THROTTLE_100MS,
+		DIRTY_THROTTLE_SLOW, DIRTY_THROTTLE_BUDGET_SKIP,
 #ifdef CONFIG_NUMA_BALANCING
 		NUMA_PTE_UPDATES,
 		NUMA_HUGE_PTE_UPDATES,
@@ -132,6 +138,7 @@ enum vm_event_item { PGPGIN, PGPGOUT, PSWPIN, PSWPOUT,
 		NR_TLB_REMOTE_FLUSH_RECEIVED,/* cpu received ipi for flush */
 		NR_TLB_LOCAL_FLUSH_ALL,
 		NR_TLB_LOCAL_FLUSH_ONE,
+		NR_TLB_BROADCAST_FLUSH,	/* cpu flushed others' tlbs with INVLPGB */
 #endif /* CONFIG_DEBUG_TLBFLUSH */
 #ifdef CONFIG_SWAP
 		SWAP_RA,
@@ -144,6 +151,8 @@ enum vm_event_item { PGPGIN, PGPGOUT, PSWPIN, PSWPOUT,
 #endif
 #ifdef CONFIG_KSM
 		COW_KSM,
+		KSM_SCAN_NSEC,
+		KSM_YIELD,
 #endif
 #ifdef CONFIG_ZSWAP
 		ZSWPIN,
@@ -172,6 +172,7 @@ struct netns_ipv4 {
 	u8 sysctl_tcp_migrate_req;
 	u8 sysctl_tcp_comp_sack_nr;
 	u8 sysctl_tcp_backlog_ack_defer;
+	u8 sysctl_tcp_gro_merge_acks;
 	u8 sysctl_tcp_pingpong_thresh;
 
 	u8 sysctl_tcp_retries1;
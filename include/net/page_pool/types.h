@@ -58,6 +58,18 @@ struct pp_alloc_cache {
 	netmem_ref cache[PP_ALLOC_CACHE_SIZE];
 };
 
+/* Pages returned outside of the pool's NAPI context are first collected in
+ * a small per-CPU magazine and then moved to the ptr_ring in one batch, so
+ * that remote CPUs take the ring producer lock once per magazine instead of
+ * once per page.
+ */
+#define PP_MAGAZINE_SIZE	16
+struct pp_magazine {
+	spinlock_t lock;
+	u32 count;
+	netmem_ref cache[PP_MAGAZINE_SIZE];
+};
+
 /**
  * struct page_pool_params - page pool parameters
  * @fast:	params accessed frequently on hotpath
@@ -123,6 +135,8 @@ struct page_pool_alloc_stats {
  * @ring:	page placed into the ptr ring
  * @ring_full:	page released from page pool because the ptr ring was full
  * @released_refcnt:	page released (and not recycled) because refcnt > 1
+ * @magazine:	page placed into a per-CPU magazine
+ * @magazine_flush:	magazine moved into the ptr ring
  */
 struct page_pool_recycle_stats {
 	u64 cached;
@@ -130,6 +144,8 @@ struct page_pool_recycle_stats {
 	u64 ring;
 	u64 ring_full;
 	u64 released_refcnt;
+	u64 magazine;
+	u64 magazine_flush;
 };
 
 /**
@@ -218,9 +234,13 @@ struct page_pool {
 	 * Use ptr_ring, as it separates consumer and producer
 	 * efficiently, it a way that doesn't bounce cache-lines.
 	 *
-	 * TODO: Implement bulk return pages into this structure.
+	 * Remote CPUs return pages through the per-CPU magazines.
+	 * Partial ones are drained when the ring runs empty, at most
+	 * once per jiffy.
 	 */
 	struct ptr_ring ring;
+	struct pp_magazine __percpu *magazines;
+	unsigned long magazines_drained;
 
 	void *mp_priv;
 	const struct memory_provider_ops *mp_ops;
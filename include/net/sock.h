@@ -1846,6 +1846,24 @@ static inline void sock_replace_proto(struct sock *sk, struct proto *proto)
 	WRITE_ONCE(sk->sk_prot, proto);
 }
 
+/* Datagrams a protocol dequeued ahead for the next messages of a recvmmsg()
+ * call.  They are still charged to @sk and go back to it through @release if
+ * the call ends before consuming them.
+ */
+struct msg_rx_batch {
+	struct sk_buff_head	skbs;
+	unsigned int		want;	/* messages still wanted, this one included */
+	struct sock		*sk;
+	void			(*release)(struct sock *sk,
+					   struct sk_buff_head *skbs);
+};
+
+static inline void msg_rx_batch_release(struct msg_rx_batch *batch)
+{
+	if (!skb_queue_empty(&batch->skbs))
+		batch->release(batch->sk, &batch->skbs);
+}
+
 struct sockcm_cookie {
 	u64 transmit_time;
 	u32 mark;
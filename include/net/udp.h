@@ -389,6 +389,8 @@ int __udp_enqueue_schedule_skb(struct sock *sk, struct sk_buff *skb);
 void udp_skb_destructor(struct sock *sk, struct sk_buff *skb);
 struct sk_buff *__skb_recv_udp(struct sock *sk, unsigned int flags, int *off,
 			       int *err);
+struct sk_buff *udp_recv_datagram(struct sock *sk, struct msghdr *msg,
+				  unsigned int flags, int *off, int *err);
 static inline struct sk_buff *skb_recv_udp(struct sock *sk, unsigned int flags,
 					   int *err)
 {
@@ -525,7 +525,12 @@ struct netdev_bpf;
 void xdp_attachment_setup(struct xdp_attachment_info *info,
 			  struct netdev_bpf *bpf);
 
+/* A devmap bulk queue starts out transmitting DEV_MAP_BULK_SIZE frames per
+ * ndo_xdp_xmit() call, and grows its batch up to DEV_MAP_BULK_MAX frames as
+ * long as the driver has room in its TX ring for all of them.
+ */
 #define DEV_MAP_BULK_SIZE XDP_BULK_QUEUE_SIZE
+#define DEV_MAP_BULK_MAX (4 * DEV_MAP_BULK_SIZE)
 
 /* Define the relationship between xdp-rx-metadata kfunc and
  * various other entities:
@@ -0,0 +1,141 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM adios
+
+#if !defined(_TRACE_ADIOS_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_ADIOS_H
+
+#include <linux/blkdev.h>
+#include <linux/tracepoint.h>
+
+#define show_adios_optype(optype)					\
+	__print_symbolic(optype,					\
+		{ 0, "R" }, { 1, "W" }, { 2, "D" }, { 3, "O" })
+
+TRACE_EVENT(adios_insert,
+
+	TP_PROTO(struct request *rq, u8 optype, u64 deadline, u64 pred_lat),
+
+	TP_ARGS(rq, optype, deadline, pred_lat),
+
+	TP_STRUCT__entry(
+		__field(	dev_t,		dev		)
+		__field(	sector_t,	sector		)
+		__field(	unsigned int,	nr_bytes	)
+		__field(	u8,		optype		)
+		__field(	u64,		slack		)
+		__field(	u64,		pred_lat	)
+	),
+
+	TP_fast_assign(
+		__entry->dev		= rq->q->disk ? disk_devt(rq->q->disk) : 0;
+		__entry->sector		= blk_rq_pos(rq);
+		__entry->nr_bytes	= blk_rq_bytes(rq);
+		__entry->optype		= optype;
+		__entry->slack		= deadline - rq->start_time_ns;
+		__entry->pred_lat	= pred_lat;
+	),
+
+	TP_printk("%d,%d %s %llu + %u slack=%llu pred=%llu",
+		  MAJOR(__entry->dev), MINOR(__entry->dev),
+		  show_adios_optype(__entry->optype),
+		  (unsigned long long)__entry->sector, __entry->nr_bytes,
+		  __entry->slack, __entry->pred_lat)
+);
+
+TRACE_EVENT(adios_fill,
+
+	TP_PROTO(struct request_queue *q, unsigned int hctx, u32 count,
+		 u64 batch_lat, u64 total_lat),
+
+	TP_ARGS(q, hctx, count, batch_lat, total_lat),
+
+	TP_STRUCT__entry(
+		__field(	dev_t,		dev		)
+		__field(	unsigned int,	hctx		)
+		__field(	u32,		count		)
+		__field(	u64,		batch_lat	)
+		__field(	u64,		total_lat	)
+	),
+
+	TP_fast_assign(
+		__entry->dev		= q->disk ? disk_devt(q->disk) : 0;
+		__entry->hctx		= hctx;
+		__entry->count		= count;
+		__entry->batch_lat	= batch_lat;
+		__entry->total_lat	= total_lat;
+	),
+
+	TP_printk("%d,%d hctx=%u count=%u batch_lat=%llu total_lat=%llu",
+		  MAJOR(__entry->dev), MINOR(__entry->dev), __entry->hctx,
+		  __entry->count, __entry->batch_lat, __entry->total_lat)
+);
+
+TRACE_EVENT(adios_dispatch,
+
+	TP_PROTO(struct request *rq, u8 optype, bool from_pq),
+
+	TP_ARGS(rq, optype, from_pq),
+
+	TP_STRUCT__entry(
+		__field(	dev_t,		dev		)
+		__field(	sector_t,	sector		)
+		__field(	unsigned int,	nr_bytes	)
+		__field(	u8,		optype		)
+		__field(	bool,		from_pq		)
+	),
+
+	TP_fast_assign(
+		__entry->dev		= rq->q->disk ? disk_devt(rq->q->disk) : 0;
+		__entry->sector		= blk_rq_pos(rq);
+		__entry->nr_bytes	= blk_rq_bytes(rq);
+		__entry->optype		= optype;
+		__entry->from_pq	= from_pq;
+	),
+
+	TP_printk("%d,%d %s %llu + %u from=%s",
+		  MAJOR(__entry->dev), MINOR(__entry->dev),
+		  show_adios_optype(__entry->optype),
+		  (unsigned long long)__entry->sector, __entry->nr_bytes,
+		  __entry->from_pq ? "prio" : "batch")
+);
+
+TRACE_EVENT(adios_complete,
+
+	TP_PROTO(struct request *rq, u8 optype, u64 latency, u64 pred_lat,
+		 bool missed),
+
+	TP_ARGS(rq, optype, latency, pred_lat, missed),
+
+	TP_STRUCT__entry(
+		__field(	dev_t,		dev		)
+		__field(	sector_t,	sector		)
+		__field(	unsigned int,	nr_bytes	)
+		__field(	u8,		optype		)
+		__field(	u64,		latency		)
+		__field(	u64,		pred_lat	)
+		__field(	bool,		missed		)
+	),
+
+	TP_fast_assign(
+		__entry->dev		= rq->q->disk ? disk_devt(rq->q->disk) : 0;
+		__entry->sector		= blk_rq_pos(rq);
+		__entry->nr_bytes	= blk_rq_bytes(rq);
+		__entry->optype		= optype;
+		__entry->latency	= latency;
+		__entry->pred_lat	= pred_lat;
+		__entry->missed		= missed;
+	),
+
+	TP_printk("%d,%d %s %llu + %u lat=%llu pred=%llu%s",
+		  MAJOR(__entry->dev), MINOR(__entry->dev),
+		  show_adios_optype(__entry->optype),
+		  (unsigned long long)__entry->sector, __entry->nr_bytes,
+		  __entry->latency, __entry->pred_lat,
+		  __entry->missed ? " missed" : "")
+);
+
+#endif /* _TRACE_ADIOS_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
@@ -702,7 +702,8 @@ DEFINE_EVENT(sched_numa_pair_template, sched_swap_numa,
 	EM( NUMAB_SKIP_SCAN_DELAY,		"scan_delay" )	\
 	EM( NUMAB_SKIP_PID_INACTIVE,		"pid_inactive" )	\
 	EM( NUMAB_SKIP_IGNORE_PID,		"ignore_pid_inactive" )		\
-	EMe(NUMAB_SKIP_SEQ_COMPLETED,		"seq_completed" )
+	EM( NUMAB_SKIP_SEQ_COMPLETED,		"seq_completed" )	\
+	EMe(NUMAB_SKIP_CONVERGED,		"converged" )
 
 /* Redefine for export. */
 #undef EM
@@ -747,6 +748,90 @@ TRACE_EVENT(sched_skip_vma_numa,
 );
 #endif /* CONFIG_NUMA_BALANCING */
 
+#ifdef CONFIG_SCHED_BORE
+/*
+ * Tracepoints for BORE burst scoring.
+ */
+DECLARE_EVENT_CLASS(sched_burst_template,
+
+	TP_PROTO(struct task_struct *p, u64 burst_time, int prio),
+
+	TP_ARGS(p, burst_time, prio),
+
+	TP_STRUCT__entry(
+		__array(	char,	comm,	TASK_COMM_LEN	)
+		__field(	pid_t,	pid			)
+		__field(	u64,	burst_time		)
+		__field(	u32,	penalty			)
+		__field(	u8,	score			)
+		__field(	int,	prio			)
+	),
+
+	TP_fast_assign(
+		memcpy(__entry->comm, p->comm, TASK_COMM_LEN);
+		__entry->pid		= p->pid;
+		__entry->burst_time	= burst_time;
+		__entry->penalty	= p->se.burst_penalty;
+		__entry->score		= p->se.burst_score;
+		__entry->prio		= prio;
+	),
+
+	TP_printk("comm=%s pid=%d burst_time=%Lu [ns] penalty=%u score=%u prio=%d",
+		  __entry->comm, __entry->pid,
+		  (unsigned long long)__entry->burst_time,
+		  __entry->penalty, __entry->score, __entry->prio)
+);
+
+/*
+ * Tracepoint for a change of the effective priority due to the burst score:
+ */
+DEFINE_EVENT(sched_burst_template, sched_burst_score,
+	     TP_PROTO(struct task_struct *p, u64 burst_time, int prio),
+	     TP_ARGS(p, burst_time, prio));
+
+/*
+ * Tracepoint for the end of a burst (sleep or yield), burst_time being the
+ * length of the burst that just ended:
+ */
+DEFINE_EVENT(sched_burst_template, sched_burst_restart,
+	     TP_PROTO(struct task_struct *p, u64 burst_time, int prio),
+	     TP_ARGS(p, burst_time, prio));
+
+/*
+ * Tracepoint for the deadline rescaling done on yield:
+ */
+TRACE_EVENT(sched_burst_rescale_deadline,
+
+	TP_PROTO(struct task_struct *p, int prev_prio, int new_prio, s64 vremain,
+		 s64 vscaled),
+
+	TP_ARGS(p, prev_prio, new_prio, vremain, vscaled),
+
+	TP_STRUCT__entry(
+		__array(	char,	comm,	TASK_COMM_LEN	)
+		__field(	pid_t,	pid			)
+		__field(	int,	prev_prio		)
+		__field(	int,	new_prio		)
+		__field(	s64,	vremain			)
+		__field(	s64,	vscaled			)
+	),
+
+	TP_fast_assign(
+		memcpy(__entry->comm, p->comm, TASK_COMM_LEN);
+		__entry->pid		= p->pid;
+		__entry->prev_prio	= prev_prio;
+		__entry->new_prio	= new_prio;
+		__entry->vremain	= vremain;
+		__entry->vscaled	= vscaled;
+	),
+
+	TP_printk("comm=%s pid=%d prev_prio=%d new_prio=%d vremain=%Ld vscaled=%Ld",
+		  __entry->comm, __entry->pid, __entry->prev_prio,
+		  __entry->new_prio, (long long)__entry->vremain,
+		  (long long)__entry->vscaled)
+);
+#endif /* CONFIG_SCHED_BORE */
+
 /*
  * Tracepoint for waking a polling cpu without an IPI.
  */
@@ -19,4 +19,9 @@
 #define POSIX_FADV_NOREUSE	5 /* Data will be accessed once.  */
 #endif
 
+/* Linux specific: NUMA placement of the page cache of the file. */
+#define POSIX_FADV_PLACE_DEFAULT 8 /* Follow the policy of the mount.  */
+#define POSIX_FADV_INTERLEAVE	9 /* Spread pages over the allowed nodes.  */
+#define POSIX_FADV_LOCAL	10 /* Allocate pages on the local node.  */
+
 #endif	/* FADVISE_H_INCLUDED */
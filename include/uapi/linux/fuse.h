@@ -232,6 +232,11 @@
  *
  *  7.43
  *  - add FUSE_REQUEST_TIMEOUT
+ *
+ *  7.44
+ *  - add FUSE_BACKING_PASSTHROUGH_ATTR backing map flag
+ *  - add FUSE_DEV_IOC_BACKING_REVOKE
+ *  - allow FOPEN_PASSTHROUGH for directories
  */
 
 #ifndef _LINUX_FUSE_H
@@ -267,7 +272,7 @@
 #define FUSE_KERNEL_VERSION 7
 
 /** Minor version number of this interface */
-#define FUSE_KERNEL_MINOR_VERSION 43
+#define FUSE_KERNEL_MINOR_VERSION 44
 
 /** The node ID of the root inode */
 #define FUSE_ROOT_ID 1
@@ -374,7 +379,8 @@ struct fuse_file_lock {
  * FOPEN_STREAM: the file is stream-like (no file position at all)
  * FOPEN_NOFLUSH: don't flush data cache on close (unless FUSE_WRITEBACK_CACHE)
  * FOPEN_PARALLEL_DIRECT_WRITES: Allow concurrent direct writes on the same inode
- * FOPEN_PASSTHROUGH: passthrough read/write io for this open file
+ * FOPEN_PASSTHROUGH: passthrough read/write io for this open file, or readdir
+ *		      for this open directory
  */
 #define FOPEN_DIRECT_IO		(1 << 0)
 #define FOPEN_KEEP_CACHE	(1 << 1)
@@ -1110,6 +1116,15 @@ struct fuse_notify_retrieve_in {
 	uint64_t	dummy4;
 };
 
+/**
+ * Backing map flags
+ *
+ * FUSE_BACKING_PASSTHROUGH_ATTR: getattr/statx of the inodes using this
+ *				  backing file are served from the backing file
+ */
+#define FUSE_BACKING_PASSTHROUGH_ATTR	(1 << 0)
+#define FUSE_BACKING_FLAGS		FUSE_BACKING_PASSTHROUGH_ATTR
+
 struct fuse_backing_map {
 	int32_t		fd;
 	uint32_t	flags;
@@ -1122,6 +1137,7 @@ struct fuse_backing_map {
 #define FUSE_DEV_IOC_BACKING_OPEN	_IOW(FUSE_DEV_IOC_MAGIC, 1, \
 					     struct fuse_backing_map)
 #define FUSE_DEV_IOC_BACKING_CLOSE	_IOW(FUSE_DEV_IOC_MAGIC, 2, uint32_t)
+#define FUSE_DEV_IOC_BACKING_REVOKE	_IOW(FUSE_DEV_IOC_MAGIC, 3, uint32_t)
 
 struct fuse_lseek_in {
 	uint64_t	fh;
@@ -1265,7 +1281,12 @@ struct fuse_uring_req_header {
 enum fuse_uring_cmd {
 	FUSE_IO_URING_CMD_INVALID = 0,
 
-	/* register the request buffer and fetch a fuse request */
+	/*
+	 * register the request buffer and fetch a fuse request. With
+	 * IORING_URING_CMD_FIXED, the payload buffer is part of the registered
+	 * buffer sqe->buf_index, and all commits of the entry have to be sent
+	 * with IORING_URING_CMD_FIXED and the same buffer index.
+	 */
 	FUSE_IO_URING_CMD_REGISTER = 1,
 
 	/* commit fuse request result and fetch next request */
@@ -1281,7 +1302,12 @@ struct fuse_uring_cmd_req {
 	/* entry identifier for commits */
 	uint64_t commit_id;
 
-	/* queue the command is for (queue index) */
+	/*
+	 * queue the command is for (queue index). Indexes from the number of
+	 * possible cpus up to twice that are the optional background queues
+	 * of the cpus, which get the background requests (readahead,
+	 * writeback) instead of the foreground queue of the same cpu.
+	 */
 	uint16_t qid;
 	uint8_t padding[6];
 };
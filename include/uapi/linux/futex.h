@@ -71,6 +71,13 @@
 
 #define FUTEX2_SIZE_MASK	0x03
 
+/*
+ * With FUTEX2_NUMA, the futex word is followed by a word of the same size
+ * holding the node of the hash bucket.  FUTEX_NO_NODE there is replaced by
+ * the node of the first task using the futex.
+ */
+#define FUTEX_NO_NODE		(-1)
+
 /* do not use */
 #define FUTEX_32		FUTEX2_SIZE_U32 /* historical accident :-( */
 
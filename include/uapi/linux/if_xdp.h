@@ -45,6 +45,14 @@
  */
 #define XDP_UMEM_TX_METADATA_LEN	(1 << 2)
 
+/* Let the kernel recycle completed Tx buffers as Rx buffers. The kernel
+ * then consumes the completion ring itself, so user space must not read
+ * it, and takes buffers from the fill ring only when no completed Tx
+ * buffers are left. Completions that Rx does not need are kept by the
+ * kernel for later Rx. Only supported in aligned chunk mode.
+ */
+#define XDP_UMEM_TX_RECYCLE		(1 << 3)
+
 struct sockaddr_xdp {
 	__u16 sxdp_family;
 	__u16 sxdp_flags;
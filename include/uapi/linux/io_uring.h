@@ -113,7 +113,8 @@ struct io_uring_sqe {
 };
 
 /* sqe->attr_type_mask flags */
-#define IORING_RW_ATTR_FLAG_PI	(1U << 0)
+#define IORING_RW_ATTR_FLAG_PI		(1U << 0)
+#define IORING_RW_ATTR_FLAG_BUF_INDEX	(1U << 1)
 /* PI attribute information */
 struct io_uring_attr_pi {
 		__u16	flags;
@@ -124,6 +125,16 @@ struct io_uring_attr_pi {
 		__u64	rsvd;
 };
 
+/*
+ * Registered buffer of each iovec of IORING_OP_READV_FIXED and
+ * IORING_OP_WRITEV_FIXED, replacing sqe->buf_index. addr points to an array
+ * of sqe->len __u16 buffer indices.
+ */
+struct io_uring_attr_buf_index {
+		__u64	addr;
+		__u64	rsvd;
+};
+
 /*
  * If sqe->file_index is set to this for opcodes that instantiate a new
  * direct descriptor (like openat/openat2/accept), then io_uring will allocate
@@ -133,6 +144,21 @@ struct io_uring_attr_pi {
  */
 #define IORING_FILE_INDEX_ALLOC		(~0U)
 
+/*
+ * Requests in a link chain can use the result of an earlier request of the
+ * chain, once that has completed:
+ *
+ * If sqe->fd is set to IORING_FD_LINK_RES, the file is the result of the
+ * closest preceding request not using IORING_FD_LINK_RES itself, e.g. openat
+ * or accept. With IOSQE_FIXED_FILE it is a direct descriptor, as allocated
+ * with IORING_FILE_INDEX_ALLOC. IORING_OP_CLOSE accepts it as well.
+ *
+ * If sqe->len is set to IORING_LEN_LINK_RES for IORING_OP_READ or
+ * IORING_OP_WRITE, the length is the result of the previous request.
+ */
+#define IORING_FD_LINK_RES		(-2)
+#define IORING_LEN_LINK_RES		(~0U)
+
 enum io_uring_sqe_flags_bit {
 	IOSQE_FIXED_FILE_BIT,
 	IOSQE_IO_DRAIN_BIT,
@@ -379,6 +405,17 @@ enum io_uring_op {
  *				IORING_NOTIF_USAGE_ZC_COPIED if data was copied
  *				(at least partially).
  *
+ * IORING_SEND_ZC_COALESCE_NOTIF
+ *				Requires IORING_RECVSEND_FIXED_BUF. SEND[MSG]_ZC
+ *				requests using the same registered buffer are
+ *				numbered from 1 in submission order, and instead
+ *				of one IORING_CQE_F_NOTIF cqe per request, a
+ *				notification cqe is only posted when the number
+ *				up to which all of them have completed advances.
+ *				Its low 31 bits are reported in cqe.res, and the
+ *				cqe's user_data is that of the last request
+ *				completed.
+ *
  * IORING_RECVSEND_BUNDLE	Used with IOSQE_BUFFER_SELECT. If set, send or
  *				recv will grab as many buffers from the buffer
  *				group ID given and send them all. The completion
@@ -392,6 +429,7 @@ enum io_uring_op {
 #define IORING_RECVSEND_FIXED_BUF	(1U << 2)
 #define IORING_SEND_ZC_REPORT_USAGE	(1U << 3)
 #define IORING_RECVSEND_BUNDLE		(1U << 4)
+#define IORING_SEND_ZC_COALESCE_NOTIF	(1U << 5)
 
 /*
  * cqe.res for IORING_CQE_F_NOTIF if
@@ -585,6 +623,7 @@ struct io_uring_params {
 #define IORING_FEAT_MIN_TIMEOUT		(1U << 15)
 #define IORING_FEAT_RW_ATTR		(1U << 16)
 #define IORING_FEAT_NO_IOWAIT		(1U << 17)
+#define IORING_FEAT_LINK_RES		(1U << 18)
 
 /*
  * io_uring_register(2) opcodes and arguments
@@ -654,6 +693,12 @@ enum io_uring_register_op {
 
 	IORING_REGISTER_MEM_REGION		= 34,
 
+	/* enable/disable/copy out per-opcode latency histograms */
+	IORING_REGISTER_LAT_STATS		= 35,
+
+	/* group buffer rings of different buffer sizes, see io_uring_buf_tiers */
+	IORING_REGISTER_PBUF_TIERS		= 36,
+
 	/* this goes last */
 	IORING_REGISTER_LAST,
 
@@ -839,6 +884,23 @@ struct io_uring_buf_status {
 	__u32	resv[8];
 };
 
+#define IO_URING_BUF_MAX_TIERS	8
+
+/*
+ * Argument for IORING_REGISTER_PBUF_TIERS. Creates buffer group bgid out
+ * of already registered buffer rings, ordered by increasing buffer size.
+ * A recv selecting from bgid takes a buffer from the first tier whose next
+ * buffer fits the data known to be pending, or from the largest non-empty
+ * one. The CQE only carries the buffer ID, so buffer IDs must be unique
+ * across the tiers. Removed with IORING_UNREGISTER_PBUF_RING on bgid.
+ */
+struct io_uring_buf_tiers {
+	__u16	bgid;
+	__u16	nr_tiers;
+	__u16	tiers[IO_URING_BUF_MAX_TIERS];
+	__u32	resv[3];
+};
+
 enum io_uring_napi_op {
 	/* register/ungister backward compatible opcode */
 	IO_URING_NAPI_REGISTER_OP = 0,
@@ -855,6 +917,14 @@ enum io_uring_napi_tracking_strategy {
 	IO_URING_NAPI_TRACKING_INACTIVE = 255
 };
 
+enum io_uring_napi_flags {
+	/*
+	 * Learn the packet inter-arrival time of each napi id and only busy
+	 * poll those which are expected to receive within busy_poll_to.
+	 */
+	IO_URING_NAPI_F_ADAPTIVE	= 1,
+};
+
 /* argument for IORING_(UN)REGISTER_NAPI */
 struct io_uring_napi {
 	__u32	busy_poll_to;
@@ -872,7 +942,8 @@ struct io_uring_napi {
 	 * it is the napi id to add/del from napi_list.
 	 */
 	__u32	op_param;
-	__u32	resv;
+	/* io_uring_napi_flags, for IO_URING_NAPI_REGISTER_OP */
+	__u32	flags;
 };
 
 /*
@@ -988,15 +1059,67 @@ struct io_uring_zcrx_offsets {
 	__u64	__resv[2];
 };
 
+enum io_uring_zcrx_area_flags {
+	/* addr is an offset into the dma-buf given by dmabuf_fd */
+	IORING_ZCRX_AREA_DMABUF		= 1,
+};
+
 struct io_uring_zcrx_area_reg {
 	__u64	addr;
 	__u64	len;
 	__u64	rq_area_token;
 	__u32	flags;
-	__u32	__resv1;
+	__u32	dmabuf_fd;
 	__u64	__resv2[2];
 };
 
+enum zcrx_reg_flags {
+	/*
+	 * Don't register a new area, share the one of the zcrx given by
+	 * area_zcrx_id instead. Both must be bound to queues of the same
+	 * netdev.
+	 */
+	ZCRX_REG_SHARE_AREA	= 1,
+};
+
+/* number of log2 buckets of struct io_uring_lat_hist */
+#define IO_URING_LAT_BUCKETS	32
+
+enum io_uring_lat_stats_op {
+	/* start collecting, the histograms are kept from any earlier run */
+	IO_URING_LAT_STATS_ENABLE,
+	IO_URING_LAT_STATS_DISABLE,
+	/* copy out and, with IO_URING_LAT_STATS_F_RESET, clear */
+	IO_URING_LAT_STATS_GET,
+};
+
+#define IO_URING_LAT_STATS_F_RESET	(1U << 0)
+
+/*
+ * Latency histograms of one opcode. Bucket i counts requests that took
+ * [2^i, 2^(i+1)) nanoseconds, the last one everything from 2^31 ns up.
+ */
+struct io_uring_lat_hist {
+	/* from submission to completion */
+	__u64	complete[IO_URING_LAT_BUCKETS];
+	/* from submission until an io-wq worker started on it */
+	__u64	iowq[IO_URING_LAT_BUCKETS];
+};
+
+/* argument for IORING_REGISTER_LAT_STATS */
+struct io_uring_lat_stats_reg {
+	__u32	op;		/* enum io_uring_lat_stats_op */
+	__u32	flags;
+	/*
+	 * IO_URING_LAT_STATS_GET: struct io_uring_lat_hist array indexed by
+	 * opcode, with room for nr_ops entries. Set to IORING_OP_LAST.
+	 */
+	__u64	addr;
+	__u32	nr_ops;
+	__u32	resv;
+	__u64	resv2[2];
+};
+
 /*
  * Argument for IORING_REGISTER_ZCRX_IFQ
  */
@@ -1011,7 +1134,7 @@ struct io_uring_zcrx_ifq_reg {
 
 	struct io_uring_zcrx_offsets offsets;
 	__u32	zcrx_id;
-	__u32	__resv2;
+	__u32	area_zcrx_id;
 	__u64	__resv[3];
 };
 
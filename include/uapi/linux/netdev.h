@@ -73,6 +73,12 @@ enum netdev_queue_type {
 	NETDEV_QUEUE_TYPE_TX,
 };
 
+enum netdev_napi_threaded {
+	NETDEV_NAPI_THREADED_DISABLED,
+	NETDEV_NAPI_THREADED_ENABLED,
+	NETDEV_NAPI_THREADED_BUSY_POLL,
+};
+
 enum netdev_qstats_scope {
 	NETDEV_QSTATS_SCOPE_QUEUE = 1,
 };
@@ -121,6 +127,8 @@ enum {
 	NETDEV_A_PAGE_POOL_STATS_RECYCLE_RING,
 	NETDEV_A_PAGE_POOL_STATS_RECYCLE_RING_FULL,
 	NETDEV_A_PAGE_POOL_STATS_RECYCLE_RELEASED_REFCNT,
+	NETDEV_A_PAGE_POOL_STATS_RECYCLE_MAGAZINE,
+	NETDEV_A_PAGE_POOL_STATS_RECYCLE_MAGAZINE_FLUSH,
 
 	__NETDEV_A_PAGE_POOL_STATS_MAX,
 	NETDEV_A_PAGE_POOL_STATS_MAX = (__NETDEV_A_PAGE_POOL_STATS_MAX - 1)
@@ -134,6 +142,8 @@ enum {
 	NETDEV_A_NAPI_DEFER_HARD_IRQS,
 	NETDEV_A_NAPI_GRO_FLUSH_TIMEOUT,
 	NETDEV_A_NAPI_IRQ_SUSPEND_TIMEOUT,
+	NETDEV_A_NAPI_POLLS,
+	NETDEV_A_NAPI_POLL_WORK,
 
 	__NETDEV_A_NAPI_MAX,
 	NETDEV_A_NAPI_MAX = (__NETDEV_A_NAPI_MAX - 1)
@@ -40,11 +40,32 @@ struct ntsync_wait_args {
 
 #define NTSYNC_MAX_WAIT_COUNT 64
 
+#define NTSYNC_SIGNAL_SEM_RELEASE	0
+#define NTSYNC_SIGNAL_MUTEX_UNLOCK	1
+#define NTSYNC_SIGNAL_EVENT_SET		2
+#define NTSYNC_SIGNAL_EVENT_PULSE	3
+
+struct ntsync_signal_op {
+	__u32 obj;
+	__u32 op;
+	__u32 value;
+	__u32 prev;
+};
+
+struct ntsync_signal_args {
+	__u64 ops;
+	__u32 count;
+	__u32 pad;
+};
+
+#define NTSYNC_MAX_SIGNAL_COUNT 64
+
 #define NTSYNC_IOC_CREATE_SEM		_IOW ('N', 0x80, struct ntsync_sem_args)
 #define NTSYNC_IOC_WAIT_ANY		_IOWR('N', 0x82, struct ntsync_wait_args)
 #define NTSYNC_IOC_WAIT_ALL		_IOWR('N', 0x83, struct ntsync_wait_args)
 #define NTSYNC_IOC_CREATE_MUTEX		_IOW ('N', 0x84, struct ntsync_mutex_args)
 #define NTSYNC_IOC_CREATE_EVENT		_IOW ('N', 0x87, struct ntsync_event_args)
+#define NTSYNC_IOC_SIGNAL		_IOW ('N', 0x8e, struct ntsync_signal_args)
 
 #define NTSYNC_IOC_SEM_RELEASE		_IOWR('N', 0x81, __u32)
 #define NTSYNC_IOC_MUTEX_UNLOCK		_IOWR('N', 0x85, struct ntsync_mutex_args)
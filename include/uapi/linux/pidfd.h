@@ -25,8 +25,10 @@
 #define PIDFD_INFO_CREDS		(1UL << 1) /* Always returned, even if not requested */
 #define PIDFD_INFO_CGROUPID		(1UL << 2) /* Always returned if available, even if not requested */
 #define PIDFD_INFO_EXIT			(1UL << 3) /* Only returned if requested. */
+#define PIDFD_INFO_STATS		(1UL << 31) /* Only returned if requested. */
 
 #define PIDFD_INFO_SIZE_VER0		64 /* sizeof first published struct */
+#define PIDFD_INFO_SIZE_STATS		160 /* add stats fields */
 
 /*
  * The concept of process and threads in userland and the kernel is a confusing
@@ -92,6 +94,25 @@ struct pidfd_info {
 	__u32 fsuid;
 	__u32 fsgid;
 	__s32 exit_code;
+	__u32 __spare1[2];
+	/*
+	 * PIDFD_INFO_STATS: the fields of /proc/<pid>/stat that monitoring
+	 * tools poll, for the whole thread group unless the pidfd was opened
+	 * with PIDFD_THREAD.  Times are in nanoseconds, sizes in bytes.
+	 */
+	__u64 utime;
+	__u64 stime;
+	__u64 start_time;	/* CLOCK_BOOTTIME */
+	__u64 min_flt;
+	__u64 maj_flt;
+	__u64 nvcsw;
+	__u64 nivcsw;
+	__u64 vsize;
+	__u64 rss;
+	__u32 nr_threads;
+	__s32 nice;
+	__u32 state;		/* as the state field of /proc/<pid>/stat */
+	__u32 processor;
 };
 
 #define PIDFS_IOCTL_MAGIC 0xFF
@@ -364,4 +364,21 @@ struct prctl_mm_map {
 # define PR_TIMER_CREATE_RESTORE_IDS_ON		1
 # define PR_TIMER_CREATE_RESTORE_IDS_GET	2
 
+/*
+ * Size the hash table of the PRIVATE futexes of the process.  The table is
+ * allocated on first use and can't be resized afterwards, 0 slots selects
+ * the global hash table.
+ */
+#define PR_FUTEX_HASH			78
+# define PR_FUTEX_HASH_SET_SLOTS	1
+# define PR_FUTEX_HASH_GET_SLOTS	2
+
+/*
+ * Allocate file descriptors of the calling thread from a small per-thread
+ * cache of reserved descriptors, instead of taking the file table lock for
+ * each.  The descriptors returned are no longer the lowest available ones.
+ */
+#define PR_SET_FD_CACHE			0x46444353	/* "FDCS" */
+#define PR_GET_FD_CACHE			0x46444347	/* "FDCG" */
+
 #endif /* _LINUX_PRCTL_H */
@@ -0,0 +1,58 @@
+/* SPDX-License-Identifier: GPL-2.0 WITH Linux-syscall-note */
+#ifndef _UAPI_LINUX_PSI_H
+#define _UAPI_LINUX_PSI_H
+
+#include <linux/types.h>
+
+/*
+ * PSI trigger event ring
+ *
+ * A privileged trigger created with the "ring" keyword, e.g.
+ *
+ *   echo "some 10000 50000 ring" > cpu.pressure
+ *
+ * records every event it generates in a ring buffer which can be mapped
+ * read-only by mmap()ing the first page of the trigger file. The ring is
+ * written by a single producer; readers keep their own tail:
+ *
+ *   head = __atomic_load_n(&hdr->head, __ATOMIC_ACQUIRE);
+ *   while (tail != head) {
+ *           ev = hdr->events[tail & (hdr->nr_events - 1)];
+ *           if (__atomic_load_n(&hdr->head, __ATOMIC_ACQUIRE) - tail >=
+ *               hdr->nr_events)
+ *                   tail = head - hdr->nr_events;  (ev was overwritten)
+ *           else
+ *                   consume(&ev), tail++;
+ *   }
+ *
+ * poll() keeps working as for any other trigger, so one poller can sleep
+ * on many trigger files and drain each ring without a read() per event.
+ */
+
+/**
+ * struct psi_ring_event - a single trigger event
+ * @time: sched_clock() timestamp of the event in ns
+ * @growth: stall time accumulated in the current window in ns
+ * @state: PSI state the trigger monitors (PSI_*_SOME or PSI_*_FULL)
+ */
+struct psi_ring_event {
+	__u64 time;
+	__u64 growth;
+	__u32 state;
+	__u32 __reserved;
+};
+
+/**
+ * struct psi_ring_header - the mapped ring
+ * @head: number of events ever recorded
+ * @nr_events: number of entries in @events, a power of two
+ * @events: event entries
+ */
+struct psi_ring_header {
+	__u32 head;
+	__u32 nr_events;
+	__u64 __reserved[7];
+	struct psi_ring_event events[];
+};
+
+#endif /* _UAPI_LINUX_PSI_H */
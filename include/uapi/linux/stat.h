@@ -188,6 +188,23 @@ struct statx {
 	/* 0x100 */
 };
 
+/*
+ * Directory entry returned by getdents64_statx(): a linux_dirent64 with the
+ * statx() of the entry, as by fstatat(dirfd, d_name, AT_SYMLINK_NOFOLLOW),
+ * between the header and the name.  If the entry could not be stat'ed,
+ * d_error is the negative error and d_stx is zeroed.
+ */
+struct linux_dirent64_statx {
+	__u64		d_ino;
+	__s64		d_off;
+	__u16		d_reclen;
+	__u8		d_type;
+	__u8		__pad;
+	__s32		d_error;
+	struct statx	d_stx;
+	char		d_name[];
+};
+
 /*
  * Flags to be stx_mask
  *
@@ -211,6 +211,22 @@
  */
 #define UBLK_F_USER_RECOVERY_FAIL_IO (1ULL << 9)
 
+/*
+ * The request buffer is registered into the io_uring fixed buffer table of
+ * the ublk server automatically before the request is delivered, so that
+ * no UBLK_U_IO_REGISTER_IO_BUF or UBLK_U_IO_UNREGISTER_IO_BUF command is
+ * needed for each IO.
+ *
+ * The buffer index is passed in `struct ublk_auto_buf_reg`, encoded into
+ * `ublksrv_io_cmd->addr` of FETCH_REQ and COMMIT_AND_FETCH_REQ, and the
+ * buffer is unregistered when the request is committed by
+ * COMMIT_AND_FETCH_REQ.  Both commands have to be issued on the io_uring
+ * which owns the buffer table.
+ *
+ * Requires UBLK_F_SUPPORT_ZERO_COPY, and can't be used with UBLK_F_ZONED.
+ */
+#define UBLK_F_AUTO_BUF_REG	(1ULL << 11)
+
 /* device state */
 #define UBLK_S_DEV_DEAD	0
 #define UBLK_S_DEV_LIVE	1
@@ -297,6 +313,12 @@ struct ublksrv_ctrl_dev_info {
 #define		UBLK_IO_F_FUA			(1U << 13)
 #define		UBLK_IO_F_NOUNMAP		(1U << 15)
 #define		UBLK_IO_F_SWAP			(1U << 16)
+/*
+ * UBLK_F_AUTO_BUF_REG with UBLK_AUTO_BUF_REG_FALLBACK: the request buffer
+ * couldn't be registered, and the ublk server has to register it with
+ * UBLK_U_IO_REGISTER_IO_BUF by itself
+ */
+#define		UBLK_IO_F_NEED_REG_BUF		(1U << 17)
 
 /*
  * io cmd is described by this structure, and stored in share memory, indexed
@@ -358,6 +380,41 @@ struct ublksrv_io_cmd {
 	};
 };
 
+/* encoded into ublksrv_io_cmd->addr in case of UBLK_F_AUTO_BUF_REG */
+struct ublk_auto_buf_reg {
+	/* index of the request buffer in the io_uring fixed buffer table */
+	__u16	index;
+
+/*
+ * Deliver the request with UBLK_IO_F_NEED_REG_BUF instead of failing it
+ * if the buffer can't be registered, e.g. because the index is in use.
+ */
+#define UBLK_AUTO_BUF_REG_FALLBACK	(1 << 0)
+#define UBLK_AUTO_BUF_REG_F_MASK	UBLK_AUTO_BUF_REG_FALLBACK
+	__u8	flags;
+	__u8	reserved0;
+	__u32	reserved1;
+};
+
+static inline __u64
+ublk_auto_buf_reg_to_sqe_addr(const struct ublk_auto_buf_reg *buf)
+{
+	return buf->index | ((__u64)buf->flags << 16) |
+		((__u64)buf->reserved0 << 24) | ((__u64)buf->reserved1 << 32);
+}
+
+static inline struct ublk_auto_buf_reg ublk_sqe_addr_to_auto_buf_reg(__u64 addr)
+{
+	struct ublk_auto_buf_reg reg = {
+		.index = (__u16)addr,
+		.flags = (__u8)(addr >> 16),
+		.reserved0 = (__u8)(addr >> 24),
+		.reserved1 = (__u32)(addr >> 32),
+	};
+
+	return reg;
+}
+
 struct ublk_param_basic {
 #define UBLK_ATTR_READ_ONLY            (1 << 0)
 #define UBLK_ATTR_ROTATIONAL           (1 << 1)
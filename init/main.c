@@ -1304,6 +1304,37 @@ static int __init ignore_unknown_bootoption(char *param, char *val,
 	return 0;
 }
 
+/*
+ * Run a level with initcall_debug and report how long it took as a whole and
+ * which initcall dominated it, i.e. where the serialized boot time goes and
+ * what is worth making asynchronous first.
+ */
+static void __init do_initcall_level_timed(int level)
+{
+	initcall_t slowest_fn = NULL;
+	s64 delta, slowest = -1;
+	ktime_t start, calltime;
+	initcall_entry_t *fn;
+
+	start = ktime_get();
+	for (fn = initcall_levels[level]; fn < initcall_levels[level+1]; fn++) {
+		initcall_t call = initcall_from_entry(fn);
+
+		calltime = ktime_get();
+		do_one_initcall(call);
+		delta = ktime_us_delta(ktime_get(), calltime);
+		if (delta > slowest) {
+			slowest = delta;
+			slowest_fn = call;
+		}
+	}
+
+	delta = ktime_us_delta(ktime_get(), start);
+	if (slowest_fn)
+		printk(KERN_DEBUG "initcall level %s took %lld usecs, slowest %pS after %lld usecs\n",
+		       initcall_level_names[level], delta, slowest_fn, slowest);
+}
+
 static void __init do_initcall_level(int level, char *command_line)
 {
 	initcall_entry_t *fn;
@@ -1315,8 +1346,13 @@ static void __init do_initcall_level(int level, char *command_line)
 		   NULL, ignore_unknown_bootoption);
 
 	trace_initcall_level(initcall_level_names[level]);
-	for (fn = initcall_levels[level]; fn < initcall_levels[level+1]; fn++)
-		do_one_initcall(initcall_from_entry(fn));
+	if (!initcall_debug) {
+		for (fn = initcall_levels[level]; fn < initcall_levels[level+1]; fn++)
+			do_one_initcall(initcall_from_entry(fn));
+		return;
+	}
+
+	do_initcall_level_timed(level);
 }
 
 static void __init do_initcalls(void)
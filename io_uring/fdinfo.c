@@ -14,6 +14,7 @@
 #include "fdinfo.h"
 #include "cancel.h"
 #include "rsrc.h"
+#include "tctx.h"
 
 #ifdef CONFIG_PROC_FS
 static __cold int io_uring_show_cred(struct seq_file *m, unsigned int id,
@@ -89,6 +90,7 @@ static inline void napi_show_fdinfo(struct io_ring_ctx *ctx,
 static void __io_uring_show_fdinfo(struct io_ring_ctx *ctx, struct seq_file *m)
 {
 	struct io_overflow_cqe *ocqe;
+	struct io_tctx_node *tnode;
 	struct io_rings *r = ctx->rings;
 	struct rusage sq_usage;
 	unsigned int sq_mask = ctx->sq_entries - 1, cq_mask = ctx->cq_entries - 1;
@@ -199,6 +201,9 @@ static void __io_uring_show_fdinfo(struct io_ring_ctx *ctx, struct seq_file *m)
 	seq_printf(m, "SqThreadCpu:\t%d\n", sq_cpu);
 	seq_printf(m, "SqTotalTime:\t%llu\n", sq_total_time);
 	seq_printf(m, "SqWorkTime:\t%llu\n", sq_work_time);
+	if (ctx->flags & IORING_SETUP_SQPOLL)
+		seq_printf(m, "SqRingWorkTime:\t%llu\n",
+			   div_u64(READ_ONCE(ctx->sq_work_time), NSEC_PER_USEC));
 	seq_printf(m, "UserFiles:\t%u\n", ctx->file_table.data.nr);
 	for (i = 0; i < ctx->file_table.data.nr; i++) {
 		struct file *f = NULL;
@@ -251,7 +256,19 @@ static void __io_uring_show_fdinfo(struct io_ring_ctx *ctx, struct seq_file *m)
 
 	}
 	spin_unlock(&ctx->completion_lock);
+
+	seq_puts(m, "IoWq:\n");
+	list_for_each_entry(tnode, &ctx->tctx_list, ctx_node) {
+		struct io_uring_task *tctx = tnode->task->io_uring;
+
+		/* the io_wq stays alive while we hold uring_lock */
+		if (!tctx || !tctx->io_wq)
+			continue;
+		seq_printf(m, " task=%d\n", task_pid_nr(tnode->task));
+		io_wq_show_fdinfo(tctx->io_wq, m);
+	}
 	napi_show_fdinfo(ctx, m);
+	io_lat_stats_show_fdinfo(ctx, m);
 }
 
 /*
@@ -17,6 +17,7 @@
 #include <linux/task_work.h>
 #include <linux/audit.h>
 #include <linux/mmu_context.h>
+#include <linux/seq_file.h>
 #include <uapi/linux/io_uring.h>
 
 #include "io-wq.h"
@@ -51,6 +52,8 @@ struct io_worker {
 	struct task_struct *task;
 	struct io_wq *wq;
 	struct io_wq_acct *acct;
+	/* node the worker is bound to, its own work is queued there */
+	int node;
 
 	struct io_wq_work *cur_work;
 	raw_spinlock_t lock;
@@ -75,6 +78,22 @@ struct io_worker {
 
 #define IO_WQ_NR_HASH_BUCKETS	(1u << IO_WQ_HASH_ORDER)
 
+/*
+ * Work of one acct queued from one NUMA node. Workers run the work of their
+ * own node first, and steal from the other nodes when that runs out.
+ */
+struct io_wq_queue {
+	raw_spinlock_t lock;
+	struct io_wq_work_list work_list;
+	unsigned long flags;
+
+	struct io_wq_work *hash_tail[IO_WQ_NR_HASH_BUCKETS];
+
+	/* work run by a worker of this node, and by one of another node */
+	unsigned long nr_local;
+	unsigned long nr_stolen;
+};
+
 struct io_wq_acct {
 	/**
 	 * Protects access to the worker lists.
@@ -97,9 +116,8 @@ struct io_wq_acct {
 	 */
 	struct list_head all_list;
 
-	raw_spinlock_t lock;
-	struct io_wq_work_list work_list;
-	unsigned long flags;
+	/* indexed by node, nr_node_ids entries */
+	struct io_wq_queue *queues;
 };
 
 enum {
@@ -130,8 +148,6 @@ struct io_wq {
 
 	struct wait_queue_entry wait;
 
-	struct io_wq_work *hash_tail[IO_WQ_NR_HASH_BUCKETS];
-
 	cpumask_var_t cpu_mask;
 };
 
@@ -145,7 +161,8 @@ struct io_cb_cancel_data {
 	bool cancel_all;
 };
 
-static bool create_io_worker(struct io_wq *wq, struct io_wq_acct *acct);
+static bool create_io_worker(struct io_wq *wq, struct io_wq_acct *acct,
+			     int node);
 static void io_wq_dec_running(struct io_worker *worker);
 static bool io_acct_cancel_pending_work(struct io_wq *wq,
 					struct io_wq_acct *acct,
@@ -180,6 +197,12 @@ static inline struct io_wq_acct *io_wq_get_acct(struct io_worker *worker)
 	return worker->acct;
 }
 
+static inline struct io_wq_queue *io_acct_queue(struct io_wq_acct *acct,
+						int node)
+{
+	return &acct->queues[node];
+}
+
 static void io_worker_ref_put(struct io_wq *wq)
 {
 	if (atomic_dec_and_test(&wq->worker_refs))
@@ -255,32 +278,39 @@ static void io_worker_exit(struct io_worker *worker)
 	do_exit(0);
 }
 
-static inline bool __io_acct_run_queue(struct io_wq_acct *acct)
+static inline bool __io_queue_run(struct io_wq_queue *q)
 {
-	return !test_bit(IO_ACCT_STALLED_BIT, &acct->flags) &&
-		!wq_list_empty(&acct->work_list);
+	return !test_bit(IO_ACCT_STALLED_BIT, &q->flags) &&
+		!wq_list_empty(&q->work_list);
 }
 
 /*
- * If there's work to do, returns true with acct->lock acquired. If not,
- * returns false with no lock held.
+ * Find work for a worker bound to @node, taking the work queued from its own
+ * node first and stealing from the other nodes otherwise. If there's work to
+ * do, returns its queue with q->lock acquired. If not, returns NULL with no
+ * lock held.
  */
-static inline bool io_acct_run_queue(struct io_wq_acct *acct)
-	__acquires(&acct->lock)
+static struct io_wq_queue *io_acct_run_queue(struct io_wq_acct *acct, int node)
 {
-	raw_spin_lock(&acct->lock);
-	if (__io_acct_run_queue(acct))
-		return true;
+	int i;
 
-	raw_spin_unlock(&acct->lock);
-	return false;
+	for (i = 0; i < nr_node_ids; i++) {
+		struct io_wq_queue *q;
+
+		q = io_acct_queue(acct, (node + i) % nr_node_ids);
+		if (i && !__io_queue_run(q))
+			continue;
+		raw_spin_lock(&q->lock);
+		if (__io_queue_run(q))
+			return q;
+		raw_spin_unlock(&q->lock);
+	}
+
+	return NULL;
 }
 
-/*
- * Check head of free list for an available worker. If one isn't available,
- * caller must create one.
- */
-static bool io_acct_activate_free_worker(struct io_wq_acct *acct)
+static bool __io_acct_activate_free_worker(struct io_wq_acct *acct, int node,
+					   bool local)
 	__must_hold(RCU)
 {
 	struct hlist_nulls_node *n;
@@ -292,6 +322,8 @@ static bool io_acct_activate_free_worker(struct io_wq_acct *acct)
 	 * of exiting, keep trying.
 	 */
 	hlist_nulls_for_each_entry_rcu(worker, n, &acct->free_list, nulls_node) {
+		if ((worker->node == node) != local)
+			continue;
 		if (!io_worker_get(worker))
 			continue;
 		/*
@@ -307,11 +339,23 @@ static bool io_acct_activate_free_worker(struct io_wq_acct *acct)
 	return false;
 }
 
+/*
+ * Check head of free list for an available worker, preferring one bound to
+ * @node. If one isn't available, caller must create one.
+ */
+static bool io_acct_activate_free_worker(struct io_wq_acct *acct, int node)
+	__must_hold(RCU)
+{
+	return __io_acct_activate_free_worker(acct, node, true) ||
+	       __io_acct_activate_free_worker(acct, node, false);
+}
+
 /*
  * We need a worker. If we find a free one, we're good. If not, and we're
  * below the max number of workers, create one.
  */
-static bool io_wq_create_worker(struct io_wq *wq, struct io_wq_acct *acct)
+static bool io_wq_create_worker(struct io_wq *wq, struct io_wq_acct *acct,
+				int node)
 {
 	/*
 	 * Most likely an attempt to queue unbounded work on an io_wq that
@@ -329,7 +373,7 @@ static bool io_wq_create_worker(struct io_wq *wq, struct io_wq_acct *acct)
 	raw_spin_unlock(&acct->workers_lock);
 	atomic_inc(&acct->nr_running);
 	atomic_inc(&wq->worker_refs);
-	return create_io_worker(wq, acct);
+	return create_io_worker(wq, acct, node);
 }
 
 static void io_wq_inc_running(struct io_worker *worker)
@@ -358,7 +402,7 @@ static void create_worker_cb(struct callback_head *cb)
 	}
 	raw_spin_unlock(&acct->workers_lock);
 	if (do_create) {
-		create_io_worker(wq, acct);
+		create_io_worker(wq, acct, worker->node);
 	} else {
 		atomic_dec(&acct->nr_running);
 		io_worker_ref_put(wq);
@@ -416,16 +460,18 @@ static void io_wq_dec_running(struct io_worker *worker)
 {
 	struct io_wq_acct *acct = io_wq_get_acct(worker);
 	struct io_wq *wq = worker->wq;
+	struct io_wq_queue *q;
 
 	if (!test_bit(IO_WORKER_F_UP, &worker->flags))
 		return;
 
 	if (!atomic_dec_and_test(&acct->nr_running))
 		return;
-	if (!io_acct_run_queue(acct))
+	q = io_acct_run_queue(acct, worker->node);
+	if (!q)
 		return;
 
-	raw_spin_unlock(&acct->lock);
+	raw_spin_unlock(&q->lock);
 	atomic_inc(&acct->nr_running);
 	atomic_inc(&wq->worker_refs);
 	io_queue_worker_create(worker, acct, create_worker_cb);
@@ -484,15 +530,15 @@ static bool io_wait_on_hash(struct io_wq *wq, unsigned int hash)
 	return ret;
 }
 
-static struct io_wq_work *io_get_next_work(struct io_wq_acct *acct,
+static struct io_wq_work *io_get_next_work(struct io_wq_queue *q,
 					   struct io_wq *wq)
-	__must_hold(acct->lock)
+	__must_hold(q->lock)
 {
 	struct io_wq_work_node *node, *prev;
 	struct io_wq_work *work, *tail;
 	unsigned int stall_hash = -1U;
 
-	wq_list_for_each(node, prev, &acct->work_list) {
+	wq_list_for_each(node, prev, &q->work_list) {
 		unsigned int work_flags;
 		unsigned int hash;
 
@@ -501,18 +547,18 @@ static struct io_wq_work *io_get_next_work(struct io_wq_acct *acct,
 		/* not hashed, can run anytime */
 		work_flags = atomic_read(&work->flags);
 		if (!__io_wq_is_hashed(work_flags)) {
-			wq_list_del(&acct->work_list, node, prev);
+			wq_list_del(&q->work_list, node, prev);
 			return work;
 		}
 
 		hash = __io_get_work_hash(work_flags);
 		/* all items with this hash lie in [work, tail] */
-		tail = wq->hash_tail[hash];
+		tail = q->hash_tail[hash];
 
 		/* hashed, can run if not already running */
 		if (!test_and_set_bit(hash, &wq->hash->map)) {
-			wq->hash_tail[hash] = NULL;
-			wq_list_cut(&acct->work_list, &tail->list, prev);
+			q->hash_tail[hash] = NULL;
+			wq_list_cut(&q->work_list, &tail->list, prev);
 			return work;
 		}
 		if (stall_hash == -1U)
@@ -528,12 +574,12 @@ static struct io_wq_work *io_get_next_work(struct io_wq_acct *acct,
 		 * Set this before dropping the lock to avoid racing with new
 		 * work being added and clearing the stalled bit.
 		 */
-		set_bit(IO_ACCT_STALLED_BIT, &acct->flags);
-		raw_spin_unlock(&acct->lock);
+		set_bit(IO_ACCT_STALLED_BIT, &q->flags);
+		raw_spin_unlock(&q->lock);
 		unstalled = io_wait_on_hash(wq, stall_hash);
-		raw_spin_lock(&acct->lock);
+		raw_spin_lock(&q->lock);
 		if (unstalled) {
-			clear_bit(IO_ACCT_STALLED_BIT, &acct->flags);
+			clear_bit(IO_ACCT_STALLED_BIT, &q->flags);
 			if (wq_has_sleeper(&wq->hash->wait))
 				wake_up(&wq->hash->wait);
 		}
@@ -556,14 +602,16 @@ static void io_assign_current_work(struct io_worker *worker,
 }
 
 /*
- * Called with acct->lock held, drops it before returning
+ * Called with q->lock held, drops it before returning
  */
 static void io_worker_handle_work(struct io_wq_acct *acct,
+				  struct io_wq_queue *q,
 				  struct io_worker *worker)
-	__releases(&acct->lock)
+	__releases(&q->lock)
 {
 	struct io_wq *wq = worker->wq;
 	bool do_kill = test_bit(IO_WQ_BIT_EXIT, &wq->state);
+	bool local = q == io_acct_queue(acct, worker->node);
 
 	do {
 		struct io_wq_work *work;
@@ -575,8 +623,12 @@ static void io_worker_handle_work(struct io_wq_acct *acct,
 		 * can't make progress, any work completion or insertion will
 		 * clear the stalled flag.
 		 */
-		work = io_get_next_work(acct, wq);
+		work = io_get_next_work(q, wq);
 		if (work) {
+			if (local)
+				q->nr_local++;
+			else
+				q->nr_stolen++;
 			/*
 			 * Make sure cancelation can find this, even before
 			 * it becomes the active work. That avoids a window
@@ -589,7 +641,7 @@ static void io_worker_handle_work(struct io_wq_acct *acct,
 			raw_spin_unlock(&worker->lock);
 		}
 
-		raw_spin_unlock(&acct->lock);
+		raw_spin_unlock(&q->lock);
 
 		if (!work)
 			break;
@@ -629,16 +681,17 @@ static void io_worker_handle_work(struct io_wq_acct *acct,
 				/* serialize hash clear with wake_up() */
 				spin_lock_irq(&wq->hash->wait.lock);
 				clear_bit(hash, &wq->hash->map);
-				clear_bit(IO_ACCT_STALLED_BIT, &acct->flags);
+				clear_bit(IO_ACCT_STALLED_BIT, &q->flags);
 				spin_unlock_irq(&wq->hash->wait.lock);
 				if (wq_has_sleeper(&wq->hash->wait))
 					wake_up(&wq->hash->wait);
 			}
 		} while (work);
 
-		if (!__io_acct_run_queue(acct))
+		/* go back to our own node's work after stealing one item */
+		if (!local || !__io_queue_run(q))
 			break;
-		raw_spin_lock(&acct->lock);
+		raw_spin_lock(&q->lock);
 	} while (1);
 }
 
@@ -649,6 +702,7 @@ static int io_wq_worker(void *data)
 	struct io_wq *wq = worker->wq;
 	bool exit_mask = false, last_timeout = false;
 	char buf[TASK_COMM_LEN] = {};
+	struct io_wq_queue *q;
 
 	set_mask_bits(&worker->flags, 0,
 		      BIT(IO_WORKER_F_UP) | BIT(IO_WORKER_F_RUNNING));
@@ -662,11 +716,11 @@ static int io_wq_worker(void *data)
 		set_current_state(TASK_INTERRUPTIBLE);
 
 		/*
-		 * If we have work to do, io_acct_run_queue() returns with
-		 * the acct->lock held. If not, it will drop it.
+		 * If we have work to do, io_acct_run_queue() returns its
+		 * queue with the lock held. If not, it will drop it.
 		 */
-		while (io_acct_run_queue(acct))
-			io_worker_handle_work(acct, worker);
+		while ((q = io_acct_run_queue(acct, worker->node)))
+			io_worker_handle_work(acct, q, worker);
 
 		raw_spin_lock(&acct->workers_lock);
 		/*
@@ -699,8 +753,9 @@ static int io_wq_worker(void *data)
 		}
 	}
 
-	if (test_bit(IO_WQ_BIT_EXIT, &wq->state) && io_acct_run_queue(acct))
-		io_worker_handle_work(acct, worker);
+	if (test_bit(IO_WQ_BIT_EXIT, &wq->state) &&
+	    (q = io_acct_run_queue(acct, worker->node)))
+		io_worker_handle_work(acct, q, worker);
 
 	io_worker_exit(worker);
 	return 0;
@@ -742,12 +797,34 @@ void io_wq_worker_sleeping(struct task_struct *tsk)
 	io_wq_dec_running(worker);
 }
 
+/*
+ * Keep a worker on the CPUs of its node, unless the io_wq isn't allowed to
+ * run on any of them.
+ */
+static void io_worker_set_affinity(struct io_wq *wq, struct io_worker *worker,
+				   struct task_struct *tsk)
+{
+	cpumask_var_t mask;
+
+	if (nr_node_ids > 1 && alloc_cpumask_var(&mask, GFP_KERNEL)) {
+		bool on_node = cpumask_and(mask, wq->cpu_mask,
+					   cpumask_of_node(worker->node));
+
+		if (on_node)
+			set_cpus_allowed_ptr(tsk, mask);
+		free_cpumask_var(mask);
+		if (on_node)
+			return;
+	}
+	set_cpus_allowed_ptr(tsk, wq->cpu_mask);
+}
+
 static void io_init_new_worker(struct io_wq *wq, struct io_wq_acct *acct, struct io_worker *worker,
 			       struct task_struct *tsk)
 {
 	tsk->worker_private = worker;
 	worker->task = tsk;
-	set_cpus_allowed_ptr(tsk, wq->cpu_mask);
+	io_worker_set_affinity(wq, worker, tsk);
 
 	raw_spin_lock(&acct->workers_lock);
 	hlist_nulls_add_head_rcu(&worker->nulls_node, &acct->free_list);
@@ -807,7 +884,7 @@ static void create_worker_cont(struct callback_head *cb)
 	clear_bit_unlock(0, &worker->create_state);
 	wq = worker->wq;
 	acct = io_wq_get_acct(worker);
-	tsk = create_io_thread(io_wq_worker, worker, NUMA_NO_NODE);
+	tsk = create_io_thread(io_wq_worker, worker, worker->node);
 	if (!IS_ERR(tsk)) {
 		io_init_new_worker(wq, acct, worker, tsk);
 		io_worker_release(worker);
@@ -848,7 +925,8 @@ static void io_workqueue_create(struct work_struct *work)
 		kfree(worker);
 }
 
-static bool create_io_worker(struct io_wq *wq, struct io_wq_acct *acct)
+static bool create_io_worker(struct io_wq *wq, struct io_wq_acct *acct,
+			     int node)
 {
 	struct io_worker *worker;
 	struct task_struct *tsk;
@@ -869,10 +947,11 @@ static bool create_io_worker(struct io_wq *wq, struct io_wq_acct *acct)
 	refcount_set(&worker->ref, 1);
 	worker->wq = wq;
 	worker->acct = acct;
+	worker->node = node;
 	raw_spin_lock_init(&worker->lock);
 	init_completion(&worker->ref_done);
 
-	tsk = create_io_thread(io_wq_worker, worker, NUMA_NO_NODE);
+	tsk = create_io_thread(io_wq_worker, worker, node);
 	if (!IS_ERR(tsk)) {
 		io_init_new_worker(wq, acct, worker, tsk);
 	} else if (!io_should_retry_thread(worker, PTR_ERR(tsk))) {
@@ -939,25 +1018,29 @@ static void io_run_cancel(struct io_wq_work *work, struct io_wq *wq)
 	} while (work);
 }
 
-static void io_wq_insert_work(struct io_wq *wq, struct io_wq_acct *acct,
-			      struct io_wq_work *work, unsigned int work_flags)
+/*
+ * Hashed work queued from different nodes ends up on different queues. It is
+ * still serialised by wq->hash->map, only the grouping by hash is per queue.
+ */
+static void io_wq_insert_work(struct io_wq_queue *q, struct io_wq_work *work,
+			      unsigned int work_flags)
 {
 	unsigned int hash;
 	struct io_wq_work *tail;
 
 	if (!__io_wq_is_hashed(work_flags)) {
 append:
-		wq_list_add_tail(&work->list, &acct->work_list);
+		wq_list_add_tail(&work->list, &q->work_list);
 		return;
 	}
 
 	hash = __io_get_work_hash(work_flags);
-	tail = wq->hash_tail[hash];
-	wq->hash_tail[hash] = work;
+	tail = q->hash_tail[hash];
+	q->hash_tail[hash] = work;
 	if (!tail)
 		goto append;
 
-	wq_list_add_after(&work->list, &tail->list, &acct->work_list);
+	wq_list_add_after(&work->list, &tail->list, &q->work_list);
 }
 
 static bool io_wq_work_match_item(struct io_wq_work *work, void *data)
@@ -974,6 +1057,8 @@ void io_wq_enqueue(struct io_wq *wq, struct io_wq_work *work)
 		.data		= work,
 		.cancel_all	= false,
 	};
+	int node = numa_node_id();
+	struct io_wq_queue *q = io_acct_queue(acct, node);
 	bool do_create;
 
 	/*
@@ -986,20 +1071,20 @@ void io_wq_enqueue(struct io_wq *wq, struct io_wq_work *work)
 		return;
 	}
 
-	raw_spin_lock(&acct->lock);
-	io_wq_insert_work(wq, acct, work, work_flags);
-	clear_bit(IO_ACCT_STALLED_BIT, &acct->flags);
-	raw_spin_unlock(&acct->lock);
+	raw_spin_lock(&q->lock);
+	io_wq_insert_work(q, work, work_flags);
+	clear_bit(IO_ACCT_STALLED_BIT, &q->flags);
+	raw_spin_unlock(&q->lock);
 
 	rcu_read_lock();
-	do_create = !io_acct_activate_free_worker(acct);
+	do_create = !io_acct_activate_free_worker(acct, node);
 	rcu_read_unlock();
 
 	if (do_create && ((work_flags & IO_WQ_WORK_CONCURRENT) ||
 	    !atomic_read(&acct->nr_running))) {
 		bool did_create;
 
-		did_create = io_wq_create_worker(wq, acct);
+		did_create = io_wq_create_worker(wq, acct, node);
 		if (likely(did_create))
 			return;
 
@@ -1056,45 +1141,59 @@ static bool io_wq_worker_cancel(struct io_worker *worker, void *data)
 	return match->nr_running && !match->cancel_all;
 }
 
-static inline void io_wq_remove_pending(struct io_wq *wq,
-					struct io_wq_acct *acct,
-					 struct io_wq_work *work,
-					 struct io_wq_work_node *prev)
+static inline void io_wq_remove_pending(struct io_wq_queue *q,
+					struct io_wq_work *work,
+					struct io_wq_work_node *prev)
 {
 	unsigned int hash = io_get_work_hash(work);
 	struct io_wq_work *prev_work = NULL;
 
-	if (io_wq_is_hashed(work) && work == wq->hash_tail[hash]) {
+	if (io_wq_is_hashed(work) && work == q->hash_tail[hash]) {
 		if (prev)
 			prev_work = container_of(prev, struct io_wq_work, list);
 		if (prev_work && io_get_work_hash(prev_work) == hash)
-			wq->hash_tail[hash] = prev_work;
+			q->hash_tail[hash] = prev_work;
 		else
-			wq->hash_tail[hash] = NULL;
+			q->hash_tail[hash] = NULL;
 	}
-	wq_list_del(&acct->work_list, &work->list, prev);
+	wq_list_del(&q->work_list, &work->list, prev);
 }
 
-static bool io_acct_cancel_pending_work(struct io_wq *wq,
-					struct io_wq_acct *acct,
-					struct io_cb_cancel_data *match)
+static bool io_queue_cancel_pending_work(struct io_wq *wq,
+					 struct io_wq_queue *q,
+					 struct io_cb_cancel_data *match)
 {
 	struct io_wq_work_node *node, *prev;
 	struct io_wq_work *work;
 
-	raw_spin_lock(&acct->lock);
-	wq_list_for_each(node, prev, &acct->work_list) {
+	raw_spin_lock(&q->lock);
+	wq_list_for_each(node, prev, &q->work_list) {
 		work = container_of(node, struct io_wq_work, list);
 		if (!match->fn(work, match->data))
 			continue;
-		io_wq_remove_pending(wq, acct, work, prev);
-		raw_spin_unlock(&acct->lock);
+		io_wq_remove_pending(q, work, prev);
+		raw_spin_unlock(&q->lock);
 		io_run_cancel(work, wq);
 		match->nr_pending++;
 		/* not safe to continue after unlock */
 		return true;
 	}
-	raw_spin_unlock(&acct->lock);
+	raw_spin_unlock(&q->lock);
+
+	return false;
+}
+
+static bool io_acct_cancel_pending_work(struct io_wq *wq,
+					struct io_wq_acct *acct,
+					struct io_cb_cancel_data *match)
+{
+	int node;
+
+	for (node = 0; node < nr_node_ids; node++) {
+		if (io_queue_cancel_pending_work(wq, io_acct_queue(acct, node),
+						 match))
+			return true;
+	}
 
 	return false;
 }
@@ -1175,7 +1274,7 @@ static int io_wq_hash_wake(struct wait_queue_entry *wait, unsigned mode,
 			    int sync, void *key)
 {
 	struct io_wq *wq = container_of(wait, struct io_wq, wait);
-	int i;
+	int i, node;
 
 	list_del_init(&wait->entry);
 
@@ -1183,16 +1282,26 @@ static int io_wq_hash_wake(struct wait_queue_entry *wait, unsigned mode,
 	for (i = 0; i < IO_WQ_ACCT_NR; i++) {
 		struct io_wq_acct *acct = &wq->acct[i];
 
-		if (test_and_clear_bit(IO_ACCT_STALLED_BIT, &acct->flags))
-			io_acct_activate_free_worker(acct);
+		for (node = 0; node < nr_node_ids; node++) {
+			struct io_wq_queue *q = io_acct_queue(acct, node);
+
+			if (test_and_clear_bit(IO_ACCT_STALLED_BIT, &q->flags))
+				io_acct_activate_free_worker(acct, node);
+		}
 	}
 	rcu_read_unlock();
 	return 1;
 }
 
+static void io_wq_free_queues(struct io_wq *wq)
+{
+	for (int i = 0; i < IO_WQ_ACCT_NR; i++)
+		kfree(wq->acct[i].queues);
+}
+
 struct io_wq *io_wq_create(unsigned bounded, struct io_wq_data *data)
 {
-	int ret, i;
+	int ret, i, node;
 	struct io_wq *wq;
 
 	if (WARN_ON_ONCE(!data->free_work || !data->do_work))
@@ -1228,8 +1337,16 @@ struct io_wq *io_wq_create(unsigned bounded, struct io_wq_data *data)
 		INIT_HLIST_NULLS_HEAD(&acct->free_list, 0);
 		INIT_LIST_HEAD(&acct->all_list);
 
-		INIT_WQ_LIST(&acct->work_list);
-		raw_spin_lock_init(&acct->lock);
+		acct->queues = kcalloc(nr_node_ids, sizeof(*acct->queues),
+				       GFP_KERNEL);
+		if (!acct->queues)
+			goto err;
+		for (node = 0; node < nr_node_ids; node++) {
+			struct io_wq_queue *q = io_acct_queue(acct, node);
+
+			INIT_WQ_LIST(&q->work_list);
+			raw_spin_lock_init(&q->lock);
+		}
 	}
 
 	wq->task = get_task_struct(data->task);
@@ -1245,6 +1362,7 @@ struct io_wq *io_wq_create(unsigned bounded, struct io_wq_data *data)
 err:
 	io_wq_put_hash(data->hash);
 	free_cpumask_var(wq->cpu_mask);
+	io_wq_free_queues(wq);
 	kfree(wq);
 	return ERR_PTR(ret);
 }
@@ -1314,6 +1432,7 @@ static void io_wq_destroy(struct io_wq *wq)
 	io_wq_cancel_pending_work(wq, &match);
 	free_cpumask_var(wq->cpu_mask);
 	io_wq_put_hash(wq->hash);
+	io_wq_free_queues(wq);
 	kfree(wq);
 }
 
@@ -1435,6 +1554,35 @@ int io_wq_max_workers(struct io_wq *wq, int *new_count)
 	return 0;
 }
 
+/*
+ * Show the workers bound to each node, and how much of the work queued from
+ * a node was run there vs stolen by a worker of another node.
+ */
+void io_wq_show_fdinfo(struct io_wq *wq, struct seq_file *m)
+{
+	static const char * const names[] = { "bound", "unbound" };
+
+	for (int i = 0; i < IO_WQ_ACCT_NR; i++) {
+		struct io_wq_acct *acct = &wq->acct[i];
+		int node;
+
+		for_each_online_node(node) {
+			struct io_wq_queue *q = io_acct_queue(acct, node);
+			struct io_worker *worker;
+			unsigned int nr = 0;
+
+			rcu_read_lock();
+			list_for_each_entry_rcu(worker, &acct->all_list, all_list)
+				nr += worker->node == node;
+			rcu_read_unlock();
+
+			seq_printf(m, "  %s node%d: workers=%u local=%lu stolen=%lu\n",
+				   names[i], node, nr, READ_ONCE(q->nr_local),
+				   READ_ONCE(q->nr_stolen));
+		}
+	}
+}
+
 static __init int io_wq_init(void)
 {
 	int ret;
@@ -346,6 +346,8 @@ static __cold struct io_ring_ctx *io_ring_ctx_alloc(struct io_uring_params *p)
 		goto free_ref;
 	init_completion(&ctx->ref_comp);
 	xa_init_flags(&ctx->personalities, XA_FLAGS_ALLOC1);
+	xa_init_flags(&ctx->zcrx_ctxs, XA_FLAGS_ALLOC);
+	xa_init(&ctx->notif_streams);
 	mutex_init(&ctx->uring_lock);
 	init_waitqueue_head(&ctx->cq_wait);
 	init_waitqueue_head(&ctx->poll_wq);
@@ -1007,6 +1009,30 @@ static void __io_req_find_next_prep(struct io_kiocb *req)
 	spin_unlock(&ctx->completion_lock);
 }
 
+/*
+ * Hand the result of @req to the requests following it that asked for it. A
+ * length only goes to the next request, while an fd goes to all consecutive
+ * IORING_FD_LINK_RES users, so that e.g. both a read and a close after an
+ * openat get the new file. The links after @nxt haven't been issued yet.
+ */
+static void io_req_pass_link_res(struct io_kiocb *req, struct io_kiocb *nxt)
+{
+	s32 res = req->cqe.res;
+
+	if (nxt->flags & REQ_F_LINK_LEN)
+		nxt->cqe.res = res;
+	if (req->flags & REQ_F_LINK_FD)
+		return;
+
+	for (; nxt; nxt = nxt->link) {
+		if (nxt->opcode == IORING_OP_LINK_TIMEOUT)
+			continue;
+		if (!(nxt->flags & REQ_F_LINK_FD))
+			break;
+		nxt->cqe.fd = res;
+	}
+}
+
 static inline struct io_kiocb *io_req_find_next(struct io_kiocb *req)
 {
 	struct io_kiocb *nxt;
@@ -1021,6 +1047,8 @@ static inline struct io_kiocb *io_req_find_next(struct io_kiocb *req)
 		__io_req_find_next_prep(req);
 	nxt = req->link;
 	req->link = NULL;
+	if (nxt && unlikely(nxt->flags & (REQ_F_LINK_FD | REQ_F_LINK_LEN)))
+		io_req_pass_link_res(req, nxt);
 	return nxt;
 }
 
@@ -1829,6 +1857,9 @@ void io_wq_submit_work(struct io_wq_work *work)
 	bool needs_poll = false;
 	int ret = 0, err = -ECANCELED;
 
+	if (unlikely(req->flags & REQ_F_LAT_STATS))
+		io_lat_stats_iowq(req);
+
 	/* one will be dropped by ->io_wq_free_work() after returning to io-wq */
 	if (!(req->flags & REQ_F_REFCOUNT))
 		__io_req_set_refcount(req, 2);
@@ -2069,6 +2100,7 @@ static int io_init_req(struct io_ring_ctx *ctx, struct io_kiocb *req,
 	req->file = NULL;
 	req->tctx = current->io_uring;
 	req->cancel_seq_set = false;
+	io_lat_stats_start(ctx, req);
 
 	if (unlikely(opcode >= IORING_OP_LAST)) {
 		req->opcode = 0;
@@ -2117,6 +2149,11 @@ static int io_init_req(struct io_ring_ctx *ctx, struct io_kiocb *req,
 		struct io_submit_state *state = &ctx->submit_state;
 
 		req->cqe.fd = READ_ONCE(sqe->fd);
+		if (unlikely(req->cqe.fd == IORING_FD_LINK_RES)) {
+			if (!io_submit_in_link(ctx))
+				return io_init_fail_req(req, -EINVAL);
+			req->flags |= REQ_F_LINK_FD;
+		}
 
 		/*
 		 * Plug now if we have more than 2 IO left after this, and the
@@ -2737,6 +2774,7 @@ static __cold void io_ring_ctx_free(struct io_ring_ctx *ctx)
 	io_sqe_buffers_unregister(ctx);
 	io_sqe_files_unregister(ctx);
 	io_unregister_zcrx_ifqs(ctx);
+	io_notif_streams_free(ctx);
 	io_cqring_overflow_kill(ctx);
 	io_eventfd_unregister(ctx);
 	io_free_alloc_caches(ctx);
@@ -2765,6 +2803,7 @@ static __cold void io_ring_ctx_free(struct io_ring_ctx *ctx)
 	if (ctx->hash_map)
 		io_wq_put_hash(ctx->hash_map);
 	io_napi_free(ctx);
+	io_lat_stats_free(ctx);
 	kvfree(ctx->cancel_table.hbs);
 	xa_destroy(&ctx->io_bl_xa);
 	kfree(ctx);
@@ -2896,7 +2935,7 @@ static __cold void io_ring_exit_work(struct work_struct *work)
 			io_cqring_overflow_kill(ctx);
 			mutex_unlock(&ctx->uring_lock);
 		}
-		if (ctx->ifq) {
+		if (!xa_empty(&ctx->zcrx_ctxs)) {
 			mutex_lock(&ctx->uring_lock);
 			io_shutdown_zcrx_ifqs(ctx);
 			mutex_unlock(&ctx->uring_lock);
@@ -3762,7 +3801,8 @@ static __cold int io_uring_create(unsigned entries, struct io_uring_params *p,
 			IORING_FEAT_RSRC_TAGS | IORING_FEAT_CQE_SKIP |
 			IORING_FEAT_LINKED_FILE | IORING_FEAT_REG_REG_RING |
 			IORING_FEAT_RECVSEND_BUNDLE | IORING_FEAT_MIN_TIMEOUT |
-			IORING_FEAT_RW_ATTR | IORING_FEAT_NO_IOWAIT;
+			IORING_FEAT_RW_ATTR | IORING_FEAT_NO_IOWAIT |
+			IORING_FEAT_LINK_RES;
 
 	if (copy_to_user(params, p, sizeof(*p))) {
 		ret = -EFAULT;
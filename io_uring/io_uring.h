@@ -13,6 +13,7 @@
 #include "slist.h"
 #include "filetable.h"
 #include "opdef.h"
+#include "latstats.h"
 
 #ifndef CREATE_TRACE_POINTS
 #include <trace/events/io_uring.h>
@@ -148,6 +149,15 @@ static inline void io_lockdep_assert_cq_locked(struct io_ring_ctx *ctx)
 #endif
 }
 
+/*
+ * Whether the request being submitted joins a link chain, i.e. has a previous
+ * request to take IORING_FD_LINK_RES or IORING_LEN_LINK_RES from.
+ */
+static inline bool io_submit_in_link(struct io_ring_ctx *ctx)
+{
+	return ctx->submit_state.link.head != NULL;
+}
+
 static inline bool io_is_compat(struct io_ring_ctx *ctx)
 {
 	return IS_ENABLED(CONFIG_COMPAT) && unlikely(ctx->compat);
@@ -206,6 +216,9 @@ static __always_inline bool io_fill_cqe_req(struct io_ring_ctx *ctx,
 {
 	struct io_uring_cqe *cqe;
 
+	if (unlikely(req->flags & REQ_F_LAT_STATS))
+		io_lat_stats_complete(ctx, req);
+
 	/*
 	 * If we can't get a cq entry, userspace overflowed the
 	 * submission (by quite a lot). Increment the overflow count in
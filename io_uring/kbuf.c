@@ -84,6 +84,7 @@ static int io_buffer_add_list(struct io_ring_ctx *ctx,
 	 * always under the ->uring_lock, but lookups from mmap do.
 	 */
 	bl->bgid = bgid;
+	bl->sel_bgid = bgid;
 	guard(mutex)(&ctx->mmap_lock);
 	return xa_err(xa_store(&ctx->io_bl_xa, bgid, bl, GFP_KERNEL));
 }
@@ -192,8 +193,65 @@ static void __user *io_ring_buffer_select(struct io_kiocb *req, size_t *len,
 	return ret;
 }
 
+/*
+ * Pick the tier of a tiered group to take a buffer from: the first one, in
+ * order of increasing buffer size, whose next buffer fits @want bytes, or
+ * if none does or @want is unknown, the largest non-empty one. With all of
+ * them empty, any tier will do to fail the selection with -ENOBUFS.
+ */
+static struct io_buffer_list *io_buffer_pick_tier(struct io_ring_ctx *ctx,
+						  struct io_buffer_list *tbl,
+						  size_t want)
+{
+	struct io_buffer_list *bl, *largest = NULL, *first = NULL;
+	int i;
+
+	for (i = 0; i < tbl->nr_tiers; i++) {
+		struct io_uring_buf *buf;
+
+		bl = io_buffer_get_list(ctx, tbl->tiers[i]);
+		/* tiers can't be unregistered while grouped, but be careful */
+		if (!bl || !(bl->flags & IOBL_BUF_RING) ||
+		    bl->sel_bgid != tbl->bgid)
+			continue;
+		if (!first)
+			first = bl;
+		if (smp_load_acquire(&bl->buf_ring->tail) == bl->head)
+			continue;
+		largest = bl;
+		if (!want)
+			continue;
+		buf = io_ring_head_to_buf(bl->buf_ring, bl->head, bl->mask);
+		if (READ_ONCE(buf->len) >= want)
+			return bl;
+	}
+	return largest ?: first;
+}
+
+static struct io_buffer_list *io_buffer_get_sel_list(struct io_kiocb *req,
+						     size_t want)
+{
+	struct io_ring_ctx *ctx = req->ctx;
+	struct io_buffer_list *bl;
+
+	bl = io_buffer_get_list(ctx, req->buf_index);
+	if (bl && unlikely(bl->flags & IOBL_TIERED))
+		bl = io_buffer_pick_tier(ctx, bl, want);
+	return bl;
+}
+
 void __user *io_buffer_select(struct io_kiocb *req, size_t *len,
 			      unsigned int issue_flags)
+{
+	return io_buffer_select_fit(req, len, *len, issue_flags);
+}
+
+/*
+ * Like io_buffer_select(), but with a hint of how much data is expected,
+ * which chooses the tier if the group is tiered.
+ */
+void __user *io_buffer_select_fit(struct io_kiocb *req, size_t *len,
+				  size_t want, unsigned int issue_flags)
 {
 	struct io_ring_ctx *ctx = req->ctx;
 	struct io_buffer_list *bl;
@@ -201,7 +259,7 @@ void __user *io_buffer_select(struct io_kiocb *req, size_t *len,
 
 	io_ring_submit_lock(req->ctx, issue_flags);
 
-	bl = io_buffer_get_list(ctx, req->buf_index);
+	bl = io_buffer_get_sel_list(req, want);
 	if (likely(bl)) {
 		if (bl->flags & IOBL_BUF_RING)
 			ret = io_ring_buffer_select(req, len, bl, issue_flags);
@@ -306,7 +364,7 @@ int io_buffers_select(struct io_kiocb *req, struct buf_sel_arg *arg,
 	int ret = -ENOENT;
 
 	io_ring_submit_lock(ctx, issue_flags);
-	bl = io_buffer_get_list(ctx, req->buf_index);
+	bl = io_buffer_get_sel_list(req, arg->max_len);
 	if (unlikely(!bl))
 		goto out_unlock;
 
@@ -339,7 +397,7 @@ int io_buffers_peek(struct io_kiocb *req, struct buf_sel_arg *arg)
 
 	lockdep_assert_held(&ctx->uring_lock);
 
-	bl = io_buffer_get_list(ctx, req->buf_index);
+	bl = io_buffer_get_sel_list(req, arg->max_len);
 	if (unlikely(!bl))
 		return -ENOENT;
 
@@ -361,7 +419,7 @@ static inline bool __io_put_kbuf_ring(struct io_kiocb *req, int len, int nr)
 
 	if (bl) {
 		ret = io_kbuf_commit(req, bl, len, nr);
-		req->buf_index = bl->bgid;
+		req->buf_index = bl->sel_bgid;
 	}
 	req->flags &= ~REQ_F_BUFFER_RING;
 	return ret;
@@ -483,7 +541,7 @@ int io_remove_buffers(struct io_kiocb *req, unsigned int issue_flags)
 	if (bl) {
 		ret = -EINVAL;
 		/* can't use provide/remove buffers command on mapped buffers */
-		if (!(bl->flags & IOBL_BUF_RING))
+		if (!(bl->flags & (IOBL_BUF_RING | IOBL_TIERED)))
 			ret = __io_remove_buffers(ctx, bl, p->nbufs);
 	}
 	io_ring_submit_unlock(ctx, issue_flags);
@@ -580,7 +638,7 @@ int io_provide_buffers(struct io_kiocb *req, unsigned int issue_flags)
 		}
 	}
 	/* can't add buffers via this command for a mapped buffer ring */
-	if (bl->flags & IOBL_BUF_RING) {
+	if (bl->flags & (IOBL_BUF_RING | IOBL_TIERED)) {
 		ret = -EINVAL;
 		goto err;
 	}
@@ -623,7 +681,8 @@ int io_register_pbuf_ring(struct io_ring_ctx *ctx, void __user *arg)
 	bl = io_buffer_get_list(ctx, reg.bgid);
 	if (bl) {
 		/* if mapped buffer ring OR classic exists, don't allow */
-		if (bl->flags & IOBL_BUF_RING || !list_empty(&bl->buf_list))
+		if (bl->flags & (IOBL_BUF_RING | IOBL_TIERED) ||
+		    !list_empty(&bl->buf_list))
 			return -EEXIST;
 		io_destroy_bl(ctx, bl);
 	}
@@ -677,6 +736,20 @@ int io_register_pbuf_ring(struct io_ring_ctx *ctx, void __user *arg)
 	return ret;
 }
 
+static void io_release_tiers(struct io_ring_ctx *ctx,
+			     struct io_buffer_list *tbl)
+{
+	struct io_buffer_list *bl;
+	int i;
+
+	for (i = 0; i < tbl->nr_tiers; i++) {
+		bl = io_buffer_get_list(ctx, tbl->tiers[i]);
+		if (bl && bl->sel_bgid == tbl->bgid)
+			bl->sel_bgid = bl->bgid;
+	}
+	tbl->nr_tiers = 0;
+}
+
 int io_unregister_pbuf_ring(struct io_ring_ctx *ctx, void __user *arg)
 {
 	struct io_uring_buf_reg reg;
@@ -694,8 +767,14 @@ int io_unregister_pbuf_ring(struct io_ring_ctx *ctx, void __user *arg)
 	bl = io_buffer_get_list(ctx, reg.bgid);
 	if (!bl)
 		return -ENOENT;
-	if (!(bl->flags & IOBL_BUF_RING))
+	if (bl->flags & IOBL_TIERED) {
+		io_release_tiers(ctx, bl);
+	} else if (!(bl->flags & IOBL_BUF_RING)) {
 		return -EINVAL;
+	} else if (bl->sel_bgid != bl->bgid) {
+		/* still a tier of a group */
+		return -EBUSY;
+	}
 
 	scoped_guard(mutex, &ctx->mmap_lock)
 		xa_erase(&ctx->io_bl_xa, bl->bgid);
@@ -730,6 +809,54 @@ int io_register_pbuf_status(struct io_ring_ctx *ctx, void __user *arg)
 	return 0;
 }
 
+int io_register_pbuf_tiers(struct io_ring_ctx *ctx, void __user *arg)
+{
+	struct io_uring_buf_tiers reg;
+	struct io_buffer_list *tbl, *bl;
+	int i, ret;
+
+	lockdep_assert_held(&ctx->uring_lock);
+
+	if (copy_from_user(&reg, arg, sizeof(reg)))
+		return -EFAULT;
+	if (reg.resv[0] || reg.resv[1] || reg.resv[2])
+		return -EINVAL;
+	if (!reg.nr_tiers || reg.nr_tiers > IO_URING_BUF_MAX_TIERS)
+		return -EINVAL;
+	if (io_buffer_get_list(ctx, reg.bgid))
+		return -EEXIST;
+
+	for (i = 0; i < reg.nr_tiers; i++) {
+		bl = io_buffer_get_list(ctx, reg.tiers[i]);
+		if (!bl)
+			return -ENOENT;
+		/* tiers must be plain rings, not shared between groups */
+		if (!(bl->flags & IOBL_BUF_RING) || bl->sel_bgid != bl->bgid)
+			return -EINVAL;
+	}
+
+	tbl = kzalloc(sizeof(*tbl), GFP_KERNEL_ACCOUNT);
+	if (!tbl)
+		return -ENOMEM;
+	INIT_LIST_HEAD(&tbl->buf_list);
+	tbl->flags = IOBL_TIERED;
+	ret = io_buffer_add_list(ctx, tbl, reg.bgid);
+	if (ret) {
+		kfree(tbl);
+		return ret;
+	}
+
+	for (i = 0; i < reg.nr_tiers; i++) {
+		bl = io_buffer_get_list(ctx, reg.tiers[i]);
+		/* a duplicate is already ours */
+		if (bl->sel_bgid == tbl->bgid)
+			continue;
+		bl->sel_bgid = tbl->bgid;
+		tbl->tiers[tbl->nr_tiers++] = reg.tiers[i];
+	}
+	return 0;
+}
+
 struct io_mapped_region *io_pbuf_get_region(struct io_ring_ctx *ctx,
 					    unsigned int bgid)
 {
@@ -10,6 +10,8 @@ enum {
 	IOBL_BUF_RING	= 1,
 	/* buffers are consumed incrementally rather than always fully */
 	IOBL_INC	= 2,
+	/* no buffers of its own, selects from one of ->tiers */
+	IOBL_TIERED	= 4,
 };
 
 struct io_buffer_list {
@@ -22,6 +24,8 @@ struct io_buffer_list {
 		struct io_uring_buf_ring *buf_ring;
 	};
 	__u16 bgid;
+	/* group requests go back to on recycle, the tiered group if a tier */
+	__u16 sel_bgid;
 
 	/* below is for ring provided buffers */
 	__u16 buf_nr_pages;
@@ -31,6 +35,10 @@ struct io_buffer_list {
 
 	__u16 flags;
 
+	/* IOBL_TIERED */
+	__u16 nr_tiers;
+	__u16 tiers[IO_URING_BUF_MAX_TIERS];
+
 	struct io_mapped_region region;
 };
 
@@ -60,6 +68,8 @@ struct buf_sel_arg {
 
 void __user *io_buffer_select(struct io_kiocb *req, size_t *len,
 			      unsigned int issue_flags);
+void __user *io_buffer_select_fit(struct io_kiocb *req, size_t *len,
+				  size_t want, unsigned int issue_flags);
 int io_buffers_select(struct io_kiocb *req, struct buf_sel_arg *arg,
 		      unsigned int issue_flags);
 int io_buffers_peek(struct io_kiocb *req, struct buf_sel_arg *arg);
@@ -74,6 +84,7 @@ int io_provide_buffers(struct io_kiocb *req, unsigned int issue_flags);
 int io_register_pbuf_ring(struct io_ring_ctx *ctx, void __user *arg);
 int io_unregister_pbuf_ring(struct io_ring_ctx *ctx, void __user *arg);
 int io_register_pbuf_status(struct io_ring_ctx *ctx, void __user *arg);
+int io_register_pbuf_tiers(struct io_ring_ctx *ctx, void __user *arg);
 
 bool io_kbuf_recycle_legacy(struct io_kiocb *req, unsigned issue_flags);
 void io_kbuf_drop_legacy(struct io_kiocb *req);
@@ -95,7 +106,7 @@ static inline bool io_kbuf_recycle_ring(struct io_kiocb *req)
 	 * to monopolize the buffer.
 	 */
 	if (req->buf_list) {
-		req->buf_index = req->buf_list->bgid;
+		req->buf_index = req->buf_list->sel_bgid;
 		req->flags &= ~(REQ_F_BUFFER_RING|REQ_F_BUFFERS_COMMIT);
 		return true;
 	}
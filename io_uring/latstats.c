@@ -0,0 +1,180 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Per-opcode latency histograms, see IORING_REGISTER_LAT_STATS.
+ *
+ * Requests are stamped at submission while collection is enabled. The
+ * completion histogram is updated when the CQE is filled, which is
+ * serialised by the CQ lock, so plain counters do. The io-wq histogram is
+ * updated by workers running in parallel and uses atomics. Requests posting
+ * no CQE (IOSQE_CQE_SKIP_SUCCESS) are not accounted in the former.
+ */
+#include <linux/kernel.h>
+#include <linux/errno.h>
+#include <linux/slab.h>
+#include <linux/log2.h>
+#include <linux/seq_file.h>
+#include <linux/io_uring.h>
+
+#include <uapi/linux/io_uring.h>
+
+#include "io_uring.h"
+#include "latstats.h"
+
+struct io_lat_stats {
+	u64		complete[IORING_OP_LAST][IO_URING_LAT_BUCKETS];
+	atomic64_t	iowq[IORING_OP_LAST][IO_URING_LAT_BUCKETS];
+};
+
+static unsigned int io_lat_bucket(struct io_kiocb *req)
+{
+	u64 delta = ktime_get_ns() - req->lat_start;
+
+	if (!delta)
+		return 0;
+	return min_t(unsigned int, ilog2(delta), IO_URING_LAT_BUCKETS - 1);
+}
+
+void io_lat_stats_complete(struct io_ring_ctx *ctx, struct io_kiocb *req)
+{
+	io_lockdep_assert_cq_locked(ctx);
+
+	/* once per request, a failed CQE fill may be retried */
+	req->flags &= ~REQ_F_LAT_STATS;
+	ctx->lat_stats->complete[req->opcode][io_lat_bucket(req)]++;
+}
+
+void io_lat_stats_iowq(struct io_kiocb *req)
+{
+	struct io_lat_stats *stats = req->ctx->lat_stats;
+
+	atomic64_inc(&stats->iowq[req->opcode][io_lat_bucket(req)]);
+}
+
+static int io_lat_stats_get(struct io_ring_ctx *ctx,
+			    struct io_uring_lat_stats_reg *reg)
+{
+	struct io_uring_lat_hist __user *uhist = u64_to_user_ptr(reg->addr);
+	struct io_lat_stats *stats = ctx->lat_stats;
+	struct io_uring_lat_hist hist;
+	unsigned int op, i;
+
+	if (reg->nr_ops < IORING_OP_LAST)
+		return -EOVERFLOW;
+
+	for (op = 0; op < IORING_OP_LAST; op++) {
+		if (!stats) {
+			memset(&hist, 0, sizeof(hist));
+		} else {
+			for (i = 0; i < IO_URING_LAT_BUCKETS; i++) {
+				hist.complete[i] = READ_ONCE(stats->complete[op][i]);
+				hist.iowq[i] = atomic64_read(&stats->iowq[op][i]);
+			}
+		}
+		if (copy_to_user(&uhist[op], &hist, sizeof(hist)))
+			return -EFAULT;
+	}
+
+	/* racy against completions in progress, which is fine for stats */
+	if (stats && (reg->flags & IO_URING_LAT_STATS_F_RESET)) {
+		spin_lock(&ctx->completion_lock);
+		memset(stats->complete, 0, sizeof(stats->complete));
+		spin_unlock(&ctx->completion_lock);
+		for (op = 0; op < IORING_OP_LAST; op++)
+			for (i = 0; i < IO_URING_LAT_BUCKETS; i++)
+				atomic64_set(&stats->iowq[op][i], 0);
+	}
+	return 0;
+}
+
+int io_register_lat_stats(struct io_ring_ctx *ctx, void __user *arg)
+	__must_hold(&ctx->uring_lock)
+{
+	struct io_uring_lat_stats_reg reg;
+	struct io_lat_stats *stats;
+	int ret;
+
+	if (copy_from_user(&reg, arg, sizeof(reg)))
+		return -EFAULT;
+	if (reg.resv || reg.resv2[0] || reg.resv2[1])
+		return -EINVAL;
+
+	switch (reg.op) {
+	case IO_URING_LAT_STATS_ENABLE:
+		if (reg.flags || reg.addr || reg.nr_ops)
+			return -EINVAL;
+		if (!ctx->lat_stats) {
+			stats = kvzalloc(sizeof(*stats), GFP_KERNEL_ACCOUNT);
+			if (!stats)
+				return -ENOMEM;
+			/* fdinfo and completions only look once it's enabled */
+			ctx->lat_stats = stats;
+		}
+		WRITE_ONCE(ctx->lat_stats_on, true);
+		return 0;
+	case IO_URING_LAT_STATS_DISABLE:
+		if (reg.flags || reg.addr || reg.nr_ops)
+			return -EINVAL;
+		/*
+		 * Requests in flight are still stamped and account into the
+		 * histograms, which is why they stay around until the ring
+		 * goes away.
+		 */
+		WRITE_ONCE(ctx->lat_stats_on, false);
+		return 0;
+	case IO_URING_LAT_STATS_GET:
+		if (reg.flags & ~IO_URING_LAT_STATS_F_RESET)
+			return -EINVAL;
+		ret = io_lat_stats_get(ctx, &reg);
+		reg.nr_ops = IORING_OP_LAST;
+		if (copy_to_user(arg, &reg, sizeof(reg)))
+			return -EFAULT;
+		return ret;
+	}
+	return -EINVAL;
+}
+
+void io_lat_stats_free(struct io_ring_ctx *ctx)
+{
+	kvfree(ctx->lat_stats);
+	ctx->lat_stats = NULL;
+}
+
+static void io_lat_hist_show(struct seq_file *m, const char *name,
+			     const u64 *hist)
+{
+	unsigned int i;
+
+	seq_printf(m, "  %s:", name);
+	for (i = 0; i < IO_URING_LAT_BUCKETS; i++)
+		if (hist[i])
+			seq_printf(m, " %u:%llu", i, hist[i]);
+	seq_putc(m, '\n');
+}
+
+__cold void io_lat_stats_show_fdinfo(struct io_ring_ctx *ctx,
+				     struct seq_file *m)
+{
+	struct io_lat_stats *stats = ctx->lat_stats;
+	u64 iowq[IO_URING_LAT_BUCKETS];
+	unsigned int op, i;
+
+	if (!stats) {
+		seq_puts(m, "LatStats:\tdisabled\n");
+		return;
+	}
+	seq_printf(m, "LatStats:\t%s (log2 ns buckets)\n",
+		   READ_ONCE(ctx->lat_stats_on) ? "enabled" : "disabled");
+	for (op = 0; op < IORING_OP_LAST; op++) {
+		bool any = false;
+
+		for (i = 0; i < IO_URING_LAT_BUCKETS; i++) {
+			iowq[i] = atomic64_read(&stats->iowq[op][i]);
+			any |= iowq[i] || READ_ONCE(stats->complete[op][i]);
+		}
+		if (!any)
+			continue;
+		seq_printf(m, " %s\n", io_uring_get_opcode(op));
+		io_lat_hist_show(m, "complete", stats->complete[op]);
+		io_lat_hist_show(m, "iowq", iowq);
+	}
+}
@@ -0,0 +1,23 @@
+// SPDX-License-Identifier: GPL-2.0
+#ifndef IOU_LATSTATS_H
+#define IOU_LATSTATS_H
+
+#include <linux/timekeeping.h>
+#include <linux/io_uring_types.h>
+
+int io_register_lat_stats(struct io_ring_ctx *ctx, void __user *arg);
+void io_lat_stats_free(struct io_ring_ctx *ctx);
+void io_lat_stats_complete(struct io_ring_ctx *ctx, struct io_kiocb *req);
+void io_lat_stats_iowq(struct io_kiocb *req);
+void io_lat_stats_show_fdinfo(struct io_ring_ctx *ctx, struct seq_file *m);
+
+static inline void io_lat_stats_start(struct io_ring_ctx *ctx,
+				      struct io_kiocb *req)
+{
+	if (unlikely(ctx->lat_stats_on)) {
+		req->flags |= REQ_F_LAT_STATS;
+		req->lat_start = ktime_get_ns();
+	}
+}
+
+#endif
@@ -8,6 +8,9 @@
 /* Timeout for cleanout of stale entries. */
 #define NAPI_TIMEOUT		(60 * SEC_CONVERSION)
 
+/* weight of a new sample in the inter-arrival average is 1/2^shift */
+#define NAPI_ARRIVAL_EWMA_SHIFT	3
+
 struct io_napi_entry {
 	unsigned int		napi_id;
 	struct list_head	list;
@@ -15,6 +18,10 @@ struct io_napi_entry {
 	unsigned long		timeout;
 	struct hlist_node	node;
 
+	/* for IO_URING_NAPI_F_ADAPTIVE */
+	ktime_t			last_arrival;
+	u64			arrival_gap_ns;
+
 	struct rcu_head		rcu;
 };
 
@@ -38,6 +45,70 @@ static inline ktime_t net_to_ktime(unsigned long t)
 	return ns_to_ktime(t << 10);
 }
 
+/*
+ * A request armed poll on a socket of this napi id, so the previous data has
+ * been consumed and the next arrival is being waited for. Under steady load,
+ * the time between two of these is the packet inter-arrival time.
+ */
+static void io_napi_note_arrival(struct io_napi_entry *e)
+{
+	ktime_t now = net_to_ktime(busy_loop_current_time());
+	ktime_t last = READ_ONCE(e->last_arrival);
+	u64 avg = READ_ONCE(e->arrival_gap_ns);
+	u64 gap;
+
+	WRITE_ONCE(e->last_arrival, now);
+	if (!last)
+		return;
+
+	gap = ktime_to_ns(ktime_sub(now, last));
+	if (avg)
+		avg += (gap >> NAPI_ARRIVAL_EWMA_SHIFT) -
+		       (avg >> NAPI_ARRIVAL_EWMA_SHIFT);
+	else
+		avg = gap;
+	WRITE_ONCE(e->arrival_gap_ns, avg);
+}
+
+/*
+ * Whether the next arrival on @e is expected before @now + @bp. An id that
+ * hasn't seen more than one arrival yet is always polled; one whose arrival
+ * is overdue by more than an average gap is assumed to have gone idle.
+ */
+static bool io_napi_arrival_expected(struct io_napi_entry *e, ktime_t now,
+				     ktime_t bp)
+{
+	u64 avg = READ_ONCE(e->arrival_gap_ns);
+	ktime_t next;
+
+	if (!avg)
+		return true;
+
+	next = ktime_add_ns(READ_ONCE(e->last_arrival), avg);
+	if (ktime_after(next, ktime_add(now, bp)))
+		return false;
+	return !ktime_after(now, ktime_add_ns(next, avg));
+}
+
+/*
+ * Account an arrival for @napi_id if it's tracked. Used by static tracking,
+ * which doesn't go through __io_napi_add_id().
+ */
+void __io_napi_note_id(struct io_ring_ctx *ctx, unsigned int napi_id)
+{
+	struct hlist_head *hash_list;
+	struct io_napi_entry *e;
+
+	if (!napi_id_valid(napi_id))
+		return;
+
+	hash_list = &ctx->napi_ht[hash_min(napi_id, HASH_BITS(ctx->napi_ht))];
+	guard(rcu)();
+	e = io_napi_hash_find(hash_list, napi_id);
+	if (e)
+		io_napi_note_arrival(e);
+}
+
 int __io_napi_add_id(struct io_ring_ctx *ctx, unsigned int napi_id)
 {
 	struct hlist_head *hash_list;
@@ -53,6 +124,8 @@ int __io_napi_add_id(struct io_ring_ctx *ctx, unsigned int napi_id)
 		e = io_napi_hash_find(hash_list, napi_id);
 		if (e) {
 			WRITE_ONCE(e->timeout, jiffies + NAPI_TIMEOUT);
+			if (READ_ONCE(ctx->napi_adaptive))
+				io_napi_note_arrival(e);
 			return -EEXIST;
 		}
 	}
@@ -63,6 +136,8 @@ int __io_napi_add_id(struct io_ring_ctx *ctx, unsigned int napi_id)
 
 	e->napi_id = napi_id;
 	e->timeout = jiffies + NAPI_TIMEOUT;
+	e->last_arrival = 0;
+	e->arrival_gap_ns = 0;
 
 	/*
 	 * guard(spinlock) is not used to manually unlock it before calling
@@ -162,30 +237,38 @@ static bool io_napi_busy_loop_should_end(void *data,
  */
 static bool static_tracking_do_busy_loop(struct io_ring_ctx *ctx,
 					 bool (*loop_end)(void *, unsigned long),
-					 void *loop_end_arg)
+					 void *loop_end_arg, ktime_t bp)
 {
+	ktime_t now = net_to_ktime(busy_loop_current_time());
+	bool adaptive = READ_ONCE(ctx->napi_adaptive);
 	struct io_napi_entry *e;
 
-	list_for_each_entry_rcu(e, &ctx->napi_list, list)
+	list_for_each_entry_rcu(e, &ctx->napi_list, list) {
+		if (adaptive && !io_napi_arrival_expected(e, now, bp))
+			continue;
 		napi_busy_loop_rcu(e->napi_id, loop_end, loop_end_arg,
 				   ctx->napi_prefer_busy_poll, BUSY_POLL_BUDGET);
+	}
 	return false;
 }
 
 static bool
 dynamic_tracking_do_busy_loop(struct io_ring_ctx *ctx,
 			      bool (*loop_end)(void *, unsigned long),
-			      void *loop_end_arg)
+			      void *loop_end_arg, ktime_t bp)
 {
+	ktime_t now = net_to_ktime(busy_loop_current_time());
+	bool adaptive = READ_ONCE(ctx->napi_adaptive);
 	struct io_napi_entry *e;
 	bool is_stale = false;
 
 	list_for_each_entry_rcu(e, &ctx->napi_list, list) {
-		napi_busy_loop_rcu(e->napi_id, loop_end, loop_end_arg,
-				   ctx->napi_prefer_busy_poll, BUSY_POLL_BUDGET);
-
 		if (time_after(jiffies, READ_ONCE(e->timeout)))
 			is_stale = true;
+		if (adaptive && !io_napi_arrival_expected(e, now, bp))
+			continue;
+		napi_busy_loop_rcu(e->napi_id, loop_end, loop_end_arg,
+				   ctx->napi_prefer_busy_poll, BUSY_POLL_BUDGET);
 	}
 
 	return is_stale;
@@ -194,11 +277,28 @@ dynamic_tracking_do_busy_loop(struct io_ring_ctx *ctx,
 static inline bool
 __io_napi_do_busy_loop(struct io_ring_ctx *ctx,
 		       bool (*loop_end)(void *, unsigned long),
-		       void *loop_end_arg)
+		       void *loop_end_arg, ktime_t bp)
 {
 	if (READ_ONCE(ctx->napi_track_mode) == IO_URING_NAPI_TRACKING_STATIC)
-		return static_tracking_do_busy_loop(ctx, loop_end, loop_end_arg);
-	return dynamic_tracking_do_busy_loop(ctx, loop_end, loop_end_arg);
+		return static_tracking_do_busy_loop(ctx, loop_end, loop_end_arg,
+						    bp);
+	return dynamic_tracking_do_busy_loop(ctx, loop_end, loop_end_arg, bp);
+}
+
+/* With IO_URING_NAPI_F_ADAPTIVE, whether any napi id is worth spinning on. */
+static bool io_napi_should_busy_poll(struct io_ring_ctx *ctx, ktime_t bp)
+{
+	ktime_t now = net_to_ktime(busy_loop_current_time());
+	struct io_napi_entry *e;
+
+	if (!READ_ONCE(ctx->napi_adaptive))
+		return true;
+
+	guard(rcu)();
+	list_for_each_entry_rcu(e, &ctx->napi_list, list)
+		if (io_napi_arrival_expected(e, now, bp))
+			return true;
+	return false;
 }
 
 static void io_napi_blocking_busy_loop(struct io_ring_ctx *ctx,
@@ -209,6 +309,10 @@ static void io_napi_blocking_busy_loop(struct io_ring_ctx *ctx,
 	void *loop_end_arg = NULL;
 	bool is_stale = false;
 
+	/* Nothing is about to arrive, sleep and take the interrupt. */
+	if (!io_napi_should_busy_poll(ctx, iowq->napi_busy_poll_dt))
+		return;
+
 	/* Singular lists use a different napi loop end check function and are
 	 * only executed once.
 	 */
@@ -220,7 +324,8 @@ static void io_napi_blocking_busy_loop(struct io_ring_ctx *ctx,
 	scoped_guard(rcu) {
 		do {
 			is_stale = __io_napi_do_busy_loop(ctx, loop_end,
-							  loop_end_arg);
+							  loop_end_arg,
+							  iowq->napi_busy_poll_dt);
 		} while (!io_napi_busy_loop_should_end(iowq, start_time) &&
 			 !loop_end_arg);
 	}
@@ -241,6 +346,7 @@ void io_napi_init(struct io_ring_ctx *ctx)
 	INIT_LIST_HEAD(&ctx->napi_list);
 	spin_lock_init(&ctx->napi_lock);
 	ctx->napi_prefer_busy_poll = false;
+	ctx->napi_adaptive = false;
 	ctx->napi_busy_poll_dt = ns_to_ktime(sys_dt);
 	ctx->napi_track_mode = IO_URING_NAPI_TRACKING_INACTIVE;
 }
@@ -273,11 +379,14 @@ static int io_napi_register_napi(struct io_ring_ctx *ctx,
 	default:
 		return -EINVAL;
 	}
+	if (napi->flags & ~IO_URING_NAPI_F_ADAPTIVE)
+		return -EINVAL;
 	/* clean the napi list for new settings */
 	io_napi_free(ctx);
 	WRITE_ONCE(ctx->napi_track_mode, napi->op_param);
 	WRITE_ONCE(ctx->napi_busy_poll_dt, napi->busy_poll_to * NSEC_PER_USEC);
 	WRITE_ONCE(ctx->napi_prefer_busy_poll, !!napi->prefer_busy_poll);
+	WRITE_ONCE(ctx->napi_adaptive, !!(napi->flags & IO_URING_NAPI_F_ADAPTIVE));
 	return 0;
 }
 
@@ -293,7 +402,8 @@ int io_register_napi(struct io_ring_ctx *ctx, void __user *arg)
 	const struct io_uring_napi curr = {
 		.busy_poll_to 	  = ktime_to_us(ctx->napi_busy_poll_dt),
 		.prefer_busy_poll = ctx->napi_prefer_busy_poll,
-		.op_param	  = ctx->napi_track_mode
+		.op_param	  = ctx->napi_track_mode,
+		.flags		  = ctx->napi_adaptive ? IO_URING_NAPI_F_ADAPTIVE : 0
 	};
 	struct io_uring_napi napi;
 
@@ -301,7 +411,9 @@ int io_register_napi(struct io_ring_ctx *ctx, void __user *arg)
 		return -EINVAL;
 	if (copy_from_user(&napi, arg, sizeof(napi)))
 		return -EFAULT;
-	if (napi.pad[0] || napi.pad[1] || napi.resv)
+	if (napi.pad[0] || napi.pad[1])
+		return -EINVAL;
+	if (napi.flags && napi.opcode != IO_URING_NAPI_REGISTER_OP)
 		return -EINVAL;
 
 	if (copy_to_user(arg, &curr, sizeof(curr)))
@@ -343,6 +455,7 @@ int io_unregister_napi(struct io_ring_ctx *ctx, void __user *arg)
 
 	WRITE_ONCE(ctx->napi_busy_poll_dt, 0);
 	WRITE_ONCE(ctx->napi_prefer_busy_poll, false);
+	WRITE_ONCE(ctx->napi_adaptive, false);
 	WRITE_ONCE(ctx->napi_track_mode, IO_URING_NAPI_TRACKING_INACTIVE);
 	return 0;
 }
@@ -386,7 +499,8 @@ int io_napi_sqpoll_busy_poll(struct io_ring_ctx *ctx)
 		return 0;
 
 	scoped_guard(rcu) {
-		is_stale = __io_napi_do_busy_loop(ctx, NULL, NULL);
+		is_stale = __io_napi_do_busy_loop(ctx, NULL, NULL,
+						  READ_ONCE(ctx->napi_busy_poll_dt));
 	}
 
 	io_napi_remove_stale(ctx, is_stale);
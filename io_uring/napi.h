@@ -16,6 +16,7 @@ int io_register_napi(struct io_ring_ctx *ctx, void __user *arg);
 int io_unregister_napi(struct io_ring_ctx *ctx, void __user *arg);
 
 int __io_napi_add_id(struct io_ring_ctx *ctx, unsigned int napi_id);
+void __io_napi_note_id(struct io_ring_ctx *ctx, unsigned int napi_id);
 
 void __io_napi_busy_loop(struct io_ring_ctx *ctx, struct io_wait_queue *iowq);
 int io_napi_sqpoll_busy_poll(struct io_ring_ctx *ctx);
@@ -44,12 +45,24 @@ static inline void io_napi_add(struct io_kiocb *req)
 	struct io_ring_ctx *ctx = req->ctx;
 	struct socket *sock;
 
-	if (READ_ONCE(ctx->napi_track_mode) != IO_URING_NAPI_TRACKING_DYNAMIC)
+	switch (READ_ONCE(ctx->napi_track_mode)) {
+	case IO_URING_NAPI_TRACKING_DYNAMIC:
+		break;
+	case IO_URING_NAPI_TRACKING_STATIC:
+		if (READ_ONCE(ctx->napi_adaptive))
+			break;
 		return;
+	default:
+		return;
+	}
 
 	sock = sock_from_file(req->file);
-	if (sock && sock->sk)
+	if (!sock || !sock->sk)
+		return;
+	if (READ_ONCE(ctx->napi_track_mode) == IO_URING_NAPI_TRACKING_DYNAMIC)
 		__io_napi_add_id(ctx, READ_ONCE(sock->sk->sk_napi_id));
+	else
+		__io_napi_note_id(ctx, READ_ONCE(sock->sk->sk_napi_id));
 }
 
 #else
@@ -743,6 +743,7 @@ static int io_recvmsg_prep_setup(struct io_kiocb *req)
 		kmsg->msg.msg_controllen = 0;
 		kmsg->msg.msg_iocb = NULL;
 		kmsg->msg.msg_ubuf = NULL;
+		kmsg->msg.msg_rx_batch = NULL;
 
 		if (!io_do_buffer_select(req)) {
 			ret = import_ubuf(ITER_DEST, sr->buf, sr->len,
@@ -1106,10 +1107,14 @@ static int io_recv_buf_select(struct io_kiocb *req, struct io_async_msghdr *kmsg
 		iov_iter_init(&kmsg->msg.msg_iter, ITER_DEST, arg.iovs, ret,
 				arg.out_len);
 	} else {
+		size_t want = sr->len;
 		void __user *buf;
 
+		/* what's queued already picks the tier of a tiered group */
+		if (kmsg->msg.msg_inq > 1)
+			want = min_not_zero(sr->len, kmsg->msg.msg_inq);
 		*len = sr->len;
-		buf = io_buffer_select(req, len, issue_flags);
+		buf = io_buffer_select_fit(req, len, want, issue_flags);
 		if (!buf)
 			return -ENOBUFS;
 		sr->buf = buf;
@@ -1210,9 +1215,7 @@ int io_recvzc_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe)
 		return -EINVAL;
 
 	ifq_idx = READ_ONCE(sqe->zcrx_ifq_idx);
-	if (ifq_idx != 0)
-		return -EINVAL;
-	zc->ifq = req->ctx->ifq;
+	zc->ifq = xa_load(&req->ctx->zcrx_ctxs, ifq_idx);
 	if (!zc->ifq)
 		return -EINVAL;
 	zc->len = READ_ONCE(sqe->len);
@@ -1281,7 +1284,8 @@ void io_send_zc_cleanup(struct io_kiocb *req)
 }
 
 #define IO_ZC_FLAGS_COMMON (IORING_RECVSEND_POLL_FIRST | IORING_RECVSEND_FIXED_BUF)
-#define IO_ZC_FLAGS_VALID  (IO_ZC_FLAGS_COMMON | IORING_SEND_ZC_REPORT_USAGE)
+#define IO_ZC_FLAGS_VALID  (IO_ZC_FLAGS_COMMON | IORING_SEND_ZC_REPORT_USAGE | \
+			    IORING_SEND_ZC_COALESCE_NOTIF)
 
 int io_send_zc_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe)
 {
@@ -1327,6 +1331,14 @@ int io_send_zc_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe)
 	if (zc->msg_flags & MSG_DONTWAIT)
 		req->flags |= REQ_F_NOWAIT;
 
+	if (zc->flags & IORING_SEND_ZC_COALESCE_NOTIF) {
+		if (!(zc->flags & IORING_RECVSEND_FIXED_BUF))
+			return -EINVAL;
+		ret = io_notif_stream_attach(notif, req->buf_index);
+		if (unlikely(ret))
+			return ret;
+	}
+
 	if (io_is_compat(req->ctx))
 		zc->msg_flags |= MSG_CMSG_COMPAT;
 
@@ -11,6 +11,46 @@
 
 static const struct ubuf_info_ops io_ubuf_ops;
 
+/*
+ * Retire @nd's sequence number and decide whether @nd posts a CQE for its
+ * stream. Notifications of a chain complete together, so a notification
+ * leaves posting to the next one in the chain if that is of the same stream.
+ */
+static bool io_notif_stream_complete(struct io_notif_data *nd)
+{
+	struct io_notif_stream *stream = nd->stream;
+	struct io_kiocb *notif = cmd_to_io_kiocb(nd);
+	bool post;
+
+	spin_lock(&stream->lock);
+	if (nd->seq == stream->done + 1) {
+		unsigned long n;
+
+		n = find_first_zero_bit(stream->pending, IO_NOTIF_STREAM_WINDOW);
+		bitmap_shift_right(stream->pending, stream->pending, n + 1,
+				   IO_NOTIF_STREAM_WINDOW);
+		stream->done += n + 1;
+	} else {
+		__set_bit(nd->seq - stream->done - 2, stream->pending);
+	}
+
+	if (notif->cqe.res & IORING_NOTIF_USAGE_ZC_COPIED)
+		stream->copied = true;
+
+	post = stream->done != stream->reported &&
+	       !(nd->next && nd->next->stream == stream);
+	if (post) {
+		notif->cqe.res = stream->done & ~IORING_NOTIF_USAGE_ZC_COPIED;
+		if (stream->copied)
+			notif->cqe.res |= IORING_NOTIF_USAGE_ZC_COPIED;
+		stream->reported = stream->done;
+		stream->copied = false;
+	}
+	spin_unlock(&stream->lock);
+
+	return post;
+}
+
 static void io_notif_tw_complete(struct io_kiocb *notif, io_tw_token_t tw)
 {
 	struct io_notif_data *nd = io_notif_to_data(notif);
@@ -23,6 +63,9 @@ static void io_notif_tw_complete(struct io_kiocb *notif, io_tw_token_t tw)
 		if (unlikely(nd->zc_report) && (nd->zc_copied || !nd->zc_used))
 			notif->cqe.res |= IORING_NOTIF_USAGE_ZC_COPIED;
 
+		if (nd->stream && !io_notif_stream_complete(nd))
+			notif->flags |= REQ_F_CQE_SKIP;
+
 		if (nd->account_pages && notif->ctx->user) {
 			__io_unaccount_mem(notif->ctx->user, nd->account_pages);
 			nd->account_pages = 0;
@@ -125,9 +168,57 @@ struct io_kiocb *io_alloc_notif(struct io_ring_ctx *ctx)
 	nd->account_pages = 0;
 	nd->next = NULL;
 	nd->head = nd;
+	nd->stream = NULL;
 
 	nd->uarg.flags = IO_NOTIF_UBUF_FLAGS;
 	nd->uarg.ops = &io_ubuf_ops;
 	refcount_set(&nd->uarg.refcnt, 1);
 	return notif;
 }
+
+int io_notif_stream_attach(struct io_kiocb *notif, unsigned int index)
+	__must_hold(&notif->ctx->uring_lock)
+{
+	struct io_notif_data *nd = io_notif_to_data(notif);
+	struct io_ring_ctx *ctx = notif->ctx;
+	struct io_notif_stream *stream;
+	int ret = 0;
+
+	if (unlikely(index >= ctx->buf_table.nr))
+		return -EFAULT;
+
+	stream = xa_load(&ctx->notif_streams, index);
+	if (!stream) {
+		stream = kzalloc(sizeof(*stream), GFP_KERNEL_ACCOUNT);
+		if (!stream)
+			return -ENOMEM;
+		spin_lock_init(&stream->lock);
+		if (xa_err(xa_store(&ctx->notif_streams, index, stream,
+				    GFP_KERNEL_ACCOUNT))) {
+			kfree(stream);
+			return -ENOMEM;
+		}
+	}
+
+	spin_lock(&stream->lock);
+	/* the watermark can't advance past the window */
+	if (stream->seq - stream->done >= IO_NOTIF_STREAM_WINDOW)
+		ret = -EBUSY;
+	else
+		nd->seq = ++stream->seq;
+	spin_unlock(&stream->lock);
+
+	if (!ret)
+		nd->stream = stream;
+	return ret;
+}
+
+void io_notif_streams_free(struct io_ring_ctx *ctx)
+{
+	struct io_notif_stream *stream;
+	unsigned long index;
+
+	xa_for_each(&ctx->notif_streams, index, stream)
+		kfree(stream);
+	xa_destroy(&ctx->notif_streams);
+}
@@ -9,6 +9,25 @@
 
 #define IO_NOTIF_UBUF_FLAGS	(SKBFL_ZEROCOPY_FRAG | SKBFL_DONT_ORPHAN)
 #define IO_NOTIF_SPLICE_BATCH	32
+#define IO_NOTIF_STREAM_WINDOW	1024
+
+/*
+ * Notifications of IORING_SEND_ZC_COALESCE_NOTIF requests using the same
+ * registered buffer. Each gets a sequence number at prep time, and only
+ * the watermark below which all of them have completed is reported.
+ */
+struct io_notif_stream {
+	spinlock_t		lock;
+	/* last sequence number handed out */
+	u32			seq;
+	/* all notifications up to this one have completed */
+	u32			done;
+	/* last watermark posted in a CQE */
+	u32			reported;
+	bool			copied;
+	/* completed notifications past the watermark, bit i is done + 2 + i */
+	DECLARE_BITMAP(pending, IO_NOTIF_STREAM_WINDOW);
+};
 
 struct io_notif_data {
 	struct file		*file;
@@ -21,9 +40,14 @@ struct io_notif_data {
 	bool			zc_report;
 	bool			zc_used;
 	bool			zc_copied;
+
+	struct io_notif_stream	*stream;
+	u32			seq;
 };
 
 struct io_kiocb *io_alloc_notif(struct io_ring_ctx *ctx);
+int io_notif_stream_attach(struct io_kiocb *notif, unsigned int index);
+void io_notif_streams_free(struct io_ring_ctx *ctx);
 void io_tx_ubuf_complete(struct sk_buff *skb, struct ubuf_info *uarg,
 			 bool success);
 
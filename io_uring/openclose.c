@@ -210,11 +210,18 @@ int io_close_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe)
 
 	if (sqe->off || sqe->addr || sqe->len || sqe->rw_flags || sqe->buf_index)
 		return -EINVAL;
-	if (req->flags & REQ_F_FIXED_FILE)
-		return -EBADF;
 
 	close->fd = READ_ONCE(sqe->fd);
 	close->file_slot = READ_ONCE(sqe->file_index);
+	/* fd or, with IOSQE_FIXED_FILE, direct descriptor of an earlier link */
+	if (close->fd == IORING_FD_LINK_RES) {
+		if (close->file_slot || !io_submit_in_link(req->ctx))
+			return -EINVAL;
+		req->flags |= REQ_F_LINK_FD;
+		return 0;
+	}
+	if (req->flags & REQ_F_FIXED_FILE)
+		return -EBADF;
 	if (close->file_slot && close->fd)
 		return -EINVAL;
 
@@ -228,6 +235,15 @@ int io_close(struct io_kiocb *req, unsigned int issue_flags)
 	struct file *file;
 	int ret = -EBADF;
 
+	if (req->flags & REQ_F_LINK_FD) {
+		if (req->cqe.fd < 0)
+			goto err;
+		if (req->flags & REQ_F_FIXED_FILE)
+			close->file_slot = req->cqe.fd + 1;
+		else
+			close->fd = req->cqe.fd;
+	}
+
 	if (close->file_slot) {
 		ret = io_close_fixed(req, issue_flags);
 		goto err;
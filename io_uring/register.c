@@ -793,6 +793,12 @@ static int __io_uring_register(struct io_ring_ctx *ctx, unsigned opcode,
 			break;
 		ret = io_register_pbuf_status(ctx, arg);
 		break;
+	case IORING_REGISTER_PBUF_TIERS:
+		ret = -EINVAL;
+		if (!arg || nr_args != 1)
+			break;
+		ret = io_register_pbuf_tiers(ctx, arg);
+		break;
 	case IORING_REGISTER_NAPI:
 		ret = -EINVAL;
 		if (!arg || nr_args != 1)
@@ -835,6 +841,12 @@ static int __io_uring_register(struct io_ring_ctx *ctx, unsigned opcode,
 			break;
 		ret = io_register_mem_region(ctx, arg);
 		break;
+	case IORING_REGISTER_LAT_STATS:
+		ret = -EINVAL;
+		if (!arg || nr_args != 1)
+			break;
+		ret = io_register_lat_stats(ctx, arg);
+		break;
 	default:
 		ret = -EINVAL;
 		break;
@@ -1332,52 +1332,72 @@ int io_vec_realloc(struct iou_vec *iv, unsigned nr_entries)
 	return 0;
 }
 
+/*
+ * Append the bvecs covering @iov, which must lie within @imu, to @res_bvec.
+ * With a coalesced huge page buffer that is one bvec per folio.
+ */
+static int io_vec_fill_bvec_one(struct io_mapped_ubuf *imu,
+				const struct iovec *iov,
+				struct bio_vec *res_bvec, unsigned *bvec_idx,
+				size_t *total_len)
+{
+	unsigned long folio_size = 1 << imu->folio_shift;
+	unsigned long folio_mask = folio_size - 1;
+	size_t iov_len = iov->iov_len;
+	u64 buf_addr = (u64)(uintptr_t)iov->iov_base;
+	struct bio_vec *src_bvec;
+	unsigned idx = *bvec_idx;
+	size_t offset;
+	int ret;
+
+	ret = validate_fixed_range(buf_addr, iov_len, imu);
+	if (unlikely(ret))
+		return ret;
+
+	if (unlikely(!iov_len))
+		return -EFAULT;
+	if (unlikely(check_add_overflow(*total_len, iov_len, total_len)))
+		return -EOVERFLOW;
+
+	offset = buf_addr - imu->ubuf;
+	/*
+	 * Only the first bvec can have non zero bv_offset, account it
+	 * here and work with full folios below.
+	 */
+	offset += imu->bvec[0].bv_offset;
+
+	src_bvec = imu->bvec + (offset >> imu->folio_shift);
+	offset &= folio_mask;
+
+	for (; iov_len; offset = 0, idx++, src_bvec++) {
+		size_t seg_size = min_t(size_t, iov_len,
+					folio_size - offset);
+
+		bvec_set_page(&res_bvec[idx],
+			      src_bvec->bv_page, seg_size, offset);
+		iov_len -= seg_size;
+	}
+	*bvec_idx = idx;
+	return 0;
+}
+
 static int io_vec_fill_bvec(int ddir, struct iov_iter *iter,
 				struct io_mapped_ubuf *imu,
 				struct iovec *iovec, unsigned nr_iovs,
 				struct iou_vec *vec)
 {
-	unsigned long folio_size = 1 << imu->folio_shift;
-	unsigned long folio_mask = folio_size - 1;
 	struct bio_vec *res_bvec = vec->bvec;
 	size_t total_len = 0;
 	unsigned bvec_idx = 0;
 	unsigned iov_idx;
 
 	for (iov_idx = 0; iov_idx < nr_iovs; iov_idx++) {
-		size_t iov_len = iovec[iov_idx].iov_len;
-		u64 buf_addr = (u64)(uintptr_t)iovec[iov_idx].iov_base;
-		struct bio_vec *src_bvec;
-		size_t offset;
 		int ret;
 
-		ret = validate_fixed_range(buf_addr, iov_len, imu);
+		ret = io_vec_fill_bvec_one(imu, &iovec[iov_idx], res_bvec,
+					   &bvec_idx, &total_len);
 		if (unlikely(ret))
 			return ret;
-
-		if (unlikely(!iov_len))
-			return -EFAULT;
-		if (unlikely(check_add_overflow(total_len, iov_len, &total_len)))
-			return -EOVERFLOW;
-
-		offset = buf_addr - imu->ubuf;
-		/*
-		 * Only the first bvec can have non zero bv_offset, account it
-		 * here and work with full folios below.
-		 */
-		offset += imu->bvec[0].bv_offset;
-
-		src_bvec = imu->bvec + (offset >> imu->folio_shift);
-		offset &= folio_mask;
-
-		for (; iov_len; offset = 0, bvec_idx++, src_bvec++) {
-			size_t seg_size = min_t(size_t, iov_len,
-						folio_size - offset);
-
-			bvec_set_page(&res_bvec[bvec_idx],
-				      src_bvec->bv_page, seg_size, offset);
-			iov_len -= seg_size;
-		}
 	}
 	if (total_len > MAX_RW_COUNT)
 		return -EINVAL;
@@ -1474,6 +1494,44 @@ static int io_kern_bvec_size(struct iovec *iov, unsigned nr_iovs,
 	return 0;
 }
 
+/*
+ * Make room for @nr_segs bvecs in front of the @nr_iovs iovecs padded to the
+ * right of @vec, and return where the iovecs are now.
+ */
+static struct iovec *io_vec_grow_bvec(struct io_kiocb *req,
+				      struct iou_vec *vec, unsigned nr_iovs,
+				      unsigned nr_segs)
+{
+	unsigned iovec_off = vec->nr - nr_iovs;
+	struct iovec *iov = vec->iovec + iovec_off;
+
+	if (sizeof(struct bio_vec) > sizeof(struct iovec)) {
+		size_t bvec_bytes;
+
+		bvec_bytes = nr_segs * sizeof(struct bio_vec);
+		nr_segs = (bvec_bytes + sizeof(*iov) - 1) / sizeof(*iov);
+		nr_segs += nr_iovs;
+	}
+
+	if (nr_segs > vec->nr) {
+		struct iou_vec tmp_vec = {};
+		int ret;
+
+		ret = io_vec_realloc(&tmp_vec, nr_segs);
+		if (ret)
+			return ERR_PTR(ret);
+
+		iovec_off = tmp_vec.nr - nr_iovs;
+		memcpy(tmp_vec.iovec + iovec_off, iov, sizeof(*iov) * nr_iovs);
+		io_vec_free(vec);
+
+		*vec = tmp_vec;
+		iov = vec->iovec + iovec_off;
+		req->flags |= REQ_F_NEED_CLEANUP;
+	}
+	return iov;
+}
+
 int io_import_reg_vec(int ddir, struct iov_iter *iter,
 			struct io_kiocb *req, struct iou_vec *vec,
 			unsigned nr_iovs, unsigned issue_flags)
@@ -1503,35 +1561,103 @@ int io_import_reg_vec(int ddir, struct iov_iter *iter,
 		nr_segs = io_estimate_bvec_size(iov, nr_iovs, imu);
 	}
 
-	if (sizeof(struct bio_vec) > sizeof(struct iovec)) {
-		size_t bvec_bytes;
+	iov = io_vec_grow_bvec(req, vec, nr_iovs, nr_segs);
+	if (IS_ERR(iov))
+		return PTR_ERR(iov);
 
-		bvec_bytes = nr_segs * sizeof(struct bio_vec);
-		nr_segs = (bvec_bytes + sizeof(*iov) - 1) / sizeof(*iov);
-		nr_segs += nr_iovs;
-	}
+	if (imu->is_kbuf)
+		return io_vec_fill_kern_bvec(ddir, iter, imu, iov, nr_iovs, vec);
 
-	if (nr_segs > vec->nr) {
-		struct iou_vec tmp_vec = {};
-		int ret;
+	return io_vec_fill_bvec(ddir, iter, imu, iov, nr_iovs, vec);
+}
 
-		ret = io_vec_realloc(&tmp_vec, nr_segs);
-		if (ret)
-			return ret;
+void io_put_buf_nodes(struct io_ring_ctx *ctx, struct io_buf_nodes *bn)
+{
+	lockdep_assert_held(&ctx->uring_lock);
 
-		iovec_off = tmp_vec.nr - nr_iovs;
-		memcpy(tmp_vec.iovec + iovec_off, iov, sizeof(*iov) * nr_iovs);
-		io_vec_free(vec);
+	while (bn->nr)
+		io_put_rsrc_node(ctx, bn->nodes[--bn->nr]);
+}
 
-		*vec = tmp_vec;
-		iov = vec->iovec + iovec_off;
-		req->flags |= REQ_F_NEED_CLEANUP;
+static struct io_mapped_ubuf *io_buf_nodes_get(struct io_ring_ctx *ctx,
+						struct io_buf_nodes *bn,
+						u16 index, int ddir)
+{
+	struct io_rsrc_node *node;
+	unsigned i;
+
+	node = io_rsrc_node_lookup(&ctx->buf_table, index);
+	if (!node)
+		return ERR_PTR(-EFAULT);
+	/* kernel buffers can't be sized up front, see io_kern_bvec_size() */
+	if (!(node->buf->dir & (1 << ddir)) || node->buf->is_kbuf)
+		return ERR_PTR(-EFAULT);
+
+	for (i = 0; i < bn->nr; i++)
+		if (bn->nodes[i] == node)
+			return node->buf;
+	if (bn->nr == IO_VEC_MAX_BUF_NODES)
+		return ERR_PTR(-EINVAL);
+	node->refs++;
+	bn->nodes[bn->nr++] = node;
+	return node->buf;
+}
+
+/*
+ * Like io_import_reg_vec(), but each iovec may come from a different
+ * registered buffer, given by @indices. The buffers are looked up and pinned
+ * in @bn right away, so this is done at prep time with uring_lock held; @bn
+ * must be put with io_put_buf_nodes() once the request is done.
+ */
+int io_import_reg_vec_indexed(int ddir, struct iov_iter *iter,
+			struct io_kiocb *req, struct iou_vec *vec,
+			unsigned nr_iovs, const u16 __user *indices,
+			struct io_buf_nodes *bn)
+{
+	struct io_ring_ctx *ctx = req->ctx;
+	size_t total_len = 0;
+	unsigned bvec_idx = 0;
+	unsigned nr_segs, i;
+	struct iovec *iov;
+
+	lockdep_assert_held(&ctx->uring_lock);
+	io_put_buf_nodes(ctx, bn);
+
+	/*
+	 * The buffers aren't known yet. Any of them is made of at least page
+	 * sized folios, so size for pages.
+	 */
+	iov = vec->iovec + vec->nr - nr_iovs;
+	for (i = 0, nr_segs = 0; i < nr_iovs; i++) {
+		if (iov[i].iov_len > MAX_RW_COUNT)
+			return -EINVAL;
+		nr_segs += (iov[i].iov_len >> PAGE_SHIFT) + 2;
 	}
 
-	if (imu->is_kbuf)
-		return io_vec_fill_kern_bvec(ddir, iter, imu, iov, nr_iovs, vec);
+	iov = io_vec_grow_bvec(req, vec, nr_iovs, nr_segs);
+	if (IS_ERR(iov))
+		return PTR_ERR(iov);
 
-	return io_vec_fill_bvec(ddir, iter, imu, iov, nr_iovs, vec);
+	for (i = 0; i < nr_iovs; i++) {
+		struct io_mapped_ubuf *imu;
+		u16 index;
+		int ret;
+
+		if (get_user(index, &indices[i]))
+			return -EFAULT;
+		imu = io_buf_nodes_get(ctx, bn, index, ddir);
+		if (IS_ERR(imu))
+			return PTR_ERR(imu);
+		ret = io_vec_fill_bvec_one(imu, &iov[i], vec->bvec, &bvec_idx,
+					   &total_len);
+		if (unlikely(ret))
+			return ret;
+	}
+	if (total_len > MAX_RW_COUNT)
+		return -EINVAL;
+
+	iov_iter_bvec(iter, ddir, vec->bvec, bvec_idx, total_len);
+	return 0;
 }
 
 int io_prep_reg_iovec(struct io_kiocb *req, struct iou_vec *iv,
@@ -70,6 +70,20 @@ int io_import_reg_vec(int ddir, struct iov_iter *iter,
 int io_prep_reg_iovec(struct io_kiocb *req, struct iou_vec *iv,
 			const struct iovec __user *uvec, size_t uvec_segs);
 
+/* max number of distinct registered buffers a vectored request may use */
+#define IO_VEC_MAX_BUF_NODES	16
+
+struct io_buf_nodes {
+	unsigned		nr;
+	struct io_rsrc_node	*nodes[IO_VEC_MAX_BUF_NODES];
+};
+
+int io_import_reg_vec_indexed(int ddir, struct iov_iter *iter,
+			struct io_kiocb *req, struct iou_vec *vec,
+			unsigned nr_iovs, const u16 __user *indices,
+			struct io_buf_nodes *bn);
+void io_put_buf_nodes(struct io_ring_ctx *ctx, struct io_buf_nodes *bn);
+
 int io_register_clone_buffers(struct io_ring_ctx *ctx, void __user *arg);
 int io_sqe_buffers_unregister(struct io_ring_ctx *ctx);
 int io_sqe_buffers_register(struct io_ring_ctx *ctx, void __user *arg,
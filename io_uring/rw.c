@@ -149,6 +149,7 @@ static void io_rw_recycle(struct io_kiocb *req, unsigned int issue_flags)
 	if (unlikely(issue_flags & IO_URING_F_UNLOCKED))
 		return;
 
+	io_put_buf_nodes(req->ctx, &rw->buf_nodes);
 	io_alloc_cache_vec_kasan(&rw->vec);
 	if (rw->vec.nr > IO_VEC_CACHE_SOFT_CAP)
 		io_vec_free(&rw->vec);
@@ -189,7 +190,11 @@ static void io_req_rw_cleanup(struct io_kiocb *req, unsigned int issue_flags)
 	 * should be fixed seperately, and then this check could be killed.
 	 */
 	if (!(req->flags & (REQ_F_REISSUE | REQ_F_REFCOUNT))) {
-		req->flags &= ~REQ_F_NEED_CLEANUP;
+		struct io_async_rw *io = req->async_data;
+
+		/* held buffers can only be put under uring_lock */
+		if (!(issue_flags & IO_URING_F_UNLOCKED) || !io->buf_nodes.nr)
+			req->flags &= ~REQ_F_NEED_CLEANUP;
 		io_rw_recycle(req, issue_flags);
 	}
 }
@@ -290,7 +295,13 @@ static int __io_prep_rw(struct io_kiocb *req, const struct io_uring_sqe *sqe,
 	if (attr_type_mask) {
 		u64 attr_ptr;
 
-		/* only PI attribute is supported currently */
+		/* buffer indices are imported by io_rw_prep_reg_vec() */
+		if (attr_type_mask == IORING_RW_ATTR_FLAG_BUF_INDEX) {
+			if (req->opcode != IORING_OP_READV_FIXED &&
+			    req->opcode != IORING_OP_WRITEV_FIXED)
+				return -EINVAL;
+			return 0;
+		}
 		if (attr_type_mask != IORING_RW_ATTR_FLAG_PI)
 			return -EINVAL;
 
@@ -311,15 +322,39 @@ static int io_rw_do_import(struct io_kiocb *req, int ddir)
 static int io_prep_rw(struct io_kiocb *req, const struct io_uring_sqe *sqe,
 		      int ddir)
 {
+	struct io_rw *rw = io_kiocb_to_cmd(req, struct io_rw);
 	int ret;
 
 	ret = __io_prep_rw(req, sqe, ddir);
 	if (unlikely(ret))
 		return ret;
 
+	/* imported at issue, once the previous link has completed */
+	if (unlikely(rw->len == IORING_LEN_LINK_RES) &&
+	    !io_issue_defs[req->opcode].vectored) {
+		if (!io_submit_in_link(req->ctx) ||
+		    (req->flags & REQ_F_BUFFER_SELECT))
+			return -EINVAL;
+		req->flags |= REQ_F_LINK_LEN;
+		return 0;
+	}
+
 	return io_rw_do_import(req, ddir);
 }
 
+static int io_rw_import_link_len(struct io_kiocb *req, struct io_async_rw *io,
+				 int ddir)
+{
+	struct io_rw *rw = io_kiocb_to_cmd(req, struct io_rw);
+
+	/* cqe.res gets reused once issued, only consume it once */
+	req->flags &= ~REQ_F_LINK_LEN;
+	if (req->cqe.res < 0)
+		return -ECANCELED;
+	rw->len = req->cqe.res;
+	return io_import_rw_buffer(ddir, req, io, 0);
+}
+
 int io_prep_read(struct io_kiocb *req, const struct io_uring_sqe *sqe)
 {
 	return io_prep_rw(req, sqe, ITER_DEST);
@@ -401,14 +436,48 @@ static int io_rw_import_reg_vec(struct io_kiocb *req,
 	return 0;
 }
 
-static int io_rw_prep_reg_vec(struct io_kiocb *req)
+/*
+ * With per-iovec buffer indices the buffers are resolved at prep, as they
+ * have to be pinned for the whole request anyway.
+ */
+static int io_rw_prep_buf_index(struct io_kiocb *req, struct io_async_rw *io,
+				int ddir, u64 attr_ptr)
+{
+	struct io_rw *rw = io_kiocb_to_cmd(req, struct io_rw);
+	struct io_uring_attr_buf_index attr;
+	int ret;
+
+	if (copy_from_user(&attr, u64_to_user_ptr(attr_ptr), sizeof(attr)))
+		return -EFAULT;
+	if (attr.rsvd)
+		return -EINVAL;
+
+	req->flags |= REQ_F_NEED_CLEANUP;
+	ret = io_import_reg_vec_indexed(ddir, &io->iter, req, &io->vec,
+					rw->len, u64_to_user_ptr(attr.addr),
+					&io->buf_nodes);
+	if (unlikely(ret))
+		return ret;
+	iov_iter_save_state(&io->iter, &io->iter_state);
+	req->flags &= ~REQ_F_IMPORT_BUFFER;
+	return 0;
+}
+
+static int io_rw_prep_reg_vec(struct io_kiocb *req,
+			      const struct io_uring_sqe *sqe, int ddir)
 {
 	struct io_rw *rw = io_kiocb_to_cmd(req, struct io_rw);
 	struct io_async_rw *io = req->async_data;
 	const struct iovec __user *uvec;
+	int ret;
 
 	uvec = u64_to_user_ptr(rw->addr);
-	return io_prep_reg_iovec(req, &io->vec, uvec, rw->len);
+	ret = io_prep_reg_iovec(req, &io->vec, uvec, rw->len);
+	if (unlikely(ret))
+		return ret;
+	if (READ_ONCE(sqe->attr_type_mask) != IORING_RW_ATTR_FLAG_BUF_INDEX)
+		return 0;
+	return io_rw_prep_buf_index(req, io, ddir, READ_ONCE(sqe->attr_ptr));
 }
 
 int io_prep_readv_fixed(struct io_kiocb *req, const struct io_uring_sqe *sqe)
@@ -418,7 +487,7 @@ int io_prep_readv_fixed(struct io_kiocb *req, const struct io_uring_sqe *sqe)
 	ret = __io_prep_rw(req, sqe, ITER_DEST);
 	if (unlikely(ret))
 		return ret;
-	return io_rw_prep_reg_vec(req);
+	return io_rw_prep_reg_vec(req, sqe, ITER_DEST);
 }
 
 int io_prep_writev_fixed(struct io_kiocb *req, const struct io_uring_sqe *sqe)
@@ -428,7 +497,7 @@ int io_prep_writev_fixed(struct io_kiocb *req, const struct io_uring_sqe *sqe)
 	ret = __io_prep_rw(req, sqe, ITER_SOURCE);
 	if (unlikely(ret))
 		return ret;
-	return io_rw_prep_reg_vec(req);
+	return io_rw_prep_reg_vec(req, sqe, ITER_SOURCE);
 }
 
 /*
@@ -904,7 +973,11 @@ static int __io_read(struct io_kiocb *req, unsigned int issue_flags)
 	ssize_t ret;
 	loff_t *ppos;
 
-	if (req->flags & REQ_F_IMPORT_BUFFER) {
+	if (unlikely(req->flags & REQ_F_LINK_LEN)) {
+		ret = io_rw_import_link_len(req, io, ITER_DEST);
+		if (unlikely(ret < 0))
+			return ret;
+	} else if (req->flags & REQ_F_IMPORT_BUFFER) {
 		ret = io_rw_import_reg_vec(req, io, ITER_DEST, issue_flags);
 		if (unlikely(ret))
 			return ret;
@@ -1114,7 +1187,11 @@ int io_write(struct io_kiocb *req, unsigned int issue_flags)
 	ssize_t ret, ret2;
 	loff_t *ppos;
 
-	if (req->flags & REQ_F_IMPORT_BUFFER) {
+	if (unlikely(req->flags & REQ_F_LINK_LEN)) {
+		ret = io_rw_import_link_len(req, io, ITER_SOURCE);
+		if (unlikely(ret < 0))
+			return ret;
+	} else if (req->flags & REQ_F_IMPORT_BUFFER) {
 		ret = io_rw_import_reg_vec(req, io, ITER_SOURCE, issue_flags);
 		if (unlikely(ret))
 			return ret;
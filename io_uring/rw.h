@@ -2,6 +2,7 @@
 
 #include <linux/io_uring_types.h>
 #include <linux/pagemap.h>
+#include "rsrc.h"
 
 struct io_meta_state {
 	u32			seed;
@@ -11,6 +12,8 @@ struct io_meta_state {
 struct io_async_rw {
 	struct iou_vec			vec;
 	size_t				bytes_done;
+	/* buffers of IORING_RW_ATTR_FLAG_BUF_INDEX, put on recycle */
+	struct io_buf_nodes		buf_nodes;
 
 	struct_group(clear,
 		struct iov_iter			iter;
@@ -21,6 +21,8 @@
 
 #define IORING_SQPOLL_CAP_ENTRIES_VALUE 8
 #define IORING_TW_CAP_ENTRIES_VALUE	32
+/* SQPOLL time a shared thread grants each ring per round */
+#define IORING_SQPOLL_QUANTUM_NS	(50 * NSEC_PER_USEC)
 
 enum {
 	IO_SQ_THREAD_SHOULD_STOP = 0,
@@ -168,44 +170,85 @@ static inline bool io_sqd_events_pending(struct io_sq_data *sqd)
 	return READ_ONCE(sqd->state);
 }
 
+/*
+ * With multiple rings, they are served deficit round robin: each round a
+ * ring with work is granted IORING_SQPOLL_QUANTUM_NS and charged the time
+ * its submissions and polling actually took. A ring that has overdrawn,
+ * e.g. by issuing expensive requests inline, sits out rounds until it's
+ * back in credit, while the cheap ones keep being served every round. An
+ * idle ring loses its credit, so that it can't save up for a burst.
+ */
 static int __io_sq_thread(struct io_ring_ctx *ctx, bool cap_entries)
 {
+	const struct cred *creds = NULL;
 	unsigned int to_submit;
+	u64 start, delta;
 	int ret = 0;
 
 	to_submit = io_sqring_entries(ctx);
-	/* if we're handling multiple rings, cap submit size for fairness */
-	if (cap_entries && to_submit > IORING_SQPOLL_CAP_ENTRIES_VALUE)
-		to_submit = IORING_SQPOLL_CAP_ENTRIES_VALUE;
-
-	if (to_submit || !wq_list_empty(&ctx->iopoll_list)) {
-		const struct cred *creds = NULL;
+	if (!to_submit && wq_list_empty(&ctx->iopoll_list)) {
+		ctx->sq_deficit = 0;
+		return 0;
+	}
 
-		if (ctx->sq_creds != current_cred())
-			creds = override_creds(ctx->sq_creds);
+	ctx->sq_idle_until = jiffies + ctx->sq_thread_idle;
+	if (cap_entries) {
+		ctx->sq_deficit = min_t(s64, ctx->sq_deficit + IORING_SQPOLL_QUANTUM_NS,
+					IORING_SQPOLL_QUANTUM_NS);
+		/* still has work, but it's someone else's turn */
+		if (ctx->sq_deficit <= 0)
+			return 0;
+		/* if we're handling multiple rings, cap submit size for fairness */
+		if (to_submit > IORING_SQPOLL_CAP_ENTRIES_VALUE)
+			to_submit = IORING_SQPOLL_CAP_ENTRIES_VALUE;
+	}
 
-		mutex_lock(&ctx->uring_lock);
-		if (!wq_list_empty(&ctx->iopoll_list))
-			io_do_iopoll(ctx, true);
+	if (ctx->sq_creds != current_cred())
+		creds = override_creds(ctx->sq_creds);
 
-		/*
-		 * Don't submit if refs are dying, good for io_uring_register(),
-		 * but also it is relied upon by io_ring_exit_work()
-		 */
-		if (to_submit && likely(!percpu_ref_is_dying(&ctx->refs)) &&
-		    !(ctx->flags & IORING_SETUP_R_DISABLED))
-			ret = io_submit_sqes(ctx, to_submit);
-		mutex_unlock(&ctx->uring_lock);
-
-		if (to_submit && wq_has_sleeper(&ctx->sqo_sq_wait))
-			wake_up(&ctx->sqo_sq_wait);
-		if (creds)
-			revert_creds(creds);
-	}
+	start = ktime_get_ns();
+	mutex_lock(&ctx->uring_lock);
+	if (!wq_list_empty(&ctx->iopoll_list))
+		io_do_iopoll(ctx, true);
 
+	/*
+	 * Don't submit if refs are dying, good for io_uring_register(),
+	 * but also it is relied upon by io_ring_exit_work()
+	 */
+	if (to_submit && likely(!percpu_ref_is_dying(&ctx->refs)) &&
+	    !(ctx->flags & IORING_SETUP_R_DISABLED))
+		ret = io_submit_sqes(ctx, to_submit);
+	mutex_unlock(&ctx->uring_lock);
+	delta = ktime_get_ns() - start;
+
+	if (to_submit && wq_has_sleeper(&ctx->sqo_sq_wait))
+		wake_up(&ctx->sqo_sq_wait);
+	if (creds)
+		revert_creds(creds);
+
+	/* fdinfo reads it locklessly */
+	WRITE_ONCE(ctx->sq_work_time, ctx->sq_work_time + delta);
+	if (cap_entries)
+		ctx->sq_deficit -= delta;
 	return ret;
 }
 
+/*
+ * Each ring keeps the thread spinning for its own sq_thread_idle after it
+ * last had work, rather than any activity extending the longest idle
+ * period of all of them.
+ */
+static unsigned long io_sqd_idle_timeout(struct io_sq_data *sqd)
+{
+	unsigned long timeout = jiffies;
+	struct io_ring_ctx *ctx;
+
+	list_for_each_entry(ctx, &sqd->ctx_list, sqd_list)
+		if (time_after(ctx->sq_idle_until, timeout))
+			timeout = ctx->sq_idle_until;
+	return timeout;
+}
+
 static bool io_sqd_handle_event(struct io_sq_data *sqd)
 {
 	bool did_sig = false;
@@ -307,7 +350,7 @@ static int io_sq_thread(void *data)
 
 	mutex_lock(&sqd->lock);
 	while (1) {
-		bool cap_entries, sqt_spin = false;
+		bool cap_entries, sqt_spin = false, napi_busy = false;
 
 		if (io_sqd_events_pending(sqd) || signal_pending(current)) {
 			if (io_sqd_handle_event(sqd))
@@ -322,19 +365,36 @@ static int io_sq_thread(void *data)
 
 			if (!sqt_spin && (ret > 0 || !wq_list_empty(&ctx->iopoll_list)))
 				sqt_spin = true;
+			/* a ring waiting out its deficit isn't idle either */
+			if (!sqt_spin && cap_entries && ctx->sq_deficit < 0)
+				sqt_spin = true;
 		}
-		if (io_sq_tw(&retry_list, IORING_TW_CAP_ENTRIES_VALUE))
+		/* don't always give the same ring the first go */
+		if (cap_entries)
+			list_rotate_left(&sqd->ctx_list);
+		if (io_sq_tw(&retry_list, IORING_TW_CAP_ENTRIES_VALUE)) {
 			sqt_spin = true;
+			/* task_work isn't told apart by ring, it counts for all */
+			list_for_each_entry(ctx, &sqd->ctx_list, sqd_list)
+				ctx->sq_idle_until = jiffies + ctx->sq_thread_idle;
+		}
 
-		list_for_each_entry(ctx, &sqd->ctx_list, sqd_list)
-			if (io_napi(ctx))
-				io_napi_sqpoll_busy_poll(ctx);
+		/*
+		 * Busy polling is activity for as long as the ring has napi ids
+		 * that haven't gone stale.
+		 */
+		list_for_each_entry(ctx, &sqd->ctx_list, sqd_list) {
+			if (io_napi(ctx) && io_napi_sqpoll_busy_poll(ctx)) {
+				ctx->sq_idle_until = jiffies + ctx->sq_thread_idle;
+				napi_busy = true;
+			}
+		}
 
+		if (sqt_spin || napi_busy)
+			timeout = io_sqd_idle_timeout(sqd);
 		if (sqt_spin || !time_after(jiffies, timeout)) {
-			if (sqt_spin) {
+			if (sqt_spin)
 				io_sq_update_worktime(sqd, &start);
-				timeout = jiffies + sqd->sq_thread_idle;
-			}
 			if (unlikely(need_resched())) {
 				mutex_unlock(&sqd->lock);
 				cond_resched();
@@ -450,6 +510,7 @@ __cold int io_sq_offload_create(struct io_ring_ctx *ctx,
 		ctx->sq_thread_idle = msecs_to_jiffies(p->sq_thread_idle);
 		if (!ctx->sq_thread_idle)
 			ctx->sq_thread_idle = HZ;
+		ctx->sq_idle_until = jiffies + ctx->sq_thread_idle;
 
 		io_sq_thread_park(sqd);
 		list_add(&ctx->sqd_list, &sqd->ctx_list);
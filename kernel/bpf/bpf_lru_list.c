@@ -414,12 +414,16 @@ static struct bpf_lru_node *bpf_percpu_lru_pop_free(struct bpf_lru *lru,
 
 	raw_spin_lock_irqsave(&l->lock, flags);
 
-	__bpf_lru_list_rotate(lru, l);
-
+	/*
+	 * Like the common LRU, only rotate when a batch of free nodes has
+	 * to be reclaimed. There is nothing to age for a free node.
+	 */
 	free_list = &l->lists[BPF_LRU_LIST_T_FREE];
-	if (list_empty(free_list))
+	if (list_empty(free_list)) {
+		__bpf_lru_list_rotate(lru, l);
 		__bpf_lru_list_shrink(lru, l, PERCPU_FREE_TARGET, free_list,
 				      BPF_LRU_LIST_T_FREE);
+	}
 
 	if (!list_empty(free_list)) {
 		node = list_first_entry(free_list, struct bpf_lru_node, list);
@@ -183,9 +183,11 @@ static int cpu_map_bpf_prog_run_xdp(struct bpf_cpu_map_entry *rcpu,
 				    struct xdp_cpumap_stats *stats)
 {
 	struct xdp_rxq_info rxq = {};
+	struct xdp_frame_bulk bq;
 	struct xdp_buff xdp;
 	int i, nframes = 0;
 
+	xdp_frame_bulk_init(&bq);
 	xdp_set_return_frame_no_direct();
 	xdp.rxq = &rxq;
 
@@ -205,7 +207,7 @@ static int cpu_map_bpf_prog_run_xdp(struct bpf_cpu_map_entry *rcpu,
 		case XDP_PASS:
 			err = xdp_update_frame_from_buff(&xdp, xdpf);
 			if (err < 0) {
-				xdp_return_frame(xdpf);
+				xdp_return_frame_bulk(xdpf, &bq);
 				stats->drop++;
 			} else {
 				frames[nframes++] = xdpf;
@@ -215,7 +217,7 @@ static int cpu_map_bpf_prog_run_xdp(struct bpf_cpu_map_entry *rcpu,
 			err = xdp_do_redirect(xdpf->dev_rx, &xdp,
 					      rcpu->prog);
 			if (unlikely(err)) {
-				xdp_return_frame(xdpf);
+				xdp_return_frame_bulk(xdpf, &bq);
 				stats->drop++;
 			} else {
 				stats->redirect++;
@@ -225,12 +227,14 @@ static int cpu_map_bpf_prog_run_xdp(struct bpf_cpu_map_entry *rcpu,
 			bpf_warn_invalid_xdp_action(NULL, rcpu->prog, act);
 			fallthrough;
 		case XDP_DROP:
-			xdp_return_frame(xdpf);
+			xdp_return_frame_bulk(xdpf, &bq);
 			stats->drop++;
 			break;
 		}
 	}
 
+	/* Dropped frames go back to their page_pool in batches */
+	xdp_flush_frame_bulk(&bq);
 	xdp_clear_return_frame_no_direct();
 	stats->pass += nframes;
 
@@ -54,12 +54,13 @@
 	(BPF_F_NUMA_NODE | BPF_F_RDONLY | BPF_F_WRONLY)
 
 struct xdp_dev_bulk_queue {
-	struct xdp_frame *q[DEV_MAP_BULK_SIZE];
+	struct xdp_frame *q[DEV_MAP_BULK_MAX];
 	struct list_head flush_node;
 	struct net_device *dev;
 	struct net_device *dev_rx;
 	struct bpf_prog *xdp_prog;
 	unsigned int count;
+	unsigned int batch;
 };
 
 struct bpf_dtab_netdev {
@@ -411,6 +412,14 @@ static void bq_xmit_all(struct xdp_dev_bulk_queue *bq, u32 flags)
 	for (i = sent; unlikely(i < to_send); i++)
 		xdp_return_frame_rx_napi(bq->q[i]);
 
+	/* Send more frames per call while the TX ring takes full batches,
+	 * and go back to the default batch as soon as it runs out of room.
+	 */
+	if (unlikely(sent < to_send))
+		bq->batch = DEV_MAP_BULK_SIZE;
+	else if (cnt == bq->batch && bq->batch < DEV_MAP_BULK_MAX)
+		bq->batch <<= 1;
+
 out:
 	bq->count = 0;
 	trace_xdp_devmap_xmit(bq->dev_rx, dev, sent, cnt - sent, err);
@@ -458,7 +467,7 @@ static void bq_enqueue(struct net_device *dev, struct xdp_frame *xdpf,
 {
 	struct xdp_dev_bulk_queue *bq = this_cpu_ptr(dev->xdp_bulkq);
 
-	if (unlikely(bq->count == DEV_MAP_BULK_SIZE))
+	if (unlikely(bq->count == bq->batch))
 		bq_xmit_all(bq, 0);
 
 	/* Ingress dev_rx will be the same for all xdp_frame's in
@@ -1102,6 +1111,7 @@ static int dev_map_notification(struct notifier_block *notifier,
 				ulong event, void *ptr)
 {
 	struct net_device *netdev = netdev_notifier_info_to_dev(ptr);
+	struct xdp_dev_bulk_queue *bq;
 	struct bpf_dtab *dtab;
 	int i, cpu;
 
@@ -1115,8 +1125,11 @@ static int dev_map_notification(struct notifier_block *notifier,
 		if (!netdev->xdp_bulkq)
 			return NOTIFY_BAD;
 
-		for_each_possible_cpu(cpu)
-			per_cpu_ptr(netdev->xdp_bulkq, cpu)->dev = netdev;
+		for_each_possible_cpu(cpu) {
+			bq = per_cpu_ptr(netdev->xdp_bulkq, cpu);
+			bq->dev = netdev;
+			bq->batch = DEV_MAP_BULK_SIZE;
+		}
 		break;
 	case NETDEV_UNREGISTER:
 		/* This rcu_read_lock/unlock pair is needed because
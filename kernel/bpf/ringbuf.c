@@ -417,6 +417,15 @@ static void *__bpf_ringbuf_reserve(struct bpf_ringbuf *rb, u64 size)
 
 	cons_pos = smp_load_acquire(&rb->consumer_pos);
 
+	/*
+	 * producer_pos only moves forward, so if the record doesn't fit now
+	 * it won't fit under the lock either. Bail out early rather than
+	 * have every producer of an overrun ring bounce rb->spinlock only to
+	 * find out there is no space.
+	 */
+	if (READ_ONCE(rb->producer_pos) + len - cons_pos > rb->mask)
+		return NULL;
+
 	if (raw_res_spin_lock_irqsave(&rb->spinlock, flags))
 		return NULL;
 
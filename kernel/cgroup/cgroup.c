@@ -3991,6 +3991,14 @@ static __poll_t cgroup_pressure_poll(struct kernfs_open_file *of,
 	return psi_trigger_poll(&ctx->psi.trigger, of->file, pt);
 }
 
+static int cgroup_pressure_mmap(struct kernfs_open_file *of,
+				struct vm_area_struct *vma)
+{
+	struct cgroup_file_ctx *ctx = of->priv;
+
+	return psi_trigger_mmap(&ctx->psi.trigger, vma);
+}
+
 static void cgroup_pressure_release(struct kernfs_open_file *of)
 {
 	struct cgroup_file_ctx *ctx = of->priv;
@@ -4259,6 +4267,23 @@ static struct kernfs_ops cgroup_kf_single_ops = {
 	.seq_show		= cgroup_seqfile_show,
 };
 
+static int cgroup_file_mmap(struct kernfs_open_file *of,
+			    struct vm_area_struct *vma)
+{
+	return of_cft(of)->mmap(of, vma);
+}
+
+/* Separate ops so that only files which can be mmap'd get KERNFS_HAS_MMAP */
+static struct kernfs_ops cgroup_kf_single_mmap_ops = {
+	.atomic_write_len	= PAGE_SIZE,
+	.open			= cgroup_file_open,
+	.release		= cgroup_file_release,
+	.write			= cgroup_file_write,
+	.poll			= cgroup_file_poll,
+	.mmap			= cgroup_file_mmap,
+	.seq_show		= cgroup_seqfile_show,
+};
+
 static struct kernfs_ops cgroup_kf_ops = {
 	.atomic_write_len	= PAGE_SIZE,
 	.open			= cgroup_file_open,
@@ -4416,6 +4441,8 @@ static int cgroup_init_cftypes(struct cgroup_subsys *ss, struct cftype *cfts)
 
 		if (cft->seq_start)
 			kf_ops = &cgroup_kf_ops;
+		else if (cft->mmap)
+			kf_ops = &cgroup_kf_single_mmap_ops;
 		else
 			kf_ops = &cgroup_kf_single_ops;
 
@@ -5377,6 +5404,7 @@ static struct cftype cgroup_psi_files[] = {
 		.seq_show = cgroup_io_pressure_show,
 		.write = cgroup_io_pressure_write,
 		.poll = cgroup_pressure_poll,
+		.mmap = cgroup_pressure_mmap,
 		.release = cgroup_pressure_release,
 	},
 	{
@@ -5385,6 +5413,7 @@ static struct cftype cgroup_psi_files[] = {
 		.seq_show = cgroup_memory_pressure_show,
 		.write = cgroup_memory_pressure_write,
 		.poll = cgroup_pressure_poll,
+		.mmap = cgroup_pressure_mmap,
 		.release = cgroup_pressure_release,
 	},
 	{
@@ -5393,6 +5422,7 @@ static struct cftype cgroup_psi_files[] = {
 		.seq_show = cgroup_cpu_pressure_show,
 		.write = cgroup_cpu_pressure_write,
 		.poll = cgroup_pressure_poll,
+		.mmap = cgroup_pressure_mmap,
 		.release = cgroup_pressure_release,
 	},
 #ifdef CONFIG_IRQ_TIME_ACCOUNTING
@@ -5402,6 +5432,7 @@ static struct cftype cgroup_psi_files[] = {
 		.seq_show = cgroup_irq_pressure_show,
 		.write = cgroup_irq_pressure_write,
 		.poll = cgroup_pressure_poll,
+		.mmap = cgroup_pressure_mmap,
 		.release = cgroup_pressure_release,
 	},
 #endif
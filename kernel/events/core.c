@@ -10205,11 +10205,21 @@ static inline void perf_event_free_bpf_handler(struct perf_event *event)
  * Generic event overflow handling, sampling.
  */
 
+static bool perf_event_has_rb(struct perf_event *event)
+{
+	/* For inherited events we send all the output towards the parent. */
+	if (event->parent)
+		event = event->parent;
+
+	return !!rcu_access_pointer(event->rb);
+}
+
 static int __perf_event_overflow(struct perf_event *event,
 				 int throttle, struct perf_sample_data *data,
 				 struct pt_regs *regs)
 {
 	int events = atomic_read(&event->event_limit);
+	bool skip_output = false;
 	int ret = 0;
 
 	/*
@@ -10224,9 +10234,17 @@ static int __perf_event_overflow(struct perf_event *event,
 	if (event->attr.aux_pause)
 		perf_event_aux_pause(event->aux_event, true);
 
-	if (event->prog && event->prog->type == BPF_PROG_TYPE_PERF_EVENT &&
-	    !bpf_overflow_handler(event, data, regs))
-		goto out;
+	if (event->prog && event->prog->type == BPF_PROG_TYPE_PERF_EVENT) {
+		if (!bpf_overflow_handler(event, data, regs))
+			goto out;
+		/*
+		 * Aggregation only events, typically folding the samples into a
+		 * BPF stack map, never get a buffer mapped. Don't bother to
+		 * prepare a record for output that would be dropped anyway.
+		 */
+		if (is_default_overflow_handler(event) && !perf_event_has_rb(event))
+			skip_output = true;
+	}
 
 	/*
 	 * XXX event_limit might not quite work as expected on inherited
@@ -10283,7 +10301,8 @@ static int __perf_event_overflow(struct perf_event *event,
 		}
 	}
 
-	READ_ONCE(event->overflow_handler)(event, data, regs);
+	if (!skip_output)
+		READ_ONCE(event->overflow_handler)(event, data, regs);
 
 	if (*perf_event_fasync(event) && event->pending_kill) {
 		event->pending_wakeup = 1;
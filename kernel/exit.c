@@ -738,6 +738,9 @@ static void forget_original_parent(struct task_struct *father,
 		 */
 		if (!same_thread_group(reaper, father))
 			reparent_leader(father, p, dead);
+#ifdef CONFIG_SCHED_BORE
+		sched_reparent_bore(p, reaper);
+#endif
 	}
 	list_splice_tail_init(&father->children, &reaper->children);
 }
@@ -758,6 +761,9 @@ static void exit_notify(struct task_struct *tsk, int group_dead)
 	if (group_dead)
 		kill_orphaned_pgrp(tsk->group_leader, NULL);
 
+#ifdef CONFIG_SCHED_BORE
+	sched_exit_bore(tsk);
+#endif
 	tsk->exit_state = EXIT_ZOMBIE;
 
 	if (unlikely(tsk->ptrace)) {
@@ -950,6 +950,7 @@ void __mmdrop(struct mm_struct *mm)
 	mm_pasid_drop(mm);
 	mm_destroy_cid(mm);
 	percpu_counter_destroy_many(mm->rss_stat, NR_MM_COUNTERS);
+	futex_hash_free(mm);
 
 	free_mm(mm);
 }
@@ -1315,6 +1316,7 @@ static struct mm_struct *mm_init(struct mm_struct *mm, struct task_struct *p,
 #endif
 	mm_init_uprobes_state(mm);
 	hugetlb_count_init(mm);
+	futex_mm_init(mm);
 
 	if (current->mm) {
 		mm->flags = mmf_init_flags(current->mm->flags);
@@ -1825,6 +1827,9 @@ static int copy_files(unsigned long clone_flags, struct task_struct *tsk,
 {
 	struct files_struct *oldf, *newf;
 
+	/* The descriptor cache is per thread, see set_fd_cache() */
+	tsk->fd_cache = NULL;
+
 	/*
 	 * A background process may not have any files ...
 	 */
@@ -2167,10 +2172,6 @@ static void rv_task_fork(struct task_struct *p)
 #define rv_task_fork(p) do {} while (0)
 #endif
 
-#ifdef CONFIG_SCHED_BORE
-void sched_clone_bore(struct task_struct *p, struct task_struct *parent, u64 clone_flags, u64 now);
-#endif
-
 /*
  * This creates a new process as a copy of the old one,
  * but does not actually start it yet.
@@ -2351,7 +2352,9 @@ __latent_entropy struct task_struct *copy_process(
 	p->io_uring = NULL;
 #endif
 
-	p->default_timer_slack_ns = current->timer_slack_ns;
+	/* Not the slack the parent's cgroup imposes, see tg_update_timer_slack() */
+	p->default_timer_slack_ns = current->saved_timer_slack_ns ?:
+				    current->timer_slack_ns;
 
 #ifdef CONFIG_PSI
 	p->psi_flags = 0;
@@ -2520,6 +2523,8 @@ __latent_entropy struct task_struct *copy_process(
 	p->nr_dirtied = 0;
 	p->nr_dirtied_pause = 128 >> (PAGE_SHIFT - 10);
 	p->dirty_paused_when = 0;
+	p->nr_dirtied_budget = 0;
+	p->dirty_budget_when = jiffies;
 
 	p->pdeath_signal = 0;
 	p->task_works = NULL;
@@ -2572,11 +2577,6 @@ __latent_entropy struct task_struct *copy_process(
 	 */
 	write_lock_irq(&tasklist_lock);
 
-#ifdef CONFIG_SCHED_BORE
-	if (likely(p->pid))
-		sched_clone_bore(p, current, clone_flags, p->start_time);
-#endif
-
 	/* CLONE_PARENT re-uses the old parent */
 	if (clone_flags & (CLONE_PARENT|CLONE_THREAD)) {
 		p->real_parent = current->real_parent;
@@ -2615,6 +2615,12 @@ __latent_entropy struct task_struct *copy_process(
 
 	/* No more failure paths after this point. */
 
+#ifdef CONFIG_SCHED_BORE
+	/* Linked into the parent's aggregates, unlinked by sched_exit_bore() */
+	if (likely(p->pid))
+		sched_clone_bore(p, current, clone_flags, p->start_time);
+#endif
+
 	/*
 	 * Copy seccomp details explicitly here, in case they were changed
 	 * before holding sighand lock.
@@ -3321,6 +3327,9 @@ static int unshare_fd(unsigned long unshare_flags, struct files_struct **new_fdp
 {
 	struct files_struct *fd = current->files;
 
+	if (unshare_flags & CLONE_FILES)
+		fd_cache_release(current);
+
 	if ((unshare_flags & CLONE_FILES) &&
 	    (fd && atomic_read(&fd->count) > 1)) {
 		fd = dup_fd(fd, NULL);
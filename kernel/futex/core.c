@@ -39,21 +39,39 @@
 #include <linux/memblock.h>
 #include <linux/fault-inject.h>
 #include <linux/slab.h>
+#include <linux/prctl.h>
 
 #include "futex.h"
 #include "../locking/rtmutex_common.h"
 
 /*
- * The base of the bucket array and its size are always used together
- * (after initialization only in futex_hash()), so ensure that they
- * reside in the same cacheline.
+ * The global hash has one bucket array per node, allocated on that node.
+ * After initialization, the fields are only read, in futex_hash().  The size
+ * of the arrays is kept first, so that it shares a cacheline with the bases
+ * of the first nodes; with many nodes, the array of bases spans several
+ * cachelines.
  */
 static struct {
-	struct futex_hash_bucket *queues;
 	unsigned long            hashmask;
+	unsigned int		 hashshift;
+	struct futex_hash_bucket *queues[MAX_NUMNODES];
 } __futex_data __read_mostly __aligned(2*sizeof(long));
-#define futex_queues   (__futex_data.queues)
-#define futex_hashmask (__futex_data.hashmask)
+#define futex_queues    (__futex_data.queues)
+#define futex_hashmask  (__futex_data.hashmask)
+#define futex_hashshift (__futex_data.hashshift)
+
+/*
+ * Hash table of the PRIVATE futexes of a process, so that unrelated
+ * processes don't contend on the same hash bucket locks.  It is allocated on
+ * the first private futex operation of the process, and freed with the mm.
+ */
+struct futex_private_hash {
+	unsigned int		 hashmask;
+	struct futex_hash_bucket queues[];
+};
+
+/* Set as mm->futex_phash when the process uses the global hash */
+static struct futex_private_hash futex_no_private_hash;
 
 
 /*
@@ -107,19 +125,188 @@ late_initcall(fail_futex_debugfs);
 
 #endif /* CONFIG_FAIL_FUTEX */
 
+static void futex_hash_bucket_init(struct futex_hash_bucket *hb)
+{
+	atomic_set(&hb->waiters, 0);
+	plist_head_init(&hb->chain);
+	spin_lock_init(&hb->lock);
+}
+
+static struct futex_private_hash *futex_private_hash_alloc(unsigned int slots)
+{
+	struct futex_private_hash *fph;
+	unsigned int i;
+
+	fph = kvmalloc(struct_size(fph, queues, slots), GFP_KERNEL_ACCOUNT);
+	if (!fph)
+		return NULL;
+
+	for (i = 0; i < slots; i++)
+		futex_hash_bucket_init(&fph->queues[i]);
+	fph->hashmask = slots - 1;
+	return fph;
+}
+
+static void futex_private_hash_release(struct futex_private_hash *fph)
+{
+	if (fph != &futex_no_private_hash)
+		kvfree(fph);
+}
+
+/*
+ * Install @fph as the private hash of @mm, unless the process already has
+ * one.  Once installed, the hash is never replaced, as the futex_q queued in
+ * its buckets can't be moved safely.
+ */
+static bool futex_private_hash_install(struct mm_struct *mm,
+				       struct futex_private_hash *fph)
+{
+	/* Pairs with the READ_ONCE() in futex_private_hash() */
+	if (cmpxchg_release(&mm->futex_phash, NULL, fph)) {
+		futex_private_hash_release(fph);
+		return false;
+	}
+	return true;
+}
+
+/*
+ * Called for each private futex key before any hash bucket is looked up, so
+ * that all the threads of the process agree on the hash to use.
+ */
+static void futex_private_hash_init(struct mm_struct *mm)
+{
+	struct futex_private_hash *fph;
+	unsigned int slots;
+
+	if (likely(READ_ONCE(mm->futex_phash)))
+		return;
+
+	/*
+	 * The table can't grow later, so size it for the most threads which
+	 * can run at the same time.
+	 */
+	if (IS_ENABLED(CONFIG_BASE_SMALL))
+		slots = 16;
+	else
+		slots = max_t(unsigned int, 16,
+			      roundup_pow_of_two(4 * num_online_cpus()));
+
+	fph = futex_private_hash_alloc(slots);
+	if (!fph)
+		fph = &futex_no_private_hash;
+	futex_private_hash_install(mm, fph);
+}
+
+static struct futex_private_hash *futex_private_hash(union futex_key *key)
+{
+	struct futex_private_hash *fph;
+
+	if (!IS_ENABLED(CONFIG_MMU) || !key->private.mm ||
+	    (key->both.offset & (FUT_OFF_INODE | FUT_OFF_MMSHARED)))
+		return NULL;
+
+	fph = READ_ONCE(key->private.mm->futex_phash);
+	if (!fph || fph == &futex_no_private_hash)
+		return NULL;
+	return fph;
+}
+
+void futex_mm_init(struct mm_struct *mm)
+{
+	mm->futex_phash = NULL;
+}
+
+void futex_hash_free(struct mm_struct *mm)
+{
+	if (mm->futex_phash)
+		futex_private_hash_release(mm->futex_phash);
+}
+
+static int futex_hash_set_slots(unsigned long slots)
+{
+	struct futex_private_hash *fph;
+
+	if (!IS_ENABLED(CONFIG_MMU))
+		return -EINVAL;
+	if (slots && (slots < 2 || slots > (1U << 16) || !is_power_of_2(slots)))
+		return -EINVAL;
+	if (READ_ONCE(current->mm->futex_phash))
+		return -EBUSY;
+
+	if (slots) {
+		fph = futex_private_hash_alloc(slots);
+		if (!fph)
+			return -ENOMEM;
+	} else {
+		fph = &futex_no_private_hash;
+	}
+
+	return futex_private_hash_install(current->mm, fph) ? 0 : -EBUSY;
+}
+
+/*
+ * Returns the number of slots of the private hash, 0 if the process uses the
+ * global hash, or -ENODATA if the hash is not chosen yet (no private futex
+ * used and no PR_FUTEX_HASH_SET_SLOTS).
+ */
+static int futex_hash_get_slots(void)
+{
+	struct futex_private_hash *fph = READ_ONCE(current->mm->futex_phash);
+
+	if (!fph)
+		return -ENODATA;
+	if (fph == &futex_no_private_hash)
+		return 0;
+	return fph->hashmask + 1;
+}
+
+int futex_hash_prctl(unsigned long arg2, unsigned long arg3, unsigned long arg4)
+{
+	switch (arg2) {
+	case PR_FUTEX_HASH_SET_SLOTS:
+		if (arg4)
+			return -EINVAL;
+		return futex_hash_set_slots(arg3);
+	case PR_FUTEX_HASH_GET_SLOTS:
+		if (arg3 || arg4)
+			return -EINVAL;
+		return futex_hash_get_slots();
+	}
+	return -EINVAL;
+}
+
 /**
- * futex_hash - Return the hash bucket in the global hash
+ * futex_hash - Return the hash bucket in the global or the private hash
  * @key:	Pointer to the futex key for which the hash is calculated
  *
  * We hash on the keys returned from get_futex_key (see below) and return the
- * corresponding hash bucket in the global hash.
+ * corresponding hash bucket.  Private futexes use the hash of the process if
+ * it has one.  Other futexes use the global hash, on the node of the key
+ * for FUTEX2_NUMA futexes, or on a node picked from the hash otherwise.
  */
 struct futex_hash_bucket *futex_hash(union futex_key *key)
 {
 	u32 hash = jhash2((u32 *)key, offsetof(typeof(*key), both.offset) / 4,
 			  key->both.offset);
+	struct futex_private_hash *fph = futex_private_hash(key);
+	int node = key->both.node;
+
+	if (fph)
+		return &fph->queues[hash & fph->hashmask];
+
+	if (node == FUTEX_NO_NODE) {
+		/*
+		 * Use the hash bits above the bucket index to spread the
+		 * futexes over the nodes.  That is not perfectly uniform, but
+		 * it is cheap and handles sparse node masks.
+		 */
+		node = (hash >> futex_hashshift) % nr_node_ids;
+		if (!node_possible(node))
+			node = find_next_bit_wrap(node_possible_map.bits,
+						  nr_node_ids, node);
+	}
 
-	return &futex_queues[hash & futex_hashmask];
+	return &futex_queues[node][hash & futex_hashmask];
 }
 
 
@@ -219,6 +406,40 @@ static u64 get_inode_sequence_number(struct inode *inode)
  *
  * lock_page() might sleep, the caller should not hold a spinlock.
  */
+/*
+ * Read the node of a FUTEX2_NUMA futex, and set it to the local node if it
+ * is FUTEX_NO_NODE, so that all the users of the futex agree on the node.
+ */
+static int futex_get_node(u32 __user *naddr, int *node)
+{
+	u32 val, cur, local;
+	int ret;
+
+again:
+	if (get_user(val, naddr))
+		return -EFAULT;
+
+	if (val == (u32)FUTEX_NO_NODE) {
+		local = numa_node_id();
+		ret = futex_cmpxchg_value_locked(&cur, naddr, val, local);
+		if (ret == -EFAULT) {
+			if (fault_in_user_writeable(naddr))
+				return -EFAULT;
+			goto again;
+		}
+		if (ret)
+			goto again;
+		/* Somebody else may have set the node meanwhile */
+		val = cur == (u32)FUTEX_NO_NODE ? local : cur;
+	}
+
+	if (val >= MAX_NUMNODES || !node_possible(val))
+		return -EINVAL;
+
+	*node = val;
+	return 0;
+}
+
 int get_futex_key(u32 __user *uaddr, unsigned int flags, union futex_key *key,
 		  enum futex_access rw)
 {
@@ -227,25 +448,37 @@ int get_futex_key(u32 __user *uaddr, unsigned int flags, union futex_key *key,
 	struct page *page;
 	struct folio *folio;
 	struct address_space *mapping;
+	size_t size = sizeof(u32);
 	int err, ro = 0;
 	bool fshared;
 
 	fshared = flags & FLAGS_SHARED;
 
+	/* A NUMA futex is followed by its node */
+	if (flags & FLAGS_NUMA)
+		size *= 2;
+
 	/*
 	 * The futex address must be "naturally" aligned.
 	 */
 	key->both.offset = address % PAGE_SIZE;
-	if (unlikely((address % sizeof(u32)) != 0))
+	if (unlikely((address % size) != 0))
 		return -EINVAL;
 	address -= key->both.offset;
 
-	if (unlikely(!access_ok(uaddr, sizeof(u32))))
+	if (unlikely(!access_ok(uaddr, size)))
 		return -EFAULT;
 
 	if (unlikely(should_fail_futex(fshared)))
 		return -EFAULT;
 
+	key->both.node = FUTEX_NO_NODE;
+	if (flags & FLAGS_NUMA) {
+		err = futex_get_node(uaddr + 1, &key->both.node);
+		if (err)
+			return err;
+	}
+
 	/*
 	 * PROCESS_PRIVATE futexes are fast.
 	 * As the mm cannot disappear under us and the 'key' only needs
@@ -260,10 +493,13 @@ int get_futex_key(u32 __user *uaddr, unsigned int flags, union futex_key *key,
 		 * there is only one address space, the address is a unique key
 		 * on its own.
 		 */
-		if (IS_ENABLED(CONFIG_MMU))
+		if (IS_ENABLED(CONFIG_MMU)) {
 			key->private.mm = mm;
-		else
+			if (mm)
+				futex_private_hash_init(mm);
+		} else {
 			key->private.mm = NULL;
+		}
 
 		key->private.address = address;
 		return 0;
@@ -1128,27 +1364,35 @@ void futex_exit_release(struct task_struct *tsk)
 static int __init futex_init(void)
 {
 	unsigned long hashsize, i;
-	unsigned int futex_shift;
+	int n;
 
 #ifdef CONFIG_BASE_SMALL
 	hashsize = 16;
 #else
-	hashsize = roundup_pow_of_two(256 * num_possible_cpus());
+	hashsize = 256 * num_possible_cpus();
+	hashsize /= num_possible_nodes();
+	hashsize = max(4UL, hashsize);
+	hashsize = roundup_pow_of_two(hashsize);
 #endif
 
-	futex_queues = alloc_large_system_hash("futex", sizeof(*futex_queues),
-					       hashsize, 0, 0,
-					       &futex_shift, NULL,
-					       hashsize, hashsize);
-	hashsize = 1UL << futex_shift;
+	for_each_node(n) {
+		struct futex_hash_bucket *table;
+
+		table = kvcalloc_node(hashsize, sizeof(*table), GFP_KERNEL, n);
+		if (!table)
+			panic("Failed to allocate the futex hash table\n");
 
-	for (i = 0; i < hashsize; i++) {
-		atomic_set(&futex_queues[i].waiters, 0);
-		plist_head_init(&futex_queues[i].chain);
-		spin_lock_init(&futex_queues[i].lock);
+		for (i = 0; i < hashsize; i++)
+			futex_hash_bucket_init(&table[i]);
+		futex_queues[n] = table;
 	}
 
+	pr_info("futex hash table entries: %lu (%lu bytes on %d NUMA nodes)\n",
+		hashsize, hashsize * sizeof(struct futex_hash_bucket),
+		num_possible_nodes());
+
 	futex_hashmask = hashsize - 1;
+	futex_hashshift = ilog2(hashsize);
 	return 0;
 }
 core_initcall(futex_init);
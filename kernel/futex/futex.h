@@ -53,7 +53,7 @@ static inline unsigned int futex_to_flags(unsigned int op)
 	return flags;
 }
 
-#define FUTEX2_VALID_MASK (FUTEX2_SIZE_MASK | FUTEX2_PRIVATE)
+#define FUTEX2_VALID_MASK (FUTEX2_SIZE_MASK | FUTEX2_NUMA | FUTEX2_PRIVATE)
 
 /* FUTEX2_ to FLAGS_ */
 static inline unsigned int futex2_to_flags(unsigned int flags2)
@@ -413,12 +413,14 @@ extern int futex_wait(u32 __user *uaddr, unsigned int flags, u32 val,
  * struct futex_vector - Auxiliary struct for futex_waitv()
  * @w: Userspace provided data
  * @q: Kernel side data
+ * @hb: Hash bucket of @q, only valid during futex_wait_multiple_setup()
  *
  * Struct used to build an array with all data need for futex_waitv()
  */
 struct futex_vector {
 	struct futex_waitv w;
 	struct futex_q q;
+	struct futex_hash_bucket *hb;
 };
 
 extern int futex_parse_waitv(struct futex_vector *futexv,
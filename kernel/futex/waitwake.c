@@ -4,6 +4,7 @@
 #include <linux/sched/task.h>
 #include <linux/sched/signal.h>
 #include <linux/freezer.h>
+#include <linux/sort.h>
 
 #include "futex.h"
 
@@ -394,6 +395,33 @@ int futex_unqueue_multiple(struct futex_vector *v, int count)
 	return ret;
 }
 
+static int futex_cmp_bucket(const void *a, const void *b, const void *priv)
+{
+	const struct futex_vector *vs = priv;
+	unsigned long x = (unsigned long)vs[*(const u8 *)a].hb;
+	unsigned long y = (unsigned long)vs[*(const u8 *)b].hb;
+
+	return (x > y) - (x < y);
+}
+
+/*
+ * Unqueue the first @count futexes of @order, i.e. the ones which have been
+ * queued by futex_wait_multiple_setup(). Returns the index of the last woken
+ * futex or -1 like futex_unqueue_multiple().
+ */
+static int futex_unqueue_ordered(struct futex_vector *vs, const u8 *order,
+				 int count)
+{
+	int ret = -1, i;
+
+	for (i = 0; i < count; i++) {
+		if (!futex_unqueue(&vs[order[i]].q))
+			ret = max(ret, (int)order[i]);
+	}
+
+	return ret;
+}
+
 /**
  * futex_wait_multiple_setup - Prepare to wait and enqueue multiple futexes
  * @vs:		The futex list to wait on
@@ -413,10 +441,14 @@ int futex_unqueue_multiple(struct futex_vector *v, int count)
 int futex_wait_multiple_setup(struct futex_vector *vs, int count, int *woken)
 {
 	struct futex_hash_bucket *hb;
+	u8 order[FUTEX_WAITV_MAX];
 	bool retry = false;
-	int ret, i;
+	int ret, i, j, k;
 	u32 uval;
 
+	if (WARN_ON_ONCE(count > FUTEX_WAITV_MAX))
+		return -EINVAL;
+
 	/*
 	 * Enqueuing multiple futexes is tricky, because we need to enqueue
 	 * each futex on the list before dealing with the next one to avoid
@@ -444,26 +476,55 @@ int futex_wait_multiple_setup(struct futex_vector *vs, int count, int *woken)
 			return ret;
 	}
 
+	/*
+	 * Visit the futexes sorted by hash bucket, so that all the futexes
+	 * of a bucket are queued under a single lock round trip. A bucket is
+	 * still never locked while holding the lock of another one.
+	 */
+	for (i = 0; i < count; i++) {
+		vs[i].hb = futex_hash(&vs[i].q.key);
+		order[i] = i;
+	}
+	if (count > 1)
+		sort_r(order, count, sizeof(*order), futex_cmp_bucket, NULL, vs);
+
 	set_current_state(TASK_INTERRUPTIBLE|TASK_FREEZABLE);
 
-	for (i = 0; i < count; i++) {
-		u32 __user *uaddr = (u32 __user *)(unsigned long)vs[i].w.uaddr;
-		struct futex_q *q = &vs[i].q;
-		u32 val = vs[i].w.val;
+	for (i = 0; i < count; i = j) {
+		u32 __user *uaddr;
+		u32 val;
 
-		hb = futex_q_lock(q);
-		ret = futex_get_value_locked(&uval, uaddr);
+		hb = vs[order[i]].hb;
+		for (j = i; j < count && vs[order[j]].hb == hb; j++) {
+			/* See futex_q_lock() */
+			futex_hb_waiters_inc(hb);
+			vs[order[j]].q.lock_ptr = &hb->lock;
+		}
 
-		if (!ret && uval == val) {
-			/*
-			 * The bucket lock can't be held while dealing with the
-			 * next futex. Queue each futex at this moment so hb can
-			 * be unlocked.
-			 */
-			futex_queue(q, hb, current);
+		spin_lock(&hb->lock);
+		for (k = i; k < j; k++) {
+			struct futex_vector *v = &vs[order[k]];
+
+			uaddr = u64_to_user_ptr(v->w.uaddr);
+			val = v->w.val;
+			ret = futex_get_value_locked(&uval, uaddr);
+			if (ret || uval != val)
+				break;
+
+			__futex_queue(&v->q, hb, current);
+		}
+
+		if (k == j) {
+			spin_unlock(&hb->lock);
 			continue;
 		}
 
+		/*
+		 * Drop the waiter counts of the futexes which were not
+		 * queued, futex_q_unlock() takes care of the last one.
+		 */
+		while (--j > k)
+			futex_hb_waiters_dec(hb);
 		futex_q_unlock(hb);
 		__set_current_state(TASK_RUNNING);
 
@@ -472,7 +533,7 @@ int futex_wait_multiple_setup(struct futex_vector *vs, int count, int *woken)
 		 * was woken, we don't return error and return this index to
 		 * userspace
 		 */
-		*woken = futex_unqueue_multiple(vs, i);
+		*woken = futex_unqueue_ordered(vs, order, k);
 		if (*woken >= 0)
 			return 1;
 
@@ -37,6 +37,8 @@ struct task_struct *kthreadd_task;
 
 static LIST_HEAD(kthreads_hotplug);
 static DEFINE_MUTEX(kthreads_hotplug_lock);
+/* CPUs of isolated cpuset partitions, protected by kthreads_hotplug_lock */
+static struct cpumask kthreads_isolated;
 
 struct kthread_create_info
 {
@@ -372,8 +374,13 @@ static void kthread_fetch_affinity(struct kthread *kthread, struct cpumask *cpum
 	}
 
 	cpumask_and(cpumask, pref, housekeeping_cpumask(HK_TYPE_KTHREAD));
-	if (cpumask_empty(cpumask))
-		cpumask_copy(cpumask, housekeeping_cpumask(HK_TYPE_KTHREAD));
+	cpumask_andnot(cpumask, cpumask, &kthreads_isolated);
+	if (cpumask_empty(cpumask)) {
+		cpumask_andnot(cpumask, housekeeping_cpumask(HK_TYPE_KTHREAD),
+			       &kthreads_isolated);
+		if (cpumask_empty(cpumask))
+			cpumask_copy(cpumask, housekeeping_cpumask(HK_TYPE_KTHREAD));
+	}
 }
 
 static void kthread_affine_node(void)
@@ -895,20 +902,13 @@ int kthread_affine_preferred(struct task_struct *p, const struct cpumask *mask)
 	return ret;
 }
 
-/*
- * Re-affine kthreads according to their preferences
- * and the newly online CPU. The CPU down part is handled
- * by select_fallback_rq() which default re-affines to
- * housekeepers from other nodes in case the preferred
- * affinity doesn't apply anymore.
- */
-static int kthreads_online_cpu(unsigned int cpu)
+static int kthreads_update_affinity(void)
 {
 	cpumask_var_t affinity;
 	struct kthread *k;
 	int ret;
 
-	guard(mutex)(&kthreads_hotplug_lock);
+	lockdep_assert_held(&kthreads_hotplug_lock);
 
 	if (list_empty(&kthreads_hotplug))
 		return 0;
@@ -933,6 +933,42 @@ static int kthreads_online_cpu(unsigned int cpu)
 	return ret;
 }
 
+/*
+ * Re-affine kthreads according to their preferences
+ * and the newly online CPU. The CPU down part is handled
+ * by select_fallback_rq() which default re-affines to
+ * housekeepers from other nodes in case the preferred
+ * affinity doesn't apply anymore.
+ */
+static int kthreads_online_cpu(unsigned int cpu)
+{
+	guard(mutex)(&kthreads_hotplug_lock);
+
+	return kthreads_update_affinity();
+}
+
+/**
+ * kthreads_update_isolated - keep affine kthreads off isolated CPUs
+ * @isolated: CPUs of the isolated cpuset partitions
+ *
+ * Called by cpuset when the set of CPUs in isolated partitions changes.
+ * The kthreads with a node or preferred affinity are re-affined so that
+ * they avoid @isolated, unless that leaves them with no CPU to run on.
+ *
+ * Return: 0 on success, -errno otherwise.
+ */
+int kthreads_update_isolated(const struct cpumask *isolated)
+{
+	guard(mutex)(&kthreads_hotplug_lock);
+
+	if (cpumask_equal(&kthreads_isolated, isolated))
+		return 0;
+
+	cpumask_copy(&kthreads_isolated, isolated);
+
+	return kthreads_update_affinity();
+}
+
 static int kthreads_init(void)
 {
 	return cpuhp_setup_state(CPUHP_AP_KTHREADS_ONLINE, "kthreads:online",
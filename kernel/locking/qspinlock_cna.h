@@ -0,0 +1,314 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _GEN_CNA_LOCK_SLOWPATH
+#error "do not include this file"
+#endif
+
+#include <linux/topology.h>
+#include <linux/sched/clock.h>
+#include <linux/moduleparam.h>
+
+/*
+ * Implement a NUMA-aware version of MCS (aka CNA, or compact NUMA-aware lock).
+ *
+ * In CNA, spinning threads are organized in two queues, a primary queue for
+ * threads running on the same NUMA node as the current lock holder, and a
+ * secondary queue for threads running on other nodes. Schematically, it
+ * looks like this:
+ *
+ *    cna_node
+ *   +----------+     +--------+         +--------+
+ *   |mcs:next  | --> |mcs:next| --> ... |mcs:next| --> NULL  [Primary queue]
+ *   |mcs:locked| -.  +--------+         +--------+
+ *   +----------+  |
+ *                 `----------------------.
+ *                                        v
+ *                 +--------+         +--------+
+ *                 |mcs:next| --> ... |mcs:next|            [Secondary queue]
+ *                 +--------+         +--------+
+ *                     ^                    |
+ *                     `--------------------'
+ *
+ * N.B. locked := 1 if secondary queue is absent. Otherwise, it contains the
+ * encoded pointer to the tail of the secondary queue, which is organized as a
+ * circular list.
+ *
+ * While the lock is being held, the head of the primary queue spins on the
+ * lock word and uses that time to move the waiters of other nodes behind it
+ * onto the secondary queue. At unlock, the lock is passed to the next thread
+ * on the primary queue; the secondary queue is kept and passed along with the
+ * lock. When the primary queue runs empty, or when the lock has stayed on the
+ * same node for longer than numa_spinlock_threshold_ns, the secondary queue is
+ * spliced back in front of the primary one, so remote waiters cannot starve.
+ *
+ * The nodes are in the second cacheline of the per-CPU qnodes, which is only
+ * used by the paravirt slow path otherwise, hence the dependency on
+ * CONFIG_PARAVIRT_SPINLOCKS.
+ *
+ * For more details, see https://arxiv.org/abs/1810.05600.
+ *
+ * Authors: Alex Kogan <alex.kogan@oracle.com>
+ *          Dave Dice <dave.dice@oracle.com>
+ */
+
+#define FLUSH_SECONDARY_QUEUE	1
+
+struct cna_node {
+	struct mcs_spinlock	mcs;
+	u16			numa_node;
+	u32			encoded_tail;	/* self */
+	u64			start_time;
+};
+
+/*
+ * Maximum time the lock may stay on one NUMA node while remote waiters are
+ * parked on the secondary queue.
+ */
+static ulong numa_spinlock_threshold_ns __read_mostly = NSEC_PER_MSEC;
+core_param(numa_spinlock_threshold_ns, numa_spinlock_threshold_ns, ulong, 0644);
+
+static __always_inline bool cna_threshold_reached(struct cna_node *cn)
+{
+	return local_clock() - cn->start_time >
+		READ_ONCE(numa_spinlock_threshold_ns);
+}
+
+static __always_inline void cna_init_node(struct mcs_spinlock *node)
+{
+	struct cna_node *cn = (struct cna_node *)node;
+	int cpu = smp_processor_id();
+
+	BUILD_BUG_ON(sizeof(struct cna_node) > sizeof(struct qnode));
+
+	cn->numa_node = cpu_to_node(cpu);
+	cn->encoded_tail = encode_tail(cpu, (struct qnode *)node -
+					    this_cpu_ptr(&qnodes[0]));
+	cn->start_time = 0;
+}
+
+/*
+ * cna_splice_head -- splice the entire secondary queue onto the head of the
+ * primary queue.
+ *
+ * Returns the new primary head node or NULL on failure.
+ */
+static struct mcs_spinlock *
+cna_splice_head(struct qspinlock *lock, u32 val,
+		struct mcs_spinlock *node, struct mcs_spinlock *next)
+{
+	struct mcs_spinlock *head_2nd, *tail_2nd;
+	u32 new;
+
+	tail_2nd = decode_tail(node->locked, qnodes);
+	head_2nd = tail_2nd->next;
+
+	if (next) {
+		/*
+		 * If the primary queue is not empty, the primary tail doesn't
+		 * need to change and we can simply link the secondary tail to
+		 * the old primary head.
+		 */
+		tail_2nd->next = next;
+	} else {
+		/*
+		 * When the primary queue is empty, the secondary tail becomes
+		 * the primary tail. Speculatively break the circular link of
+		 * the secondary queue, and restore it if the tail moved.
+		 *
+		 * tail_2nd->next = NULL;	old = xchg_tail(lock, tail);
+		 *				prev = decode_tail(old);
+		 * try_cmpxchg_release(...);	WRITE_ONCE(prev->next, node);
+		 *
+		 * If the following cmpxchg() succeeds, our stores will not
+		 * collide.
+		 */
+		tail_2nd->next = NULL;
+
+		new = ((struct cna_node *)tail_2nd)->encoded_tail |
+			_Q_LOCKED_VAL;
+		if (!atomic_try_cmpxchg_release(&lock->val, &val, new)) {
+			tail_2nd->next = head_2nd;
+			return NULL;
+		}
+	}
+
+	/* The primary queue head now is what was the secondary queue head. */
+	return head_2nd;
+}
+
+static __always_inline bool cna_try_clear_tail(struct qspinlock *lock, u32 val,
+					       struct mcs_spinlock *node)
+{
+	struct mcs_spinlock *next;
+
+	/* Both queues are empty, do what MCS does */
+	if (node->locked <= 1)
+		return __try_clear_tail(lock, val, node);
+
+	/*
+	 * The primary queue is empty but there are waiters on the secondary
+	 * queue; move them back onto the primary queue and let them rip.
+	 */
+	next = cna_splice_head(lock, val, node, NULL);
+	if (!next)
+		return false;
+
+	smp_store_release(&next->locked, 1);
+	return true;
+}
+
+/*
+ * cna_splice_next -- splice the next node from the primary queue onto
+ * the secondary queue.
+ */
+static void cna_splice_next(struct mcs_spinlock *node,
+			    struct mcs_spinlock *next,
+			    struct mcs_spinlock *nnext)
+{
+	/* Remove @next from the primary queue */
+	node->next = nnext;
+
+	if (node->locked <= 1) {
+		/* Create the secondary queue */
+		next->next = next;
+	} else {
+		/* Add @next to the tail of the secondary queue */
+		struct mcs_spinlock *tail_2nd = decode_tail(node->locked, qnodes);
+		struct mcs_spinlock *head_2nd = tail_2nd->next;
+
+		tail_2nd->next = next;
+		next->next = head_2nd;
+	}
+
+	node->locked = ((struct cna_node *)next)->encoded_tail;
+}
+
+/*
+ * cna_order_queue - check whether the next waiter in the primary queue is on
+ * the same NUMA node as the lock holder; if not, and it has a waiter behind
+ * it in the primary queue, move the former onto the secondary queue.
+ *
+ * Returns true if the next waiter runs on the same NUMA node.
+ */
+static bool cna_order_queue(struct mcs_spinlock *node)
+{
+	struct mcs_spinlock *next = READ_ONCE(node->next);
+	struct mcs_spinlock *nnext;
+
+	if (!next)
+		return false;
+
+	if (((struct cna_node *)next)->numa_node ==
+	    ((struct cna_node *)node)->numa_node)
+		return true;
+
+	/* The tail can't be moved, it has to stay linked to the lock word */
+	nnext = READ_ONCE(next->next);
+	if (nnext)
+		cna_splice_next(node, next, nnext);
+
+	return false;
+}
+
+/* Abuse the pv_wait_head_or_lock() hook to get some work done */
+static __always_inline u32 cna_wait_head_or_lock(struct qspinlock *lock,
+						 struct mcs_spinlock *node)
+{
+	struct cna_node *cn = (struct cna_node *)node;
+
+	if (!cn->start_time)
+		cn->start_time = local_clock();
+
+	if (node->locked > 1 && cna_threshold_reached(cn)) {
+		cn->start_time = FLUSH_SECONDARY_QUEUE;
+		return 0;
+	}
+
+	/*
+	 * Put the time otherwise spent spin waiting on _Q_LOCKED_PENDING_MASK
+	 * to use by sorting the queue.
+	 */
+	while ((atomic_read(&lock->val) & _Q_LOCKED_PENDING_MASK) &&
+	       !cna_order_queue(node))
+		cpu_relax();
+
+	return 0; /* we lied; we didn't wait, go do so now */
+}
+
+static __always_inline void cna_lock_handoff(struct mcs_spinlock *node,
+					     struct mcs_spinlock *next)
+{
+	struct cna_node *cn = (struct cna_node *)node;
+	u32 val = 1;
+
+	if (cn->start_time == FLUSH_SECONDARY_QUEUE) {
+		/*
+		 * Splice the secondary queue onto the primary queue and pass
+		 * the lock to the longest waiting remote waiter.
+		 */
+		next = cna_splice_head(NULL, 0, node, next);
+	} else if (node->locked > 1) {
+		/* Preserve the secondary queue */
+		val = node->locked;
+
+		/* @next may have been moved by cna_order_queue() */
+		next = node->next;
+
+		/*
+		 * Pass over the NUMA node and the start time of the primary
+		 * queue, so the preference is kept and the threshold is
+		 * accounted for the whole run of local waiters.
+		 */
+		((struct cna_node *)next)->numa_node = cn->numa_node;
+		((struct cna_node *)next)->start_time = cn->start_time;
+	}
+
+	smp_store_release(&next->locked, val);
+}
+
+/*
+ * "numa_spinlock=on|off|auto", auto enables the NUMA-aware slow path when
+ * there is more than one NUMA node.
+ */
+static int numa_spinlock_flag;
+
+static int __init numa_spinlock_setup(char *str)
+{
+	if (!str)
+		return -EINVAL;
+
+	if (!strcmp(str, "auto"))
+		numa_spinlock_flag = 0;
+	else if (!strcmp(str, "on"))
+		numa_spinlock_flag = 1;
+	else if (!strcmp(str, "off"))
+		numa_spinlock_flag = -1;
+	else
+		return -EINVAL;
+
+	return 0;
+}
+early_param("numa_spinlock", numa_spinlock_setup);
+
+void __cna_queued_spin_lock_slowpath(struct qspinlock *lock, u32 val);
+
+/*
+ * Switch to the NUMA-friendly slow path for spinlocks when applicable.
+ * Called early in boot, before any other CPU is brought up, and only when
+ * the paravirt slow path is not in use.
+ */
+void __init cna_configure_spin_lock_slowpath(void)
+{
+	if (numa_spinlock_flag < 0)
+		return;
+
+	if (numa_spinlock_flag == 0 && nr_node_ids < 2)
+		return;
+
+	if (pv_ops.lock.queued_spin_lock_slowpath !=
+	    native_queued_spin_lock_slowpath)
+		return;
+
+	pv_ops.lock.queued_spin_lock_slowpath = __cna_queued_spin_lock_slowpath;
+
+	pr_info("Enabling CNA spinlock\n");
+}
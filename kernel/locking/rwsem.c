@@ -934,6 +934,50 @@ static bool rwsem_optimistic_spin(struct rw_semaphore *sem)
 	return taken;
 }
 
+/*
+ * Reader optimistic spinning on a writer owned rwsem
+ *
+ * The reader has already added its RWSEM_READER_BIAS to the count, so it
+ * owns the lock as soon as the running writer releases it, provided that no
+ * waiter has set the handoff bit meanwhile. Stop spinning when the writer
+ * isn't running, when the rwsem gets waiters or when we need to reschedule.
+ */
+static bool rwsem_reader_spin(struct rw_semaphore *sem)
+{
+	bool taken = false;
+	long count;
+
+	if (!osq_lock(&sem->osq))
+		goto done;
+
+	for (;;) {
+		enum owner_state owner_state;
+
+		owner_state = rwsem_spin_on_owner(sem);
+
+		count = atomic_long_read_acquire(&sem->count);
+		if (!(count & (RWSEM_WRITER_LOCKED | RWSEM_FLAG_HANDOFF))) {
+			taken = true;
+			break;
+		}
+
+		if (!(owner_state & (OWNER_WRITER | OWNER_NULL)) ||
+		    (count & (RWSEM_FLAG_WAITERS | RWSEM_FLAG_HANDOFF)))
+			break;
+
+		/* See rwsem_optimistic_spin() for the NULL owner case */
+		if (owner_state == OWNER_NULL &&
+		    (need_resched() || rt_or_dl_task(current)))
+			break;
+
+		cpu_relax();
+	}
+	osq_unlock(&sem->osq);
+done:
+	lockevent_cond_inc(rwsem_opt_fail, !taken);
+	return taken;
+}
+
 /*
  * Clear the owner's RWSEM_NONSPINNABLE bit if it is set. This should
  * only be called when the reader count reaches 0.
@@ -955,6 +999,11 @@ static inline bool rwsem_optimistic_spin(struct rw_semaphore *sem)
 	return false;
 }
 
+static inline bool rwsem_reader_spin(struct rw_semaphore *sem)
+{
+	return false;
+}
+
 static inline void clear_nonspinnable(struct rw_semaphore *sem) { }
 
 static inline enum owner_state
@@ -1031,6 +1080,18 @@ rwsem_down_read_slowpath(struct rw_semaphore *sem, long count, unsigned int stat
 		return sem;
 	}
 
+	/*
+	 * Reader optimistic spinning, only done while there is no waiter as
+	 * the queued ones would not be woken up with the lock.
+	 */
+	if ((count & RWSEM_WRITER_LOCKED) &&
+	    !(count & (RWSEM_FLAG_WAITERS | RWSEM_FLAG_HANDOFF)) &&
+	    rwsem_can_spin_on_owner(sem) && rwsem_reader_spin(sem)) {
+		rwsem_set_reader_owned(sem);
+		lockevent_inc(rwsem_rlock_spin);
+		return sem;
+	}
+
 queue:
 	waiter.task = current;
 	waiter.type = RWSEM_WAITING_FOR_READ;
@@ -235,6 +235,9 @@ struct rcu_data {
 	unsigned long nocb_bypass_first; /* Time (jiffies) of first enqueue. */
 	unsigned long nocb_nobypass_last; /* Last ->cblist enqueue (jiffies). */
 	int nocb_nobypass_count;	/* # ->cblist enqueues at ^^^ time. */
+	unsigned long nocb_bypass_flushes; /* # of ->nocb_bypass flushes. */
+	unsigned long nocb_lazy_early;	/* # of lazy flushes joining a GP. */
+	unsigned long nocb_bypass_max_age; /* Longest bypass stay (jiffies). */
 
 	/* The following fields are used by GP kthread, hence own cacheline. */
 	raw_spinlock_t nocb_gp_lock ____cacheline_internodealigned_in_smp;
@@ -243,6 +246,7 @@ struct rcu_data {
 	u8 nocb_gp_gp;			/* GP to wait for on last scan? */
 	unsigned long nocb_gp_seq;	/*  If so, ->gp_seq to wait for. */
 	unsigned long nocb_gp_loops;	/* # passes through wait code. */
+	unsigned long nocb_gp_wakeups;	/* # wakeups of the nocb GP thread. */
 	struct swait_queue_head nocb_gp_wq; /* For nocb kthreads to sleep on. */
 	bool nocb_cb_sleep;		/* Is the nocb CB thread asleep? */
 	struct task_struct *nocb_cb_kthread;
@@ -211,6 +211,7 @@ static bool __wake_nocb_gp(struct rcu_data *rdp_gp,
 
 	if (force || READ_ONCE(rdp_gp->nocb_gp_sleep)) {
 		WRITE_ONCE(rdp_gp->nocb_gp_sleep, false);
+		WRITE_ONCE(rdp_gp->nocb_gp_wakeups, rdp_gp->nocb_gp_wakeups + 1);
 		needwake = true;
 	}
 	raw_spin_unlock_irqrestore(&rdp_gp->nocb_gp_lock, flags);
@@ -310,6 +311,7 @@ static bool rcu_nocb_do_flush_bypass(struct rcu_data *rdp, struct rcu_head *rhp_
 {
 	struct rcu_cblist rcl;
 	struct rcu_head *rhp = rhp_in;
+	unsigned long age;
 
 	WARN_ON_ONCE(!rcu_rdp_is_offloaded(rdp));
 	rcu_lockdep_assert_cblist_protected(rdp);
@@ -318,6 +320,12 @@ static bool rcu_nocb_do_flush_bypass(struct rcu_data *rdp, struct rcu_head *rhp_
 		raw_spin_unlock(&rdp->nocb_bypass_lock);
 		return false;
 	}
+	if (rcu_cblist_n_cbs(&rdp->nocb_bypass)) {
+		age = j - rdp->nocb_bypass_first;
+		WRITE_ONCE(rdp->nocb_bypass_flushes, rdp->nocb_bypass_flushes + 1);
+		if (age > rdp->nocb_bypass_max_age)
+			WRITE_ONCE(rdp->nocb_bypass_max_age, age);
+	}
 	/* Note: ->cblist.len already accounts for ->nocb_bypass contents. */
 	if (rhp)
 		rcu_segcblist_inc_len(&rdp->cblist); /* Must precede enqueue. */
@@ -703,6 +711,13 @@ static void nocb_gp_wait(struct rcu_data *my_rdp)
 		    (time_after(j, READ_ONCE(rdp->nocb_bypass_first) + rcu_get_jiffies_lazy_flush()) ||
 		     bypass_ncbs > 2 * qhimark)) {
 			flush_bypass = true;
+		} else if (bypass_ncbs && (lazy_ncbs == bypass_ncbs) &&
+			   !rcu_segcblist_restempty(&rdp->cblist, RCU_NEXT_READY_TAIL)) {
+			// The CPU is not idle: it queued callbacks which
+			// will need a new grace period anyway, so let the
+			// lazy ones wait for that same grace period.
+			WRITE_ONCE(rdp->nocb_lazy_early, rdp->nocb_lazy_early + 1);
+			flush_bypass = true;
 		} else if (bypass_ncbs && (lazy_ncbs != bypass_ncbs) &&
 		    (time_after(j, READ_ONCE(rdp->nocb_bypass_first) + 1) ||
 		     bypass_ncbs > 2 * qhimark)) {
@@ -1606,6 +1621,11 @@ static void show_rcu_nocb_state(struct rcu_data *rdp)
 		rdp->nocb_cb_kthread ? task_state_to_char(rdp->nocb_cb_kthread) : '.',
 		rdp->nocb_cb_kthread ? (int)task_cpu(rdp->nocb_cb_kthread) : -1,
 		show_rcu_should_be_on_cpu(rdp->nocb_cb_kthread));
+	pr_info("   CB %d bypass flushes %lu lazy early %lu max age %lu GP wakeups %lu\n",
+		rdp->cpu, READ_ONCE(rdp->nocb_bypass_flushes),
+		READ_ONCE(rdp->nocb_lazy_early),
+		READ_ONCE(rdp->nocb_bypass_max_age),
+		READ_ONCE(rdp->nocb_gp_rdp->nocb_gp_wakeups));
 
 	/* It is OK for GP kthreads to have GP state. */
 	if (rdp->nocb_gp_rdp == rdp)
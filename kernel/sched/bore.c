@@ -8,14 +8,9 @@
 #define SCHED_BORE_VERSION	"6.1.0"
 
 #define BORE_PENALTY_OFFSET	(25)
-#define BORE_PENALTY_SCALE	(3180)
 #define BORE_PENALTY_SHIFT	(12)
 #define BORE_SMOOTHNESS		(40)
 #define BORE_MAX_PENALTY	((40U << BORE_PENALTY_SHIFT) - 1)
-#define BORE_CACHE_LIFETIME	(100000000)
-
-#define bore_for_each_child(p, t) \
-	list_for_each_entry((t), &(p)->children, sibling)
 
 #define bore_scale_slice(delta, score) \
 	mul_u64_u32_shr((delta), sched_prio_to_wmult[(score)], 22)
@@ -26,8 +21,30 @@
 #define bore_task_is_eligible(p) \
 	((p) && (p)->sched_class == &fair_sched_class && !(p)->exit_state)
 
-#define bore_cache_expired(bc, now) \
-	((s64)((bc)->timestamp + BORE_CACHE_LIFETIME - (now)) < 0)
+/*
+ * burst_count is bounded by BORE_SMOOTHNESS, so the divisions by it done at
+ * every tick and burst restart are replaced by a multiplication with its
+ * reciprocal, rounded up. That is exact for dividends below 2^32 / count,
+ * which penalties (below 2^18) always are.
+ */
+#define BORE_RECIP(n)		(((1ULL << 32) / (n)) + 1)
+
+static const u64 bore_recip_count[BORE_SMOOTHNESS + 1] = {
+	0,
+	BORE_RECIP(1), BORE_RECIP(2), BORE_RECIP(3), BORE_RECIP(4), BORE_RECIP(5),
+	BORE_RECIP(6), BORE_RECIP(7), BORE_RECIP(8), BORE_RECIP(9), BORE_RECIP(10),
+	BORE_RECIP(11), BORE_RECIP(12), BORE_RECIP(13), BORE_RECIP(14), BORE_RECIP(15),
+	BORE_RECIP(16), BORE_RECIP(17), BORE_RECIP(18), BORE_RECIP(19), BORE_RECIP(20),
+	BORE_RECIP(21), BORE_RECIP(22), BORE_RECIP(23), BORE_RECIP(24), BORE_RECIP(25),
+	BORE_RECIP(26), BORE_RECIP(27), BORE_RECIP(28), BORE_RECIP(29), BORE_RECIP(30),
+	BORE_RECIP(31), BORE_RECIP(32), BORE_RECIP(33), BORE_RECIP(34), BORE_RECIP(35),
+	BORE_RECIP(36), BORE_RECIP(37), BORE_RECIP(38), BORE_RECIP(39), BORE_RECIP(40)
+};
+
+static inline u32 bore_div_count(u32 v, u8 count)
+{
+	return (u64)v * bore_recip_count[count] >> 32;
+}
 
 static inline u32 log2p1_u64_u32fp(u64 v, u8 fp)
 {
@@ -38,16 +55,43 @@ static inline u32 log2p1_u64_u32fp(u64 v, u8 fp)
 	return exponent << fp | mantissa;
 }
 
-static inline u32 calc_burst_penalty(u64 burst_time)
+#ifdef CONFIG_CGROUP_SCHED
+static inline u32 bore_penalty_scale(struct task_struct *p)
+{
+	return READ_ONCE(task_group(p)->bore_penalty_scale);
+}
+
+static inline bool bore_inherit(struct task_struct *p)
+{
+	return READ_ONCE(task_group(p)->bore_inherit);
+}
+#else
+static inline u32 bore_penalty_scale(struct task_struct *p)
+{
+	return BORE_PENALTY_SCALE;
+}
+
+static inline bool bore_inherit(struct task_struct *p)
 {
-	s32 greed, tolerance, penalty, scaled_penalty;
+	return true;
+}
+#endif
+
+static inline u32 calc_burst_penalty(u64 burst_time, u32 scale)
+{
+	s32 greed, tolerance, penalty;
+	u64 scaled_penalty;
+
+	/* Below 2^(offset - 1), greed can't exceed the tolerance. */
+	if (burst_time < (1ULL << (BORE_PENALTY_OFFSET - 1)))
+		return 0;
 
 	greed = log2p1_u64_u32fp(burst_time, BORE_PENALTY_SHIFT);
 	tolerance = BORE_PENALTY_OFFSET << BORE_PENALTY_SHIFT;
 	penalty = max_t(s32, 0, (greed - tolerance));
-	scaled_penalty = penalty * BORE_PENALTY_SCALE >> 10;
+	scaled_penalty = (u64)penalty * scale >> 10;
 
-	return min_t(u32, BORE_MAX_PENALTY, scaled_penalty);
+	return min_t(u64, BORE_MAX_PENALTY, scaled_penalty);
 }
 
 static inline void reweight_task_by_prio(struct task_struct *p, int prio)
@@ -74,13 +118,15 @@ void update_burst_score(struct sched_entity *se)
 	u8 prev_prio = effective_prio(p);
 	u8 burst_score = 0, new_prio;
 
-	if (!(p->flags & PF_KTHREAD))
+	if (!(p->flags & PF_KTHREAD) && bore_penalty_scale(p))
 		burst_score = se->burst_penalty >> BORE_PENALTY_SHIFT;
 	se->burst_score = burst_score;
 
 	new_prio = effective_prio(p);
-	if (new_prio != prev_prio)
+	if (new_prio != prev_prio) {
 		reweight_task_by_prio(p, new_prio);
+		trace_sched_burst_score(p, se->burst_time, new_prio);
+	}
 }
 
 void update_curr_bore(u64 delta_exec, struct sched_entity *se)
@@ -89,19 +135,21 @@ void update_curr_bore(u64 delta_exec, struct sched_entity *se)
 		return;
 
 	se->burst_time += delta_exec;
-	se->curr_burst_penalty = calc_burst_penalty(se->burst_time);
+	se->curr_burst_penalty = calc_burst_penalty(se->burst_time,
+						     bore_penalty_scale(task_of(se)));
 	if (se->curr_burst_penalty > se->prev_burst_penalty)
 		se->burst_penalty =
 			se->prev_burst_penalty +
-			(se->curr_burst_penalty - se->prev_burst_penalty) /
-				se->burst_count;
+			bore_div_count(se->curr_burst_penalty -
+				       se->prev_burst_penalty,
+				       se->burst_count);
 	update_burst_score(se);
 }
 
 static inline u32 binary_smooth(u32 new, u32 old, u8 dumper)
 {
 	u32 abs_diff = (new > old) ? (new - old) : (old - new);
-	u32 adj_diff = (abs_diff / dumper) + ((abs_diff % dumper) != 0);
+	u32 adj_diff = bore_div_count(abs_diff + dumper - 1, dumper);
 	return (new > old) ? (old + adj_diff) : (old - adj_diff);
 }
 
@@ -119,11 +167,57 @@ static inline void __restart_burst(struct sched_entity *se)
 		se->burst_count = BORE_SMOOTHNESS;
 }
 
+static inline void bore_aggr_add(struct sched_burst_aggr *ba, u32 penalty)
+{
+	atomic_long_add(penalty, &ba->sum);
+	atomic_inc(&ba->count);
+}
+
+static inline void bore_aggr_sub(struct sched_burst_aggr *ba, u32 penalty)
+{
+	atomic_long_sub(penalty, &ba->sum);
+	atomic_dec(&ba->count);
+}
+
+/*
+ * Propagate the change of @p's penalty since it was last accounted to the
+ * aggregates of its parent (process leaders only, as only they are linked
+ * in the parent's children list) and of its thread group leader.
+ *
+ * This runs in @p's own context, without tasklist_lock, so it may race with
+ * a reparenting and leave a small error in an aggregate. That is harmless,
+ * the aggregates only seed the initial penalty of new tasks and their
+ * readers clamp them.
+ */
+static void update_burst_contrib(struct task_struct *p)
+{
+	long delta = (long)p->se.burst_penalty - (long)p->se.burst_contrib;
+
+	if (!delta || !p->pid || p->exit_state)
+		return;
+
+	p->se.burst_contrib = p->se.burst_penalty;
+
+	rcu_read_lock();
+	if (thread_group_leader(p))
+		atomic_long_add(delta, &rcu_dereference(p->real_parent)->se.child_burst.sum);
+	atomic_long_add(delta, &READ_ONCE(p->group_leader)->se.group_burst.sum);
+	rcu_read_unlock();
+}
+
 void restart_burst(struct sched_entity *se)
 {
+	u64 burst_time = se->burst_time;
+
 	__restart_burst(se);
 	se->burst_penalty = se->prev_burst_penalty;
 	update_burst_score(se);
+	if (entity_is_task(se)) {
+		struct task_struct *p = task_of(se);
+
+		update_burst_contrib(p);
+		trace_sched_burst_restart(p, burst_time, effective_prio(p));
+	}
 }
 
 void restart_burst_rescale_deadline(struct sched_entity *se)
@@ -140,74 +234,60 @@ void restart_burst_rescale_deadline(struct sched_entity *se)
 		if (unlikely(vremain < 0))
 			vscaled = -vscaled;
 		se->deadline = se->vruntime + vscaled;
+		trace_sched_burst_rescale_deadline(p, prev_prio, new_prio,
+						   vremain, vscaled);
 	}
 }
 
-static inline void update_burst_cache(struct sched_burst_cache *bc,
-				      struct task_struct *p, u32 cnt, u32 sum,
-				      u64 now)
-{
-	u32 avg = cnt ? sum / cnt : 0;
-	bc->value = max_t(u32, avg, p->se.burst_penalty);
-	bc->count = cnt;
-	bc->timestamp = now;
-}
-
-static inline void update_child_burst_direct(struct task_struct *p, u64 now)
+static inline u32 bore_aggr_value(struct sched_burst_aggr *ba,
+				  struct task_struct *p)
 {
-	u32 cnt = 0, sum = 0;
-	struct task_struct *child;
+	long sum = atomic_long_read(&ba->sum);
+	int cnt = atomic_read(&ba->count);
+	u32 avg = (cnt > 0 && sum > 0) ? min_t(long, sum / cnt, BORE_MAX_PENALTY) : 0;
 
-	bore_for_each_child(p, child) {
-		if (!bore_task_is_eligible(child))
-			continue;
-		cnt++;
-		sum += child->se.burst_penalty;
-	}
-
-	update_burst_cache(&p->se.child_burst, p, cnt, sum, now);
+	return max_t(u32, avg, p->se.burst_penalty);
 }
 
-static inline u32 inherit_burst_direct(struct task_struct *p, u64 now,
-				       u64 clone_flags)
+static inline u32 inherit_burst_direct(struct task_struct *p, u64 clone_flags)
 {
 	struct task_struct *parent = p;
-	struct sched_burst_cache *bc;
 
 	if (clone_flags & CLONE_PARENT)
 		parent = parent->real_parent;
 
-	bc = &parent->se.child_burst;
-	if (bore_cache_expired(bc, now))
-		update_child_burst_direct(parent, now);
-
-	return bc->value;
+	return bore_aggr_value(&parent->se.child_burst, parent);
 }
 
-static inline void update_tg_burst(struct task_struct *p, u64 now)
+static inline u32 inherit_burst_tg(struct task_struct *p)
 {
-	struct task_struct *task;
-	u32 cnt = 0, sum = 0;
-
-	for_each_thread(p, task) {
-		if (!bore_task_is_eligible(task))
-			continue;
-		cnt++;
-		sum += task->se.burst_penalty;
-	}
+	struct task_struct *parent = p->group_leader;
 
-	update_burst_cache(&p->se.group_burst, p, cnt, sum, now);
+	return bore_aggr_value(&parent->se.group_burst, parent);
 }
 
-static inline u32 inherit_burst_tg(struct task_struct *p, u64 now)
+/*
+ * Account the new task @p in the aggregates of its family. Called with
+ * tasklist_lock held for writing, past the last failure point of
+ * copy_process(), so that sched_exit_bore() is sure to undo it.
+ */
+static void link_burst_aggr(struct task_struct *p, struct task_struct *parent,
+			    u64 clone_flags)
 {
-	struct task_struct *parent = p->group_leader;
-	struct sched_burst_cache *bc = &parent->se.group_burst;
+	struct task_struct *leader = p;
+	u32 contrib = p->se.burst_penalty;
 
-	if (bore_cache_expired(bc, now))
-		update_tg_burst(parent, now);
+	p->se.burst_contrib = contrib;
 
-	return bc->value;
+	if (clone_flags & CLONE_THREAD) {
+		leader = parent->group_leader;
+	} else {
+		if (clone_flags & CLONE_PARENT)
+			parent = parent->real_parent;
+		bore_aggr_add(&parent->se.child_burst, contrib);
+	}
+
+	bore_aggr_add(&leader->se.group_burst, contrib);
 }
 
 void sched_clone_bore(struct task_struct *p, struct task_struct *parent,
@@ -216,19 +296,65 @@ void sched_clone_bore(struct task_struct *p, struct task_struct *parent,
 	struct sched_entity *se = &p->se;
 	u32 penalty;
 
-	if (!bore_task_is_eligible(p))
+	memset(&se->child_burst, 0, sizeof(struct sched_burst_aggr));
+	memset(&se->group_burst, 0, sizeof(struct sched_burst_aggr));
+
+	if (bore_task_is_eligible(p)) {
+		penalty = 0;
+		if (bore_inherit(p)) {
+			penalty = (clone_flags & CLONE_THREAD) ?
+				  inherit_burst_tg(parent) :
+				  inherit_burst_direct(parent, clone_flags);
+		} else {
+			/* Start from a clean slate, not from the parent's copy. */
+			se->curr_burst_penalty = 0;
+			se->prev_burst_penalty = 0;
+		}
+
+		__restart_burst(se);
+		se->burst_penalty = se->prev_burst_penalty =
+			max_t(u32, se->prev_burst_penalty, penalty);
+		se->burst_count = 1;
+	}
+
+	link_burst_aggr(p, parent, clone_flags);
+}
+
+/*
+ * @p is exiting, with tasklist_lock held for writing: drop it from the
+ * aggregates of its family.
+ */
+void sched_exit_bore(struct task_struct *p)
+{
+	if (!p->pid)
 		return;
 
-	penalty = (clone_flags & CLONE_THREAD) ?
-		  inherit_burst_tg(parent, now) :
-		  inherit_burst_direct(parent, now, clone_flags);
+	if (thread_group_leader(p))
+		bore_aggr_sub(&p->real_parent->se.child_burst, p->se.burst_contrib);
+	bore_aggr_sub(&p->group_leader->se.group_burst, p->se.burst_contrib);
+}
 
-	__restart_burst(se);
-	se->burst_penalty = se->prev_burst_penalty =
-		max_t(u32, se->prev_burst_penalty, penalty);
-	se->burst_count = 1;
-	se->child_burst.timestamp = 0;
-	se->group_burst.timestamp = 0;
+/*
+ * The children of an exiting task are being handed over to @reaper, with
+ * tasklist_lock held for writing.
+ */
+void sched_reparent_bore(struct task_struct *p, struct task_struct *reaper)
+{
+	if (p->exit_state)
+		return;
+
+	bore_aggr_add(&reaper->se.child_burst, p->se.burst_contrib);
+}
+
+/*
+ * A non-leader thread took over its thread group on exec, with tasklist_lock
+ * held for writing. The rest of the group is gone by now.
+ */
+void sched_exec_bore(struct task_struct *p)
+{
+	atomic_long_set(&p->se.group_burst.sum, p->se.burst_contrib);
+	atomic_set(&p->se.group_burst.count, 1);
+	bore_aggr_add(&p->real_parent->se.child_burst, p->se.burst_contrib);
 }
 
 void reset_task_bore(struct task_struct *p)
@@ -239,8 +365,6 @@ void reset_task_bore(struct task_struct *p)
 	p->se.burst_penalty = 0;
 	p->se.burst_score = 0;
 	p->se.burst_count = 1;
-	memset(&p->se.child_burst, 0, sizeof(struct sched_burst_cache));
-	memset(&p->se.group_burst, 0, sizeof(struct sched_burst_cache));
 }
 
 void __init sched_bore_init(void)
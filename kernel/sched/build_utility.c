@@ -41,10 +41,12 @@
 #include <linux/swait_api.h>
 #include <linux/timex.h>
 #include <linux/utsname.h>
+#include <linux/vmalloc.h>
 #include <linux/wait_api.h>
 #include <linux/workqueue_api.h>
 
 #include <uapi/linux/prctl.h>
+#include <uapi/linux/psi.h>
 #include <uapi/linux/sched/types.h>
 
 #include <asm/switch_to.h>
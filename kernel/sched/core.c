@@ -49,6 +49,7 @@
 #include <linux/kcov.h>
 #include <linux/kprobes.h>
 #include <linux/llist_api.h>
+#include <linux/memory-tiers.h>
 #include <linux/mmu_context.h>
 #include <linux/mmzone.h>
 #include <linux/mutex_api.h>
@@ -1182,7 +1183,9 @@ int get_nohz_timer_target(void)
 	struct sched_domain *sd;
 	const struct cpumask *hk_mask;
 
-	if (housekeeping_cpu(cpu, HK_TYPE_KERNEL_NOISE)) {
+	/* CPUs of isolated cpuset partitions don't take unpinned timers */
+	if (housekeeping_cpu(cpu, HK_TYPE_KERNEL_NOISE) &&
+	    !cpuset_cpu_is_isolated(cpu)) {
 		if (!idle_cpu(cpu))
 			return cpu;
 		default_cpu = cpu;
@@ -1202,8 +1205,18 @@ int get_nohz_timer_target(void)
 		}
 	}
 
-	if (default_cpu == -1)
+	/*
+	 * An isolated partition has no sched domains, so the walk above finds
+	 * nothing for its CPUs, and housekeeping_any_cpu() may well return one
+	 * of them.
+	 */
+	if (default_cpu == -1) {
+		for_each_cpu_and(i, hk_mask, cpu_online_mask) {
+			if (!cpuset_cpu_is_isolated(i))
+				return i;
+		}
 		default_cpu = housekeeping_any_cpu(HK_TYPE_KERNEL_NOISE);
+	}
 
 	return default_cpu;
 }
@@ -3735,6 +3748,7 @@ ttwu_do_activate(struct rq *rq, struct task_struct *p, int wake_flags,
 		atomic_dec(&task_rq(p)->nr_iowait);
 	}
 
+	sched_wake_hist_activate(rq, p);
 	activate_task(rq, p, en_flags);
 	wakeup_preempt(rq, p, wake_flags);
 
@@ -3881,6 +3895,7 @@ static void __ttwu_queue_wakelist(struct task_struct *p, int cpu, int wake_flags
 	struct rq *rq = cpu_rq(cpu);
 
 	p->sched_remote_wakeup = !!(wake_flags & WF_MIGRATED);
+	sched_wake_hist_queue(p);
 
 	WRITE_ONCE(rq->ttwu_pending, 1);
 	__smp_call_single_queue(cpu, &p->wake_entry.llist);
@@ -4186,6 +4201,7 @@ int try_to_wake_up(struct task_struct *p, unsigned int state, int wake_flags)
 {
 	guard(preempt)();
 	int cpu, success = 0;
+	u64 wake_start;
 
 	wake_flags |= WF_TTWU;
 
@@ -4321,7 +4337,9 @@ int try_to_wake_up(struct task_struct *p, unsigned int state, int wake_flags)
 		 */
 		smp_cond_load_acquire(&p->on_cpu, !VAL);
 
+		wake_start = sched_wake_hist_clock();
 		cpu = select_task_rq(p, p->wake_cpu, &wake_flags);
+		sched_wake_hist_since(p, SCHED_WAKE_HIST_SELECT, wake_start);
 		if (task_cpu(p) != cpu) {
 			if (p->in_iowait) {
 				delayacct_blkio_end(p);
@@ -4508,6 +4526,7 @@ static void __sched_fork(unsigned long clone_flags, struct task_struct *p)
 #ifdef CONFIG_SCHEDSTATS
 	/* Even if schedstat is disabled, there should not be garbage */
 	memset(&p->stats, 0, sizeof(p->stats));
+	memset(&p->wake_stats, 0, sizeof(p->wake_stats));
 #endif
 
 	init_dl_entity(&p->dl);
@@ -4566,10 +4585,11 @@ static void reset_memory_tiering(void)
 	struct pglist_data *pgdat;
 
 	for_each_online_pgdat(pgdat) {
-		pgdat->nbp_threshold = 0;
-		pgdat->nbp_th_nr_cand = node_page_state(pgdat, PGPROMOTE_CANDIDATE);
-		pgdat->nbp_th_start = jiffies_to_msecs(jiffies);
+		pgdat->nbp.threshold = 0;
+		pgdat->nbp.th_nr_cand = node_page_state(pgdat, PGPROMOTE_CANDIDATE);
+		pgdat->nbp.th_start = jiffies_to_msecs(jiffies);
 	}
+	memtier_reset_promote_pairs();
 }
 
 static int sysctl_numa_balancing(const struct ctl_table *table, int write,
@@ -4660,6 +4680,49 @@ static int sysctl_schedstats(const struct ctl_table *table, int write, void *buf
 		set_schedstats(state);
 	return err;
 }
+
+/*
+ * The wakeup stamps are left behind when the key is disabled, and would be
+ * taken for the start of the first wakeup seen after it is enabled again.
+ * Clear them while the key is still off, so nothing stamps them meanwhile.
+ */
+static void sched_wake_hist_reset_stamps(void)
+{
+	struct task_struct *g, *p;
+
+	guard(rcu)();
+	for_each_process_thread(g, p) {
+		WRITE_ONCE(p->wake_stats.queued, 0);
+		WRITE_ONCE(p->wake_stats.enqueued, 0);
+	}
+}
+
+static int sysctl_sched_wake_hist(const struct ctl_table *table, int write,
+				  void *buffer, size_t *lenp, loff_t *ppos)
+{
+	struct ctl_table t;
+	int err;
+	int state = static_branch_likely(&sched_wake_hist);
+
+	if (write && !capable(CAP_SYS_ADMIN))
+		return -EPERM;
+
+	t = *table;
+	t.data = &state;
+	err = proc_dointvec_minmax(&t, write, buffer, lenp, ppos);
+	if (err < 0)
+		return err;
+	if (write) {
+		if (state) {
+			if (!static_key_enabled(&sched_wake_hist))
+				sched_wake_hist_reset_stamps();
+			static_branch_enable(&sched_wake_hist);
+		} else {
+			static_branch_disable(&sched_wake_hist);
+		}
+	}
+	return err;
+}
 #endif /* CONFIG_PROC_SYSCTL */
 #endif /* CONFIG_SCHEDSTATS */
 
@@ -4675,6 +4738,15 @@ static const struct ctl_table sched_core_sysctls[] = {
 		.extra1         = SYSCTL_ZERO,
 		.extra2         = SYSCTL_ONE,
 	},
+	{
+		.procname       = "sched_wake_hist",
+		.data           = NULL,
+		.maxlen         = sizeof(unsigned int),
+		.mode           = 0644,
+		.proc_handler   = sysctl_sched_wake_hist,
+		.extra1         = SYSCTL_ZERO,
+		.extra2         = SYSCTL_ONE,
+	},
 #endif /* CONFIG_SCHEDSTATS */
 #ifdef CONFIG_UCLAMP_TASK
 	{
@@ -5169,6 +5241,35 @@ static inline void kmap_local_sched_in(void)
 #endif
 }
 
+#ifdef CONFIG_CPU_FREQ
+/*
+ * Let the cpufreq driver program per-task performance hints for @next: RT
+ * and DL tasks ask for full capacity, the idle task for nothing and fair
+ * tasks for their effective uclamp_min.
+ */
+static inline void cpufreq_task_switch(struct rq *rq, struct task_struct *next)
+{
+	struct task_switch_data *data;
+	unsigned long min_util;
+
+	data = rcu_dereference_sched(*per_cpu_ptr(&cpufreq_task_switch_data,
+						  cpu_of(rq)));
+	if (!data)
+		return;
+
+	if (next == rq->idle)
+		min_util = 0;
+	else if (rt_or_dl_task(next))
+		min_util = SCHED_CAPACITY_SCALE;
+	else
+		min_util = uclamp_eff_value(next, UCLAMP_MIN);
+
+	data->func(data, next, min_util);
+}
+#else
+static inline void cpufreq_task_switch(struct rq *rq, struct task_struct *next) { }
+#endif
+
 /**
  * prepare_task_switch - prepare to switch tasks
  * @rq: the runqueue preparing to switch
@@ -5188,6 +5289,7 @@ prepare_task_switch(struct rq *rq, struct task_struct *prev,
 {
 	kcov_prepare_switch(prev);
 	sched_info_switch(rq, prev, next);
+	cpufreq_task_switch(rq, next);
 	perf_event_task_sched_out(prev, next);
 	rseq_preempt(prev);
 	fire_sched_out_preempt_notifiers(prev, next);
@@ -8611,6 +8713,10 @@ void __init sched_init(void)
 	list_add(&root_task_group.list, &task_groups);
 	INIT_LIST_HEAD(&root_task_group.children);
 	INIT_LIST_HEAD(&root_task_group.siblings);
+#ifdef CONFIG_SCHED_BORE
+	root_task_group.bore_penalty_scale = BORE_PENALTY_SCALE;
+	root_task_group.bore_inherit = 1;
+#endif
 	autogroup_init(&init_task);
 #endif /* CONFIG_CGROUP_SCHED */
 
@@ -8987,6 +9093,9 @@ static inline void alloc_uclamp_sched_group(struct task_group *tg,
 
 static void sched_free_group(struct task_group *tg)
 {
+#ifdef CONFIG_SCHEDSTATS
+	free_percpu(tg->wake_hist);
+#endif
 	free_fair_sched_group(tg);
 	free_rt_sched_group(tg);
 	autogroup_free(tg);
@@ -9018,6 +9127,12 @@ struct task_group *sched_create_group(struct task_group *parent)
 	if (!tg)
 		return ERR_PTR(-ENOMEM);
 
+#ifdef CONFIG_SCHEDSTATS
+	tg->wake_hist = alloc_percpu(struct sched_wake_hist);
+	if (!tg->wake_hist)
+		goto err;
+#endif
+
 	if (!alloc_fair_sched_group(tg, parent))
 		goto err;
 
@@ -9026,6 +9141,11 @@ struct task_group *sched_create_group(struct task_group *parent)
 
 	scx_tg_init(tg);
 	alloc_uclamp_sched_group(tg, parent);
+	tg->timer_slack_ns = READ_ONCE(parent->timer_slack_ns);
+#ifdef CONFIG_SCHED_BORE
+	tg->bore_penalty_scale = READ_ONCE(parent->bore_penalty_scale);
+	tg->bore_inherit = READ_ONCE(parent->bore_inherit);
+#endif
 
 	return tg;
 
@@ -9233,13 +9353,47 @@ static int cpu_cgroup_can_attach(struct cgroup_taskset *tset)
 	return scx_cgroup_can_attach(tset);
 }
 
+/* Serializes cpu.timer_slack writes against task attach */
+static DEFINE_MUTEX(tg_timer_slack_mutex);
+
+/*
+ * Apply the timer slack @new of a task's group, which was @old. The slack the
+ * task had before a group value applied is kept in ->saved_timer_slack_ns and
+ * restored when the group stops setting one. A prctl() or /proc write clears
+ * ->saved_timer_slack_ns, and the slack it set is then left alone.
+ */
+static void tg_update_timer_slack(struct task_struct *p, u64 old, u64 new)
+{
+	/* rt-policy tasks do not have a timerslack */
+	if (old == new || rt_or_dl_task_policy(p))
+		return;
+
+	task_lock(p);
+	if (new) {
+		if (!p->saved_timer_slack_ns)
+			p->saved_timer_slack_ns = p->timer_slack_ns;
+		WRITE_ONCE(p->timer_slack_ns, new);
+	} else if (p->saved_timer_slack_ns) {
+		WRITE_ONCE(p->timer_slack_ns, p->saved_timer_slack_ns);
+		p->saved_timer_slack_ns = 0;
+	}
+	task_unlock(p);
+}
+
 static void cpu_cgroup_attach(struct cgroup_taskset *tset)
 {
 	struct task_struct *task;
 	struct cgroup_subsys_state *css;
 
-	cgroup_taskset_for_each(task, css, tset)
+	mutex_lock(&tg_timer_slack_mutex);
+	cgroup_taskset_for_each(task, css, tset) {
+		u64 old_slack = READ_ONCE(task->sched_task_group->timer_slack_ns);
+
 		sched_move_task(task, false);
+		tg_update_timer_slack(task, old_slack,
+				      READ_ONCE(css_tg(css)->timer_slack_ns));
+	}
+	mutex_unlock(&tg_timer_slack_mutex);
 
 	scx_cgroup_finish_attach();
 }
@@ -9844,6 +9998,69 @@ static int cpu_idle_write_s64(struct cgroup_subsys_state *css,
 }
 #endif
 
+#ifdef CONFIG_SCHED_BORE
+static u64 cpu_bore_penalty_scale_read_u64(struct cgroup_subsys_state *css,
+					   struct cftype *cft)
+{
+	return READ_ONCE(css_tg(css)->bore_penalty_scale);
+}
+
+static int cpu_bore_penalty_scale_write_u64(struct cgroup_subsys_state *css,
+					    struct cftype *cft, u64 scale)
+{
+	if (scale > BORE_PENALTY_SCALE_MAX)
+		return -ERANGE;
+
+	WRITE_ONCE(css_tg(css)->bore_penalty_scale, scale);
+	return 0;
+}
+
+static u64 cpu_bore_inherit_read_u64(struct cgroup_subsys_state *css,
+				     struct cftype *cft)
+{
+	return READ_ONCE(css_tg(css)->bore_inherit);
+}
+
+static int cpu_bore_inherit_write_u64(struct cgroup_subsys_state *css,
+				      struct cftype *cft, u64 inherit)
+{
+	if (inherit > 1)
+		return -ERANGE;
+
+	WRITE_ONCE(css_tg(css)->bore_inherit, inherit);
+	return 0;
+}
+#endif
+
+static u64 cpu_timer_slack_read_u64(struct cgroup_subsys_state *css,
+				    struct cftype *cft)
+{
+	return READ_ONCE(css_tg(css)->timer_slack_ns);
+}
+
+static int cpu_timer_slack_write_u64(struct cgroup_subsys_state *css,
+				     struct cftype *cft, u64 slack)
+{
+	struct task_group *tg = css_tg(css);
+	struct css_task_iter it;
+	struct task_struct *p;
+	u64 old;
+
+	if (slack > NSEC_PER_SEC)
+		return -ERANGE;
+
+	guard(mutex)(&tg_timer_slack_mutex);
+	old = READ_ONCE(tg->timer_slack_ns);
+	WRITE_ONCE(tg->timer_slack_ns, slack);
+
+	css_task_iter_start(css, 0, &it);
+	while ((p = css_task_iter_next(&it)))
+		tg_update_timer_slack(p, old, slack);
+	css_task_iter_end(&it);
+
+	return 0;
+}
+
 static struct cftype cpu_legacy_files[] = {
 #ifdef CONFIG_GROUP_SCHED_WEIGHT
 	{
@@ -9908,12 +10125,36 @@ static struct cftype cpu_legacy_files[] = {
 		.write = cpu_uclamp_max_write,
 	},
 #endif
+	{
+		.name = "timer_slack",
+		.flags = CFTYPE_NOT_ON_ROOT,
+		.read_u64 = cpu_timer_slack_read_u64,
+		.write_u64 = cpu_timer_slack_write_u64,
+	},
 	{ }	/* Terminate */
 };
 
 static int cpu_extra_stat_show(struct seq_file *sf,
 			       struct cgroup_subsys_state *css)
 {
+#ifdef CONFIG_SCHEDSTATS
+	if (sched_wake_hist_enabled()) {
+		struct task_group *tg = css_tg(css);
+		struct sched_wake_hist sum = { };
+		int cpu, i, j;
+
+		if (tg->wake_hist) {
+			for_each_possible_cpu(cpu) {
+				struct sched_wake_hist *h = per_cpu_ptr(tg->wake_hist, cpu);
+
+				for (i = 0; i < NR_SCHED_WAKE_HIST; i++)
+					for (j = 0; j < SCHED_WAKE_HIST_BUCKETS; j++)
+						sum.count[i][j] += READ_ONCE(h->count[i][j]);
+			}
+			sched_wake_hist_show(sf, &sum);
+		}
+	}
+#endif
 #ifdef CONFIG_CFS_BANDWIDTH
 	{
 		struct task_group *tg = css_tg(css);
@@ -10125,6 +10366,26 @@ static struct cftype cpu_files[] = {
 		.write = cpu_uclamp_max_write,
 	},
 #endif
+#ifdef CONFIG_SCHED_BORE
+	{
+		.name = "bore.penalty_scale",
+		.flags = CFTYPE_NOT_ON_ROOT,
+		.read_u64 = cpu_bore_penalty_scale_read_u64,
+		.write_u64 = cpu_bore_penalty_scale_write_u64,
+	},
+	{
+		.name = "bore.inherit",
+		.flags = CFTYPE_NOT_ON_ROOT,
+		.read_u64 = cpu_bore_inherit_read_u64,
+		.write_u64 = cpu_bore_inherit_write_u64,
+	},
+#endif
+	{
+		.name = "timer_slack",
+		.flags = CFTYPE_NOT_ON_ROOT,
+		.read_u64 = cpu_timer_slack_read_u64,
+		.write_u64 = cpu_timer_slack_write_u64,
+	},
 	{ }	/* terminate */
 };
 
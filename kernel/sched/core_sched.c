@@ -241,6 +241,7 @@ void __sched_core_account_forceidle(struct rq *rq)
 {
 	const struct cpumask *smt_mask = cpu_smt_mask(cpu_of(rq));
 	u64 delta, now = rq_clock(rq->core);
+	u64 idle_delta;
 	struct rq *rq_i;
 	struct task_struct *p;
 	int i;
@@ -257,6 +258,7 @@ void __sched_core_account_forceidle(struct rq *rq)
 		return;
 
 	rq->core->core_forceidle_start = now;
+	idle_delta = delta;
 
 	if (WARN_ON_ONCE(!rq->core->core_forceidle_occupation)) {
 		/* can't be forced idle without a running task */
@@ -275,8 +277,12 @@ void __sched_core_account_forceidle(struct rq *rq)
 		rq_i = cpu_rq(i);
 		p = rq_i->core_pick ?: rq_i->curr;
 
-		if (p == rq_i->idle)
+		if (p == rq_i->idle) {
+			/* Idle with runnable tasks: forced idle by a cookie mismatch */
+			if (rq_i->nr_running)
+				rq_i->core_forceidle_sum += idle_delta;
 			continue;
+		}
 
 		/*
 		 * Note: this will account forceidle to the current CPU, even
@@ -57,6 +57,54 @@ void cpufreq_remove_update_util_hook(int cpu)
 }
 EXPORT_SYMBOL_GPL(cpufreq_remove_update_util_hook);
 
+DEFINE_PER_CPU(struct task_switch_data __rcu *, cpufreq_task_switch_data);
+
+/**
+ * cpufreq_add_task_switch_hook - Populate the CPU's task_switch_data pointer.
+ * @cpu: The CPU to set the pointer for.
+ * @data: New pointer value.
+ * @func: Callback function to set for the CPU.
+ *
+ * Set and publish the task_switch_data pointer for the given CPU.
+ *
+ * @func is called on @cpu by the scheduler right before switching to a new
+ * task, with the rq lock held and interrupts disabled, so it must not sleep
+ * and should be cheap. It is passed the incoming task and its minimum
+ * utilization request in capacity units: SCHED_CAPACITY_SCALE for RT and
+ * DL tasks, the effective uclamp_min otherwise. This allows drivers to
+ * program per-task performance hints which the hardware applies immediately.
+ *
+ * The task_switch_data pointer of @cpu must be NULL when this function is
+ * called or it will WARN() and return with no effect.
+ */
+void cpufreq_add_task_switch_hook(int cpu, struct task_switch_data *data,
+			void (*func)(struct task_switch_data *data,
+				     struct task_struct *next,
+				     unsigned long min_util))
+{
+	if (WARN_ON(!data || !func))
+		return;
+
+	if (WARN_ON(per_cpu(cpufreq_task_switch_data, cpu)))
+		return;
+
+	data->func = func;
+	rcu_assign_pointer(per_cpu(cpufreq_task_switch_data, cpu), data);
+}
+EXPORT_SYMBOL_GPL(cpufreq_add_task_switch_hook);
+
+/**
+ * cpufreq_remove_task_switch_hook - Clear the CPU's task_switch_data pointer.
+ * @cpu: The CPU to clear the pointer for.
+ *
+ * Same rules as for cpufreq_remove_update_util_hook() apply.
+ */
+void cpufreq_remove_task_switch_hook(int cpu)
+{
+	rcu_assign_pointer(per_cpu(cpufreq_task_switch_data, cpu), NULL);
+}
+EXPORT_SYMBOL_GPL(cpufreq_remove_task_switch_hook);
+
 /**
  * cpufreq_this_cpu_can_update - Check if cpufreq policy can be updated.
  * @policy: cpufreq policy to check.
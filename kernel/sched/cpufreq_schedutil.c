@@ -8,9 +8,13 @@
 
 #define IOWAIT_BOOST_MIN	(SCHED_CAPACITY_SCALE / 8)
 
+/* Minimum interval between two PSI samples of the responsive mode */
+#define RESPONSIVE_SAMPLE_NS	(NSEC_PER_MSEC / 2)
+
 struct sugov_tunables {
 	struct gov_attr_set	attr_set;
 	unsigned int		rate_limit_us;
+	unsigned int		responsive_halflife_us;
 };
 
 struct sugov_policy {
@@ -22,6 +26,7 @@ struct sugov_policy {
 	raw_spinlock_t		update_lock;
 	u64			last_freq_update_time;
 	s64			freq_update_delay_ns;
+	u64			resp_halflife_ns;
 	unsigned int		next_freq;
 	unsigned int		cached_raw_freq;
 
@@ -49,6 +54,11 @@ struct sugov_cpu {
 	unsigned long		util;
 	unsigned long		bw_min;
 
+	/* The fields below are only used in the responsive mode: */
+	unsigned long		resp_boost;
+	u64			resp_time;
+	u32			resp_stall;
+
 	/* The field below is for single-CPU policies only: */
 #ifdef CONFIG_NO_HZ_COMMON
 	unsigned long		saved_idle_calls;
@@ -352,6 +362,69 @@ static unsigned long sugov_iowait_apply(struct sugov_cpu *sg_cpu, u64 time,
 	return (sg_cpu->iowait_boost * max_cap) >> SCHED_CAPACITY_SHIFT;
 }
 
+/**
+ * sugov_responsive_boost() - Update the latency boost of a CPU.
+ * @sg_cpu: the sugov data for the CPU to boost
+ * @time: the update time from the caller
+ * @max_cap: the max CPU capacity
+ *
+ * In the responsive mode (responsive_halflife_us != 0), the fraction of time
+ * tasks spent runnable but waiting for the CPU, as tracked by the PSI cpu
+ * "some" state, is turned into a utilization boost. If latency sensitive tasks
+ * are waiting, the boost is raised to at least their uclamp_min right away.
+ * The boost decays with the configured half-life, so that the frequency is
+ * raised as soon as tasks start to queue up, well before the PELT signals catch
+ * up, and comes back down smoothly afterwards.
+ *
+ * Increasing the boost above the last requested utilization bypasses the rate
+ * limit, decreasing it does not.
+ */
+static void sugov_responsive_boost(struct sugov_cpu *sg_cpu, u64 time,
+				   unsigned long max_cap)
+{
+	struct sugov_policy *sg_policy = sg_cpu->sg_policy;
+	u64 halflife = READ_ONCE(sg_policy->resp_halflife_ns);
+	u64 delta_ns = time - sg_cpu->resp_time;
+	unsigned long boost = sg_cpu->resp_boost;
+	unsigned long target;
+	u32 stall, delta_stall;
+	u64 rem;
+
+	if (!halflife) {
+		sg_cpu->resp_boost = 0;
+		return;
+	}
+
+	if (delta_ns < RESPONSIVE_SAMPLE_NS)
+		return;
+
+	stall = psi_cpu_some_time(sg_cpu->cpu);
+	delta_stall = stall - sg_cpu->resp_stall;
+	sg_cpu->resp_stall = stall;
+	sg_cpu->resp_time = time;
+
+	/* Decay the previous boost by 2^(-delta_ns / halflife) */
+	if (delta_ns >= halflife * BITS_PER_LONG) {
+		boost = 0;
+	} else {
+		boost >>= div64_u64_rem(delta_ns, halflife, &rem);
+		boost -= mul_u64_u64_div_u64(boost, rem, 2 * halflife);
+	}
+
+	target = div64_u64((u64)min_t(u64, delta_stall, delta_ns) * max_cap,
+			   delta_ns);
+	if (target)
+		target = max(target, uclamp_rq_get(cpu_rq(sg_cpu->cpu), UCLAMP_MIN));
+
+	if (target > boost) {
+		boost = min(target, max_cap);
+		if (boost > sg_cpu->util)
+			sg_policy->need_freq_update = true;
+	}
+
+	sg_cpu->resp_boost = boost;
+}
+
 #ifdef CONFIG_NO_HZ_COMMON
 static bool sugov_hold_freq(struct sugov_cpu *sg_cpu)
 {
@@ -403,13 +476,14 @@ static inline bool sugov_update_single_common(struct sugov_cpu *sg_cpu,
 	sugov_iowait_boost(sg_cpu, time, flags);
 	sg_cpu->last_update = time;
 
+	sugov_responsive_boost(sg_cpu, time, max_cap);
 	ignore_dl_rate_limit(sg_cpu);
 
 	if (!sugov_should_update_freq(sg_cpu->sg_policy, time))
 		return false;
 
 	boost = sugov_iowait_apply(sg_cpu, time, max_cap);
-	sugov_get_util(sg_cpu, boost);
+	sugov_get_util(sg_cpu, max(boost, sg_cpu->resp_boost));
 
 	return true;
 }
@@ -500,7 +574,7 @@ static unsigned int sugov_next_freq_shared(struct sugov_cpu *sg_cpu, u64 time)
 		unsigned long boost;
 
 		boost = sugov_iowait_apply(j_sg_cpu, time, max_cap);
-		sugov_get_util(j_sg_cpu, boost);
+		sugov_get_util(j_sg_cpu, max(boost, j_sg_cpu->resp_boost));
 
 		util = max(j_sg_cpu->util, util);
 	}
@@ -520,6 +594,7 @@ sugov_update_shared(struct update_util_data *hook, u64 time, unsigned int flags)
 	sugov_iowait_boost(sg_cpu, time, flags);
 	sg_cpu->last_update = time;
 
+	sugov_responsive_boost(sg_cpu, time, arch_scale_cpu_capacity(sg_cpu->cpu));
 	ignore_dl_rate_limit(sg_cpu);
 
 	if (sugov_should_update_freq(sg_policy, time)) {
@@ -609,8 +684,38 @@ rate_limit_us_store(struct gov_attr_set *attr_set, const char *buf, size_t count
 
 static struct governor_attr rate_limit_us = __ATTR_RW(rate_limit_us);
 
+static ssize_t responsive_halflife_us_show(struct gov_attr_set *attr_set, char *buf)
+{
+	struct sugov_tunables *tunables = to_sugov_tunables(attr_set);
+
+	return sprintf(buf, "%u\n", tunables->responsive_halflife_us);
+}
+
+static ssize_t
+responsive_halflife_us_store(struct gov_attr_set *attr_set, const char *buf,
+			     size_t count)
+{
+	struct sugov_tunables *tunables = to_sugov_tunables(attr_set);
+	struct sugov_policy *sg_policy;
+	unsigned int halflife_us;
+
+	if (kstrtouint(buf, 10, &halflife_us))
+		return -EINVAL;
+
+	tunables->responsive_halflife_us = halflife_us;
+
+	list_for_each_entry(sg_policy, &attr_set->policy_list, tunables_hook)
+		WRITE_ONCE(sg_policy->resp_halflife_ns,
+			   (u64)halflife_us * NSEC_PER_USEC);
+
+	return count;
+}
+
+static struct governor_attr responsive_halflife_us = __ATTR_RW(responsive_halflife_us);
+
 static struct attribute *sugov_attrs[] = {
 	&rate_limit_us.attr,
+	&responsive_halflife_us.attr,
 	NULL
 };
 ATTRIBUTE_GROUPS(sugov);
@@ -845,6 +950,7 @@ static int sugov_start(struct cpufreq_policy *policy)
 	unsigned int cpu;
 
 	sg_policy->freq_update_delay_ns	= sg_policy->tunables->rate_limit_us * NSEC_PER_USEC;
+	sg_policy->resp_halflife_ns	= (u64)sg_policy->tunables->responsive_halflife_us * NSEC_PER_USEC;
 	sg_policy->last_freq_update_time	= 0;
 	sg_policy->next_freq			= 0;
 	sg_policy->work_in_progress		= false;
@@ -536,6 +536,10 @@ static __init int sched_init_debug(void)
 
 	debugfs_fair_server_init();
 
+#ifdef CONFIG_SCHED_SSS
+	sss_debugfs_init(debugfs_sched);
+#endif
+
 	return 0;
 }
 late_initcall(sched_init_debug);
@@ -990,6 +994,14 @@ do {									\
 		P(sched_goidle);
 		P(ttwu_count);
 		P(ttwu_local);
+#ifdef CONFIG_SCHED_SSS
+		P(sss_llc_fallback);
+#endif
+#ifdef CONFIG_SCHED_CORE
+		P(ttwu_cookie_avoid);
+		SEQ_printf(m, "  .%-30s: %Ld.%06ld\n", "core_forceidle_sum",
+			   SPLIT_NS(rq->core_forceidle_sum));
+#endif
 	}
 #undef P
 
@@ -1242,6 +1254,11 @@ void proc_sched_show_task(struct task_struct *p, struct pid_namespace *ns,
 #endif
 	}
 
+#ifdef CONFIG_SCHEDSTATS
+	if (sched_wake_hist_enabled())
+		sched_wake_hist_show(m, &p->wake_stats.hist);
+#endif
+
 	__P(nr_switches);
 	__PS("nr_voluntary_switches", p->nvcsw);
 	__PS("nr_involuntary_switches", p->nivcsw);
@@ -1293,6 +1310,7 @@ void proc_sched_set_task(struct task_struct *p)
 {
 #ifdef CONFIG_SCHEDSTATS
 	memset(&p->stats, 0, sizeof(p->stats));
+	memset(&p->wake_stats.hist, 0, sizeof(p->wake_stats.hist));
 #endif
 }
 
@@ -992,12 +992,35 @@ static const struct rhashtable_params dsq_hash_params = {
 static struct rhashtable dsq_hash;
 static LLIST_HEAD(dsqs_to_free);
 
+/*
+ * A domain DSQ, created by passing an ID with %SCX_DSQ_FLAG_LLC set to
+ * scx_bpf_create_dsq(), is backed by one queue per LLC. The queues are
+ * allocated on the node of their LLC and each has its own lock, so CPUs in
+ * different LLCs don't contend on the same DSQ lock. The DSQ in the hash table
+ * is the parent and is used for CPUs whose LLC didn't exist when the DSQ was
+ * created.
+ *
+ * All domain DSQs are on scx_llc_dsq_list so that CPUs which are about to go
+ * idle can steal from the queues of the sibling LLCs.
+ */
+struct scx_llc_dsqs {
+	struct list_head	node;		/* on scx_llc_dsq_list */
+	struct scx_dispatch_q	*parent;
+	struct scx_dispatch_q	**cpu_dsqs;	/* LLC queue of each CPU */
+	u32			nr;
+	struct scx_dispatch_q	*dsqs[];	/* one per LLC */
+};
+
+static LIST_HEAD(scx_llc_dsq_list);
+static DEFINE_RAW_SPINLOCK(scx_llc_dsq_lock);
+
 /* dispatch buf */
 struct scx_dsp_buf_ent {
 	struct task_struct	*task;
 	unsigned long		qseq;
 	u64			dsq_id;
 	u64			enq_flags;
+	struct rq		*src_rq;	/* for batched local dispatches */
 };
 
 static u32 scx_dsp_max_batch;
@@ -1094,6 +1117,26 @@ static struct scx_dispatch_q *find_user_dsq(u64 dsq_id)
 	return rhashtable_lookup_fast(&dsq_hash, &dsq_id, dsq_hash_params);
 }
 
+/* Resolve a domain DSQ to the queue of @cpu's LLC, other DSQs to themselves. */
+static struct scx_dispatch_q *find_llc_dsq(struct scx_dispatch_q *dsq, s32 cpu)
+{
+	if (!dsq->llc)
+		return dsq;
+	return dsq->llc->cpu_dsqs[cpu] ?: dsq;
+}
+
+/* Number of tasks on @dsq, including the per-LLC queues of a domain DSQ. */
+static u32 dsq_nr_queued(struct scx_dispatch_q *dsq)
+{
+	u32 i, nr = READ_ONCE(dsq->nr);
+
+	if (dsq->llc)
+		for (i = 0; i < dsq->llc->nr; i++)
+			nr += READ_ONCE(dsq->llc->dsqs[i]->nr);
+
+	return nr;
+}
+
 /*
  * scx_kf_mask enforcement. Some kfuncs can only be called from specific SCX
  * ops. When invoking SCX ops, SCX_CALL_OP[_RET]() should be used to indicate
@@ -1541,6 +1584,12 @@ struct scx_event_stats {
 	 */
 	s64		SCX_EV_DISPATCH_KEEP_LAST;
 
+	/*
+	 * The number of times that a CPU which was about to go idle stole a
+	 * task from the queue of a sibling LLC of a domain DSQ.
+	 */
+	s64		SCX_EV_DISPATCH_LLC_STEAL;
+
 	/*
 	 * If SCX_OPS_ENQ_EXITING is not set, the number of times that a task
 	 * is dispatched to a local DSQ when exiting.
@@ -2062,7 +2111,7 @@ static struct scx_dispatch_q *find_dsq_for_dispatch(struct rq *rq, u64 dsq_id,
 		return find_global_dsq(p);
 	}
 
-	return dsq;
+	return find_llc_dsq(dsq, task_cpu(p));
 }
 
 static void mark_direct_dispatch(struct task_struct *ddsp_task,
@@ -2452,17 +2501,12 @@ static void move_local_task_to_local_dsq(struct task_struct *p, u64 enq_flags,
 }
 
 #ifdef CONFIG_SMP
-/**
- * move_remote_task_to_local_dsq - Move a task from a foreign rq to a local DSQ
- * @p: task to move
- * @enq_flags: %SCX_ENQ_*
- * @src_rq: rq to move the task from, locked on entry, released on return
- * @dst_rq: rq to move the task into, locked on return
- *
- * Move @p which is currently on @src_rq to @dst_rq's local DSQ.
+/*
+ * Take @p off @src_rq, which must be locked and stays locked, and point it at
+ * @dst_rq. attach_remote_task() enqueues it there once @dst_rq is locked.
  */
-static void move_remote_task_to_local_dsq(struct task_struct *p, u64 enq_flags,
-					  struct rq *src_rq, struct rq *dst_rq)
+static void detach_remote_task(struct task_struct *p, struct rq *src_rq,
+			       struct rq *dst_rq)
 {
 	lockdep_assert_rq_held(src_rq);
 
@@ -2470,9 +2514,12 @@ static void move_remote_task_to_local_dsq(struct task_struct *p, u64 enq_flags,
 	deactivate_task(src_rq, p, 0);
 	set_task_cpu(p, cpu_of(dst_rq));
 	p->scx.sticky_cpu = cpu_of(dst_rq);
+}
 
-	raw_spin_rq_unlock(src_rq);
-	raw_spin_rq_lock(dst_rq);
+static void attach_remote_task(struct task_struct *p, u64 enq_flags,
+			       struct rq *dst_rq)
+{
+	lockdep_assert_rq_held(dst_rq);
 
 	/*
 	 * We want to pass scx-specific enq_flags but activate_task() will
@@ -2486,6 +2533,26 @@ static void move_remote_task_to_local_dsq(struct task_struct *p, u64 enq_flags,
 	dst_rq->scx.extra_enq_flags = 0;
 }
 
+/**
+ * move_remote_task_to_local_dsq - Move a task from a foreign rq to a local DSQ
+ * @p: task to move
+ * @enq_flags: %SCX_ENQ_*
+ * @src_rq: rq to move the task from, locked on entry, released on return
+ * @dst_rq: rq to move the task into, locked on return
+ *
+ * Move @p which is currently on @src_rq to @dst_rq's local DSQ.
+ */
+static void move_remote_task_to_local_dsq(struct task_struct *p, u64 enq_flags,
+					  struct rq *src_rq, struct rq *dst_rq)
+{
+	detach_remote_task(p, src_rq, dst_rq);
+
+	raw_spin_rq_unlock(src_rq);
+	raw_spin_rq_lock(dst_rq);
+
+	attach_remote_task(p, enq_flags, dst_rq);
+}
+
 /*
  * Similar to kernel/sched/core.c::is_cpu_allowed(). However, there are two
  * differences:
@@ -2769,6 +2836,49 @@ static bool consume_global_dsq(struct rq *rq)
 	return consume_dispatch_q(rq, global_dsqs[node]);
 }
 
+/*
+ * Consume from the domain DSQ @dsq: the queue of @rq's LLC first, then the
+ * parent and, if @steal, the queues of the other LLCs. The scan starts at a
+ * CPU dependent offset so that idle CPUs don't all pile onto the same queue.
+ * consume_dispatch_q() skips empty queues without taking their locks.
+ */
+static bool consume_llc_dsq(struct rq *rq, struct scx_dispatch_q *dsq,
+			    bool steal)
+{
+	struct scx_llc_dsqs *llc = dsq->llc;
+	struct scx_dispatch_q *own = llc->cpu_dsqs[cpu_of(rq)];
+	u32 i, start;
+
+	if ((own && consume_dispatch_q(rq, own)) || consume_dispatch_q(rq, dsq))
+		return true;
+
+	if (!steal)
+		return false;
+
+	start = cpu_of(rq) % llc->nr;
+	for (i = 0; i < llc->nr; i++) {
+		struct scx_dispatch_q *sib = llc->dsqs[(start + i) % llc->nr];
+
+		if (sib != own && consume_dispatch_q(rq, sib)) {
+			__scx_add_event(SCX_EV_DISPATCH_LLC_STEAL, 1);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static bool steal_llc_dsqs(struct rq *rq)
+{
+	struct scx_llc_dsqs *llc;
+
+	list_for_each_entry_rcu(llc, &scx_llc_dsq_list, node)
+		if (consume_llc_dsq(rq, llc->parent, true))
+			return true;
+
+	return false;
+}
+
 /**
  * dispatch_to_local_dsq - Dispatch a task to a local dsq
  * @rq: current rq which is locked
@@ -2867,13 +2977,142 @@ static void dispatch_to_local_dsq(struct rq *rq, struct scx_dispatch_q *dst_dsq,
 #endif	/* CONFIG_SMP */
 }
 
+#ifdef CONFIG_SMP
+/*
+ * Dispatching a batch of tasks from ops.dispatch() to local DSQs one by one
+ * bounces between the current rq lock and the task rq locks for each task. To
+ * avoid that, flush_dispatch_buf() only claims the tasks going to local DSQs
+ * and marks them with holding_cpu like dispatch_to_local_dsq() does.
+ * finish_deferred_dispatches() then detaches the ones changing rqs with one
+ * lock acquisition per source rq and queues all of them with one lock
+ * acquisition per run of tasks going to the same destination rq, similar to
+ * detach_tasks() and attach_tasks() in fair.c. As local dispatches all go
+ * through the second pass, the dispatch order on each local DSQ is preserved.
+ */
+static bool defer_dispatch_to_local_dsq(struct rq *rq,
+					struct scx_dispatch_q *dst_dsq,
+					struct scx_dsp_buf_ent *ent)
+{
+	struct task_struct *p = ent->task;
+	struct rq *src_rq = task_rq(p);
+	struct rq *dst_rq = container_of(dst_dsq, struct rq, scx.local_dsq);
+
+	/* let dispatch_to_local_dsq() report and handle the failure */
+	if (src_rq != dst_rq && !task_can_run_on_remote_rq(p, dst_rq, false))
+		return false;
+
+	p->scx.holding_cpu = raw_smp_processor_id();
+
+	/* store_release ensures that dequeue sees the above */
+	atomic_long_set_release(&p->scx.ops_state, SCX_OPSS_NONE);
+
+	ent->src_rq = src_rq;
+	ent->dsq_id = SCX_DSQ_LOCAL_ON | cpu_of(dst_rq);
+	return true;
+}
+
+static struct rq *switch_rq_lock(struct rq *locked_rq, struct rq *rq)
+{
+	if (locked_rq != rq) {
+		raw_spin_rq_unlock(locked_rq);
+		raw_spin_rq_lock(rq);
+	}
+	return rq;
+}
+
+static void finish_deferred_dispatches(struct rq *rq,
+				       struct scx_dsp_buf_ent *ents, u32 nr)
+{
+	int this_cpu = raw_smp_processor_id();
+	struct rq *locked_rq = rq;
+	u32 u, v;
+
+	/*
+	 * Detach the tasks which change rqs, grouped by source rq. Detached
+	 * tasks have ->src_rq cleared and lost ones ->task.
+	 */
+	for (u = 0; u < nr; u++) {
+		struct rq *src_rq = ents[u].src_rq;
+
+		if (!ents[u].task || !src_rq ||
+		    src_rq == cpu_rq(ents[u].dsq_id & SCX_DSQ_LOCAL_CPU_MASK))
+			continue;
+
+		locked_rq = switch_rq_lock(locked_rq, src_rq);
+
+		for (v = u; v < nr; v++) {
+			struct scx_dsp_buf_ent *ent = &ents[v];
+			struct task_struct *p = ent->task;
+			struct rq *dst_rq;
+
+			if (!p || ent->src_rq != src_rq)
+				continue;
+
+			dst_rq = cpu_rq(ent->dsq_id & SCX_DSQ_LOCAL_CPU_MASK);
+			if (src_rq == dst_rq)
+				continue;
+
+			/* task_rq couldn't have changed if we're still the holding cpu */
+			if (unlikely(p->scx.holding_cpu != this_cpu) ||
+			    WARN_ON_ONCE(src_rq != task_rq(p))) {
+				ent->task = NULL;
+				continue;
+			}
+
+			detach_remote_task(p, src_rq, dst_rq);
+			ent->src_rq = NULL;
+		}
+	}
+
+	/*
+	 * Walk the entries in dispatch order and attach or enqueue each task on
+	 * its destination rq.
+	 */
+	for (u = 0; u < nr; u++) {
+		struct scx_dsp_buf_ent *ent = &ents[u];
+		struct task_struct *p = ent->task;
+		struct rq *dst_rq;
+
+		if (!p)
+			continue;
+
+		dst_rq = cpu_rq(ent->dsq_id & SCX_DSQ_LOCAL_CPU_MASK);
+		locked_rq = switch_rq_lock(locked_rq, dst_rq);
+
+		if (!ent->src_rq) {
+			attach_remote_task(p, ent->enq_flags, dst_rq);
+		} else {
+			if (unlikely(p->scx.holding_cpu != this_cpu) ||
+			    WARN_ON_ONCE(dst_rq != task_rq(p)))
+				continue;
+			p->scx.holding_cpu = -1;
+			dispatch_enqueue(&dst_rq->scx.local_dsq, p, ent->enq_flags);
+		}
+
+		/* if the destination CPU is idle, wake it up */
+		if (sched_class_above(p->sched_class, dst_rq->curr->sched_class))
+			resched_curr(dst_rq);
+	}
+
+	switch_rq_lock(locked_rq, rq);
+}
+#else	/* CONFIG_SMP */
+static bool defer_dispatch_to_local_dsq(struct rq *rq,
+					struct scx_dispatch_q *dst_dsq,
+					struct scx_dsp_buf_ent *ent)
+{
+	return false;
+}
+
+static void finish_deferred_dispatches(struct rq *rq,
+				       struct scx_dsp_buf_ent *ents, u32 nr) {}
+#endif	/* CONFIG_SMP */
+
 /**
  * finish_dispatch - Asynchronously finish dispatching a task
  * @rq: current rq which is locked
- * @p: task to finish dispatching
- * @qseq_at_dispatch: qseq when @p started getting dispatched
- * @dsq_id: destination DSQ ID
- * @enq_flags: %SCX_ENQ_*
+ * @ent: dispatch buffer entry recording the task, its qseq when it started
+ *	 getting dispatched, the destination DSQ ID and %SCX_ENQ_* flags
  *
  * Dispatching to local DSQs may need to wait for queueing to complete or
  * require rq lock dancing. As we don't wanna do either while inside
@@ -2885,11 +3124,15 @@ static void dispatch_to_local_dsq(struct rq *rq, struct scx_dispatch_q *dst_dsq,
  * There is no guarantee that @p is still valid for dispatching or even that it
  * was valid in the first place. Make sure that the task is still owned by the
  * BPF scheduler and claim the ownership before dispatching.
+ *
+ * Returns %true if moving the task to its local DSQ has been deferred to
+ * finish_deferred_dispatches().
  */
-static void finish_dispatch(struct rq *rq, struct task_struct *p,
-			    unsigned long qseq_at_dispatch,
-			    u64 dsq_id, u64 enq_flags)
+static bool finish_dispatch(struct rq *rq, struct scx_dsp_buf_ent *ent)
 {
+	struct task_struct *p = ent->task;
+	unsigned long qseq_at_dispatch = ent->qseq;
+	u64 dsq_id = ent->dsq_id, enq_flags = ent->enq_flags;
 	struct scx_dispatch_q *dsq;
 	unsigned long opss;
 
@@ -2905,7 +3148,7 @@ static void finish_dispatch(struct rq *rq, struct task_struct *p,
 	case SCX_OPSS_DISPATCHING:
 	case SCX_OPSS_NONE:
 		/* someone else already got to it */
-		return;
+		return false;
 	case SCX_OPSS_QUEUED:
 		/*
 		 * If qseq doesn't match, @p has gone through at least one
@@ -2913,7 +3156,7 @@ static void finish_dispatch(struct rq *rq, struct task_struct *p,
 		 * scx_bpf_dsq_insert() and here and we have no claim on it.
 		 */
 		if ((opss & SCX_OPSS_QSEQ_MASK) != qseq_at_dispatch)
-			return;
+			return false;
 
 		/*
 		 * While we know @p is accessible, we don't yet have a claim on
@@ -2941,24 +3184,32 @@ static void finish_dispatch(struct rq *rq, struct task_struct *p,
 
 	dsq = find_dsq_for_dispatch(this_rq(), dsq_id, p);
 
-	if (dsq->id == SCX_DSQ_LOCAL)
+	if (dsq->id == SCX_DSQ_LOCAL) {
+		if (defer_dispatch_to_local_dsq(rq, dsq, ent))
+			return true;
 		dispatch_to_local_dsq(rq, dsq, p, enq_flags);
-	else
+	} else {
 		dispatch_enqueue(dsq, p, enq_flags | SCX_ENQ_CLEAR_OPSS);
+	}
+
+	return false;
 }
 
 static void flush_dispatch_buf(struct rq *rq)
 {
 	struct scx_dsp_ctx *dspc = this_cpu_ptr(scx_dsp_ctx);
-	u32 u;
+	u32 u, nr_deferred = 0;
 
 	for (u = 0; u < dspc->cursor; u++) {
 		struct scx_dsp_buf_ent *ent = &dspc->buf[u];
 
-		finish_dispatch(rq, ent->task, ent->qseq, ent->dsq_id,
-				ent->enq_flags);
+		if (finish_dispatch(rq, ent))
+			dspc->buf[nr_deferred++] = *ent;
 	}
 
+	if (nr_deferred)
+		finish_deferred_dispatches(rq, dspc->buf, nr_deferred);
+
 	dspc->nr_tasks += dspc->cursor;
 	dspc->cursor = 0;
 }
@@ -3057,6 +3308,14 @@ static int balance_one(struct rq *rq, struct task_struct *prev)
 		}
 	} while (dspc->nr_tasks);
 
+	/*
+	 * ops.dispatch() didn't find anything. Unless @prev is going to keep
+	 * running, steal from the domain DSQs before going idle.
+	 */
+	if ((!prev_on_rq || static_branch_unlikely(&scx_ops_enq_last)) &&
+	    !list_empty(&scx_llc_dsq_list) && steal_llc_dsqs(rq))
+		goto has_tasks;
+
 no_tasks:
 	/*
 	 * Didn't find another task to run. Keep running @prev unless
@@ -4169,6 +4428,74 @@ static void init_dsq(struct scx_dispatch_q *dsq, u64 dsq_id)
 	dsq->id = dsq_id;
 }
 
+static int scx_llc_id(s32 cpu)
+{
+#ifdef CONFIG_SMP
+	return per_cpu(sd_llc_id, cpu);
+#else
+	return 0;
+#endif
+}
+
+static void free_llc_dsqs(struct scx_llc_dsqs *llc)
+{
+	u32 i;
+
+	if (!llc)
+		return;
+
+	for (i = 0; i < llc->nr; i++)
+		kfree(llc->dsqs[i]);
+	kfree(llc->cpu_dsqs);
+	kfree(llc);
+}
+
+/*
+ * Allocate the per-LLC queues of the domain DSQ @parent according to the
+ * current LLC topology. The queues are not rebuilt on topology changes; CPUs
+ * keep using the queue of the LLC they were in, which only costs locality.
+ */
+static struct scx_llc_dsqs *alloc_llc_dsqs(struct scx_dispatch_q *parent)
+{
+	struct scx_llc_dsqs *llc;
+	int cpu;
+
+	llc = kzalloc(struct_size(llc, dsqs, nr_cpu_ids), GFP_KERNEL);
+	if (!llc)
+		return NULL;
+
+	llc->parent = parent;
+	llc->cpu_dsqs = kcalloc(nr_cpu_ids, sizeof(llc->cpu_dsqs[0]), GFP_KERNEL);
+	if (!llc->cpu_dsqs)
+		goto err;
+
+	cpus_read_lock();
+	for_each_possible_cpu(cpu) {
+		int llc_cpu = scx_llc_id(cpu);
+
+		if (!llc->cpu_dsqs[llc_cpu]) {
+			struct scx_dispatch_q *dsq;
+
+			dsq = kmalloc_node(sizeof(*dsq), GFP_KERNEL,
+					   cpu_to_node(llc_cpu));
+			if (!dsq) {
+				cpus_read_unlock();
+				goto err;
+			}
+			init_dsq(dsq, parent->id);
+			llc->dsqs[llc->nr++] = dsq;
+			llc->cpu_dsqs[llc_cpu] = dsq;
+		}
+		llc->cpu_dsqs[cpu] = llc->cpu_dsqs[llc_cpu];
+	}
+	cpus_read_unlock();
+
+	return llc;
+err:
+	free_llc_dsqs(llc);
+	return NULL;
+}
+
 static struct scx_dispatch_q *create_dsq(u64 dsq_id, int node)
 {
 	struct scx_dispatch_q *dsq;
@@ -4183,26 +4510,89 @@ static struct scx_dispatch_q *create_dsq(u64 dsq_id, int node)
 
 	init_dsq(dsq, dsq_id);
 
+	if (dsq_id & SCX_DSQ_FLAG_LLC) {
+		dsq->llc = alloc_llc_dsqs(dsq);
+		if (!dsq->llc) {
+			kfree(dsq);
+			return ERR_PTR(-ENOMEM);
+		}
+	}
+
 	ret = rhashtable_lookup_insert_fast(&dsq_hash, &dsq->hash_node,
 					    dsq_hash_params);
 	if (ret) {
+		free_llc_dsqs(dsq->llc);
 		kfree(dsq);
 		return ERR_PTR(ret);
 	}
+
+	if (dsq->llc) {
+		raw_spin_lock_irq(&scx_llc_dsq_lock);
+		list_add_tail_rcu(&dsq->llc->node, &scx_llc_dsq_list);
+		raw_spin_unlock_irq(&scx_llc_dsq_lock);
+	}
+
 	return dsq;
 }
 
+static void free_dsq_rcufn(struct rcu_head *rcu)
+{
+	struct scx_dispatch_q *dsq = container_of(rcu, struct scx_dispatch_q, rcu);
+
+	free_llc_dsqs(dsq->llc);
+	kfree(dsq);
+}
+
 static void free_dsq_irq_workfn(struct irq_work *irq_work)
 {
 	struct llist_node *to_free = llist_del_all(&dsqs_to_free);
 	struct scx_dispatch_q *dsq, *tmp_dsq;
 
 	llist_for_each_entry_safe(dsq, tmp_dsq, to_free, free_node)
-		kfree_rcu(dsq, rcu);
+		call_rcu(&dsq->rcu, free_dsq_rcufn);
 }
 
 static DEFINE_IRQ_WORK(free_dsq_irq_work, free_dsq_irq_workfn);
 
+static void restore_llc_dsqs(struct scx_llc_dsqs *llc, u32 nr, u64 dsq_id)
+{
+	u32 i;
+
+	for (i = 0; i < nr; i++) {
+		struct scx_dispatch_q *ldsq = llc->dsqs[i];
+
+		raw_spin_lock_nested(&ldsq->lock, SINGLE_DEPTH_NESTING);
+		ldsq->id = dsq_id;
+		raw_spin_unlock(&ldsq->lock);
+	}
+}
+
+static bool invalidate_llc_dsqs(struct scx_llc_dsqs *llc)
+{
+	u64 dsq_id = llc->parent->id;
+	u32 i;
+
+	for (i = 0; i < llc->nr; i++) {
+		struct scx_dispatch_q *ldsq = llc->dsqs[i];
+		u32 nr;
+
+		raw_spin_lock_nested(&ldsq->lock, SINGLE_DEPTH_NESTING);
+		nr = ldsq->nr;
+		if (!nr)
+			ldsq->id = SCX_DSQ_INVALID;
+		raw_spin_unlock(&ldsq->lock);
+
+		if (nr) {
+			scx_ops_error("attempting to destroy in-use dsq 0x%016llx (nr=%u)",
+				      dsq_id, dsq_nr_queued(llc->parent));
+			restore_llc_dsqs(llc, i, dsq_id);
+			return false;
+		}
+	}
+
+	return true;
+}
+
 static void destroy_dsq(u64 dsq_id)
 {
 	struct scx_dispatch_q *dsq;
@@ -4222,8 +4612,25 @@ static void destroy_dsq(u64 dsq_id)
 		goto out_unlock_dsq;
 	}
 
-	if (rhashtable_remove_fast(&dsq_hash, &dsq->hash_node, dsq_hash_params))
+	/*
+	 * The per-LLC DSQs are checked and invalidated under their own locks
+	 * so that nothing can be queued on them after the check. They are
+	 * only ever nested inside the parent's lock.
+	 */
+	if (dsq->llc && !invalidate_llc_dsqs(dsq->llc))
+		goto out_unlock_dsq;
+
+	if (rhashtable_remove_fast(&dsq_hash, &dsq->hash_node, dsq_hash_params)) {
+		if (dsq->llc)
+			restore_llc_dsqs(dsq->llc, dsq->llc->nr, dsq->id);
 		goto out_unlock_dsq;
+	}
+
+	if (dsq->llc) {
+		raw_spin_lock(&scx_llc_dsq_lock);
+		list_del_rcu(&dsq->llc->node);
+		raw_spin_unlock(&scx_llc_dsq_lock);
+	}
 
 	/*
 	 * Mark dead by invalidating ->id to prevent dispatch_enqueue() from
@@ -4417,6 +4824,7 @@ static ssize_t scx_attr_events_show(struct kobject *kobj,
 	at += scx_attr_event_show(buf, at, &events, SCX_EV_SELECT_CPU_FALLBACK);
 	at += scx_attr_event_show(buf, at, &events, SCX_EV_DISPATCH_LOCAL_DSQ_OFFLINE);
 	at += scx_attr_event_show(buf, at, &events, SCX_EV_DISPATCH_KEEP_LAST);
+	at += scx_attr_event_show(buf, at, &events, SCX_EV_DISPATCH_LLC_STEAL);
 	at += scx_attr_event_show(buf, at, &events, SCX_EV_ENQ_SKIP_EXITING);
 	at += scx_attr_event_show(buf, at, &events, SCX_EV_ENQ_SKIP_MIGRATION_DISABLED);
 	at += scx_attr_event_show(buf, at, &events, SCX_EV_ENQ_SLICE_DFL);
@@ -5152,6 +5560,7 @@ static void scx_dump_state(struct scx_exit_info *ei, size_t dump_len)
 	scx_dump_event(s, &events, SCX_EV_SELECT_CPU_FALLBACK);
 	scx_dump_event(s, &events, SCX_EV_DISPATCH_LOCAL_DSQ_OFFLINE);
 	scx_dump_event(s, &events, SCX_EV_DISPATCH_KEEP_LAST);
+	scx_dump_event(s, &events, SCX_EV_DISPATCH_LLC_STEAL);
 	scx_dump_event(s, &events, SCX_EV_ENQ_SKIP_EXITING);
 	scx_dump_event(s, &events, SCX_EV_ENQ_SKIP_MIGRATION_DISABLED);
 	scx_dump_event(s, &events, SCX_EV_ENQ_SLICE_DFL);
@@ -6398,6 +6807,10 @@ __bpf_kfunc void scx_bpf_dispatch_cancel(void)
  * Move a task from the non-local DSQ identified by @dsq_id to the current CPU's
  * local DSQ for execution. Can only be called from ops.dispatch().
  *
+ * For a domain DSQ, the queue of the current CPU's LLC is tried first, then
+ * the parent queue. The queues of the other LLCs are left to the steal path
+ * of CPUs which are about to go idle.
+ *
  * This function flushes the in-flight dispatches from scx_bpf_dsq_insert()
  * before trying to move from the specified DSQ. It may also grab rq locks and
  * thus can't be called under any BPF locks.
@@ -6421,7 +6834,8 @@ __bpf_kfunc bool scx_bpf_dsq_move_to_local(u64 dsq_id)
 		return false;
 	}
 
-	if (consume_dispatch_q(dspc->rq, dsq)) {
+	if (dsq->llc ? consume_llc_dsq(dspc->rq, dsq, false) :
+		       consume_dispatch_q(dspc->rq, dsq)) {
 		/*
 		 * A successfully consumed task can be dequeued before it starts
 		 * running while the CPU is trying to migrate other dispatched
@@ -6672,6 +7086,11 @@ __bpf_kfunc_start_defs();
  *
  * Create a custom DSQ identified by @dsq_id. Can be called from any sleepable
  * scx callback, and any BPF_PROG_TYPE_SYSCALL prog.
+ *
+ * If @dsq_id has %SCX_DSQ_FLAG_LLC set, a domain DSQ is created which has a
+ * separate queue for each LLC. Tasks inserted into it are queued on the LLC of
+ * their CPU and CPUs which find nothing to run after ops.dispatch() steal from
+ * the queues of the other LLCs. BPF iterators only walk the parent queue.
  */
 __bpf_kfunc s32 scx_bpf_create_dsq(u64 dsq_id, s32 node)
 {
@@ -6792,7 +7211,7 @@ __bpf_kfunc s32 scx_bpf_dsq_nr_queued(u64 dsq_id)
 	} else {
 		dsq = find_user_dsq(dsq_id);
 		if (dsq) {
-			ret = READ_ONCE(dsq->nr);
+			ret = dsq_nr_queued(dsq);
 			goto out;
 		}
 	}
@@ -7345,6 +7764,7 @@ __bpf_kfunc void scx_bpf_events(struct scx_event_stats *events,
 		scx_agg_event(&e_sys, e_cpu, SCX_EV_SELECT_CPU_FALLBACK);
 		scx_agg_event(&e_sys, e_cpu, SCX_EV_DISPATCH_LOCAL_DSQ_OFFLINE);
 		scx_agg_event(&e_sys, e_cpu, SCX_EV_DISPATCH_KEEP_LAST);
+		scx_agg_event(&e_sys, e_cpu, SCX_EV_DISPATCH_LLC_STEAL);
 		scx_agg_event(&e_sys, e_cpu, SCX_EV_ENQ_SKIP_EXITING);
 		scx_agg_event(&e_sys, e_cpu, SCX_EV_ENQ_SKIP_MIGRATION_DISABLED);
 		scx_agg_event(&e_sys, e_cpu, SCX_EV_ENQ_SLICE_DFL);
@@ -46,6 +46,15 @@ static struct scx_idle_cpus scx_idle_global_masks;
  */
 static struct scx_idle_cpus **scx_idle_node_masks;
 
+/*
+ * Per-LLC idle core summary, indexed by the sd_llc_id of each LLC. A bit is set
+ * when a core of the LLC becomes wholly idle and cleared when its last idle
+ * core goes busy, so that the search for an idle core can skip busy LLCs
+ * without scanning their spans. Like the SMT mask, it's racy but only used as
+ * a hint and self-correcting.
+ */
+static cpumask_var_t scx_idle_llcs;
+
 /*
  * Return the idle masks associated to a target @node.
  *
@@ -218,6 +227,126 @@ s32 scx_pick_idle_cpu(const struct cpumask *cpus_allowed, int node, u64 flags)
 	return pick_idle_cpu_from_online_nodes(cpus_allowed, node, flags);
 }
 
+/*
+ * Return the mask tracking the wholly idle cores which include @cpu.
+ */
+static struct cpumask *idle_cores_mask(int cpu)
+{
+	struct scx_idle_cpus *masks = idle_cpumask(scx_cpu_node_if_enabled(cpu));
+
+	return sched_smt_active() ? masks->smt : masks->cpu;
+}
+
+static struct cpumask *llc_span(s32 cpu);
+
+/*
+ * Pick and claim a wholly idle core in @cpus_allowed within the LLC of @cpu.
+ */
+static s32 pick_idle_core_in_llc(const struct cpumask *cpus_allowed, s32 cpu)
+{
+	struct cpumask *idle_cores = idle_cores_mask(cpu);
+	const struct cpumask *span = llc_span(cpu);
+	s32 idle_cpu;
+
+	if (!span)
+		return -EBUSY;
+retry:
+	idle_cpu = cpumask_first_and_and(span, idle_cores, cpus_allowed);
+	if (idle_cpu >= nr_cpu_ids) {
+		if (!cpumask_intersects(span, idle_cores))
+			cpumask_clear_cpu(per_cpu(sd_llc_id, cpu), scx_idle_llcs);
+		return -EBUSY;
+	}
+
+	if (scx_idle_test_and_clear_cpu(idle_cpu))
+		return idle_cpu;
+	goto retry;
+}
+
+/*
+ * Pick and claim a wholly idle core in @cpus_allowed within the LLCs of @node,
+ * other than the LLC of @skip_cpu.
+ */
+static s32 pick_idle_core_in_node_llcs(const struct cpumask *cpus_allowed,
+				       int node, s32 skip_cpu)
+{
+	int skip_llc = per_cpu(sd_llc_id, skip_cpu);
+	s32 llc, cpu;
+
+	for_each_cpu_and(llc, scx_idle_llcs, cpumask_of_node(node)) {
+		if (llc == skip_llc)
+			continue;
+		cpu = pick_idle_core_in_llc(cpus_allowed, llc);
+		if (cpu >= 0)
+			return cpu;
+	}
+
+	return -EBUSY;
+}
+
+#ifdef CONFIG_NUMA
+/*
+ * Search for an idle core across the LLCs of all nodes, excluding @node.
+ */
+static s32 pick_idle_core_from_online_nodes(const struct cpumask *cpus_allowed,
+					    int node, s32 cpu)
+{
+	nodemask_t *unvisited;
+	s32 idle_cpu = -EBUSY;
+
+	preempt_disable();
+	unvisited = this_cpu_ptr(&per_cpu_unvisited);
+
+	nodes_copy(*unvisited, node_states[N_ONLINE]);
+	node_clear(node, *unvisited);
+
+	for_each_node_numadist(node, *unvisited) {
+		idle_cpu = pick_idle_core_in_node_llcs(cpus_allowed, node, cpu);
+		if (idle_cpu >= 0)
+			break;
+	}
+	preempt_enable();
+
+	return idle_cpu;
+}
+#else
+static inline s32
+pick_idle_core_from_online_nodes(const struct cpumask *cpus_allowed, int node, s32 cpu)
+{
+	return -EBUSY;
+}
+#endif
+
+/*
+ * Find and claim the wholly idle core in @cpus_allowed which is the closest to
+ * @cpu: @cpu itself, then its LLC, then the other LLCs of its node and finally
+ * the LLCs of the other nodes in order of increasing distance. LLCs without an
+ * idle core are skipped through scx_idle_llcs, so the cost is a few cpumask
+ * words per visited LLC instead of a scan of the whole idle mask.
+ */
+s32 scx_pick_idle_core_near(const struct cpumask *cpus_allowed, s32 cpu)
+{
+	int node = cpu_to_node(cpu);
+	s32 idle_cpu;
+
+	guard(rcu)();
+
+	if (cpumask_test_cpu(cpu, cpus_allowed) &&
+	    cpumask_test_cpu(cpu, idle_cores_mask(cpu)) &&
+	    scx_idle_test_and_clear_cpu(cpu))
+		return cpu;
+
+	idle_cpu = pick_idle_core_in_llc(cpus_allowed, cpu);
+	if (idle_cpu >= 0)
+		return idle_cpu;
+
+	idle_cpu = pick_idle_core_in_node_llcs(cpus_allowed, node, cpu);
+	if (idle_cpu >= 0)
+		return idle_cpu;
+
+	return pick_idle_core_from_online_nodes(cpus_allowed, node, cpu);
+}
+
 /*
  * Return the amount of CPUs in the same LLC domain of @cpu (or zero if the LLC
  * domain is not defined).
@@ -623,6 +752,33 @@ void scx_idle_init_masks(void)
 		BUG_ON(!alloc_cpumask_var_node(&scx_idle_node_masks[node]->cpu, GFP_KERNEL, node));
 		BUG_ON(!alloc_cpumask_var_node(&scx_idle_node_masks[node]->smt, GFP_KERNEL, node));
 	}
+
+	/* Allocate the per-LLC idle core summary */
+	BUG_ON(!zalloc_cpumask_var(&scx_idle_llcs, GFP_KERNEL));
+}
+
+/*
+ * Update the idle core summary of the LLC of @cpu after @cpu's core became
+ * wholly idle (@idle) or busy.
+ */
+static void update_idle_llc(int cpu, bool idle, const struct cpumask *idle_cores)
+{
+	int llc = per_cpu(sd_llc_id, cpu);
+	const struct cpumask *span;
+
+	if (idle) {
+		if (!cpumask_test_cpu(llc, scx_idle_llcs))
+			cpumask_set_cpu(llc, scx_idle_llcs);
+		return;
+	}
+
+	if (!cpumask_test_cpu(llc, scx_idle_llcs))
+		return;
+
+	guard(rcu)();
+	span = llc_span(cpu);
+	if (!span || !cpumask_intersects(span, idle_cores))
+		cpumask_clear_cpu(llc, scx_idle_llcs);
 }
 
 static void update_builtin_idle(int cpu, bool idle)
@@ -646,10 +802,17 @@ static void update_builtin_idle(int cpu, bool idle)
 				return;
 			cpumask_or(idle_smts, idle_smts, smt);
 		} else {
+			if (!cpumask_intersects(smt, idle_smts))
+				return;
 			cpumask_andnot(idle_smts, idle_smts, smt);
 		}
+
+		update_idle_llc(cpu, idle, idle_smts);
+		return;
 	}
 #endif
+
+	update_idle_llc(cpu, idle, idle_cpus);
 }
 
 /*
@@ -705,12 +868,16 @@ void __scx_update_idle(struct rq *rq, bool idle, bool do_notify)
 
 static void reset_idle_masks(struct sched_ext_ops *ops)
 {
-	int node;
+	int node, cpu;
 
 	/*
 	 * Consider all online cpus idle. Should converge to the actual state
 	 * quickly.
 	 */
+	cpumask_clear(scx_idle_llcs);
+	for_each_online_cpu(cpu)
+		cpumask_set_cpu(per_cpu(sd_llc_id, cpu), scx_idle_llcs);
+
 	if (!(ops->flags & SCX_OPS_BUILTIN_IDLE_PER_NODE)) {
 		cpumask_copy(idle_cpumask(NUMA_NO_NODE)->cpu, cpu_online_mask);
 		cpumask_copy(idle_cpumask(NUMA_NO_NODE)->smt, cpu_online_mask);
@@ -1050,6 +1217,36 @@ __bpf_kfunc s32 scx_bpf_pick_idle_cpu(const struct cpumask *cpus_allowed,
 	return scx_pick_idle_cpu(cpus_allowed, NUMA_NO_NODE, flags);
 }
 
+/**
+ * scx_bpf_pick_idle_core_near - Pick and claim the closest idle core to a cpu
+ * @cpus_allowed: Allowed cpumask
+ * @cpu: cpu to measure the topology distance from
+ *
+ * Pick and claim a cpu in @cpus_allowed whose SMT siblings are all idle,
+ * preferring @cpu itself, then the LLC of @cpu, then the other LLCs of the
+ * NUMA node of @cpu and finally the other online NUMA nodes in order of
+ * increasing distance. Returns the picked idle cpu number on success, -%EBUSY
+ * if no idle core was found.
+ *
+ * Busy LLCs are skipped through a per-LLC idle core summary, which makes this
+ * cheaper than scx_bpf_pick_idle_cpu() with %SCX_PICK_IDLE_CORE on machines
+ * with many LLCs.
+ *
+ * Unavailable if ops.update_idle() is implemented and
+ * %SCX_OPS_KEEP_BUILTIN_IDLE is not set.
+ */
+__bpf_kfunc s32 scx_bpf_pick_idle_core_near(const struct cpumask *cpus_allowed,
+					    s32 cpu)
+{
+	if (!check_builtin_idle_enabled())
+		return -EBUSY;
+
+	if (!ops_cpu_valid(cpu, NULL))
+		return -EINVAL;
+
+	return scx_pick_idle_core_near(cpus_allowed, cpu);
+}
+
 /**
  * scx_bpf_pick_any_cpu_node - Pick and claim an idle cpu if available
  *			       or pick any CPU from @node
@@ -1146,6 +1343,7 @@ BTF_ID_FLAGS(func, scx_bpf_put_idle_cpumask, KF_RELEASE)
 BTF_ID_FLAGS(func, scx_bpf_test_and_clear_cpu_idle)
 BTF_ID_FLAGS(func, scx_bpf_pick_idle_cpu_node, KF_RCU)
 BTF_ID_FLAGS(func, scx_bpf_pick_idle_cpu, KF_RCU)
+BTF_ID_FLAGS(func, scx_bpf_pick_idle_core_near, KF_RCU)
 BTF_ID_FLAGS(func, scx_bpf_pick_any_cpu_node, KF_RCU)
 BTF_ID_FLAGS(func, scx_bpf_pick_any_cpu, KF_RCU)
 BTF_KFUNCS_END(scx_kfunc_ids_idle)
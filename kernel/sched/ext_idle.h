@@ -17,6 +17,7 @@ void scx_idle_update_selcpu_topology(struct sched_ext_ops *ops);
 void scx_idle_init_masks(void);
 bool scx_idle_test_and_clear_cpu(int cpu);
 s32 scx_pick_idle_cpu(const struct cpumask *cpus_allowed, int node, u64 flags);
+s32 scx_pick_idle_core_near(const struct cpumask *cpus_allowed, s32 cpu);
 #else /* !CONFIG_SMP */
 static inline void scx_idle_update_selcpu_topology(struct sched_ext_ops *ops) {}
 static inline void scx_idle_init_masks(void) {}
@@ -25,6 +26,10 @@ static inline s32 scx_pick_idle_cpu(const struct cpumask *cpus_allowed, int node
 {
 	return -EBUSY;
 }
+static inline s32 scx_pick_idle_core_near(const struct cpumask *cpus_allowed, s32 cpu)
+{
+	return -EBUSY;
+}
 #endif /* CONFIG_SMP */
 
 s32 scx_select_cpu_dfl(struct task_struct *p, s32 prev_cpu, u64 wake_flags, u64 flags);
@@ -1883,50 +1883,48 @@ static int numa_hint_fault_latency(struct folio *folio)
  * hurt application latency.  So we provide a mechanism to rate limit
  * the number of pages that are tried to be promoted.
  */
-static bool numa_promotion_rate_limit(struct pglist_data *pgdat,
-				      unsigned long rate_limit, int nr)
+static bool numa_promotion_rate_limit(struct numa_promote_ctl *ctl,
+				      unsigned long rate_limit,
+				      unsigned long nr_cand)
 {
-	unsigned long nr_cand;
 	unsigned int now, start;
 
 	now = jiffies_to_msecs(jiffies);
-	mod_node_page_state(pgdat, PGPROMOTE_CANDIDATE, nr);
-	nr_cand = node_page_state(pgdat, PGPROMOTE_CANDIDATE);
-	start = pgdat->nbp_rl_start;
+	start = ctl->rl_start;
 	if (now - start > MSEC_PER_SEC &&
-	    cmpxchg(&pgdat->nbp_rl_start, start, now) == start)
-		pgdat->nbp_rl_nr_cand = nr_cand;
-	if (nr_cand - pgdat->nbp_rl_nr_cand >= rate_limit)
+	    cmpxchg(&ctl->rl_start, start, now) == start)
+		ctl->rl_nr_cand = nr_cand;
+	if (nr_cand - ctl->rl_nr_cand >= rate_limit)
 		return true;
 	return false;
 }
 
 #define NUMA_MIGRATION_ADJUST_STEPS	16
 
-static void numa_promotion_adjust_threshold(struct pglist_data *pgdat,
+static void numa_promotion_adjust_threshold(struct numa_promote_ctl *ctl,
 					    unsigned long rate_limit,
-					    unsigned int ref_th)
+					    unsigned int ref_th,
+					    unsigned long nr_cand)
 {
 	unsigned int now, start, th_period, unit_th, th;
-	unsigned long nr_cand, ref_cand, diff_cand;
+	unsigned long ref_cand, diff_cand;
 
 	now = jiffies_to_msecs(jiffies);
 	th_period = sysctl_numa_balancing_scan_period_max;
-	start = pgdat->nbp_th_start;
+	start = ctl->th_start;
 	if (now - start > th_period &&
-	    cmpxchg(&pgdat->nbp_th_start, start, now) == start) {
+	    cmpxchg(&ctl->th_start, start, now) == start) {
 		ref_cand = rate_limit *
 			sysctl_numa_balancing_scan_period_max / MSEC_PER_SEC;
-		nr_cand = node_page_state(pgdat, PGPROMOTE_CANDIDATE);
-		diff_cand = nr_cand - pgdat->nbp_th_nr_cand;
+		diff_cand = nr_cand - ctl->th_nr_cand;
 		unit_th = ref_th * 2 / NUMA_MIGRATION_ADJUST_STEPS;
-		th = pgdat->nbp_threshold ? : ref_th;
+		th = ctl->threshold ? : ref_th;
 		if (diff_cand > ref_cand * 11 / 10)
 			th = max(th - unit_th, unit_th);
 		else if (diff_cand < ref_cand * 9 / 10)
 			th = min(th + unit_th, ref_th * 2);
-		pgdat->nbp_th_nr_cand = nr_cand;
-		pgdat->nbp_threshold = th;
+		ctl->th_nr_cand = nr_cand;
+		ctl->threshold = th;
 	}
 }
 
@@ -1948,29 +1946,60 @@ bool should_numa_migrate_memory(struct task_struct *p, struct folio *folio,
 	 * to hot/cold instead of private/shared.
 	 */
 	if (folio_use_access_time(folio)) {
+		struct memtier_promote_pair *pair;
 		struct pglist_data *pgdat;
-		unsigned long rate_limit;
+		unsigned long rate_limit, pair_rate_limit = 0, nr_cand;
 		unsigned int latency, th, def_th;
+		int nr = folio_nr_pages(folio);
+		bool limited;
 
 		pgdat = NODE_DATA(dst_nid);
+		pair = memtier_promote_pair(src_nid, dst_nid);
 		if (pgdat_free_space_enough(pgdat)) {
 			/* workload changed, reset hot threshold */
-			pgdat->nbp_threshold = 0;
+			pgdat->nbp.threshold = 0;
+			if (pair)
+				pair->ctl.threshold = 0;
 			return true;
 		}
 
 		def_th = sysctl_numa_balancing_hot_threshold;
 		rate_limit = sysctl_numa_balancing_promote_rate_limit << \
 			(20 - PAGE_SHIFT);
-		numa_promotion_adjust_threshold(pgdat, rate_limit, def_th);
+		numa_promotion_adjust_threshold(&pgdat->nbp, rate_limit, def_th,
+				node_page_state(pgdat, PGPROMOTE_CANDIDATE));
+		th = pgdat->nbp.threshold ? : def_th;
+
+		/*
+		 * The threshold of the pair follows its own rate limit, e.g. of
+		 * the link to a CXL memory expander, within the one of the node.
+		 */
+		if (pair) {
+			pair_rate_limit = READ_ONCE(pair->rate_limit) ? :
+				sysctl_numa_balancing_promote_rate_limit;
+			pair_rate_limit <<= 20 - PAGE_SHIFT;
+			numa_promotion_adjust_threshold(&pair->ctl,
+					pair_rate_limit, def_th,
+					atomic_long_read(&pair->nr_cand));
+			th = min(th, pair->ctl.threshold ? : def_th);
+		}
 
-		th = pgdat->nbp_threshold ? : def_th;
 		latency = numa_hint_fault_latency(folio);
 		if (latency >= th)
 			return false;
 
-		return !numa_promotion_rate_limit(pgdat, rate_limit,
-						  folio_nr_pages(folio));
+		mod_node_page_state(pgdat, PGPROMOTE_CANDIDATE, nr);
+		nr_cand = node_page_state(pgdat, PGPROMOTE_CANDIDATE);
+		limited = numa_promotion_rate_limit(&pgdat->nbp, rate_limit,
+						    nr_cand);
+		if (pair) {
+			nr_cand = atomic_long_add_return(nr, &pair->nr_cand);
+			if (numa_promotion_rate_limit(&pair->ctl,
+						      pair_rate_limit, nr_cand))
+				limited = true;
+		}
+
+		return !limited;
 	}
 
 	this_cpupid = cpu_pid_to_cpupid(dst_cpu, current->pid);
@@ -3171,10 +3200,91 @@ void task_numa_free(struct task_struct *p, bool final)
 	}
 }
 
+/*
+ * A VMA needs this many hinting faults within a scan before its locality is
+ * judged, and converged VMAs are scanned at least every 1 << VMA_SCAN_SHIFT_MAX
+ * sequences.
+ */
+#define VMA_SCAN_FAULTS_MIN	64
+#define VMA_SCAN_SHIFT_MAX	3
+
+static void vma_numab_fault(struct vm_area_struct *vma, int local, int priv,
+			    int pages)
+{
+	struct vma_numab_state *ns = vma ? vma->numab_state : NULL;
+
+	if (!ns)
+		return;
+
+	/* Racy against other faulting tasks, only a hint for the scanner. */
+	ns->faults[local] += pages;
+	ns->faults_priv[priv] += pages;
+	ns->scan_faults[local] += pages;
+}
+
+/*
+ * The scan of @vma just completed: adapt its scan rate to the locality of the
+ * hinting faults the previous scan produced. Scanning a VMA whose faults are
+ * (almost) all local only burns cycles on useless faults, back it off
+ * exponentially. A VMA with mostly remote faults is scanned every sequence
+ * and regardless of which threads accessed it.
+ */
+static void vma_numab_adapt(struct mm_struct *mm, struct vm_area_struct *vma)
+{
+	struct vma_numab_state *ns = vma->numab_state;
+	unsigned long remote = ns->scan_faults[0];
+	unsigned long total = remote + ns->scan_faults[1];
+
+	ns->scan_faults[0] = ns->scan_faults[1] = 0;
+
+	if (total >= VMA_SCAN_FAULTS_MIN) {
+		if (remote * 8 < total) {
+			ns->scan_shift = min(ns->scan_shift + 1, VMA_SCAN_SHIFT_MAX);
+			ns->remote_hot = false;
+		} else if (remote * 2 >= total) {
+			ns->scan_shift = 0;
+			ns->remote_hot = true;
+		} else {
+			if (ns->scan_shift)
+				ns->scan_shift--;
+			ns->remote_hot = false;
+		}
+	}
+
+	ns->next_scan_seq = mm->numa_scan_seq + (1 << ns->scan_shift);
+}
+
+int proc_numa_vma_stats_show(struct seq_file *m, struct mm_struct *mm)
+{
+	struct vm_area_struct *vma;
+	VMA_ITERATOR(vmi, mm, 0);
+
+	if (mmap_read_lock_killable(mm))
+		return -EINTR;
+
+	seq_puts(m, "# start-end local remote private shared scan_shift remote_hot\n");
+	for_each_vma(vmi, vma) {
+		struct vma_numab_state *ns = vma->numab_state;
+
+		if (!ns)
+			continue;
+
+		seq_printf(m, "%08lx-%08lx %lu %lu %lu %lu %u %d\n",
+			   vma->vm_start, vma->vm_end,
+			   READ_ONCE(ns->faults[1]), READ_ONCE(ns->faults[0]),
+			   READ_ONCE(ns->faults_priv[1]), READ_ONCE(ns->faults_priv[0]),
+			   ns->scan_shift, ns->remote_hot);
+	}
+	mmap_read_unlock(mm);
+
+	return 0;
+}
+
 /*
  * Got a PROT_NONE fault for a page on @node.
  */
-void task_numa_fault(int last_cpupid, int mem_node, int pages, int flags)
+void task_numa_fault(struct vm_area_struct *vma, int last_cpupid, int mem_node,
+		     int pages, int flags)
 {
 	struct task_struct *p = current;
 	bool migrated = flags & TNF_MIGRATED;
@@ -3253,6 +3363,8 @@ void task_numa_fault(int last_cpupid, int mem_node, int pages, int flags)
 	p->numa_faults[task_faults_idx(NUMA_MEMBUF, mem_node, priv)] += pages;
 	p->numa_faults[task_faults_idx(NUMA_CPUBUF, cpu_node, priv)] += pages;
 	p->numa_faults_locality[local] += pages;
+
+	vma_numab_fault(vma, local, priv, pages);
 }
 
 static void reset_ptenuma_scan(struct task_struct *p)
@@ -3281,6 +3393,10 @@ static bool vma_is_accessed(struct mm_struct *mm, struct vm_area_struct *vma)
 	if ((READ_ONCE(current->mm->numa_scan_seq) - vma->numab_state->start_scan_seq) < 2)
 		return true;
 
+	/* Mostly remote faults: worth scanning whoever accessed it. */
+	if (vma->numab_state->remote_hot)
+		return true;
+
 	pids = vma->numab_state->pids_active[0] | vma->numab_state->pids_active[1];
 	if (test_bit(hash_32(current->pid, ilog2(BITS_PER_LONG)), &pids))
 		return true;
@@ -3451,6 +3567,7 @@ static void task_numa_work(struct callback_head *work)
 			 * first scan:
 			 */
 			 vma->numab_state->prev_scan_seq = mm->numa_scan_seq - 1;
+			vma->numab_state->next_scan_seq = mm->numa_scan_seq;
 		}
 
 		/*
@@ -3479,6 +3596,12 @@ static void task_numa_work(struct callback_head *work)
 			continue;
 		}
 
+		/* Converged VMAs are only rescanned every few sequences. */
+		if ((int)(mm->numa_scan_seq - vma->numab_state->next_scan_seq) < 0) {
+			trace_sched_skip_vma_numa(mm, vma, NUMAB_SKIP_CONVERGED);
+			continue;
+		}
+
 		/*
 		 * Do not scan the VMA if task has not accessed it, unless no other
 		 * VMA candidate exists.
@@ -3516,6 +3639,7 @@ static void task_numa_work(struct callback_head *work)
 
 		/* VMA scan is complete, do not scan until next sequence. */
 		vma->numab_state->prev_scan_seq = mm->numa_scan_seq;
+		vma_numab_adapt(mm, vma);
 
 		/*
 		 * Only force scan within one VMA at a time, to limit the
@@ -4045,6 +4169,9 @@ static inline void cfs_rq_util_change(struct cfs_rq *cfs_rq, int flags)
 		 * See cpu_util_cfs().
 		 */
 		cpufreq_update_util(rq, flags);
+#ifdef CONFIG_SCHED_SSS
+		sss_update_spare(rq);
+#endif
 	}
 }
 
@@ -4895,6 +5022,9 @@ static inline void util_est_enqueue(struct cfs_rq *cfs_rq,
 	enqueued  = cfs_rq->avg.util_est;
 	enqueued += _task_util_est(p);
 	WRITE_ONCE(cfs_rq->avg.util_est, enqueued);
+#ifdef CONFIG_SCHED_SSS
+	sss_update_spare(rq_of(cfs_rq));
+#endif
 
 	trace_sched_util_est_cfs_tp(cfs_rq);
 }
@@ -4911,6 +5041,9 @@ static inline void util_est_dequeue(struct cfs_rq *cfs_rq,
 	enqueued  = cfs_rq->avg.util_est;
 	enqueued -= min_t(unsigned int, enqueued, _task_util_est(p));
 	WRITE_ONCE(cfs_rq->avg.util_est, enqueued);
+#ifdef CONFIG_SCHED_SSS
+	sss_update_spare(rq_of(cfs_rq));
+#endif
 
 	trace_sched_util_est_cfs_tp(cfs_rq);
 }
@@ -5575,6 +5708,9 @@ set_next_entity(struct cfs_rq *cfs_rq, struct sched_entity *se)
 		update_load_avg(cfs_rq, se, UPDATE_TG);
 
 		set_protect_slice(se);
+
+		if (entity_is_task(se))
+			sched_wake_hist_run(rq_of(cfs_rq), task_of(se));
 	}
 
 	update_stats_curr_start(cfs_rq, se);
@@ -7600,6 +7736,23 @@ static inline int sched_balance_find_dst_cpu(struct sched_domain *sd, struct tas
 	return new_cpu;
 }
 
+/*
+ * The wakeup fast paths take an idle CPU without scanning. With core
+ * scheduling, an idle SMT sibling of a core running another cookie would just
+ * be forced idle again (or force its sibling idle), prefer CPUs whose core
+ * runs our cookie or is idle altogether.
+ */
+static inline bool select_idle_cookie_match(struct task_struct *p, int cpu)
+{
+#ifdef CONFIG_SCHED_CORE
+	if (!sched_core_cookie_match(cpu_rq(cpu), p)) {
+		schedstat_inc(this_rq()->ttwu_cookie_avoid);
+		return false;
+	}
+#endif
+	return true;
+}
+
 static inline int __select_idle_cpu(int cpu, struct task_struct *p)
 {
 	if ((available_idle_cpu(cpu) || sched_idle_cpu(cpu)) &&
@@ -7711,7 +7864,8 @@ static int select_idle_smt(struct task_struct *p, struct sched_domain *sd, int t
 		 */
 		if (!cpumask_test_cpu(cpu, sched_domain_span(sd)))
 			continue;
-		if (available_idle_cpu(cpu) || sched_idle_cpu(cpu))
+		if ((available_idle_cpu(cpu) || sched_idle_cpu(cpu)) &&
+		    select_idle_cookie_match(p, cpu))
 			return cpu;
 	}
 
@@ -7905,7 +8059,8 @@ static int select_idle_sibling(struct task_struct *p, int prev, int target)
 	lockdep_assert_irqs_disabled();
 
 	if ((available_idle_cpu(target) || sched_idle_cpu(target)) &&
-	    asym_fits_cpu(task_util, util_min, util_max, target))
+	    asym_fits_cpu(task_util, util_min, util_max, target) &&
+	    select_idle_cookie_match(p, target))
 		return target;
 
 	/*
@@ -7913,7 +8068,8 @@ static int select_idle_sibling(struct task_struct *p, int prev, int target)
 	 */
 	if (prev != target && cpus_share_cache(prev, target) &&
 	    (available_idle_cpu(prev) || sched_idle_cpu(prev)) &&
-	    asym_fits_cpu(task_util, util_min, util_max, prev)) {
+	    asym_fits_cpu(task_util, util_min, util_max, prev) &&
+	    select_idle_cookie_match(p, prev)) {
 
 		if (!static_branch_unlikely(&sched_cluster_active) ||
 		    cpus_share_resources(prev, target))
@@ -7946,7 +8102,8 @@ static int select_idle_sibling(struct task_struct *p, int prev, int target)
 	    cpus_share_cache(recent_used_cpu, target) &&
 	    (available_idle_cpu(recent_used_cpu) || sched_idle_cpu(recent_used_cpu)) &&
 	    cpumask_test_cpu(recent_used_cpu, p->cpus_ptr) &&
-	    asym_fits_cpu(task_util, util_min, util_max, recent_used_cpu)) {
+	    asym_fits_cpu(task_util, util_min, util_max, recent_used_cpu) &&
+	    select_idle_cookie_match(p, recent_used_cpu)) {
 
 		if (!static_branch_unlikely(&sched_cluster_active) ||
 		    cpus_share_resources(recent_used_cpu, target))
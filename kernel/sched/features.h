@@ -91,6 +91,20 @@ SCHED_FEAT(SIS_UTIL, false)
 SCHED_FEAT(SIS_UTIL, true)
 #endif
 
+#ifdef CONFIG_SCHED_SSS
+/*
+ * SSS: scan the waker/wakee LLC first, and only consult the per-LLC spare
+ * capacity summary of the remaining LLCs when the local one is saturated.
+ */
+SCHED_FEAT(SSS_LLC_SCAN, true)
+
+/*
+ * SSS: skip the candidate scan when a precomputed cpumask (idle enough cpus
+ * for CFS, cpus without RT tasks for RT) already determines the winner.
+ */
+SCHED_FEAT(SSS_FAST_PATH, true)
+#endif
+
 /*
  * Issue a WARN when we do multiple update_rq_clock() calls
  * in a single rq->lock section. Default disabled because the
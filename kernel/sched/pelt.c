@@ -352,6 +352,9 @@ int update_rt_rq_load_avg(u64 now, struct rq *rq, int running)
 
 		___update_load_avg(&rq->avg_rt, 1);
 		trace_pelt_rt_tp(rq);
+#ifdef CONFIG_SCHED_SSS
+		sss_update_spare(rq);
+#endif
 		return 1;
 	}
 
@@ -378,6 +381,9 @@ int update_dl_rq_load_avg(u64 now, struct rq *rq, int running)
 
 		___update_load_avg(&rq->avg_dl, 1);
 		trace_pelt_dl_tp(rq);
+#ifdef CONFIG_SCHED_SSS
+		sss_update_spare(rq);
+#endif
 		return 1;
 	}
 
@@ -317,6 +317,36 @@ static void get_recent_times(struct psi_group *group, int cpu,
 	}
 }
 
+/**
+ * psi_cpu_some_time - system-wide CPU "some" stall time of a CPU
+ * @cpu: the CPU to sample
+ *
+ * Returns the time in ns during which tasks on @cpu were runnable but waiting
+ * for it, including the currently active stall. The value is a free running
+ * u32 counter, only deltas between two samples are meaningful. Used by
+ * schedutil to react to runqueue contention before it shows up in the
+ * utilization.
+ */
+u32 psi_cpu_some_time(int cpu)
+{
+	struct psi_group_cpu *groupc;
+	unsigned int seq;
+	u32 time;
+
+	if (static_branch_likely(&psi_disabled))
+		return 0;
+
+	groupc = per_cpu_ptr(psi_system.pcpu, cpu);
+	do {
+		seq = read_seqcount_begin(&groupc->seq);
+		time = groupc->times[PSI_CPU_SOME];
+		if (groupc->state_mask & (1 << PSI_CPU_SOME))
+			time += cpu_clock(cpu) - groupc->state_start;
+	} while (read_seqcount_retry(&groupc->seq, seq));
+
+	return time;
+}
+
 static void calc_avgs(unsigned long avg[3], int missed_periods,
 		      u64 time, u64 period)
 {
@@ -438,6 +468,37 @@ static u64 window_update(struct psi_window *win, u64 now, u64 value)
 	return growth;
 }
 
+/*
+ * Ring events are only produced by the rtpoll worker under
+ * rtpoll_trigger_lock, so there is a single producer per ring. Publish the
+ * entry before the head, readers detect being overrun by the head moving
+ * too far past their tail.
+ */
+static void psi_ring_record(struct psi_trigger *t, u64 now, u64 value)
+{
+	struct psi_ring_header *ring = t->ring;
+	u32 head = ring->head;
+	struct psi_ring_event *ev = &ring->events[head & (ring->nr_events - 1)];
+
+	ev->time = now;
+	ev->growth = value - t->win.start_value;
+	ev->state = t->state;
+	smp_store_release(&ring->head, head + 1);
+}
+
+static struct psi_ring_header *psi_ring_alloc(void)
+{
+	struct psi_ring_header *ring;
+
+	ring = vmalloc_user(PAGE_SIZE);
+	if (!ring)
+		return NULL;
+
+	ring->nr_events = rounddown_pow_of_two((PAGE_SIZE - sizeof(*ring)) /
+					       sizeof(ring->events[0]));
+	return ring;
+}
+
 static void update_triggers(struct psi_group *group, u64 now,
 						   enum psi_aggregators aggregator)
 {
@@ -487,6 +548,9 @@ static void update_triggers(struct psi_group *group, u64 now,
 		if (now < t->last_event_time + t->win.size)
 			continue;
 
+		if (t->ring)
+			psi_ring_record(t, now, total[t->state]);
+
 		/* Generate an event */
 		if (cmpxchg(&t->event, 0, 1) == 0) {
 			if (t->of)
@@ -1289,7 +1353,9 @@ struct psi_trigger *psi_trigger_create(struct psi_group *group, char *buf,
 	enum psi_states state;
 	u32 threshold_us;
 	bool privileged;
+	char mode[8];
 	u32 window_us;
+	int nr;
 
 	if (static_branch_likely(&psi_disabled))
 		return ERR_PTR(-EOPNOTSUPP);
@@ -1300,11 +1366,18 @@ struct psi_trigger *psi_trigger_create(struct psi_group *group, char *buf,
 	 */
 	privileged = cap_raised(file->f_cred->cap_effective, CAP_SYS_RESOURCE);
 
-	if (sscanf(buf, "some %u %u", &threshold_us, &window_us) == 2)
+	nr = sscanf(buf, "some %u %u %7s", &threshold_us, &window_us, mode);
+	if (nr >= 2) {
 		state = PSI_IO_SOME + res * 2;
-	else if (sscanf(buf, "full %u %u", &threshold_us, &window_us) == 2)
+	} else {
+		nr = sscanf(buf, "full %u %u %7s", &threshold_us, &window_us, mode);
+		if (nr < 2)
+			return ERR_PTR(-EINVAL);
 		state = PSI_IO_FULL + res * 2;
-	else
+	}
+
+	/* The event ring is only produced by the rtpoll worker */
+	if (nr == 3 && (strcmp(mode, "ring") || !privileged))
 		return ERR_PTR(-EINVAL);
 
 #ifdef CONFIG_IRQ_TIME_ACCOUNTING
@@ -1333,6 +1406,15 @@ struct psi_trigger *psi_trigger_create(struct psi_group *group, char *buf,
 	if (!t)
 		return ERR_PTR(-ENOMEM);
 
+	t->ring = NULL;
+	if (nr == 3) {
+		t->ring = psi_ring_alloc();
+		if (!t->ring) {
+			kfree(t);
+			return ERR_PTR(-ENOMEM);
+		}
+	}
+
 	t->group = group;
 	t->state = state;
 	t->threshold = threshold_us * NSEC_PER_USEC;
@@ -1356,6 +1438,7 @@ struct psi_trigger *psi_trigger_create(struct psi_group *group, char *buf,
 
 			task = kthread_create(psi_rtpoll_worker, group, "psimon");
 			if (IS_ERR(task)) {
+				vfree(t->ring);
 				kfree(t);
 				mutex_unlock(&group->rtpoll_trigger_lock);
 				return ERR_CAST(task);
@@ -1465,6 +1548,7 @@ void psi_trigger_destroy(struct psi_trigger *t)
 		kthread_stop(task_to_destroy);
 		atomic_set(&group->rtpoll_scheduled, 0);
 	}
+	vfree(t->ring);
 	kfree(t);
 }
 
@@ -1492,6 +1576,28 @@ __poll_t psi_trigger_poll(void **trigger_ptr,
 	return ret;
 }
 
+int psi_trigger_mmap(void **trigger_ptr, struct vm_area_struct *vma)
+{
+	struct psi_trigger *t;
+
+	if (static_branch_likely(&psi_disabled))
+		return -EOPNOTSUPP;
+
+	t = smp_load_acquire(trigger_ptr);
+	if (!t || !t->ring)
+		return -ENODEV;
+
+	if (vma->vm_pgoff || vma->vm_end - vma->vm_start != PAGE_SIZE)
+		return -EINVAL;
+
+	/* The ring is read-only for userspace */
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+	vm_flags_clear(vma, VM_MAYWRITE);
+
+	return remap_vmalloc_range(vma, t->ring, 0);
+}
+
 #ifdef CONFIG_PROC_FS
 static int psi_io_show(struct seq_file *m, void *v)
 {
@@ -1591,6 +1697,13 @@ static __poll_t psi_fop_poll(struct file *file, poll_table *wait)
 	return psi_trigger_poll(&seq->private, file, wait);
 }
 
+static int psi_fop_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct seq_file *seq = file->private_data;
+
+	return psi_trigger_mmap(&seq->private, vma);
+}
+
 static int psi_fop_release(struct inode *inode, struct file *file)
 {
 	struct seq_file *seq = file->private_data;
@@ -1605,6 +1718,7 @@ static const struct proc_ops psi_io_proc_ops = {
 	.proc_lseek	= seq_lseek,
 	.proc_write	= psi_io_write,
 	.proc_poll	= psi_fop_poll,
+	.proc_mmap	= psi_fop_mmap,
 	.proc_release	= psi_fop_release,
 };
 
@@ -1614,6 +1728,7 @@ static const struct proc_ops psi_memory_proc_ops = {
 	.proc_lseek	= seq_lseek,
 	.proc_write	= psi_memory_write,
 	.proc_poll	= psi_fop_poll,
+	.proc_mmap	= psi_fop_mmap,
 	.proc_release	= psi_fop_release,
 };
 
@@ -1623,6 +1738,7 @@ static const struct proc_ops psi_cpu_proc_ops = {
 	.proc_lseek	= seq_lseek,
 	.proc_write	= psi_cpu_write,
 	.proc_poll	= psi_fop_poll,
+	.proc_mmap	= psi_fop_mmap,
 	.proc_release	= psi_fop_release,
 };
 
@@ -1649,6 +1765,7 @@ static const struct proc_ops psi_irq_proc_ops = {
 	.proc_lseek	= seq_lseek,
 	.proc_write	= psi_irq_write,
 	.proc_poll	= psi_fop_poll,
+	.proc_mmap	= psi_fop_mmap,
 	.proc_release	= psi_fop_release,
 };
 #endif
@@ -431,6 +431,11 @@ struct cfs_bandwidth {
 struct task_group {
 	struct cgroup_subsys_state css;
 
+#ifdef CONFIG_SCHEDSTATS
+	/* Wakeup latency histograms of the tasks in this hierarchy */
+	struct sched_wake_hist __percpu *wake_hist;
+#endif
+
 #ifdef CONFIG_GROUP_SCHED_WEIGHT
 	/* A positive value indicates that this is a SCHED_IDLE group. */
 	int			idle;
@@ -477,6 +482,16 @@ struct task_group {
 
 	struct cfs_bandwidth	cfs_bandwidth;
 
+	/* Timer slack of the group's non-RT tasks, 0 leaves it per task */
+	u64			timer_slack_ns;
+
+#ifdef CONFIG_SCHED_BORE
+	/* Burst penalty scale of the group's tasks, 0 disables penalties */
+	unsigned int		bore_penalty_scale;
+	/* Whether forked tasks inherit the burst penalty of their family */
+	unsigned int		bore_inherit;
+#endif
+
 #ifdef CONFIG_UCLAMP_TASK_GROUP
 	/* The two decimal precision [%] value requested from user-space */
 	unsigned int		uclamp_pct[UCLAMP_CNT];
@@ -1262,6 +1277,17 @@ struct rq {
 	/* try_to_wake_up() stats */
 	unsigned int		ttwu_count;
 	unsigned int		ttwu_local;
+
+#ifdef CONFIG_SCHED_SSS
+	/* sss_select_task_rq_fair() stats */
+	unsigned int		sss_llc_fallback;
+#endif
+
+#ifdef CONFIG_SCHED_CORE
+	/* core scheduling stats */
+	u64			core_forceidle_sum;
+	unsigned int		ttwu_cookie_avoid;
+#endif
 #endif
 
 #ifdef CONFIG_CPU_IDLE
@@ -1409,25 +1435,25 @@ static inline bool sched_cpu_cookie_match(struct rq *rq, struct task_struct *p)
 
 static inline bool sched_core_cookie_match(struct rq *rq, struct task_struct *p)
 {
-	bool idle_core = true;
 	int cpu;
 
 	/* Ignore cookie match if core scheduler is not enabled on the CPU. */
 	if (!sched_core_enabled(rq))
 		return true;
 
-	for_each_cpu(cpu, cpu_smt_mask(cpu_of(rq))) {
-		if (!available_idle_cpu(cpu)) {
-			idle_core = false;
-			break;
-		}
-	}
+	if (rq->core->core_cookie == p->core_cookie)
+		return true;
 
 	/*
 	 * A CPU in an idle core is always the best choice for tasks with
 	 * cookies.
 	 */
-	return idle_core || rq->core->core_cookie == p->core_cookie;
+	for_each_cpu(cpu, cpu_smt_mask(cpu_of(rq))) {
+		if (!available_idle_cpu(cpu))
+			return false;
+	}
+
+	return true;
 }
 
 static inline bool sched_group_cookie_match(struct rq *rq,
@@ -3235,6 +3261,7 @@ static inline int irqtime_enabled(void)
 #ifdef CONFIG_CPU_FREQ
 
 DECLARE_PER_CPU(struct update_util_data __rcu *, cpufreq_update_util_data);
+DECLARE_PER_CPU(struct task_switch_data __rcu *, cpufreq_task_switch_data);
 
 /**
  * cpufreq_update_util - Take a note about CPU utilization changes.
@@ -3962,17 +3989,24 @@ int sss_select_task_rq_rt(struct task_struct *p, int prev_cpu, int wake_flags);
 void sss_rt_add_factor(int cpu, int normal_prio);
 void sss_rt_sub_factor(int cpu, int normal_prio);
 void __init sched_sss_init(void);
+void sss_update_spare(struct rq *rq);
+#ifdef CONFIG_DEBUG_FS
+void sss_debugfs_init(struct dentry *parent);
+#else
+static inline void sss_debugfs_init(struct dentry *parent) { }
+#endif
 int wake_wide(struct task_struct *p);
 void record_wakee(struct task_struct *p);
 #endif
 
 #ifdef CONFIG_SCHED_BORE
+#define BORE_PENALTY_SCALE	(3180)
+#define BORE_PENALTY_SCALE_MAX	(U16_MAX)
+
 void update_burst_score(struct sched_entity *se);
 void update_curr_bore(u64 delta_exec, struct sched_entity *se);
 void restart_burst(struct sched_entity *se);
 void restart_burst_rescale_deadline(struct sched_entity *se);
-void sched_clone_bore(struct task_struct *p, struct task_struct *parent,
-		      u64 clone_flags, u64 now);
 void reset_task_bore(struct task_struct *p);
 void reweight_entity(struct cfs_rq *cfs_rq, struct sched_entity *se,
 		     unsigned long weight, bool no_update_curr);
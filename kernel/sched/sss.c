@@ -5,36 +5,293 @@
 
 static __read_mostly unsigned int sched_sss_smt_bias = 4;
 static __read_mostly unsigned int sched_sss_llc_bias = 4;
+static __read_mostly unsigned int sched_sss_factor = SCHED_CAPACITY_SCALE >> 5;
+static __read_mostly unsigned int sched_sss_margin = SCHED_CAPACITY_SCALE >> 3;
 
-#define SSS_FACTOR (SCHED_CAPACITY_SCALE >> 5)
-#define SSS_MARGIN (SCHED_CAPACITY_SCALE >> 3)
+#define SSS_FACTOR ((long)sched_sss_factor)
+#define SSS_MARGIN ((long)sched_sss_margin)
+#define SSS_SNAP_THRESHOLD (SCHED_CAPACITY_SCALE >> 7)
 
 static __cacheline_aligned atomic_t sss_rt_factor_bank[CONFIG_NR_CPUS];
 static __read_mostly unsigned int sss_cpu_capacities[CONFIG_NR_CPUS];
+static __cacheline_aligned int sss_cpu_spare_snap[CONFIG_NR_CPUS];
+static __cacheline_aligned struct cpumask sss_idle_mask;
+static __cacheline_aligned struct cpumask sss_rt_free_mask;
 static __read_mostly struct cpumask sss_hp_mask;
 static __read_mostly bool sss_asymmetric;
 
+#define SSS_RT_NR_TIERS 4
+
+enum sss_rt_tier_policy {
+	SSS_RT_TIER_OFF,	/* Any HP core, E-cores as backup */
+	SSS_RT_TIER_RANKED,	/* Highest ranked idle physical core first */
+};
+
+static __read_mostly unsigned int sched_sss_rt_tier_policy = SSS_RT_TIER_RANKED;
+static __read_mostly unsigned int sss_rt_nr_tiers;
+static __read_mostly struct cpumask sss_rt_tier_mask[SSS_RT_NR_TIERS];
+static unsigned int sss_rt_cpu_freq[CONFIG_NR_CPUS];
+static DEFINE_MUTEX(sss_rt_tier_mutex);
+
 struct sss_candidate {
 	long factor;
 	int cpu;
 };
 
-int sss_select_task_rq_fair(struct task_struct *p, int prev_cpu, int wake_flags)
+/*
+ * Where sss_select_task_rq_fair() placed its wakeups, accounted on the waking
+ * cpu when schedstats are enabled.
+ */
+struct sss_stats {
+	unsigned long prev_cpu;		/* stayed on prev_cpu */
+	unsigned long this_cpu;		/* pulled to the waking cpu */
+	unsigned long cross_smt;	/* moved to an SMT sibling of prev_cpu */
+	unsigned long cross_llc;	/* moved out of prev_cpu's LLC */
+	unsigned long exec;		/* WF_EXEC, cache heuristics skipped */
+};
+
+static DEFINE_PER_CPU(struct sss_stats, sss_stats);
+
+/*
+ * Calculate the remaining capacity of the cpu owning @rq by subtracting its
+ * true capacity with its CFS, RT, DL utilization.
+ */
+static inline long sss_rq_spare(struct rq *rq)
 {
-	int this_cpu = raw_smp_processor_id(), cpu;
-	int p_queued, p_affine = 0;
-	long p_factor;
+	long spare = sss_cpu_capacities[cpu_of(rq)];
+
+	spare -= READ_ONCE(rq->cfs.avg.util_est);
+	spare -= READ_ONCE(rq->avg_rt.util_avg);
+	spare -= READ_ONCE(rq->avg_dl.util_avg);
+
+	return spare;
+}
+
+/*
+ * Remaining capacity of @cpu as last published by sss_update_spare(). Polling
+ * this dense array instead of three PELT fields in every candidate's rq keeps
+ * the wakeup scan from pulling one remote rq cacheline per cpu.
+ */
+static inline long sss_cpu_spare(int cpu)
+{
+	return READ_ONCE(sss_cpu_spare_snap[cpu]);
+}
+
+/*
+ * Publish the remaining capacity of @rq's cpu and keep the per-LLC "best
+ * remaining capacity" summary up to date. Called from the PELT update path
+ * with @rq locked.
+ *
+ * The snapshot is only rewritten when it drifts by more than
+ * SSS_SNAP_THRESHOLD, so that the cachelines of the array do not bounce on
+ * every PELT update.
+ *
+ * The summary is only a hint: it is raced against by every cpu of the LLC and
+ * it may lag behind when the best cpu of the LLC is not the one being updated.
+ * The consumer re-validates the hinted cpu before using it.
+ */
+void sss_update_spare(struct rq *rq)
+{
+	struct sched_domain_shared *sds;
+	int cpu = cpu_of(rq);
+	long spare;
+
+	spare = sss_rq_spare(rq);
+	if (abs(spare - sss_cpu_spare(cpu)) <= SSS_SNAP_THRESHOLD)
+		return;
+
+	WRITE_ONCE(sss_cpu_spare_snap[cpu], spare);
+
+	/*
+	 * Track cpus that are idle enough for a wakeup to stay put without
+	 * polling the rest of the candidates.
+	 */
+	if (spare >= (long)sss_cpu_capacities[cpu] - SSS_MARGIN) {
+		if (!cpumask_test_cpu(cpu, &sss_idle_mask))
+			cpumask_set_cpu(cpu, &sss_idle_mask);
+	} else {
+		if (cpumask_test_cpu(cpu, &sss_idle_mask))
+			cpumask_clear_cpu(cpu, &sss_idle_mask);
+	}
+
+	rcu_read_lock();
+	sds = rcu_dereference(per_cpu(sd_llc_shared, cpu));
+	if (unlikely(!sds))
+		goto unlock;
+
+	if (READ_ONCE(sds->sss_spare_cpu) == cpu ||
+	    spare > READ_ONCE(sds->sss_spare_cap)) {
+		WRITE_ONCE(sds->sss_spare_cap, spare);
+		WRITE_ONCE(sds->sss_spare_cpu, cpu);
+	}
+unlock:
+	rcu_read_unlock();
+}
+
+struct sss_fair_ctx {
+	struct task_struct *p;
 	const struct cpumask *prev_mask;
-	struct cpumask *llc_mask = NULL;
+	const struct cpumask *llc_mask;
+	long p_factor;
+	int p_queued;
+	int p_affine;
+	int prev_cpu;
+	int this_cpu;
+	int wake_flags;
+};
+
+/*
+ * With core scheduling, a cpu whose core runs another cookie would force
+ * either @p or its sibling idle: make it look busy.
+ */
+static inline long sss_cookie_penalty(int cpu, struct task_struct *p)
+{
+#ifdef CONFIG_SCHED_CORE
+	if (!sched_core_cookie_match(cpu_rq(cpu), p))
+		return SSS_MARGIN;
+#endif
+	return 0;
+}
+
+static long sss_fair_factor(int cpu, struct sss_fair_ctx *ctx)
+{
+	long factor = sss_cpu_spare(cpu);
+
+	/*
+	 * Account @p's factor to simulate cpu remaining capacity
+	 * if @p is enqueued on this cpu.
+	 */
+	if (ctx->p_queued)
+		factor -= (cpu != ctx->prev_cpu) ? ctx->p_factor : 0;
+	else
+		factor -= ctx->p_factor;
+
+	factor -= sss_cookie_penalty(cpu, ctx->p);
+
+	/*
+	 * For exec wakeup, skip cache heuristics altogether since it
+	 * won't benefit from it.
+	 */
+	if (ctx->wake_flags & WF_EXEC)
+		return factor;
+
+	/*
+	 * Performing cache heuristics on a busy cpu is a bad idea.
+	 */
+	if (factor < SSS_MARGIN)
+		return factor;
+
+	/*
+	 * If @p prefers wake-affine bias to both prev_cpu and this_cpu.
+	 */
+	if (ctx->p_affine && (cpu == ctx->this_cpu || cpu == ctx->prev_cpu))
+		factor += SSS_FACTOR * 8;
+
+	/*
+	 * Otherwise bias to prev_cpu and its SMT siblings.
+	 */
+	if (!ctx->p_affine && (ctx->wake_flags & WF_TTWU))
+		if (cpumask_test_cpu(cpu, ctx->prev_mask))
+			factor += SSS_FACTOR * (long)sched_sss_smt_bias;
+
+	/*
+	 * Penalize candidates that doesn't share LLC with prev_cpu.
+	 */
+	if (likely(ctx->llc_mask) && cpumask_test_cpu(cpu, ctx->llc_mask))
+		factor += SSS_FACTOR * (long)sched_sss_llc_bias;
+
+	return factor;
+}
+
+static void sss_scan_fair(const struct cpumask *cpus, struct sss_fair_ctx *ctx,
+			  struct sss_candidate *best)
+{
+	struct sss_candidate curr;
+
+	for_each_cpu(curr.cpu, cpus) {
+		curr.factor = sss_fair_factor(curr.cpu, ctx);
+
+		/*
+		 * The cpu with the highest remaining capacity, wins.
+		 */
+		if (curr.factor > best->factor)
+			*best = curr;
+	}
+}
+
+/*
+ * Second level of the hierarchical scan: instead of polling every remaining
+ * cpu, consult the per-LLC summary maintained by sss_update_spare(), which
+ * makes the cost proportional to the number of LLCs rather than cpus.
+ *
+ * @cpus is consumed.
+ */
+static void sss_scan_llc_spare(struct cpumask *cpus, struct sss_fair_ctx *ctx,
+			       struct sss_candidate *best)
+{
+	struct sched_domain_shared *sds;
 	struct sched_domain *sd;
-	struct rq *rq;
+	struct sss_candidate curr;
+	int cpu;
+
+	rcu_read_lock();
+	while ((cpu = cpumask_first(cpus)) < nr_cpu_ids) {
+		sd = rcu_dereference(per_cpu(sd_llc, cpu));
+		sds = rcu_dereference(per_cpu(sd_llc_shared, cpu));
+		if (unlikely(!sd || !sds)) {
+			__cpumask_clear_cpu(cpu, cpus);
+			continue;
+		}
+
+		curr.cpu = READ_ONCE(sds->sss_spare_cpu);
+		if (cpumask_test_cpu(curr.cpu, cpus)) {
+			/* Re-validate the hint, it might be stale. */
+			curr.factor = sss_cpu_spare(curr.cpu) - ctx->p_factor -
+				      sss_cookie_penalty(curr.cpu, ctx->p);
+			if (curr.factor > best->factor)
+				*best = curr;
+		}
+
+		cpumask_andnot(cpus, cpus, sched_domain_span(sd));
+	}
+	rcu_read_unlock();
+}
+
+static void sss_account_fair(int cpu, int prev_cpu, int this_cpu, int wake_flags)
+{
+	if (!schedstat_enabled())
+		return;
 
+	if (wake_flags & WF_EXEC)
+		this_cpu_inc(sss_stats.exec);
+
+	if (cpu == prev_cpu)
+		this_cpu_inc(sss_stats.prev_cpu);
+	else if (cpu == this_cpu)
+		this_cpu_inc(sss_stats.this_cpu);
+
+	if (!cpus_share_cache(cpu, prev_cpu))
+		this_cpu_inc(sss_stats.cross_llc);
+	else if (cpu != prev_cpu && cpumask_test_cpu(cpu, cpu_smt_mask(prev_cpu)))
+		this_cpu_inc(sss_stats.cross_smt);
+}
+
+static int __sss_select_task_rq_fair(struct task_struct *p, int prev_cpu,
+				     int this_cpu, int wake_flags)
+{
+	struct sched_domain *sd;
+
+	struct sss_fair_ctx ctx = {
+		.p = p,
+		.prev_cpu = prev_cpu,
+		.this_cpu = this_cpu,
+		.wake_flags = wake_flags,
+	};
 	struct sss_candidate best = {
 		.cpu = prev_cpu,
 		.factor = 0
 	};
-	struct sss_candidate curr;
-	struct cpumask cpus;
+	struct cpumask cpus, scan;
 
 	if (unlikely(!cpumask_and(&cpus, p->cpus_ptr, cpu_active_mask)))
 		return cpumask_first(p->cpus_ptr);
@@ -49,83 +306,156 @@ int sss_select_task_rq_fair(struct task_struct *p, int prev_cpu, int wake_flags)
 		if (((wake_flags & WF_CURRENT_CPU) || sync) && valid)
 			return this_cpu;
 
-		p_affine = !wake_wide(p) && valid;
+		ctx.p_affine = !wake_wide(p) && valid;
 	}
 
 	rcu_read_lock();
 	sd = rcu_dereference(per_cpu(sd_llc, prev_cpu));
 	if (likely(sd))
-		llc_mask = sched_domain_span(sd);
+		ctx.llc_mask = sched_domain_span(sd);
+
+	/*
+	 * Two-level selection: only scan the LLC of prev_cpu (and this_cpu's
+	 * when wake-affine) here, the rest of the system is looked at through
+	 * the per-LLC summary once the local LLC turns out to be saturated.
+	 */
+	if (sched_feat(SSS_LLC_SCAN) && likely(ctx.llc_mask)) {
+		cpumask_and(&scan, &cpus, ctx.llc_mask);
+		if (ctx.p_affine) {
+			sd = rcu_dereference(per_cpu(sd_llc, this_cpu));
+			if (likely(sd))
+				cpumask_or(&scan, &scan, sched_domain_span(sd));
+			cpumask_and(&scan, &scan, &cpus);
+		}
+	} else {
+		cpumask_copy(&scan, &cpus);
+	}
 	rcu_read_unlock();
 
-	if (!p_affine)
-		prev_mask = cpu_smt_mask(prev_cpu);
-	p_factor = READ_ONCE(p->se.avg.util_est) & ~UTIL_AVG_UNCHANGED;
-	p_queued = task_on_rq_queued(p) || current == p;
+	if (!ctx.p_affine)
+		ctx.prev_mask = cpu_smt_mask(prev_cpu);
+	ctx.p_factor = READ_ONCE(p->se.avg.util_est) & ~UTIL_AVG_UNCHANGED;
+	ctx.p_queued = task_on_rq_queued(p) || current == p;
 
-	for_each_cpu(cpu, &cpus) {
-		curr.cpu = cpu;
-		curr.factor = sss_cpu_capacities[cpu];
-		rq = cpu_rq(cpu);
+	/*
+	 * Fast path: an idle enough, highest capacity prev_cpu would win the
+	 * scan anyway due to the SMT and LLC bias, don't bother polling.
+	 */
+	if (sched_feat(SSS_FAST_PATH) && (wake_flags & WF_TTWU) &&
+	    !ctx.p_affine && cpumask_test_cpu(prev_cpu, &scan) &&
+	    cpumask_test_cpu(prev_cpu, &sss_idle_mask) &&
+	    (!sss_asymmetric || cpumask_test_cpu(prev_cpu, &sss_hp_mask)) &&
+	    sss_fair_factor(prev_cpu, &ctx) >= SSS_MARGIN)
+		return prev_cpu;
 
-		/*
-		 * Calculate the remaining capacity of this cpu by subtracting
-		 * its true capacity with its CFS, RT, DL utilization.
-		 */
-		curr.factor -= READ_ONCE(rq->cfs.avg.util_est);
-		curr.factor -= READ_ONCE(rq->avg_rt.util_avg);
-		curr.factor -= READ_ONCE(rq->avg_dl.util_avg);
+	sss_scan_fair(&scan, &ctx, &best);
 
-		/*
-		 * Account @p's factor to simulate cpu remaining capacity
-		 * if @p is enqueued on this cpu.
-		 */
-		if (p_queued)
-			curr.factor -= (cpu != prev_cpu) ? p_factor : 0;
-		else
-			curr.factor -= p_factor;
+	if (best.factor >= SSS_MARGIN)
+		return best.cpu;
 
-		/*
-		 * For exec wakeup, skip cache heuristics altogether since it
-		 * won't benefit from it.
-		 */
-		if (wake_flags & WF_EXEC)
-			goto out;
+	if (cpumask_andnot(&cpus, &cpus, &scan)) {
+		schedstat_inc(cpu_rq(this_cpu)->sss_llc_fallback);
+		sss_scan_llc_spare(&cpus, &ctx, &best);
+	}
 
-		/*
-		 * Performing cache heuristics on a busy cpu is a bad idea.
-		 */
-		if (curr.factor < SSS_MARGIN)
-			goto out;
+	return best.cpu;
+}
 
-		/*
-		 * If @p prefers wake-affine bias to both prev_cpu and this_cpu.
-		 */
-		if (p_affine && (cpu == this_cpu || cpu == prev_cpu))
-			curr.factor += SSS_FACTOR * 8;
+int sss_select_task_rq_fair(struct task_struct *p, int prev_cpu, int wake_flags)
+{
+	int this_cpu = raw_smp_processor_id();
+	int cpu = __sss_select_task_rq_fair(p, prev_cpu, this_cpu, wake_flags);
 
-		/*
-		 * Otherwise bias to prev_cpu and its SMT siblings.
-		 */
-		if (!p_affine && (wake_flags & WF_TTWU))
-			if (cpumask_test_cpu(cpu, prev_mask))
-				curr.factor += SSS_FACTOR * (long)sched_sss_smt_bias;
+	sss_account_fair(cpu, prev_cpu, this_cpu, wake_flags);
 
-		/*
-		 * Penalize candidates that doesn't share LLC with prev_cpu.
-		 */
-		if (likely(llc_mask) && cpumask_test_cpu(cpu, llc_mask))
-			curr.factor += SSS_FACTOR * (long)sched_sss_llc_bias;
+	return cpu;
+}
 
-out:
-		/*
-		 * The cpu with the highest remaining capacity, wins.
-		 */
-		if (curr.factor > best.factor)
-			best = curr;
+/*
+ * Rank of @cpu for RT placement: the ITMT/asym priority decides first, the
+ * hardware max frequency breaks ties between cores ranked equally by the
+ * firmware (e.g. P-cores of the same ITMT class but with different boost).
+ */
+static u64 sss_rt_rank(int cpu)
+{
+	u32 prio = (u32)arch_asym_cpu_priority(cpu) ^ BIT(31);
+
+	return ((u64)prio << 32) | sss_rt_cpu_freq[cpu];
+}
+
+/*
+ * Split the present cpus into at most SSS_RT_NR_TIERS tiers of equal rank,
+ * tier 0 being the highest ranked. Readers are lockless and may observe a
+ * transient mix of the old and the new tiers, which is harmless.
+ */
+static void sss_rt_build_tiers(void)
+{
+	u64 rank, best, prev = U64_MAX;
+	unsigned int tier;
+	int cpu;
+
+	mutex_lock(&sss_rt_tier_mutex);
+	for (tier = 0; tier < SSS_RT_NR_TIERS; tier++) {
+		best = 0;
+		for_each_cpu(cpu, cpu_present_mask) {
+			rank = sss_rt_rank(cpu);
+			if (rank < prev && rank >= best)
+				best = rank;
+		}
+
+		cpumask_clear(&sss_rt_tier_mask[tier]);
+		for_each_cpu(cpu, cpu_present_mask) {
+			rank = sss_rt_rank(cpu);
+			/* The last tier holds everything below. */
+			if (rank == best ||
+			    (tier == SSS_RT_NR_TIERS - 1 && rank < best))
+				cpumask_set_cpu(cpu, &sss_rt_tier_mask[tier]);
+		}
+
+		if (cpumask_empty(&sss_rt_tier_mask[tier]))
+			break;
+		prev = best;
 	}
+	WRITE_ONCE(sss_rt_nr_tiers, tier);
+	mutex_unlock(&sss_rt_tier_mutex);
+}
 
-	return best.cpu;
+/*
+ * A physical core is idle when none of its SMT siblings runs RT tasks nor
+ * carries a meaningful CFS/DL utilization.
+ */
+static bool sss_rt_core_idle(int cpu)
+{
+	int sibling;
+
+	for_each_cpu(sibling, cpu_smt_mask(cpu)) {
+		if (!cpumask_test_cpu(sibling, &sss_rt_free_mask) ||
+		    !cpumask_test_cpu(sibling, &sss_idle_mask))
+			return false;
+	}
+
+	return true;
+}
+
+static int sss_select_rt_tiered(const struct cpumask *cpus)
+{
+	unsigned int tier, nr_tiers = READ_ONCE(sss_rt_nr_tiers);
+	struct cpumask tmp;
+	int cpu;
+
+	for (tier = 0; tier < nr_tiers; tier++) {
+		if (!cpumask_and(&tmp, cpus, &sss_rt_tier_mask[tier]))
+			continue;
+		if (!cpumask_and(&tmp, &tmp, &sss_rt_free_mask))
+			continue;
+
+		for_each_cpu(cpu, &tmp) {
+			if (sss_rt_core_idle(cpu))
+				return cpu;
+		}
+	}
+
+	return nr_cpu_ids;
 }
 
 int sss_select_task_rq_rt(struct task_struct *p, int prev_cpu, int wake_flags)
@@ -163,6 +493,32 @@ int sss_select_task_rq_rt(struct task_struct *p, int prev_cpu, int wake_flags)
 		rcu_read_unlock();
 	}
 
+	/*
+	 * Prefer the highest ranked fully idle physical core, so that the
+	 * sibling does not eat into its boost headroom.
+	 */
+	if (READ_ONCE(sched_sss_rt_tier_policy) == SSS_RT_TIER_RANKED) {
+		cpu = sss_select_rt_tiered(&cpus);
+		if (cpu < nr_cpu_ids)
+			return cpu;
+	}
+
+	/*
+	 * Fast path: the accumulated priority is never negative, so a cpu
+	 * without any RT task already is the lowest possible candidate. The
+	 * only one that can beat it is a still queued prev_cpu, which does
+	 * not get @p's factor accounted.
+	 */
+	if (sched_feat(SSS_FAST_PATH)) {
+		struct cpumask free;
+
+		if (!p_queued || !cpumask_test_cpu(prev_cpu, &cpus) ||
+		    atomic_read(&sss_rt_factor_bank[prev_cpu]) >= p_factor) {
+			if (cpumask_and(&free, &cpus, &sss_rt_free_mask))
+				return cpumask_first(&free);
+		}
+	}
+
 	for_each_cpu(cpu, &cpus) {
 		curr.cpu = cpu;
 		curr.factor = atomic_read(&sss_rt_factor_bank[cpu]);
@@ -186,14 +542,20 @@ int sss_select_task_rq_rt(struct task_struct *p, int prev_cpu, int wake_flags)
 	return best.cpu;
 }
 
+/*
+ * Both are called with the rq of @cpu locked, which serializes the updates of
+ * sss_rt_free_mask for a given cpu.
+ */
 void sss_rt_add_factor(int cpu, int normal_prio)
 {
-	atomic_add(MAX_RT_PRIO - normal_prio, &sss_rt_factor_bank[cpu]);
+	if (!atomic_fetch_add(MAX_RT_PRIO - normal_prio, &sss_rt_factor_bank[cpu]))
+		cpumask_clear_cpu(cpu, &sss_rt_free_mask);
 }
 
 void sss_rt_sub_factor(int cpu, int normal_prio)
 {
-	atomic_sub(MAX_RT_PRIO - normal_prio, &sss_rt_factor_bank[cpu]);
+	if (!atomic_sub_return(MAX_RT_PRIO - normal_prio, &sss_rt_factor_bank[cpu]))
+		cpumask_set_cpu(cpu, &sss_rt_free_mask);
 }
 
 void __init sched_sss_init(void)
@@ -205,6 +567,9 @@ void __init sched_sss_init(void)
 
 	for_each_cpu(cpu, cpu_present_mask) {
 		sss_cpu_capacities[cpu] = arch_scale_cpu_capacity(cpu);
+		sss_cpu_spare_snap[cpu] = sss_cpu_capacities[cpu];
+		cpumask_set_cpu(cpu, &sss_idle_mask);
+		cpumask_set_cpu(cpu, &sss_rt_free_mask);
 
 		if (sss_cpu_capacities[cpu] < lowest_cap) {
 			cpumask_clear(&tmp_lp_mask);
@@ -225,10 +590,147 @@ void __init sched_sss_init(void)
 	 */
 	if (cpumask_weight(&tmp_lp_mask) <= cpumask_weight(&sss_hp_mask))
 		sss_asymmetric = true;
+
+	sss_rt_build_tiers();
 }
 
+/*
+ * cpufreq drivers register long after sched_sss_init(), refresh the tiers
+ * with the hardware max frequencies as their policies come and go.
+ */
+static int sss_cpufreq_policy_notifier(struct notifier_block *nb,
+				       unsigned long event, void *data)
+{
+	struct cpufreq_policy *policy = data;
+	int cpu;
+
+	if (event != CPUFREQ_CREATE_POLICY && event != CPUFREQ_REMOVE_POLICY)
+		return NOTIFY_DONE;
+
+	for_each_cpu(cpu, policy->related_cpus) {
+		WRITE_ONCE(sss_rt_cpu_freq[cpu],
+			   event == CPUFREQ_CREATE_POLICY ?
+			   policy->cpuinfo.max_freq : 0);
+	}
+
+	sss_rt_build_tiers();
+
+	return NOTIFY_OK;
+}
+
+static struct notifier_block sss_cpufreq_policy_nb = {
+	.notifier_call = sss_cpufreq_policy_notifier,
+};
+
+static int __init sched_sss_cpufreq_init(void)
+{
+	return cpufreq_register_notifier(&sss_cpufreq_policy_nb,
+					 CPUFREQ_POLICY_NOTIFIER);
+}
+core_initcall(sched_sss_cpufreq_init);
+
+#ifdef CONFIG_DEBUG_FS
+static int sss_rt_tiers_show(struct seq_file *m, void *v)
+{
+	unsigned int tier;
+	int cpu;
+
+	seq_printf(m, "%-6s %-5s %-12s %s\n", "cpu", "tier", "asym_prio", "max_freq");
+	for (tier = 0; tier < READ_ONCE(sss_rt_nr_tiers); tier++) {
+		for_each_cpu(cpu, &sss_rt_tier_mask[tier]) {
+			seq_printf(m, "%-6d %-5u %-12d %u\n", cpu, tier,
+				   arch_asym_cpu_priority(cpu),
+				   READ_ONCE(sss_rt_cpu_freq[cpu]));
+		}
+	}
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(sss_rt_tiers);
+
+static ssize_t sss_rt_tier_policy_write(struct file *filp, const char __user *ubuf,
+					size_t cnt, loff_t *ppos)
+{
+	unsigned int policy;
+	int ret;
+
+	ret = kstrtouint_from_user(ubuf, cnt, 10, &policy);
+	if (ret)
+		return ret;
+
+	if (policy > SSS_RT_TIER_RANKED)
+		return -EINVAL;
+
+	/* Pick up ITMT priority changes made since the last rebuild. */
+	sss_rt_build_tiers();
+	WRITE_ONCE(sched_sss_rt_tier_policy, policy);
+
+	return cnt;
+}
+
+static int sss_rt_tier_policy_show(struct seq_file *m, void *v)
+{
+	seq_printf(m, "%u\n", READ_ONCE(sched_sss_rt_tier_policy));
+	return 0;
+}
+
+static int sss_rt_tier_policy_open(struct inode *inode, struct file *filp)
+{
+	return single_open(filp, sss_rt_tier_policy_show, NULL);
+}
+
+static const struct file_operations sss_rt_tier_policy_fops = {
+	.open		= sss_rt_tier_policy_open,
+	.write		= sss_rt_tier_policy_write,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int sss_stats_show(struct seq_file *m, void *v)
+{
+	struct sss_stats *st, sum = { };
+	int cpu;
+
+	if (!schedstat_enabled())
+		seq_puts(m, "# kernel.sched_schedstats is disabled\n");
+
+	seq_printf(m, "%-6s %-12s %-12s %-12s %-12s %s\n", "cpu",
+		   "prev_cpu", "this_cpu", "cross_smt", "cross_llc", "exec");
+	for_each_possible_cpu(cpu) {
+		st = per_cpu_ptr(&sss_stats, cpu);
+		seq_printf(m, "%-6d %-12lu %-12lu %-12lu %-12lu %lu\n", cpu,
+			   st->prev_cpu, st->this_cpu, st->cross_smt,
+			   st->cross_llc, st->exec);
+		sum.prev_cpu += st->prev_cpu;
+		sum.this_cpu += st->this_cpu;
+		sum.cross_smt += st->cross_smt;
+		sum.cross_llc += st->cross_llc;
+		sum.exec += st->exec;
+	}
+	seq_printf(m, "%-6s %-12lu %-12lu %-12lu %-12lu %lu\n", "all",
+		   sum.prev_cpu, sum.this_cpu, sum.cross_smt,
+		   sum.cross_llc, sum.exec);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(sss_stats);
+
+void sss_debugfs_init(struct dentry *parent)
+{
+	struct dentry *d_sss;
+
+	d_sss = debugfs_create_dir("sss", parent);
+
+	debugfs_create_file("rt_tier_policy", 0644, d_sss, NULL, &sss_rt_tier_policy_fops);
+	debugfs_create_file("rt_tiers", 0444, d_sss, NULL, &sss_rt_tiers_fops);
+	debugfs_create_file("stats", 0444, d_sss, NULL, &sss_stats_fops);
+}
+#endif
+
 #ifdef CONFIG_SYSCTL
 static int sss_maxval_eight = 8;
+static int sss_maxval_capacity = SCHED_CAPACITY_SCALE;
 static const struct ctl_table sched_sss_sysctls[] = {
 	{
 		.procname	= "sched_sss_smt_bias",
@@ -248,6 +750,24 @@ static const struct ctl_table sched_sss_sysctls[] = {
 		.extra1		= SYSCTL_ZERO,
 		.extra2		= &sss_maxval_eight,
 	},
+	{
+		.procname	= "sched_sss_factor",
+		.data		= &sched_sss_factor,
+		.maxlen		= sizeof(unsigned int),
+		.mode		= 0644,
+		.proc_handler	= proc_douintvec_minmax,
+		.extra1		= SYSCTL_ZERO,
+		.extra2		= &sss_maxval_capacity,
+	},
+	{
+		.procname	= "sched_sss_margin",
+		.data		= &sched_sss_margin,
+		.maxlen		= sizeof(unsigned int),
+		.mode		= 0644,
+		.proc_handler	= proc_douintvec_minmax,
+		.extra1		= SYSCTL_ZERO,
+		.extra2		= &sss_maxval_capacity,
+	},
 };
 
 static int __init sched_sss_sysctl_init(void)
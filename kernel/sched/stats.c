@@ -97,6 +97,53 @@ void __update_stats_enqueue_sleeper(struct rq *rq, struct task_struct *p,
 	}
 }
 
+DEFINE_STATIC_KEY_FALSE(sched_wake_hist);
+
+static inline unsigned int sched_wake_hist_bucket(s64 delta)
+{
+	if (delta <= 0)
+		return 0;
+
+	return min_t(unsigned int, fls64((u64)delta >> SCHED_WAKE_HIST_SHIFT),
+		     SCHED_WAKE_HIST_BUCKETS - 1);
+}
+
+/*
+ * Account @delta to @p and to the cgroups it belongs to. Called with either
+ * @p->pi_lock or the rq lock held, and interrupts disabled.
+ */
+void __sched_wake_hist_account(struct task_struct *p,
+			       enum sched_wake_hist_type type, s64 delta)
+{
+	unsigned int bucket = sched_wake_hist_bucket(delta);
+#ifdef CONFIG_CGROUP_SCHED
+	struct task_group *tg;
+
+	for (tg = task_group(p); tg; tg = tg->parent) {
+		if (tg->wake_hist)
+			__this_cpu_inc(tg->wake_hist->count[type][bucket]);
+	}
+#endif
+	p->wake_stats.hist.count[type][bucket]++;
+}
+
+void sched_wake_hist_show(struct seq_file *m, const struct sched_wake_hist *hist)
+{
+	static const char * const names[NR_SCHED_WAKE_HIST] = {
+		[SCHED_WAKE_HIST_SELECT]	= "select",
+		[SCHED_WAKE_HIST_IPI]		= "ipi",
+		[SCHED_WAKE_HIST_WAIT]		= "wait",
+	};
+	int i, j;
+
+	for (i = 0; i < NR_SCHED_WAKE_HIST; i++) {
+		seq_printf(m, "wake_hist.%s", names[i]);
+		for (j = 0; j < SCHED_WAKE_HIST_BUCKETS; j++)
+			seq_printf(m, " %u", hist->count[i][j]);
+		seq_putc(m, '\n');
+	}
+}
+
 /*
  * Current schedstat API version.
  *
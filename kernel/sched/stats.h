@@ -52,6 +52,58 @@ void __update_stats_wait_end(struct rq *rq, struct task_struct *p,
 void __update_stats_enqueue_sleeper(struct rq *rq, struct task_struct *p,
 				    struct sched_statistics *stats);
 
+extern struct static_key_false sched_wake_hist;
+
+#define sched_wake_hist_enabled()	static_branch_unlikely(&sched_wake_hist)
+
+void __sched_wake_hist_account(struct task_struct *p,
+			       enum sched_wake_hist_type type, s64 delta);
+void sched_wake_hist_show(struct seq_file *m, const struct sched_wake_hist *hist);
+
+/* Start timestamp for sched_wake_hist_since(), 0 while disabled. */
+static inline u64 sched_wake_hist_clock(void)
+{
+	return sched_wake_hist_enabled() ? local_clock() : 0;
+}
+
+static inline void sched_wake_hist_since(struct task_struct *p,
+					 enum sched_wake_hist_type type, u64 start)
+{
+	if (start)
+		__sched_wake_hist_account(p, type, local_clock() - start);
+}
+
+/* @p is being queued on a remote wakelist. */
+static inline void sched_wake_hist_queue(struct task_struct *p)
+{
+	p->wake_stats.queued = sched_wake_hist_clock();
+}
+
+/* @p is being activated on @rq, whose clock is up to date. */
+static inline void sched_wake_hist_activate(struct rq *rq, struct task_struct *p)
+{
+	if (!sched_wake_hist_enabled())
+		return;
+
+	if (p->wake_stats.queued) {
+		__sched_wake_hist_account(p, SCHED_WAKE_HIST_IPI,
+					  local_clock() - p->wake_stats.queued);
+		p->wake_stats.queued = 0;
+	}
+	p->wake_stats.enqueued = rq_clock(rq);
+}
+
+/* @p is about to run on @rq after its wakeup. */
+static inline void sched_wake_hist_run(struct rq *rq, struct task_struct *p)
+{
+	if (!sched_wake_hist_enabled() || !p->wake_stats.enqueued)
+		return;
+
+	__sched_wake_hist_account(p, SCHED_WAKE_HIST_WAIT,
+				  rq_clock(rq) - p->wake_stats.enqueued);
+	p->wake_stats.enqueued = 0;
+}
+
 static inline void
 check_schedstat_required(void)
 {
@@ -87,6 +139,13 @@ static inline void rq_sched_info_depart  (struct rq *rq, unsigned long long delt
 # define __update_stats_enqueue_sleeper(rq, p, stats)  do { } while (0)
 # define check_schedstat_required()                    do { } while (0)
 
+static inline u64 sched_wake_hist_clock(void) { return 0; }
+static inline void sched_wake_hist_since(struct task_struct *p,
+					 enum sched_wake_hist_type type, u64 start) { }
+static inline void sched_wake_hist_queue(struct task_struct *p) { }
+static inline void sched_wake_hist_activate(struct rq *rq, struct task_struct *p) { }
+static inline void sched_wake_hist_run(struct rq *rq, struct task_struct *p) { }
+
 #endif /* CONFIG_SCHEDSTATS */
 
 #ifdef CONFIG_FAIR_GROUP_SCHED
@@ -107,6 +166,7 @@ __schedstats_from_se(struct sched_entity *se)
 }
 
 #ifdef CONFIG_PSI
+u32 psi_cpu_some_time(int cpu);
 void psi_task_change(struct task_struct *task, int clear, int set);
 void psi_task_switch(struct task_struct *prev, struct task_struct *next,
 		     bool sleep);
@@ -221,6 +281,7 @@ static inline void psi_sched_switch(struct task_struct *prev,
 }
 
 #else /* CONFIG_PSI */
+static inline u32 psi_cpu_some_time(int cpu) { return 0; }
 static inline void psi_enqueue(struct task_struct *p, bool migrate) {}
 static inline void psi_dequeue(struct task_struct *p, bool migrate) {}
 static inline void psi_ttwu_dequeue(struct task_struct *p) {}
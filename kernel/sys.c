@@ -39,12 +39,14 @@
 #include <linux/ptrace.h>
 #include <linux/fs_struct.h>
 #include <linux/file.h>
+#include <linux/fdtable.h>
 #include <linux/mount.h>
 #include <linux/gfp.h>
 #include <linux/syscore_ops.h>
 #include <linux/version.h>
 #include <linux/ctype.h>
 #include <linux/syscall_user_dispatch.h>
+#include <linux/futex.h>
 
 #include <linux/compat.h>
 #include <linux/syscalls.h>
@@ -2580,6 +2582,7 @@ SYSCALL_DEFINE5(prctl, int, option, unsigned long, arg2, unsigned long, arg3,
 					current->default_timer_slack_ns;
 		else
 			current->timer_slack_ns = arg2;
+		current->saved_timer_slack_ns = 0;
 		break;
 	case PR_MCE_KILL:
 		if (arg4 | arg5)
@@ -2820,6 +2823,21 @@ SYSCALL_DEFINE5(prctl, int, option, unsigned long, arg2, unsigned long, arg3,
 			return -EINVAL;
 		error = posixtimer_create_prctl(arg2);
 		break;
+	case PR_SET_FD_CACHE:
+		if (arg3 || arg4 || arg5)
+			return -EINVAL;
+		error = set_fd_cache(arg2);
+		break;
+	case PR_GET_FD_CACHE:
+		if (arg2 || arg3 || arg4 || arg5)
+			return -EINVAL;
+		error = !!me->fd_cache;
+		break;
+	case PR_FUTEX_HASH:
+		if (arg5)
+			return -EINVAL;
+		error = futex_hash_prctl(arg2, arg3, arg4);
+		break;
 	default:
 		trace_task_prctl_unknown(option, arg2, arg3, arg4, arg5);
 		error = -EINVAL;
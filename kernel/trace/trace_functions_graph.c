@@ -346,18 +346,34 @@ static void handle_nosleeptime(struct ftrace_graph_ret *trace,
 	ftimes->calltime += current->ftrace_sleeptime - ftimes->sleeptime;
 }
 
+static void graph_return_commit(struct ftrace_graph_ret *trace,
+				struct trace_array *tr,
+				u64 calltime, u64 rettime)
+{
+	struct trace_array_cpu *data;
+	unsigned int trace_ctx;
+	long disabled;
+	int cpu;
+
+	preempt_disable_notrace();
+	cpu = raw_smp_processor_id();
+	data = per_cpu_ptr(tr->array_buffer.data, cpu);
+	disabled = atomic_read(&data->disabled);
+	if (likely(!disabled)) {
+		trace_ctx = tracing_gen_ctx();
+		__trace_graph_return(tr, trace, trace_ctx, calltime, rettime);
+	}
+	preempt_enable_notrace();
+}
+
 void trace_graph_return(struct ftrace_graph_ret *trace,
 			struct fgraph_ops *gops, struct ftrace_regs *fregs)
 {
 	unsigned long *task_var = fgraph_get_task_var(gops);
 	struct trace_array *tr = gops->private;
-	struct trace_array_cpu *data;
 	struct fgraph_times *ftimes;
-	unsigned int trace_ctx;
-	u64 calltime, rettime;
-	long disabled;
+	u64 rettime;
 	int size;
-	int cpu;
 
 	rettime = trace_clock_local();
 
@@ -374,30 +390,30 @@ void trace_graph_return(struct ftrace_graph_ret *trace,
 
 	handle_nosleeptime(trace, ftimes, size);
 
-	calltime = ftimes->calltime;
-
-	preempt_disable_notrace();
-	cpu = raw_smp_processor_id();
-	data = per_cpu_ptr(tr->array_buffer.data, cpu);
-	disabled = atomic_read(&data->disabled);
-	if (likely(!disabled)) {
-		trace_ctx = tracing_gen_ctx();
-		__trace_graph_return(tr, trace, trace_ctx, calltime, rettime);
-	}
-	preempt_enable_notrace();
+	graph_return_commit(trace, tr, ftimes->calltime, rettime);
 }
 
+/*
+ * With tracing_thresh set, graph_entry() writes nothing and the duration is
+ * checked here, so functions faster than the threshold never touch the ring
+ * buffer. The return timestamp is taken once and reused for the event.
+ */
 static void trace_graph_thresh_return(struct ftrace_graph_ret *trace,
 				      struct fgraph_ops *gops,
 				      struct ftrace_regs *fregs)
 {
+	unsigned long *task_var = fgraph_get_task_var(gops);
+	struct trace_array *tr = gops->private;
 	struct fgraph_times *ftimes;
+	u64 rettime;
 	int size;
 
+	rettime = trace_clock_local();
+
 	ftrace_graph_addr_finish(gops, trace);
 
-	if (trace_recursion_test(TRACE_GRAPH_NOTRACE_BIT)) {
-		trace_recursion_clear(TRACE_GRAPH_NOTRACE_BIT);
+	if (*task_var & TRACE_GRAPH_NOTRACE) {
+		*task_var &= ~TRACE_GRAPH_NOTRACE;
 		return;
 	}
 
@@ -407,11 +423,10 @@ static void trace_graph_thresh_return(struct ftrace_graph_ret *trace,
 
 	handle_nosleeptime(trace, ftimes, size);
 
-	if (tracing_thresh &&
-	    (trace_clock_local() - ftimes->calltime < tracing_thresh))
+	if (tracing_thresh && (rettime - ftimes->calltime < tracing_thresh))
 		return;
-	else
-		trace_graph_return(trace, gops, fregs);
+
+	graph_return_commit(trace, tr, ftimes->calltime, rettime);
 }
 
 static struct fgraph_ops funcgraph_ops = {
@@ -243,10 +243,18 @@ enum pool_workqueue_stats {
 	PWQ_STAT_REPATRIATED,	/* unbound workers brought back into scope */
 	PWQ_STAT_MAYDAY,	/* maydays to rescuer */
 	PWQ_STAT_RESCUED,	/* linked work items executed by rescuer */
+	PWQ_STAT_THROTTLED,	/* work items delayed by max_active */
 
 	PWQ_NR_STATS,
 };
 
+/*
+ * Queueing latency histogram. One queued work item per pwq at a time is
+ * sampled, and the time until it starts executing is accounted in power of
+ * four buckets starting at 4us, the last one being open-ended.
+ */
+#define PWQ_NR_LAT_BUCKETS	10
+
 /*
  * The per-pool workqueue.  While queued, bits below WORK_PWQ_SHIFT
  * of work_struct->data are used for flags and the remaining high bits
@@ -287,6 +295,10 @@ struct pool_workqueue {
 
 	u64			stats[PWQ_NR_STATS];
 
+	struct work_struct	*lat_work;	/* L: work item being timed */
+	u64			lat_queued;	/* L: when @lat_work was queued */
+	u64			lat_hist[PWQ_NR_LAT_BUCKETS]; /* L: latencies */
+
 	/*
 	 * Release of unbound pwq is punted to a kthread_worker. See put_pwq()
 	 * and pwq_release_workfn() for details. pool_workqueue itself is also
@@ -2111,6 +2123,8 @@ static int try_to_grab_pending(struct work_struct *work, u32 cflags,
 			move_linked_works(work, &pwq->pool->worklist, NULL);
 
 		list_del_init(&work->entry);
+		if (pwq->lat_work == work)
+			pwq->lat_work = NULL;
 
 		/*
 		 * work->data points to pwq iff queued. Let's point to pool. As
@@ -2343,6 +2357,12 @@ static void __queue_work(int cpu, struct workqueue_struct *wq,
 	} else {
 		work_flags |= WORK_STRUCT_INACTIVE;
 		insert_work(pwq, work, &pwq->inactive_works, work_flags);
+		pwq->stats[PWQ_STAT_THROTTLED]++;
+	}
+
+	if (!pwq->lat_work) {
+		pwq->lat_work = work;
+		pwq->lat_queued = ktime_get_mono_fast_ns();
 	}
 
 out:
@@ -3120,6 +3140,22 @@ static bool manage_workers(struct worker *worker)
 	return true;
 }
 
+/* Account the queueing latency of the sampled work item of @pwq */
+static void pwq_account_latency(struct pool_workqueue *pwq)
+{
+	u64 us = div_u64(ktime_get_mono_fast_ns() - pwq->lat_queued,
+			 NSEC_PER_USEC);
+	int bucket = 0;
+
+	lockdep_assert_held(&pwq->pool->lock);
+
+	while ((us >>= 2) && bucket < PWQ_NR_LAT_BUCKETS - 1)
+		bucket++;
+
+	pwq->lat_hist[bucket]++;
+	pwq->lat_work = NULL;
+}
+
 /**
  * process_one_work - process single work
  * @worker: self
@@ -3203,6 +3239,9 @@ __acquires(&pool->lock)
 	 */
 	set_work_pool_and_clear_pending(work, pool->id, pool_offq_flags(pool));
 
+	if (pwq->lat_work == work)
+		pwq_account_latency(pwq);
+
 	pwq->stats[PWQ_STAT_STARTED]++;
 	raw_spin_unlock_irq(&pool->lock);
 
@@ -7077,9 +7116,32 @@ static ssize_t max_active_store(struct device *dev,
 }
 static DEVICE_ATTR_RW(max_active);
 
+static ssize_t latency_hist_show(struct device *dev,
+				 struct device_attribute *attr, char *buf)
+{
+	struct workqueue_struct *wq = dev_to_wq(dev);
+	u64 hist[PWQ_NR_LAT_BUCKETS] = { };
+	struct pool_workqueue *pwq;
+	int i, written = 0;
+
+	rcu_read_lock();
+	for_each_pwq(pwq, wq)
+		for (i = 0; i < PWQ_NR_LAT_BUCKETS; i++)
+			hist[i] += READ_ONCE(pwq->lat_hist[i]);
+	rcu_read_unlock();
+
+	for (i = 0; i < PWQ_NR_LAT_BUCKETS; i++)
+		written += scnprintf(buf + written, PAGE_SIZE - written,
+				     "%s%llu", i ? " " : "", hist[i]);
+	written += scnprintf(buf + written, PAGE_SIZE - written, "\n");
+	return written;
+}
+static DEVICE_ATTR_RO(latency_hist);
+
 static struct attribute *wq_sysfs_attrs[] = {
 	&dev_attr_per_cpu.attr,
 	&dev_attr_max_active.attr,
+	&dev_attr_latency_hist.attr,
 	NULL,
 };
 ATTRIBUTE_GROUPS(wq_sysfs);
@@ -7247,11 +7309,27 @@ static ssize_t wq_affinity_strict_store(struct device *dev,
 	return ret ?: count;
 }
 
+static ssize_t wq_repatriated_show(struct device *dev,
+				   struct device_attribute *attr, char *buf)
+{
+	struct workqueue_struct *wq = dev_to_wq(dev);
+	struct pool_workqueue *pwq;
+	u64 nr = 0;
+
+	rcu_read_lock();
+	for_each_pwq(pwq, wq)
+		nr += READ_ONCE(pwq->stats[PWQ_STAT_REPATRIATED]);
+	rcu_read_unlock();
+
+	return scnprintf(buf, PAGE_SIZE, "%llu\n", nr);
+}
+
 static struct device_attribute wq_sysfs_unbound_attrs[] = {
 	__ATTR(nice, 0644, wq_nice_show, wq_nice_store),
 	__ATTR(cpumask, 0644, wq_cpumask_show, wq_cpumask_store),
 	__ATTR(affinity_scope, 0644, wq_affn_scope_show, wq_affn_scope_store),
 	__ATTR(affinity_strict, 0644, wq_affinity_strict_show, wq_affinity_strict_store),
+	__ATTR(repatriated, 0444, wq_repatriated_show, NULL),
 	__ATTR_NULL,
 };
 
@@ -1925,6 +1925,19 @@ static int sysctl_compact_unevictable_allowed __read_mostly = CONFIG_COMPACT_UNE
  */
 static unsigned int __read_mostly sysctl_compaction_proactiveness;
 static int sysctl_extfrag_threshold = 500;
+
+/*
+ * Orders proactive compaction works for, set through
+ * /sys/kernel/mm/compaction/order_targets. Empty means
+ * COMPACTION_HPAGE_ORDER only.
+ */
+static unsigned long __read_mostly compaction_order_targets;
+
+/*
+ * Failed allocations of a target order make kcompactd more proactive on the
+ * preferred node, by up to this many points of proactiveness.
+ */
+#define COMPACTION_MAX_BOOST	30
 static int __read_mostly sysctl_compact_memory;
 
 static inline void
@@ -2196,18 +2209,29 @@ static bool kswapd_is_running(pg_data_t *pgdat)
 	return running;
 }
 
+static unsigned long compaction_targets(void)
+{
+	return READ_ONCE(compaction_order_targets) ?: BIT(COMPACTION_HPAGE_ORDER);
+}
+
 /*
- * A zone's fragmentation score is the external fragmentation wrt to the
- * COMPACTION_HPAGE_ORDER. It returns a value in the range [0, 100].
+ * A zone's fragmentation score is its worst external fragmentation wrt to
+ * the target orders. It returns a value in the range [0, 100].
  */
 static unsigned int fragmentation_score_zone(struct zone *zone)
 {
-	return extfrag_for_order(zone, COMPACTION_HPAGE_ORDER);
+	unsigned long targets = compaction_targets();
+	unsigned int order, score = 0;
+
+	for_each_set_bit(order, &targets, NR_PAGE_ORDERS)
+		score = max(score, extfrag_for_order(zone, order));
+
+	return score;
 }
 
 /*
  * A weighted zone's fragmentation score is the external fragmentation
- * wrt to the COMPACTION_HPAGE_ORDER scaled by the zone's size. It
+ * wrt to the target orders scaled by the zone's size. It
  * returns a value in the range [0, 100].
  *
  * The scaling factor ensures that proactive compaction focuses on larger
@@ -2247,19 +2271,52 @@ static unsigned int fragmentation_score_node(pg_data_t *pgdat)
 	return score;
 }
 
-static unsigned int fragmentation_score_wmark(bool low)
+static unsigned int fragmentation_score_wmark(pg_data_t *pgdat, bool low)
 {
-	unsigned int wmark_low;
+	unsigned int proactiveness, wmark_low;
+
+	proactiveness = min(sysctl_compaction_proactiveness +
+			    READ_ONCE(pgdat->proactive_boost), 100U);
 
 	/*
 	 * Cap the low watermark to avoid excessive compaction
 	 * activity in case a user sets the proactiveness tunable
 	 * close to 100 (maximum).
 	 */
-	wmark_low = max(100U - sysctl_compaction_proactiveness, 5U);
+	wmark_low = max(100U - proactiveness, 5U);
 	return low ? wmark_low : min(wmark_low + 10, 100U);
 }
 
+/*
+ * Account an allocation of a target order that failed even after the slow
+ * path, against the preferred node of the allocation.
+ */
+void compaction_alloc_failed(const struct alloc_context *ac, unsigned int order)
+{
+	struct zone *zone = zonelist_zone(ac->preferred_zoneref);
+
+	if (!zone || !(compaction_targets() & BIT(order)))
+		return;
+
+	atomic_inc(&zone->zone_pgdat->proactive_alloc_failures);
+}
+
+/*
+ * The compaction effort tracks the rate of failed allocations of the target
+ * orders: the boost to the proactiveness halves every check interval, and
+ * every failure since the last check adds one point back.
+ */
+static void update_proactive_boost(pg_data_t *pgdat)
+{
+	unsigned int failures, boost;
+
+	failures = atomic_xchg(&pgdat->proactive_alloc_failures, 0);
+	boost = READ_ONCE(pgdat->proactive_boost) / 2 +
+		min_t(unsigned int, failures, COMPACTION_MAX_BOOST);
+	WRITE_ONCE(pgdat->proactive_boost,
+		   min_t(unsigned int, boost, COMPACTION_MAX_BOOST));
+}
+
 static bool should_proactive_compact_node(pg_data_t *pgdat)
 {
 	int wmark_high;
@@ -2267,7 +2324,7 @@ static bool should_proactive_compact_node(pg_data_t *pgdat)
 	if (!sysctl_compaction_proactiveness || kswapd_is_running(pgdat))
 		return false;
 
-	wmark_high = fragmentation_score_wmark(false);
+	wmark_high = fragmentation_score_wmark(pgdat, false);
 	return fragmentation_score_node(pgdat) > wmark_high;
 }
 
@@ -2306,7 +2363,7 @@ static enum compact_result __compact_finished(struct compact_control *cc)
 			return COMPACT_PARTIAL_SKIPPED;
 
 		score = fragmentation_score_zone(cc->zone);
-		wmark_low = fragmentation_score_wmark(true);
+		wmark_low = fragmentation_score_wmark(pgdat, true);
 
 		if (score > wmark_low)
 			ret = COMPACT_CONTINUE;
@@ -3062,6 +3119,56 @@ void compaction_unregister_node(struct node *node)
 }
 #endif /* CONFIG_SYSFS && CONFIG_NUMA */
 
+#ifdef CONFIG_SYSFS
+static ssize_t order_targets_show(struct kobject *kobj,
+				  struct kobj_attribute *attr, char *buf)
+{
+	unsigned long targets = compaction_targets();
+
+	return sysfs_emit(buf, "%*pbl\n", NR_PAGE_ORDERS, &targets);
+}
+
+static ssize_t order_targets_store(struct kobject *kobj,
+				   struct kobj_attribute *attr,
+				   const char *buf, size_t count)
+{
+	unsigned long targets;
+	int err;
+
+	err = bitmap_parselist(buf, &targets, NR_PAGE_ORDERS);
+	if (err)
+		return err;
+
+	/* Order 0 can't be fragmented. */
+	if (targets & BIT(0))
+		return -EINVAL;
+
+	WRITE_ONCE(compaction_order_targets, targets);
+	return count;
+}
+static struct kobj_attribute order_targets_attr = __ATTR_RW(order_targets);
+
+static struct attribute *compaction_attrs[] = {
+	&order_targets_attr.attr,
+	NULL,
+};
+
+static const struct attribute_group compaction_attr_group = {
+	.attrs = compaction_attrs,
+	.name = "compaction",
+};
+
+static void __init compaction_sysfs_init(void)
+{
+	if (sysfs_create_group(mm_kobj, &compaction_attr_group))
+		pr_err("compaction: failed to register sysfs group\n");
+}
+#else
+static inline void compaction_sysfs_init(void)
+{
+}
+#endif /* CONFIG_SYSFS */
+
 static inline bool kcompactd_work_requested(pg_data_t *pgdat)
 {
 	return pgdat->kcompactd_max_order > 0 || kthread_should_stop() ||
@@ -3249,6 +3356,7 @@ static int kcompactd(void *p)
 		 * on the fragmentation score, this timeout is updated.
 		 */
 		timeout = default_timeout;
+		update_proactive_boost(pgdat);
 		if (should_proactive_compact_node(pgdat)) {
 			unsigned int prev_score, score;
 
@@ -3369,6 +3477,7 @@ static int __init kcompactd_init(void)
 	for_each_node_state(nid, N_MEMORY)
 		kcompactd_run(nid);
 	register_sysctl_init("vm", vm_compaction);
+	compaction_sysfs_init();
 	return 0;
 }
 subsys_initcall(kcompactd_init)
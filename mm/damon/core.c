@@ -509,6 +509,31 @@ unsigned int damon_nr_regions(struct damon_target *t)
 	return t->nr_regions;
 }
 
+/**
+ * damon_shard_bounds() - Get the regions of a shard of the access checks.
+ * @ctx:	The monitoring context.
+ * @shard:	The shard, in [0, @nr_shards).
+ * @nr_shards:	The number of shards the regions are split into.
+ * @start:	Returns the index of the first region of the shard.
+ * @end:	Returns the index after the last region of the shard.
+ *
+ * The regions of all targets of @ctx are indexed in their list order, and
+ * split into @nr_shards contiguous shards of about the same number of regions.
+ */
+void damon_shard_bounds(struct damon_ctx *ctx, unsigned int shard,
+		unsigned int nr_shards, unsigned long *start,
+		unsigned long *end)
+{
+	struct damon_target *t;
+	unsigned long nr_regions = 0;
+
+	damon_for_each_target(t, ctx)
+		nr_regions += damon_nr_regions(t);
+
+	*start = nr_regions * shard / nr_shards;
+	*end = nr_regions * (shard + 1) / nr_shards;
+}
+
 struct damon_ctx *damon_new_ctx(void)
 {
 	struct damon_ctx *ctx;
@@ -532,6 +557,11 @@ struct damon_ctx *damon_new_ctx(void)
 	mutex_init(&ctx->call_control_lock);
 	mutex_init(&ctx->walk_control_lock);
 
+	ctx->nr_workers = 1;
+	ctx->nr_shards = 1;
+	init_completion(&ctx->workers_done);
+	init_waitqueue_head(&ctx->workers_wait);
+
 	ctx->attrs.min_nr_regions = 10;
 	ctx->attrs.max_nr_regions = 1000;
 
@@ -545,11 +575,6 @@ static void damon_destroy_targets(struct damon_ctx *ctx)
 {
 	struct damon_target *t, *next_t;
 
-	if (ctx->ops.cleanup) {
-		ctx->ops.cleanup(ctx);
-		return;
-	}
-
 	damon_for_each_target_safe(t, next_t, ctx)
 		damon_destroy_target(t);
 }
@@ -1150,6 +1175,8 @@ int damon_commit_ctx(struct damon_ctx *dst, struct damon_ctx *src)
 	if (err)
 		return err;
 	dst->ops = src->ops;
+	dst->nr_workers = src->nr_workers;
+	cpumask_copy(&dst->workers_cpumask, &src->workers_cpumask);
 
 	return 0;
 }
@@ -2384,6 +2411,146 @@ static void kdamond_init_ctx(struct damon_ctx *ctx)
 	}
 }
 
+struct damon_worker {
+	struct damon_ctx *ctx;
+	struct task_struct *task;
+	unsigned int shard;
+	unsigned int max_nr_accesses;
+	/* &damon_ctx.workers_seq of the last step done */
+	unsigned long seq;
+};
+
+static void damon_worker_do_shard(struct damon_ctx *ctx, unsigned int shard,
+		unsigned int *max_nr_accesses)
+{
+	if (ctx->workers_check)
+		*max_nr_accesses = ctx->ops.check_accesses_shard(ctx, shard,
+				ctx->nr_shards);
+	else
+		ctx->ops.prepare_access_checks_shard(ctx, shard,
+				ctx->nr_shards);
+}
+
+static int damon_worker_fn(void *data)
+{
+	struct damon_worker *worker = data;
+	struct damon_ctx *ctx = worker->ctx;
+
+	while (true) {
+		wait_event_idle(ctx->workers_wait, kthread_should_stop() ||
+				smp_load_acquire(&ctx->workers_seq) !=
+				worker->seq);
+		if (kthread_should_stop())
+			break;
+		worker->seq = ctx->workers_seq;
+		damon_worker_do_shard(ctx, worker->shard,
+				&worker->max_nr_accesses);
+		if (atomic_dec_and_test(&ctx->workers_pending))
+			complete(&ctx->workers_done);
+	}
+	return 0;
+}
+
+/*
+ * Start the worker threads of @ctx, if it wants any and its operations set
+ * supports sharded access checks.  If not all of them can be started, the
+ * access checks are split among the ones that could.
+ */
+static void kdamond_start_workers(struct damon_ctx *ctx)
+{
+	struct damon_worker *worker;
+	struct task_struct *task;
+	unsigned int i;
+
+	ctx->nr_shards = 1;
+	if (ctx->nr_workers <= 1 || !ctx->ops.prepare_access_checks_shard ||
+			!ctx->ops.check_accesses_shard)
+		return;
+
+	ctx->workers = kcalloc(ctx->nr_workers - 1, sizeof(*ctx->workers),
+			GFP_KERNEL);
+	if (!ctx->workers)
+		return;
+
+	for (i = 0; i < ctx->nr_workers - 1; i++) {
+		worker = &ctx->workers[i];
+		worker->ctx = ctx;
+		worker->shard = i + 1;
+		worker->seq = ctx->workers_seq;
+		task = kthread_create(damon_worker_fn, worker, "%s.%u",
+				current->comm, worker->shard);
+		if (IS_ERR(task))
+			break;
+		if (!cpumask_empty(&ctx->workers_cpumask))
+			set_cpus_allowed_ptr(task, &ctx->workers_cpumask);
+		worker->task = task;
+		wake_up_process(task);
+	}
+
+	ctx->nr_shards = i + 1;
+	if (ctx->nr_shards == 1) {
+		kfree(ctx->workers);
+		ctx->workers = NULL;
+	}
+}
+
+static void kdamond_stop_workers(struct damon_ctx *ctx)
+{
+	unsigned int i;
+
+	if (!ctx->workers)
+		return;
+
+	for (i = 0; i < ctx->nr_shards - 1; i++)
+		kthread_stop(ctx->workers[i].task);
+	kfree(ctx->workers);
+	ctx->workers = NULL;
+	ctx->nr_shards = 1;
+}
+
+/*
+ * Do one access check step, the preparation or the check, for all shards.
+ * @kdamond does the first shard itself and waits for the workers.
+ */
+static unsigned int kdamond_run_shards(struct damon_ctx *ctx, bool check)
+{
+	unsigned int max_nr_accesses = 0;
+	unsigned int i;
+
+	ctx->workers_check = check;
+	atomic_set(&ctx->workers_pending, ctx->nr_shards - 1);
+	reinit_completion(&ctx->workers_done);
+	/* Pairs with smp_load_acquire() in damon_worker_fn() */
+	smp_store_release(&ctx->workers_seq, ctx->workers_seq + 1);
+	wake_up_all(&ctx->workers_wait);
+
+	damon_worker_do_shard(ctx, 0, &max_nr_accesses);
+	wait_for_completion(&ctx->workers_done);
+
+	for (i = 0; i < ctx->nr_shards - 1; i++)
+		max_nr_accesses = max(max_nr_accesses,
+				ctx->workers[i].max_nr_accesses);
+	return max_nr_accesses;
+}
+
+static void kdamond_prepare_access_checks(struct damon_ctx *ctx)
+{
+	if (ctx->workers)
+		kdamond_run_shards(ctx, false);
+	else if (ctx->ops.prepare_access_checks)
+		ctx->ops.prepare_access_checks(ctx);
+}
+
+static unsigned int kdamond_check_accesses(struct damon_ctx *ctx,
+		unsigned int max_nr_accesses)
+{
+	if (ctx->workers)
+		return kdamond_run_shards(ctx, true);
+	if (ctx->ops.check_accesses)
+		return ctx->ops.check_accesses(ctx);
+	return max_nr_accesses;
+}
+
 /*
  * The monitoring daemon that runs as a kernel thread
  */
@@ -2407,6 +2574,7 @@ static int kdamond_fn(void *data)
 	if (!ctx->regions_score_histogram)
 		goto done;
 
+	kdamond_start_workers(ctx);
 	sz_limit = damon_region_sz_limit(ctx);
 
 	while (!kdamond_need_stop(ctx)) {
@@ -2424,14 +2592,12 @@ static int kdamond_fn(void *data)
 		if (kdamond_wait_activation(ctx))
 			break;
 
-		if (ctx->ops.prepare_access_checks)
-			ctx->ops.prepare_access_checks(ctx);
+		kdamond_prepare_access_checks(ctx);
 
 		kdamond_usleep(sample_interval);
 		ctx->passed_sample_intervals++;
 
-		if (ctx->ops.check_accesses)
-			max_nr_accesses = ctx->ops.check_accesses(ctx);
+		max_nr_accesses = kdamond_check_accesses(ctx, max_nr_accesses);
 
 		if (ctx->passed_sample_intervals >= next_aggregation_sis) {
 			kdamond_merge_regions(ctx,
@@ -2501,6 +2667,7 @@ static int kdamond_fn(void *data)
 		}
 	}
 done:
+	kdamond_stop_workers(ctx);
 	damon_for_each_target(t, ctx) {
 		damon_for_each_region_safe(r, next, t)
 			damon_destroy_region(r, t);
@@ -0,0 +1,290 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * DAMON Primitives for The Physical Address Space using Hardware Samples
+ *
+ * Instead of clearing and checking the Accessed bits of the page table entries
+ * that map the sampling address of each region, this set of operations opens
+ * a kernel perf event on each online CPU that samples the physical address of
+ * memory accesses, e.g., AMD IBS op or Intel PEBS load latency events.  The
+ * overflow handler of the events queues the addresses in per-CPU buffers, and
+ * each access check marks the regions that any queued sample falls in as
+ * accessed.  Hence no TLB flush or rmap walk is needed, and a single sample
+ * covers the whole region regardless of the page size that maps it.
+ *
+ * The schemes are applied in the same way as for the 'paddr' operations.
+ */
+
+#define pr_fmt(fmt) "damon-hwsample: " fmt
+
+#include <linux/cpu.h>
+#include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/perf_event.h>
+#include <linux/slab.h>
+#include <linux/sort.h>
+
+#include "ops-common.h"
+
+#ifdef MODULE_PARAM_PREFIX
+#undef MODULE_PARAM_PREFIX
+#endif
+#define MODULE_PARAM_PREFIX "damon_hwsample."
+
+/*
+ * Type of the perf event to sample the memory accesses with.
+ *
+ * This is the ``type`` field of &struct perf_event_attr.  For AMD IBS op, this
+ * should be the value of /sys/bus/event_source/devices/ibs_op/type.  For Intel
+ * PEBS, this should be 4 (PERF_TYPE_RAW).  Changes are applied on the next
+ * start of a context using the operations.
+ */
+static unsigned int perf_type __read_mostly = PERF_TYPE_RAW;
+module_param(perf_type, uint, 0600);
+
+/*
+ * Config of the perf event to sample the memory accesses with.
+ *
+ * This is the ``config`` field of &struct perf_event_attr.  The default value
+ * is the MEM_TRANS_RETIRED.LOAD_LATENCY event of Intel PEBS.  For AMD IBS op,
+ * this should be 0.
+ */
+static unsigned long perf_config __read_mostly = 0x1cd;
+module_param(perf_config, ulong, 0600);
+
+/*
+ * Config1 of the perf event to sample the memory accesses with.
+ *
+ * This is the ``config1`` field of &struct perf_event_attr.  For the default
+ * event, this is the load latency threshold in cycles.
+ */
+static unsigned long perf_config1 __read_mostly = 3;
+module_param(perf_config1, ulong, 0600);
+
+/*
+ * Number of events between two samples of the perf event.
+ */
+static unsigned long sample_period __read_mostly = 10007;
+module_param(sample_period, ulong, 0600);
+
+/*
+ * Required precision of the sampled address.
+ *
+ * This is the ``precise_ip`` field of &struct perf_event_attr.  PEBS and IBS
+ * based events provide the data address only if this is non-zero.
+ */
+static unsigned int precise_ip __read_mostly = 2;
+module_param(precise_ip, uint, 0600);
+
+/*
+ * Number of hardware samples that have been applied to the regions.
+ */
+static unsigned long nr_samples __read_mostly;
+module_param(nr_samples, ulong, 0400);
+
+/*
+ * Number of hardware samples that have been dropped because the per-CPU
+ * buffer was full.  This is updated when the using context stops.
+ */
+static unsigned long nr_dropped_samples __read_mostly;
+module_param(nr_dropped_samples, ulong, 0400);
+
+#define DAMON_HW_NR_SAMPLES	512
+
+/* Single producer (the overflow handler), single consumer (kdamond) buffer */
+struct damon_hw_cpu {
+	struct perf_event *event;
+	unsigned int head;
+	unsigned int tail;
+	unsigned long dropped;
+	u64 addrs[DAMON_HW_NR_SAMPLES];
+};
+
+/* The sampling events can be used by only one context at a time */
+static DEFINE_MUTEX(damon_hw_lock);
+static struct damon_ctx *damon_hw_owner;
+static struct damon_hw_cpu __percpu *damon_hw_cpus;
+static u64 *damon_hw_addrs;
+
+static void damon_hw_overflow(struct perf_event *event,
+		struct perf_sample_data *data, struct pt_regs *regs)
+{
+	struct damon_hw_cpu *hc = this_cpu_ptr(damon_hw_cpus);
+	unsigned int head = hc->head;
+
+	perf_prepare_sample(data, event, regs);
+	if (!(data->sample_flags & PERF_SAMPLE_PHYS_ADDR) || !data->phys_addr)
+		return;
+
+	if (head - READ_ONCE(hc->tail) >= DAMON_HW_NR_SAMPLES) {
+		hc->dropped++;
+		return;
+	}
+	hc->addrs[head % DAMON_HW_NR_SAMPLES] = data->phys_addr;
+	/* Pairs with smp_load_acquire() in damon_hw_drain() */
+	smp_store_release(&hc->head, head + 1);
+}
+
+static void damon_hw_release_events(void)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct damon_hw_cpu *hc;
+
+		if (!damon_hw_cpus)
+			break;
+		hc = per_cpu_ptr(damon_hw_cpus, cpu);
+		if (hc->event) {
+			perf_event_release_kernel(hc->event);
+			hc->event = NULL;
+		}
+		nr_dropped_samples += hc->dropped;
+	}
+	free_percpu(damon_hw_cpus);
+	damon_hw_cpus = NULL;
+	kvfree(damon_hw_addrs);
+	damon_hw_addrs = NULL;
+}
+
+static int damon_hw_create_events(void)
+{
+	struct perf_event_attr attr = {
+		.type = perf_type,
+		.size = sizeof(attr),
+		.config = perf_config,
+		.config1 = perf_config1,
+		.sample_period = sample_period,
+		.sample_type = PERF_SAMPLE_ADDR | PERF_SAMPLE_PHYS_ADDR,
+		.precise_ip = precise_ip,
+		.exclude_hv = 1,
+	};
+	int cpu, nr_events = 0;
+
+	damon_hw_cpus = alloc_percpu(struct damon_hw_cpu);
+	damon_hw_addrs = kvmalloc_array(num_possible_cpus(),
+			sizeof(*damon_hw_addrs) * DAMON_HW_NR_SAMPLES,
+			GFP_KERNEL);
+	if (!damon_hw_cpus || !damon_hw_addrs)
+		goto fail;
+
+	cpus_read_lock();
+	for_each_online_cpu(cpu) {
+		struct perf_event *event;
+
+		event = perf_event_create_kernel_counter(&attr, cpu, NULL,
+				damon_hw_overflow, NULL);
+		if (IS_ERR(event)) {
+			pr_warn_once("cannot open the event on cpu %d (%ld)\n",
+					cpu, PTR_ERR(event));
+			continue;
+		}
+		per_cpu_ptr(damon_hw_cpus, cpu)->event = event;
+		nr_events++;
+	}
+	cpus_read_unlock();
+	if (nr_events)
+		return 0;
+
+fail:
+	damon_hw_release_events();
+	return -ENODEV;
+}
+
+static void damon_hw_init(struct damon_ctx *ctx)
+{
+	mutex_lock(&damon_hw_lock);
+	if (damon_hw_owner) {
+		pr_warn("events are in use by another context\n");
+	} else if (!damon_hw_create_events()) {
+		damon_hw_owner = ctx;
+	}
+	mutex_unlock(&damon_hw_lock);
+}
+
+static void damon_hw_cleanup(struct damon_ctx *ctx)
+{
+	mutex_lock(&damon_hw_lock);
+	if (damon_hw_owner == ctx) {
+		damon_hw_release_events();
+		damon_hw_owner = NULL;
+	}
+	mutex_unlock(&damon_hw_lock);
+}
+
+/* Move the queued samples of all CPUs to damon_hw_addrs */
+static unsigned long damon_hw_drain(void)
+{
+	unsigned long nr = 0;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct damon_hw_cpu *hc = per_cpu_ptr(damon_hw_cpus, cpu);
+		unsigned int head, tail = hc->tail;
+
+		if (!hc->event)
+			continue;
+		/* Pairs with smp_store_release() in damon_hw_overflow() */
+		head = smp_load_acquire(&hc->head);
+		for (; tail != head; tail++)
+			damon_hw_addrs[nr++] = hc->addrs[tail % DAMON_HW_NR_SAMPLES];
+		/* Make the slots reusable only after they are read */
+		smp_store_release(&hc->tail, tail);
+	}
+	return nr;
+}
+
+static int damon_hw_cmp_addr(const void *a, const void *b)
+{
+	u64 x = *(const u64 *)a, y = *(const u64 *)b;
+
+	return (x > y) - (x < y);
+}
+
+static unsigned int damon_hw_check_accesses(struct damon_ctx *ctx)
+{
+	struct damon_target *t;
+	struct damon_region *r;
+	unsigned int max_nr_accesses = 0;
+	unsigned long nr = 0, i;
+
+	if (damon_hw_owner == ctx) {
+		nr = damon_hw_drain();
+		sort(damon_hw_addrs, nr, sizeof(*damon_hw_addrs),
+				damon_hw_cmp_addr, NULL);
+		nr_samples += nr;
+	}
+
+	/* Regions of each target are sorted, so walk them with the samples */
+	damon_for_each_target(t, ctx) {
+		i = 0;
+		damon_for_each_region(r, t) {
+			while (i < nr && damon_hw_addrs[i] < r->ar.start)
+				i++;
+			damon_update_region_access_rate(r,
+					i < nr && damon_hw_addrs[i] < r->ar.end,
+					&ctx->attrs);
+			max_nr_accesses = max(r->nr_accesses, max_nr_accesses);
+		}
+	}
+
+	return max_nr_accesses;
+}
+
+static int __init damon_hw_initcall(void)
+{
+	struct damon_operations ops = {
+		.id = DAMON_OPS_PADDR_HW,
+		.init = damon_hw_init,
+		.update = NULL,
+		.prepare_access_checks = NULL,
+		.check_accesses = damon_hw_check_accesses,
+		.target_valid = NULL,
+		.cleanup = damon_hw_cleanup,
+		.apply_scheme = damon_pa_apply_scheme,
+		.get_scheme_score = damon_pa_scheme_score,
+	};
+
+	return damon_register_ops(&ops);
+};
+
+subsys_initcall(damon_hw_initcall);
@@ -76,17 +76,28 @@ static void __damon_pa_prepare_access_check(struct damon_region *r)
 	damon_pa_mkold(r->sampling_addr);
 }
 
-static void damon_pa_prepare_access_checks(struct damon_ctx *ctx)
+static void damon_pa_prepare_access_checks_shard(struct damon_ctx *ctx,
+		unsigned int shard, unsigned int nr_shards)
 {
 	struct damon_target *t;
 	struct damon_region *r;
+	unsigned long idx = 0, start, end;
 
+	damon_shard_bounds(ctx, shard, nr_shards, &start, &end);
 	damon_for_each_target(t, ctx) {
-		damon_for_each_region(r, t)
-			__damon_pa_prepare_access_check(r);
+		damon_for_each_region(r, t) {
+			if (idx >= start && idx < end)
+				__damon_pa_prepare_access_check(r);
+			idx++;
+		}
 	}
 }
 
+static void damon_pa_prepare_access_checks(struct damon_ctx *ctx)
+{
+	damon_pa_prepare_access_checks_shard(ctx, 0, 1);
+}
+
 static bool damon_folio_young_one(struct folio *folio,
 		struct vm_area_struct *vma, unsigned long addr, void *arg)
 {
@@ -170,42 +181,61 @@ static bool damon_pa_young(unsigned long paddr, unsigned long *folio_sz)
 	return accessed;
 }
 
+/* The last checked folio of a shard of the access checks */
+struct damon_pa_last_check {
+	unsigned long addr;
+	unsigned long folio_sz;
+	bool accessed;
+};
+
 static void __damon_pa_check_access(struct damon_region *r,
-		struct damon_attrs *attrs)
+		struct damon_attrs *attrs, struct damon_pa_last_check *last)
 {
-	static unsigned long last_addr;
-	static unsigned long last_folio_sz = PAGE_SIZE;
-	static bool last_accessed;
-
 	/* If the region is in the last checked page, reuse the result */
-	if (ALIGN_DOWN(last_addr, last_folio_sz) ==
-				ALIGN_DOWN(r->sampling_addr, last_folio_sz)) {
-		damon_update_region_access_rate(r, last_accessed, attrs);
+	if (ALIGN_DOWN(last->addr, last->folio_sz) ==
+				ALIGN_DOWN(r->sampling_addr, last->folio_sz)) {
+		damon_update_region_access_rate(r, last->accessed, attrs);
 		return;
 	}
 
-	last_accessed = damon_pa_young(r->sampling_addr, &last_folio_sz);
-	damon_update_region_access_rate(r, last_accessed, attrs);
+	last->accessed = damon_pa_young(r->sampling_addr, &last->folio_sz);
+	damon_update_region_access_rate(r, last->accessed, attrs);
 
-	last_addr = r->sampling_addr;
+	last->addr = r->sampling_addr;
 }
 
-static unsigned int damon_pa_check_accesses(struct damon_ctx *ctx)
+static unsigned int damon_pa_check_accesses_shard(struct damon_ctx *ctx,
+		unsigned int shard, unsigned int nr_shards)
 {
+	struct damon_pa_last_check last = {
+		.addr = ULONG_MAX,
+		.folio_sz = PAGE_SIZE,
+	};
 	struct damon_target *t;
 	struct damon_region *r;
 	unsigned int max_nr_accesses = 0;
+	unsigned long idx = 0, start, end;
 
+	damon_shard_bounds(ctx, shard, nr_shards, &start, &end);
 	damon_for_each_target(t, ctx) {
 		damon_for_each_region(r, t) {
-			__damon_pa_check_access(r, &ctx->attrs);
-			max_nr_accesses = max(r->nr_accesses, max_nr_accesses);
+			if (idx >= start && idx < end) {
+				__damon_pa_check_access(r, &ctx->attrs, &last);
+				max_nr_accesses = max(r->nr_accesses,
+						max_nr_accesses);
+			}
+			idx++;
 		}
 	}
 
 	return max_nr_accesses;
 }
 
+static unsigned int damon_pa_check_accesses(struct damon_ctx *ctx)
+{
+	return damon_pa_check_accesses_shard(ctx, 0, 1);
+}
+
 static bool damos_pa_filter_match(struct damos_filter *filter,
 		struct folio *folio)
 {
@@ -571,7 +601,7 @@ static unsigned long damon_pa_stat(struct damon_region *r, struct damos *s,
 	return 0;
 }
 
-static unsigned long damon_pa_apply_scheme(struct damon_ctx *ctx,
+unsigned long damon_pa_apply_scheme(struct damon_ctx *ctx,
 		struct damon_target *t, struct damon_region *r,
 		struct damos *scheme, unsigned long *sz_filter_passed)
 {
@@ -594,7 +624,7 @@ static unsigned long damon_pa_apply_scheme(struct damon_ctx *ctx,
 	return 0;
 }
 
-static int damon_pa_scheme_score(struct damon_ctx *context,
+int damon_pa_scheme_score(struct damon_ctx *context,
 		struct damon_target *t, struct damon_region *r,
 		struct damos *scheme)
 {
@@ -624,6 +654,9 @@ static int __init damon_pa_initcall(void)
 		.update = NULL,
 		.prepare_access_checks = damon_pa_prepare_access_checks,
 		.check_accesses = damon_pa_check_accesses,
+		.prepare_access_checks_shard =
+			damon_pa_prepare_access_checks_shard,
+		.check_accesses_shard = damon_pa_check_accesses_shard,
 		.target_valid = NULL,
 		.cleanup = NULL,
 		.apply_scheme = damon_pa_apply_scheme,
@@ -137,6 +137,16 @@ module_param(monitor_region_end, ulong, 0600);
 static bool skip_anon __read_mostly;
 module_param(skip_anon, bool, 0600);
 
+/*
+ * Number of threads doing the access checks of the monitoring.
+ *
+ * If this is more than one, DAMON_RECLAIM splits the access checks of the monitoring
+ * regions among this many threads, including the DAMON thread.  Applied when
+ * DAMON_RECLAIM is enabled.  1 by default.
+ */
+static unsigned int monitor_nr_workers __read_mostly = 1;
+module_param(monitor_nr_workers, uint, 0600);
+
 /*
  * PID of the DAMON thread
  *
@@ -232,6 +242,8 @@ static int damon_reclaim_apply_parameters(void)
 					&monitor_region_end);
 	if (err)
 		goto out;
+	param_ctx->nr_workers = clamp(monitor_nr_workers, 1U,
+			num_possible_cpus());
 	err = damon_commit_ctx(ctx, param_ctx);
 out:
 	damon_destroy_ctx(param_ctx);
@@ -56,6 +56,9 @@ int generic_fadvise(struct file *file, loff_t offset, loff_t len, int advice)
 		case POSIX_FADV_WILLNEED:
 		case POSIX_FADV_NOREUSE:
 		case POSIX_FADV_DONTNEED:
+		case POSIX_FADV_PLACE_DEFAULT:
+		case POSIX_FADV_INTERLEAVE:
+		case POSIX_FADV_LOCAL:
 			/* no bad return value, but ignore advice */
 			break;
 		default:
@@ -110,6 +113,18 @@ int generic_fadvise(struct file *file, loff_t offset, loff_t len, int advice)
 		file->f_mode |= FMODE_NOREUSE;
 		spin_unlock(&file->f_lock);
 		break;
+	case POSIX_FADV_PLACE_DEFAULT:
+	case POSIX_FADV_INTERLEAVE:
+	case POSIX_FADV_LOCAL:
+		/*
+		 * The page cache is shared by all openers, so the placement
+		 * is a property of the mapping rather than of the file.
+		 * Folios already cached stay where they are.
+		 */
+		mapping_set_placement(mapping,
+				      advice == POSIX_FADV_INTERLEAVE,
+				      advice == POSIX_FADV_LOCAL);
+		break;
 	case POSIX_FADV_DONTNEED:
 		__filemap_fdatawrite_range(mapping, offset, endbyte,
 					   WB_SYNC_NONE);
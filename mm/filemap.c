@@ -179,6 +179,10 @@ static void filemap_unaccount_folio(struct address_space *mapping,
 	if (folio_test_hugetlb(folio))
 		return;
 
+	/* nobody got as far as the readahead marker, see page_cache_async_ra() */
+	if (folio_test_readahead(folio) && !folio_test_swapbacked(folio))
+		percpu_counter_inc(&mapping->host->i_sb->s_ra_wasted);
+
 	nr = folio_nr_pages(folio);
 
 	__lruvec_stat_mod_folio(folio, NR_FILE_PAGES, -nr);
@@ -1007,6 +1011,75 @@ struct folio *filemap_alloc_folio_noprof(gfp_t gfp, unsigned int order)
 	return folio_alloc_noprof(gfp, order);
 }
 EXPORT_SYMBOL(filemap_alloc_folio_noprof);
+
+/*
+ * Interleaving is done on the file offset rather than with a rotor, so that
+ * a file read by several tasks still ends up evenly spread over the nodes.
+ */
+static int mapping_interleave_nid(struct address_space *mapping,
+				  pgoff_t index, unsigned int order)
+{
+	const nodemask_t *nodes = &cpuset_current_mems_allowed;
+	unsigned int nr = nodes_weight(*nodes);
+	unsigned int target;
+	int nid;
+
+	if (!nr)
+		return numa_node_id();
+
+	target = ((mapping->host ? mapping->host->i_ino : 0) +
+		  (index >> order)) % nr;
+	nid = first_node(*nodes);
+	while (target--)
+		nid = next_node(nid, *nodes);
+	return nid;
+}
+
+/**
+ * mapping_alloc_folio - Allocate a folio for the page cache of a mapping.
+ * @mapping: The address_space the folio will be added to.
+ * @index: The index the folio will be added at.
+ * @gfp: The allocation flags.
+ * @order: The order of the folio.
+ *
+ * Like filemap_alloc_folio(), but honours the NUMA placement policy of
+ * @mapping, set by POSIX_FADV_INTERLEAVE or POSIX_FADV_LOCAL, and failing
+ * that the one of its superblock, set by the pagecache_policy= mount option.
+ *
+ * Return: The folio, or NULL if the allocation failed.
+ */
+struct folio *mapping_alloc_folio_noprof(struct address_space *mapping,
+		pgoff_t index, gfp_t gfp, unsigned int order)
+{
+	unsigned long flags = READ_ONCE(mapping->flags);
+	unsigned int cpuset_mems_cookie;
+	bool interleave = false, local = false;
+	struct folio *folio;
+
+	if (flags & (BIT(AS_PLACE_INTERLEAVE) | BIT(AS_PLACE_LOCAL))) {
+		interleave = flags & BIT(AS_PLACE_INTERLEAVE);
+		local = flags & BIT(AS_PLACE_LOCAL);
+	} else if (mapping->host) {
+		unsigned long iflags = READ_ONCE(mapping->host->i_sb->s_iflags);
+
+		interleave = iflags & SB_I_PAGECACHE_INTERLEAVE;
+		local = iflags & SB_I_PAGECACHE_LOCAL;
+	}
+
+	if (local)
+		return __folio_alloc_node_noprof(gfp, order, numa_node_id());
+	if (!interleave)
+		return filemap_alloc_folio_noprof(gfp, order);
+
+	do {
+		cpuset_mems_cookie = read_mems_allowed_begin();
+		folio = __folio_alloc_node_noprof(gfp, order,
+				mapping_interleave_nid(mapping, index, order));
+	} while (!folio && read_mems_allowed_retry(cpuset_mems_cookie));
+
+	return folio;
+}
+EXPORT_SYMBOL(mapping_alloc_folio_noprof);
 #endif
 
 /*
@@ -1975,7 +2048,8 @@ struct folio *__filemap_get_folio(struct address_space *mapping, pgoff_t index,
 			err = -ENOMEM;
 			if (order > min_order)
 				alloc_gfp |= __GFP_NORETRY | __GFP_NOWARN;
-			folio = filemap_alloc_folio(alloc_gfp, order);
+			folio = mapping_alloc_folio(mapping, index, alloc_gfp,
+						    order);
 			if (!folio)
 				continue;
 
@@ -2514,7 +2588,8 @@ static int filemap_create_folio(struct kiocb *iocb, struct folio_batch *fbatch)
 	if (iocb->ki_flags & (IOCB_NOWAIT | IOCB_WAITQ))
 		return -EAGAIN;
 
-	folio = filemap_alloc_folio(mapping_gfp_mask(mapping), min_order);
+	folio = mapping_alloc_folio(mapping, iocb->ki_pos >> PAGE_SHIFT,
+				    mapping_gfp_mask(mapping), min_order);
 	if (!folio)
 		return -ENOMEM;
 	if (iocb->ki_flags & IOCB_DONTCACHE)
@@ -2637,6 +2712,40 @@ static int filemap_get_pages(struct kiocb *iocb, size_t count,
 	return err;
 }
 
+/*
+ * A batch only holds PAGEVEC_SIZE folios, so a big read goes through many of
+ * them. If the range after @fbatch is not in the page cache yet, get the
+ * readahead for it going before copying out @fbatch, so that its I/O overlaps
+ * with the copy instead of only starting once the copy is done.
+ */
+static void filemap_readahead_next(struct kiocb *iocb,
+		struct folio_batch *fbatch, loff_t end_offset)
+{
+	struct file *filp = iocb->ki_filp;
+	struct address_space *mapping = filp->f_mapping;
+	struct folio *folio = fbatch->folios[folio_batch_count(fbatch) - 1];
+	pgoff_t index = folio_next_index(folio);
+	pgoff_t last_index = DIV_ROUND_UP(end_offset, PAGE_SIZE);
+	DEFINE_READAHEAD(ractl, filp, &filp->f_ra, mapping, index);
+	void *entry;
+
+	if (index >= last_index)
+		return;
+	/* filemap_get_pages() knows how to deal with these */
+	if (iocb->ki_flags & (IOCB_NOIO | IOCB_NOWAIT))
+		return;
+
+	rcu_read_lock();
+	entry = xa_load(&mapping->i_pages, index);
+	rcu_read_unlock();
+	if (entry && !xa_is_value(entry))
+		return;
+
+	if (iocb->ki_flags & IOCB_DONTCACHE)
+		ractl.dropbehind = 1;
+	page_cache_sync_ra(&ractl, last_index - index);
+}
+
 static inline bool pos_same_folio(loff_t pos1, loff_t pos2, struct folio *folio)
 {
 	unsigned int shift = folio_shift(folio);
@@ -2724,6 +2833,8 @@ ssize_t filemap_read(struct kiocb *iocb, struct iov_iter *iter,
 			goto put_folios;
 		end_offset = min_t(loff_t, isize, iocb->ki_pos + iter->count);
 
+		filemap_readahead_next(iocb, &fbatch, end_offset);
+
 		/*
 		 * Once we start copying data, we don't want to be touching any
 		 * cachelines that might be contended:
@@ -3852,7 +3963,7 @@ static struct folio *do_read_cache_folio(struct address_space *mapping,
 repeat:
 	folio = filemap_get_folio(mapping, index);
 	if (IS_ERR(folio)) {
-		folio = filemap_alloc_folio(gfp,
+		folio = mapping_alloc_folio(mapping, index, gfp,
 					    mapping_min_folio_order(mapping));
 		if (!folio)
 			return ERR_PTR(-ENOMEM);
@@ -81,6 +81,7 @@ unsigned long huge_zero_pfn __read_mostly = ~0UL;
 unsigned long huge_anon_orders_always __read_mostly;
 unsigned long huge_anon_orders_madvise __read_mostly;
 unsigned long huge_anon_orders_inherit __read_mostly;
+unsigned long huge_anon_orders_swapin __read_mostly;
 static bool anon_orders_configured __initdata;
 
 static inline bool file_thp_enabled(struct vm_area_struct *vma)
@@ -553,8 +554,47 @@ static ssize_t anon_enabled_store(struct kobject *kobj,
 static struct kobj_attribute anon_enabled_attr =
 	__ATTR(enabled, 0644, anon_enabled_show, anon_enabled_store);
 
+/*
+ * Whether folios of this size are also swapped in whole from swap devices
+ * that are not synchronous, with a single read that bypasses the swap cache
+ * readahead. Synchronous devices always do so for the enabled sizes.
+ */
+static ssize_t swapin_enabled_show(struct kobject *kobj,
+				   struct kobj_attribute *attr, char *buf)
+{
+	int order = to_thpsize(kobj)->order;
+	const char *output;
+
+	if (test_bit(order, &huge_anon_orders_swapin))
+		output = "[always] never";
+	else
+		output = "always [never]";
+
+	return sysfs_emit(buf, "%s\n", output);
+}
+
+static ssize_t swapin_enabled_store(struct kobject *kobj,
+				    struct kobj_attribute *attr,
+				    const char *buf, size_t count)
+{
+	int order = to_thpsize(kobj)->order;
+
+	if (sysfs_streq(buf, "always"))
+		set_bit(order, &huge_anon_orders_swapin);
+	else if (sysfs_streq(buf, "never"))
+		clear_bit(order, &huge_anon_orders_swapin);
+	else
+		return -EINVAL;
+
+	return count;
+}
+
+static struct kobj_attribute swapin_enabled_attr =
+	__ATTR(swapin_enabled, 0644, swapin_enabled_show, swapin_enabled_store);
+
 static struct attribute *anon_ctrl_attrs[] = {
 	&anon_enabled_attr.attr,
+	&swapin_enabled_attr.attr,
 	NULL,
 };
 
@@ -621,6 +661,7 @@ DEFINE_MTHP_STAT_ATTR(swpin_fallback, MTHP_STAT_SWPIN_FALLBACK);
 DEFINE_MTHP_STAT_ATTR(swpin_fallback_charge, MTHP_STAT_SWPIN_FALLBACK_CHARGE);
 DEFINE_MTHP_STAT_ATTR(swpout, MTHP_STAT_SWPOUT);
 DEFINE_MTHP_STAT_ATTR(swpout_fallback, MTHP_STAT_SWPOUT_FALLBACK);
+DEFINE_MTHP_STAT_ATTR(swpout_defrag, MTHP_STAT_SWPOUT_DEFRAG);
 #ifdef CONFIG_SHMEM
 DEFINE_MTHP_STAT_ATTR(shmem_alloc, MTHP_STAT_SHMEM_ALLOC);
 DEFINE_MTHP_STAT_ATTR(shmem_fallback, MTHP_STAT_SHMEM_FALLBACK);
@@ -643,6 +684,7 @@ static struct attribute *anon_stats_attrs[] = {
 	&swpin_fallback_charge_attr.attr,
 	&swpout_attr.attr,
 	&swpout_fallback_attr.attr,
+	&swpout_defrag_attr.attr,
 #endif
 	&split_deferred_attr.attr,
 	&nr_anon_attr.attr,
@@ -677,6 +719,7 @@ static struct attribute *any_stats_attrs[] = {
 	&swpin_fallback_charge_attr.attr,
 	&swpout_attr.attr,
 	&swpout_fallback_attr.attr,
+	&swpout_defrag_attr.attr,
 #endif
 	&split_attr.attr,
 	&split_failed_attr.attr,
@@ -2094,7 +2137,7 @@ vm_fault_t do_huge_pmd_numa_page(struct vm_fault *vmf)
 	if (!migrate_misplaced_folio(folio, target_nid)) {
 		flags |= TNF_MIGRATED;
 		nid = target_nid;
-		task_numa_fault(last_cpupid, nid, HPAGE_PMD_NR, flags);
+		task_numa_fault(vma, last_cpupid, nid, HPAGE_PMD_NR, flags);
 		return 0;
 	}
 
@@ -2115,7 +2158,7 @@ vm_fault_t do_huge_pmd_numa_page(struct vm_fault *vmf)
 	spin_unlock(vmf->ptl);
 
 	if (nid != NUMA_NO_NODE)
-		task_numa_fault(last_cpupid, nid, HPAGE_PMD_NR, flags);
+		task_numa_fault(vma, last_cpupid, nid, HPAGE_PMD_NR, flags);
 	return 0;
 }
 
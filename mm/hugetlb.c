@@ -59,7 +59,7 @@ unsigned int default_hstate_idx;
 struct hstate hstates[HUGE_MAX_HSTATE];
 
 __initdata struct list_head huge_boot_pages[MAX_NUMNODES];
-static unsigned long hstate_boot_nrinvalid[HUGE_MAX_HSTATE] __initdata;
+static atomic_long_t hstate_boot_nrinvalid[HUGE_MAX_HSTATE] __initdata;
 
 /*
  * Due to ordering constraints across the init code for various
@@ -3402,7 +3402,7 @@ bool __init hugetlb_bootmem_page_zones_valid(int nid,
 			pages_per_huge_page(m->hstate));
 out:
 	if (!valid)
-		hstate_boot_nrinvalid[hstate_index(m->hstate)]++;
+		atomic_long_inc(&hstate_boot_nrinvalid[hstate_index(m->hstate)]);
 
 	return valid;
 }
@@ -3433,13 +3433,13 @@ static void __init hugetlb_bootmem_free_invalid_page(int nid, struct page *page,
  * Put bootmem huge pages into the standard lists after mem_map is up.
  * Note: This only applies to gigantic (order > MAX_PAGE_ORDER) pages.
  */
-static void __init gather_bootmem_prealloc_node(unsigned long nid)
+static void __init gather_bootmem_prealloc_list(int nid, struct list_head *list)
 {
 	LIST_HEAD(folio_list);
 	struct huge_bootmem_page *m, *tm;
 	struct hstate *h = NULL, *prev_h = NULL;
 
-	list_for_each_entry_safe(m, tm, &huge_boot_pages[nid], list) {
+	list_for_each_entry_safe(m, tm, list, list) {
 		struct page *page = virt_to_page(m);
 		struct folio *folio = (void *)page;
 
@@ -3499,17 +3499,104 @@ static void __init gather_bootmem_prealloc_node(unsigned long nid)
 	prep_and_add_bootmem_folios(h, &folio_list);
 }
 
+/*
+ * Bootmem huge pages of a node are handed to the gather threads in chunks of
+ * this many pages, so that a node with lots of gigantic pages does not
+ * serialize the struct page initialization and vmemmap optimization of all of
+ * them on a single thread.
+ */
+#define HUGETLB_BOOTMEM_CHUNK_PAGES	8
+
+struct hugetlb_bootmem_chunk {
+	int nid;
+	struct list_head pages;
+};
+
 static void __init gather_bootmem_prealloc_parallel(unsigned long start,
 						    unsigned long end, void *arg)
 {
+	struct hugetlb_bootmem_chunk *chunks = arg;
+	unsigned long i;
 	int nid;
 
-	for (nid = start; nid < end; nid++)
-		gather_bootmem_prealloc_node(nid);
+	if (!chunks) {
+		for (nid = start; nid < end; nid++)
+			gather_bootmem_prealloc_list(nid, &huge_boot_pages[nid]);
+		return;
+	}
+
+	for (i = start; i < end; i++)
+		gather_bootmem_prealloc_list(chunks[i].nid, &chunks[i].pages);
+}
+
+/*
+ * Split the bootmem huge pages of all nodes into chunks.  Returns the number
+ * of chunks, or 0 if the chunk array could not be allocated, in which case
+ * the pages are left on the per node lists.
+ */
+static unsigned long __init gather_bootmem_split_chunks(
+				struct hugetlb_bootmem_chunk **chunksp)
+{
+	struct hugetlb_bootmem_chunk *chunks;
+	struct huge_bootmem_page *m, *tm;
+	unsigned long nr_chunks = 0, i = 0, nr;
+	int nid;
+
+	for_each_node(nid) {
+		nr = list_count_nodes(&huge_boot_pages[nid]);
+		nr_chunks += DIV_ROUND_UP(nr, HUGETLB_BOOTMEM_CHUNK_PAGES);
+	}
+	if (!nr_chunks)
+		return 0;
+
+	chunks = kvcalloc(nr_chunks, sizeof(*chunks), GFP_KERNEL);
+	if (!chunks)
+		return 0;
+
+	for_each_node(nid) {
+		nr = 0;
+		list_for_each_entry_safe(m, tm, &huge_boot_pages[nid], list) {
+			if (nr++ % HUGETLB_BOOTMEM_CHUNK_PAGES == 0) {
+				chunks[i].nid = nid;
+				INIT_LIST_HEAD(&chunks[i++].pages);
+			}
+			list_move_tail(&m->list, &chunks[i - 1].pages);
+		}
+	}
+
+	*chunksp = chunks;
+	return nr_chunks;
+}
+
+static unsigned long __init hugetlb_boot_threads(void)
+{
+	/*
+	 * 25% of the available cpu threads by default.
+	 *
+	 * On large servers with terabytes of memory, huge page allocation
+	 * can consume a considerably amount of time.
+	 *
+	 * Tests below show how long it takes to allocate 1 TiB of memory with 2MiB huge pages.
+	 * 2MiB huge pages. Using more threads can significantly improve allocation time.
+	 *
+	 * +-----------------------+-------+-------+-------+-------+-------+
+	 * | threads               |   8   |   16  |   32  |   64  |   128 |
+	 * +-----------------------+-------+-------+-------+-------+-------+
+	 * | skylake      144 cpus |   44s |   22s |   16s |   19s |   20s |
+	 * | cascade lake 192 cpus |   39s |   20s |   11s |   10s |    9s |
+	 * +-----------------------+-------+-------+-------+-------+-------+
+	 */
+	if (hugepage_allocation_threads == 0) {
+		hugepage_allocation_threads = num_online_cpus() / 4;
+		hugepage_allocation_threads = max(hugepage_allocation_threads, 1);
+	}
+
+	return hugepage_allocation_threads;
 }
 
 static void __init gather_bootmem_prealloc(void)
 {
+	struct hugetlb_bootmem_chunk *chunks = NULL;
 	struct padata_mt_job job = {
 		.thread_fn	= gather_bootmem_prealloc_parallel,
 		.fn_arg		= NULL,
@@ -3520,8 +3607,29 @@ static void __init gather_bootmem_prealloc(void)
 		.max_threads	= num_node_state(N_MEMORY),
 		.numa_aware	= true,
 	};
+	unsigned long jiffies_start, nr_chunks;
+
+	jiffies_start = jiffies;
+
+	/*
+	 * Gigantic pages are allocated from memblock before the other CPUs are
+	 * up, so only their initialization can be done in parallel.  Fall back
+	 * to one thread per node if the chunks cannot be set up.
+	 */
+	nr_chunks = gather_bootmem_split_chunks(&chunks);
+	if (nr_chunks) {
+		job.fn_arg	= chunks;
+		job.size	= nr_chunks;
+		job.max_threads	= min(nr_chunks, hugetlb_boot_threads());
+	}
 
 	padata_do_multithreaded(&job);
+	kvfree(chunks);
+
+	if (nr_chunks)
+		pr_info("HugeTLB: gathering bootmem pages took %ums with %d threads\n",
+			jiffies_to_msecs(jiffies - jiffies_start),
+			job.max_threads);
 }
 
 static void __init hugetlb_hstate_alloc_pages_onenode(struct hstate *h, int nid)
@@ -3639,28 +3747,7 @@ static unsigned long __init hugetlb_pages_alloc_boot(struct hstate *h)
 	job.start	= 0;
 	job.size	= h->max_huge_pages;
 
-	/*
-	 * job.max_threads is 25% of the available cpu threads by default.
-	 *
-	 * On large servers with terabytes of memory, huge page allocation
-	 * can consume a considerably amount of time.
-	 *
-	 * Tests below show how long it takes to allocate 1 TiB of memory with 2MiB huge pages.
-	 * 2MiB huge pages. Using more threads can significantly improve allocation time.
-	 *
-	 * +-----------------------+-------+-------+-------+-------+-------+
-	 * | threads               |   8   |   16  |   32  |   64  |   128 |
-	 * +-----------------------+-------+-------+-------+-------+-------+
-	 * | skylake      144 cpus |   44s |   22s |   16s |   19s |   20s |
-	 * | cascade lake 192 cpus |   39s |   20s |   11s |   10s |    9s |
-	 * +-----------------------+-------+-------+-------+-------+-------+
-	 */
-	if (hugepage_allocation_threads == 0) {
-		hugepage_allocation_threads = num_online_cpus() / 4;
-		hugepage_allocation_threads = max(hugepage_allocation_threads, 1);
-	}
-
-	job.max_threads	= hugepage_allocation_threads;
+	job.max_threads	= hugetlb_boot_threads();
 	job.min_chunk	= h->max_huge_pages / hugepage_allocation_threads;
 
 	jiffies_start = jiffies;
@@ -3751,7 +3838,7 @@ static void __init report_hugepages(void)
 	for_each_hstate(h) {
 		char buf[32];
 
-		nrinvalid = hstate_boot_nrinvalid[hstate_index(h)];
+		nrinvalid = atomic_long_read(&hstate_boot_nrinvalid[hstate_index(h)]);
 		h->max_huge_pages -= nrinvalid;
 
 		string_get_size(huge_page_size(h), 1, STRING_UNITS_2, buf, 32);
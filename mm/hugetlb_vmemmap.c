@@ -24,6 +24,7 @@
  *
  * @remap_pte:		called for each lowest-level entry (PTE).
  * @nr_walked:		the number of walked pte.
+ * @nr_split:		the number of split PMDs.
  * @reuse_page:		the page which is reused for the tail vmemmap pages.
  * @reuse_addr:		the virtual address of the @reuse_page page.
  * @vmemmap_pages:	the list head of the vmemmap pages that can be freed
@@ -35,6 +36,7 @@ struct vmemmap_remap_walk {
 	void			(*remap_pte)(pte_t *pte, unsigned long addr,
 					     struct vmemmap_remap_walk *walk);
 	unsigned long		nr_walked;
+	unsigned long		nr_split;
 	struct page		*reuse_page;
 	unsigned long		reuse_addr;
 	struct list_head	*vmemmap_pages;
@@ -84,6 +86,7 @@ static int vmemmap_split_pmd(pmd_t *pmd, struct page *head, unsigned long start,
 		/* Make pte visible before pmd. See comment in pmd_install(). */
 		smp_wmb();
 		pmd_populate_kernel(&init_mm, pmd, pgtable);
+		walk->nr_split++;
 		if (!(walk->flags & VMEMMAP_SPLIT_NO_TLB_FLUSH))
 			flush_tlb_kernel_range(start, start + PMD_SIZE);
 	} else {
@@ -284,7 +287,8 @@ static void vmemmap_restore_pte(pte_t *pte, unsigned long addr,
  *             remap.
  * @reuse:     reuse address.
  *
- * Return: %0 on success, negative error code otherwise.
+ * Return: the number of PMDs that were split on success, negative error code
+ * otherwise.
  */
 static int vmemmap_remap_split(unsigned long start, unsigned long end,
 			       unsigned long reuse)
@@ -293,11 +297,14 @@ static int vmemmap_remap_split(unsigned long start, unsigned long end,
 		.remap_pte	= NULL,
 		.flags		= VMEMMAP_SPLIT_NO_TLB_FLUSH,
 	};
+	int ret;
 
 	/* See the comment in the vmemmap_remap_free(). */
 	BUG_ON(start - reuse != PAGE_SIZE);
 
-	return vmemmap_remap_range(reuse, end, &walk);
+	ret = vmemmap_remap_range(reuse, end, &walk);
+
+	return ret ? ret : walk.nr_split;
 }
 
 /**
@@ -654,11 +661,11 @@ static void __hugetlb_vmemmap_optimize_folios(struct hstate *h,
 					      bool boot)
 {
 	struct folio *folio;
-	int nr_to_optimize;
+	int nr_to_optimize, nr_split;
 	LIST_HEAD(vmemmap_pages);
 	unsigned long flags = VMEMMAP_REMAP_NO_TLB_FLUSH | VMEMMAP_SYNCHRONIZE_RCU;
 
-	nr_to_optimize = 0;
+	nr_to_optimize = nr_split = 0;
 	list_for_each_entry(folio, folio_list, lru) {
 		int ret;
 		unsigned long spfn, epfn;
@@ -689,8 +696,13 @@ static void __hugetlb_vmemmap_optimize_folios(struct hstate *h,
 		 * as it can be dynamically done on remap with the memory
 		 * we get back from the vmemmap deduplication.
 		 */
-		if (ret == -ENOMEM)
+		if (ret == -ENOMEM) {
+			/* A part of the range may have been split already */
+			nr_split++;
 			break;
+		}
+		if (ret > 0)
+			nr_split += ret;
 	}
 
 	if (!nr_to_optimize)
@@ -703,7 +715,14 @@ static void __hugetlb_vmemmap_optimize_folios(struct hstate *h,
 		 */
 		goto out;
 
-	flush_tlb_all();
+	/*
+	 * The split PMDs must be flushed before their PTEs are remapped.  If
+	 * the vmemmap of the whole batch was already mapped with PTEs, e.g. the
+	 * folios were optimized and restored before, the flush at the end
+	 * covers all the remaps.
+	 */
+	if (nr_split)
+		flush_tlb_all();
 
 	list_for_each_entry(folio, folio_list, lru) {
 		int ret;
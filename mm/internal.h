@@ -430,6 +430,9 @@ void unmap_page_range(struct mmu_gather *tlb,
 			     struct vm_area_struct *vma,
 			     unsigned long addr, unsigned long end,
 			     struct zap_details *details);
+void zap_page_range_single_batched(struct mmu_gather *tlb,
+		struct vm_area_struct *vma, unsigned long address,
+		unsigned long size, struct zap_details *details);
 int folio_unmap_invalidate(struct address_space *mapping, struct folio *folio,
 			   gfp_t gfp);
 
@@ -514,6 +517,9 @@ extern unsigned long highest_memmap_pfn;
 bool folio_isolate_lru(struct folio *folio);
 void folio_putback_lru(struct folio *folio);
 extern void reclaim_throttle(pg_data_t *pgdat, enum vmscan_throttle_state reason);
+#if defined(CONFIG_LRU_GEN) && defined(CONFIG_MEMCG)
+void lru_gen_working_set_show(struct seq_file *m, struct mem_cgroup *memcg);
+#endif
 
 /*
  * in mm/rmap.c:
@@ -813,6 +819,9 @@ extern void zone_pcp_reset(struct zone *zone);
 extern void zone_pcp_disable(struct zone *zone);
 extern void zone_pcp_enable(struct zone *zone);
 extern void zone_pcp_init(struct zone *zone);
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE
+extern u8 pcp_mthp_orders[NR_PCP_MTHP_ORDERS];
+#endif
 
 extern void *memmap_alloc(phys_addr_t size, phys_addr_t align,
 			  phys_addr_t min_addr,
@@ -1546,12 +1555,39 @@ static inline void shrinker_debugfs_name_free(struct shrinker *shrinker)
 	shrinker->name = NULL;
 }
 
+static inline u64 shrinker_debugfs_clock(void)
+{
+	return ktime_get_ns();
+}
+
+static inline void shrinker_debugfs_account(struct shrinker *shrinker,
+					    u64 start, unsigned long freed)
+{
+	u64 ns = ktime_get_ns() - start;
+
+	atomic_long_inc(&shrinker->debugfs_nr_calls);
+	if (freed != SHRINK_EMPTY)
+		atomic_long_add(freed, &shrinker->debugfs_nr_freed);
+	atomic64_add(ns, &shrinker->debugfs_time_ns);
+	/* Racy, but good enough to spot the outliers */
+	if (ns > READ_ONCE(shrinker->debugfs_max_ns))
+		WRITE_ONCE(shrinker->debugfs_max_ns, ns);
+}
+
 extern int shrinker_debugfs_add(struct shrinker *shrinker);
 extern struct dentry *shrinker_debugfs_detach(struct shrinker *shrinker,
 					      int *debugfs_id);
 extern void shrinker_debugfs_remove(struct dentry *debugfs_entry,
 				    int debugfs_id);
 #else /* CONFIG_SHRINKER_DEBUG */
+static inline u64 shrinker_debugfs_clock(void)
+{
+	return 0;
+}
+static inline void shrinker_debugfs_account(struct shrinker *shrinker,
+					    u64 start, unsigned long freed)
+{
+}
 static inline int shrinker_debugfs_add(struct shrinker *shrinker)
 {
 	return 0;
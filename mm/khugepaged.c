@@ -130,6 +130,49 @@ static struct khugepaged_scan khugepaged_scan = {
 	.mm_head = LIST_HEAD_INIT(khugepaged_scan.mm_head),
 };
 
+/*
+ * The round-robin scan can take minutes to get to a given range of a new mm.
+ * Ranges that are known to be hot are queued here instead, and collapsed first
+ * by khugepaged, hottest first. They come from page faults that fell back to
+ * small pages, young PTE tables found by the MGLRU page table walk, and
+ * MADV_COLLAPSE failures that are worth retrying.
+ */
+#define KHUGEPAGED_HOT_NR		64
+/* ranges colder than this are left to the scan */
+#define KHUGEPAGED_HOT_MIN		(HPAGE_PMD_NR / 16)
+
+/**
+ * struct khugepaged_hot_range - a PMD range queued for a priority collapse
+ * @mm: the mm, pinned with mmgrab()
+ * @haddr: the PMD aligned address of the range
+ * @heat: the sum of the hints for the range
+ * @queued: jiffies when the range was queued
+ */
+struct khugepaged_hot_range {
+	struct mm_struct *mm;
+	unsigned long haddr;
+	unsigned int heat;
+	unsigned long queued;
+};
+
+static DEFINE_SPINLOCK(khugepaged_hot_lock);
+static struct khugepaged_hot_range khugepaged_hot[KHUGEPAGED_HOT_NR];
+static unsigned int khugepaged_nr_hot;
+
+/*
+ * Hot ranges wake khugepaged up early, but at most once per this fraction of
+ * scan_sleep_millisecs, and never during alloc_sleep_millisecs.
+ */
+#define KHUGEPAGED_HOT_WAKE_DIV		8
+static unsigned long khugepaged_hot_wake_after;
+
+/* the last range each CPU queued from a fault fallback */
+static DEFINE_PER_CPU(unsigned long, khugepaged_hot_last);
+
+static unsigned int khugepaged_hot_collapsed;
+static u64 khugepaged_hot_latency_total;
+static unsigned int khugepaged_hot_latency_max;
+
 #ifdef CONFIG_SYSFS
 static ssize_t scan_sleep_millisecs_show(struct kobject *kobj,
 					 struct kobj_attribute *attr,
@@ -227,6 +270,34 @@ static ssize_t full_scans_show(struct kobject *kobj,
 static struct kobj_attribute full_scans_attr =
 	__ATTR_RO(full_scans);
 
+static ssize_t hot_pages_collapsed_show(struct kobject *kobj,
+					struct kobj_attribute *attr,
+					char *buf)
+{
+	return sysfs_emit(buf, "%u\n", READ_ONCE(khugepaged_hot_collapsed));
+}
+static struct kobj_attribute hot_pages_collapsed_attr =
+	__ATTR_RO(hot_pages_collapsed);
+
+static ssize_t hot_collapse_latency_ms_show(struct kobject *kobj,
+					    struct kobj_attribute *attr,
+					    char *buf)
+{
+	unsigned int nr, max;
+	u64 total;
+
+	spin_lock(&khugepaged_hot_lock);
+	nr = khugepaged_hot_collapsed;
+	total = khugepaged_hot_latency_total;
+	max = khugepaged_hot_latency_max;
+	spin_unlock(&khugepaged_hot_lock);
+
+	return sysfs_emit(buf, "avg %llu max %u\n",
+			  nr ? div_u64(total, nr) : 0, max);
+}
+static struct kobj_attribute hot_collapse_latency_ms_attr =
+	__ATTR_RO(hot_collapse_latency_ms);
+
 static ssize_t defrag_show(struct kobject *kobj,
 			   struct kobj_attribute *attr, char *buf)
 {
@@ -335,6 +406,8 @@ static struct attribute *khugepaged_attr[] = {
 	&pages_to_scan_attr.attr,
 	&pages_collapsed_attr.attr,
 	&full_scans_attr.attr,
+	&hot_pages_collapsed_attr.attr,
+	&hot_collapse_latency_ms_attr.attr,
 	&scan_sleep_millisecs_attr.attr,
 	&alloc_sleep_millisecs_attr.attr,
 	NULL,
@@ -513,6 +586,109 @@ void __khugepaged_exit(struct mm_struct *mm)
 	}
 }
 
+/**
+ * khugepaged_hot_range - hint that a PMD range is worth collapsing soon
+ * @vma: the vma the range is in
+ * @addr: an address in the range
+ * @heat: how hot the range is, in accessed or faulted pages
+ *
+ * The caller must hold the mmap_lock or the vma lock.
+ */
+void khugepaged_hot_range(struct vm_area_struct *vma, unsigned long addr,
+			  unsigned int heat)
+{
+	struct mm_struct *mm = vma->vm_mm, *drop = NULL;
+	unsigned long haddr = addr & HPAGE_PMD_MASK;
+	struct khugepaged_hot_range *range, *coldest = NULL;
+	bool wakeup = false;
+	int i;
+
+	/* not worth a collapse ahead of the scan */
+	if (heat < KHUGEPAGED_HOT_MIN)
+		return;
+	/* only registered mms get scanned at all */
+	if (!test_bit(MMF_VM_HUGEPAGE, &mm->flags))
+		return;
+	/* the anon_vma may come with the fault, the collapse checks for it */
+	if (!vma_is_anonymous(vma))
+		return;
+	if (haddr < vma->vm_start || haddr + HPAGE_PMD_SIZE > vma->vm_end)
+		return;
+	if (!thp_vma_allowable_order(vma, vma->vm_flags, TVA_ENFORCE_SYSFS,
+				     PMD_ORDER))
+		return;
+
+	spin_lock(&khugepaged_hot_lock);
+	for (i = 0; i < khugepaged_nr_hot; i++) {
+		range = &khugepaged_hot[i];
+		if (range->mm == mm && range->haddr == haddr) {
+			range->heat += heat;
+			goto unlock;
+		}
+		if (!coldest || range->heat < coldest->heat)
+			coldest = range;
+	}
+
+	if (khugepaged_nr_hot < KHUGEPAGED_HOT_NR) {
+		range = &khugepaged_hot[khugepaged_nr_hot++];
+		wakeup = true;
+	} else if (coldest->heat < heat) {
+		range = coldest;
+		drop = range->mm;
+	} else {
+		goto unlock;
+	}
+
+	mmgrab(mm);
+	range->mm = mm;
+	range->haddr = haddr;
+	range->heat = heat;
+	range->queued = jiffies;
+unlock:
+	spin_unlock(&khugepaged_hot_lock);
+
+	if (drop)
+		mmdrop(drop);
+	if (wakeup && time_after_eq(jiffies, READ_ONCE(khugepaged_hot_wake_after)))
+		wake_up_interruptible(&khugepaged_wait);
+}
+
+/*
+ * A fault that fell back to small pages is just enough to queue its range.
+ * Such faults come in runs over the same range, so only the first of a run
+ * on each CPU takes khugepaged_hot_lock.
+ */
+void khugepaged_fault_fallback(struct vm_area_struct *vma, unsigned long addr)
+{
+	unsigned long key = (unsigned long)vma->vm_mm ^ (addr & HPAGE_PMD_MASK);
+
+	if (this_cpu_read(khugepaged_hot_last) == key)
+		return;
+	this_cpu_write(khugepaged_hot_last, key);
+
+	khugepaged_hot_range(vma, addr, KHUGEPAGED_HOT_MIN);
+}
+
+static bool khugepaged_pop_hot(struct khugepaged_hot_range *hot)
+{
+	struct khugepaged_hot_range *range, *hottest = NULL;
+	int i;
+
+	spin_lock(&khugepaged_hot_lock);
+	for (i = 0; i < khugepaged_nr_hot; i++) {
+		range = &khugepaged_hot[i];
+		if (!hottest || range->heat > hottest->heat)
+			hottest = range;
+	}
+	if (hottest) {
+		*hot = *hottest;
+		*hottest = khugepaged_hot[--khugepaged_nr_hot];
+	}
+	spin_unlock(&khugepaged_hot_lock);
+
+	return hottest;
+}
+
 static void release_pte_folio(struct folio *folio)
 {
 	node_stat_mod_folio(folio,
@@ -839,11 +1015,13 @@ static int __collapse_huge_page_copy(pte_t *pte, struct folio *folio,
 
 static void khugepaged_alloc_sleep(void)
 {
+	unsigned long timeout = msecs_to_jiffies(khugepaged_alloc_sleep_millisecs);
 	DEFINE_WAIT(wait);
 
+	WRITE_ONCE(khugepaged_hot_wake_after, jiffies + timeout);
 	add_wait_queue(&khugepaged_wait, &wait);
 	__set_current_state(TASK_INTERRUPTIBLE|TASK_FREEZABLE);
-	schedule_timeout(msecs_to_jiffies(khugepaged_alloc_sleep_millisecs));
+	schedule_timeout(timeout);
 	remove_wait_queue(&khugepaged_wait, &wait);
 }
 
@@ -2514,6 +2692,65 @@ static unsigned int khugepaged_scan_mm_slot(unsigned int pages, int *result,
 	return progress;
 }
 
+/*
+ * Collapses the queued hot ranges, spending up to @pages of the scan budget on
+ * them. Returns the budget spent.
+ */
+static unsigned int khugepaged_collapse_hot(unsigned int pages, int *result,
+					    struct collapse_control *cc)
+{
+	struct khugepaged_hot_range hot;
+	struct vm_area_struct *vma;
+	unsigned int progress = 0;
+	unsigned int latency;
+
+	while (progress < pages && khugepaged_pop_hot(&hot)) {
+		struct mm_struct *mm = hot.mm;
+		bool mmap_locked = true;
+
+		cond_resched();
+		progress++;
+		*result = SCAN_FAIL;
+
+		if (!mmget_not_zero(mm))
+			goto drop;
+
+		/* just like the scan, don't wait for the mmap_lock */
+		if (!mmap_read_trylock(mm))
+			goto put;
+
+		*result = hugepage_vma_revalidate(mm, hot.haddr, true, &vma, cc);
+		if (*result == SCAN_SUCCEED) {
+			*result = hpage_collapse_scan_pmd(mm, vma, hot.haddr,
+							  &mmap_locked, cc);
+			progress += HPAGE_PMD_NR;
+		}
+		if (mmap_locked)
+			mmap_read_unlock(mm);
+
+		if (*result == SCAN_SUCCEED) {
+			++khugepaged_pages_collapsed;
+
+			latency = jiffies_to_msecs(jiffies - hot.queued);
+			spin_lock(&khugepaged_hot_lock);
+			khugepaged_hot_collapsed++;
+			khugepaged_hot_latency_total += latency;
+			khugepaged_hot_latency_max = max(khugepaged_hot_latency_max,
+							 latency);
+			spin_unlock(&khugepaged_hot_lock);
+		}
+put:
+		mmput(mm);
+drop:
+		mmdrop(mm);
+
+		if (*result == SCAN_ALLOC_HUGE_PAGE_FAIL)
+			break;
+	}
+
+	return progress;
+}
+
 static int khugepaged_has_work(void)
 {
 	return !list_empty(&khugepaged_scan.mm_head) && hugepage_pmd_enabled();
@@ -2534,6 +2771,17 @@ static void khugepaged_do_scan(struct collapse_control *cc)
 
 	lru_add_drain_all();
 
+	/* leave at least half of the budget to the scan */
+	if (hugepage_pmd_enabled()) {
+		progress = khugepaged_collapse_hot(pages / 2, &result, cc);
+		if (result == SCAN_ALLOC_HUGE_PAGE_FAIL) {
+			wait = false;
+			khugepaged_alloc_sleep();
+		}
+		if (progress >= pages)
+			return;
+	}
+
 	while (true) {
 		cond_resched();
 
@@ -2570,7 +2818,9 @@ static void khugepaged_do_scan(struct collapse_control *cc)
 static bool khugepaged_should_wakeup(void)
 {
 	return kthread_should_stop() ||
-	       time_after_eq(jiffies, khugepaged_sleep_expire);
+	       time_after_eq(jiffies, khugepaged_sleep_expire) ||
+	       (READ_ONCE(khugepaged_nr_hot) &&
+		time_after_eq(jiffies, READ_ONCE(khugepaged_hot_wake_after)));
 }
 
 static void khugepaged_wait_work(void)
@@ -2583,6 +2833,8 @@ static void khugepaged_wait_work(void)
 			return;
 
 		khugepaged_sleep_expire = jiffies + scan_sleep_jiffies;
+		WRITE_ONCE(khugepaged_hot_wake_after,
+			   jiffies + scan_sleep_jiffies / KHUGEPAGED_HOT_WAKE_DIV);
 		wait_event_freezable_timeout(khugepaged_wait,
 					     khugepaged_should_wakeup(),
 					     scan_sleep_jiffies);
@@ -2825,6 +3077,13 @@ int madvise_collapse(struct vm_area_struct *vma, struct vm_area_struct **prev,
 		case SCAN_PAGE_LRU:
 		case SCAN_DEL_PAGE_LRU:
 			last_fail = result;
+			/*
+			 * Temporary failures, let khugepaged retry them first
+			 * thing. Only when we still hold the mmap_lock the vma
+			 * can be trusted.
+			 */
+			if (mmap_locked && madvise_collapse_errno(result) == -EAGAIN)
+				khugepaged_hot_range(vma, addr, HPAGE_PMD_NR);
 			break;
 		default:
 			last_fail = result;
@@ -21,6 +21,7 @@
 #include <linux/sched.h>
 #include <linux/sched/mm.h>
 #include <linux/sched/cputime.h>
+#include <linux/sched/clock.h>
 #include <linux/rwsem.h>
 #include <linux/pagemap.h>
 #include <linux/rmap.h>
@@ -154,6 +155,7 @@ struct ksm_scan {
  * @kpfn: page frame number of this ksm page (perhaps temporarily on wrong nid)
  * @chain_prune_time: time of the last full garbage collection
  * @rmap_hlist_len: number of rmap_item entries in hlist or STABLE_NODE_CHAIN
+ * @checksum: checksum of the ksm page, for the stable filter (not in chains)
  * @nid: NUMA node id of stable tree in which linked (may not match kpfn)
  */
 struct ksm_stable_node {
@@ -179,6 +181,7 @@ struct ksm_stable_node {
 	 */
 #define STABLE_NODE_CHAIN -1024
 	int rmap_hlist_len;
+	u32 checksum;
 #ifdef CONFIG_NUMA
 	int nid;
 #endif
@@ -197,6 +200,7 @@ struct ksm_stable_node {
  * @hlist: link into hlist of rmap_items hanging off that stable_node
  * @age: number of scan iterations since creation
  * @remaining_skips: how many scans to skip
+ * @backoff: number of failed merge attempts in a row, capped
  */
 struct ksm_rmap_item {
 	struct ksm_rmap_item *rmap_list;
@@ -211,6 +215,7 @@ struct ksm_rmap_item {
 	unsigned int oldchecksum;	/* when unstable */
 	rmap_age_t age;
 	rmap_age_t remaining_skips;
+	rmap_age_t backoff;
 	union {
 		struct rb_node node;	/* when node of unstable tree */
 		struct {		/* when listed from stable tree */
@@ -300,6 +305,24 @@ atomic_long_t ksm_zero_pages = ATOMIC_LONG_INIT(0);
 /* The number of pages that have been skipped due to "smart scanning" */
 static unsigned long ksm_pages_skipped;
 
+/*
+ * A smart scan skips a page that keeps failing to merge for up to
+ * 2^KSM_MAX_BACKOFF - 1 scans in a row.
+ */
+#define KSM_MAX_BACKOFF	6
+
+/*
+ * Counting filter in front of the stable tree: how many stable nodes have
+ * a page whose checksum falls in each bucket. A page whose bucket is empty
+ * can't be in the stable tree, so searching the tree for it is skipped.
+ * Without the filter every page is searched for.
+ */
+static atomic_t *stable_filter __read_mostly;
+static unsigned int stable_filter_bits __read_mostly;
+
+/* The number of stable tree searches the filter has avoided */
+static unsigned long ksm_stable_filter_misses;
+
 /* Don't scan more than max pages per batch. */
 static unsigned long ksm_advisor_max_pages_to_scan = 30000;
 
@@ -587,6 +610,19 @@ static inline struct ksm_stable_node *alloc_stable_node(void)
 	return kmem_cache_alloc(stable_node_cache, GFP_KERNEL | __GFP_HIGH);
 }
 
+static void stable_filter_add(struct ksm_stable_node *stable_node, int nr)
+{
+	if (stable_filter)
+		atomic_add(nr, &stable_filter[hash_32(stable_node->checksum,
+						     stable_filter_bits)]);
+}
+
+static bool stable_filter_may_contain(u32 checksum)
+{
+	return !stable_filter ||
+		atomic_read(&stable_filter[hash_32(checksum, stable_filter_bits)]);
+}
+
 static inline void free_stable_node(struct ksm_stable_node *stable_node)
 {
 	VM_BUG_ON(stable_node->rmap_hlist_len &&
@@ -853,6 +889,7 @@ static void remove_node_from_stable_tree(struct ksm_stable_node *stable_node)
 		list_del(&stable_node->list);
 	else
 		stable_node_dup_del(stable_node);
+	stable_filter_add(stable_node, -1);
 	free_stable_node(stable_node);
 }
 
@@ -2068,6 +2105,7 @@ static struct ksm_stable_node *stable_tree_insert(struct folio *kfolio)
 	INIT_HLIST_HEAD(&stable_node_dup->hlist);
 	stable_node_dup->kpfn = kpfn;
 	stable_node_dup->rmap_hlist_len = 0;
+	stable_node_dup->checksum = calc_checksum(&kfolio->page);
 	DO_NUMA(stable_node_dup->nid = nid);
 	if (!need_chain) {
 		rb_link_node(&stable_node_dup->node, parent, new);
@@ -2086,6 +2124,7 @@ static struct ksm_stable_node *stable_tree_insert(struct folio *kfolio)
 	}
 
 	folio_set_stable_node(kfolio, stable_node_dup);
+	stable_filter_add(stable_node_dup, 1);
 
 	return stable_node_dup;
 }
@@ -2210,6 +2249,16 @@ static void stable_tree_append(struct ksm_rmap_item *rmap_item,
 	rmap_item->mm->ksm_merging_pages++;
 }
 
+/*
+ * Note a failed attempt to merge the page: it changed since the last scan,
+ * or merging it with an identical page failed.
+ */
+static void ksm_backoff(struct ksm_rmap_item *rmap_item)
+{
+	if (rmap_item->backoff < KSM_MAX_BACKOFF)
+		rmap_item->backoff++;
+}
+
 /*
  * cmp_and_merge_page - first see if page can be merged into the stable tree;
  * if not, compare checksum to previous and if it's the same, see if page can
@@ -2228,6 +2277,7 @@ static void cmp_and_merge_page(struct page *page, struct ksm_rmap_item *rmap_ite
 	unsigned int checksum;
 	int err;
 	bool max_page_sharing_bypass = false;
+	bool search_stable = true;
 
 	stable_node = page_stable_node(page);
 	if (stable_node) {
@@ -2259,15 +2309,20 @@ static void cmp_and_merge_page(struct page *page, struct ksm_rmap_item *rmap_ite
 		checksum = calc_checksum(page);
 		if (rmap_item->oldchecksum != checksum) {
 			rmap_item->oldchecksum = checksum;
+			ksm_backoff(rmap_item);
 			return;
 		}
 
 		if (!try_to_merge_with_zero_page(rmap_item, page))
 			return;
+
+		search_stable = stable_filter_may_contain(checksum);
+		if (!search_stable)
+			ksm_stable_filter_misses++;
 	}
 
 	/* Start by searching for the folio in the stable tree */
-	kfolio = stable_tree_search(page);
+	kfolio = search_stable ? stable_tree_search(page) : NULL;
 	if (&kfolio->page == page && rmap_item->head == stable_node) {
 		folio_put(kfolio);
 		return;
@@ -2289,6 +2344,9 @@ static void cmp_and_merge_page(struct page *page, struct ksm_rmap_item *rmap_ite
 			stable_tree_append(rmap_item, folio_stable_node(kfolio),
 					   max_page_sharing_bypass);
 			folio_unlock(kfolio);
+			rmap_item->backoff = 0;
+		} else {
+			ksm_backoff(rmap_item);
 		}
 		folio_put(kfolio);
 		return;
@@ -2338,6 +2396,9 @@ static void cmp_and_merge_page(struct page *page, struct ksm_rmap_item *rmap_ite
 			if (!stable_node) {
 				break_cow(tree_rmap_item);
 				break_cow(rmap_item);
+			} else {
+				tree_rmap_item->backoff = 0;
+				rmap_item->backoff = 0;
 			}
 		} else if (split) {
 			/*
@@ -2443,7 +2504,12 @@ static bool should_skip_rmap_item(struct folio *folio,
 	 * and determine how much more often we are allowed to skip next.
 	 */
 	if (!rmap_item->remaining_skips) {
-		rmap_item->remaining_skips = skip_age(age);
+		/*
+		 * Pages that keep changing or failing to merge back off
+		 * exponentially, beyond what their age alone gives.
+		 */
+		rmap_item->remaining_skips = max(skip_age(age),
+					(1U << rmap_item->backoff) - 1);
 		return false;
 	}
 
@@ -2644,6 +2710,22 @@ static struct ksm_rmap_item *scan_get_next_rmap_item(struct page **page)
 	return NULL;
 }
 
+/*
+ * The time ksmd spends comparing and merging the pages of an mm, and the
+ * times it yields the CPU after them, are charged to the mm's memcg.
+ */
+static void ksm_account_scan(struct mm_struct *mm, u64 nsec)
+{
+	count_vm_events(KSM_SCAN_NSEC, nsec);
+	count_memcg_events_mm(mm, KSM_SCAN_NSEC, nsec);
+}
+
+static void ksm_account_yield(struct mm_struct *mm)
+{
+	count_vm_event(KSM_YIELD);
+	count_memcg_event_mm(mm, KSM_YIELD);
+}
+
 /**
  * ksm_do_scan  - the ksm scanner main worker function.
  * @scan_npages:  number of pages we want to scan before we return.
@@ -2651,14 +2733,22 @@ static struct ksm_rmap_item *scan_get_next_rmap_item(struct page **page)
 static void ksm_do_scan(unsigned int scan_npages)
 {
 	struct ksm_rmap_item *rmap_item;
+	struct mm_struct *mm = NULL;
 	struct page *page;
+	u64 start;
 
 	while (scan_npages-- && likely(!freezing(current))) {
+		/* Still the mm of the scan cursor, so it can't go away. */
+		if (mm && need_resched())
+			ksm_account_yield(mm);
 		cond_resched();
 		rmap_item = scan_get_next_rmap_item(&page);
 		if (!rmap_item)
 			return;
+		mm = rmap_item->mm;
+		start = local_clock();
 		cmp_and_merge_page(page, rmap_item);
+		ksm_account_scan(mm, local_clock() - start);
 		put_page(page);
 		ksm_pages_scanned++;
 	}
@@ -3576,6 +3666,13 @@ static ssize_t pages_skipped_show(struct kobject *kobj,
 }
 KSM_ATTR_RO(pages_skipped);
 
+static ssize_t stable_filter_misses_show(struct kobject *kobj,
+					 struct kobj_attribute *attr, char *buf)
+{
+	return sysfs_emit(buf, "%lu\n", ksm_stable_filter_misses);
+}
+KSM_ATTR_RO(stable_filter_misses);
+
 static ssize_t ksm_zero_pages_show(struct kobject *kobj,
 				struct kobj_attribute *attr, char *buf)
 {
@@ -3798,6 +3895,7 @@ static struct attribute *ksm_attrs[] = {
 	&pages_unshared_attr.attr,
 	&pages_volatile_attr.attr,
 	&pages_skipped_attr.attr,
+	&stable_filter_misses_attr.attr,
 	&ksm_zero_pages_attr.attr,
 	&full_scans_attr.attr,
 #ifdef CONFIG_NUMA
@@ -3824,6 +3922,16 @@ static const struct attribute_group ksm_attr_group = {
 };
 #endif /* CONFIG_SYSFS */
 
+static void __init stable_filter_init(void)
+{
+	/* About one bucket per 64 pages of memory */
+	stable_filter_bits = clamp(ilog2(totalram_pages()) - 6, 10, 22);
+	stable_filter = kvcalloc(1UL << stable_filter_bits,
+				 sizeof(*stable_filter), GFP_KERNEL);
+	if (!stable_filter)
+		pr_warn("ksm: no stable filter, every page searches the stable tree\n");
+}
+
 static int __init ksm_init(void)
 {
 	struct task_struct *ksm_thread;
@@ -3838,6 +3946,8 @@ static int __init ksm_init(void)
 	if (err)
 		goto out;
 
+	stable_filter_init();
+
 	ksm_thread = kthread_run(ksm_scan_thread, NULL, "ksmd");
 	if (IS_ERR(ksm_thread)) {
 		pr_err("ksm: creating kthread failed\n");
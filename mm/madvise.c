@@ -796,12 +796,19 @@ static const struct mm_walk_ops madvise_free_walk_ops = {
 	.walk_lock		= PGWALK_RDLOCK,
 };
 
+/* Same, for a VMA that is only read-locked, without mmap_lock. */
+static const struct mm_walk_ops madvise_free_vma_walk_ops = {
+	.pmd_entry		= madvise_free_pte_range,
+	.walk_lock		= PGWALK_VMA_RDLOCK_VERIFY,
+};
+
 static int madvise_free_single_vma(struct vm_area_struct *vma,
-			unsigned long start_addr, unsigned long end_addr)
+			unsigned long start_addr, unsigned long end_addr,
+			struct mmu_gather *batch, bool vma_locked)
 {
 	struct mm_struct *mm = vma->vm_mm;
 	struct mmu_notifier_range range;
-	struct mmu_gather tlb;
+	struct mmu_gather local, *tlb = batch ? batch : &local;
 
 	/* MADV_FREE works for only anon vma at the moment */
 	if (!vma_is_anonymous(vma))
@@ -817,16 +824,19 @@ static int madvise_free_single_vma(struct vm_area_struct *vma,
 				range.start, range.end);
 
 	lru_add_drain();
-	tlb_gather_mmu(&tlb, mm);
+	if (!batch)
+		tlb_gather_mmu(tlb, mm);
 	update_hiwater_rss(mm);
 
 	mmu_notifier_invalidate_range_start(&range);
-	tlb_start_vma(&tlb, vma);
-	walk_page_range(vma->vm_mm, range.start, range.end,
-			&madvise_free_walk_ops, &tlb);
-	tlb_end_vma(&tlb, vma);
+	tlb_start_vma(tlb, vma);
+	walk_page_range_vma(vma, range.start, range.end,
+			    vma_locked ? &madvise_free_vma_walk_ops :
+					 &madvise_free_walk_ops, tlb);
+	tlb_end_vma(tlb, vma);
 	mmu_notifier_invalidate_range_end(&range);
-	tlb_finish_mmu(&tlb);
+	if (!batch)
+		tlb_finish_mmu(tlb);
 
 	return 0;
 }
@@ -851,14 +861,19 @@ static int madvise_free_single_vma(struct vm_area_struct *vma,
  * dirty pages is already available as msync(MS_INVALIDATE).
  */
 static long madvise_dontneed_single_vma(struct vm_area_struct *vma,
-					unsigned long start, unsigned long end)
+					unsigned long start, unsigned long end,
+					struct mmu_gather *batch)
 {
 	struct zap_details details = {
 		.reclaim_pt = true,
 		.even_cows = true,
 	};
 
-	zap_page_range_single(vma, start, end - start, &details);
+	if (batch)
+		zap_page_range_single_batched(batch, vma, start, end - start,
+					      &details);
+	else
+		zap_page_range_single(vma, start, end - start, &details);
 	return 0;
 }
 
@@ -895,7 +910,7 @@ static bool madvise_dontneed_free_valid_vma(struct vm_area_struct *vma,
 static long madvise_dontneed_free(struct vm_area_struct *vma,
 				  struct vm_area_struct **prev,
 				  unsigned long start, unsigned long end,
-				  int behavior)
+				  int behavior, struct mmu_gather *batch)
 {
 	struct mm_struct *mm = vma->vm_mm;
 
@@ -906,6 +921,13 @@ static long madvise_dontneed_free(struct vm_area_struct *vma,
 	if (start == end)
 		return 0;
 
+	/*
+	 * userfaultfd_remove() may drop mmap_lock: don't let the ranges
+	 * already zapped keep stale TLB entries across that.
+	 */
+	if (batch && userfaultfd_armed(vma))
+		tlb_flush_mmu(batch);
+
 	if (!userfaultfd_remove(vma, start, end)) {
 		*prev = NULL; /* mmap_lock has been dropped, prev is stale */
 
@@ -948,13 +970,142 @@ static long madvise_dontneed_free(struct vm_area_struct *vma,
 	}
 
 	if (behavior == MADV_DONTNEED || behavior == MADV_DONTNEED_LOCKED)
-		return madvise_dontneed_single_vma(vma, start, end);
+		return madvise_dontneed_single_vma(vma, start, end, batch);
 	else if (behavior == MADV_FREE)
-		return madvise_free_single_vma(vma, start, end);
+		return madvise_free_single_vma(vma, start, end, batch, false);
 	else
 		return -EINVAL;
 }
 
+/*
+ * Discarding memory is the madvise() that allocators and language runtimes
+ * issue all the time, and it only zaps page tables.
+ */
+static bool madvise_is_discard(int behavior)
+{
+	switch (behavior) {
+	case MADV_DONTNEED:
+	case MADV_DONTNEED_LOCKED:
+	case MADV_FREE:
+		return true;
+	default:
+		return false;
+	}
+}
+
+/*
+ * The discards of one madvise() spanning several VMAs, or of all the ranges
+ * of one process_madvise(), share an mmu_gather: one TLB flush and one round
+ * of page freeing for the whole call instead of one per VMA.
+ */
+struct madvise_batch {
+	int behavior;
+	unsigned int nr;
+	struct mmu_gather tlb;
+};
+
+static void madvise_batch_init(struct madvise_batch *batch,
+			       struct mm_struct *mm, int behavior)
+{
+	batch->behavior = behavior;
+	batch->nr = 0;
+	tlb_gather_mmu(&batch->tlb, mm);
+}
+
+static void madvise_batch_finish(struct madvise_batch *batch)
+{
+	tlb_finish_mmu(&batch->tlb);
+	if (batch->nr > 1)
+		count_vm_events(MADVISE_FLUSH_SAVED, batch->nr - 1);
+}
+
+static int madvise_vma_batched(struct vm_area_struct *vma,
+			       struct vm_area_struct **prev,
+			       unsigned long start, unsigned long end,
+			       unsigned long arg)
+{
+	struct madvise_batch *batch = (struct madvise_batch *)arg;
+	bool merged;
+	long error;
+
+	if (unlikely(!can_modify_vma_madv(vma, batch->behavior)))
+		return -EPERM;
+
+	/*
+	 * Only count the VMAs whose flush can merge with the others', see
+	 * tlb_end_vma(). hugetlb ones are flushed on their own anyway.
+	 */
+	merged = IS_ENABLED(CONFIG_MMU_GATHER_MERGE_VMAS) &&
+		 !is_vm_hugetlb_page(vma) &&
+		 !(vma->vm_flags & (VM_PFNMAP | VM_MIXEDMAP));
+
+	error = madvise_dontneed_free(vma, prev, start, end, batch->behavior,
+				      &batch->tlb);
+	if (!error && merged)
+		batch->nr++;
+	return error;
+}
+
+#ifdef CONFIG_PER_VMA_LOCK
+/*
+ * When a discard lies in a single VMA, do it under that VMA's read lock
+ * instead of mmap_lock, so that it stops serializing against mmap(), munmap()
+ * and mprotect() elsewhere in the address space.
+ */
+
+/*
+ * Returns true if the request was handled under the per-VMA lock, with its
+ * result in @err, or false if it needs mmap_lock.
+ */
+static bool madvise_vma_locked(struct mm_struct *mm, unsigned long start,
+		size_t len_in, int behavior, int *err)
+{
+	struct vm_area_struct *vma;
+	unsigned long end;
+
+	/* lock_vma_under_rcu() is only safe for our own address space. */
+	if (!madvise_is_discard(behavior) || mm != current->mm)
+		return false;
+
+	start = untagged_addr(start);
+	end = start + PAGE_ALIGN(len_in);
+
+	vma = lock_vma_under_rcu(mm, start);
+	if (!vma)
+		return false;
+
+	/*
+	 * Ranges spanning several VMAs take the walk under mmap_lock, as do
+	 * hugetlb VMAs, and userfaultfd_remove() wants to drop mmap_lock.
+	 */
+	if (end > vma->vm_end || is_vm_hugetlb_page(vma) ||
+	    userfaultfd_armed(vma)) {
+		vma_end_read(vma);
+		return false;
+	}
+
+	if (unlikely(!can_modify_vma_madv(vma, behavior)))
+		*err = -EPERM;
+	else if (!madvise_dontneed_free_valid_vma(vma, start, &end, behavior))
+		*err = -EINVAL;
+	else if (start == end)
+		*err = 0;
+	else if (behavior == MADV_FREE)
+		*err = madvise_free_single_vma(vma, start, end, NULL, true);
+	else
+		*err = madvise_dontneed_single_vma(vma, start, end, NULL);
+
+	vma_end_read(vma);
+	return true;
+}
+#else
+static bool madvise_vma_locked(struct mm_struct *mm, unsigned long start,
+		size_t len_in, int behavior, int *err)
+{
+	return false;
+}
+#endif /* CONFIG_PER_VMA_LOCK */
+
 static long madvise_populate(struct mm_struct *mm, unsigned long start,
 		unsigned long end, int behavior)
 {
@@ -1272,7 +1423,8 @@ static int madvise_vma_behavior(struct vm_area_struct *vma,
 	case MADV_FREE:
 	case MADV_DONTNEED:
 	case MADV_DONTNEED_LOCKED:
-		return madvise_dontneed_free(vma, prev, start, end, behavior);
+		return madvise_dontneed_free(vma, prev, start, end, behavior,
+					     NULL);
 	case MADV_NORMAL:
 		new_flags = new_flags & ~VM_RAND_READ & ~VM_SEQ_READ;
 		break;
@@ -1679,7 +1831,8 @@ static bool is_madvise_populate(int behavior)
 }
 
 static int madvise_do_behavior(struct mm_struct *mm,
-		unsigned long start, size_t len_in, int behavior)
+		unsigned long start, size_t len_in, int behavior,
+		struct madvise_batch *batch)
 {
 	struct blk_plug plug;
 	unsigned long end;
@@ -1693,6 +1846,9 @@ static int madvise_do_behavior(struct mm_struct *mm,
 	blk_start_plug(&plug);
 	if (is_madvise_populate(behavior))
 		error = madvise_populate(mm, start, end, behavior);
+	else if (batch)
+		error = madvise_walk_vmas(mm, start, end, (unsigned long)batch,
+					  madvise_vma_batched);
 	else
 		error = madvise_walk_vmas(mm, start, end, behavior,
 					  madvise_vma_behavior);
@@ -1774,14 +1930,23 @@ static int madvise_do_behavior(struct mm_struct *mm,
  */
 int do_madvise(struct mm_struct *mm, unsigned long start, size_t len_in, int behavior)
 {
+	struct madvise_batch batch;
+	bool batched = madvise_is_discard(behavior);
 	int error;
 
 	if (madvise_should_skip(start, len_in, behavior, &error))
 		return error;
+	if (madvise_vma_locked(mm, start, len_in, behavior, &error))
+		return error;
 	error = madvise_lock(mm, behavior);
 	if (error)
 		return error;
-	error = madvise_do_behavior(mm, start, len_in, behavior);
+	if (batched)
+		madvise_batch_init(&batch, mm, behavior);
+	error = madvise_do_behavior(mm, start, len_in, behavior,
+				    batched ? &batch : NULL);
+	if (batched)
+		madvise_batch_finish(&batch);
 	madvise_unlock(mm, behavior);
 
 	return error;
@@ -1796,6 +1961,8 @@ SYSCALL_DEFINE3(madvise, unsigned long, start, size_t, len_in, int, behavior)
 static ssize_t vector_madvise(struct mm_struct *mm, struct iov_iter *iter,
 			      int behavior)
 {
+	struct madvise_batch batch;
+	bool batched = madvise_is_discard(behavior);
 	ssize_t ret = 0;
 	size_t total_len;
 
@@ -1804,6 +1971,8 @@ static ssize_t vector_madvise(struct mm_struct *mm, struct iov_iter *iter,
 	ret = madvise_lock(mm, behavior);
 	if (ret)
 		return ret;
+	if (batched)
+		madvise_batch_init(&batch, mm, behavior);
 
 	while (iov_iter_count(iter)) {
 		unsigned long start = (unsigned long)iter_iov_addr(iter);
@@ -1813,7 +1982,8 @@ static ssize_t vector_madvise(struct mm_struct *mm, struct iov_iter *iter,
 		if (madvise_should_skip(start, len_in, behavior, &error))
 			ret = error;
 		else
-			ret = madvise_do_behavior(mm, start, len_in, behavior);
+			ret = madvise_do_behavior(mm, start, len_in, behavior,
+						  batched ? &batch : NULL);
 		/*
 		 * An madvise operation is attempting to restart the syscall,
 		 * but we cannot proceed as it would not be correct to repeat
@@ -1831,16 +2001,22 @@ static ssize_t vector_madvise(struct mm_struct *mm, struct iov_iter *iter,
 			}
 
 			/* Drop and reacquire lock to unwind race. */
+			if (batched)
+				madvise_batch_finish(&batch);
 			madvise_unlock(mm, behavior);
 			ret = madvise_lock(mm, behavior);
 			if (ret)
 				goto out;
+			if (batched)
+				madvise_batch_init(&batch, mm, behavior);
 			continue;
 		}
 		if (ret < 0)
 			break;
 		iov_iter_advance(iter, iter_iov_len(iter));
 	}
+	if (batched)
+		madvise_batch_finish(&batch);
 	madvise_unlock(mm, behavior);
 
 out:
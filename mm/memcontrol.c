@@ -145,15 +145,16 @@ static void obj_cgroup_release(struct percpu_ref *ref)
 	 * However, it can be PAGE_SIZE or (x * PAGE_SIZE).
 	 *
 	 * The following sequence can lead to it:
-	 * 1) CPU0: objcg == stock->cached_objcg
+	 * 1) CPU0: objcg is cached in one of the stock->obj[] slots
 	 * 2) CPU1: we do a small allocation (e.g. 92 bytes),
 	 *          PAGE_SIZE bytes are charged
-	 * 3) CPU1: a process from another memcg is allocating something,
-	 *          the stock if flushed,
+	 * 3) CPU1: processes from other memcgs are allocating something,
+	 *          objcg's slot is the least recently used one and is
+	 *          evicted, or the whole stock is drained,
 	 *          objcg->nr_charged_bytes = PAGE_SIZE - 92
 	 * 5) CPU0: we do release this object,
-	 *          92 bytes are added to stock->nr_bytes
-	 * 6) CPU0: stock is flushed,
+	 *          92 bytes are added to the nr_bytes of objcg's slot
+	 * 6) CPU0: the slot is evicted or the stock is drained,
 	 *          92 bytes are added to objcg->nr_charged_bytes
 	 *
 	 * In the result, nr_charged_bytes == PAGE_SIZE.
@@ -453,6 +454,10 @@ static const unsigned int memcg_vm_event_stat[] = {
 	ZSWPOUT,
 	ZSWPWB,
 #endif
+#ifdef CONFIG_KSM
+	KSM_SCAN_NSEC,
+	KSM_YIELD,
+#endif
 #ifdef CONFIG_TRANSPARENT_HUGEPAGE
 	THP_FAULT_ALLOC,
 	THP_COLLAPSE_ALLOC,
@@ -537,6 +542,11 @@ struct memcg_vmstats {
  *    (MEMCG_CHARGE_BATCH * nr_cpus) update events. Though this optimization
  *    will let stats be out of sync by atmost (MEMCG_CHARGE_BATCH * nr_cpus) but
  *    only for 2 seconds due to (1).
+ *
+ * 3) Readers that can live with stats up to two flush periods old, like
+ *    memory.stat.approx, skip the synchronous flush of (2) and rely on (1)
+ *    instead, so that polling many cgroups doesn't contend on the rstat lock.
+ *    The skipped flushes are counted as memcg_flush_avoided in /proc/vmstat.
  */
 static void flush_memcg_stats_dwork(struct work_struct *w);
 static DECLARE_DEFERRABLE_WORK(stats_flush_dwork, flush_memcg_stats_dwork);
@@ -642,6 +652,9 @@ void mem_cgroup_flush_stats_ratelimited(struct mem_cgroup *memcg)
 	/* Only flush if the periodic flusher is one full cycle late */
 	if (time_after64(jiffies_64, READ_ONCE(flush_last_time) + 2*FLUSH_TIME))
 		mem_cgroup_flush_stats(memcg);
+	else if (memcg && !mem_cgroup_disabled() &&
+		 memcg_vmstats_needs_flush(memcg->vmstats))
+		count_vm_event(MEMCG_FLUSH_AVOIDED);
 }
 
 static void flush_memcg_stats_dwork(struct work_struct *w)
@@ -1486,10 +1499,8 @@ static void memcg_stat_format(struct mem_cgroup *memcg, struct seq_buf *s)
 	 * 1) generic big picture -> specifics and details
 	 * 2) reflecting userspace activity -> reflecting kernel heuristics
 	 *
-	 * Current memory state:
+	 * Current memory state, flushed by the caller:
 	 */
-	mem_cgroup_flush_stats(memcg);
-
 	for (i = 0; i < ARRAY_SIZE(memory_stats); i++) {
 		u64 size;
 
@@ -1534,10 +1545,12 @@ static void memcg_stat_format(struct mem_cgroup *memcg, struct seq_buf *s)
 
 static void memory_stat_format(struct mem_cgroup *memcg, struct seq_buf *s)
 {
-	if (cgroup_subsys_on_dfl(memory_cgrp_subsys))
+	if (cgroup_subsys_on_dfl(memory_cgrp_subsys)) {
+		mem_cgroup_flush_stats(memcg);
 		memcg_stat_format(memcg, s);
-	else
+	} else {
 		memcg1_stat_format(memcg, s);
+	}
 	if (seq_buf_has_overflowed(s))
 		pr_warn("%s: Warning, stat buffer overflow, please report\n", __func__);
 }
@@ -1756,16 +1769,74 @@ void mem_cgroup_print_oom_group(struct mem_cgroup *memcg)
 	pr_cont(" are going to be killed due to memory.oom.group set\n");
 }
 
-struct memcg_stock_pcp {
-	local_trylock_t stock_lock;
+static unsigned int memcg_stall_bucket(u64 ns)
+{
+	u64 us = div_u64(ns, NSEC_PER_USEC);
+
+	if (us < 16)
+		return 0;
+	return min(ilog2(us) / 2 - 1, MEMCG_NR_STALL_BUCKETS - 1);
+}
+
+/**
+ * mem_cgroup_account_stall - account a stall of the current task
+ * @stall_ns: time spent in each phase of the stall, zero for the phases that
+ *	      it did not go through
+ *
+ * The stall is accounted to the memcg of the current task and its ancestors,
+ * so that memory.reclaim_stat of a parent covers its whole subtree.
+ */
+void mem_cgroup_account_stall(const u64 stall_ns[MEMCG_NR_STALL_PHASES])
+{
+	struct mem_cgroup *memcg;
+	int i;
+
+	if (mem_cgroup_disabled())
+		return;
+
+	rcu_read_lock();
+	memcg = mem_cgroup_from_task(current);
+	for (; memcg; memcg = parent_mem_cgroup(memcg)) {
+		for (i = 0; i < MEMCG_NR_STALL_PHASES; i++) {
+			if (!stall_ns[i])
+				continue;
+			atomic64_add(stall_ns[i], &memcg->stall_time[i]);
+			atomic_long_inc(&memcg->stall_hist[i][memcg_stall_bucket(stall_ns[i])]);
+		}
+	}
+	rcu_read_unlock();
+}
+
+/*
+ * A CPU that switches between tasks of different cgroups would drain and
+ * refill a single-entry stock on every switch, and end up in the shared
+ * page_counter atomics anyway. So the stock caches the charges of the last
+ * few memcgs and objcgs used on the CPU, and evicts the least recently used
+ * one when it needs a new slot.
+ */
+#define NR_MEMCG_STOCK	7
+#define NR_OBJ_STOCK	4
+
+struct memcg_stock_slot {
 	struct mem_cgroup *cached; /* this never be root cgroup */
 	unsigned int nr_pages;
+	unsigned int last_used;
+};
 
+struct obj_stock_slot {
 	struct obj_cgroup *cached_objcg;
 	struct pglist_data *cached_pgdat;
 	unsigned int nr_bytes;
 	int nr_slab_reclaimable_b;
 	int nr_slab_unreclaimable_b;
+	unsigned int last_used;
+};
+
+struct memcg_stock_pcp {
+	local_trylock_t stock_lock;
+	unsigned int clock;
+	struct memcg_stock_slot slots[NR_MEMCG_STOCK];
+	struct obj_stock_slot obj[NR_OBJ_STOCK];
 
 	struct work_struct work;
 	unsigned long flags;
@@ -1776,19 +1847,34 @@ static DEFINE_PER_CPU(struct memcg_stock_pcp, memcg_stock) = {
 };
 static DEFINE_MUTEX(percpu_charge_mutex);
 
-static struct obj_cgroup *drain_obj_stock(struct memcg_stock_pcp *stock);
+static struct obj_cgroup *drain_obj_stock_slot(struct obj_stock_slot *slot);
+static void drain_obj_stock(struct memcg_stock_pcp *stock,
+			    struct obj_cgroup **old);
 static bool obj_stock_flush_required(struct memcg_stock_pcp *stock,
 				     struct mem_cgroup *root_memcg);
 
+/* Stamp a slot as the most recently used one of the stock. */
+static inline unsigned int stock_tick(struct memcg_stock_pcp *stock)
+{
+	return ++stock->clock;
+}
+
+/* How long ago a slot was used, robust against the clock wrapping. */
+static inline unsigned int stock_age(struct memcg_stock_pcp *stock,
+				     unsigned int last_used)
+{
+	return stock->clock - last_used;
+}
+
 /**
  * consume_stock: Try to consume stocked charge on this cpu.
  * @memcg: memcg to consume from.
  * @nr_pages: how many pages to charge.
  * @gfp_mask: allocation mask.
  *
- * The charges will only happen if @memcg matches the current cpu's memcg
- * stock, and at least @nr_pages are available in that stock.  Failure to
- * service an allocation will refill the stock.
+ * The charges will only happen if @memcg is one of the memcgs cached in the
+ * current cpu's stock, and at least @nr_pages are available in its slot.
+ * Failure to service an allocation will refill the stock.
  *
  * returns true if successful, false otherwise.
  */
@@ -1799,6 +1885,7 @@ static bool consume_stock(struct mem_cgroup *memcg, unsigned int nr_pages,
 	unsigned int stock_pages;
 	unsigned long flags;
 	bool ret = false;
+	int i;
 
 	if (nr_pages > MEMCG_CHARGE_BATCH)
 		return ret;
@@ -1809,10 +1896,18 @@ static bool consume_stock(struct mem_cgroup *memcg, unsigned int nr_pages,
 		return ret;
 
 	stock = this_cpu_ptr(&memcg_stock);
-	stock_pages = READ_ONCE(stock->nr_pages);
-	if (memcg == READ_ONCE(stock->cached) && stock_pages >= nr_pages) {
-		WRITE_ONCE(stock->nr_pages, stock_pages - nr_pages);
-		ret = true;
+	for (i = 0; i < NR_MEMCG_STOCK; i++) {
+		struct memcg_stock_slot *slot = &stock->slots[i];
+
+		if (memcg != READ_ONCE(slot->cached))
+			continue;
+		stock_pages = READ_ONCE(slot->nr_pages);
+		if (stock_pages >= nr_pages) {
+			WRITE_ONCE(slot->nr_pages, stock_pages - nr_pages);
+			slot->last_used = stock_tick(stock);
+			ret = true;
+		}
+		break;
 	}
 
 	local_unlock_irqrestore(&memcg_stock.stock_lock, flags);
@@ -1821,12 +1916,12 @@ static bool consume_stock(struct mem_cgroup *memcg, unsigned int nr_pages,
 }
 
 /*
- * Returns stocks cached in percpu and reset cached information.
+ * Returns the charge cached in a slot of the percpu stock and resets it.
  */
-static void drain_stock(struct memcg_stock_pcp *stock)
+static void drain_stock_slot(struct memcg_stock_slot *slot)
 {
-	unsigned int stock_pages = READ_ONCE(stock->nr_pages);
-	struct mem_cgroup *old = READ_ONCE(stock->cached);
+	unsigned int stock_pages = READ_ONCE(slot->nr_pages);
+	struct mem_cgroup *old = READ_ONCE(slot->cached);
 
 	if (!old)
 		return;
@@ -1836,18 +1931,27 @@ static void drain_stock(struct memcg_stock_pcp *stock)
 		if (do_memsw_account())
 			page_counter_uncharge(&old->memsw, stock_pages);
 
-		WRITE_ONCE(stock->nr_pages, 0);
+		WRITE_ONCE(slot->nr_pages, 0);
 	}
 
 	css_put(&old->css);
-	WRITE_ONCE(stock->cached, NULL);
+	WRITE_ONCE(slot->cached, NULL);
+}
+
+static void drain_stock(struct memcg_stock_pcp *stock)
+{
+	int i;
+
+	for (i = 0; i < NR_MEMCG_STOCK; i++)
+		drain_stock_slot(&stock->slots[i]);
 }
 
 static void drain_local_stock(struct work_struct *dummy)
 {
+	struct obj_cgroup *old[NR_OBJ_STOCK];
 	struct memcg_stock_pcp *stock;
-	struct obj_cgroup *old = NULL;
 	unsigned long flags;
+	int i;
 
 	/*
 	 * The only protection from cpu hotplug (memcg_hotplug_cpu_dead) vs.
@@ -1857,12 +1961,13 @@ static void drain_local_stock(struct work_struct *dummy)
 	local_lock_irqsave(&memcg_stock.stock_lock, flags);
 
 	stock = this_cpu_ptr(&memcg_stock);
-	old = drain_obj_stock(stock);
+	drain_obj_stock(stock, old);
 	drain_stock(stock);
 	clear_bit(FLUSHING_CACHED_CHARGE, &stock->flags);
 
 	local_unlock_irqrestore(&memcg_stock.stock_lock, flags);
-	obj_cgroup_put(old);
+	for (i = 0; i < NR_OBJ_STOCK; i++)
+		obj_cgroup_put(old[i]);
 }
 
 /*
@@ -1871,20 +1976,38 @@ static void drain_local_stock(struct work_struct *dummy)
  */
 static void __refill_stock(struct mem_cgroup *memcg, unsigned int nr_pages)
 {
+	struct memcg_stock_slot *slot = NULL, *victim = NULL;
 	struct memcg_stock_pcp *stock;
 	unsigned int stock_pages;
+	int i;
 
 	stock = this_cpu_ptr(&memcg_stock);
-	if (READ_ONCE(stock->cached) != memcg) { /* reset if necessary */
-		drain_stock(stock);
+	for (i = 0; i < NR_MEMCG_STOCK; i++) {
+		struct memcg_stock_slot *s = &stock->slots[i];
+
+		if (READ_ONCE(s->cached) == memcg) {
+			slot = s;
+			break;
+		}
+		if (!victim || !s->cached ||
+		    (victim->cached &&
+		     stock_age(stock, s->last_used) >
+		     stock_age(stock, victim->last_used)))
+			victim = s;
+	}
+
+	if (!slot) { /* evict the least recently used memcg if necessary */
+		slot = victim;
+		drain_stock_slot(slot);
 		css_get(&memcg->css);
-		WRITE_ONCE(stock->cached, memcg);
+		WRITE_ONCE(slot->cached, memcg);
 	}
-	stock_pages = READ_ONCE(stock->nr_pages) + nr_pages;
-	WRITE_ONCE(stock->nr_pages, stock_pages);
+	slot->last_used = stock_tick(stock);
+	stock_pages = READ_ONCE(slot->nr_pages) + nr_pages;
+	WRITE_ONCE(slot->nr_pages, stock_pages);
 
 	if (stock_pages > MEMCG_CHARGE_BATCH)
-		drain_stock(stock);
+		drain_stock_slot(slot);
 }
 
 static void refill_stock(struct mem_cgroup *memcg, unsigned int nr_pages)
@@ -1928,15 +2051,21 @@ void drain_all_stock(struct mem_cgroup *root_memcg)
 	curcpu = smp_processor_id();
 	for_each_online_cpu(cpu) {
 		struct memcg_stock_pcp *stock = &per_cpu(memcg_stock, cpu);
-		struct mem_cgroup *memcg;
 		bool flush = false;
+		int i;
 
 		rcu_read_lock();
-		memcg = READ_ONCE(stock->cached);
-		if (memcg && READ_ONCE(stock->nr_pages) &&
-		    mem_cgroup_is_descendant(memcg, root_memcg))
-			flush = true;
-		else if (obj_stock_flush_required(stock, root_memcg))
+		for (i = 0; i < NR_MEMCG_STOCK; i++) {
+			struct memcg_stock_slot *slot = &stock->slots[i];
+			struct mem_cgroup *memcg = READ_ONCE(slot->cached);
+
+			if (memcg && READ_ONCE(slot->nr_pages) &&
+			    mem_cgroup_is_descendant(memcg, root_memcg)) {
+				flush = true;
+				break;
+			}
+		}
+		if (!flush && obj_stock_flush_required(stock, root_memcg))
 			flush = true;
 		rcu_read_unlock();
 
@@ -1954,19 +2083,21 @@ void drain_all_stock(struct mem_cgroup *root_memcg)
 
 static int memcg_hotplug_cpu_dead(unsigned int cpu)
 {
+	struct obj_cgroup *old[NR_OBJ_STOCK];
 	struct memcg_stock_pcp *stock;
-	struct obj_cgroup *old;
 	unsigned long flags;
+	int i;
 
 	stock = &per_cpu(memcg_stock, cpu);
 
 	/* drain_obj_stock requires stock_lock */
 	local_lock_irqsave(&memcg_stock.stock_lock, flags);
-	old = drain_obj_stock(stock);
+	drain_obj_stock(stock, old);
 	local_unlock_irqrestore(&memcg_stock.stock_lock, flags);
 
 	drain_stock(stock);
-	obj_cgroup_put(old);
+	for (i = 0; i < NR_OBJ_STOCK; i++)
+		obj_cgroup_put(old[i]);
 
 	return 0;
 }
@@ -2762,25 +2893,64 @@ void __memcg_kmem_uncharge_page(struct page *page, int order)
 	obj_cgroup_put(objcg);
 }
 
-/* Replace the stock objcg with objcg, return the old objcg */
-static struct obj_cgroup *replace_stock_objcg(struct memcg_stock_pcp *stock,
+static struct obj_stock_slot *find_obj_stock(struct memcg_stock_pcp *stock,
 					     struct obj_cgroup *objcg)
 {
-	struct obj_cgroup *old = NULL;
+	int i;
+
+	for (i = 0; i < NR_OBJ_STOCK; i++) {
+		struct obj_stock_slot *slot = &stock->obj[i];
+
+		if (READ_ONCE(slot->cached_objcg) == objcg) {
+			slot->last_used = stock_tick(stock);
+			return slot;
+		}
+	}
+	return NULL;
+}
+
+/*
+ * Return the slot of objcg in the stock, replacing the least recently used
+ * objcg if objcg isn't cached. The replaced objcg is returned in @old.
+ */
+static struct obj_stock_slot *get_obj_stock(struct memcg_stock_pcp *stock,
+					    struct obj_cgroup *objcg,
+					    struct obj_cgroup **old)
+{
+	struct obj_stock_slot *slot, *victim = NULL;
+	int i;
+
+	*old = NULL;
+	slot = find_obj_stock(stock, objcg);
+	if (slot)
+		return slot;
+
+	for (i = 0; i < NR_OBJ_STOCK; i++) {
+		slot = &stock->obj[i];
+		if (!slot->cached_objcg) {
+			victim = slot;
+			break;
+		}
+		if (!victim || stock_age(stock, slot->last_used) >
+			       stock_age(stock, victim->last_used))
+			victim = slot;
+	}
 
-	old = drain_obj_stock(stock);
+	*old = drain_obj_stock_slot(victim);
 	obj_cgroup_get(objcg);
-	stock->nr_bytes = atomic_read(&objcg->nr_charged_bytes)
+	victim->nr_bytes = atomic_read(&objcg->nr_charged_bytes)
 			? atomic_xchg(&objcg->nr_charged_bytes, 0) : 0;
-	WRITE_ONCE(stock->cached_objcg, objcg);
-	return old;
+	WRITE_ONCE(victim->cached_objcg, objcg);
+	victim->last_used = stock_tick(stock);
+	return victim;
 }
 
 static void mod_objcg_state(struct obj_cgroup *objcg, struct pglist_data *pgdat,
 		     enum node_stat_item idx, int nr)
 {
 	struct memcg_stock_pcp *stock;
-	struct obj_cgroup *old = NULL;
+	struct obj_stock_slot *slot;
+	struct obj_cgroup *old;
 	unsigned long flags;
 	int *bytes;
 
@@ -2792,28 +2962,28 @@ static void mod_objcg_state(struct obj_cgroup *objcg, struct pglist_data *pgdat,
 	 * accumulating over a page of vmstat data or when pgdat or idx
 	 * changes.
 	 */
-	if (READ_ONCE(stock->cached_objcg) != objcg) {
-		old = replace_stock_objcg(stock, objcg);
-		stock->cached_pgdat = pgdat;
-	} else if (stock->cached_pgdat != pgdat) {
+	slot = get_obj_stock(stock, objcg, &old);
+	if (!slot->cached_pgdat) {
+		slot->cached_pgdat = pgdat;
+	} else if (slot->cached_pgdat != pgdat) {
 		/* Flush the existing cached vmstat data */
-		struct pglist_data *oldpg = stock->cached_pgdat;
+		struct pglist_data *oldpg = slot->cached_pgdat;
 
-		if (stock->nr_slab_reclaimable_b) {
+		if (slot->nr_slab_reclaimable_b) {
 			__mod_objcg_mlstate(objcg, oldpg, NR_SLAB_RECLAIMABLE_B,
-					  stock->nr_slab_reclaimable_b);
-			stock->nr_slab_reclaimable_b = 0;
+					  slot->nr_slab_reclaimable_b);
+			slot->nr_slab_reclaimable_b = 0;
 		}
-		if (stock->nr_slab_unreclaimable_b) {
+		if (slot->nr_slab_unreclaimable_b) {
 			__mod_objcg_mlstate(objcg, oldpg, NR_SLAB_UNRECLAIMABLE_B,
-					  stock->nr_slab_unreclaimable_b);
-			stock->nr_slab_unreclaimable_b = 0;
+					  slot->nr_slab_unreclaimable_b);
+			slot->nr_slab_unreclaimable_b = 0;
 		}
-		stock->cached_pgdat = pgdat;
+		slot->cached_pgdat = pgdat;
 	}
 
-	bytes = (idx == NR_SLAB_RECLAIMABLE_B) ? &stock->nr_slab_reclaimable_b
-					       : &stock->nr_slab_unreclaimable_b;
+	bytes = (idx == NR_SLAB_RECLAIMABLE_B) ? &slot->nr_slab_reclaimable_b
+					       : &slot->nr_slab_unreclaimable_b;
 	/*
 	 * Even for large object >= PAGE_SIZE, the vmstat data will still be
 	 * cached locally at least once before pushing it out.
@@ -2840,14 +3010,16 @@ static void mod_objcg_state(struct obj_cgroup *objcg, struct pglist_data *pgdat,
 static bool consume_obj_stock(struct obj_cgroup *objcg, unsigned int nr_bytes)
 {
 	struct memcg_stock_pcp *stock;
+	struct obj_stock_slot *slot;
 	unsigned long flags;
 	bool ret = false;
 
 	local_lock_irqsave(&memcg_stock.stock_lock, flags);
 
 	stock = this_cpu_ptr(&memcg_stock);
-	if (objcg == READ_ONCE(stock->cached_objcg) && stock->nr_bytes >= nr_bytes) {
-		stock->nr_bytes -= nr_bytes;
+	slot = find_obj_stock(stock, objcg);
+	if (slot && slot->nr_bytes >= nr_bytes) {
+		slot->nr_bytes -= nr_bytes;
 		ret = true;
 	}
 
@@ -2856,16 +3028,16 @@ static bool consume_obj_stock(struct obj_cgroup *objcg, unsigned int nr_bytes)
 	return ret;
 }
 
-static struct obj_cgroup *drain_obj_stock(struct memcg_stock_pcp *stock)
+static struct obj_cgroup *drain_obj_stock_slot(struct obj_stock_slot *slot)
 {
-	struct obj_cgroup *old = READ_ONCE(stock->cached_objcg);
+	struct obj_cgroup *old = READ_ONCE(slot->cached_objcg);
 
 	if (!old)
 		return NULL;
 
-	if (stock->nr_bytes) {
-		unsigned int nr_pages = stock->nr_bytes >> PAGE_SHIFT;
-		unsigned int nr_bytes = stock->nr_bytes & (PAGE_SIZE - 1);
+	if (slot->nr_bytes) {
+		unsigned int nr_pages = slot->nr_bytes >> PAGE_SHIFT;
+		unsigned int nr_bytes = slot->nr_bytes & (PAGE_SIZE - 1);
 
 		if (nr_pages) {
 			struct mem_cgroup *memcg;
@@ -2890,29 +3062,29 @@ static struct obj_cgroup *drain_obj_stock(struct memcg_stock_pcp *stock)
 		 * so it might be changed in the future.
 		 */
 		atomic_add(nr_bytes, &old->nr_charged_bytes);
-		stock->nr_bytes = 0;
+		slot->nr_bytes = 0;
 	}
 
 	/*
-	 * Flush the vmstat data in current stock
+	 * Flush the vmstat data in the slot
 	 */
-	if (stock->nr_slab_reclaimable_b || stock->nr_slab_unreclaimable_b) {
-		if (stock->nr_slab_reclaimable_b) {
-			__mod_objcg_mlstate(old, stock->cached_pgdat,
+	if (slot->nr_slab_reclaimable_b || slot->nr_slab_unreclaimable_b) {
+		if (slot->nr_slab_reclaimable_b) {
+			__mod_objcg_mlstate(old, slot->cached_pgdat,
 					  NR_SLAB_RECLAIMABLE_B,
-					  stock->nr_slab_reclaimable_b);
-			stock->nr_slab_reclaimable_b = 0;
+					  slot->nr_slab_reclaimable_b);
+			slot->nr_slab_reclaimable_b = 0;
 		}
-		if (stock->nr_slab_unreclaimable_b) {
-			__mod_objcg_mlstate(old, stock->cached_pgdat,
+		if (slot->nr_slab_unreclaimable_b) {
+			__mod_objcg_mlstate(old, slot->cached_pgdat,
 					  NR_SLAB_UNRECLAIMABLE_B,
-					  stock->nr_slab_unreclaimable_b);
-			stock->nr_slab_unreclaimable_b = 0;
+					  slot->nr_slab_unreclaimable_b);
+			slot->nr_slab_unreclaimable_b = 0;
 		}
-		stock->cached_pgdat = NULL;
+		slot->cached_pgdat = NULL;
 	}
 
-	WRITE_ONCE(stock->cached_objcg, NULL);
+	WRITE_ONCE(slot->cached_objcg, NULL);
 	/*
 	 * The `old' objects needs to be released by the caller via
 	 * obj_cgroup_put() outside of memcg_stock_pcp::stock_lock.
@@ -2920,13 +3092,27 @@ static struct obj_cgroup *drain_obj_stock(struct memcg_stock_pcp *stock)
 	return old;
 }
 
+/* Drain all the objcgs of the stock, and return them in @old. */
+static void drain_obj_stock(struct memcg_stock_pcp *stock,
+			    struct obj_cgroup **old)
+{
+	int i;
+
+	for (i = 0; i < NR_OBJ_STOCK; i++)
+		old[i] = drain_obj_stock_slot(&stock->obj[i]);
+}
+
 static bool obj_stock_flush_required(struct memcg_stock_pcp *stock,
 				     struct mem_cgroup *root_memcg)
 {
-	struct obj_cgroup *objcg = READ_ONCE(stock->cached_objcg);
 	struct mem_cgroup *memcg;
+	int i;
 
-	if (objcg) {
+	for (i = 0; i < NR_OBJ_STOCK; i++) {
+		struct obj_cgroup *objcg = READ_ONCE(stock->obj[i].cached_objcg);
+
+		if (!objcg)
+			continue;
 		memcg = obj_cgroup_memcg(objcg);
 		if (memcg && mem_cgroup_is_descendant(memcg, root_memcg))
 			return true;
@@ -2939,6 +3125,7 @@ static void refill_obj_stock(struct obj_cgroup *objcg, unsigned int nr_bytes,
 			     bool allow_uncharge)
 {
 	struct memcg_stock_pcp *stock;
+	struct obj_stock_slot *slot;
 	struct obj_cgroup *old = NULL;
 	unsigned long flags;
 	unsigned int nr_pages = 0;
@@ -2946,15 +3133,16 @@ static void refill_obj_stock(struct obj_cgroup *objcg, unsigned int nr_bytes,
 	local_lock_irqsave(&memcg_stock.stock_lock, flags);
 
 	stock = this_cpu_ptr(&memcg_stock);
-	if (READ_ONCE(stock->cached_objcg) != objcg) { /* reset if necessary */
-		old = replace_stock_objcg(stock, objcg);
+	slot = find_obj_stock(stock, objcg);
+	if (!slot) { /* evict the least recently used objcg if necessary */
+		slot = get_obj_stock(stock, objcg, &old);
 		allow_uncharge = true;	/* Allow uncharge when objcg changes */
 	}
-	stock->nr_bytes += nr_bytes;
+	slot->nr_bytes += nr_bytes;
 
-	if (allow_uncharge && (stock->nr_bytes > PAGE_SIZE)) {
-		nr_pages = stock->nr_bytes >> PAGE_SHIFT;
-		stock->nr_bytes &= (PAGE_SIZE - 1);
+	if (allow_uncharge && (slot->nr_bytes > PAGE_SIZE)) {
+		nr_pages = slot->nr_bytes >> PAGE_SHIFT;
+		slot->nr_bytes &= (PAGE_SIZE - 1);
 	}
 
 	local_unlock_irqrestore(&memcg_stock.stock_lock, flags);
@@ -4322,6 +4510,26 @@ int memory_stat_show(struct seq_file *m, void *v)
 	return 0;
 }
 
+/*
+ * memory.stat without the synchronous flush: the counters may miss the
+ * updates of the last two flush periods at most.
+ */
+static int memory_stat_approx_show(struct seq_file *m, void *v)
+{
+	struct mem_cgroup *memcg = mem_cgroup_from_seq(m);
+	char *buf = kmalloc(SEQ_BUF_SIZE, GFP_KERNEL);
+	struct seq_buf s;
+
+	if (!buf)
+		return -ENOMEM;
+	seq_buf_init(&s, buf, SEQ_BUF_SIZE);
+	mem_cgroup_flush_stats_ratelimited(memcg);
+	memcg_stat_format(memcg, &s);
+	seq_puts(m, buf);
+	kfree(buf);
+	return 0;
+}
+
 #ifdef CONFIG_NUMA
 static inline unsigned long lruvec_page_state_output(struct lruvec *lruvec,
 						     int item)
@@ -4360,6 +4568,45 @@ static int memory_numa_stat_show(struct seq_file *m, void *v)
 }
 #endif
 
+static const char *const memcg_stall_phase_names[MEMCG_NR_STALL_PHASES] = {
+	[MEMCG_STALL_RECLAIM]	= "reclaim",
+	[MEMCG_STALL_LRU]	= "lru",
+	[MEMCG_STALL_SHRINKER]	= "shrinker",
+	[MEMCG_STALL_THROTTLE]	= "throttle",
+	[MEMCG_STALL_COMPACT]	= "compact",
+};
+
+/*
+ * One line per phase: the total time in usec, then the number of stalls in
+ * each bucket, keyed by the bucket's upper bound in usec.
+ */
+static int memory_reclaim_stat_show(struct seq_file *m, void *v)
+{
+	struct mem_cgroup *memcg = mem_cgroup_from_seq(m);
+	int i, b;
+
+	for (i = 0; i < MEMCG_NR_STALL_PHASES; i++) {
+		seq_printf(m, "%s usec=%llu", memcg_stall_phase_names[i],
+			   div_u64(atomic64_read(&memcg->stall_time[i]),
+				   NSEC_PER_USEC));
+		for (b = 0; b < MEMCG_NR_STALL_BUCKETS - 1; b++)
+			seq_printf(m, " %lu=%lu", 16UL << (2 * b),
+				   atomic_long_read(&memcg->stall_hist[i][b]));
+		seq_printf(m, " inf=%lu\n",
+			   atomic_long_read(&memcg->stall_hist[i][b]));
+	}
+
+	return 0;
+}
+
+#ifdef CONFIG_LRU_GEN
+static int memory_working_set_show(struct seq_file *m, void *v)
+{
+	lru_gen_working_set_show(m, mem_cgroup_from_seq(m));
+	return 0;
+}
+#endif
+
 static int memory_oom_group_show(struct seq_file *m, void *v)
 {
 	struct mem_cgroup *memcg = mem_cgroup_from_seq(m);
@@ -4521,11 +4768,25 @@ static struct cftype memory_files[] = {
 		.name = "stat",
 		.seq_show = memory_stat_show,
 	},
+	{
+		.name = "stat.approx",
+		.seq_show = memory_stat_approx_show,
+	},
 #ifdef CONFIG_NUMA
 	{
 		.name = "numa_stat",
 		.seq_show = memory_numa_stat_show,
 	},
+#endif
+	{
+		.name = "reclaim_stat",
+		.seq_show = memory_reclaim_stat_show,
+	},
+#ifdef CONFIG_LRU_GEN
+	{
+		.name = "working_set",
+		.seq_show = memory_working_set_show,
+	},
 #endif
 	{
 		.name = "oom.group",
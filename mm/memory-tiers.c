@@ -67,8 +67,193 @@ bool folio_use_access_time(struct folio *folio)
 	return (sysctl_numa_balancing_mode & NUMA_BALANCING_MEMORY_TIERING) &&
 	       !node_is_toptier(folio_nid(folio));
 }
+
+/*
+ * Promotion state of each (source, target) node pair.  The row of a target
+ * node is indexed by the source node, and allocated once the target node
+ * gets memory.
+ */
+static struct memtier_promote_pair *promote_pairs[MAX_NUMNODES];
+
+/**
+ * memtier_promote_pair - get the promotion state of a node pair
+ * @src: node the pages are promoted from
+ * @dst: node the pages are promoted to
+ *
+ * Return: the promotion state, or NULL if it is not allocated
+ */
+struct memtier_promote_pair *memtier_promote_pair(int src, int dst)
+{
+	/* Pairs with smp_store_release() in memtier_alloc_promote_pairs() */
+	struct memtier_promote_pair *row = smp_load_acquire(&promote_pairs[dst]);
+
+	return row ? &row[src] : NULL;
+}
+
+void memtier_count_promoted(int src, int dst, unsigned long nr)
+{
+	struct memtier_promote_pair *pair = memtier_promote_pair(src, dst);
+
+	if (pair)
+		atomic_long_add(nr, &pair->nr_promoted);
+}
+
+void memtier_reset_promote_pairs(void)
+{
+	struct memtier_promote_pair *pair;
+	int src, dst;
+
+	for_each_node_state(dst, N_MEMORY) {
+		for_each_node_state(src, N_MEMORY) {
+			pair = memtier_promote_pair(src, dst);
+			if (!pair)
+				continue;
+			pair->ctl.threshold = 0;
+			pair->ctl.th_nr_cand = atomic_long_read(&pair->nr_cand);
+			pair->ctl.th_start = jiffies_to_msecs(jiffies);
+		}
+	}
+}
+
+static void memtier_alloc_promote_pairs(int node)
+{
+	struct memtier_promote_pair *row;
+
+	lockdep_assert_held_once(&memory_tier_lock);
+
+	if (promote_pairs[node])
+		return;
+
+	/* Without the row, only the limits of the target node apply */
+	row = kcalloc(nr_node_ids, sizeof(*row), GFP_KERNEL);
+	if (row)
+		smp_store_release(&promote_pairs[node], row);
+}
+
+static ssize_t promote_rate_limit_MBps_show(struct device *dev,
+					    struct device_attribute *attr,
+					    char *buf)
+{
+	struct memtier_promote_pair *pair;
+	unsigned int rate_limit;
+	int src, dst, len = 0;
+
+	for_each_node_state(dst, N_MEMORY) {
+		for_each_node_state(src, N_MEMORY) {
+			pair = memtier_promote_pair(src, dst);
+			rate_limit = pair ? READ_ONCE(pair->rate_limit) : 0;
+			if (rate_limit)
+				len += sysfs_emit_at(buf, len, "%d %d %u\n",
+						     src, dst, rate_limit);
+		}
+	}
+
+	return len;
+}
+
+/* "<source node> <target node> <MB/s>", 0 MB/s to use the sysctl again */
+static ssize_t promote_rate_limit_MBps_store(struct device *dev,
+					     struct device_attribute *attr,
+					     const char *buf, size_t count)
+{
+	struct memtier_promote_pair *pair;
+	unsigned int rate_limit;
+	int src, dst;
+
+	if (sscanf(buf, "%d %d %u", &src, &dst, &rate_limit) != 3)
+		return -EINVAL;
+	if (src < 0 || src >= nr_node_ids || dst < 0 || dst >= nr_node_ids ||
+	    src == dst)
+		return -EINVAL;
+
+	pair = memtier_promote_pair(src, dst);
+	if (!pair)
+		return -ENODEV;
+
+	WRITE_ONCE(pair->rate_limit, rate_limit);
+	return count;
+}
+
+static DEVICE_ATTR_RW(promote_rate_limit_MBps);
+
+/* "<source node> <target node> <candidates> <promoted> <threshold in ms>" */
+static ssize_t promote_stat_show(struct device *dev,
+				 struct device_attribute *attr, char *buf)
+{
+	struct memtier_promote_pair *pair;
+	unsigned long nr_cand;
+	int src, dst, len = 0;
+
+	for_each_node_state(dst, N_MEMORY) {
+		for_each_node_state(src, N_MEMORY) {
+			pair = memtier_promote_pair(src, dst);
+			if (!pair)
+				continue;
+			nr_cand = atomic_long_read(&pair->nr_cand);
+			if (!nr_cand)
+				continue;
+			len += sysfs_emit_at(buf, len, "%d %d %lu %lu %u\n",
+					     src, dst, nr_cand,
+					     atomic_long_read(&pair->nr_promoted),
+					     READ_ONCE(pair->ctl.threshold));
+		}
+	}
+
+	return len;
+}
+
+static DEVICE_ATTR_RO(promote_stat);
+#else
+static inline void memtier_alloc_promote_pairs(int node)
+{
+}
 #endif
 
+/* "<node> <promoted> <demoted>" */
+static ssize_t node_stat_show(struct device *dev,
+			      struct device_attribute *attr, char *buf)
+{
+	unsigned long promoted, demoted;
+	pg_data_t *pgdat;
+	int nid, len = 0;
+
+	for_each_node_state(nid, N_MEMORY) {
+		pgdat = NODE_DATA(nid);
+		promoted = 0;
+#ifdef CONFIG_NUMA_BALANCING
+		promoted = node_page_state(pgdat, PGPROMOTE_SUCCESS);
+#endif
+		demoted = node_page_state(pgdat, PGDEMOTE_KSWAPD) +
+			  node_page_state(pgdat, PGDEMOTE_DIRECT) +
+			  node_page_state(pgdat, PGDEMOTE_KHUGEPAGED) +
+			  node_page_state(pgdat, PGDEMOTE_PROACTIVE);
+		len += sysfs_emit_at(buf, len, "%d %lu %lu\n",
+				     nid, promoted, demoted);
+	}
+
+	return len;
+}
+
+static DEVICE_ATTR_RO(node_stat);
+
+static struct attribute *memtier_subsys_attrs[] = {
+#ifdef CONFIG_NUMA_BALANCING
+	&dev_attr_promote_rate_limit_MBps.attr,
+	&dev_attr_promote_stat.attr,
+#endif
+	&dev_attr_node_stat.attr,
+	NULL
+};
+
+static const struct attribute_group memtier_subsys_group = {
+	.attrs = memtier_subsys_attrs,
+};
+
+static const struct attribute_group *memtier_subsys_groups[] = {
+	&memtier_subsys_group,
+	NULL,
+};
+
 #ifdef CONFIG_MIGRATION
 static int top_tier_adistance;
 /*
@@ -552,6 +737,7 @@ static struct memory_tier *set_node_memory_tier(int node)
 	}
 
 	__init_node_memory_type(node, memtype);
+	memtier_alloc_promote_pairs(node);
 
 	memtype = node_memory_types[node].memtype;
 	node_set(node, memtype->nodes);
@@ -904,7 +1090,7 @@ static int __init memory_tier_init(void)
 {
 	int ret;
 
-	ret = subsys_virtual_register(&memory_tier_subsys, NULL);
+	ret = subsys_virtual_register(&memory_tier_subsys, memtier_subsys_groups);
 	if (ret)
 		panic("%s() failed to register memory tier subsystem\n", __func__);
 
@@ -50,6 +50,7 @@
 #include <linux/swap.h>
 #include <linux/highmem.h>
 #include <linux/pagemap.h>
+#include <linux/khugepaged.h>
 #include <linux/memremap.h>
 #include <linux/kmsan.h>
 #include <linux/ksm.h>
@@ -1990,35 +1991,65 @@ void unmap_vmas(struct mmu_gather *tlb, struct ma_state *mas,
 }
 
 /**
- * zap_page_range_single - remove user pages in a given range
+ * zap_page_range_single_batched - remove user pages in a given range
+ * @tlb: pointer to the caller's struct mmu_gather
  * @vma: vm_area_struct holding the applicable pages
  * @address: starting address of pages to zap
  * @size: number of bytes to zap
  * @details: details of shared cache invalidation
  *
- * The range must fit into one VMA.
+ * Like zap_page_range_single(), but the TLB flush and the freeing of the
+ * pages are left to the caller's tlb_finish_mmu(), so that several ranges
+ * can share them. The range must fit into one VMA.
  */
-void zap_page_range_single(struct vm_area_struct *vma, unsigned long address,
+void zap_page_range_single_batched(struct mmu_gather *tlb,
+		struct vm_area_struct *vma, unsigned long address,
 		unsigned long size, struct zap_details *details)
 {
 	const unsigned long end = address + size;
 	struct mmu_notifier_range range;
-	struct mmu_gather tlb;
+
+	VM_WARN_ON_ONCE(tlb->mm != vma->vm_mm);
 
 	mmu_notifier_range_init(&range, MMU_NOTIFY_CLEAR, 0, vma->vm_mm,
 				address, end);
 	hugetlb_zap_begin(vma, &range.start, &range.end);
-	tlb_gather_mmu(&tlb, vma->vm_mm);
 	update_hiwater_rss(vma->vm_mm);
 	mmu_notifier_invalidate_range_start(&range);
 	/*
 	 * unmap 'address-end' not 'range.start-range.end' as range
 	 * could have been expanded for hugetlb pmd sharing.
 	 */
-	unmap_single_vma(&tlb, vma, address, end, details, false);
+	unmap_single_vma(tlb, vma, address, end, details, false);
 	mmu_notifier_invalidate_range_end(&range);
+	if (is_vm_hugetlb_page(vma)) {
+		/*
+		 * flush tlb and free resources before hugetlb_zap_end(), to
+		 * avoid concurrent page faults' allocation failure.
+		 */
+		tlb_finish_mmu(tlb);
+		hugetlb_zap_end(vma, details);
+		tlb_gather_mmu(tlb, vma->vm_mm);
+	}
+}
+
+/**
+ * zap_page_range_single - remove user pages in a given range
+ * @vma: vm_area_struct holding the applicable pages
+ * @address: starting address of pages to zap
+ * @size: number of bytes to zap
+ * @details: details of shared cache invalidation
+ *
+ * The range must fit into one VMA.
+ */
+void zap_page_range_single(struct vm_area_struct *vma, unsigned long address,
+		unsigned long size, struct zap_details *details)
+{
+	struct mmu_gather tlb;
+
+	tlb_gather_mmu(&tlb, vma->vm_mm);
+	zap_page_range_single_batched(&tlb, vma, address, size, details);
 	tlb_finish_mmu(&tlb);
-	hugetlb_zap_end(vma, details);
 }
 
 /**
@@ -4281,10 +4312,14 @@ static inline unsigned long thp_swap_suitable_orders(pgoff_t swp_offset,
 	return orders;
 }
 
-static struct folio *alloc_swap_folio(struct vm_fault *vmf)
+/*
+ * Allocate a large folio of one of @orders to read the whole aligned range of
+ * swap entries of the fault into, or return NULL if none fits.
+ */
+static struct folio *alloc_large_swap_folio(struct vm_fault *vmf,
+					    unsigned long orders)
 {
 	struct vm_area_struct *vma = vmf->vma;
-	unsigned long orders;
 	struct folio *folio;
 	unsigned long addr;
 	swp_entry_t entry;
@@ -4298,7 +4333,7 @@ static struct folio *alloc_swap_folio(struct vm_fault *vmf)
 	 * maintain the uffd semantics.
 	 */
 	if (unlikely(userfaultfd_armed(vma)))
-		goto fallback;
+		return NULL;
 
 	/*
 	 * A large swapped out folio could be partially or fully in zswap. We
@@ -4306,7 +4341,7 @@ static struct folio *alloc_swap_folio(struct vm_fault *vmf)
 	 * folio.
 	 */
 	if (!zswap_never_enabled())
-		goto fallback;
+		return NULL;
 
 	entry = pte_to_swp_entry(vmf->orig_pte);
 	/*
@@ -4314,18 +4349,19 @@ static struct folio *alloc_swap_folio(struct vm_fault *vmf)
 	 * and suitable for swapping THP.
 	 */
 	orders = thp_vma_allowable_orders(vma, vma->vm_flags,
-			TVA_IN_PF | TVA_ENFORCE_SYSFS, BIT(PMD_ORDER) - 1);
+			TVA_IN_PF | TVA_ENFORCE_SYSFS,
+			orders & (BIT(PMD_ORDER) - 1));
 	orders = thp_vma_suitable_orders(vma, vmf->address, orders);
 	orders = thp_swap_suitable_orders(swp_offset(entry),
 					  vmf->address, orders);
 
 	if (!orders)
-		goto fallback;
+		return NULL;
 
 	pte = pte_offset_map_lock(vmf->vma->vm_mm, vmf->pmd,
 				  vmf->address & PMD_MASK, &ptl);
 	if (unlikely(!pte))
-		goto fallback;
+		return NULL;
 
 	/*
 	 * For do_swap_page, find the highest order where the aligned range is
@@ -4357,15 +4393,42 @@ static struct folio *alloc_swap_folio(struct vm_fault *vmf)
 		order = next_order(&orders, order);
 	}
 
-fallback:
-	return __alloc_swap_folio(vmf);
+	return NULL;
+}
+
+/*
+ * Orders that are swapped in whole with a single read bypassing the swap
+ * cache even though @si is not synchronous. Only block devices are allowed,
+ * as a swap file is only contiguous on disk within its extents.
+ */
+static unsigned long swapin_direct_orders(struct swap_info_struct *si)
+{
+	if (!(si->flags & SWP_BLKDEV))
+		return 0;
+	return READ_ONCE(huge_anon_orders_swapin);
 }
 #else /* !CONFIG_TRANSPARENT_HUGEPAGE */
+static struct folio *alloc_large_swap_folio(struct vm_fault *vmf,
+					    unsigned long orders)
+{
+	return NULL;
+}
+
+static unsigned long swapin_direct_orders(struct swap_info_struct *si)
+{
+	return 0;
+}
+#endif /* CONFIG_TRANSPARENT_HUGEPAGE */
+
 static struct folio *alloc_swap_folio(struct vm_fault *vmf)
 {
+	struct folio *folio;
+
+	folio = alloc_large_swap_folio(vmf, BIT(PMD_ORDER) - 1);
+	if (folio)
+		return folio;
 	return __alloc_swap_folio(vmf);
 }
-#endif /* CONFIG_TRANSPARENT_HUGEPAGE */
 
 static DECLARE_WAIT_QUEUE_HEAD(swapcache_wq);
 
@@ -4464,10 +4527,21 @@ vm_fault_t do_swap_page(struct vm_fault *vmf)
 	swapcache = folio;
 
 	if (!folio) {
-		if (data_race(si->flags & SWP_SYNCHRONOUS_IO) &&
-		    __swap_count(entry) == 1) {
-			/* skip swapcache */
-			folio = alloc_swap_folio(vmf);
+		bool skip_swapcache = false;
+
+		if (__swap_count(entry) == 1) {
+			if (data_race(si->flags & SWP_SYNCHRONOUS_IO)) {
+				folio = alloc_swap_folio(vmf);
+				skip_swapcache = true;
+			} else {
+				/* Only if the whole large folio can be read */
+				folio = alloc_large_swap_folio(vmf,
+						swapin_direct_orders(si));
+				skip_swapcache = !!folio;
+			}
+		}
+
+		if (skip_swapcache) {
 			if (folio) {
 				__folio_set_locked(folio);
 				__folio_set_swapbacked(folio);
@@ -4507,6 +4581,11 @@ vm_fault_t do_swap_page(struct vm_fault *vmf)
 				folio->swap = entry;
 				swap_read_folio(folio, NULL);
 				folio->private = NULL;
+				/*
+				 * The folio is not in the swap cache, so its
+				 * read must not be abandoned by a fault retry.
+				 */
+				folio_wait_locked(folio);
 			}
 		} else {
 			folio = swapin_readahead(entry, GFP_HIGHUSER_MOVABLE,
@@ -4601,7 +4680,7 @@ vm_fault_t do_swap_page(struct vm_fault *vmf)
 		goto out_nomap;
 	}
 
-	/* allocated large folios for SWP_SYNCHRONOUS_IO */
+	/* allocated large folios that skipped the swap cache */
 	if (folio_test_large(folio) && !folio_test_swapcache(folio)) {
 		unsigned long nr = folio_nr_pages(folio);
 		unsigned long folio_start = ALIGN_DOWN(vmf->address, nr * PAGE_SIZE);
@@ -5804,7 +5883,7 @@ static vm_fault_t do_numa_page(struct vm_fault *vmf)
 	if (!migrate_misplaced_folio(folio, target_nid)) {
 		nid = target_nid;
 		flags |= TNF_MIGRATED;
-		task_numa_fault(last_cpupid, nid, nr_pages, flags);
+		task_numa_fault(vma, last_cpupid, nid, nr_pages, flags);
 		return 0;
 	}
 
@@ -5831,7 +5910,7 @@ static vm_fault_t do_numa_page(struct vm_fault *vmf)
 	pte_unmap_unlock(vmf->pte, vmf->ptl);
 
 	if (nid != NUMA_NO_NODE)
-		task_numa_fault(last_cpupid, nid, nr_pages, flags);
+		task_numa_fault(vma, last_cpupid, nid, nr_pages, flags);
 	return 0;
 }
 
@@ -6091,6 +6170,7 @@ static vm_fault_t __handle_mm_fault(struct vm_area_struct *vma,
 		ret = create_huge_pmd(&vmf);
 		if (!(ret & VM_FAULT_FALLBACK))
 			return ret;
+		khugepaged_fault_fallback(vma, address);
 	} else {
 		vmf.orig_pmd = pmdp_get_lockless(vmf.pmd);
 
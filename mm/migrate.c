@@ -2709,6 +2709,7 @@ int migrate_misplaced_folio_prepare(struct folio *folio,
 int migrate_misplaced_folio(struct folio *folio, int node)
 {
 	pg_data_t *pgdat = NODE_DATA(node);
+	int src_nid = folio_nid(folio);
 	int nr_remaining;
 	unsigned int nr_succeeded;
 	LIST_HEAD(migratepages);
@@ -2725,9 +2726,11 @@ int migrate_misplaced_folio(struct folio *folio, int node)
 		count_vm_numa_events(NUMA_PAGE_MIGRATE, nr_succeeded);
 		count_memcg_events(memcg, NUMA_PAGE_MIGRATE, nr_succeeded);
 		if ((sysctl_numa_balancing_mode & NUMA_BALANCING_MEMORY_TIERING)
-		    && !node_is_toptier(folio_nid(folio))
-		    && node_is_toptier(node))
+		    && !node_is_toptier(src_nid)
+		    && node_is_toptier(node)) {
 			mod_lruvec_state(lruvec, PGPROMOTE_SUCCESS, nr_succeeded);
+			memtier_count_promoted(src_nid, node, nr_succeeded);
+		}
 	}
 	mem_cgroup_put(memcg);
 	BUG_ON(!list_empty(&migratepages));
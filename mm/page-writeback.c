@@ -96,6 +96,12 @@ static int vm_dirty_ratio = 20;
  */
 static unsigned long vm_dirty_bytes;
 
+/*
+ * Number of KB a task may dirty per second without being throttled, as long
+ * as the dirty limits are not exceeded.  0 disables the budget.
+ */
+static unsigned int vm_dirty_task_budget_kb;
+
 /*
  * The interval between `kupdate'-style writebacks
  */
@@ -1801,6 +1807,47 @@ static void balance_wb_limits(struct dirty_throttle_control *dtc,
 	wb_position_ratio(dtc);
 }
 
+/*
+ * Light dirtiers, e.g. an editor saving a file during a large copy, should
+ * not be paused along with the bulk writers that push the dirty pages over
+ * the setpoint.  Let a task dirty up to vm_dirty_task_budget_kb per second
+ * without pausing while below the dirty limit; the bulk writers are then
+ * throttled by the same wb ratelimit and absorb the difference.
+ */
+static bool dirty_task_budget_charge(unsigned long pages_dirtied,
+				     unsigned long now)
+{
+	unsigned long budget;
+
+	budget = READ_ONCE(vm_dirty_task_budget_kb) >> (PAGE_SHIFT - 10);
+	if (!budget)
+		return false;
+
+	if (time_after(now, current->dirty_budget_when + HZ)) {
+		current->dirty_budget_when = now;
+		current->nr_dirtied_budget = 0;
+	}
+	if (current->nr_dirtied_budget + pages_dirtied > budget)
+		return false;
+
+	current->nr_dirtied_budget += pages_dirtied;
+	return true;
+}
+
+static void dirty_throttle_count_pause(long pause)
+{
+	unsigned int msecs = jiffies_to_msecs(pause);
+
+	if (msecs <= 10)
+		count_vm_event(DIRTY_THROTTLE_10MS);
+	else if (msecs <= 50)
+		count_vm_event(DIRTY_THROTTLE_50MS);
+	else if (msecs <= 100)
+		count_vm_event(DIRTY_THROTTLE_100MS);
+	else
+		count_vm_event(DIRTY_THROTTLE_SLOW);
+}
+
 /*
  * balance_dirty_pages() must be called by processes which are generating dirty
  * data.  It looks at the number of dirty pages in the machine and will force
@@ -1912,6 +1959,14 @@ static int balance_dirty_pages(struct bdi_writeback *wb,
 					   BANDWIDTH_INTERVAL))
 			__wb_update_bandwidth(gdtc, mdtc, true);
 
+		if (!wb->dirty_exceeded &&
+		    dirty_task_budget_charge(pages_dirtied, now)) {
+			count_vm_event(DIRTY_THROTTLE_BUDGET_SKIP);
+			current->dirty_paused_when = now;
+			current->nr_dirtied = 0;
+			break;
+		}
+
 		/* throttle according to the chosen dtc */
 		dirty_ratelimit = READ_ONCE(wb->dirty_ratelimit);
 		task_ratelimit = ((u64)dirty_ratelimit * sdtc->pos_ratio) >>
@@ -1978,6 +2033,7 @@ static int balance_dirty_pages(struct bdi_writeback *wb,
 		__set_current_state(TASK_KILLABLE);
 		bdi->last_bdp_sleep = jiffies;
 		io_schedule_timeout(pause);
+		dirty_throttle_count_pause(pause);
 
 		current->dirty_paused_when = now + pause;
 		current->nr_dirtied = 0;
@@ -2302,6 +2358,13 @@ static const struct ctl_table vm_page_writeback_sysctls[] = {
 		.proc_handler   = dirty_bytes_handler,
 		.extra1     = (void *)&dirty_bytes_min,
 	},
+	{
+		.procname	= "dirty_task_budget_kbytes",
+		.data		= &vm_dirty_task_budget_kb,
+		.maxlen		= sizeof(vm_dirty_task_budget_kb),
+		.mode		= 0644,
+		.proc_handler	= proc_douintvec,
+	},
 	{
 		.procname   = "dirty_writeback_centisecs",
 		.data       = &dirty_writeback_interval,
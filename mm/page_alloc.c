@@ -513,17 +513,115 @@ static void bad_page(struct page *page, const char *reason)
 	add_taint(TAINT_BAD_PAGE, LOCKDEP_NOW_UNRELIABLE);
 }
 
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE
+/*
+ * mTHP orders that are cached on the pcp lists next to HPAGE_PMD_ORDER. They
+ * are selected with pcp_mthp_orders= and fixed at boot, so that the order of
+ * the pages on a given pcp list never changes.
+ */
+u8 pcp_mthp_orders[NR_PCP_MTHP_ORDERS] __ro_after_init;
+static unsigned long pcp_mthp_mask __ro_after_init;
+
+static int __init pcp_mthp_orders_setup(char *str)
+{
+	u8 orders[NR_PCP_MTHP_ORDERS] = { };
+	unsigned long mask = 0;
+	unsigned int order;
+	int nr = 0;
+	char *p;
+
+	while ((p = strsep(&str, ",")) != NULL) {
+		if (kstrtouint(p, 0, &order) ||
+		    order <= PAGE_ALLOC_COSTLY_ORDER || order > MAX_PAGE_ORDER)
+			return -EINVAL;
+		/* Always cached, it has a pcp list of its own */
+		if (order == HPAGE_PMD_ORDER)
+			return -EINVAL;
+		if (mask & BIT(order))
+			continue;
+		if (nr == NR_PCP_MTHP_ORDERS)
+			return -EINVAL;
+		orders[nr++] = order;
+		mask |= BIT(order);
+	}
+
+	memcpy(pcp_mthp_orders, orders, sizeof(orders));
+	pcp_mthp_mask = mask;
+	return 0;
+}
+early_param("pcp_mthp_orders", pcp_mthp_orders_setup);
+
+/*
+ * The high-order pcp lists come in pairs, the first one for THP and then one
+ * per mTHP order. Returns the mthp_* slot of @pindex, or -1 if it is not the
+ * list of an mTHP order.
+ */
+static inline int pcp_mthp_slot(unsigned int pindex)
+{
+	if (pindex < NR_LOWORDER_PCP_LISTS + 2)
+		return -1;
+	return (pindex - NR_LOWORDER_PCP_LISTS) / 2 - 1;
+}
+
+static inline void pcp_mthp_mod_count(struct per_cpu_pages *pcp, int slot,
+				      int nr_pages)
+{
+	if (slot >= 0)
+		pcp->mthp_count[slot] += nr_pages;
+}
+
+/* Count THP and mTHP allocations that found, or missed, a cached page. */
+static inline void pcp_huge_count_alloc(struct per_cpu_pages *pcp,
+					unsigned int order, unsigned int pindex,
+					bool miss)
+{
+	int h;
+
+	if (order <= PAGE_ALLOC_COSTLY_ORDER)
+		return;
+
+	h = (pindex - NR_LOWORDER_PCP_LISTS) / 2;
+	if (miss)
+		pcp->huge_miss[h]++;
+	else
+		pcp->huge_hit[h]++;
+}
+#else
+static inline int pcp_mthp_slot(unsigned int pindex)
+{
+	return -1;
+}
+
+static inline void pcp_mthp_mod_count(struct per_cpu_pages *pcp, int slot,
+				      int nr_pages)
+{
+}
+
+static inline void pcp_huge_count_alloc(struct per_cpu_pages *pcp,
+					unsigned int order, unsigned int pindex,
+					bool miss)
+{
+}
+#endif
+
 static inline unsigned int order_to_pindex(int migratetype, int order)
 {
 
 #ifdef CONFIG_TRANSPARENT_HUGEPAGE
 	bool movable;
 	if (order > PAGE_ALLOC_COSTLY_ORDER) {
-		VM_BUG_ON(order != HPAGE_PMD_ORDER);
+		int h = 0;
+
+		if (order != HPAGE_PMD_ORDER) {
+			for (h = 1; h < NR_PCP_HUGE_ORDERS; h++)
+				if (pcp_mthp_orders[h - 1] == order)
+					break;
+			VM_BUG_ON(h == NR_PCP_HUGE_ORDERS);
+		}
 
 		movable = migratetype == MIGRATE_MOVABLE;
 
-		return NR_LOWORDER_PCP_LISTS + movable;
+		return NR_LOWORDER_PCP_LISTS + 2 * h + movable;
 	}
 #else
 	VM_BUG_ON(order > PAGE_ALLOC_COSTLY_ORDER);
@@ -537,8 +635,11 @@ static inline int pindex_to_order(unsigned int pindex)
 	int order = pindex / MIGRATE_PCPTYPES;
 
 #ifdef CONFIG_TRANSPARENT_HUGEPAGE
-	if (pindex >= NR_LOWORDER_PCP_LISTS)
-		order = HPAGE_PMD_ORDER;
+	if (pindex >= NR_LOWORDER_PCP_LISTS) {
+		int h = (pindex - NR_LOWORDER_PCP_LISTS) / 2;
+
+		order = h ? pcp_mthp_orders[h - 1] : HPAGE_PMD_ORDER;
+	}
 #else
 	VM_BUG_ON(order > PAGE_ALLOC_COSTLY_ORDER);
 #endif
@@ -553,6 +654,8 @@ static inline bool pcp_allowed_order(unsigned int order)
 #ifdef CONFIG_TRANSPARENT_HUGEPAGE
 	if (order == HPAGE_PMD_ORDER)
 		return true;
+	if (pcp_mthp_mask & BIT(order))
+		return true;
 #endif
 	return false;
 }
@@ -1296,6 +1399,27 @@ __always_inline bool free_pages_prepare(struct page *page,
 	return true;
 }
 
+/*
+ * PCP refills and drains move up to batch << CONFIG_PCP_BATCH_SCALE_MAX pages
+ * in one zone->lock section. Every ZONE_LOCK_BATCH buddy operations, let the
+ * CPUs spinning on the lock in so that a fault does not wait for a whole
+ * drain of another CPU's pcp.
+ */
+#define ZONE_LOCK_BATCH		32
+
+static inline void zone_lock_break(struct zone *zone, unsigned long *flags,
+				   int *batched)
+{
+	if (++*batched < ZONE_LOCK_BATCH)
+		return;
+
+	*batched = 0;
+	if (spin_is_contended(&zone->lock)) {
+		spin_unlock_irqrestore(&zone->lock, *flags);
+		spin_lock_irqsave(&zone->lock, *flags);
+	}
+}
+
 /*
  * Frees a number of pages from the PCP lists
  * Assumes all pages on list are in same zone.
@@ -1308,6 +1432,8 @@ static void free_pcppages_bulk(struct zone *zone, int count,
 	unsigned long flags;
 	unsigned int order;
 	struct page *page;
+	int batched = 0;
+	int slot;
 
 	/*
 	 * Ensure proper count is passed which otherwise would stuck in the
@@ -1333,6 +1459,7 @@ static void free_pcppages_bulk(struct zone *zone, int count,
 
 		order = pindex_to_order(pindex);
 		nr_pages = 1 << order;
+		slot = pcp_mthp_slot(pindex);
 		do {
 			unsigned long pfn;
 			int mt;
@@ -1345,9 +1472,12 @@ static void free_pcppages_bulk(struct zone *zone, int count,
 			list_del(&page->pcp_list);
 			count -= nr_pages;
 			pcp->count -= nr_pages;
+			pcp_mthp_mod_count(pcp, slot, -nr_pages);
 
 			__free_one_page(page, pfn, zone, order, mt, FPI_NONE);
 			trace_mm_page_pcpu_drain(page, order, mt);
+			if (count > 0)
+				zone_lock_break(zone, &flags, &batched);
 		} while (count > 0 && !list_empty(list));
 	}
 
@@ -2350,6 +2480,7 @@ static int rmqueue_bulk(struct zone *zone, unsigned int order,
 {
 	enum rmqueue_mode rmqm = RMQUEUE_NORMAL;
 	unsigned long flags;
+	int batched = 0;
 	int i;
 
 	if (unlikely(alloc_flags & ALLOC_TRYLOCK)) {
@@ -2375,6 +2506,10 @@ static int rmqueue_bulk(struct zone *zone, unsigned int order,
 		 * pages are ordered properly.
 		 */
 		list_add_tail(&page->pcp_list, list);
+
+		/* Don't spin for the lock again on the trylock path. */
+		if (!(alloc_flags & ALLOC_TRYLOCK))
+			zone_lock_break(zone, &flags, &batched);
 	}
 	spin_unlock_irqrestore(&zone->lock, flags);
 
@@ -2643,6 +2778,72 @@ static int nr_pcp_high(struct per_cpu_pages *pcp, struct zone *zone,
 	return high;
 }
 
+/*
+ * Each mTHP order keeps its own high watermark within pcp->count, so that a
+ * burst of large folio frees does not push the order-0 pages out of the pcp
+ * or get drained in favour of them. It grows by a refill batch whenever an
+ * allocation misses the lists, and shrinks by a folio on every free while the
+ * zone is under pressure. It is bounded by a fraction of pcp->high_max, which
+ * also keeps the boot pagesets from caching anything.
+ */
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE
+#define PCP_MTHP_HIGH_SHIFT	2
+
+static int pcp_mthp_high_max(struct per_cpu_pages *pcp)
+{
+	return READ_ONCE(pcp->high_max) >> PCP_MTHP_HIGH_SHIFT;
+}
+
+static int nr_pcp_mthp_high(struct per_cpu_pages *pcp, struct zone *zone,
+			    int slot, unsigned int order)
+{
+	int high = min(pcp->mthp_high[slot], pcp_mthp_high_max(pcp));
+
+	if (test_bit(ZONE_RECLAIM_ACTIVE, &zone->flags) ||
+	    test_bit(ZONE_BELOW_HIGH, &zone->flags))
+		high = max(high - (1 << order), 0);
+
+	pcp->mthp_high[slot] = high;
+	return high;
+}
+
+static void pcp_mthp_grow_high(struct per_cpu_pages *pcp, struct zone *zone,
+			       int slot, unsigned int order, int batch)
+{
+	if (slot < 0 || test_bit(ZONE_BELOW_HIGH, &zone->flags))
+		return;
+
+	pcp->mthp_high[slot] = min(pcp->mthp_high[slot] + (batch << order),
+				   pcp_mthp_high_max(pcp));
+}
+
+static void free_pcp_mthp(struct zone *zone, struct per_cpu_pages *pcp,
+			  int pindex, unsigned int order)
+{
+	int slot = pcp_mthp_slot(pindex);
+	int high;
+
+	if (slot < 0)
+		return;
+
+	high = nr_pcp_mthp_high(pcp, zone, slot, order);
+	if (pcp->mthp_count[slot] > high)
+		free_pcppages_bulk(zone, pcp->mthp_count[slot] - high, pcp,
+				   pindex);
+}
+#else
+static inline void pcp_mthp_grow_high(struct per_cpu_pages *pcp,
+				      struct zone *zone, int slot,
+				      unsigned int order, int batch)
+{
+}
+
+static inline void free_pcp_mthp(struct zone *zone, struct per_cpu_pages *pcp,
+				 int pindex, unsigned int order)
+{
+}
+#endif
+
 static void free_frozen_page_commit(struct zone *zone,
 		struct per_cpu_pages *pcp, struct page *page, int migratetype,
 		unsigned int order, fpi_t fpi_flags)
@@ -2661,6 +2862,7 @@ static void free_frozen_page_commit(struct zone *zone,
 	pindex = order_to_pindex(migratetype, order);
 	list_add(&page->pcp_list, &pcp->lists[pindex]);
 	pcp->count += 1 << order;
+	pcp_mthp_mod_count(pcp, pcp_mthp_slot(pindex), 1 << order);
 
 	batch = READ_ONCE(pcp->batch);
 	/*
@@ -2688,6 +2890,7 @@ static void free_frozen_page_commit(struct zone *zone,
 		 */
 		return;
 	}
+	free_pcp_mthp(zone, pcp, pindex, order);
 	high = nr_pcp_high(pcp, zone, batch, free_high);
 	if (pcp->count >= high) {
 		free_pcppages_bulk(zone, nr_pcp_free(pcp, batch, high, free_high),
@@ -3071,17 +3274,23 @@ struct page *__rmqueue_pcplist(struct zone *zone, unsigned int order,
 			struct list_head *list)
 {
 	struct page *page;
+	int slot = -1;
+
+	if (order > PAGE_ALLOC_COSTLY_ORDER)
+		slot = pcp_mthp_slot(list - pcp->lists);
 
 	do {
 		if (list_empty(list)) {
 			int batch = nr_pcp_alloc(pcp, zone, order);
 			int alloced;
 
+			pcp_mthp_grow_high(pcp, zone, slot, order, batch);
 			alloced = rmqueue_bulk(zone, order,
 					batch, list,
 					migratetype, alloc_flags);
 
 			pcp->count += alloced << order;
+			pcp_mthp_mod_count(pcp, slot, alloced << order);
 			if (unlikely(list_empty(list)))
 				return NULL;
 		}
@@ -3089,6 +3298,7 @@ struct page *__rmqueue_pcplist(struct zone *zone, unsigned int order,
 		page = list_first_entry(list, struct page, pcp_list);
 		list_del(&page->pcp_list);
 		pcp->count -= 1 << order;
+		pcp_mthp_mod_count(pcp, slot, -(1 << order));
 	} while (check_new_pages(page, order));
 
 	return page;
@@ -3103,6 +3313,7 @@ static struct page *rmqueue_pcplist(struct zone *preferred_zone,
 	struct list_head *list;
 	struct page *page;
 	unsigned long __maybe_unused UP_flags;
+	unsigned int pindex;
 
 	/* spin_trylock may fail due to a parallel drain or IRQ reentrancy. */
 	pcp_trylock_prepare(UP_flags);
@@ -3118,7 +3329,9 @@ static struct page *rmqueue_pcplist(struct zone *preferred_zone,
 	 * frees.
 	 */
 	pcp->free_count >>= 1;
-	list = &pcp->lists[order_to_pindex(migratetype, order)];
+	pindex = order_to_pindex(migratetype, order);
+	list = &pcp->lists[pindex];
+	pcp_huge_count_alloc(pcp, order, pindex, list_empty(list));
 	page = __rmqueue_pcplist(zone, order, migratetype, alloc_flags, pcp, list);
 	pcp_spin_unlock(pcp);
 	pcp_trylock_finish(UP_flags);
@@ -3879,6 +4092,8 @@ __alloc_pages_direct_compact(gfp_t gfp_mask, unsigned int order,
 	struct page *page = NULL;
 	unsigned long pflags;
 	unsigned int noreclaim_flag;
+	u64 stall_ns[MEMCG_NR_STALL_PHASES] = {};
+	u64 start;
 
 	if (!order)
 		return NULL;
@@ -3886,10 +4101,12 @@ __alloc_pages_direct_compact(gfp_t gfp_mask, unsigned int order,
 	psi_memstall_enter(&pflags);
 	delayacct_compact_start();
 	noreclaim_flag = memalloc_noreclaim_save();
+	start = ktime_get_ns();
 
 	*compact_result = try_to_compact_pages(gfp_mask, order, alloc_flags, ac,
 								prio, &page);
 
+	stall_ns[MEMCG_STALL_COMPACT] = ktime_get_ns() - start;
 	memalloc_noreclaim_restore(noreclaim_flag);
 	psi_memstall_leave(&pflags);
 	delayacct_compact_end();
@@ -3901,6 +4118,7 @@ __alloc_pages_direct_compact(gfp_t gfp_mask, unsigned int order,
 	 * count a compaction stall
 	 */
 	count_vm_event(COMPACTSTALL);
+	mem_cgroup_account_stall(stall_ns);
 
 	/* Prep a captured page if available */
 	if (page)
@@ -4992,6 +5210,8 @@ struct page *__alloc_frozen_pages_noprof(gfp_t gfp, unsigned int order,
 	ac.nodemask = nodemask;
 
 	page = __alloc_pages_slowpath(alloc_gfp, order, &ac);
+	if (unlikely(!page) && order)
+		compaction_alloc_failed(&ac, order);
 
 out:
 	if (memcg_kmem_online() && (gfp & __GFP_ACCOUNT) && page &&
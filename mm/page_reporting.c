@@ -6,6 +6,7 @@
 #include <linux/export.h>
 #include <linux/module.h>
 #include <linux/delay.h>
+#include <linux/ktime.h>
 #include <linux/scatterlist.h>
 
 #include "page_reporting.h"
@@ -47,7 +48,44 @@ MODULE_PARM_DESC(page_reporting_order, "Set page reporting order");
  */
 EXPORT_SYMBOL_GPL(page_reporting_order);
 
-#define PAGE_REPORTING_DELAY	(2 * HZ)
+/*
+ * Free pages below page_reporting_order are only reported by idle passes,
+ * which run once no page of page_reporting_order or higher has been freed for
+ * PAGE_REPORTING_IDLE_DELAY. Unset, or not below page_reporting_order, means
+ * that there are no idle passes. Only set this if the reporting device can
+ * take chunks smaller than page_reporting_order.
+ */
+static unsigned int page_reporting_idle_order = -1;
+module_param_cb(page_reporting_idle_order, &page_reporting_param_ops,
+			&page_reporting_idle_order, 0644);
+MODULE_PARM_DESC(page_reporting_idle_order,
+		 "Set lowest page reporting order when idle");
+
+/*
+ * Percentage of time the report callback, i.e. the host, may be kept busy.
+ * The delay between two passes is stretched so that a pass whose reports
+ * took long is followed by a proportionally longer pause.
+ */
+static unsigned int page_reporting_duty = 10;
+
+static int page_duty_update_notify(const char *val, const struct kernel_param *kp)
+{
+	return param_set_uint_minmax(val, kp, 1, 100);
+}
+
+static const struct kernel_param_ops page_reporting_duty_ops = {
+	.set = &page_duty_update_notify,
+	.get = &param_get_uint,
+};
+
+module_param_cb(page_reporting_duty, &page_reporting_duty_ops,
+			&page_reporting_duty, 0644);
+MODULE_PARM_DESC(page_reporting_duty,
+		 "Set percentage of time spent reporting pages to the host");
+
+#define PAGE_REPORTING_DELAY		(2 * HZ)
+#define PAGE_REPORTING_MAX_DELAY	(64 * HZ)
+#define PAGE_REPORTING_IDLE_DELAY	(32 * HZ)
 static struct page_reporting_dev_info __rcu *pr_dev_info __read_mostly;
 
 enum {
@@ -64,8 +102,17 @@ __page_reporting_request(struct page_reporting_dev_info *prdev)
 
 	/* Check to see if we are in desired state */
 	state = atomic_read(&prdev->state);
-	if (state == PAGE_REPORTING_REQUESTED)
+	if (state == PAGE_REPORTING_REQUESTED) {
+		/*
+		 * The guest is not idle anymore, so don't wait for the idle
+		 * pass to report the newly freed pages.
+		 */
+		if (unlikely(READ_ONCE(prdev->idle_pass))) {
+			WRITE_ONCE(prdev->idle_pass, false);
+			mod_delayed_work(system_wq, &prdev->work, prdev->delay);
+		}
 		return;
+	}
 
 	/*
 	 * If reporting is already active there is nothing we need to do.
@@ -76,11 +123,11 @@ __page_reporting_request(struct page_reporting_dev_info *prdev)
 		return;
 
 	/*
-	 * Delay the start of work to allow a sizable queue to build. For
-	 * now we are limiting this to running no more than once every
-	 * couple of seconds.
+	 * Delay the start of work to allow a sizable queue to build. This
+	 * is at least a couple of seconds, and longer if the host has been
+	 * slow to process the previous reports.
 	 */
-	schedule_delayed_work(&prdev->work, PAGE_REPORTING_DELAY);
+	schedule_delayed_work(&prdev->work, prdev->delay);
 }
 
 /* notify prdev of free page reporting request */
@@ -101,6 +148,20 @@ void __page_reporting_notify(void)
 	rcu_read_unlock();
 }
 
+/* Report the pages, and account the time the host took to process them */
+static int
+page_reporting_report(struct page_reporting_dev_info *prdev,
+		      struct scatterlist *sgl, unsigned int nents)
+{
+	u64 start = ktime_get_ns();
+	int err;
+
+	err = prdev->report(prdev, sgl, nents);
+	prdev->report_ns += ktime_get_ns() - start;
+
+	return err;
+}
+
 static void
 page_reporting_drain(struct page_reporting_dev_info *prdev,
 		     struct scatterlist *sgl, unsigned int nents, bool reported)
@@ -222,7 +283,7 @@ page_reporting_cycle(struct page_reporting_dev_info *prdev, struct zone *zone,
 		spin_unlock_irq(&zone->lock);
 
 		/* begin processing pages in local list */
-		err = prdev->report(prdev, sgl, PAGE_REPORTING_CAPACITY);
+		err = page_reporting_report(prdev, sgl, PAGE_REPORTING_CAPACITY);
 
 		/* reset offset since the full list was reported */
 		*offset = PAGE_REPORTING_CAPACITY;
@@ -258,7 +319,8 @@ page_reporting_cycle(struct page_reporting_dev_info *prdev, struct zone *zone,
 
 static int
 page_reporting_process_zone(struct page_reporting_dev_info *prdev,
-			    struct scatterlist *sgl, struct zone *zone)
+			    struct scatterlist *sgl, struct zone *zone,
+			    unsigned int min_order)
 {
 	unsigned int order, mt, leftover, offset = PAGE_REPORTING_CAPACITY;
 	unsigned long watermark;
@@ -276,7 +338,7 @@ page_reporting_process_zone(struct page_reporting_dev_info *prdev,
 		return err;
 
 	/* Process each free list starting from lowest order/mt */
-	for (order = page_reporting_order; order < NR_PAGE_ORDERS; order++) {
+	for (order = min_order; order < NR_PAGE_ORDERS; order++) {
 		for (mt = 0; mt < MIGRATE_TYPES; mt++) {
 			/* We do not pull pages from the isolate free list */
 			if (is_migrate_isolate(mt))
@@ -293,7 +355,7 @@ page_reporting_process_zone(struct page_reporting_dev_info *prdev,
 	leftover = PAGE_REPORTING_CAPACITY - offset;
 	if (leftover) {
 		sgl = &sgl[offset];
-		err = prdev->report(prdev, sgl, leftover);
+		err = page_reporting_report(prdev, sgl, leftover);
 
 		/* flush any remaining pages out from the last report */
 		spin_lock_irq(&zone->lock);
@@ -304,15 +366,38 @@ page_reporting_process_zone(struct page_reporting_dev_info *prdev,
 	return err;
 }
 
+/*
+ * Pause for at least PAGE_REPORTING_DELAY between two passes, and long enough
+ * that the time the host spent on the reports of the last pass is no more
+ * than page_reporting_duty percent of the whole.
+ */
+static void page_reporting_update_delay(struct page_reporting_dev_info *prdev)
+{
+	unsigned int duty = READ_ONCE(page_reporting_duty);
+	u64 pause_ns = div_u64(prdev->report_ns * (100 - duty), duty);
+
+	prdev->delay = clamp(nsecs_to_jiffies(pause_ns),
+			     (unsigned long)PAGE_REPORTING_DELAY,
+			     (unsigned long)PAGE_REPORTING_MAX_DELAY);
+}
+
 static void page_reporting_process(struct work_struct *work)
 {
 	struct delayed_work *d_work = to_delayed_work(work);
 	struct page_reporting_dev_info *prdev =
 		container_of(d_work, struct page_reporting_dev_info, work);
 	int err = 0, state = PAGE_REPORTING_ACTIVE;
+	unsigned int min_order = page_reporting_order;
+	bool idle_pass = READ_ONCE(prdev->idle_pass);
 	struct scatterlist *sgl;
 	struct zone *zone;
 
+	if (idle_pass)
+		min_order = min(READ_ONCE(page_reporting_idle_order),
+				page_reporting_order);
+	WRITE_ONCE(prdev->idle_pass, false);
+	prdev->report_ns = 0;
+
 	/*
 	 * Change the state to "Active" so that we can track if there is
 	 * anyone requests page reporting after we complete our pass. If
@@ -329,21 +414,43 @@ static void page_reporting_process(struct work_struct *work)
 	sg_init_table(sgl, PAGE_REPORTING_CAPACITY);
 
 	for_each_zone(zone) {
-		err = page_reporting_process_zone(prdev, sgl, zone);
+		err = page_reporting_process_zone(prdev, sgl, zone, min_order);
 		if (err)
 			break;
 	}
 
 	kfree(sgl);
 err_out:
+	page_reporting_update_delay(prdev);
+
 	/*
 	 * If the state has reverted back to requested then there may be
-	 * additional pages to be processed. We will defer for 2s to allow
-	 * more pages to accumulate.
+	 * additional pages to be processed. We will defer for at least 2s to
+	 * allow more pages to accumulate.
 	 */
 	state = atomic_cmpxchg(&prdev->state, state, PAGE_REPORTING_IDLE);
-	if (state == PAGE_REPORTING_REQUESTED)
-		schedule_delayed_work(&prdev->work, PAGE_REPORTING_DELAY);
+	if (state == PAGE_REPORTING_REQUESTED) {
+		schedule_delayed_work(&prdev->work, prdev->delay);
+		return;
+	}
+
+	/*
+	 * Nothing was freed at page_reporting_order or higher during the pass.
+	 * If that stays so for a while, report the smaller free chunks too.
+	 * Only one idle pass follows a busy one, so that an idle guest does
+	 * not keep rescanning its free lists.
+	 */
+	if (idle_pass || err ||
+	    READ_ONCE(page_reporting_idle_order) >= page_reporting_order)
+		return;
+
+	WRITE_ONCE(prdev->idle_pass, true);
+	state = atomic_cmpxchg(&prdev->state, PAGE_REPORTING_IDLE,
+			       PAGE_REPORTING_REQUESTED);
+	if (state == PAGE_REPORTING_IDLE)
+		schedule_delayed_work(&prdev->work, PAGE_REPORTING_IDLE_DELAY);
+	else
+		WRITE_ONCE(prdev->idle_pass, false);
 }
 
 static DEFINE_MUTEX(page_reporting_mutex);
@@ -378,6 +485,8 @@ int page_reporting_register(struct page_reporting_dev_info *prdev)
 
 	/* initialize state and work structures */
 	atomic_set(&prdev->state, PAGE_REPORTING_IDLE);
+	prdev->delay = PAGE_REPORTING_DELAY;
+	prdev->idle_pass = false;
 	INIT_DELAYED_WORK(&prdev->work, &page_reporting_process);
 
 	/* Begin initial flush of zones */
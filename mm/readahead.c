@@ -179,11 +179,12 @@ static void read_pages(struct readahead_control *rac)
 }
 
 static struct folio *ractl_alloc_folio(struct readahead_control *ractl,
-				       gfp_t gfp_mask, unsigned int order)
+				       pgoff_t index, gfp_t gfp_mask,
+				       unsigned int order)
 {
 	struct folio *folio;
 
-	folio = filemap_alloc_folio(gfp_mask, order);
+	folio = mapping_alloc_folio(ractl->mapping, index, gfp_mask, order);
 	if (folio && ractl->dropbehind)
 		__folio_set_dropbehind(folio);
 
@@ -267,7 +268,7 @@ void page_cache_ra_unbounded(struct readahead_control *ractl,
 			continue;
 		}
 
-		folio = ractl_alloc_folio(ractl, gfp_mask,
+		folio = ractl_alloc_folio(ractl, index + i, gfp_mask,
 					mapping_min_folio_order(mapping));
 		if (!folio)
 			break;
@@ -282,8 +283,10 @@ void page_cache_ra_unbounded(struct readahead_control *ractl,
 			i = ractl->_index + ractl->_nr_pages - index;
 			continue;
 		}
-		if (i == mark)
+		if (i == mark) {
 			folio_set_readahead(folio);
+			percpu_counter_inc(&mapping->host->i_sb->s_ra_windows);
+		}
 		ractl->_workingset |= folio_test_workingset(folio);
 		ractl->_nr_pages += min_nrpages;
 		i += min_nrpages;
@@ -438,7 +441,7 @@ static inline int ra_alloc_folio(struct readahead_control *ractl, pgoff_t index,
 		pgoff_t mark, unsigned int order, gfp_t gfp)
 {
 	int err;
-	struct folio *folio = ractl_alloc_folio(ractl, gfp, order);
+	struct folio *folio = ractl_alloc_folio(ractl, index, gfp, order);
 
 	if (!folio)
 		return -ENOMEM;
@@ -450,6 +453,8 @@ static inline int ra_alloc_folio(struct readahead_control *ractl, pgoff_t index,
 		folio_put(folio);
 		return err;
 	}
+	if (index == mark)
+		percpu_counter_inc(&ractl->mapping->host->i_sb->s_ra_windows);
 
 	ractl->_nr_pages += 1UL << order;
 	ractl->_workingset |= folio_test_workingset(folio);
@@ -533,6 +538,75 @@ void page_cache_ra_order(struct readahead_control *ractl,
 				 ra->async_size);
 }
 
+/*
+ * Strided and backward reads.
+ *
+ * A scan that reads small chunks at a fixed distance from each other, forward
+ * or backward, never looks sequential, and every read ends up as a small
+ * random read above. So the start of each small read is remembered, and once
+ * RA_STRIDE_MIN_HITS reads in a row were the same distance apart, the windows
+ * that the next reads are predicted to hit are read ahead, each the size of
+ * the current read and flagged with PG_readahead. A hit on the marker of a
+ * predicted window tops up the pipeline with one more window.
+ *
+ * Interleaved sequential streams on the same file are already taken care of
+ * by the PG_readahead markers; interleaved strided streams simply keep
+ * resetting the detector and get the plain random read treatment.
+ */
+#define RA_STRIDE_MIN_HITS	2
+#define RA_STRIDE_WINDOWS	8
+
+static bool ra_stride_active(struct file_ra_state *ra)
+{
+	return ra->stride_hits >= RA_STRIDE_MIN_HITS;
+}
+
+/* Read the window predicted after ra->stride_prev, returns false if none. */
+static bool ra_stride_next(struct readahead_control *ractl,
+			   unsigned long req_count)
+{
+	struct file_ra_state *ra = ractl->ra;
+	pgoff_t next;
+
+	if (ra->stride < 0 && ra->stride_prev < (pgoff_t)-ra->stride)
+		return false;
+
+	next = ra->stride_prev + ra->stride;
+	ra->stride_prev = next;
+	ractl->_index = next;
+	do_page_cache_ra(ractl, req_count, req_count);
+	return true;
+}
+
+static bool ra_stride(struct readahead_control *ractl, unsigned long req_count)
+{
+	struct file_ra_state *ra = ractl->ra;
+	pgoff_t index = readahead_index(ractl);
+	long stride = (long)(index - ra->stride_prev);
+	unsigned long nr, i;
+
+	if (stride && stride == ra->stride) {
+		if (!ra_stride_active(ra))
+			ra->stride_hits++;
+	} else {
+		ra->stride = stride > INT_MIN && stride <= INT_MAX ? stride : 0;
+		ra->stride_hits = ra->stride ? 1 : 0;
+	}
+	ra->stride_prev = index;
+
+	if (!ra_stride_active(ra))
+		return false;
+
+	do_page_cache_ra(ractl, req_count, 0);
+
+	nr = clamp_val(ra->ra_pages / req_count, 1, RA_STRIDE_WINDOWS);
+	for (i = 0; i < nr; i++) {
+		if (!ra_stride_next(ractl, req_count))
+			break;
+	}
+	return true;
+}
+
 static unsigned long ractl_max_pages(struct readahead_control *ractl,
 		unsigned long req_size)
 {
@@ -584,6 +658,7 @@ void page_cache_sync_ra(struct readahead_control *ractl,
 	 * unaligned reads: (index - prev_index) == 0
 	 */
 	if (!index || req_count > max_pages || index - prev_index <= 1UL) {
+		ra->stride_hits = 0;
 		ra->start = index;
 		ra->size = get_init_ra_size(req_count, max_pages);
 		ra->async_size = ra->size > req_count ? ra->size - req_count :
@@ -604,7 +679,8 @@ void page_cache_sync_ra(struct readahead_control *ractl,
 	 * readahead state.
 	 */
 	if (contig_count <= req_count) {
-		do_page_cache_ra(ractl, req_count, 0);
+		if (!ra_stride(ractl, req_count))
+			do_page_cache_ra(ractl, req_count, 0);
 		return;
 	}
 	/*
@@ -642,10 +718,17 @@ void page_cache_async_ra(struct readahead_control *ractl,
 		return;
 
 	folio_clear_readahead(folio);
+	percpu_counter_inc(&ractl->mapping->host->i_sb->s_ra_hits);
 
 	if (blk_cgroup_congested())
 		return;
 
+	/* a predicted window of a strided stream, not the start of a stream */
+	if (ra_stride_active(ra)) {
+		ra_stride_next(ractl, req_count);
+		return;
+	}
+
 	max_pages = ractl_max_pages(ractl, req_count);
 	/*
 	 * It's the expected callback index, assume sequential access.
@@ -775,7 +858,7 @@ void readahead_expand(struct readahead_control *ractl,
 		if (folio && !xa_is_value(folio))
 			return; /* Folio apparently present */
 
-		folio = ractl_alloc_folio(ractl, gfp_mask, min_order);
+		folio = ractl_alloc_folio(ractl, index, gfp_mask, min_order);
 		if (!folio)
 			return;
 
@@ -804,7 +887,7 @@ void readahead_expand(struct readahead_control *ractl,
 		if (folio && !xa_is_value(folio))
 			return; /* Folio apparently present */
 
-		folio = ractl_alloc_folio(ractl, gfp_mask, min_order);
+		folio = ractl_alloc_folio(ractl, index, gfp_mask, min_order);
 		if (!folio)
 			return;
 
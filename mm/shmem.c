@@ -528,12 +528,16 @@ static bool shmem_confirm_swap(struct address_space *mapping,
  *	also respect madvise() hints;
  * SHMEM_HUGE_ADVISE:
  *	only allocate huge pages if requested with madvise();
+ * SHMEM_HUGE_LADDER:
+ *	like SHMEM_HUGE_ALWAYS, but only try PMD, 64K and 16K folios, in
+ *	that order, before falling back to small pages;
  */
 
 #define SHMEM_HUGE_NEVER	0
 #define SHMEM_HUGE_ALWAYS	1
 #define SHMEM_HUGE_WITHIN_SIZE	2
 #define SHMEM_HUGE_ADVISE	3
+#define SHMEM_HUGE_LADDER	4
 
 /*
  * Special values.
@@ -612,6 +616,38 @@ static unsigned int shmem_get_orders_within_size(struct inode *inode,
 	return 0;
 }
 
+/*
+ * The folio orders tried by huge=ladder. Sizes that are not larger than a
+ * page, or that the page cache can't hold, drop out of the ladder.
+ */
+static unsigned long shmem_ladder_orders(void)
+{
+	unsigned long orders = BIT(HPAGE_PMD_ORDER);
+
+	if (SZ_64K > PAGE_SIZE)
+		orders |= BIT(ilog2(SZ_64K / PAGE_SIZE));
+	if (SZ_16K > PAGE_SIZE)
+		orders |= BIT(ilog2(SZ_16K / PAGE_SIZE));
+
+	return orders & (BIT(MAX_PAGECACHE_ORDER + 1) - 1) & ~BIT(0);
+}
+
+static void shmem_count_folio_alloc(struct inode *inode, int order)
+{
+	if (order)
+		atomic_long_inc(&SHMEM_SB(inode->i_sb)->folio_alloc[order]);
+}
+
+static void shmem_count_folio_fallback(struct inode *inode, int order)
+{
+	atomic_long_inc(&SHMEM_SB(inode->i_sb)->folio_fallback[order]);
+}
+
+static void shmem_count_folio_split(struct inode *inode)
+{
+	atomic_long_inc(&SHMEM_SB(inode->i_sb)->folio_split);
+}
+
 static unsigned int shmem_huge_global_enabled(struct inode *inode, pgoff_t index,
 					      loff_t write_end, bool shmem_huge_force,
 					      struct vm_area_struct *vma,
@@ -646,6 +682,12 @@ static unsigned int shmem_huge_global_enabled(struct inode *inode, pgoff_t index
 			return maybe_pmd_order;
 
 		return shmem_mapping_size_orders(inode->i_mapping, index, write_end);
+	case SHMEM_HUGE_LADDER:
+		if (vma)
+			return shmem_ladder_orders();
+
+		return shmem_mapping_size_orders(inode->i_mapping, index, write_end) &
+			shmem_ladder_orders();
 	case SHMEM_HUGE_WITHIN_SIZE:
 		if (vma)
 			within_size_orders = maybe_pmd_order;
@@ -683,6 +725,8 @@ static int shmem_parse_huge(const char *str)
 		huge = SHMEM_HUGE_WITHIN_SIZE;
 	else if (!strcmp(str, "advise"))
 		huge = SHMEM_HUGE_ADVISE;
+	else if (!strcmp(str, "ladder"))
+		huge = SHMEM_HUGE_LADDER;
 	else if (!strcmp(str, "deny"))
 		huge = SHMEM_HUGE_DENY;
 	else if (!strcmp(str, "force"))
@@ -714,6 +758,8 @@ static const char *shmem_format_huge(int huge)
 		return "within_size";
 	case SHMEM_HUGE_ADVISE:
 		return "advise";
+	case SHMEM_HUGE_LADDER:
+		return "ladder";
 	case SHMEM_HUGE_DENY:
 		return "deny";
 	case SHMEM_HUGE_FORCE:
@@ -809,6 +855,8 @@ static unsigned long shmem_unused_huge_shrink(struct shmem_sb_info *sbinfo,
 		if (ret)
 			goto move_back;
 
+		shmem_count_folio_split(inode);
+
 		freed += next - end;
 		split++;
 drop:
@@ -849,6 +897,36 @@ static long shmem_unused_huge_count(struct super_block *sb,
 	struct shmem_sb_info *sbinfo = SHMEM_SB(sb);
 	return READ_ONCE(sbinfo->shrinklist_len);
 }
+
+#ifdef CONFIG_TMPFS
+/*
+ * Large folio statistics of the mount, in /proc/<pid>/mountstats: how many
+ * folios of each order were allocated, how many allocations of each order
+ * fell back to a smaller one, and how many large folios were split.
+ */
+static int shmem_show_stats(struct seq_file *seq, struct dentry *root)
+{
+	struct shmem_sb_info *sbinfo = SHMEM_SB(root->d_sb);
+	int order;
+
+	seq_printf(seq, "huge=%s", shmem_format_huge(sbinfo->huge));
+
+	seq_puts(seq, "\n\tlarge_folio_alloc:");
+	for (order = 1; order <= MAX_PAGECACHE_ORDER; order++)
+		seq_printf(seq, " %lu",
+			   atomic_long_read(&sbinfo->folio_alloc[order]));
+
+	seq_puts(seq, "\n\tlarge_folio_fallback:");
+	for (order = 1; order <= MAX_PAGECACHE_ORDER; order++)
+		seq_printf(seq, " %lu",
+			   atomic_long_read(&sbinfo->folio_fallback[order]));
+
+	seq_printf(seq, "\n\tlarge_folio_split: %lu",
+		   atomic_long_read(&sbinfo->folio_split));
+
+	return 0;
+}
+#endif /* CONFIG_TMPFS */
 #else /* !CONFIG_TRANSPARENT_HUGEPAGE */
 
 #define shmem_huge SHMEM_HUGE_DENY
@@ -866,6 +944,18 @@ static unsigned int shmem_huge_global_enabled(struct inode *inode, pgoff_t index
 {
 	return 0;
 }
+
+static void shmem_count_folio_alloc(struct inode *inode, int order)
+{
+}
+
+static void shmem_count_folio_fallback(struct inode *inode, int order)
+{
+}
+
+static void shmem_count_folio_split(struct inode *inode)
+{
+}
 #endif /* CONFIG_TRANSPARENT_HUGEPAGE */
 
 static void shmem_update_stats(struct folio *folio, int nr_pages)
@@ -1077,6 +1167,20 @@ static struct folio *shmem_get_partial_folio(struct inode *inode, pgoff_t index)
 	return folio;
 }
 
+/* truncate_inode_partial_folio(), counting the splits it does per mount */
+static bool shmem_truncate_partial_folio(struct inode *inode,
+		struct folio *folio, loff_t lstart, loff_t lend)
+{
+	unsigned int order = folio_order(folio);
+	bool ret;
+
+	ret = truncate_inode_partial_folio(folio, lstart, lend);
+	if (folio_order(folio) < order)
+		shmem_count_folio_split(inode);
+
+	return ret;
+}
+
 /*
  * Remove range of pages and swap entries from page cache, and free them.
  * If !unfalloc, truncate or punch hole; if unfalloc, undo failed fallocate.
@@ -1140,7 +1244,7 @@ static void shmem_undo_range(struct inode *inode, loff_t lstart, loff_t lend,
 	if (folio) {
 		same_folio = lend < folio_pos(folio) + folio_size(folio);
 		folio_mark_dirty(folio);
-		if (!truncate_inode_partial_folio(folio, lstart, lend)) {
+		if (!shmem_truncate_partial_folio(inode, folio, lstart, lend)) {
 			start = folio_next_index(folio);
 			if (same_folio)
 				end = folio->index;
@@ -1154,7 +1258,7 @@ static void shmem_undo_range(struct inode *inode, loff_t lstart, loff_t lend,
 		folio = shmem_get_partial_folio(inode, lend >> PAGE_SHIFT);
 	if (folio) {
 		folio_mark_dirty(folio);
-		if (!truncate_inode_partial_folio(folio, lstart, lend))
+		if (!shmem_truncate_partial_folio(inode, folio, lstart, lend))
 			end = folio->index;
 		folio_unlock(folio);
 		folio_put(folio);
@@ -1207,7 +1311,8 @@ static void shmem_undo_range(struct inode *inode, loff_t lstart, loff_t lend,
 
 				if (!folio_test_large(folio)) {
 					truncate_inode_folio(mapping, folio);
-				} else if (truncate_inode_partial_folio(folio, lstart, lend)) {
+				} else if (shmem_truncate_partial_folio(inode, folio,
+									lstart, lend)) {
 					/*
 					 * If we split a page, reset the loop so
 					 * that we pick up the new sub pages.
@@ -1886,6 +1991,7 @@ static struct folio *shmem_alloc_and_add_folio(struct vm_fault *vmf,
 			if (pages == HPAGE_PMD_NR)
 				count_vm_event(THP_FILE_FALLBACK);
 			count_mthp_stat(order, MTHP_STAT_SHMEM_FALLBACK);
+			shmem_count_folio_fallback(inode, order);
 			order = next_order(&suitable_orders, order);
 		}
 	} else {
@@ -1912,6 +2018,7 @@ static struct folio *shmem_alloc_and_add_folio(struct vm_fault *vmf,
 			}
 			count_mthp_stat(folio_order(folio), MTHP_STAT_SHMEM_FALLBACK);
 			count_mthp_stat(folio_order(folio), MTHP_STAT_SHMEM_FALLBACK_CHARGE);
+			shmem_count_folio_fallback(inode, folio_order(folio));
 		}
 		goto unlock;
 	}
@@ -2528,6 +2635,7 @@ static int shmem_get_folio_gfp(struct inode *inode, pgoff_t index,
 			if (folio_test_pmd_mappable(folio))
 				count_vm_event(THP_FILE_ALLOC);
 			count_mthp_stat(folio_order(folio), MTHP_STAT_SHMEM_ALLOC);
+			shmem_count_folio_alloc(inode, folio_order(folio));
 			goto alloced;
 		}
 		if (PTR_ERR(folio) == -EEXIST)
@@ -4507,6 +4615,7 @@ static const struct constant_table shmem_param_enums_huge[] = {
 	{"always",	SHMEM_HUGE_ALWAYS },
 	{"within_size",	SHMEM_HUGE_WITHIN_SIZE },
 	{"advise",	SHMEM_HUGE_ADVISE },
+	{"ladder",	SHMEM_HUGE_LADDER },
 	{}
 };
 
@@ -5287,6 +5396,9 @@ static const struct super_operations shmem_ops = {
 #ifdef CONFIG_TRANSPARENT_HUGEPAGE
 	.nr_cached_objects	= shmem_unused_huge_count,
 	.free_cached_objects	= shmem_unused_huge_scan,
+#ifdef CONFIG_TMPFS
+	.show_stats	= shmem_show_stats,
+#endif
 #endif
 };
 
@@ -5464,6 +5576,7 @@ static ssize_t shmem_enabled_show(struct kobject *kobj,
 		SHMEM_HUGE_ALWAYS,
 		SHMEM_HUGE_WITHIN_SIZE,
 		SHMEM_HUGE_ADVISE,
+		SHMEM_HUGE_LADDER,
 		SHMEM_HUGE_NEVER,
 		SHMEM_HUGE_DENY,
 		SHMEM_HUGE_FORCE,
@@ -258,6 +258,7 @@ struct kmem_cache_order_objects {
 struct kmem_cache {
 #ifndef CONFIG_SLUB_TINY
 	struct kmem_cache_cpu __percpu *cpu_slab;
+	struct slub_percpu_sheaves __percpu *cpu_sheaves;
 #endif
 	/* Used for retrieving partial slabs, etc. */
 	slab_flags_t flags;
@@ -271,6 +272,9 @@ struct kmem_cache {
 	unsigned int cpu_partial;
 	/* Number of per cpu partial slabs to keep around */
 	unsigned int cpu_partial_slabs;
+#endif
+#ifndef CONFIG_SLUB_TINY
+	unsigned int sheaf_capacity;	/* Objects per percpu sheaf, or 0 */
 #endif
 	struct kmem_cache_order_objects oo;
 
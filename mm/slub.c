@@ -372,6 +372,14 @@ enum stat_item {
 	CPU_PARTIAL_FREE,	/* Refill cpu partial on free */
 	CPU_PARTIAL_NODE,	/* Refill cpu partial from node partial */
 	CPU_PARTIAL_DRAIN,	/* Drain cpu partial to node partial */
+	ALLOC_PCS,		/* Allocation from percpu sheaf */
+	FREE_PCS,		/* Free to percpu sheaf */
+	SHEAF_REFILL,		/* Main sheaf refilled from slabs */
+	SHEAF_FLUSH,		/* Objects flushed from a sheaf to slabs */
+	BARN_GET,		/* Full sheaf taken from the barn */
+	BARN_PUT,		/* Full sheaf put into the barn */
+	FREE_PCS_REMOTE,	/* Free to percpu sheaf of a remote node */
+	BARN_PUT_REMOTE,	/* Remote node sheaf put into its barn */
 	NR_SLUB_STAT_ITEMS
 };
 
@@ -430,6 +438,7 @@ struct kmem_cache_node {
 	atomic_long_t total_objects;
 	struct list_head full;
 #endif
+	struct node_barn *barn;		/* for caches with percpu sheaves */
 };
 
 static inline struct kmem_cache_node *get_node(struct kmem_cache *s, int node)
@@ -445,6 +454,548 @@ static inline struct kmem_cache_node *get_node(struct kmem_cache *s, int node)
 	for (__node = 0; __node < nr_node_ids; __node++) \
 		 if ((__n = get_node(__s, __node)))
 
+#ifndef CONFIG_SLUB_TINY
+/*
+ * Per-cpu sheaves, for caches created with a sheaf_capacity.
+ *
+ * A sheaf is an array of objects. Each cpu has a main sheaf that it
+ * allocates from and frees to, and possibly a spare one, which is either
+ * empty or full. When both are exhausted, full and empty sheaves are
+ * exchanged with the barn of the local node. Only when the barn has none to
+ * offer either, objects are allocated or freed in bulk from and to slabs.
+ *
+ * The point is that a free is just a store into the local sheaf, no matter
+ * which cpu slab the object belongs to, where it would otherwise go through
+ * __slab_free() and, as often as not, the node list_lock.
+ *
+ * Objects of remote nodes are collected in per-node remote sheaves instead,
+ * so they can't pile up on the wrong node. Once full, a remote sheaf goes
+ * into the barn of its node as a full sheaf, where that node's cpus pick it
+ * up on their next allocation. The interconnect is then crossed once for a
+ * sheaf, rather than for each object freed into a remote slab.
+ */
+struct slab_sheaf {
+	struct list_head barn_list;
+	unsigned int size;
+	void *objects[];
+};
+
+struct slub_percpu_sheaves {
+	local_lock_t lock;
+	struct slab_sheaf *main;	/* never NULL */
+	struct slab_sheaf *spare;	/* empty or full, may be NULL */
+	struct slab_sheaf **remote;	/* by node, NULL if there's just one */
+};
+
+struct node_barn {
+	spinlock_t lock;
+	struct list_head sheaves_full;
+	struct list_head sheaves_empty;
+	unsigned int nr_full;
+	unsigned int nr_empty;
+};
+
+#define MAX_FULL_SHEAVES	10
+#define MAX_EMPTY_SHEAVES	10
+/* objects refilled or flushed at a time, kept on the stack */
+#define PCS_BATCH_MAX		32U
+
+static inline int __kmem_cache_alloc_bulk(struct kmem_cache *s, gfp_t flags,
+					  size_t size, void **p);
+static void __kmem_cache_free_bulk(struct kmem_cache *s, size_t size, void **p);
+
+static inline bool pcs_enabled(struct kmem_cache *s)
+{
+	return s->cpu_sheaves;
+}
+
+static struct slab_sheaf *alloc_empty_sheaf(struct kmem_cache *s, gfp_t gfp)
+{
+	return kzalloc(struct_size_t(struct slab_sheaf, objects,
+				     s->sheaf_capacity),
+		       (gfp & GFP_RECLAIM_MASK) | __GFP_NOWARN);
+}
+
+static void free_empty_sheaf(struct slab_sheaf *sheaf)
+{
+	VM_WARN_ON_ONCE(sheaf->size);
+	kfree(sheaf);
+}
+
+static void sheaf_flush(struct kmem_cache *s, struct slab_sheaf *sheaf)
+{
+	__kmem_cache_free_bulk(s, sheaf->size, sheaf->objects);
+	sheaf->size = 0;
+	stat(s, SHEAF_FLUSH);
+}
+
+static struct node_barn *get_barn(struct kmem_cache *s)
+{
+	struct kmem_cache_node *n = get_node(s, numa_mem_id());
+
+	return n ? n->barn : NULL;
+}
+
+static struct slab_sheaf *barn_get(struct node_barn *barn, bool full)
+{
+	struct slab_sheaf *sheaf = NULL;
+	struct list_head *list;
+	unsigned long flags;
+
+	if (!data_race(full ? barn->nr_full : barn->nr_empty))
+		return NULL;
+
+	list = full ? &barn->sheaves_full : &barn->sheaves_empty;
+	spin_lock_irqsave(&barn->lock, flags);
+	sheaf = list_first_entry_or_null(list, struct slab_sheaf, barn_list);
+	if (sheaf) {
+		list_del(&sheaf->barn_list);
+		if (full)
+			barn->nr_full--;
+		else
+			barn->nr_empty--;
+	}
+	spin_unlock_irqrestore(&barn->lock, flags);
+	return sheaf;
+}
+
+static bool barn_put(struct node_barn *barn, struct slab_sheaf *sheaf,
+		     bool full)
+{
+	unsigned int *nr = full ? &barn->nr_full : &barn->nr_empty;
+	unsigned int max = full ? MAX_FULL_SHEAVES : MAX_EMPTY_SHEAVES;
+	unsigned long flags;
+	bool ret = false;
+
+	if (data_race(*nr) >= max)
+		return false;
+
+	spin_lock_irqsave(&barn->lock, flags);
+	if (*nr < max) {
+		list_add(&sheaf->barn_list, full ? &barn->sheaves_full :
+						   &barn->sheaves_empty);
+		(*nr)++;
+		ret = true;
+	}
+	spin_unlock_irqrestore(&barn->lock, flags);
+	return ret;
+}
+
+/* Flush the full and free all sheaves of a barn */
+static void barn_shrink(struct kmem_cache *s, struct node_barn *barn)
+{
+	struct slab_sheaf *sheaf, *tmp;
+	unsigned long flags;
+	LIST_HEAD(full);
+	LIST_HEAD(empty);
+
+	spin_lock_irqsave(&barn->lock, flags);
+	list_splice_init(&barn->sheaves_full, &full);
+	list_splice_init(&barn->sheaves_empty, &empty);
+	barn->nr_full = barn->nr_empty = 0;
+	spin_unlock_irqrestore(&barn->lock, flags);
+
+	list_for_each_entry_safe(sheaf, tmp, &full, barn_list) {
+		sheaf_flush(s, sheaf);
+		free_empty_sheaf(sheaf);
+	}
+	list_for_each_entry_safe(sheaf, tmp, &empty, barn_list)
+		free_empty_sheaf(sheaf);
+}
+
+/*
+ * The main sheaf is empty, replace it with the spare or a full sheaf from
+ * the barn. Returns false if there's no full sheaf to be had.
+ */
+static bool pcs_swap_for_alloc(struct kmem_cache *s,
+			       struct slub_percpu_sheaves *pcs)
+{
+	struct node_barn *barn;
+	struct slab_sheaf *full;
+
+	if (pcs->spare && pcs->spare->size) {
+		swap(pcs->main, pcs->spare);
+		return true;
+	}
+
+	barn = get_barn(s);
+	full = barn ? barn_get(barn, true) : NULL;
+	if (!full)
+		return false;
+
+	stat(s, BARN_GET);
+	if (!pcs->spare)
+		pcs->spare = pcs->main;
+	else if (!barn_put(barn, pcs->main, false))
+		free_empty_sheaf(pcs->main);
+	pcs->main = full;
+	return true;
+}
+
+/*
+ * The main sheaf is full, replace it with the spare or an empty sheaf from
+ * the barn, or a new one. Returns false if the barn has no room for the
+ * full sheaf, or no empty sheaf could be had.
+ */
+static bool pcs_swap_for_free(struct kmem_cache *s,
+			      struct slub_percpu_sheaves *pcs)
+{
+	struct node_barn *barn;
+	struct slab_sheaf *empty;
+
+	if (pcs->spare && pcs->spare->size < s->sheaf_capacity) {
+		swap(pcs->main, pcs->spare);
+		return true;
+	}
+
+	barn = get_barn(s);
+	if (!barn)
+		return false;
+	if (pcs->spare && data_race(barn->nr_full) >= MAX_FULL_SHEAVES)
+		return false;
+
+	empty = barn_get(barn, false);
+	if (!empty)
+		empty = alloc_empty_sheaf(s, GFP_NOWAIT);
+	if (!empty)
+		return false;
+
+	if (!pcs->spare) {
+		pcs->spare = pcs->main;
+	} else if (!barn_put(barn, pcs->main, true)) {
+		if (!barn_put(barn, empty, false))
+			free_empty_sheaf(empty);
+		return false;
+	} else {
+		stat(s, BARN_PUT);
+	}
+	pcs->main = empty;
+	return true;
+}
+
+/*
+ * Nothing to allocate from in the sheaves, get a batch of objects from
+ * slabs: one to return and the rest goes into the main sheaf. Sheaves are
+ * handed to any caller, so the batch must not come from pfmemalloc slabs;
+ * callers that may dip into the reserves fall back to the slab path.
+ */
+static void *alloc_refill_pcs(struct kmem_cache *s, gfp_t gfp)
+{
+	void *objects[PCS_BATCH_MAX];
+	struct slub_percpu_sheaves *pcs;
+	unsigned int batch, i = 1;
+	unsigned long flags;
+	struct slab_sheaf *main;
+
+	batch = min(s->sheaf_capacity, PCS_BATCH_MAX);
+	if (!__kmem_cache_alloc_bulk(s, gfp | __GFP_NOMEMALLOC, batch, objects))
+		return NULL;
+
+	local_lock_irqsave(&s->cpu_sheaves->lock, flags);
+	pcs = this_cpu_ptr(s->cpu_sheaves);
+	main = pcs->main;
+	while (i < batch && main->size < s->sheaf_capacity)
+		main->objects[main->size++] = objects[i++];
+	local_unlock_irqrestore(&s->cpu_sheaves->lock, flags);
+
+	/* frees on this cpu beat us to it */
+	if (i < batch)
+		__kmem_cache_free_bulk(s, batch - i, &objects[i]);
+
+	stat(s, SHEAF_REFILL);
+	return objects[0];
+}
+
+static __fastpath_inline void *alloc_from_pcs(struct kmem_cache *s, gfp_t gfp,
+					      int node)
+{
+	struct slub_percpu_sheaves *pcs;
+	unsigned long flags;
+	void *object;
+
+	if (node != NUMA_NO_NODE && node != numa_mem_id())
+		return NULL;
+
+	local_lock_irqsave(&s->cpu_sheaves->lock, flags);
+	pcs = this_cpu_ptr(s->cpu_sheaves);
+	if (unlikely(!pcs->main->size) && !pcs_swap_for_alloc(s, pcs)) {
+		local_unlock_irqrestore(&s->cpu_sheaves->lock, flags);
+		return alloc_refill_pcs(s, gfp);
+	}
+	object = pcs->main->objects[--pcs->main->size];
+	local_unlock_irqrestore(&s->cpu_sheaves->lock, flags);
+
+	stat(s, ALLOC_PCS);
+	return object;
+}
+
+/* Hand a full remote sheaf over to its node, or free it there ourselves */
+static void remote_sheaf_put(struct kmem_cache *s, int node,
+			     struct slab_sheaf *sheaf)
+{
+	struct kmem_cache_node *n = get_node(s, node);
+
+	if (n && n->barn && barn_put(n->barn, sheaf, true)) {
+		stat(s, BARN_PUT_REMOTE);
+		return;
+	}
+	sheaf_flush(s, sheaf);
+	free_empty_sheaf(sheaf);
+}
+
+static bool free_to_remote_pcs(struct kmem_cache *s, int node, void *object)
+{
+	struct slub_percpu_sheaves *pcs;
+	struct slab_sheaf *sheaf, *full = NULL;
+	unsigned long flags;
+
+	local_lock_irqsave(&s->cpu_sheaves->lock, flags);
+	pcs = this_cpu_ptr(s->cpu_sheaves);
+	if (unlikely(!pcs->remote))
+		goto fail;
+	sheaf = pcs->remote[node];
+	if (!sheaf) {
+		sheaf = alloc_empty_sheaf(s, GFP_NOWAIT);
+		if (!sheaf)
+			goto fail;
+		pcs->remote[node] = sheaf;
+	}
+	sheaf->objects[sheaf->size++] = object;
+	if (sheaf->size == s->sheaf_capacity) {
+		full = sheaf;
+		pcs->remote[node] = NULL;
+	}
+	local_unlock_irqrestore(&s->cpu_sheaves->lock, flags);
+
+	if (full)
+		remote_sheaf_put(s, node, full);
+	stat(s, FREE_PCS_REMOTE);
+	return true;
+fail:
+	local_unlock_irqrestore(&s->cpu_sheaves->lock, flags);
+	return false;
+}
+
+static __fastpath_inline bool free_to_pcs(struct kmem_cache *s,
+					  struct slab *slab, void *object)
+{
+	void *objects[PCS_BATCH_MAX];
+	struct slub_percpu_sheaves *pcs;
+	unsigned int batch = 0;
+	struct slab_sheaf *main;
+	unsigned long flags;
+
+	/* Reserve objects go back to their slab, not to any allocation */
+	if (unlikely(slab_test_pfmemalloc(slab)))
+		return false;
+
+	if (unlikely(slab_nid(slab) != numa_mem_id()))
+		return free_to_remote_pcs(s, slab_nid(slab), object);
+
+	local_lock_irqsave(&s->cpu_sheaves->lock, flags);
+	pcs = this_cpu_ptr(s->cpu_sheaves);
+	main = pcs->main;
+	if (unlikely(main->size == s->sheaf_capacity)) {
+		if (pcs_swap_for_free(s, pcs)) {
+			main = pcs->main;
+		} else {
+			/* flush a batch from the top to make room */
+			batch = min(main->size, PCS_BATCH_MAX);
+			main->size -= batch;
+			memcpy(objects, &main->objects[main->size],
+			       batch * sizeof(void *));
+		}
+	}
+	main->objects[main->size++] = object;
+	local_unlock_irqrestore(&s->cpu_sheaves->lock, flags);
+
+	if (batch) {
+		__kmem_cache_free_bulk(s, batch, objects);
+		stat(s, SHEAF_FLUSH);
+	}
+	stat(s, FREE_PCS);
+	return true;
+}
+
+/* Flush the sheaves of the current cpu, from a flush work */
+static void pcs_flush_all(struct kmem_cache *s)
+{
+	void *objects[PCS_BATCH_MAX];
+	struct slub_percpu_sheaves *pcs;
+	struct slab_sheaf *spare;
+	unsigned int batch;
+	unsigned long flags;
+	int node;
+
+	local_lock_irqsave(&s->cpu_sheaves->lock, flags);
+	pcs = this_cpu_ptr(s->cpu_sheaves);
+	spare = pcs->spare;
+	pcs->spare = NULL;
+	local_unlock_irqrestore(&s->cpu_sheaves->lock, flags);
+
+	if (spare) {
+		sheaf_flush(s, spare);
+		free_empty_sheaf(spare);
+	}
+
+	for (node = 0; pcs->remote && node < nr_node_ids; node++) {
+		local_lock_irqsave(&s->cpu_sheaves->lock, flags);
+		pcs = this_cpu_ptr(s->cpu_sheaves);
+		spare = pcs->remote[node];
+		pcs->remote[node] = NULL;
+		local_unlock_irqrestore(&s->cpu_sheaves->lock, flags);
+
+		if (spare) {
+			sheaf_flush(s, spare);
+			free_empty_sheaf(spare);
+		}
+	}
+
+	do {
+		local_lock_irqsave(&s->cpu_sheaves->lock, flags);
+		pcs = this_cpu_ptr(s->cpu_sheaves);
+		batch = min(pcs->main->size, PCS_BATCH_MAX);
+		pcs->main->size -= batch;
+		memcpy(objects, &pcs->main->objects[pcs->main->size],
+		       batch * sizeof(void *));
+		local_unlock_irqrestore(&s->cpu_sheaves->lock, flags);
+
+		__kmem_cache_free_bulk(s, batch, objects);
+	} while (batch);
+}
+
+/* Flush the sheaves of a cpu that is gone, or of a cache being released */
+static void __pcs_flush_all_cpu(struct kmem_cache *s, int cpu)
+{
+	struct slub_percpu_sheaves *pcs = per_cpu_ptr(s->cpu_sheaves, cpu);
+	int node;
+
+	if (pcs->spare) {
+		sheaf_flush(s, pcs->spare);
+		free_empty_sheaf(pcs->spare);
+		pcs->spare = NULL;
+	}
+	if (pcs->main && pcs->main->size)
+		sheaf_flush(s, pcs->main);
+
+	for (node = 0; pcs->remote && node < nr_node_ids; node++) {
+		if (!pcs->remote[node])
+			continue;
+		sheaf_flush(s, pcs->remote[node]);
+		free_empty_sheaf(pcs->remote[node]);
+		pcs->remote[node] = NULL;
+	}
+}
+
+static bool pcs_has_objects(struct kmem_cache *s, int cpu)
+{
+	struct slub_percpu_sheaves *pcs;
+	int node;
+
+	if (!pcs_enabled(s))
+		return false;
+	pcs = per_cpu_ptr(s->cpu_sheaves, cpu);
+	if (data_race(pcs->main->size) || data_race(pcs->spare))
+		return true;
+	for (node = 0; pcs->remote && node < nr_node_ids; node++)
+		if (data_race(pcs->remote[node]))
+			return true;
+	return false;
+}
+
+static void barns_shrink(struct kmem_cache *s)
+{
+	struct kmem_cache_node *n;
+	int node;
+
+	for_each_kmem_cache_node(s, node, n)
+		if (n->barn)
+			barn_shrink(s, n->barn);
+}
+
+static int init_barn(struct kmem_cache *s, struct kmem_cache_node *n, int node)
+{
+	struct node_barn *barn;
+
+	if (!s->sheaf_capacity)
+		return 0;
+
+	barn = kmalloc_node(sizeof(*barn), GFP_KERNEL, node);
+	if (!barn)
+		return -ENOMEM;
+	spin_lock_init(&barn->lock);
+	INIT_LIST_HEAD(&barn->sheaves_full);
+	INIT_LIST_HEAD(&barn->sheaves_empty);
+	barn->nr_full = barn->nr_empty = 0;
+	n->barn = barn;
+	return 0;
+}
+
+static int init_percpu_sheaves(struct kmem_cache *s)
+{
+	int cpu;
+
+	if (!s->sheaf_capacity)
+		return 0;
+
+	s->cpu_sheaves = alloc_percpu(struct slub_percpu_sheaves);
+	if (!s->cpu_sheaves)
+		return -ENOMEM;
+
+	for_each_possible_cpu(cpu) {
+		struct slub_percpu_sheaves *pcs = per_cpu_ptr(s->cpu_sheaves, cpu);
+
+		local_lock_init(&pcs->lock);
+		pcs->main = alloc_empty_sheaf(s, GFP_KERNEL);
+		if (!pcs->main)
+			return -ENOMEM;
+		if (nr_node_ids > 1) {
+			pcs->remote = kcalloc_node(nr_node_ids, sizeof(*pcs->remote),
+						   GFP_KERNEL, cpu_to_node(cpu));
+			if (!pcs->remote)
+				return -ENOMEM;
+		}
+	}
+	return 0;
+}
+
+static void free_percpu_sheaves(struct kmem_cache *s)
+{
+	int cpu;
+
+	if (!s->cpu_sheaves)
+		return;
+
+	/* shutdown flushed them, or they were never used */
+	for_each_possible_cpu(cpu) {
+		struct slub_percpu_sheaves *pcs = per_cpu_ptr(s->cpu_sheaves, cpu);
+
+		kfree(pcs->main);
+		kfree(pcs->spare);
+		kfree(pcs->remote);
+	}
+	free_percpu(s->cpu_sheaves);
+	s->cpu_sheaves = NULL;
+}
+#else /* CONFIG_SLUB_TINY */
+static inline bool pcs_enabled(struct kmem_cache *s) { return false; }
+static inline void *alloc_from_pcs(struct kmem_cache *s, gfp_t gfp, int node)
+{
+	return NULL;
+}
+static inline bool free_to_pcs(struct kmem_cache *s, struct slab *slab,
+			       void *object)
+{
+	return false;
+}
+static inline void barns_shrink(struct kmem_cache *s) { }
+static inline int init_barn(struct kmem_cache *s, struct kmem_cache_node *n,
+			    int node)
+{
+	return 0;
+}
+#endif /* CONFIG_SLUB_TINY */
+
 /*
  * Tracks for which NUMA nodes we have kmem_cache_nodes allocated.
  * Corresponds to node_state[N_NORMAL_MEMORY], but can temporarily
@@ -3337,13 +3888,16 @@ static void flush_cpu_slab(struct work_struct *w)
 		flush_slab(s, c);
 
 	put_partials(s);
+
+	if (pcs_enabled(s))
+		pcs_flush_all(s);
 }
 
 static bool has_cpu_slab(int cpu, struct kmem_cache *s)
 {
 	struct kmem_cache_cpu *c = per_cpu_ptr(s->cpu_slab, cpu);
 
-	return c->slab || slub_percpu_partial(c);
+	return c->slab || slub_percpu_partial(c) || pcs_has_objects(s, cpu);
 }
 
 static DEFINE_MUTEX(flush_lock);
@@ -3395,8 +3949,11 @@ static int slub_cpu_dead(unsigned int cpu)
 	struct kmem_cache *s;
 
 	mutex_lock(&slab_mutex);
-	list_for_each_entry(s, &slab_caches, list)
+	list_for_each_entry(s, &slab_caches, list) {
 		__flush_cpu_slab(s, cpu);
+		if (pcs_enabled(s))
+			__pcs_flush_all_cpu(s, cpu);
+	}
 	mutex_unlock(&slab_mutex);
 	return 0;
 }
@@ -4181,7 +4738,10 @@ static __fastpath_inline void *slab_alloc_node(struct kmem_cache *s, struct list
 	if (unlikely(object))
 		goto out;
 
-	object = __slab_alloc_node(s, gfpflags, node, addr, orig_size);
+	if (pcs_enabled(s))
+		object = alloc_from_pcs(s, gfpflags, node);
+	if (!object)
+		object = __slab_alloc_node(s, gfpflags, node, addr, orig_size);
 
 	maybe_wipe_obj_freeptr(s, object);
 	init = slab_want_init_on_alloc(gfpflags, s);
@@ -4639,8 +5199,11 @@ void slab_free(struct kmem_cache *s, struct slab *slab, void *object,
 	memcg_slab_free_hook(s, slab, &object, 1);
 	alloc_tagging_slab_free_hook(s, slab, &object, 1);
 
-	if (likely(slab_free_hook(s, object, slab_want_init_on_free(s), false)))
-		do_slab_free(s, slab, object, object, 1, addr);
+	if (unlikely(!slab_free_hook(s, object, slab_want_init_on_free(s), false)))
+		return;
+	if (pcs_enabled(s) && free_to_pcs(s, slab, object))
+		return;
+	do_slab_free(s, slab, object, object, 1, addr);
 }
 
 #ifdef CONFIG_MEMCG
@@ -5520,6 +6083,7 @@ init_kmem_cache_node(struct kmem_cache_node *n)
 	atomic_long_set(&n->total_objects, 0);
 	INIT_LIST_HEAD(&n->full);
 #endif
+	n->barn = NULL;
 }
 
 #ifndef CONFIG_SLUB_TINY
@@ -5602,6 +6166,7 @@ static void free_kmem_cache_nodes(struct kmem_cache *s)
 
 	for_each_kmem_cache_node(s, node, n) {
 		s->node[node] = NULL;
+		kfree(n->barn);
 		kmem_cache_free(kmem_cache_node, n);
 	}
 }
@@ -5610,6 +6175,7 @@ void __kmem_cache_release(struct kmem_cache *s)
 {
 	cache_random_seq_destroy(s);
 #ifndef CONFIG_SLUB_TINY
+	free_percpu_sheaves(s);
 	free_percpu(s->cpu_slab);
 #endif
 	free_kmem_cache_nodes(s);
@@ -5636,6 +6202,10 @@ static int init_kmem_cache_nodes(struct kmem_cache *s)
 
 		init_kmem_cache_node(n);
 		s->node[node] = n;
+		if (init_barn(s, n, node)) {
+			free_kmem_cache_nodes(s);
+			return 0;
+		}
 	}
 	return 1;
 }
@@ -5889,6 +6459,7 @@ int __kmem_cache_shutdown(struct kmem_cache *s)
 	struct kmem_cache_node *n;
 
 	flush_all_cpus_locked(s);
+	barns_shrink(s);
 	/* Attempt to free all objects */
 	for_each_kmem_cache_node(s, node, n) {
 		free_partial(s, n);
@@ -6143,6 +6714,7 @@ static int __kmem_cache_do_shrink(struct kmem_cache *s)
 int __kmem_cache_shrink(struct kmem_cache *s)
 {
 	flush_all(s);
+	barns_shrink(s);
 	return __kmem_cache_do_shrink(s);
 }
 
@@ -6153,6 +6725,7 @@ static int slab_mem_going_offline_callback(void *arg)
 	mutex_lock(&slab_mutex);
 	list_for_each_entry(s, &slab_caches, list) {
 		flush_all_cpus_locked(s);
+		barns_shrink(s);
 		__kmem_cache_do_shrink(s);
 	}
 	mutex_unlock(&slab_mutex);
@@ -6224,6 +6797,10 @@ static int slab_mem_going_online_callback(void *arg)
 		}
 		init_kmem_cache_node(n);
 		s->node[nid] = n;
+		if (init_barn(s, n, nid)) {
+			ret = -ENOMEM;
+			goto out;
+		}
 	}
 	/*
 	 * Any cache created after this point will also have kmem_cache_node
@@ -6405,6 +6982,11 @@ int do_kmem_cache_create(struct kmem_cache *s, const char *name,
 #endif
 	s->align = args->align;
 	s->ctor = args->ctor;
+#ifndef CONFIG_SLUB_TINY
+	/* debugging wants to see every alloc and free, sheaves would hide them */
+	if (!kmem_cache_debug(s))
+		s->sheaf_capacity = args->sheaf_capacity;
+#endif
 #ifdef CONFIG_HARDENED_USERCOPY
 	s->useroffset = args->useroffset;
 	s->usersize = args->usersize;
@@ -6457,6 +7039,11 @@ int do_kmem_cache_create(struct kmem_cache *s, const char *name,
 	if (!alloc_kmem_cache_cpus(s))
 		goto out;
 
+#ifndef CONFIG_SLUB_TINY
+	if (init_percpu_sheaves(s))
+		goto out;
+#endif
+
 	err = 0;
 
 	/* Mutex is not taken during early boot */
@@ -6929,6 +7516,12 @@ static ssize_t min_partial_store(struct kmem_cache *s, const char *buf,
 }
 SLAB_ATTR(min_partial);
 
+static ssize_t sheaf_capacity_show(struct kmem_cache *s, char *buf)
+{
+	return sysfs_emit(buf, "%u\n", s->sheaf_capacity);
+}
+SLAB_ATTR_RO(sheaf_capacity);
+
 static ssize_t cpu_partial_show(struct kmem_cache *s, char *buf)
 {
 	unsigned int nr_partial = 0;
@@ -7282,6 +7875,14 @@ STAT_ATTR(CPU_PARTIAL_ALLOC, cpu_partial_alloc);
 STAT_ATTR(CPU_PARTIAL_FREE, cpu_partial_free);
 STAT_ATTR(CPU_PARTIAL_NODE, cpu_partial_node);
 STAT_ATTR(CPU_PARTIAL_DRAIN, cpu_partial_drain);
+STAT_ATTR(ALLOC_PCS, alloc_cpu_sheaf);
+STAT_ATTR(FREE_PCS, free_cpu_sheaf);
+STAT_ATTR(SHEAF_REFILL, sheaf_refill);
+STAT_ATTR(SHEAF_FLUSH, sheaf_flush);
+STAT_ATTR(BARN_GET, barn_get);
+STAT_ATTR(BARN_PUT, barn_put);
+STAT_ATTR(FREE_PCS_REMOTE, free_cpu_sheaf_remote);
+STAT_ATTR(BARN_PUT_REMOTE, barn_put_remote);
 #endif	/* CONFIG_SLUB_STATS */
 
 #ifdef CONFIG_KFENCE
@@ -7313,6 +7914,7 @@ static struct attribute *slab_attrs[] = {
 	&objs_per_slab_attr.attr,
 	&order_attr.attr,
 	&min_partial_attr.attr,
+	&sheaf_capacity_attr.attr,
 	&cpu_partial_attr.attr,
 	&objects_partial_attr.attr,
 	&partial_attr.attr,
@@ -7369,6 +7971,14 @@ static struct attribute *slab_attrs[] = {
 	&cpu_partial_free_attr.attr,
 	&cpu_partial_node_attr.attr,
 	&cpu_partial_drain_attr.attr,
+	&alloc_cpu_sheaf_attr.attr,
+	&free_cpu_sheaf_attr.attr,
+	&sheaf_refill_attr.attr,
+	&sheaf_flush_attr.attr,
+	&barn_get_attr.attr,
+	&barn_put_attr.attr,
+	&free_cpu_sheaf_remote_attr.attr,
+	&barn_put_remote_attr.attr,
 #endif
 #ifdef CONFIG_FAILSLAB
 	&failslab_attr.attr,
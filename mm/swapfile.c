@@ -475,6 +475,10 @@ static void move_cluster(struct swap_info_struct *si,
 		atomic_long_dec(&si->frag_cluster_nr[ci->order]);
 	else if (new_flags == CLUSTER_FLAG_FRAG)
 		atomic_long_inc(&si->frag_cluster_nr[ci->order]);
+	if (ci->flags == CLUSTER_FLAG_FREE)
+		atomic_long_dec(&si->free_cluster_nr);
+	else if (new_flags == CLUSTER_FLAG_FREE)
+		atomic_long_inc(&si->free_cluster_nr);
 	ci->flags = new_flags;
 }
 
@@ -523,6 +527,8 @@ static struct swap_cluster_info *isolate_lock_cluster(
 			  ci->flags != CLUSTER_FLAG_FULL);
 
 		list_del(&ci->list);
+		if (ci->flags == CLUSTER_FLAG_FREE)
+			atomic_long_dec(&si->free_cluster_nr);
 		ci->flags = CLUSTER_FLAG_NONE;
 		ret = ci;
 		break;
@@ -874,6 +880,106 @@ static void swap_reclaim_work(struct work_struct *work)
 	swap_reclaim_full_clusters(si, true);
 }
 
+/*
+ * Number of free clusters that order 0 allocations leave to large folios, so
+ * that their swap-out keeps finding whole clusters instead of splitting.
+ */
+unsigned int swap_cluster_reserve __read_mostly = 16;
+
+#define SWAP_DEFRAG_BATCH	64
+
+static bool swap_cluster_reserved(struct swap_info_struct *si)
+{
+	unsigned long reserve = READ_ONCE(swap_cluster_reserve);
+
+	/* Only block devices can have large entries allocated */
+	if (!IS_ENABLED(CONFIG_THP_SWAP) || !(si->flags & SWP_BLKDEV))
+		return false;
+
+	/* Never hold back more than 1/32 of the device */
+	reserve = min(reserve, si->pages / SWAPFILE_CLUSTER / 32);
+	return reserve && atomic_long_read(&si->free_cluster_nr) <= reserve;
+}
+
+/* Whether all used slots in the range are only pinned by the swap cache */
+static bool cluster_cache_only(struct swap_info_struct *si,
+			       unsigned long offset, unsigned long end)
+{
+	unsigned char *map = si->swap_map;
+
+	for (; offset < end; offset++) {
+		unsigned char count = READ_ONCE(map[offset]);
+
+		if (count && count != SWAP_HAS_CACHE)
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * Free fragmented clusters whose used slots only hold swap cache, e.g.
+ * left behind by swap-in, until the free clusters are over the reserve
+ * again. Large folios can't use such a cluster before all of its slots are
+ * freed, while the order 0 allocations that would eventually free it keep
+ * consuming the free clusters.
+ */
+static void swap_defrag_clusters(struct swap_info_struct *si)
+{
+	unsigned char *map = si->swap_map;
+	struct swap_cluster_info *ci;
+	unsigned long offset, end;
+	long to_scan = SWAP_DEFRAG_BATCH, nr_frags;
+	int order, nr_reclaim;
+
+	for (order = SWAP_NR_ORDERS - 1; order >= 0; order--) {
+		nr_frags = atomic_long_read(&si->frag_cluster_nr[order]);
+		while (nr_frags-- > 0 && to_scan-- > 0 &&
+		       swap_cluster_reserved(si) &&
+		       (ci = isolate_lock_cluster(si, &si->frag_clusters[order]))) {
+			atomic_long_dec(&si->frag_cluster_nr[order]);
+			offset = cluster_offset(si, ci);
+			end = min(si->max, offset + SWAPFILE_CLUSTER);
+
+			if (!cluster_cache_only(si, offset, end))
+				offset = end;
+
+			while (offset < end) {
+				if (READ_ONCE(map[offset]) == SWAP_HAS_CACHE) {
+					spin_unlock(&ci->lock);
+					nr_reclaim = __try_to_reclaim_swap(si, offset,
+									   TTRS_ANYWAY);
+					spin_lock(&ci->lock);
+					if (nr_reclaim > 0) {
+						offset += nr_reclaim;
+						continue;
+					}
+					/* A busy folio keeps the cluster in use */
+					if (nr_reclaim < 0)
+						break;
+				}
+				offset++;
+			}
+
+			/* Freeing its last slot moved it to the free list */
+			if (!ci->count)
+				count_mthp_stat(order, MTHP_STAT_SWPOUT_DEFRAG);
+			else if (ci->flags == CLUSTER_FLAG_NONE)
+				relocate_cluster(si, ci);
+			unlock_cluster(ci);
+		}
+	}
+}
+
+static void swap_defrag_work(struct work_struct *work)
+{
+	struct swap_info_struct *si;
+
+	si = container_of(work, struct swap_info_struct, defrag_work);
+
+	swap_defrag_clusters(si);
+}
+
 /*
  * Try to allocate swap entries with specified order and try set a new
  * cluster for current CPU too.
@@ -913,12 +1019,18 @@ static unsigned long cluster_alloc_swap_entry(struct swap_info_struct *si, int o
 	}
 
 new_cluster:
-	ci = isolate_lock_cluster(si, &si->free_clusters);
-	if (ci) {
-		found = alloc_swap_scan_cluster(si, ci, cluster_offset(si, ci),
-						order, usage);
-		if (found)
-			goto done;
+	/*
+	 * Order 0 allocations leave the reserved free clusters to large
+	 * folios, and only fall back to them once nothing else is usable.
+	 */
+	if (order || !swap_cluster_reserved(si)) {
+		ci = isolate_lock_cluster(si, &si->free_clusters);
+		if (ci) {
+			found = alloc_swap_scan_cluster(si, ci, cluster_offset(si, ci),
+							order, usage);
+			if (found)
+				goto done;
+		}
 	}
 
 	/* Try reclaim from full clusters if free clusters list is drained */
@@ -966,6 +1078,16 @@ static unsigned long cluster_alloc_swap_entry(struct swap_info_struct *si, int o
 	if (order)
 		goto done;
 
+	if (swap_cluster_reserved(si)) {
+		ci = isolate_lock_cluster(si, &si->free_clusters);
+		if (ci) {
+			found = alloc_swap_scan_cluster(si, ci, cluster_offset(si, ci),
+							0, usage);
+			if (found)
+				goto done;
+		}
+	}
+
 	/* Order 0 stealing from higher order */
 	for (int o = 1; o < SWAP_NR_ORDERS; o++) {
 		/*
@@ -990,6 +1112,9 @@ static unsigned long cluster_alloc_swap_entry(struct swap_info_struct *si, int o
 done:
 	if (!(si->flags & SWP_SOLIDSTATE))
 		spin_unlock(&si->global_cluster_lock);
+	/* Refill the reserve in the background once large folios dip into it */
+	if (order && swap_cluster_reserved(si))
+		schedule_work(&si->defrag_work);
 	return found;
 }
 
@@ -2765,6 +2890,7 @@ SYSCALL_DEFINE1(swapoff, const char __user *, specialfile)
 
 	flush_work(&p->discard_work);
 	flush_work(&p->reclaim_work);
+	flush_work(&p->defrag_work);
 	flush_percpu_swap_cluster(p);
 
 	destroy_swap_extents(p);
@@ -3233,6 +3359,7 @@ static struct swap_cluster_info *setup_clusters(struct swap_info_struct *si,
 		INIT_LIST_HEAD(&si->frag_clusters[i]);
 		atomic_long_set(&si->frag_cluster_nr[i], 0);
 	}
+	atomic_long_set(&si->free_cluster_nr, 0);
 
 	/*
 	 * Reduce false cache line sharing between cluster_info and
@@ -3252,6 +3379,7 @@ static struct swap_cluster_info *setup_clusters(struct swap_info_struct *si,
 			}
 			ci->flags = CLUSTER_FLAG_FREE;
 			list_add_tail(&ci->list, &si->free_clusters);
+			atomic_long_inc(&si->free_cluster_nr);
 		}
 	}
 
@@ -3298,6 +3426,7 @@ SYSCALL_DEFINE2(swapon, const char __user *, specialfile, int, swap_flags)
 
 	INIT_WORK(&si->discard_work, swap_discard_work);
 	INIT_WORK(&si->reclaim_work, swap_reclaim_work);
+	INIT_WORK(&si->defrag_work, swap_defrag_work);
 
 	name = getname(specialfile);
 	if (IS_ERR(name)) {
@@ -890,6 +890,7 @@ static struct vmap_node {
 	/* Bookkeeping data of this node. */
 	struct rb_list busy;
 	struct rb_list lazy;
+	atomic_long_t nr_lazy;
 
 	/*
 	 * Ready-to-free areas.
@@ -2110,6 +2111,14 @@ static unsigned long lazy_max_pages(void)
 
 static atomic_long_t vmap_lazy_nr = ATOMIC_LONG_INIT(0);
 
+/*
+ * Latency histogram of the purges that freed anything: bucket 0 counts the
+ * purges that took less than 1us, bucket i the ones that took [2^(i-1), 2^i)
+ * microseconds and the last bucket everything slower.
+ */
+#define NR_PURGE_LATENCY_BUCKETS	16
+static unsigned long purge_latency_hist[NR_PURGE_LATENCY_BUCKETS];
+
 /*
  * Serialize vmap purging.  There is no actual critical section protected
  * by this lock, but we want to avoid concurrent calls for performance
@@ -2239,21 +2248,35 @@ static void purge_vmap_node(struct work_struct *work)
 		list_add(&va->list, &local_list);
 	}
 
+	atomic_long_sub(nr_purged_pages, &vn->nr_lazy);
 	atomic_long_sub(nr_purged_pages, &vmap_lazy_nr);
 
 	reclaim_list_global(&local_list);
 }
 
+static void account_purge_latency(u64 ns)
+{
+	unsigned int i;
+
+	lockdep_assert_held(&vmap_purge_lock);
+
+	i = min_t(unsigned int, fls64(div_u64(ns, NSEC_PER_USEC)),
+		  NR_PURGE_LATENCY_BUCKETS - 1);
+	WRITE_ONCE(purge_latency_hist[i], purge_latency_hist[i] + 1);
+}
+
 /*
- * Purges all lazily-freed vmap areas.
+ * Purges the lazily-freed vmap areas of all nodes holding at least
+ * nr_lazy_min lazy pages, with one TLB flush covering just those nodes.
  */
 static bool __purge_vmap_area_lazy(unsigned long start, unsigned long end,
-		bool full_pool_decay)
+		bool full_pool_decay, unsigned long nr_lazy_min)
 {
 	unsigned long nr_purged_areas = 0;
 	unsigned int nr_purge_helpers;
 	unsigned int nr_purge_nodes;
 	struct vmap_node *vn;
+	u64 time = ktime_get_ns();
 	int i;
 
 	lockdep_assert_held(&vmap_purge_lock);
@@ -2267,6 +2290,9 @@ static bool __purge_vmap_area_lazy(unsigned long start, unsigned long end,
 		vn = &vmap_nodes[i];
 
 		INIT_LIST_HEAD(&vn->purge_list);
+		if (atomic_long_read(&vn->nr_lazy) < nr_lazy_min)
+			continue;
+
 		vn->skip_populate = full_pool_decay;
 		decay_va_pool_node(vn, full_pool_decay);
 
@@ -2324,6 +2350,9 @@ static bool __purge_vmap_area_lazy(unsigned long start, unsigned long end,
 		}
 	}
 
+	if (nr_purged_areas)
+		account_purge_latency(ktime_get_ns() - time);
+
 	trace_purge_vmap_area_lazy(start, end, nr_purged_areas);
 	return nr_purged_areas > 0;
 }
@@ -2336,14 +2365,28 @@ static void reclaim_and_purge_vmap_areas(void)
 {
 	mutex_lock(&vmap_purge_lock);
 	purge_fragmented_blocks_allcpus();
-	__purge_vmap_area_lazy(ULONG_MAX, 0, true);
+	__purge_vmap_area_lazy(ULONG_MAX, 0, true, 0);
 	mutex_unlock(&vmap_purge_lock);
 }
 
 static void drain_vmap_area_work(struct work_struct *work)
 {
-	mutex_lock(&vmap_purge_lock);
-	__purge_vmap_area_lazy(ULONG_MAX, 0, false);
+	/*
+	 * Whoever holds the lock is purging all nodes already, and queuing
+	 * up behind it only delays the allocators that wait for a purge. If
+	 * that purge leaves too much behind, the next free schedules us
+	 * again.
+	 */
+	if (!mutex_trylock(&vmap_purge_lock))
+		return;
+
+	/*
+	 * Only purge the nodes holding more than their share of the lazy
+	 * pages: at least one of them does once the threshold is crossed,
+	 * and the others are not worth walking and flushing for.
+	 */
+	__purge_vmap_area_lazy(ULONG_MAX, 0, false,
+			       lazy_max_pages() / nr_vmap_nodes);
 	mutex_unlock(&vmap_purge_lock);
 }
 
@@ -2372,6 +2415,7 @@ static void free_vmap_area_noflush(struct vmap_area *va)
 	 */
 	vn = is_vn_id_valid(vn_id) ?
 		id_to_node(vn_id):addr_to_node(va->va_start);
+	atomic_long_add(va_size(va) >> PAGE_SHIFT, &vn->nr_lazy);
 
 	spin_lock(&vn->lazy.lock);
 	insert_vmap_area(va, &vn->lazy.root, &vn->lazy.head);
@@ -2904,7 +2948,7 @@ static void _vm_unmap_aliases(unsigned long start, unsigned long end, int flush)
 	}
 	free_purged_blocks(&purge_list);
 
-	if (!__purge_vmap_area_lazy(start, end, false) && flush)
+	if (!__purge_vmap_area_lazy(start, end, false, 0) && flush)
 		flush_tlb_kernel_range(start, end);
 	mutex_unlock(&vmap_purge_lock);
 }
@@ -4986,6 +5030,21 @@ static void show_purge_info(struct seq_file *m)
 	}
 }
 
+static void show_purge_latency(struct seq_file *m)
+{
+	int i;
+
+	seq_puts(m, "purge_latency_us <1:");
+	for (i = 0; i < NR_PURGE_LATENCY_BUCKETS; i++) {
+		if (i == NR_PURGE_LATENCY_BUCKETS - 1)
+			seq_printf(m, " >=%u:", 1U << (i - 1));
+		else if (i)
+			seq_printf(m, " <%u:", 1U << i);
+		seq_printf(m, "%lu", READ_ONCE(purge_latency_hist[i]));
+	}
+	seq_putc(m, '\n');
+}
+
 static int vmalloc_info_show(struct seq_file *m, void *p)
 {
 	struct vmap_node *vn;
@@ -5063,6 +5122,7 @@ static int vmalloc_info_show(struct seq_file *m, void *p)
 	 * As a final step, dump "unpurged" areas.
 	 */
 	show_purge_info(m);
+	show_purge_latency(m);
 	if (IS_ENABLED(CONFIG_NUMA))
 		kfree(counters);
 	return 0;
@@ -5163,6 +5223,7 @@ static void vmap_init_nodes(void)
 		vn->lazy.root = RB_ROOT;
 		INIT_LIST_HEAD(&vn->lazy.head);
 		spin_lock_init(&vn->lazy.lock);
+		atomic_long_set(&vn->nr_lazy, 0);
 
 		for (i = 0; i < MAX_VA_SIZE_PAGES; i++) {
 			INIT_LIST_HEAD(&vn->pool[i].head);
@@ -151,6 +151,9 @@ struct scan_control {
 	/* Always discard instead of demoting to lower tier memory */
 	unsigned int no_demotion:1;
 
+	/* A task stalls in this reclaim, account it in memory.reclaim_stat */
+	unsigned int account_stall:1;
+
 	/* Allocation order */
 	s8 order;
 
@@ -169,6 +172,9 @@ struct scan_control {
 	/* Number of pages freed so far during a call to shrink_zones() */
 	unsigned long nr_reclaimed;
 
+	/* Time spent in each phase if account_stall is set */
+	u64 stall_ns[MEMCG_NR_STALL_PHASES];
+
 	struct {
 		unsigned int dirty;
 		unsigned int unqueued_dirty;
@@ -608,6 +614,54 @@ void reclaim_throttle(pg_data_t *pgdat, enum vmscan_throttle_state reason)
 				reason);
 }
 
+static u64 stall_clock(struct scan_control *sc)
+{
+	return sc->account_stall ? ktime_get_ns() : 0;
+}
+
+static void stall_account(struct scan_control *sc,
+			  enum memcg_stall_phase phase, u64 start)
+{
+	if (sc->account_stall)
+		sc->stall_ns[phase] += ktime_get_ns() - start;
+}
+
+static void sc_reclaim_throttle(struct scan_control *sc, pg_data_t *pgdat,
+				enum vmscan_throttle_state reason)
+{
+	u64 start = stall_clock(sc);
+
+	reclaim_throttle(pgdat, reason);
+	stall_account(sc, MEMCG_STALL_THROTTLE, start);
+}
+
+static void sc_shrink_slab(struct scan_control *sc, int nid,
+			   struct mem_cgroup *memcg)
+{
+	u64 start = stall_clock(sc);
+
+	shrink_slab(sc->gfp_mask, nid, memcg, sc->priority);
+	stall_account(sc, MEMCG_STALL_SHRINKER, start);
+}
+
+/*
+ * The LRU phase is what is left of the reclaim once the shrinkers and the
+ * throttling are taken out, as those run nested in the LRU scanning.
+ */
+static void account_direct_stall(struct scan_control *sc, u64 start)
+{
+	u64 *ns = sc->stall_ns;
+
+	if (!sc->account_stall)
+		return;
+
+	ns[MEMCG_STALL_RECLAIM] = ktime_get_ns() - start;
+	ns[MEMCG_STALL_LRU] = ns[MEMCG_STALL_RECLAIM] -
+		min(ns[MEMCG_STALL_RECLAIM],
+		    ns[MEMCG_STALL_SHRINKER] + ns[MEMCG_STALL_THROTTLE]);
+	mem_cgroup_account_stall(ns);
+}
+
 /*
  * Account for folios written if tasks are throttled waiting on dirty
  * folios to clean. If enough folios have been cleaned since throttling
@@ -2013,7 +2067,7 @@ static unsigned long shrink_inactive_list(unsigned long nr_to_scan,
 
 		/* wait a bit for the reclaimer. */
 		stalled = true;
-		reclaim_throttle(pgdat, VMSCAN_THROTTLE_ISOLATED);
+		sc_reclaim_throttle(sc, pgdat, VMSCAN_THROTTLE_ISOLATED);
 
 		/* We are about to die and free our memory. Return now. */
 		if (fatal_signal_pending(current))
@@ -2079,7 +2133,7 @@ static unsigned long shrink_inactive_list(unsigned long nr_to_scan,
 		 * on a large system.
 		 */
 		if (!writeback_throttling_sane(sc))
-			reclaim_throttle(pgdat, VMSCAN_THROTTLE_WRITEBACK);
+			sc_reclaim_throttle(sc, pgdat, VMSCAN_THROTTLE_WRITEBACK);
 	}
 
 	sc->nr.dirty += stat.nr_dirty;
@@ -2844,6 +2898,80 @@ static void update_bloom_filter(struct lru_gen_mm_state *mm_state, unsigned long
 		set_bit(key[1], filter);
 }
 
+/*
+ * The Bloom filters only remember the last iteration, so every iteration still
+ * visits all PMD entries of large and mostly idle address spaces, only to find
+ * them not in the filter. The cold filter counts, in 8-bit counters indexed
+ * like the Bloom filters but by PUD entry, how many iterations in a row the
+ * PMD table under a PUD entry had neither young entries nor entries in the
+ * Bloom filter. Once that reaches COLD_FILTER_GENS, the walk skips the table
+ * for COLD_FILTER_GENS iterations, then walks it once more to revalidate. A
+ * warm walk of the table, or a report from lru_gen_look_around(), resets the
+ * count. Collisions take the lower count and, at worst, cause extra walks.
+ */
+#define COLD_FILTER_SHIFT	12
+#define COLD_FILTER_GENS	4
+
+static int get_cold_count(u8 *filter, void *item, int *key)
+{
+	u32 hash = hash_ptr(item, COLD_FILTER_SHIFT * 2);
+
+	BUILD_BUG_ON(COLD_FILTER_GENS * 2 > U8_MAX);
+
+	key[0] = hash & (BIT(COLD_FILTER_SHIFT) - 1);
+	key[1] = hash >> COLD_FILTER_SHIFT;
+
+	return min(READ_ONCE(filter[key[0]]), READ_ONCE(filter[key[1]]));
+}
+
+static void set_cold_count(u8 *filter, int *key, int cold)
+{
+	if (READ_ONCE(filter[key[0]]) != cold)
+		WRITE_ONCE(filter[key[0]], cold);
+	if (READ_ONCE(filter[key[1]]) != cold)
+		WRITE_ONCE(filter[key[1]], cold);
+}
+
+/* returns true if the PMD table under @item should not be walked */
+static bool test_cold_filter(struct lru_gen_mm_state *mm_state, void *item)
+{
+	int key[2];
+	int cold;
+	u8 *filter = READ_ONCE(mm_state->cold_filter);
+
+	if (!filter)
+		return false;
+
+	cold = get_cold_count(filter, item, key);
+	if (cold < COLD_FILTER_GENS)
+		return false;
+
+	if (cold + 1 == COLD_FILTER_GENS * 2) {
+		set_cold_count(filter, key, COLD_FILTER_GENS - 1);
+		return false;
+	}
+
+	set_cold_count(filter, key, cold + 1);
+
+	return true;
+}
+
+static void update_cold_filter(struct lru_gen_mm_state *mm_state, void *item, bool warm)
+{
+	int key[2];
+	int cold;
+	u8 *filter = READ_ONCE(mm_state->cold_filter);
+
+	if (!filter)
+		return;
+
+	cold = get_cold_count(filter, item, key);
+	if (warm)
+		set_cold_count(filter, key, 0);
+	else if (cold < COLD_FILTER_GENS)
+		set_cold_count(filter, key, cold + 1);
+}
+
 static void reset_bloom_filter(struct lru_gen_mm_state *mm_state, unsigned long seq)
 {
 	unsigned long *filter;
@@ -2858,6 +2986,12 @@ static void reset_bloom_filter(struct lru_gen_mm_state *mm_state, unsigned long
 	filter = bitmap_zalloc(BIT(BLOOM_FILTER_SHIFT),
 			       __GFP_HIGH | __GFP_NOMEMALLOC | __GFP_NOWARN);
 	WRITE_ONCE(mm_state->filters[gen], filter);
+
+	/* unlike the Bloom filters, the cold filter carries over */
+	if (!mm_state->cold_filter)
+		WRITE_ONCE(mm_state->cold_filter,
+			   kzalloc(BIT(COLD_FILTER_SHIFT),
+				   __GFP_HIGH | __GFP_NOMEMALLOC | __GFP_NOWARN));
 }
 
 /******************************************************************************
@@ -3378,11 +3512,16 @@ static bool get_next_vma(unsigned long mask, unsigned long size, struct mm_walk
 {
 	unsigned long start = round_up(*vm_end, size);
 	unsigned long end = (start | ~mask) + 1;
+	struct lru_gen_mm_walk *walk = args->private;
 	VMA_ITERATOR(vmi, args->mm, start);
 
 	VM_WARN_ON_ONCE(mask & size);
 	VM_WARN_ON_ONCE((start & mask) != (*vm_start & mask));
 
+	/* the other VMAs are not locked */
+	if (walk->vma_locked)
+		return false;
+
 	for_each_vma(vmi, args->vma) {
 		if (end && end <= args->vma->vm_start)
 			return false;
@@ -3574,6 +3713,10 @@ static bool walk_pte_range(pmd_t *pmd, unsigned long start, unsigned long end,
 	arch_leave_lazy_mmu_mode();
 	pte_unmap_unlock(pte, ptl);
 
+	/* a hot PTE table is a good candidate for a collapse */
+	if (young)
+		khugepaged_hot_range(args->vma, start, young);
+
 	return suitable_to_scan(total, young);
 }
 
@@ -3665,7 +3808,8 @@ static void walk_pmd_range_locked(pud_t *pud, unsigned long addr, struct vm_area
 	*first = -1;
 }
 
-static void walk_pmd_range(pud_t *pud, unsigned long start, unsigned long end,
+/* returns true if the PMD table had young entries or entries in the Bloom filter */
+static bool walk_pmd_range(pud_t *pud, unsigned long start, unsigned long end,
 			   struct mm_walk *args)
 {
 	int i;
@@ -3677,6 +3821,8 @@ static void walk_pmd_range(pud_t *pud, unsigned long start, unsigned long end,
 	unsigned long first = -1;
 	struct lru_gen_mm_walk *walk = args->private;
 	struct lru_gen_mm_state *mm_state = get_mm_state(walk->lruvec);
+	int young = walk->mm_stats[MM_LEAF_YOUNG];
+	bool warm = false;
 
 	VM_WARN_ON_ONCE(pud_leaf(*pud));
 
@@ -3715,12 +3861,14 @@ static void walk_pmd_range(pud_t *pud, unsigned long start, unsigned long end,
 			if (!pmd_young(val))
 				continue;
 
+			warm = true;
 			walk_pmd_range_locked(pud, addr, vma, args, bitmap, &first);
 		}
 
 		if (!walk->force_scan && !test_bloom_filter(mm_state, walk->seq, pmd + i))
 			continue;
 
+		warm = true;
 		walk->mm_stats[MM_NONLEAF_FOUND]++;
 
 		if (!walk_pte_range(&val, addr, next, args))
@@ -3736,6 +3884,8 @@ static void walk_pmd_range(pud_t *pud, unsigned long start, unsigned long end,
 
 	if (i < PTRS_PER_PMD && get_next_vma(PUD_MASK, PMD_SIZE, args, &start, &end))
 		goto restart;
+
+	return warm || walk->mm_stats[MM_LEAF_YOUNG] != young;
 }
 
 static int walk_pud_range(p4d_t *p4d, unsigned long start, unsigned long end,
@@ -3745,7 +3895,9 @@ static int walk_pud_range(p4d_t *p4d, unsigned long start, unsigned long end,
 	pud_t *pud;
 	unsigned long addr;
 	unsigned long next;
+	bool warm;
 	struct lru_gen_mm_walk *walk = args->private;
+	struct lru_gen_mm_state *mm_state = get_mm_state(walk->lruvec);
 
 	VM_WARN_ON_ONCE(p4d_leaf(*p4d));
 
@@ -3759,7 +3911,12 @@ static int walk_pud_range(p4d_t *p4d, unsigned long start, unsigned long end,
 		if (!pud_present(val) || WARN_ON_ONCE(pud_leaf(val)))
 			continue;
 
-		walk_pmd_range(&val, addr, next, args);
+		if (!walk->force_scan && test_cold_filter(mm_state, pud + i))
+			continue;
+
+		warm = walk_pmd_range(&val, addr, next, args);
+
+		update_cold_filter(mm_state, pud + i, warm);
 
 		if (need_resched() || walk->batched >= MAX_LRU_BATCH) {
 			end = (addr | ~PUD_MASK) + 1;
@@ -3780,6 +3937,66 @@ static int walk_pud_range(p4d_t *p4d, unsigned long start, unsigned long end,
 	return -EAGAIN;
 }
 
+#ifdef CONFIG_PER_VMA_LOCK
+/*
+ * If mmap_lock is not available, e.g., because the process keeps mapping and
+ * unmapping, walk the next VMA under its per-VMA read lock instead, like page
+ * faults do. The walk stays within that VMA and returns -EAGAIN to continue
+ * with the next one, or 0 after the last one.
+ */
+static int walk_mm_vma_locked(struct mm_struct *mm, struct lru_gen_mm_walk *walk)
+{
+	static const struct mm_walk_ops mm_walk_vma_ops = {
+		.p4d_entry = walk_pud_range,
+		.walk_lock = PGWALK_VMA_RDLOCK_VERIFY,
+	};
+	int err = -EAGAIN;
+	unsigned long start = walk->next_addr;
+	unsigned long end;
+	struct vm_area_struct *vma;
+	struct mm_walk args = {
+		.mm = mm,
+		.private = walk,
+	};
+
+	/* only a hint, lock_vma_under_rcu() looks the VMA up again */
+	rcu_read_lock();
+	vma = mt_find(&mm->mm_mt, &start, ULONG_MAX);
+	if (vma)
+		start = max(walk->next_addr, vma->vm_start);
+	rcu_read_unlock();
+
+	if (!vma)
+		return 0;
+
+	vma = lock_vma_under_rcu(mm, start);
+	if (!vma)
+		return -EBUSY;
+
+	end = vma->vm_end;
+	args.vma = vma;
+
+	if (!should_skip_vma(start, end, &args)) {
+		walk->vma_locked = true;
+		err = walk_page_range_vma(vma, start, end, &mm_walk_vma_ops, walk);
+		walk->vma_locked = false;
+	}
+
+	vma_end_read(vma);
+
+	/* walk_pud_range() rounds up to P4D_SIZE past the end of the VMA */
+	if (err != -EAGAIN || walk->next_addr > end)
+		walk->next_addr = end;
+
+	return -EAGAIN;
+}
+#else
+static int walk_mm_vma_locked(struct mm_struct *mm, struct lru_gen_mm_walk *walk)
+{
+	return -EBUSY;
+}
+#endif
+
 static void walk_mm(struct mm_struct *mm, struct lru_gen_mm_walk *walk)
 {
 	static const struct mm_walk_ops mm_walk_ops = {
@@ -3806,6 +4023,8 @@ static void walk_mm(struct mm_struct *mm, struct lru_gen_mm_walk *walk)
 			err = walk_page_range(mm, walk->next_addr, ULONG_MAX, &mm_walk_ops, walk);
 
 			mmap_read_unlock(mm);
+		} else {
+			err = walk_mm_vma_locked(mm, walk);
 		}
 
 		if (walk->batched) {
@@ -4280,8 +4499,12 @@ bool lru_gen_look_around(struct page_vma_mapped_walk *pvmw)
 	arch_leave_lazy_mmu_mode();
 
 	/* feedback from rmap walkers to page table walkers */
-	if (mm_state && suitable_to_scan(i, young))
+	if (mm_state && suitable_to_scan(i, young)) {
+		pud_t *pud = pud_offset(p4d_offset(pgd_offset(vma->vm_mm, start), start), start);
+
 		update_bloom_filter(mm_state, max_seq, pvmw->pmd);
+		update_cold_filter(mm_state, pud, true);
+	}
 
 	return true;
 }
@@ -4911,7 +5134,7 @@ static int shrink_one(struct lruvec *lruvec, struct scan_control *sc)
 
 	success = try_to_shrink_lruvec(lruvec, sc);
 
-	shrink_slab(sc->gfp_mask, pgdat->node_id, memcg, sc->priority);
+	sc_shrink_slab(sc, pgdat->node_id, memcg);
 
 	if (!sc->proactive)
 		vmpressure(sc->gfp_mask, memcg, false, sc->nr_scanned - scanned,
@@ -5201,6 +5424,122 @@ static void lru_gen_change_state(bool enabled)
 	cgroup_unlock();
 }
 
+/******************************************************************************
+ *                          proactive aging
+ ******************************************************************************/
+
+/*
+ * When aging_interval_ms is set, every node gets a max_seq increment of all its
+ * memcgs once per interval, whether or not there is memory pressure. Each
+ * generation then roughly covers one interval, and the number of pages in the
+ * youngest N generations of a memcg estimates its working set over the last
+ * N intervals, which memory.working_set reports.
+ */
+static unsigned long lru_gen_aging_interval __read_mostly;
+static struct work_struct *lru_gen_aging_works;
+
+static void lru_gen_aging_workfn(struct work_struct *work);
+static DECLARE_DELAYED_WORK(lru_gen_aging_dwork, lru_gen_aging_workfn);
+
+static void lru_gen_age_node_proactive(struct work_struct *work)
+{
+	int nid = work - lru_gen_aging_works;
+	struct pglist_data *pgdat = NODE_DATA(nid);
+	struct mem_cgroup *memcg;
+	unsigned int flags;
+	struct scan_control sc = {
+		.may_writepage = true,
+		.may_unmap = true,
+		.may_swap = true,
+		.reclaim_idx = MAX_NR_ZONES - 1,
+		.gfp_mask = GFP_KERNEL,
+	};
+
+	set_task_reclaim_state(current, &sc.reclaim_state);
+	flags = memalloc_noreclaim_save();
+	set_mm_walk(NULL, true);
+
+	memcg = mem_cgroup_iter(NULL, NULL, NULL);
+	do {
+		struct lruvec *lruvec = mem_cgroup_lruvec(memcg, pgdat);
+		DEFINE_MAX_SEQ(lruvec);
+
+		try_to_inc_max_seq(lruvec, max_seq, get_swappiness(lruvec, &sc), false);
+
+		cond_resched();
+	} while ((memcg = mem_cgroup_iter(NULL, memcg, NULL)));
+
+	clear_mm_walk();
+	memalloc_noreclaim_restore(flags);
+	set_task_reclaim_state(current, NULL);
+}
+
+static void lru_gen_aging_workfn(struct work_struct *work)
+{
+	unsigned long interval = READ_ONCE(lru_gen_aging_interval);
+	int nid;
+
+	if (!interval)
+		return;
+
+	/* a node still busy with the previous interval skips this one */
+	if (lru_gen_enabled()) {
+		for_each_node_state(nid, N_MEMORY)
+			queue_work_node(nid, system_unbound_wq, &lru_gen_aging_works[nid]);
+	}
+
+	queue_delayed_work(system_unbound_wq, &lru_gen_aging_dwork, interval);
+}
+
+#ifdef CONFIG_MEMCG
+void lru_gen_working_set_show(struct seq_file *m, struct mem_cgroup *memcg)
+{
+	int nid, age, type;
+	unsigned long total[ANON_AND_FILE] = {};
+	unsigned long size[MAX_NR_GENS][ANON_AND_FILE] = {};
+	static const char *const names[ANON_AND_FILE] = { "anon", "file" };
+
+	for_each_node_state(nid, N_MEMORY) {
+		struct mem_cgroup *iter = mem_cgroup_iter(memcg, NULL, NULL);
+
+		do {
+			struct lruvec *lruvec = mem_cgroup_lruvec(iter, NODE_DATA(nid));
+			struct lru_gen_folio *lrugen = &lruvec->lrugen;
+			DEFINE_MAX_SEQ(lruvec);
+			DEFINE_MIN_SEQ(lruvec);
+
+			for (type = 0; type < ANON_AND_FILE; type++) {
+				unsigned long seq;
+
+				for (seq = min_seq[type]; seq <= max_seq; seq++) {
+					int zone, gen = lru_gen_from_seq(seq);
+
+					/* lockless, so min_seq and max_seq can be out of sync */
+					age = max_seq - seq;
+					if (age >= MAX_NR_GENS)
+						continue;
+
+					for (zone = 0; zone < MAX_NR_ZONES; zone++)
+						size[age][type] += max(READ_ONCE(lrugen->nr_pages[gen][type][zone]), 0L);
+				}
+			}
+		} while ((iter = mem_cgroup_iter(memcg, iter, NULL)));
+	}
+
+	seq_printf(m, "interval_ms %u\n",
+		   jiffies_to_msecs(READ_ONCE(lru_gen_aging_interval)));
+
+	for (type = 0; type < ANON_AND_FILE; type++) {
+		seq_puts(m, names[type]);
+		for (age = 0; age < MAX_NR_GENS; age++) {
+			total[type] += size[age][type];
+			seq_printf(m, " %d=%lu", age + 1, total[type] << PAGE_SHIFT);
+		}
+		seq_putc(m, '\n');
+	}
+}
+#endif /* CONFIG_MEMCG */
+
 /******************************************************************************
  *                          sysfs interface
  ******************************************************************************/
@@ -5226,6 +5565,38 @@ static ssize_t min_ttl_ms_store(struct kobject *kobj, struct kobj_attribute *att
 
 static struct kobj_attribute lru_gen_min_ttl_attr = __ATTR_RW(min_ttl_ms);
 
+static ssize_t aging_interval_ms_show(struct kobject *kobj, struct kobj_attribute *attr,
+				      char *buf)
+{
+	return sysfs_emit(buf, "%u\n", jiffies_to_msecs(READ_ONCE(lru_gen_aging_interval)));
+}
+
+/* see Documentation/admin-guide/mm/multigen_lru.rst for details */
+static ssize_t aging_interval_ms_store(struct kobject *kobj, struct kobj_attribute *attr,
+				       const char *buf, size_t len)
+{
+	unsigned long interval;
+	unsigned int msecs;
+
+	if (kstrtouint(buf, 0, &msecs))
+		return -EINVAL;
+
+	if (!lru_gen_aging_works)
+		return -ENOMEM;
+
+	interval = msecs_to_jiffies(msecs);
+	WRITE_ONCE(lru_gen_aging_interval, interval);
+
+	if (interval)
+		mod_delayed_work(system_unbound_wq, &lru_gen_aging_dwork, interval);
+	else
+		cancel_delayed_work(&lru_gen_aging_dwork);
+
+	return len;
+}
+
+static struct kobj_attribute lru_gen_aging_interval_attr = __ATTR_RW(aging_interval_ms);
+
 static ssize_t enabled_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf)
 {
 	unsigned int caps = 0;
@@ -5275,6 +5646,7 @@ static struct kobj_attribute lru_gen_enabled_attr = __ATTR_RW(enabled);
 static struct attribute *lru_gen_attrs[] = {
 	&lru_gen_min_ttl_attr.attr,
 	&lru_gen_enabled_attr.attr,
+	&lru_gen_aging_interval_attr.attr,
 	NULL
 };
 
@@ -5707,6 +6079,9 @@ void lru_gen_exit_memcg(struct mem_cgroup *memcg)
 			bitmap_free(mm_state->filters[i]);
 			mm_state->filters[i] = NULL;
 		}
+
+		kfree(mm_state->cold_filter);
+		mm_state->cold_filter = NULL;
 	}
 }
 
@@ -5714,9 +6089,19 @@ void lru_gen_exit_memcg(struct mem_cgroup *memcg)
 
 static int __init init_lru_gen(void)
 {
+	int nid;
+
 	BUILD_BUG_ON(MIN_NR_GENS + 1 >= MAX_NR_GENS);
 	BUILD_BUG_ON(BIT(LRU_GEN_WIDTH) <= MAX_NR_GENS);
 
+	lru_gen_aging_works = kcalloc(nr_node_ids, sizeof(*lru_gen_aging_works), GFP_KERNEL);
+	if (lru_gen_aging_works) {
+		for (nid = 0; nid < nr_node_ids; nid++)
+			INIT_WORK(&lru_gen_aging_works[nid], lru_gen_age_node_proactive);
+	} else {
+		pr_err("lru_gen: failed to allocate aging works\n");
+	}
+
 	if (sysfs_create_group(mm_kobj, &lru_gen_attr_group))
 		pr_err("lru_gen: failed to create sysfs group\n");
 
@@ -5996,8 +6381,7 @@ static void shrink_node_memcgs(pg_data_t *pgdat, struct scan_control *sc)
 
 		shrink_lruvec(lruvec, sc);
 
-		shrink_slab(sc->gfp_mask, pgdat->node_id, memcg,
-			    sc->priority);
+		sc_shrink_slab(sc, pgdat->node_id, memcg);
 
 		/* Record the group's reclaim efficiency */
 		if (!sc->proactive)
@@ -6083,7 +6467,7 @@ static void shrink_node(pg_data_t *pgdat, struct scan_control *sc)
 		 * until some pages complete writeback.
 		 */
 		if (sc->nr.immediate)
-			reclaim_throttle(pgdat, VMSCAN_THROTTLE_WRITEBACK);
+			sc_reclaim_throttle(sc, pgdat, VMSCAN_THROTTLE_WRITEBACK);
 	}
 
 	/*
@@ -6111,7 +6495,7 @@ static void shrink_node(pg_data_t *pgdat, struct scan_control *sc)
 	    !sc->hibernation_mode &&
 	    (test_bit(LRUVEC_CGROUP_CONGESTED, &target_lruvec->flags) ||
 	     test_bit(LRUVEC_NODE_CONGESTED, &target_lruvec->flags)))
-		reclaim_throttle(pgdat, VMSCAN_THROTTLE_CONGESTED);
+		sc_reclaim_throttle(sc, pgdat, VMSCAN_THROTTLE_CONGESTED);
 
 	if (should_continue_reclaim(pgdat, nr_node_reclaimed, sc))
 		goto again;
@@ -6189,7 +6573,7 @@ static void consider_reclaim_throttle(pg_data_t *pgdat, struct scan_control *sc)
 
 	/* Throttle if making no progress at high prioities. */
 	if (sc->priority == 1 && !sc->nr_reclaimed)
-		reclaim_throttle(pgdat, VMSCAN_THROTTLE_NOPROGRESS);
+		sc_reclaim_throttle(sc, pgdat, VMSCAN_THROTTLE_NOPROGRESS);
 }
 
 /*
@@ -6573,7 +6957,9 @@ unsigned long try_to_free_pages(struct zonelist *zonelist, int order,
 		.may_writepage = !laptop_mode,
 		.may_unmap = 1,
 		.may_swap = 1,
+		.account_stall = !mem_cgroup_disabled(),
 	};
+	u64 start = stall_clock(&sc);
 
 	/*
 	 * scan_control uses s8 fields for order, priority, and reclaim_idx.
@@ -6590,6 +6976,7 @@ unsigned long try_to_free_pages(struct zonelist *zonelist, int order,
 	 */
 	if (throttle_direct_reclaim(sc.gfp_mask, zonelist, nodemask))
 		return 1;
+	stall_account(&sc, MEMCG_STALL_THROTTLE, start);
 
 	set_task_reclaim_state(current, &sc.reclaim_state);
 	trace_mm_vmscan_direct_reclaim_begin(order, sc.gfp_mask);
@@ -6598,6 +6985,7 @@ unsigned long try_to_free_pages(struct zonelist *zonelist, int order,
 
 	trace_mm_vmscan_direct_reclaim_end(nr_reclaimed);
 	set_task_reclaim_state(current, NULL);
+	account_direct_stall(&sc, start);
 
 	return nr_reclaimed;
 }
@@ -6664,7 +7052,9 @@ unsigned long try_to_free_mem_cgroup_pages(struct mem_cgroup *memcg,
 		.may_unmap = 1,
 		.may_swap = !!(reclaim_options & MEMCG_RECLAIM_MAY_SWAP),
 		.proactive = !!(reclaim_options & MEMCG_RECLAIM_PROACTIVE),
+		.account_stall = !(reclaim_options & MEMCG_RECLAIM_PROACTIVE),
 	};
+	u64 start = stall_clock(&sc);
 	/*
 	 * Traverse the ZONELIST_FALLBACK zonelist of the current node to put
 	 * equal pressure on all the nodes. This is based on the assumption that
@@ -6681,6 +7071,7 @@ unsigned long try_to_free_mem_cgroup_pages(struct mem_cgroup *memcg,
 	memalloc_noreclaim_restore(noreclaim_flag);
 	trace_mm_vmscan_memcg_reclaim_end(nr_reclaimed);
 	set_task_reclaim_state(current, NULL);
+	account_direct_stall(&sc, start);
 
 	return nr_reclaimed;
 }
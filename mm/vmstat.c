@@ -1307,6 +1307,10 @@ const char * const vmstat_text[] = {
 	"pgfault",
 	"pgmajfault",
 	"pglazyfreed",
+	"madvise_flush_saved",
+#ifdef CONFIG_MEMCG
+	"memcg_flush_avoided",
+#endif
 
 	"pgrefill",
 	"pgreuse",
@@ -1341,6 +1345,12 @@ const char * const vmstat_text[] = {
 	"drop_slab",
 	"oom_kill",
 
+	"dirty_throttle_10ms",
+	"dirty_throttle_50ms",
+	"dirty_throttle_100ms",
+	"dirty_throttle_slow",
+	"dirty_throttle_budget_skip",
+
 #ifdef CONFIG_NUMA_BALANCING
 	"numa_pte_updates",
 	"numa_huge_pte_updates",
@@ -1421,6 +1431,7 @@ const char * const vmstat_text[] = {
 	"nr_tlb_remote_flush_received",
 	"nr_tlb_local_flush_all",
 	"nr_tlb_local_flush_one",
+	"nr_tlb_broadcast_flush",
 #endif /* CONFIG_DEBUG_TLBFLUSH */
 
 #ifdef CONFIG_SWAP
@@ -1434,6 +1445,8 @@ const char * const vmstat_text[] = {
 #endif
 #ifdef CONFIG_KSM
 	"cow_ksm",
+	"ksm_scan_nsec",
+	"ksm_yield",
 #endif
 #ifdef CONFIG_ZSWAP
 	"zswpin",
@@ -1799,6 +1812,28 @@ static void zoneinfo_show_print(struct seq_file *m, pg_data_t *pgdat,
 			   zone_numa_event_state(zone, i));
 #endif
 
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE
+	seq_printf(m, "\n  pcp huge orders");
+	for (int j = 0; j < NR_PCP_HUGE_ORDERS; j++) {
+		unsigned long hit = 0, miss = 0;
+		unsigned int order;
+
+		order = j ? pcp_mthp_orders[j - 1] : HPAGE_PMD_ORDER;
+		if (!order)
+			continue;
+
+		for_each_online_cpu(i) {
+			struct per_cpu_pages *pcp;
+
+			pcp = per_cpu_ptr(zone->per_cpu_pageset, i);
+			hit += data_race(pcp->huge_hit[j]);
+			miss += data_race(pcp->huge_miss[j]);
+		}
+		seq_printf(m, "\n      order %-2u hit: %lu miss: %lu",
+			   order, hit, miss);
+	}
+#endif
+
 	seq_printf(m, "\n  pagesets");
 	for_each_online_cpu(i) {
 		struct per_cpu_pages *pcp;
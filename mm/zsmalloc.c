@@ -181,6 +181,8 @@ struct size_class {
 
 	unsigned int index;
 	struct zs_size_stat stats;
+	/* a compactor is working on this class */
+	atomic_t compacting;
 };
 
 /*
@@ -225,7 +227,8 @@ struct zs_pool {
 #endif
 	/* protect zspage migration/compaction */
 	rwlock_t lock;
-	atomic_t compaction_in_progress;
+	/* the class the last compaction ran out of budget in */
+	int compact_next;
 };
 
 static inline void zpdesc_set_first(struct zpdesc *zpdesc)
@@ -1916,8 +1919,34 @@ static unsigned long zs_can_compact(struct size_class *class)
 	return obj_wasted * class->pages_per_zspage;
 }
 
+/*
+ * The shrinker leaves a class alone until at least 1/ZS_COMPACT_FRAG_RATIO of
+ * its pages could be freed, so that it doesn't keep taking pool->lock for
+ * writing to shuffle around a few objects. zs_compact() compacts everything.
+ */
+#define ZS_COMPACT_FRAG_RATIO	8
+
+static bool zs_class_fragmented(struct size_class *class)
+{
+	unsigned long obj_allocated = class_stat_read(class, ZS_OBJS_ALLOCATED);
+	unsigned long freeable = zs_can_compact(class);
+	unsigned long pages_used;
+
+	pages_used = obj_allocated / class->objs_per_zspage *
+		     class->pages_per_zspage;
+
+	return freeable && freeable * ZS_COMPACT_FRAG_RATIO >= pages_used;
+}
+
+/*
+ * Migrates objects out of sparse zspages of @class until no more pages can be
+ * freed or @budget pages worth of zspages have been emptied. Locks are dropped
+ * whenever the destination is full, or somebody else needs the lock or the CPU,
+ * so a single lock section never migrates more than one destination zspage.
+ */
 static unsigned long __zs_compact(struct zs_pool *pool,
-				  struct size_class *class)
+				  struct size_class *class,
+				  unsigned long *budget)
 {
 	struct zspage *src_zspage = NULL;
 	struct zspage *dst_zspage = NULL;
@@ -1929,7 +1958,7 @@ static unsigned long __zs_compact(struct zs_pool *pool,
 	 */
 	write_lock(&pool->lock);
 	spin_lock(&class->lock);
-	while (zs_can_compact(class)) {
+	while (*budget && zs_can_compact(class)) {
 		int fg;
 
 		if (!dst_zspage) {
@@ -1947,6 +1976,7 @@ static unsigned long __zs_compact(struct zs_pool *pool,
 
 		migrate_zspage(pool, src_zspage, dst_zspage);
 		zspage_write_unlock(src_zspage);
+		*budget -= min_t(unsigned long, *budget, class->pages_per_zspage);
 
 		fg = putback_zspage(class, src_zspage);
 		if (fg == ZS_INUSE_RATIO_0) {
@@ -1956,7 +1986,7 @@ static unsigned long __zs_compact(struct zs_pool *pool,
 		src_zspage = NULL;
 
 		if (get_fullness_group(class, dst_zspage) == ZS_INUSE_RATIO_100
-		    || rwlock_is_contended(&pool->lock)) {
+		    || rwlock_is_contended(&pool->lock) || need_resched()) {
 			putback_zspage(class, dst_zspage);
 			dst_zspage = NULL;
 
@@ -1980,32 +2010,48 @@ static unsigned long __zs_compact(struct zs_pool *pool,
 	return pages_freed;
 }
 
-unsigned long zs_compact(struct zs_pool *pool)
+/*
+ * Compacts the classes from the largest to the smallest, starting over where
+ * the last compaction ran out of budget. Concurrent compactors skip the classes
+ * that are already being worked on instead of waiting for them, and so spread
+ * over the classes; they still take turns on pool->lock though.
+ */
+static unsigned long zs_compact_classes(struct zs_pool *pool,
+					unsigned long budget,
+					bool fragmented_only)
 {
-	int i;
+	int i, idx, start = READ_ONCE(pool->compact_next);
 	struct size_class *class;
 	unsigned long pages_freed = 0;
 
-	/*
-	 * Pool compaction is performed under pool->lock so it is basically
-	 * single-threaded. Having more than one thread in __zs_compact()
-	 * will increase pool->lock contention, which will impact other
-	 * zsmalloc operations that need pool->lock.
-	 */
-	if (atomic_xchg(&pool->compaction_in_progress, 1))
-		return 0;
-
-	for (i = ZS_SIZE_CLASSES - 1; i >= 0; i--) {
-		class = pool->size_class[i];
-		if (class->index != i)
+	for (i = 0; i < ZS_SIZE_CLASSES; i++) {
+		idx = (start - i + ZS_SIZE_CLASSES) % ZS_SIZE_CLASSES;
+		class = pool->size_class[idx];
+		if (class->index != idx)
+			continue;
+		if (fragmented_only && !zs_class_fragmented(class))
 			continue;
-		pages_freed += __zs_compact(pool, class);
+		if (atomic_xchg(&class->compacting, 1))
+			continue;
+
+		pages_freed += __zs_compact(pool, class, &budget);
+		atomic_set_release(&class->compacting, 0);
+
+		if (!budget) {
+			/* it may have more to give */
+			WRITE_ONCE(pool->compact_next, idx);
+			break;
+		}
 	}
 	atomic_long_add(pages_freed, &pool->stats.pages_compacted);
-	atomic_set(&pool->compaction_in_progress, 0);
 
 	return pages_freed;
 }
+
+unsigned long zs_compact(struct zs_pool *pool)
+{
+	return zs_compact_classes(pool, ULONG_MAX, false);
+}
 EXPORT_SYMBOL_GPL(zs_compact);
 
 void zs_pool_stats(struct zs_pool *pool, struct zs_pool_stats *stats)
@@ -2021,11 +2067,12 @@ static unsigned long zs_shrinker_scan(struct shrinker *shrinker,
 	struct zs_pool *pool = shrinker->private_data;
 
 	/*
-	 * Compact classes and calculate compaction delta.
-	 * Can run concurrently with a manually triggered
+	 * Compact classes and calculate compaction delta, giving up after
+	 * nr_to_scan pages worth of zspages so that reclaim isn't stalled
+	 * on a big pool. Can run concurrently with a manually triggered
 	 * (by user) compaction.
 	 */
-	pages_freed = zs_compact(pool);
+	pages_freed = zs_compact_classes(pool, sc->nr_to_scan, true);
 
 	return pages_freed ? pages_freed : SHRINK_STOP;
 }
@@ -2042,6 +2089,8 @@ static unsigned long zs_shrinker_count(struct shrinker *shrinker,
 		class = pool->size_class[i];
 		if (class->index != i)
 			continue;
+		if (!zs_class_fragmented(class))
+			continue;
 
 		pages_to_free += zs_can_compact(class);
 	}
@@ -2113,7 +2162,7 @@ struct zs_pool *zs_create_pool(const char *name)
 
 	init_deferred_free(pool);
 	rwlock_init(&pool->lock);
-	atomic_set(&pool->compaction_in_progress, 0);
+	pool->compact_next = ZS_SIZE_CLASSES - 1;
 
 	pool->name = kstrdup(name, GFP_KERNEL);
 	if (!pool->name)
@@ -2185,6 +2234,7 @@ struct zs_pool *zs_create_pool(const char *name)
 		class->pages_per_zspage = pages_per_zspage;
 		class->objs_per_zspage = objs_per_zspage;
 		spin_lock_init(&class->lock);
+		atomic_set(&class->compacting, 0);
 		pool->size_class[i] = class;
 
 		fullness = ZS_INUSE_RATIO_0;
@@ -68,6 +68,10 @@ static u64 zswap_decompress_fail;
 static u64 zswap_reject_alloc_fail;
 /* Store failed because the entry metadata could not be allocated (rare) */
 static u64 zswap_reject_kmemcache_fail;
+/* Entries moved to the recompression compressor */
+static u64 zswap_recompressed_pages;
+/* Recompression attempts that did not save space */
+static u64 zswap_recompress_poor;
 
 /* Shrinker work queue */
 static struct workqueue_struct *shrink_wq;
@@ -129,6 +133,22 @@ static bool zswap_shrinker_enabled = IS_ENABLED(
 		CONFIG_ZSWAP_SHRINKER_DEFAULT_ON);
 module_param_named(shrinker_enabled, zswap_shrinker_enabled, bool, 0644);
 
+/* Compressor to recompress old entries with, empty to disable */
+static char *zswap_recompress_compressor = ZSWAP_PARAM_UNSET;
+static int zswap_recompress_param_set(const char *,
+				      const struct kernel_param *);
+static const struct kernel_param_ops zswap_recompress_param_ops = {
+	.set =		zswap_recompress_param_set,
+	.get =		param_get_charp,
+	.free =		param_free_charp,
+};
+module_param_cb(recompress_compressor, &zswap_recompress_param_ops,
+		&zswap_recompress_compressor, 0644);
+
+/* How long an entry stays in zswap before it is recompressed */
+static unsigned int zswap_recompress_age_ms = 60 * MSEC_PER_SEC;
+module_param_named(recompress_age_ms, zswap_recompress_age_ms, uint, 0644);
+
 bool zswap_is_enabled(void)
 {
 	return zswap_enabled;
@@ -143,11 +163,21 @@ bool zswap_never_enabled(void)
 * data structures
 **********************************/
 
+/*
+ * How many pages of a large folio are compressed with one chain of requests.
+ * Only asynchronous (hardware) compressors get that many requests per CPU;
+ * for the others, batching would just spend memory on more buffers.
+ */
+#define ZSWAP_MAX_BATCH		8
+
 struct crypto_acomp_ctx {
 	struct crypto_acomp *acomp;
-	struct acomp_req *req;
+	struct acomp_req *reqs[ZSWAP_MAX_BATCH];
 	struct crypto_wait wait;
-	u8 *buffer;
+	u8 *buffers[ZSWAP_MAX_BATCH];
+	struct scatterlist inputs[ZSWAP_MAX_BATCH];
+	struct scatterlist outputs[ZSWAP_MAX_BATCH];
+	unsigned int nr_reqs;
 	struct mutex mutex;
 	bool is_sleepable;
 };
@@ -177,6 +207,13 @@ static struct mem_cgroup *zswap_next_shrink;
 static struct work_struct zswap_shrink_work;
 static struct shrinker *zswap_shrinker;
 
+/*
+ * The pool of the recompression compressor. It is on zswap_pools, but is never
+ * the current pool, and holds its initial ref for as long as it is installed.
+ */
+static struct zswap_pool __rcu *zswap_recompress_pool;
+static struct delayed_work zswap_recompress_work;
+
 /*
  * struct zswap_entry
  *
@@ -190,7 +227,9 @@ static struct shrinker *zswap_shrinker;
  *              writeback logic. The entry is only reclaimed by the writeback
  *              logic if referenced is unset. See comments in the shrinker
  *              section for context.
- * pool - the zswap_pool the entry's data is in
+ * stored - jiffies when the page was stored, for recompression
+ * recompress_tried - true once the recompression worker has tried the entry
+ * pool - the zswap_pool the entry's data is in, and so its compressor
  * handle - zpool allocation handle that stores the compressed page data
  * objcg - the obj_cgroup that the compressed memory is charged to
  * lru - handle to the pool's lru used to evict pages.
@@ -199,6 +238,8 @@ struct zswap_entry {
 	swp_entry_t swpentry;
 	unsigned int length;
 	bool referenced;
+	bool recompress_tried;
+	unsigned long stored;
 	struct zswap_pool *pool;
 	unsigned long handle;
 	struct obj_cgroup *objcg;
@@ -471,6 +512,9 @@ static struct zswap_pool *zswap_pool_find_get(char *type, char *compressor)
 			continue;
 		if (strcmp(zpool_get_type(pool->zpool), type))
 			continue;
+		/* the recompression pool can't also become the current one */
+		if (pool == rcu_access_pointer(zswap_recompress_pool))
+			continue;
 		/* if we can't get it, it's about to be destroyed */
 		if (!zswap_pool_tryget(pool))
 			continue;
@@ -656,6 +700,72 @@ static int zswap_zpool_param_set(const char *val,
 	return __zswap_param_set(val, kp, NULL, zswap_compressor);
 }
 
+static void zswap_recompress_pool_install(struct zswap_pool *pool)
+{
+	struct zswap_pool *old;
+
+	spin_lock_bh(&zswap_pools_lock);
+	if (pool)
+		list_add_tail_rcu(&pool->list, &zswap_pools);
+	old = rcu_replace_pointer(zswap_recompress_pool, pool,
+				  lockdep_is_held(&zswap_pools_lock));
+	spin_unlock_bh(&zswap_pools_lock);
+
+	/* released once the entries compressed by it are gone */
+	if (old)
+		percpu_ref_kill(&old->ref);
+
+	if (pool)
+		mod_delayed_work(system_unbound_wq, &zswap_recompress_work, 0);
+}
+
+static int zswap_recompress_param_set(const char *val,
+				      const struct kernel_param *kp)
+{
+	struct zswap_pool *pool = NULL;
+	char *s = strstrip((char *)val);
+	int ret;
+
+	mutex_lock(&zswap_init_lock);
+	switch (zswap_init_state) {
+	case ZSWAP_UNINIT:
+		/* the pool is created during init */
+		ret = param_set_charp(s, kp);
+		break;
+	case ZSWAP_INIT_SUCCEED:
+		if (*s && !crypto_has_acomp(s, 0, 0)) {
+			pr_err("compressor %s not available\n", s);
+			ret = -ENOENT;
+			break;
+		}
+		/* it must not end up first on zswap_pools */
+		if (*s && !zswap_has_pool) {
+			pr_err("no current pool to recompress from\n");
+			ret = -ENODEV;
+			break;
+		}
+		ret = param_set_charp(s, kp);
+		if (ret || !*s) {
+			if (!ret)
+				zswap_recompress_pool_install(NULL);
+			break;
+		}
+		pool = zswap_pool_create(zswap_zpool_type, s);
+		if (!pool) {
+			ret = -EINVAL;
+			break;
+		}
+		zswap_recompress_pool_install(pool);
+		break;
+	default:
+		pr_err("can't set param, initialization failed\n");
+		ret = -ENODEV;
+	}
+	mutex_unlock(&zswap_init_lock);
+
+	return ret;
+}
+
 static int zswap_enabled_param_set(const char *val,
 				   const struct kernel_param *kp)
 {
@@ -822,31 +932,35 @@ static int zswap_cpu_comp_prepare(unsigned int cpu, struct hlist_node *node)
 {
 	struct zswap_pool *pool = hlist_entry(node, struct zswap_pool, node);
 	struct crypto_acomp_ctx *acomp_ctx = per_cpu_ptr(pool->acomp_ctx, cpu);
-	struct crypto_acomp *acomp = NULL;
-	struct acomp_req *req = NULL;
-	u8 *buffer = NULL;
+	struct acomp_req *reqs[ZSWAP_MAX_BATCH] = {};
+	u8 *buffers[ZSWAP_MAX_BATCH] = {};
+	struct crypto_acomp *acomp;
+	unsigned int i, nr_reqs;
 	int ret;
 
-	buffer = kmalloc_node(PAGE_SIZE * 2, GFP_KERNEL, cpu_to_node(cpu));
-	if (!buffer) {
-		ret = -ENOMEM;
-		goto fail;
-	}
-
 	acomp = crypto_alloc_acomp_node(pool->tfm_name, 0, 0, cpu_to_node(cpu));
 	if (IS_ERR(acomp)) {
 		pr_err("could not alloc crypto acomp %s : %ld\n",
 				pool->tfm_name, PTR_ERR(acomp));
-		ret = PTR_ERR(acomp);
-		goto fail;
+		return PTR_ERR(acomp);
 	}
 
-	req = acomp_request_alloc(acomp);
-	if (!req) {
-		pr_err("could not alloc crypto acomp_request %s\n",
-		       pool->tfm_name);
-		ret = -ENOMEM;
-		goto fail;
+	nr_reqs = acomp_is_async(acomp) ? ZSWAP_MAX_BATCH : 1;
+	for (i = 0; i < nr_reqs; i++) {
+		buffers[i] = kmalloc_node(PAGE_SIZE * 2, GFP_KERNEL,
+					  cpu_to_node(cpu));
+		if (!buffers[i]) {
+			ret = -ENOMEM;
+			goto fail;
+		}
+
+		reqs[i] = acomp_request_alloc(acomp);
+		if (!reqs[i]) {
+			pr_err("could not alloc crypto acomp_request %s\n",
+			       pool->tfm_name);
+			ret = -ENOMEM;
+			goto fail;
+		}
 	}
 
 	/*
@@ -862,20 +976,24 @@ static int zswap_cpu_comp_prepare(unsigned int cpu, struct hlist_node *node)
 	 * crypto_wait_req(); if the backend of acomp is scomp, the callback
 	 * won't be called, crypto_wait_req() will return without blocking.
 	 */
-	acomp_request_set_callback(req, CRYPTO_TFM_REQ_MAY_BACKLOG,
+	acomp_request_set_callback(reqs[0], CRYPTO_TFM_REQ_MAY_BACKLOG,
 				   crypto_req_done, &acomp_ctx->wait);
 
-	acomp_ctx->buffer = buffer;
+	memcpy(acomp_ctx->buffers, buffers, sizeof(buffers));
 	acomp_ctx->acomp = acomp;
 	acomp_ctx->is_sleepable = acomp_is_async(acomp);
-	acomp_ctx->req = req;
+	acomp_ctx->nr_reqs = nr_reqs;
+	memcpy(acomp_ctx->reqs, reqs, sizeof(reqs));
 	mutex_unlock(&acomp_ctx->mutex);
 	return 0;
 
 fail:
-	if (acomp)
-		crypto_free_acomp(acomp);
-	kfree(buffer);
+	for (i = 0; i < nr_reqs; i++) {
+		if (reqs[i])
+			acomp_request_free(reqs[i]);
+		kfree(buffers[i]);
+	}
+	crypto_free_acomp(acomp);
 	return ret;
 }
 
@@ -883,31 +1001,36 @@ static int zswap_cpu_comp_dead(unsigned int cpu, struct hlist_node *node)
 {
 	struct zswap_pool *pool = hlist_entry(node, struct zswap_pool, node);
 	struct crypto_acomp_ctx *acomp_ctx = per_cpu_ptr(pool->acomp_ctx, cpu);
-	struct acomp_req *req;
+	struct acomp_req *reqs[ZSWAP_MAX_BATCH];
+	u8 *buffers[ZSWAP_MAX_BATCH];
 	struct crypto_acomp *acomp;
-	u8 *buffer;
+	unsigned int i, nr_reqs;
 
 	if (IS_ERR_OR_NULL(acomp_ctx))
 		return 0;
 
 	mutex_lock(&acomp_ctx->mutex);
-	req = acomp_ctx->req;
+	memcpy(reqs, acomp_ctx->reqs, sizeof(reqs));
 	acomp = acomp_ctx->acomp;
-	buffer = acomp_ctx->buffer;
-	acomp_ctx->req = NULL;
+	memcpy(buffers, acomp_ctx->buffers, sizeof(buffers));
+	nr_reqs = acomp_ctx->nr_reqs;
+	memset(acomp_ctx->reqs, 0, sizeof(acomp_ctx->reqs));
 	acomp_ctx->acomp = NULL;
-	acomp_ctx->buffer = NULL;
+	memset(acomp_ctx->buffers, 0, sizeof(acomp_ctx->buffers));
+	acomp_ctx->nr_reqs = 0;
 	mutex_unlock(&acomp_ctx->mutex);
 
 	/*
 	 * Do the actual freeing after releasing the mutex to avoid subtle
 	 * locking dependencies causing deadlocks.
 	 */
-	if (!IS_ERR_OR_NULL(req))
-		acomp_request_free(req);
+	for (i = 0; i < nr_reqs; i++) {
+		if (!IS_ERR_OR_NULL(reqs[i]))
+			acomp_request_free(reqs[i]);
+		kfree(buffers[i]);
+	}
 	if (!IS_ERR_OR_NULL(acomp))
 		crypto_free_acomp(acomp);
-	kfree(buffer);
 
 	return 0;
 }
@@ -919,13 +1042,13 @@ static struct crypto_acomp_ctx *acomp_ctx_get_cpu_lock(struct zswap_pool *pool)
 	for (;;) {
 		acomp_ctx = raw_cpu_ptr(pool->acomp_ctx);
 		mutex_lock(&acomp_ctx->mutex);
-		if (likely(acomp_ctx->req))
+		if (likely(acomp_ctx->reqs[0]))
 			return acomp_ctx;
 		/*
 		 * It is possible that we were migrated to a different CPU after
 		 * getting the per-CPU ctx but before the mutex was acquired. If
 		 * the old CPU got offlined, zswap_cpu_comp_dead() could have
-		 * already freed ctx->req (among other things) and set it to
+		 * already freed ctx->reqs (among other things) and set them to
 		 * NULL. Just try again on the new CPU that we ended up on.
 		 */
 		mutex_unlock(&acomp_ctx->mutex);
@@ -937,59 +1060,91 @@ static void acomp_ctx_put_unlock(struct crypto_acomp_ctx *acomp_ctx)
 	mutex_unlock(&acomp_ctx->mutex);
 }
 
-static bool zswap_compress(struct page *page, struct zswap_entry *entry,
-			   struct zswap_pool *pool)
+/*
+ * Compress @nr consecutive pages starting at @page into @entries. The pages are
+ * submitted to the compressor in chains of up to acomp_ctx->nr_reqs requests,
+ * so that an accelerator can work on them in parallel. All of the pages are
+ * stored, or none of them.
+ */
+static bool zswap_compress_pages(struct page *page,
+				 struct zswap_entry **entries,
+				 unsigned int nr, struct zswap_pool *pool)
 {
 	struct crypto_acomp_ctx *acomp_ctx;
-	struct scatterlist input, output;
-	int comp_ret = 0, alloc_ret = 0;
-	unsigned int dlen = PAGE_SIZE;
+	unsigned int i, batch, done = 0;
+	struct zpool *zpool = pool->zpool;
+	int ret, comp_ret = 0, alloc_ret = 0;
 	unsigned long handle;
-	struct zpool *zpool;
+	unsigned int dlen;
 	gfp_t gfp;
-	u8 *dst;
+
+	gfp = GFP_NOWAIT | __GFP_NORETRY | __GFP_HIGHMEM | __GFP_MOVABLE;
 
 	acomp_ctx = acomp_ctx_get_cpu_lock(pool);
-	dst = acomp_ctx->buffer;
-	sg_init_table(&input, 1);
-	sg_set_page(&input, page, PAGE_SIZE, 0);
+	while (done < nr) {
+		batch = min(nr - done, acomp_ctx->nr_reqs);
 
-	/*
-	 * We need PAGE_SIZE * 2 here since there maybe over-compression case,
-	 * and hardware-accelerators may won't check the dst buffer size, so
-	 * giving the dst buffer with enough length to avoid buffer overflow.
-	 */
-	sg_init_one(&output, dst, PAGE_SIZE * 2);
-	acomp_request_set_params(acomp_ctx->req, &input, &output, PAGE_SIZE, dlen);
+		for (i = 0; i < batch; i++) {
+			struct acomp_req *req = acomp_ctx->reqs[i];
 
-	/*
-	 * it maybe looks a little bit silly that we send an asynchronous request,
-	 * then wait for its completion synchronously. This makes the process look
-	 * synchronous in fact.
-	 * Theoretically, acomp supports users send multiple acomp requests in one
-	 * acomp instance, then get those requests done simultaneously. but in this
-	 * case, zswap actually does store and load page by page, there is no
-	 * existing method to send the second page before the first page is done
-	 * in one thread doing zwap.
-	 * but in different threads running on different cpu, we have different
-	 * acomp instance, so multiple threads can do (de)compression in parallel.
-	 */
-	comp_ret = crypto_wait_req(crypto_acomp_compress(acomp_ctx->req), &acomp_ctx->wait);
-	dlen = acomp_ctx->req->dlen;
-	if (comp_ret)
-		goto unlock;
+			sg_init_table(&acomp_ctx->inputs[i], 1);
+			sg_set_page(&acomp_ctx->inputs[i], nth_page(page, done + i),
+				    PAGE_SIZE, 0);
+			/*
+			 * We need PAGE_SIZE * 2 here since there maybe
+			 * over-compression case, and hardware-accelerators may
+			 * won't check the dst buffer size, so giving the dst
+			 * buffer with enough length to avoid buffer overflow.
+			 */
+			sg_init_one(&acomp_ctx->outputs[i], acomp_ctx->buffers[i],
+				    PAGE_SIZE * 2);
+			acomp_request_set_params(req, &acomp_ctx->inputs[i],
+						 &acomp_ctx->outputs[i],
+						 PAGE_SIZE, PAGE_SIZE);
+			if (!i)
+				continue;
+			acomp_request_set_callback(req, CRYPTO_TFM_REQ_MAY_BACKLOG,
+						   NULL, NULL);
+			acomp_request_chain(req, acomp_ctx->reqs[0]);
+		}
 
-	zpool = pool->zpool;
-	gfp = GFP_NOWAIT | __GFP_NORETRY | __GFP_HIGHMEM | __GFP_MOVABLE;
-	alloc_ret = zpool_malloc(zpool, dlen, gfp, &handle);
-	if (alloc_ret)
-		goto unlock;
+		/*
+		 * The whole chain completes before we are woken up. If the
+		 * backend is scomp, the requests are simply done one by one in
+		 * this context and crypto_wait_req() returns without blocking.
+		 */
+		ret = crypto_wait_req(crypto_acomp_compress(acomp_ctx->reqs[0]),
+				      &acomp_ctx->wait);
+		if (batch > 1) {
+			/* unchain reqs[0] for the single page users */
+			acomp_request_set_callback(acomp_ctx->reqs[0],
+						   CRYPTO_TFM_REQ_MAY_BACKLOG,
+						   crypto_req_done,
+						   &acomp_ctx->wait);
+		}
 
-	zpool_obj_write(zpool, handle, dst, dlen);
-	entry->handle = handle;
-	entry->length = dlen;
+		for (i = 0; i < batch; i++, done++) {
+			struct acomp_req *req = acomp_ctx->reqs[i];
 
-unlock:
+			comp_ret = batch > 1 ? req->base.err : ret;
+			if (comp_ret)
+				goto fail;
+
+			dlen = req->dlen;
+			alloc_ret = zpool_malloc(zpool, dlen, gfp, &handle);
+			if (alloc_ret)
+				goto fail;
+
+			zpool_obj_write(zpool, handle, acomp_ctx->buffers[i], dlen);
+			entries[done]->handle = handle;
+			entries[done]->length = dlen;
+		}
+	}
+
+	acomp_ctx_put_unlock(acomp_ctx);
+	return true;
+
+fail:
 	if (comp_ret == -ENOSPC || alloc_ret == -ENOSPC)
 		zswap_reject_compress_poor++;
 	else if (comp_ret)
@@ -998,7 +1153,16 @@ static bool zswap_compress(struct page *page, struct zswap_entry *entry,
 		zswap_reject_alloc_fail++;
 
 	acomp_ctx_put_unlock(acomp_ctx);
-	return comp_ret == 0 && alloc_ret == 0;
+
+	while (done--)
+		zpool_free(zpool, entries[done]->handle);
+	return false;
+}
+
+static bool zswap_compress(struct page *page, struct zswap_entry *entry,
+			   struct zswap_pool *pool)
+{
+	return zswap_compress_pages(page, &entry, 1, pool);
 }
 
 static bool zswap_decompress(struct zswap_entry *entry, struct folio *folio)
@@ -1010,27 +1174,27 @@ static bool zswap_decompress(struct zswap_entry *entry, struct folio *folio)
 	u8 *src, *obj;
 
 	acomp_ctx = acomp_ctx_get_cpu_lock(entry->pool);
-	obj = zpool_obj_read_begin(zpool, entry->handle, acomp_ctx->buffer);
+	obj = zpool_obj_read_begin(zpool, entry->handle, acomp_ctx->buffers[0]);
 
 	/*
 	 * zpool_obj_read_begin() might return a kmap address of highmem when
-	 * acomp_ctx->buffer is not used.  However, sg_init_one() does not
-	 * handle highmem addresses, so copy the object to acomp_ctx->buffer.
+	 * acomp_ctx->buffers[0] is not used.  However, sg_init_one() does not
+	 * handle highmem addresses, so copy the object to acomp_ctx->buffers[0].
 	 */
 	if (virt_addr_valid(obj)) {
 		src = obj;
 	} else {
-		WARN_ON_ONCE(obj == acomp_ctx->buffer);
-		memcpy(acomp_ctx->buffer, obj, entry->length);
-		src = acomp_ctx->buffer;
+		WARN_ON_ONCE(obj == acomp_ctx->buffers[0]);
+		memcpy(acomp_ctx->buffers[0], obj, entry->length);
+		src = acomp_ctx->buffers[0];
 	}
 
 	sg_init_one(&input, src, entry->length);
 	sg_init_table(&output, 1);
 	sg_set_folio(&output, folio, PAGE_SIZE, 0);
-	acomp_request_set_params(acomp_ctx->req, &input, &output, entry->length, PAGE_SIZE);
-	decomp_ret = crypto_wait_req(crypto_acomp_decompress(acomp_ctx->req), &acomp_ctx->wait);
-	dlen = acomp_ctx->req->dlen;
+	acomp_request_set_params(acomp_ctx->reqs[0], &input, &output, entry->length, PAGE_SIZE);
+	decomp_ret = crypto_wait_req(crypto_acomp_decompress(acomp_ctx->reqs[0]), &acomp_ctx->wait);
+	dlen = acomp_ctx->reqs[0]->dlen;
 
 	zpool_obj_read_end(zpool, entry->handle, obj);
 	acomp_ctx_put_unlock(acomp_ctx);
@@ -1475,84 +1639,278 @@ static void shrink_worker(struct work_struct *w)
 }
 
 /*********************************
-* main API
+* recompression
 **********************************/
+/*
+ * Entries are stored with the fast compressor of the current pool. Those that
+ * stay in zswap for longer than recompress_age_ms are cold data that is not
+ * likely to be loaded soon, so a background worker moves them to the pool of
+ * recompress_compressor, which is slower but compresses better. Like
+ * writeback, it pins the swap slot by adding a folio to the swap cache,
+ * decompresses the entry into it and then replaces the entry's data; the
+ * original data is kept if the new compressor does not save space.
+ */
+#define ZSWAP_RECOMPRESS_BATCH	SWAP_CLUSTER_MAX
+
+struct zswap_recompress_control {
+	struct zswap_pool *pool;
+	unsigned long age;
+};
 
-static bool zswap_store_page(struct page *page,
-			     struct obj_cgroup *objcg,
-			     struct zswap_pool *pool)
+static int zswap_recompress_entry(struct zswap_entry *entry,
+				  swp_entry_t swpentry,
+				  struct zswap_pool *pool)
 {
-	swp_entry_t page_swpentry = page_swap_entry(page);
-	struct zswap_entry *entry, *old;
+	struct zswap_entry new;
+	struct zswap_pool *old_pool;
+	struct xarray *tree;
+	pgoff_t offset = swp_offset(swpentry);
+	struct folio *folio;
+	struct mempolicy *mpol;
+	bool folio_was_allocated;
+	struct swap_info_struct *si;
+	int ret = 0;
 
-	/* allocate entry */
-	entry = zswap_entry_cache_alloc(GFP_KERNEL, page_to_nid(page));
-	if (!entry) {
-		zswap_reject_kmemcache_fail++;
-		return false;
+	si = get_swap_device(swpentry);
+	if (!si)
+		return -EEXIST;
+
+	mpol = get_task_policy(current);
+	folio = __read_swap_cache_async(swpentry, GFP_KERNEL, mpol,
+			NO_INTERLEAVE_INDEX, &folio_was_allocated, true);
+	put_swap_device(si);
+	if (!folio)
+		return -ENOMEM;
+
+	/* being swapped in, so not cold after all */
+	if (!folio_was_allocated) {
+		folio_put(folio);
+		return -EEXIST;
 	}
 
-	if (!zswap_compress(page, entry, pool))
-		goto compress_failed;
+	/* see zswap_writeback_entry() */
+	tree = swap_zswap_tree(swpentry);
+	if (entry != xa_load(tree, offset)) {
+		ret = -ENOMEM;
+		goto out;
+	}
 
-	old = xa_store(swap_zswap_tree(page_swpentry),
-		       swp_offset(page_swpentry),
-		       entry, GFP_KERNEL);
-	if (xa_is_err(old)) {
-		int err = xa_err(old);
+	if (!zswap_decompress(entry, folio)) {
+		ret = -EIO;
+		goto out;
+	}
 
-		WARN_ONCE(err != -ENOMEM, "unexpected xarray error: %d\n", err);
-		zswap_reject_alloc_fail++;
-		goto store_failed;
+	if (!zswap_compress(&folio->page, &new, pool)) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	if (new.length >= entry->length) {
+		zswap_recompress_poor++;
+		zpool_free(pool->zpool, new.handle);
+		ret = -ENOSPC;
+		goto out;
 	}
 
 	/*
-	 * We may have had an existing entry that became stale when
-	 * the folio was redirtied and now the new version is being
-	 * swapped out. Get rid of the old.
+	 * The folio lock excludes loads, invalidation and writeback of the
+	 * slot, so the data can be swapped under the entry in place. Unlike
+	 * a new entry, this also leaves it where it was on the LRU.
 	 */
-	if (old)
-		zswap_entry_free(old);
+	zswap_pool_get(pool);
+	if (entry->objcg) {
+		obj_cgroup_uncharge_zswap(entry->objcg, entry->length);
+		obj_cgroup_charge_zswap(entry->objcg, new.length);
+	}
+
+	old_pool = entry->pool;
+	zpool_free(old_pool->zpool, entry->handle);
+	entry->handle = new.handle;
+	entry->length = new.length;
+	entry->pool = pool;
+	zswap_pool_put(old_pool);
+
+	zswap_recompressed_pages++;
+
+out:
+	/* the data is still in zswap, drop the folio without writing it */
+	delete_from_swap_cache(folio);
+	folio_unlock(folio);
+	folio_put(folio);
+	return ret;
+}
+
+static enum lru_status zswap_recompress_cb(struct list_head *item,
+					   struct list_lru_one *l, void *arg)
+{
+	struct zswap_entry *entry = container_of(item, struct zswap_entry, lru);
+	struct zswap_recompress_control *rc = arg;
+	swp_entry_t swpentry;
+
+	if (entry->pool == rc->pool || entry->recompress_tried)
+		return LRU_SKIP;
 
 	/*
-	 * The entry is successfully compressed and stored in the tree, there is
-	 * no further possibility of failure. Grab refs to the pool and objcg,
-	 * charge zswap memory, and increment zswap_stored_pages.
-	 * The opposite actions will be performed by zswap_entry_free()
-	 * when the entry is removed from the tree.
+	 * The LRU is in store order, except for the second chance rotation.
+	 * LRU_STOP expects the lock to be dropped, like LRU_RETRY does.
 	 */
-	zswap_pool_get(pool);
-	if (objcg) {
-		obj_cgroup_get(objcg);
-		obj_cgroup_charge_zswap(objcg, entry->length);
+	if (time_before(jiffies, entry->stored + rc->age)) {
+		spin_unlock(&l->lock);
+		return LRU_STOP;
 	}
-	atomic_long_inc(&zswap_stored_pages);
 
 	/*
-	 * We finish initializing the entry while it's already in xarray.
-	 * This is safe because:
-	 *
-	 * 1. Concurrent stores and invalidations are excluded by folio lock.
-	 *
-	 * 2. Writeback is excluded by the entry not being on the LRU yet.
-	 *    The publishing order matters to prevent writeback from seeing
-	 *    an incoherent entry.
+	 * Whatever the outcome, do not try it again on every cycle. The entry
+	 * stays in place and is skipped when the walk restarts from the head.
 	 */
-	entry->pool = pool;
-	entry->swpentry = page_swpentry;
-	entry->objcg = objcg;
-	entry->referenced = true;
-	if (entry->length) {
-		INIT_LIST_HEAD(&entry->lru);
-		zswap_lru_add(&zswap_list_lru, entry);
+	entry->recompress_tried = true;
+	swpentry = entry->swpentry;
+	spin_unlock(&l->lock);
+
+	zswap_recompress_entry(entry, swpentry, rc->pool);
+
+	return LRU_RETRY;
+}
+
+static void zswap_recompress_worker(struct work_struct *w)
+{
+	struct zswap_recompress_control rc = {
+		.age = msecs_to_jiffies(READ_ONCE(zswap_recompress_age_ms)),
+	};
+	struct mem_cgroup *memcg;
+	int nid;
+
+	rcu_read_lock();
+	rc.pool = rcu_dereference(zswap_recompress_pool);
+	if (!zswap_pool_tryget(rc.pool))
+		rc.pool = NULL;
+	rcu_read_unlock();
+
+	/* reinstalling a pool restarts the worker */
+	if (!rc.pool)
+		return;
+
+	memcg = mem_cgroup_iter(NULL, NULL, NULL);
+	do {
+		/* zombie LRUs are reparented, the parent gets its turn */
+		if (memcg && !mem_cgroup_online(memcg))
+			continue;
+
+		for_each_node_state(nid, N_NORMAL_MEMORY) {
+			unsigned long nr_to_walk = ZSWAP_RECOMPRESS_BATCH;
+
+			list_lru_walk_one(&zswap_list_lru, nid, memcg,
+					  &zswap_recompress_cb, &rc, &nr_to_walk);
+			cond_resched();
+		}
+	} while ((memcg = mem_cgroup_iter(NULL, memcg, NULL)));
+
+	zswap_pool_put(rc.pool);
+
+	queue_delayed_work(system_unbound_wq, &zswap_recompress_work,
+			   max(rc.age / 4, (unsigned long)HZ));
+}
+
+/*********************************
+* main API
+**********************************/
+
+static bool zswap_store_pages(struct folio *folio, long index,
+			      unsigned int nr, struct obj_cgroup *objcg,
+			      struct zswap_pool *pool)
+{
+	struct zswap_entry *entries[ZSWAP_MAX_BATCH], *entry, *old;
+	struct page *page = folio_page(folio, index);
+	swp_entry_t page_swpentry;
+	unsigned int i, nr_alloc;
+
+	/* allocate entries */
+	for (nr_alloc = 0; nr_alloc < nr; nr_alloc++) {
+		entries[nr_alloc] = zswap_entry_cache_alloc(GFP_KERNEL,
+							    folio_nid(folio));
+		if (!entries[nr_alloc]) {
+			zswap_reject_kmemcache_fail++;
+			goto compress_failed;
+		}
+	}
+
+	if (!zswap_compress_pages(page, entries, nr, pool))
+		goto compress_failed;
+
+	for (i = 0; i < nr; i++) {
+		entry = entries[i];
+		page_swpentry = page_swap_entry(nth_page(page, i));
+
+		old = xa_store(swap_zswap_tree(page_swpentry),
+			       swp_offset(page_swpentry),
+			       entry, GFP_KERNEL);
+		if (xa_is_err(old)) {
+			int err = xa_err(old);
+
+			WARN_ONCE(err != -ENOMEM, "unexpected xarray error: %d\n", err);
+			zswap_reject_alloc_fail++;
+			goto store_failed;
+		}
+
+		/*
+		 * We may have had an existing entry that became stale when
+		 * the folio was redirtied and now the new version is being
+		 * swapped out. Get rid of the old.
+		 */
+		if (old)
+			zswap_entry_free(old);
+
+		/*
+		 * The entry is successfully compressed and stored in the tree,
+		 * there is no further possibility of failure. Grab refs to the
+		 * pool and objcg, charge zswap memory, and increment
+		 * zswap_stored_pages. The opposite actions will be performed
+		 * by zswap_entry_free() when the entry is removed from the
+		 * tree.
+		 */
+		zswap_pool_get(pool);
+		if (objcg) {
+			obj_cgroup_get(objcg);
+			obj_cgroup_charge_zswap(objcg, entry->length);
+		}
+		atomic_long_inc(&zswap_stored_pages);
+
+		/*
+		 * We finish initializing the entry while it's already in
+		 * xarray. This is safe because:
+		 *
+		 * 1. Concurrent stores and invalidations are excluded by folio
+		 *    lock.
+		 *
+		 * 2. Writeback is excluded by the entry not being on the LRU
+		 *    yet. The publishing order matters to prevent writeback
+		 *    from seeing an incoherent entry.
+		 */
+		entry->pool = pool;
+		entry->swpentry = page_swpentry;
+		entry->objcg = objcg;
+		entry->referenced = true;
+		entry->recompress_tried = false;
+		entry->stored = jiffies;
+		if (entry->length) {
+			INIT_LIST_HEAD(&entry->lru);
+			zswap_lru_add(&zswap_list_lru, entry);
+		}
 	}
 
 	return true;
 
 store_failed:
-	zpool_free(pool->zpool, entry->handle);
+	/* the entries that made it into the tree are erased by zswap_store() */
+	for (; i < nr; i++) {
+		zpool_free(pool->zpool, entries[i]->handle);
+		zswap_entry_cache_free(entries[i]);
+	}
+	return false;
+
 compress_failed:
-	zswap_entry_cache_free(entry);
+	while (nr_alloc--)
+		zswap_entry_cache_free(entries[nr_alloc]);
 	return false;
 }
 
@@ -1598,10 +1956,10 @@ bool zswap_store(struct folio *folio)
 		mem_cgroup_put(memcg);
 	}
 
-	for (index = 0; index < nr_pages; ++index) {
-		struct page *page = folio_page(folio, index);
+	for (index = 0; index < nr_pages; index += ZSWAP_MAX_BATCH) {
+		unsigned int nr = min(nr_pages - index, (long)ZSWAP_MAX_BATCH);
 
-		if (!zswap_store_page(page, objcg, pool))
+		if (!zswap_store_pages(folio, index, nr, objcg, pool))
 			goto put_pool;
 	}
 
@@ -1818,6 +2176,10 @@ static int zswap_debugfs_init(void)
 			   zswap_debugfs_root, &zswap_decompress_fail);
 	debugfs_create_u64("written_back_pages", 0444,
 			   zswap_debugfs_root, &zswap_written_back_pages);
+	debugfs_create_u64("recompressed_pages", 0444,
+			   zswap_debugfs_root, &zswap_recompressed_pages);
+	debugfs_create_u64("recompress_poor", 0444,
+			   zswap_debugfs_root, &zswap_recompress_poor);
 	debugfs_create_file("pool_total_size", 0444,
 			    zswap_debugfs_root, NULL, &total_size_fops);
 	debugfs_create_file("stored_pages", 0444,
@@ -1866,6 +2228,7 @@ static int zswap_setup(void)
 	shrinker_register(zswap_shrinker);
 
 	INIT_WORK(&zswap_shrink_work, shrink_worker);
+	INIT_DELAYED_WORK(&zswap_recompress_work, zswap_recompress_worker);
 
 	pool = __zswap_pool_create_fallback();
 	if (pool) {
@@ -1879,6 +2242,19 @@ static int zswap_setup(void)
 		zswap_enabled = false;
 	}
 
+	if (zswap_has_pool &&
+	    strcmp(zswap_recompress_compressor, ZSWAP_PARAM_UNSET)) {
+		pool = NULL;
+		if (crypto_has_acomp(zswap_recompress_compressor, 0, 0))
+			pool = zswap_pool_create(zswap_zpool_type,
+						 zswap_recompress_compressor);
+		if (pool)
+			zswap_recompress_pool_install(pool);
+		else
+			pr_err("recompression pool %s/%s creation failed\n",
+			       zswap_recompress_compressor, zswap_zpool_type);
+	}
+
 	if (zswap_debugfs_init())
 		pr_warn("debugfs initialization failed\n");
 	zswap_init_state = ZSWAP_INIT_SUCCEED;
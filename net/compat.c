@@ -77,6 +77,7 @@ int __get_compat_msghdr(struct msghdr *kmsg,
 
 	kmsg->msg_iocb = NULL;
 	kmsg->msg_ubuf = NULL;
+	kmsg->msg_rx_batch = NULL;
 	return 0;
 }
 
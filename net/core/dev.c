@@ -77,6 +77,7 @@
 #include <linux/hash.h>
 #include <linux/slab.h>
 #include <linux/sched.h>
+#include <linux/sched/clock.h>
 #include <linux/sched/isolation.h>
 #include <linux/sched/mm.h>
 #include <linux/smpboot.h>
@@ -3991,9 +3992,10 @@ static inline int __dev_xmit_skb(struct sk_buff *skb, struct Qdisc *q,
 				 struct net_device *dev,
 				 struct netdev_queue *txq)
 {
+	struct sk_buff *next, *to_free = NULL;
 	spinlock_t *root_lock = qdisc_lock(q);
-	struct sk_buff *to_free = NULL;
-	bool contended;
+	struct llist_node *ll_list, *first_n;
+	unsigned long defer_count = 0;
 	int rc;
 
 	qdisc_calculate_pkt_len(skb, q);
@@ -4037,63 +4039,87 @@ static inline int __dev_xmit_skb(struct sk_buff *skb, struct Qdisc *q,
 		kfree_skb_reason(skb, SKB_DROP_REASON_TC_RECLASSIFY_LOOP);
 		return NET_XMIT_DROP;
 	}
+
 	/*
-	 * Heuristic to force contended enqueues to serialize on a
-	 * separate lock before trying to get qdisc main lock.
-	 * This permits qdisc->running owner to get the lock more
-	 * often and dequeue packets faster.
-	 * On PREEMPT_RT it is possible to preempt the qdisc owner during xmit
-	 * and then other tasks will only enqueue packets. The packets will be
-	 * sent after the qdisc owner is scheduled again. To prevent this
-	 * scenario the task always serialize on the lock.
+	 * Instead of having all the producers serialize on the qdisc lock,
+	 * queue the packet on q->defer_list without any lock. The producer
+	 * that finds the list empty takes the lock and enqueues the packets
+	 * of the others in a single batch; they return without waiting.
+	 *
+	 * This is an open coded llist_add(), so that defer_count, which
+	 * bounds the length of the list by the qdisc limit, is incremented
+	 * at most once, and only when the list is not empty. Qdiscs that
+	 * have no packet limit of their own are bounded by tx_queue_len.
 	 */
-	contended = qdisc_is_running(q) || IS_ENABLED(CONFIG_PREEMPT_RT);
-	if (unlikely(contended))
-		spin_lock(&q->busylock);
+	first_n = READ_ONCE(q->defer_list.first);
+	do {
+		if (first_n && !defer_count) {
+			defer_count = atomic_long_inc_return(&q->defer_count);
+			if (unlikely(defer_count > (READ_ONCE(q->limit) ?:
+						    READ_ONCE(dev->tx_queue_len)))) {
+				kfree_skb_reason(skb, SKB_DROP_REASON_QDISC_DROP);
+				return NET_XMIT_DROP;
+			}
+		}
+		skb->ll_node.next = first_n;
+	} while (!try_cmpxchg(&q->defer_list.first, &first_n, &skb->ll_node));
+
+	/* The producer which queued the first packet will send ours. */
+	if (first_n)
+		return NET_XMIT_SUCCESS;
 
 	spin_lock(root_lock);
+
+	ll_list = llist_del_all(&q->defer_list);
+	/* The list may briefly grow over q->limit until this is seen. */
+	atomic_long_set(&q->defer_count, 0);
+
+	ll_list = llist_reverse_order(ll_list);
+
 	if (unlikely(test_bit(__QDISC_STATE_DEACTIVATED, &q->state))) {
-		__qdisc_drop(skb, &to_free);
+		llist_for_each_entry_safe(skb, next, ll_list, ll_node)
+			__qdisc_drop(skb, &to_free);
 		rc = NET_XMIT_DROP;
-	} else if ((q->flags & TCQ_F_CAN_BYPASS) && !qdisc_qlen(q) &&
-		   qdisc_run_begin(q)) {
+		goto unlock;
+	}
+	if ((q->flags & TCQ_F_CAN_BYPASS) && !qdisc_qlen(q) &&
+	    !llist_next(ll_list) && qdisc_run_begin(q)) {
 		/*
 		 * This is a work-conserving queue; there are no old skbs
 		 * waiting to be sent out; and the qdisc is not running -
 		 * xmit the skb directly.
 		 */
-
+		DEBUG_NET_WARN_ON_ONCE(skb != llist_entry(ll_list,
+							  struct sk_buff,
+							  ll_node));
 		qdisc_bstats_update(q, skb);
-
-		if (sch_direct_xmit(skb, q, dev, txq, root_lock, true)) {
-			if (unlikely(contended)) {
-				spin_unlock(&q->busylock);
-				contended = false;
-			}
+		if (sch_direct_xmit(skb, q, dev, txq, root_lock, true))
 			__qdisc_run(q);
-		}
-
 		qdisc_run_end(q);
 		rc = NET_XMIT_SUCCESS;
 	} else {
+		int count = 0;
+
 		WRITE_ONCE(q->owner, smp_processor_id());
-		rc = dev_qdisc_enqueue(skb, q, &to_free, txq);
+		llist_for_each_entry_safe(skb, next, ll_list, ll_node) {
+			skb_mark_not_on_list(skb);
+			rc = dev_qdisc_enqueue(skb, q, &to_free, txq);
+			count++;
+		}
 		WRITE_ONCE(q->owner, -1);
 		if (qdisc_run_begin(q)) {
-			if (unlikely(contended)) {
-				spin_unlock(&q->busylock);
-				contended = false;
-			}
 			__qdisc_run(q);
 			qdisc_run_end(q);
 		}
+		/* rc is the verdict of the last packet, ours only if alone. */
+		if (count != 1)
+			rc = NET_XMIT_SUCCESS;
 	}
+unlock:
 	spin_unlock(root_lock);
 	if (unlikely(to_free))
 		kfree_skb_list_reason(to_free,
 				      tcf_get_drop_reason(to_free));
-	if (unlikely(contended))
-		spin_unlock(&q->busylock);
 	return rc;
 }
 
@@ -6836,7 +6862,8 @@ static enum hrtimer_restart napi_watchdog(struct hrtimer *timer)
 	return HRTIMER_NORESTART;
 }
 
-int dev_set_threaded(struct net_device *dev, bool threaded)
+int dev_set_threaded(struct net_device *dev,
+		      enum netdev_napi_threaded threaded)
 {
 	struct napi_struct *napi;
 	int err = 0;
@@ -6851,7 +6878,7 @@ int dev_set_threaded(struct net_device *dev, bool threaded)
 			if (!napi->thread) {
 				err = napi_kthread_create(napi);
 				if (err) {
-					threaded = false;
+					threaded = NETDEV_NAPI_THREADED_DISABLED;
 					break;
 				}
 			}
@@ -6871,8 +6898,11 @@ int dev_set_threaded(struct net_device *dev, bool threaded)
 	 * softirq mode will happen in the next round of napi_schedule().
 	 * This should not cause hiccups/stalls to the live traffic.
 	 */
-	list_for_each_entry(napi, &dev->napi_list, dev_list)
+	list_for_each_entry(napi, &dev->napi_list, dev_list) {
+		assign_bit(NAPI_STATE_THREADED_BUSY_POLL, &napi->state,
+			   threaded == NETDEV_NAPI_THREADED_BUSY_POLL);
 		assign_bit(NAPI_STATE_THREADED, &napi->state, threaded);
+	}
 
 	return err;
 }
@@ -7189,7 +7219,7 @@ void netif_napi_add_weight_locked(struct net_device *dev,
 	 * threaded mode will not be enabled in napi_enable().
 	 */
 	if (dev->threaded && napi_kthread_create(napi))
-		dev->threaded = false;
+		dev->threaded = NETDEV_NAPI_THREADED_DISABLED;
 	netif_napi_set_irq_locked(napi, -1);
 }
 EXPORT_SYMBOL(netif_napi_add_weight_locked);
@@ -7211,7 +7241,8 @@ void napi_disable_locked(struct napi_struct *n)
 		}
 
 		new = val | NAPIF_STATE_SCHED | NAPIF_STATE_NPSVC;
-		new &= ~(NAPIF_STATE_THREADED | NAPIF_STATE_PREFER_BUSY_POLL);
+		new &= ~(NAPIF_STATE_THREADED | NAPIF_STATE_THREADED_BUSY_POLL |
+			 NAPIF_STATE_PREFER_BUSY_POLL);
 	} while (!try_cmpxchg(&n->state, &val, new));
 
 	hrtimer_cancel(&n->timer);
@@ -7256,6 +7287,9 @@ void napi_enable_locked(struct napi_struct *n)
 		new = val & ~(NAPIF_STATE_SCHED | NAPIF_STATE_NPSVC);
 		if (n->dev->threaded && n->thread)
 			new |= NAPIF_STATE_THREADED;
+		if (n->dev->threaded == NETDEV_NAPI_THREADED_BUSY_POLL &&
+		    n->thread)
+			new |= NAPIF_STATE_THREADED_BUSY_POLL;
 	} while (!try_cmpxchg(&n->state, &val, new));
 }
 EXPORT_SYMBOL(napi_enable_locked);
@@ -7323,6 +7357,8 @@ static int __napi_poll(struct napi_struct *n, bool *repoll)
 	if (napi_is_scheduled(n)) {
 		work = n->poll(n, weight);
 		trace_napi_poll(n, work, weight);
+		WRITE_ONCE(n->poll_count, n->poll_count + 1);
+		WRITE_ONCE(n->poll_work, n->poll_work + work);
 
 		xdp_do_check_flushed(n);
 	}
@@ -7419,15 +7455,45 @@ static int napi_thread_wait(struct napi_struct *napi)
 	return -1;
 }
 
-static void napi_threaded_poll_loop(struct napi_struct *napi)
+unsigned int napi_threaded_busy_poll_idle_usecs __read_mostly;
+
+/* In busy poll mode, NAPI_STATE_IN_BUSY_POLL makes napi_complete_done() keep
+ * the NAPI scheduled and its IRQ masked, so the thread polls again right away.
+ * Busy polling stops when the mode is switched off, the NAPI is disabled or,
+ * if napi_threaded_busy_poll_idle_usecs is set, the queue stayed idle for
+ * that long.  One more poll then completes the NAPI and re-arms the IRQ.
+ */
+static bool napi_threaded_busy_poll_stop(struct napi_struct *napi, int work,
+					  u64 *last_work)
+{
+	u64 idle_ns, now;
+
+	if (!test_bit(NAPI_STATE_THREADED_BUSY_POLL, &napi->state) ||
+	    napi_disable_pending(napi) || kthread_should_stop())
+		return true;
+
+	idle_ns = (u64)READ_ONCE(napi_threaded_busy_poll_idle_usecs) *
+		  NSEC_PER_USEC;
+	now = local_clock();
+	if (work || !idle_ns) {
+		*last_work = now;
+		return false;
+	}
+
+	return now - *last_work > idle_ns;
+}
+
+static void napi_threaded_poll_loop(struct napi_struct *napi, bool busy_poll)
 {
 	struct bpf_net_context __bpf_net_ctx, *bpf_net_ctx;
 	struct softnet_data *sd;
 	unsigned long last_qs = jiffies;
+	u64 last_work = local_clock();
 
 	for (;;) {
 		bool repoll = false;
 		void *have;
+		int work;
 
 		local_bh_disable();
 		bpf_net_ctx = bpf_net_ctx_set(&__bpf_net_ctx);
@@ -7436,7 +7502,12 @@ static void napi_threaded_poll_loop(struct napi_struct *napi)
 		sd->in_napi_threaded_poll = true;
 
 		have = netpoll_poll_lock(napi);
-		__napi_poll(napi, &repoll);
+		work = __napi_poll(napi, &repoll);
+		if (busy_poll && !repoll) {
+			/* The NAPI is not completed, flush what GRO holds */
+			gro_flush(&napi->gro, false);
+			gro_normal_list(&napi->gro);
+		}
 		netpoll_poll_unlock(have);
 
 		sd->in_napi_threaded_poll = false;
@@ -7450,6 +7521,14 @@ static void napi_threaded_poll_loop(struct napi_struct *napi)
 		bpf_net_ctx_clear(bpf_net_ctx);
 		local_bh_enable();
 
+		if (busy_poll && !repoll) {
+			if (napi_threaded_busy_poll_stop(napi, work, &last_work)) {
+				clear_bit(NAPI_STATE_IN_BUSY_POLL, &napi->state);
+				busy_poll = false;
+			}
+			repoll = true;
+		}
+
 		if (!repoll)
 			break;
 
@@ -7461,9 +7540,15 @@ static void napi_threaded_poll_loop(struct napi_struct *napi)
 static int napi_threaded_poll(void *data)
 {
 	struct napi_struct *napi = data;
+	bool busy_poll;
 
-	while (!napi_thread_wait(napi))
-		napi_threaded_poll_loop(napi);
+	while (!napi_thread_wait(napi)) {
+		busy_poll = test_bit(NAPI_STATE_THREADED_BUSY_POLL, &napi->state) &&
+			    !napi_disable_pending(napi);
+		if (busy_poll)
+			set_bit(NAPI_STATE_IN_BUSY_POLL, &napi->state);
+		napi_threaded_poll_loop(napi, busy_poll);
+	}
 
 	return 0;
 }
@@ -12639,7 +12724,7 @@ static void run_backlog_napi(unsigned int cpu)
 {
 	struct softnet_data *sd = per_cpu_ptr(&softnet_data, cpu);
 
-	napi_threaded_poll_loop(&sd->backlog);
+	napi_threaded_poll_loop(&sd->backlog, false);
 }
 
 static void backlog_napi_setup(unsigned int cpu)
@@ -66,6 +66,7 @@ static inline void net_shaper_set_real_num_tx_queues(struct net_device *dev,
 
 /* sysctls not referred to from outside net/core/ */
 extern int		netdev_unregister_timeout_secs;
+extern unsigned int	napi_threaded_busy_poll_idle_usecs;
 extern int		weight_p;
 extern int		dev_weight_rx_bias;
 extern int		dev_weight_tx_bias;
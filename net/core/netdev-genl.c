@@ -207,6 +207,10 @@ netdev_nl_napi_fill_one(struct sk_buff *rsp, struct napi_struct *napi,
 			 gro_flush_timeout))
 		goto nla_put_failure;
 
+	if (nla_put_uint(rsp, NETDEV_A_NAPI_POLLS, READ_ONCE(napi->poll_count)) ||
+	    nla_put_uint(rsp, NETDEV_A_NAPI_POLL_WORK, READ_ONCE(napi->poll_work)))
+		goto nla_put_failure;
+
 	genlmsg_end(rsp, hdr);
 
 	return 0;
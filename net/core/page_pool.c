@@ -69,6 +69,8 @@ static const char pp_stats[][ETH_GSTRING_LEN] = {
 	"rx_pp_recycle_ring",
 	"rx_pp_recycle_ring_full",
 	"rx_pp_recycle_released_ref",
+	"rx_pp_recycle_magazine",
+	"rx_pp_recycle_magazine_flush",
 };
 
 /**
@@ -107,6 +109,8 @@ bool page_pool_get_stats(const struct page_pool *pool,
 		stats->recycle_stats.ring += pcpu->ring;
 		stats->recycle_stats.ring_full += pcpu->ring_full;
 		stats->recycle_stats.released_refcnt += pcpu->released_refcnt;
+		stats->recycle_stats.magazine += pcpu->magazine;
+		stats->recycle_stats.magazine_flush += pcpu->magazine_flush;
 	}
 
 	return true;
@@ -147,6 +151,8 @@ u64 *page_pool_ethtool_stats_get(u64 *data, const void *stats)
 	*data++ = pool_stats->recycle_stats.ring;
 	*data++ = pool_stats->recycle_stats.ring_full;
 	*data++ = pool_stats->recycle_stats.released_refcnt;
+	*data++ = pool_stats->recycle_stats.magazine;
+	*data++ = pool_stats->recycle_stats.magazine_flush;
 
 	return data;
 }
@@ -196,7 +202,7 @@ static int page_pool_init(struct page_pool *pool,
 {
 	unsigned int ring_qsize = 1024; /* Default */
 	struct netdev_rx_queue *rxq;
-	int err;
+	int err, cpu;
 
 	page_pool_struct_check();
 
@@ -271,6 +277,19 @@ static int page_pool_init(struct page_pool *pool,
 		return -ENOMEM;
 	}
 
+	/* The system pools are per-CPU already, and would need a magazine
+	 * for every other CPU.
+	 */
+	if (!(pool->slow.flags & PP_FLAG_SYSTEM_POOL)) {
+		pool->magazines = alloc_percpu(struct pp_magazine);
+		if (!pool->magazines) {
+			err = -ENOMEM;
+			goto free_ptr_ring;
+		}
+		for_each_possible_cpu(cpu)
+			spin_lock_init(&per_cpu_ptr(pool->magazines, cpu)->lock);
+	}
+
 	atomic_set(&pool->pages_state_release_cnt, 0);
 
 	/* Driver calling page_pool_create() also call page_pool_destroy() */
@@ -308,6 +327,7 @@ static int page_pool_init(struct page_pool *pool,
 	return 0;
 
 free_ptr_ring:
+	free_percpu(pool->magazines);
 	ptr_ring_cleanup(&pool->ring, NULL);
 #ifdef CONFIG_PAGE_POOL_STATS
 	if (!pool->system)
@@ -318,6 +338,7 @@ static int page_pool_init(struct page_pool *pool,
 
 static void page_pool_uninit(struct page_pool *pool)
 {
+	free_percpu(pool->magazines);
 	ptr_ring_cleanup(&pool->ring, NULL);
 	xa_destroy(&pool->dma_mapped);
 
@@ -372,6 +393,7 @@ struct page_pool *page_pool_create(const struct page_pool_params *params)
 EXPORT_SYMBOL(page_pool_create);
 
 static void page_pool_return_page(struct page_pool *pool, netmem_ref netmem);
+static bool page_pool_drain_magazines(struct page_pool *pool);
 
 static noinline netmem_ref page_pool_refill_alloc_cache(struct page_pool *pool)
 {
@@ -380,7 +402,8 @@ static noinline netmem_ref page_pool_refill_alloc_cache(struct page_pool *pool)
 	int pref_nid; /* preferred NUMA node */
 
 	/* Quicker fallback, avoid locks when ring is empty */
-	if (__ptr_ring_empty(r)) {
+	if (__ptr_ring_empty(r) &&
+	    (!page_pool_drain_magazines(pool) || __ptr_ring_empty(r))) {
 		alloc_stat_inc(pool, empty);
 		return 0;
 	}
@@ -858,30 +881,6 @@ static bool page_pool_napi_local(const struct page_pool *pool)
 	return napi && READ_ONCE(napi->list_owner) == cpuid;
 }
 
-void page_pool_put_unrefed_netmem(struct page_pool *pool, netmem_ref netmem,
-				  unsigned int dma_sync_size, bool allow_direct)
-{
-	if (!allow_direct)
-		allow_direct = page_pool_napi_local(pool);
-
-	netmem =
-		__page_pool_put_page(pool, netmem, dma_sync_size, allow_direct);
-	if (netmem && !page_pool_recycle_in_ring(pool, netmem)) {
-		/* Cache full, fallback to free pages */
-		recycle_stat_inc(pool, ring_full);
-		page_pool_return_page(pool, netmem);
-	}
-}
-EXPORT_SYMBOL(page_pool_put_unrefed_netmem);
-
-void page_pool_put_unrefed_page(struct page_pool *pool, struct page *page,
-				unsigned int dma_sync_size, bool allow_direct)
-{
-	page_pool_put_unrefed_netmem(pool, page_to_netmem(page), dma_sync_size,
-				     allow_direct);
-}
-EXPORT_SYMBOL(page_pool_put_unrefed_page);
-
 static void page_pool_recycle_ring_bulk(struct page_pool *pool,
 					netmem_ref *bulk,
 					u32 bulk_len)
@@ -915,6 +914,121 @@ static void page_pool_recycle_ring_bulk(struct page_pool *pool,
 		page_pool_return_page(pool, bulk[i]);
 }
 
+/* Move a full magazine into the ptr_ring, releasing the pages that are not on
+ * the pool's NUMA node right away. The refill stops at the first such page
+ * found in the ring and falls back to the page allocator.
+ */
+static void page_pool_flush_magazine(struct page_pool *pool,
+				     netmem_ref *bulk, u32 count)
+{
+	int nid = READ_ONCE(pool->p.nid);
+	u32 i, n = 0;
+
+	recycle_stat_inc(pool, magazine_flush);
+
+	for (i = 0; i < count; i++) {
+		if (nid == NUMA_NO_NODE || netmem_is_pref_nid(bulk[i], nid))
+			bulk[n++] = bulk[i];
+		else
+			page_pool_return_page(pool, bulk[i]);
+	}
+
+	if (n)
+		page_pool_recycle_ring_bulk(pool, bulk, n);
+}
+
+/* Move the pages of partial magazines into the ring, so that they don't stay
+ * stranded on CPUs that stopped returning pages. Called from the refill slow
+ * path when the ring is empty, returns true if any page was moved.
+ */
+static bool page_pool_drain_magazines(struct page_pool *pool)
+{
+	netmem_ref bulk[PP_MAGAZINE_SIZE];
+	bool drained = false;
+	u32 count;
+	int cpu;
+
+	if (!pool->magazines || pool->magazines_drained == jiffies)
+		return false;
+	pool->magazines_drained = jiffies;
+
+	for_each_possible_cpu(cpu) {
+		struct pp_magazine *mag = per_cpu_ptr(pool->magazines, cpu);
+
+		if (!READ_ONCE(mag->count))
+			continue;
+
+		spin_lock_bh(&mag->lock);
+		count = mag->count;
+		memcpy(bulk, mag->cache, count * sizeof(bulk[0]));
+		mag->count = 0;
+		spin_unlock_bh(&mag->lock);
+
+		if (count) {
+			page_pool_flush_magazine(pool, bulk, count);
+			drained = true;
+		}
+	}
+
+	return drained;
+}
+
+static bool page_pool_recycle_in_magazine(struct page_pool *pool,
+					  netmem_ref netmem)
+{
+	netmem_ref bulk[PP_MAGAZINE_SIZE];
+	struct pp_magazine *mag;
+	u32 count = 0;
+
+	if (!pool->magazines)
+		return false;
+
+	local_bh_disable();
+	mag = this_cpu_ptr(pool->magazines);
+
+	/* Only contended by page_pool_empty_magazines() */
+	spin_lock(&mag->lock);
+	mag->cache[mag->count++] = netmem;
+	if (mag->count == PP_MAGAZINE_SIZE) {
+		memcpy(bulk, mag->cache, sizeof(bulk));
+		count = mag->count;
+		mag->count = 0;
+	}
+	spin_unlock(&mag->lock);
+
+	recycle_stat_inc(pool, magazine);
+	if (count)
+		page_pool_flush_magazine(pool, bulk, count);
+	local_bh_enable();
+
+	return true;
+}
+
+void page_pool_put_unrefed_netmem(struct page_pool *pool, netmem_ref netmem,
+				  unsigned int dma_sync_size, bool allow_direct)
+{
+	if (!allow_direct)
+		allow_direct = page_pool_napi_local(pool);
+
+	netmem =
+		__page_pool_put_page(pool, netmem, dma_sync_size, allow_direct);
+	if (netmem && !page_pool_recycle_in_magazine(pool, netmem) &&
+	    !page_pool_recycle_in_ring(pool, netmem)) {
+		/* Cache full, fallback to free pages */
+		recycle_stat_inc(pool, ring_full);
+		page_pool_return_page(pool, netmem);
+	}
+}
+EXPORT_SYMBOL(page_pool_put_unrefed_netmem);
+
+void page_pool_put_unrefed_page(struct page_pool *pool, struct page *page,
+				unsigned int dma_sync_size, bool allow_direct)
+{
+	page_pool_put_unrefed_netmem(pool, page_to_netmem(page), dma_sync_size,
+				     allow_direct);
+}
+EXPORT_SYMBOL(page_pool_put_unrefed_page);
+
 /**
  * page_pool_put_netmem_bulk() - release references on multiple netmems
  * @data:	array holding netmem references
@@ -1080,6 +1194,23 @@ static void page_pool_empty_ring(struct page_pool *pool)
 	}
 }
 
+static void page_pool_empty_magazines(struct page_pool *pool)
+{
+	int cpu;
+
+	if (!pool->magazines)
+		return;
+
+	for_each_possible_cpu(cpu) {
+		struct pp_magazine *mag = per_cpu_ptr(pool->magazines, cpu);
+
+		spin_lock_bh(&mag->lock);
+		while (mag->count)
+			page_pool_return_page(pool, mag->cache[--mag->count]);
+		spin_unlock_bh(&mag->lock);
+	}
+}
+
 static void __page_pool_destroy(struct page_pool *pool)
 {
 	if (pool->disconnect)
@@ -1142,6 +1273,7 @@ static void page_pool_scrub(struct page_pool *pool)
 	/* No more consumers should exist, but producers could still
 	 * be in-flight.
 	 */
+	page_pool_empty_magazines(pool);
 	page_pool_empty_ring(pool);
 }
 
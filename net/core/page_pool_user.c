@@ -157,7 +157,11 @@ page_pool_nl_stats_fill(struct sk_buff *rsp, const struct page_pool *pool,
 	    nla_put_uint(rsp, NETDEV_A_PAGE_POOL_STATS_RECYCLE_RING_FULL,
 			 stats.recycle_stats.ring_full) ||
 	    nla_put_uint(rsp, NETDEV_A_PAGE_POOL_STATS_RECYCLE_RELEASED_REFCNT,
-			 stats.recycle_stats.released_refcnt))
+			 stats.recycle_stats.released_refcnt) ||
+	    nla_put_uint(rsp, NETDEV_A_PAGE_POOL_STATS_RECYCLE_MAGAZINE,
+			 stats.recycle_stats.magazine) ||
+	    nla_put_uint(rsp, NETDEV_A_PAGE_POOL_STATS_RECYCLE_MAGAZINE_FLUSH,
+			 stats.recycle_stats.magazine_flush))
 		goto err_cancel_msg;
 
 	genlmsg_end(rsp, hdr);
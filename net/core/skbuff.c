@@ -228,6 +228,9 @@ struct napi_alloc_cache {
 	struct page_frag_cache page;
 	unsigned int skb_count;
 	void *skb_cache[NAPI_SKB_CACHE_SIZE];
+	/* Small heads from net_hotdata.skb_small_head_cache */
+	unsigned int head_count;
+	void *head_cache[NAPI_SKB_CACHE_SIZE];
 };
 
 static DEFINE_PER_CPU(struct page_frag_cache, netdev_alloc_cache);
@@ -613,6 +616,53 @@ static void *kmalloc_reserve(unsigned int *size, gfp_t flags, int node,
 	return obj;
 }
 
+static void *napi_skb_head_cache_get(void)
+{
+	struct napi_alloc_cache *nc = this_cpu_ptr(&napi_alloc_cache);
+	void *head;
+
+	local_lock_nested_bh(&napi_alloc_cache.bh_lock);
+	if (unlikely(!nc->head_count)) {
+		nc->head_count = kmem_cache_alloc_bulk(net_hotdata.skb_small_head_cache,
+						       GFP_ATOMIC | __GFP_NOMEMALLOC |
+						       __GFP_NOWARN,
+						       NAPI_SKB_CACHE_BULK,
+						       nc->head_cache);
+		if (unlikely(!nc->head_count)) {
+			local_unlock_nested_bh(&napi_alloc_cache.bh_lock);
+			return NULL;
+		}
+	}
+
+	head = nc->head_cache[--nc->head_count];
+	local_unlock_nested_bh(&napi_alloc_cache.bh_lock);
+	kasan_mempool_unpoison_object(head, SKB_SMALL_HEAD_CACHE_SIZE);
+
+	return head;
+}
+
+/* Like kmalloc_reserve(), but small heads come from the NAPI percpu cache.
+ * Must be called *only* from the BH context.
+ */
+static void *napi_kmalloc_reserve(unsigned int *size, gfp_t flags, int node,
+				  bool *pfmemalloc)
+{
+	void *obj;
+
+	if (SKB_HEAD_ALIGN(*size) <= SKB_SMALL_HEAD_CACHE_SIZE &&
+	    !(flags & KMALLOC_NOT_NORMAL_BITS) &&
+	    (node == NUMA_NO_NODE || node == numa_mem_id())) {
+		obj = napi_skb_head_cache_get();
+		if (likely(obj)) {
+			*size = SKB_SMALL_HEAD_CACHE_SIZE;
+			*pfmemalloc = false;
+			return obj;
+		}
+	}
+
+	return kmalloc_reserve(size, flags, node, pfmemalloc);
+}
+
 /* 	Allocate a new skbuff. We do this ourselves so we can fill in a few
  *	'private' fields and also do memory statistics to find all the
  *	[BEEP] leaks.
@@ -665,7 +715,10 @@ struct sk_buff *__alloc_skb(unsigned int size, gfp_t gfp_mask,
 	 * aligned memory blocks, unless SLUB/SLAB debug is enabled.
 	 * Both skb->head and skb_shared_info are cache line aligned.
 	 */
-	data = kmalloc_reserve(&size, gfp_mask, node, &pfmemalloc);
+	if (flags & SKB_ALLOC_NAPI)
+		data = napi_kmalloc_reserve(&size, gfp_mask, node, &pfmemalloc);
+	else
+		data = kmalloc_reserve(&size, gfp_mask, node, &pfmemalloc);
 	if (unlikely(!data))
 		goto nodata;
 	/* kmalloc_size_roundup() might give us more room than requested.
@@ -1046,7 +1099,31 @@ static void skb_kfree_head(void *head, unsigned int end_offset)
 		kfree(head);
 }
 
-static void skb_free_head(struct sk_buff *skb)
+static void napi_skb_head_cache_put(void *head)
+{
+	struct napi_alloc_cache *nc = this_cpu_ptr(&napi_alloc_cache);
+	u32 i;
+
+	if (!kasan_mempool_poison_object(head))
+		return;
+
+	local_lock_nested_bh(&napi_alloc_cache.bh_lock);
+	nc->head_cache[nc->head_count++] = head;
+
+	if (unlikely(nc->head_count == NAPI_SKB_CACHE_SIZE)) {
+		for (i = NAPI_SKB_CACHE_HALF; i < NAPI_SKB_CACHE_SIZE; i++)
+			kasan_mempool_unpoison_object(nc->head_cache[i],
+						      SKB_SMALL_HEAD_CACHE_SIZE);
+
+		kmem_cache_free_bulk(net_hotdata.skb_small_head_cache,
+				     NAPI_SKB_CACHE_HALF,
+				     nc->head_cache + NAPI_SKB_CACHE_HALF);
+		nc->head_count = NAPI_SKB_CACHE_HALF;
+	}
+	local_unlock_nested_bh(&napi_alloc_cache.bh_lock);
+}
+
+static void skb_free_head(struct sk_buff *skb, bool napi_safe)
 {
 	unsigned char *head = skb->head;
 
@@ -1054,12 +1131,16 @@ static void skb_free_head(struct sk_buff *skb)
 		if (skb_pp_recycle(skb, head))
 			return;
 		skb_free_frag(head);
+	} else if (napi_safe &&
+		   skb_end_offset(skb) == SKB_SMALL_HEAD_HEADROOM) {
+		napi_skb_head_cache_put(head);
 	} else {
 		skb_kfree_head(head, skb_end_offset(skb));
 	}
 }
 
-static void skb_release_data(struct sk_buff *skb, enum skb_drop_reason reason)
+static void skb_release_data(struct sk_buff *skb, enum skb_drop_reason reason,
+			     bool napi_safe)
 {
 	struct skb_shared_info *shinfo = skb_shinfo(skb);
 	int i;
@@ -1082,7 +1163,7 @@ static void skb_release_data(struct sk_buff *skb, enum skb_drop_reason reason)
 	if (shinfo->frag_list)
 		kfree_skb_list_reason(shinfo->frag_list, reason);
 
-	skb_free_head(skb);
+	skb_free_head(skb, napi_safe);
 exit:
 	/* When we clone an SKB we copy the reycling bit. The pp_recycle
 	 * bit is only set on the head though, so in order to avoid races
@@ -1143,11 +1224,12 @@ void skb_release_head_state(struct sk_buff *skb)
 }
 
 /* Free everything but the sk_buff shell. */
-static void skb_release_all(struct sk_buff *skb, enum skb_drop_reason reason)
+static void skb_release_all(struct sk_buff *skb, enum skb_drop_reason reason,
+			    bool napi_safe)
 {
 	skb_release_head_state(skb);
 	if (likely(skb->head))
-		skb_release_data(skb, reason);
+		skb_release_data(skb, reason, napi_safe);
 }
 
 /**
@@ -1161,7 +1243,7 @@ static void skb_release_all(struct sk_buff *skb, enum skb_drop_reason reason)
 
 void __kfree_skb(struct sk_buff *skb)
 {
-	skb_release_all(skb, SKB_DROP_REASON_NOT_SPECIFIED);
+	skb_release_all(skb, SKB_DROP_REASON_NOT_SPECIFIED, false);
 	kfree_skbmem(skb);
 }
 EXPORT_SYMBOL(__kfree_skb);
@@ -1207,6 +1289,8 @@ EXPORT_SYMBOL(sk_skb_reason_drop);
 
 struct skb_free_array {
 	unsigned int skb_count;
+	/* Small heads go to the NAPI cache, which frees them in bulk */
+	bool napi_safe;
 	void *skb_array[KFREE_SKB_BULK_SIZE];
 };
 
@@ -1220,7 +1304,7 @@ static void kfree_skb_add_bulk(struct sk_buff *skb,
 		return;
 	}
 
-	skb_release_all(skb, reason);
+	skb_release_all(skb, reason, sa->napi_safe);
 	sa->skb_array[sa->skb_count++] = skb;
 
 	if (unlikely(sa->skb_count == KFREE_SKB_BULK_SIZE)) {
@@ -1236,6 +1320,7 @@ kfree_skb_list_reason(struct sk_buff *segs, enum skb_drop_reason reason)
 	struct skb_free_array sa;
 
 	sa.skb_count = 0;
+	sa.napi_safe = in_softirq() && !in_hardirq();
 
 	while (segs) {
 		struct sk_buff *next = segs->next;
@@ -1408,7 +1493,7 @@ EXPORT_SYMBOL(consume_skb);
 void __consume_stateless_skb(struct sk_buff *skb)
 {
 	trace_consume_skb(skb, __builtin_return_address(0));
-	skb_release_data(skb, SKB_CONSUMED);
+	skb_release_data(skb, SKB_CONSUMED, false);
 	kfree_skbmem(skb);
 }
 
@@ -1437,7 +1522,7 @@ static void napi_skb_cache_put(struct sk_buff *skb)
 
 void __napi_kfree_skb(struct sk_buff *skb, enum skb_drop_reason reason)
 {
-	skb_release_all(skb, reason);
+	skb_release_all(skb, reason, true);
 	napi_skb_cache_put(skb);
 }
 
@@ -1475,7 +1560,7 @@ void napi_consume_skb(struct sk_buff *skb, int budget)
 		return;
 	}
 
-	skb_release_all(skb, SKB_CONSUMED);
+	skb_release_all(skb, SKB_CONSUMED, true);
 	napi_skb_cache_put(skb);
 }
 EXPORT_SYMBOL(napi_consume_skb);
@@ -1606,7 +1691,7 @@ EXPORT_SYMBOL_GPL(alloc_skb_for_msg);
  */
 struct sk_buff *skb_morph(struct sk_buff *dst, struct sk_buff *src)
 {
-	skb_release_all(dst, SKB_CONSUMED);
+	skb_release_all(dst, SKB_CONSUMED, false);
 	return __skb_clone(dst, src);
 }
 EXPORT_SYMBOL_GPL(skb_morph);
@@ -2262,9 +2347,9 @@ int pskb_expand_head(struct sk_buff *skb, int nhead, int ntail,
 		if (skb_has_frag_list(skb))
 			skb_clone_fraglist(skb);
 
-		skb_release_data(skb, SKB_CONSUMED);
+		skb_release_data(skb, SKB_CONSUMED, false);
 	} else {
-		skb_free_head(skb);
+		skb_free_head(skb, false);
 	}
 	off = (data + nhead) - skb->head;
 
@@ -5061,14 +5146,18 @@ static void skb_extensions_init(void) {}
 
 void __init skb_init(void)
 {
-	net_hotdata.skbuff_cache = kmem_cache_create_usercopy("skbuff_head_cache",
+	struct kmem_cache_args skb_args = {
+		.useroffset	= offsetof(struct sk_buff, cb),
+		.usersize	= sizeof_field(struct sk_buff, cb),
+		/* skbs are commonly freed on another cpu than allocated */
+		.sheaf_capacity	= 32,
+	};
+
+	net_hotdata.skbuff_cache = kmem_cache_create("skbuff_head_cache",
 					      sizeof(struct sk_buff),
-					      0,
+					      &skb_args,
 					      SLAB_HWCACHE_ALIGN|SLAB_PANIC|
-						FLAG_SKB_NO_MERGE,
-					      offsetof(struct sk_buff, cb),
-					      sizeof_field(struct sk_buff, cb),
-					      NULL);
+						FLAG_SKB_NO_MERGE);
 	net_hotdata.skbuff_fclone_cache = kmem_cache_create("skbuff_fclone_cache",
 						sizeof(struct sk_buff_fclones),
 						0,
@@ -6695,12 +6784,12 @@ static int pskb_carve_inside_header(struct sk_buff *skb, const u32 off,
 			skb_frag_ref(skb, i);
 		if (skb_has_frag_list(skb))
 			skb_clone_fraglist(skb);
-		skb_release_data(skb, SKB_CONSUMED);
+		skb_release_data(skb, SKB_CONSUMED, false);
 	} else {
 		/* we can reuse existing recount- all we did was
 		 * relocate values
 		 */
-		skb_free_head(skb);
+		skb_free_head(skb, false);
 	}
 
 	skb->head = data;
@@ -6835,7 +6924,7 @@ static int pskb_carve_inside_nonlinear(struct sk_buff *skb, const u32 off,
 		skb_kfree_head(data, size);
 		return -ENOMEM;
 	}
-	skb_release_data(skb, SKB_CONSUMED);
+	skb_release_data(skb, SKB_CONSUMED, false);
 
 	skb->head = data;
 	skb->head_frag = 0;
@@ -515,7 +515,8 @@ static struct sk_msg *alloc_sk_msg(gfp_t gfp)
 }
 
 static struct sk_msg *sk_psock_create_ingress_msg(struct sock *sk,
-						  struct sk_buff *skb)
+						  struct sk_buff *skb,
+						  gfp_t gfp)
 {
 	if (atomic_read(&sk->sk_rmem_alloc) > sk->sk_rcvbuf)
 		return NULL;
@@ -523,7 +524,7 @@ static struct sk_msg *sk_psock_create_ingress_msg(struct sock *sk,
 	if (!sk_rmem_schedule(sk, skb, skb->truesize))
 		return NULL;
 
-	return alloc_sk_msg(GFP_KERNEL);
+	return alloc_sk_msg(gfp);
 }
 
 static int sk_psock_skb_ingress_enqueue(struct sk_buff *skb,
@@ -573,7 +574,7 @@ static int sk_psock_skb_ingress_self(struct sk_psock *psock, struct sk_buff *skb
 				     u32 off, u32 len, bool take_ref);
 
 static int sk_psock_skb_ingress(struct sk_psock *psock, struct sk_buff *skb,
-				u32 off, u32 len)
+				u32 off, u32 len, gfp_t gfp)
 {
 	struct sock *sk = psock->sk;
 	struct sk_msg *msg;
@@ -585,7 +586,7 @@ static int sk_psock_skb_ingress(struct sk_psock *psock, struct sk_buff *skb,
 	 */
 	if (unlikely(skb->sk == sk))
 		return sk_psock_skb_ingress_self(psock, skb, off, len, true);
-	msg = sk_psock_create_ingress_msg(sk, skb);
+	msg = sk_psock_create_ingress_msg(sk, skb, gfp);
 	if (!msg)
 		return -EAGAIN;
 
@@ -631,7 +632,7 @@ static int sk_psock_handle_skb(struct sk_psock *psock, struct sk_buff *skb,
 		return skb_send_sock(psock->sk, skb, off, len);
 	}
 
-	return sk_psock_skb_ingress(psock, skb, off, len);
+	return sk_psock_skb_ingress(psock, skb, off, len, GFP_KERNEL);
 }
 
 static void sk_psock_skb_state(struct sk_psock *psock,
@@ -955,6 +956,32 @@ static int sk_psock_skb_redirect(struct sk_psock *from, struct sk_buff *skb)
 		return -EIO;
 	}
 
+	/* Redirects to a local peer's ingress are queued on its receive
+	 * side right away when nothing is pending in its backlog. The worker
+	 * dequeues an skb only once it is fully handled, so an empty backlog
+	 * means that no earlier data from this socket can be overtaken.
+	 */
+	if (skb_bpf_ingress(skb) && !skb_bpf_strparser(skb) &&
+	    skb_queue_empty(&psock_other->ingress_skb)) {
+		spin_unlock_bh(&psock_other->ingress_lock);
+
+		skb_bpf_redirect_clear(skb);
+		if (sk_psock_skb_ingress(psock_other, skb, 0, skb->len,
+					 GFP_ATOMIC) > 0) {
+			consume_skb(skb);
+			return 0;
+		}
+		skb_bpf_set_redir(skb, sk_other, true);
+
+		spin_lock_bh(&psock_other->ingress_lock);
+		if (!sk_psock_test_state(psock_other, SK_PSOCK_TX_ENABLED)) {
+			spin_unlock_bh(&psock_other->ingress_lock);
+			skb_bpf_redirect_clear(skb);
+			sock_drop(from->sk, skb);
+			return -EIO;
+		}
+	}
+
 	skb_queue_tail(&psock_other->ingress_skb, skb);
 	schedule_delayed_work(&psock_other->work, 0);
 	spin_unlock_bh(&psock_other->ingress_lock);
@@ -632,6 +632,13 @@ static struct ctl_table net_core_table[] = {
 		.extra1		= SYSCTL_ONE,
 		.extra2		= &int_3600,
 	},
+	{
+		.procname	= "napi_threaded_busy_poll_idle_usecs",
+		.data		= &napi_threaded_busy_poll_idle_usecs,
+		.maxlen		= sizeof(unsigned int),
+		.mode		= 0644,
+		.proc_handler	= proc_douintvec,
+	},
 	{
 		.procname	= "skb_defer_max",
 		.data		= &net_hotdata.sysctl_skb_defer_max,
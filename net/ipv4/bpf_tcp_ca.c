@@ -188,12 +188,65 @@ bpf_tcp_ca_get_func_proto(enum bpf_func_id func_id,
 	}
 }
 
+__bpf_kfunc_start_defs();
+
+/**
+ * bpf_tcp_ca_ack_rx_hwtstamp - NIC receive time of the current ACK
+ * @sk: TCP socket whose congestion control has TCP_CONG_WANTS_ACK_HINTS set
+ *
+ * Return: the hardware timestamp in ns, or 0 if the NIC did not provide one.
+ */
+__bpf_kfunc u64 bpf_tcp_ca_ack_rx_hwtstamp(struct sock *sk)
+{
+	if (!sk_is_tcp(sk) || !tcp_ca_wants_ack_hints(sk))
+		return 0;
+	return tcp_sk(sk)->ack_hints.rx_hwtstamp;
+}
+
+/**
+ * bpf_tcp_ca_ack_tx_hwtstamp - NIC send time of the newest skb the ACK acked
+ * @sk: TCP socket whose congestion control has TCP_CONG_WANTS_ACK_HINTS set
+ *
+ * Only skbs that were sent with SOF_TIMESTAMPING_TX_HARDWARE and never
+ * retransmitted carry such a timestamp.
+ *
+ * Return: the hardware timestamp in ns, or 0 if none is known.
+ */
+__bpf_kfunc u64 bpf_tcp_ca_ack_tx_hwtstamp(struct sock *sk)
+{
+	if (!sk_is_tcp(sk) || !tcp_ca_wants_ack_hints(sk))
+		return 0;
+	return tcp_sk(sk)->ack_hints.tx_hwtstamp;
+}
+
+/**
+ * bpf_tcp_ca_ack_delivered_ce - Packets delivered with CE marks by the ACK
+ * @sk: TCP socket whose congestion control has TCP_CONG_WANTS_ACK_HINTS set
+ *
+ * Return: the number of packets newly delivered by the ACK that was
+ * processed with ECE set, i.e. the increment of tp->delivered_ce.
+ */
+__bpf_kfunc u32 bpf_tcp_ca_ack_delivered_ce(struct sock *sk)
+{
+	struct tcp_sock *tp;
+
+	if (!sk_is_tcp(sk) || !tcp_ca_wants_ack_hints(sk))
+		return 0;
+	tp = tcp_sk(sk);
+	return tp->delivered_ce - tp->ack_hints.prior_delivered_ce;
+}
+
+__bpf_kfunc_end_defs();
+
 BTF_KFUNCS_START(bpf_tcp_ca_check_kfunc_ids)
 BTF_ID_FLAGS(func, tcp_reno_ssthresh)
 BTF_ID_FLAGS(func, tcp_reno_cong_avoid)
 BTF_ID_FLAGS(func, tcp_reno_undo_cwnd)
 BTF_ID_FLAGS(func, tcp_slow_start)
 BTF_ID_FLAGS(func, tcp_cong_avoid_ai)
+BTF_ID_FLAGS(func, bpf_tcp_ca_ack_rx_hwtstamp)
+BTF_ID_FLAGS(func, bpf_tcp_ca_ack_tx_hwtstamp)
+BTF_ID_FLAGS(func, bpf_tcp_ca_ack_delivered_ce)
 BTF_KFUNCS_END(bpf_tcp_ca_check_kfunc_ids)
 
 static const struct btf_kfunc_id_set bpf_tcp_ca_kfunc_set = {
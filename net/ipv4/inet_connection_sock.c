@@ -611,7 +611,7 @@ EXPORT_SYMBOL_GPL(inet_csk_get_port);
  * Wait for an incoming connection, avoid race conditions. This must be called
  * with the socket locked.
  */
-static int inet_csk_wait_for_connect(struct sock *sk, long timeo)
+static int inet_csk_wait_for_connect(struct sock *sk, long *timeo)
 {
 	struct inet_connection_sock *icsk = inet_csk(sk);
 	DEFINE_WAIT(wait);
@@ -636,7 +636,7 @@ static int inet_csk_wait_for_connect(struct sock *sk, long timeo)
 					  TASK_INTERRUPTIBLE);
 		release_sock(sk);
 		if (reqsk_queue_empty(&icsk->icsk_accept_queue))
-			timeo = schedule_timeout(timeo);
+			*timeo = schedule_timeout(*timeo);
 		sched_annotate_sleep();
 		lock_sock(sk);
 		err = 0;
@@ -645,11 +645,11 @@ static int inet_csk_wait_for_connect(struct sock *sk, long timeo)
 		err = -EINVAL;
 		if (sk->sk_state != TCP_LISTEN)
 			break;
-		err = sock_intr_errno(timeo);
+		err = sock_intr_errno(*timeo);
 		if (signal_pending(current))
 			break;
 		err = -EAGAIN;
-		if (!timeo)
+		if (!*timeo)
 			break;
 	}
 	finish_wait(sk_sleep(sk), &wait);
@@ -664,10 +664,26 @@ struct sock *inet_csk_accept(struct sock *sk, struct proto_accept_arg *arg)
 	struct inet_connection_sock *icsk = inet_csk(sk);
 	struct request_sock_queue *queue = &icsk->icsk_accept_queue;
 	struct request_sock *req;
+	bool locked = false;
 	struct sock *newsk;
+	long timeo;
 	int error;
 
+	/* Fast path: an established child is already queued.  The accept
+	 * queue is serialised by rskq_lock, and children are never added once
+	 * the listener left TCP_LISTEN, so the listener lock is only needed
+	 * to check the state and to wait for a connection.  Concurrent
+	 * accept() callers then only contend on rskq_lock.
+	 */
+	if (!reqsk_queue_empty(queue) &&
+	    inet_sk_state_load(sk) == TCP_LISTEN) {
+		req = reqsk_queue_remove(queue, sk);
+		if (req)
+			goto got_req;
+	}
+
 	lock_sock(sk);
+	locked = true;
 
 	/* We need to make sure that this socket is listening,
 	 * and that it has something pending.
@@ -676,20 +692,21 @@ struct sock *inet_csk_accept(struct sock *sk, struct proto_accept_arg *arg)
 	if (sk->sk_state != TCP_LISTEN)
 		goto out_err;
 
-	/* Find already established connection */
-	if (reqsk_queue_empty(queue)) {
-		long timeo = sock_rcvtimeo(sk, arg->flags & O_NONBLOCK);
-
+	/* Find already established connection.  Lockless callers can take
+	 * it before us after we were woken up, so wait again in that case.
+	 */
+	timeo = sock_rcvtimeo(sk, arg->flags & O_NONBLOCK);
+	while (!(req = reqsk_queue_remove(queue, sk))) {
 		/* If this is a non blocking socket don't sleep */
 		error = -EAGAIN;
 		if (!timeo)
 			goto out_err;
 
-		error = inet_csk_wait_for_connect(sk, timeo);
+		error = inet_csk_wait_for_connect(sk, &timeo);
 		if (error)
 			goto out_err;
 	}
-	req = reqsk_queue_remove(queue, sk);
+got_req:
 	arg->is_empty = reqsk_queue_empty(queue);
 	newsk = req->sk;
 
@@ -710,7 +727,8 @@ struct sock *inet_csk_accept(struct sock *sk, struct proto_accept_arg *arg)
 	}
 
 out:
-	release_sock(sk);
+	if (locked)
+		release_sock(sk);
 	if (newsk && mem_cgroup_sockets_enabled) {
 		gfp_t gfp = GFP_KERNEL | __GFP_NOFAIL;
 		int amt = 0;
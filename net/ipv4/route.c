@@ -81,6 +81,7 @@
 #include <linux/random.h>
 #include <linux/rcupdate.h>
 #include <linux/slab.h>
+#include <linux/hash.h>
 #include <linux/jhash.h>
 #include <net/dst.h>
 #include <net/dst_metadata.h>
@@ -1543,11 +1544,15 @@ static void ipv4_dst_destroy(struct dst_entry *dst)
 	rt_del_uncached_list(dst_rtable(dst));
 }
 
+static void rt_output_cache_flush_dev(struct net_device *dev);
+
 void rt_flush_dev(struct net_device *dev)
 {
 	struct rtable *rt, *safe;
 	int cpu;
 
+	rt_output_cache_flush_dev(dev);
+
 	for_each_possible_cpu(cpu) {
 		struct uncached_list *ul = &per_cpu(rt_uncached_list, cpu);
 
@@ -2928,6 +2933,179 @@ struct rtable *ip_route_output_flow(struct net *net, struct flowi4 *flp4,
 }
 EXPORT_SYMBOL_GPL(ip_route_output_flow);
 
+/* Small per-CPU cache of output routes for senders that look up a route per
+ * packet, such as unconnected UDP sockets.  An entry is only used as long as
+ * the route is still valid (dst_check() and the rt_genid of the netns), so any
+ * FIB, nexthop or PMTU change invalidates it just like a socket's dst cache.
+ */
+#define RT_OUTPUT_CACHE_BITS	6
+
+struct rt_output_cache_entry {
+	struct rtable	*rt;
+	const struct net *net;
+	__be32		daddr;
+	__be32		saddr;
+	__be32		fl_daddr;
+	__be32		fl_saddr;
+	int		oif;
+	int		genid;
+	u8		tos;
+	u8		scope;
+};
+
+struct rt_output_cache {
+	spinlock_t	lock;
+	struct rt_output_cache_entry entries[1 << RT_OUTPUT_CACHE_BITS];
+};
+
+static DEFINE_PER_CPU(struct rt_output_cache, rt_output_cache) = {
+	.lock = __SPIN_LOCK_UNLOCKED(rt_output_cache.lock),
+};
+
+/* The result of the lookup must depend on nothing but the cache key */
+static bool rt_output_cacheable(const struct net *net, const struct flowi4 *fl4)
+{
+	if (fl4->flowi4_flags || !fl4->daddr || ipv4_is_multicast(fl4->daddr) ||
+	    fl4->flowi4_l3mdev || fib4_has_custom_rules(net))
+		return false;
+#ifdef CONFIG_IP_ROUTE_MULTIPATH
+	if (READ_ONCE(net->ipv4.sysctl_fib_multipath_hash_policy) ||
+	    READ_ONCE(net->ipv4.sysctl_fib_multipath_use_neigh))
+		return false;
+#endif
+	return true;
+}
+
+static u32 rt_output_cache_hash(const struct flowi4 *fl4)
+{
+	return hash_32((__force u32)fl4->daddr ^ (__force u32)fl4->saddr ^
+		       fl4->flowi4_oif, RT_OUTPUT_CACHE_BITS);
+}
+
+static bool rt_output_cache_match(const struct rt_output_cache_entry *e,
+				  const struct net *net,
+				  const struct flowi4 *fl4)
+{
+	return e->rt && e->net == net && e->daddr == fl4->daddr &&
+	       e->saddr == fl4->saddr && e->oif == fl4->flowi4_oif &&
+	       e->tos == fl4->flowi4_tos && e->scope == fl4->flowi4_scope;
+}
+
+static struct rtable *rt_output_cache_get(struct net *net, struct flowi4 *fl4)
+{
+	struct rt_output_cache_entry *e;
+	struct rt_output_cache *c;
+	struct rtable *rt = NULL;
+
+	local_bh_disable();
+	c = this_cpu_ptr(&rt_output_cache);
+	e = &c->entries[rt_output_cache_hash(fl4)];
+	spin_lock(&c->lock);
+	if (rt_output_cache_match(e, net, fl4) &&
+	    e->genid == rt_genid_ipv4(net) &&
+	    dst_check(&e->rt->dst, 0) &&
+	    net_eq(dev_net(e->rt->dst.dev), net)) {
+		rt = e->rt;
+		dst_hold(&rt->dst);
+		fl4->saddr = e->fl_saddr;
+		fl4->daddr = e->fl_daddr;
+		fl4->flowi4_iif = LOOPBACK_IFINDEX;
+	}
+	spin_unlock(&c->lock);
+	local_bh_enable();
+
+	return rt;
+}
+
+static void rt_output_cache_set(struct net *net, const struct flowi4 *key,
+				const struct flowi4 *fl4, struct rtable *rt)
+{
+	struct rt_output_cache_entry *e;
+	struct rt_output_cache *c;
+	struct rtable *old;
+
+	dst_hold(&rt->dst);
+
+	local_bh_disable();
+	c = this_cpu_ptr(&rt_output_cache);
+	e = &c->entries[rt_output_cache_hash(key)];
+	spin_lock(&c->lock);
+	old = e->rt;
+	e->rt = rt;
+	e->net = net;
+	e->daddr = key->daddr;
+	e->saddr = key->saddr;
+	e->oif = key->flowi4_oif;
+	e->tos = key->flowi4_tos;
+	e->scope = key->flowi4_scope;
+	e->fl_daddr = fl4->daddr;
+	e->fl_saddr = fl4->saddr;
+	e->genid = rt_genid_ipv4(net);
+	spin_unlock(&c->lock);
+	local_bh_enable();
+
+	if (old)
+		ip_rt_put(old);
+}
+
+static void rt_output_cache_flush_dev(struct net_device *dev)
+{
+	int cpu, i;
+
+	for_each_possible_cpu(cpu) {
+		struct rt_output_cache *c = per_cpu_ptr(&rt_output_cache, cpu);
+
+		spin_lock_bh(&c->lock);
+		for (i = 0; i < ARRAY_SIZE(c->entries); i++) {
+			struct rt_output_cache_entry *e = &c->entries[i];
+
+			if (e->rt && e->rt->dst.dev == dev) {
+				ip_rt_put(e->rt);
+				e->rt = NULL;
+			}
+		}
+		spin_unlock_bh(&c->lock);
+	}
+}
+
+/**
+ * ip_route_output_flow_cached - ip_route_output_flow() for per-packet lookups
+ * @net: network namespace
+ * @flp4: flow to route, updated like ip_route_output_flow() does
+ * @sk: socket the flow belongs to
+ *
+ * Looks the route up in a per-CPU cache first, for senders that would
+ * otherwise do a full FIB lookup for every packet.
+ */
+struct rtable *ip_route_output_flow_cached(struct net *net, struct flowi4 *flp4,
+					   const struct sock *sk)
+{
+	struct flowi4 key;
+	struct rtable *rt;
+
+	if (!rt_output_cacheable(net, flp4))
+		return ip_route_output_flow(net, flp4, sk);
+
+	rt = rt_output_cache_get(net, flp4);
+	if (!rt) {
+		key = *flp4;
+		rt = __ip_route_output_key(net, flp4);
+		if (IS_ERR(rt))
+			return rt;
+		rt_output_cache_set(net, &key, flp4, rt);
+	}
+
+	if (flp4->flowi4_proto) {
+		flp4->flowi4_oif = rt->dst.dev->ifindex;
+		rt = dst_rtable(xfrm_lookup_route(net, &rt->dst,
+						  flowi4_to_flowi(flp4),
+						  sk, 0));
+	}
+
+	return rt;
+}
+EXPORT_SYMBOL_GPL(ip_route_output_flow_cached);
+
 /* called with rcu_read_lock held */
 static int rt_fill_info(struct net *net, __be32 dst, __be32 src,
 			struct rtable *rt, u32 table_id, dscp_t dscp,
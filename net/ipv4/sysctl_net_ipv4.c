@@ -1436,6 +1436,15 @@ static struct ctl_table ipv4_net_table[] = {
 		.proc_handler	= proc_dou8vec_minmax,
 		.extra1		= SYSCTL_ZERO,
 	},
+	{
+		.procname	= "tcp_gro_merge_acks",
+		.data		= &init_net.ipv4.sysctl_tcp_gro_merge_acks,
+		.maxlen		= sizeof(u8),
+		.mode		= 0644,
+		.proc_handler	= proc_dou8vec_minmax,
+		.extra1		= SYSCTL_ZERO,
+		.extra2		= SYSCTL_ONE,
+	},
 	{
 		.procname	= "tcp_backlog_ack_defer",
 		.data		= &init_net.ipv4.sysctl_tcp_backlog_ack_defer,
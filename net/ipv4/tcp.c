@@ -530,6 +530,12 @@ __poll_t tcp_poll(struct file *file, struct socket *sock, poll_table *wait)
 	if (state == TCP_LISTEN)
 		return inet_csk_listen_poll(sk);
 
+	/* The consumer polls from the CPU it runs on now, so steer the flow
+	 * there before it reads: after a migration, packets that arrive while
+	 * the woken thread is being scheduled would still go to the old CPU.
+	 */
+	sock_rps_record_flow(sk);
+
 	/* Socket is not locked. We are protected from async events
 	 * by poll logic and correct handling of state changes
 	 * made by other threads is impossible in any case.
@@ -1358,10 +1364,101 @@ int tcp_sendmsg_locked(struct sock *sk, struct msghdr *msg, size_t size)
 }
 EXPORT_SYMBOL_GPL(tcp_sendmsg_locked);
 
+/* Largest write tcp_sendmsg_small() tries to append to the tail skb */
+#define TCP_SMALL_SEND_MAX	512
+#define TCP_SMALL_SEND_FLAGS	(MSG_DONTWAIT | MSG_NOSIGNAL | MSG_MORE)
+
+/* Append a small write to the unsent tail skb of an established socket.
+ * Called from lock_sock_fast() fast mode, i.e. with the socket spinlock held
+ * and bottom halves disabled, so nothing here may sleep: the data goes into
+ * the page frag already backing the tail, memory must already be forward
+ * allocated and user pages are copied with page faults disabled.  Returns the
+ * number of bytes queued, or 0 when tcp_sendmsg_locked() must do the work.
+ */
+static int tcp_sendmsg_small(struct sock *sk, struct msghdr *msg, size_t size)
+{
+	struct tcp_sock *tp = tcp_sk(sk);
+	struct page_frag *pfrag = sk_page_frag(sk);
+	struct sockcm_cookie sockc;
+	struct sk_buff *skb;
+	int mss_now, size_goal, err, i;
+	bool merge = true;
+
+	if (sk->sk_state != TCP_ESTABLISHED || unlikely(tp->repair) ||
+	    sk->sk_err || (sk->sk_shutdown & SEND_SHUTDOWN))
+		return 0;
+
+	skb = tcp_write_queue_tail(sk);
+	if (!skb || !tcp_skb_can_collapse_to(skb) || skb_zcopy(skb))
+		return 0;
+
+	mss_now = tcp_send_mss(sk, &size_goal, msg->msg_flags);
+	if (skb->len + size > size_goal)
+		return 0;
+
+	if (!sk_stream_memory_free(sk) || size > sk->sk_forward_alloc)
+		return 0;
+
+	i = skb_shinfo(skb)->nr_frags;
+	if (!pfrag->page || pfrag->size - pfrag->offset < size)
+		return 0;
+	if (!skb_can_coalesce(skb, i, pfrag->page, pfrag->offset)) {
+		if (i >= READ_ONCE(net_hotdata.sysctl_max_skb_frags))
+			return 0;
+		merge = false;
+	}
+
+	pagefault_disable();
+	err = skb_copy_to_page_nocache(sk, &msg->msg_iter, skb, pfrag->page,
+				       pfrag->offset, size);
+	pagefault_enable();
+	if (err)
+		return 0;
+
+	if (merge) {
+		skb_frag_size_add(&skb_shinfo(skb)->frags[i - 1], size);
+	} else {
+		skb_fill_page_desc(skb, i, pfrag->page, pfrag->offset, size);
+		page_ref_inc(pfrag->page);
+	}
+	pfrag->offset += size;
+
+	tcp_rate_check_app_limited(sk);
+	sk_clear_bit(SOCKWQ_ASYNC_NOSPACE, sk);
+
+	TCP_SKB_CB(skb)->tcp_flags &= ~TCPHDR_PSH;
+	WRITE_ONCE(tp->write_seq, tp->write_seq + size);
+	TCP_SKB_CB(skb)->end_seq += size;
+	tcp_skb_pcount_set(skb, 0);
+
+	sockc = (struct sockcm_cookie) { .tsflags = READ_ONCE(sk->sk_tsflags)};
+	tcp_tx_timestamp(sk, &sockc);
+	tcp_push(sk, msg->msg_flags, mss_now, tp->nonagle, size_goal);
+
+	return size;
+}
+
 int tcp_sendmsg(struct sock *sk, struct msghdr *msg, size_t size)
 {
 	int ret;
 
+	/* Small writes behind queued data skip the lock_sock()/release_sock()
+	 * round trip as long as nobody else owns the socket.
+	 */
+	if (size && size <= TCP_SMALL_SEND_MAX && !msg->msg_controllen &&
+	    !(msg->msg_flags & ~TCP_SMALL_SEND_FLAGS) &&
+	    !skb_queue_empty_lockless(&sk->sk_write_queue)) {
+		bool slow = lock_sock_fast(sk);
+
+		if (slow)
+			ret = tcp_sendmsg_locked(sk, msg, size);
+		else
+			ret = tcp_sendmsg_small(sk, msg, size);
+		unlock_sock_fast(sk, slow);
+		if (ret)
+			return ret;
+	}
+
 	lock_sock(sk);
 	ret = tcp_sendmsg_locked(sk, msg, size);
 	release_sock(sk);
@@ -0,0 +1,1156 @@
+/* Bottleneck Bandwidth and RTT (BBR) congestion control, version 3
+ *
+ * BBRv3 keeps the model of BBR (see tcp_bbr.c): a windowed max of the
+ * delivery rate and a windowed min of the RTT, paced through sk_pacing_rate.
+ * On top of that it bounds the volume of data in flight with loss and ECN
+ * signals, so that it neither keeps a shallow buffer overflowing nor takes
+ * more than its share from loss-based flows:
+ *
+ *   inflight_hi: the highest inflight that did not cause too much loss or
+ *                ECN marking when probing for bandwidth (long-term bound).
+ *   bw_lo, inflight_lo: cut multiplicatively in every round with loss or
+ *                ECN marks while not probing (short-term bounds).
+ *
+ *   bw = min(max(bw_hi[0], bw_hi[1]), bw_lo)
+ *   cwnd = min(cwnd_gain * bw * min_rtt, inflight_hi, inflight_lo)
+ *
+ * Bandwidth probing in PROBE_BW is a cycle of four phases:
+ *
+ *   DOWN   (pacing_gain 0.9):  drain the queue left by the last probe.
+ *   CRUISE (pacing_gain 1.0):  run with headroom below inflight_hi, until it
+ *                              is time to probe again: after 2-3 seconds, or
+ *                              sooner if a Reno flow would have probed.
+ *   REFILL (pacing_gain 1.0):  one round to refill the pipe with the lower
+ *                              bounds reset.
+ *   UP     (pacing_gain 1.25): grow inflight_hi exponentially per round until
+ *                              the loss rate exceeds 2% or the CE mark rate
+ *                              exceeds 50%, then go back to DOWN.
+ *
+ * STARTUP also ends when a round sees enough loss or ECN marks, not only when
+ * the bandwidth stops growing. PROBE_RTT runs every 5 seconds at half the BDP
+ * instead of 4 packets.
+ *
+ * The loss rate of a round is the number of packets marked lost in the round
+ * relative to the packets in flight when the round started, taken from the
+ * same tcp_rate.c samples as the bandwidth.
+ *
+ * BBRv3 is described in:
+ *   "BBRv3: Algorithm Bug Fixes and Public Internet Deployment",
+ *   Neal Cardwell, Yuchung Cheng, et al., IETF 117, CCWG, July 2023.
+ *
+ * NOTE: like BBR, BBRv3 is best used with the fq qdisc ("man tc-fq") with
+ * pacing enabled; otherwise TCP falls back to its internal pacing.
+ */
+#include <linux/module.h>
+#include <net/tcp.h>
+#include <linux/inet_diag.h>
+#include <linux/inet.h>
+#include <linux/random.h>
+
+/* Scale factor for rate in pkt/uSec unit, as in tcp_bbr.c. */
+#define BW_SCALE 24
+#define BW_UNIT (1 << BW_SCALE)
+
+#define BBR_SCALE 8	/* scaling factor for fractions in BBR (e.g. gains) */
+#define BBR_UNIT (1 << BBR_SCALE)
+
+enum bbr3_mode {
+	BBR3_STARTUP,	/* ramp up sending rate rapidly to fill pipe */
+	BBR3_DRAIN,	/* drain any queue created during startup */
+	BBR3_PROBE_BW,	/* discover, share bw: pace around estimated bw */
+	BBR3_PROBE_RTT,	/* cut inflight to min to probe min_rtt */
+};
+
+/* Phases of the PROBE_BW bandwidth probing cycle */
+enum bbr3_phase {
+	BBR3_BW_PROBE_DOWN,	/* drain excess inflight from the queue */
+	BBR3_BW_PROBE_CRUISE,	/* use pipe, w/ headroom in queue/pipe */
+	BBR3_BW_PROBE_REFILL,	/* refill the pipe again to 100% */
+	BBR3_BW_PROBE_UP,	/* push up inflight to probe for bw/vol */
+};
+
+/* BBRv3 congestion control block */
+struct bbr3 {
+	u64	cycle_mstamp;		/* time of this cycle phase start */
+	u32	min_rtt_us;		/* min RTT in bbr3_min_rtt_win_sec */
+	u32	min_rtt_stamp;		/* timestamp of min_rtt_us */
+	u32	probe_rtt_min_us;	/* min RTT in bbr3_probe_rtt_win_ms */
+	u32	probe_rtt_min_stamp;	/* timestamp of probe_rtt_min_us */
+	u32	probe_rtt_done_stamp;	/* end time for BBR3_PROBE_RTT mode */
+	u32	prior_cwnd;		/* prior cwnd upon entering recovery */
+	u32	next_rtt_delivered;	/* tp->delivered at end of round */
+	u32	bw_hi[2];		/* max bw of the last two probe cycles */
+	u32	bw_lo;			/* short-term bw bound */
+	u32	bw_latest;		/* max bw sampled in this round */
+	u32	inflight_hi;		/* long-term inflight bound */
+	u32	inflight_lo;		/* short-term inflight bound */
+	u32	inflight_latest;	/* max delivered in a sample this round */
+	u32	full_bw;		/* recent bw, to estimate if pipe is full */
+	u32	probe_wait_us;		/* PROBE_BW wait before next probe */
+	u32	round_lost;		/* tp->lost at start of round */
+	u32	round_delivered_ce;	/* tp->delivered_ce at start of round */
+	u32	round_inflight;		/* packets in flight at start of round */
+	u32	probe_up_cnt;		/* packets ACKed per inflight_hi growth */
+	u32	probe_up_acked;		/* packets ACKed since last growth */
+	u32	ecn_alpha;		/* EWMA of the CE mark ratio */
+	u32	mode:2,			/* current bbr3_mode in state machine */
+		phase:2,		/* current bbr3_phase in PROBE_BW */
+		prev_ca_state:3,	/* CA state on previous ACK */
+		packet_conservation:1,	/* use packet conservation? */
+		round_start:1,		/* start of packet-timed tx->ack round? */
+		idle_restart:1,		/* restarting after idle? */
+		probe_rtt_round_done:1,	/* a BBR3_PROBE_RTT round done? */
+		full_bw_reached:1,	/* reached full bw in Startup? */
+		full_bw_cnt:2,		/* rounds without large bw gains */
+		has_seen_rtt:1,		/* have we seen an RTT sample yet? */
+		prev_probe_too_high:1,	/* did last probe hit the bounds? */
+		bw_probe_samples:1,	/* sampling bw of a probe? */
+		rounds_since_probe:8,	/* packet-timed rounds since probe */
+		probe_up_rounds:5,	/* rounds of inflight_hi growth */
+		unused:2;
+	u32	pacing_gain:10,		/* current gain for setting pacing rate */
+		cwnd_gain:10,		/* current gain for setting cwnd */
+		unused_b:12;
+};
+
+/* Window length of min_rtt filter (in sec): */
+static const u32 bbr3_min_rtt_win_sec = 10;
+/* Window length of the min RTT that triggers PROBE_RTT (in ms): */
+static const u32 bbr3_probe_rtt_win_ms = 5000;
+/* Minimum time (in ms) spent at the reduced cwnd in BBR3_PROBE_RTT mode: */
+static const u32 bbr3_probe_rtt_mode_ms = 200;
+/* Fraction of the BDP kept in flight in BBR3_PROBE_RTT mode: */
+static const int bbr3_probe_rtt_cwnd_gain = BBR_UNIT / 2;
+/* Skip TSO below the following bandwidth (bits/sec): */
+static const int bbr3_min_tso_rate = 1200000;
+/* Pace at ~1% below estimated bw, on average, to reduce queue at bottleneck */
+static const int bbr3_pacing_margin_percent = 1;
+
+/* Startup gain of 2.77 keeps doubling the delivery rate every round: */
+static const int bbr3_startup_pacing_gain = BBR_UNIT * 277 / 100 + 1;
+static const int bbr3_startup_cwnd_gain = BBR_UNIT * 2;
+/* Drain gain of 0.35 drains the Startup queue in about one round: */
+static const int bbr3_drain_gain = BBR_UNIT * 35 / 100;
+/* The gain for deriving steady-state cwnd tolerates delayed/stretched ACKs: */
+static const int bbr3_cwnd_gain = BBR_UNIT * 2;
+/* Extra cwnd while pushing inflight up, so pacing is the limit: */
+static const int bbr3_probe_up_cwnd_gain = BBR_UNIT * 9 / 4;
+/* The pacing_gain values of the PROBE_BW phases: */
+static const int bbr3_pacing_gain[] = {
+	[BBR3_BW_PROBE_DOWN]	= BBR_UNIT * 90 / 100,
+	[BBR3_BW_PROBE_CRUISE]	= BBR_UNIT,
+	[BBR3_BW_PROBE_REFILL]	= BBR_UNIT,
+	[BBR3_BW_PROBE_UP]	= BBR_UNIT * 5 / 4,
+};
+
+/* Try to keep at least this many packets in flight, if things go smoothly. */
+static const u32 bbr3_cwnd_min_target = 4;
+
+/* If bw has increased significantly (1.25x), there may be more bw available: */
+static const u32 bbr3_full_bw_thresh = BBR_UNIT * 5 / 4;
+/* But after 3 rounds w/o significant bw growth, estimate pipe is full: */
+static const u32 bbr3_full_bw_cnt = 3;
+/* Or exit Startup after a round with this many losses at a high loss rate: */
+static const u32 bbr3_full_loss_cnt = 6;
+
+/* Loss rate above which inflight is too high (2%): */
+static const u32 bbr3_loss_thresh = BBR_UNIT * 2 / 100;
+/* CE mark rate above which inflight is too high (50%): */
+static const u32 bbr3_ecn_thresh = BBR_UNIT / 2;
+/* Multiplicative decrease of the bounds upon loss (to 0.7x): */
+static const u32 bbr3_beta = BBR_UNIT * 30 / 100;
+/* Gain of the ecn_alpha EWMA (1/16): */
+static const u32 bbr3_ecn_alpha_gain = BBR_UNIT / 16;
+/* Fraction of ecn_alpha that inflight_lo is cut by in a marked round: */
+static const u32 bbr3_ecn_factor = BBR_UNIT / 3;
+/* Only trust ECN marks on paths with a min RTT below this (in usec): */
+static const u32 bbr3_ecn_max_rtt_us = 5000;
+/* Leave this fraction of inflight_hi unused while cruising (15%): */
+static const u32 bbr3_inflight_headroom = BBR_UNIT * 15 / 100;
+/* Wait 2 to 3 seconds between two bandwidth probes: */
+static const u32 bbr3_bw_probe_base_us = 2 * USEC_PER_SEC;
+static const u32 bbr3_bw_probe_rand_us = 1 * USEC_PER_SEC;
+/* But probe at least as often as a Reno flow would, within 63 rounds: */
+static const u32 bbr3_bw_probe_max_rounds = 63;
+
+static void bbr3_check_probe_rtt_done(struct sock *sk);
+
+static bool bbr3_full_bw_reached(const struct sock *sk)
+{
+	const struct bbr3 *bbr = inet_csk_ca(sk);
+
+	return bbr->full_bw_reached;
+}
+
+/* Return the max bandwidth of the last two probe cycles, in pkts/uS << 24. */
+static u32 bbr3_max_bw(const struct sock *sk)
+{
+	const struct bbr3 *bbr = inet_csk_ca(sk);
+
+	return max(bbr->bw_hi[0], bbr->bw_hi[1]);
+}
+
+/* Return the estimated bandwidth of the path, in pkts/uS << BW_SCALE. */
+static u32 bbr3_bw(const struct sock *sk)
+{
+	const struct bbr3 *bbr = inet_csk_ca(sk);
+
+	return min(bbr3_max_bw(sk), bbr->bw_lo);
+}
+
+/* Are we pushing inflight up to see if there is more bandwidth? */
+static bool bbr3_is_probing_bandwidth(const struct sock *sk)
+{
+	const struct bbr3 *bbr = inet_csk_ca(sk);
+
+	return bbr->mode == BBR3_STARTUP ||
+	       (bbr->mode == BBR3_PROBE_BW &&
+		(bbr->phase == BBR3_BW_PROBE_REFILL ||
+		 bbr->phase == BBR3_BW_PROBE_UP));
+}
+
+/*
+ * A classic RFC3168 receiver keeps setting ECE until it sees CWR, so every
+ * ACK of a window would count as CE marked. Only treat ECE as per-packet CE
+ * feedback when the admin knows the receivers echo each mark, DCTCP-style.
+ */
+static bool bbr3_ecn_rfc3168 __read_mostly;
+module_param_named(ecn_rfc3168, bbr3_ecn_rfc3168, bool, 0644);
+MODULE_PARM_DESC(ecn_rfc3168, "Use RFC3168 ECE as per-packet CE feedback (receivers echoing it DCTCP-style)");
+
+/* ECN marks are only a reliable signal with per-packet feedback on short paths. */
+static bool bbr3_ecn_eligible(const struct sock *sk)
+{
+	const struct tcp_sock *tp = tcp_sk(sk);
+	const struct bbr3 *bbr = inet_csk_ca(sk);
+
+	if (!tcp_ecn_mode_accecn(tp) &&
+	    !(tcp_ecn_mode_rfc3168(tp) && READ_ONCE(bbr3_ecn_rfc3168)))
+		return false;
+
+	return bbr->min_rtt_us <= bbr3_ecn_max_rtt_us;
+}
+
+/* Return rate in bytes per second, optionally with a gain. */
+static u64 bbr3_rate_bytes_per_sec(struct sock *sk, u64 rate, int gain)
+{
+	unsigned int mss = tcp_sk(sk)->mss_cache;
+
+	rate *= mss;
+	rate *= gain;
+	rate >>= BBR_SCALE;
+	rate *= USEC_PER_SEC / 100 * (100 - bbr3_pacing_margin_percent);
+	return rate >> BW_SCALE;
+}
+
+/* Convert a BBR bw and gain factor to a pacing rate in bytes per second. */
+static unsigned long bbr3_bw_to_pacing_rate(struct sock *sk, u32 bw, int gain)
+{
+	u64 rate = bw;
+
+	rate = bbr3_rate_bytes_per_sec(sk, rate, gain);
+	rate = min_t(u64, rate, READ_ONCE(sk->sk_max_pacing_rate));
+	return rate;
+}
+
+/* Initialize pacing rate to: startup_pacing_gain * init_cwnd / RTT. */
+static void bbr3_init_pacing_rate_from_rtt(struct sock *sk)
+{
+	struct tcp_sock *tp = tcp_sk(sk);
+	struct bbr3 *bbr = inet_csk_ca(sk);
+	u64 bw;
+	u32 rtt_us;
+
+	if (tp->srtt_us) {		/* any RTT sample yet? */
+		rtt_us = max(tp->srtt_us >> 3, 1U);
+		bbr->has_seen_rtt = 1;
+	} else {			 /* no RTT sample yet */
+		rtt_us = USEC_PER_MSEC;	 /* use nominal default RTT */
+	}
+	bw = (u64)tcp_snd_cwnd(tp) * BW_UNIT;
+	do_div(bw, rtt_us);
+	WRITE_ONCE(sk->sk_pacing_rate,
+		   bbr3_bw_to_pacing_rate(sk, bw, bbr3_startup_pacing_gain));
+}
+
+/* Pace using current bw estimate and a gain factor. */
+static void bbr3_set_pacing_rate(struct sock *sk, u32 bw, int gain)
+{
+	struct tcp_sock *tp = tcp_sk(sk);
+	struct bbr3 *bbr = inet_csk_ca(sk);
+	unsigned long rate = bbr3_bw_to_pacing_rate(sk, bw, gain);
+
+	if (unlikely(!bbr->has_seen_rtt && tp->srtt_us))
+		bbr3_init_pacing_rate_from_rtt(sk);
+	if (bbr3_full_bw_reached(sk) || rate > READ_ONCE(sk->sk_pacing_rate))
+		WRITE_ONCE(sk->sk_pacing_rate, rate);
+}
+
+/* override sysctl_tcp_min_tso_segs */
+static u32 bbr3_min_tso_segs(struct sock *sk)
+{
+	return READ_ONCE(sk->sk_pacing_rate) < (bbr3_min_tso_rate >> 3) ? 1 : 2;
+}
+
+static u32 bbr3_tso_segs_goal(struct sock *sk)
+{
+	struct tcp_sock *tp = tcp_sk(sk);
+	u32 segs, bytes;
+
+	bytes = min_t(unsigned long,
+		      READ_ONCE(sk->sk_pacing_rate) >> READ_ONCE(sk->sk_pacing_shift),
+		      GSO_LEGACY_MAX_SIZE - 1 - MAX_TCP_HEADER);
+	segs = max_t(u32, bytes / tp->mss_cache, bbr3_min_tso_segs(sk));
+
+	return min(segs, 0x7FU);
+}
+
+/* Save "last known good" cwnd so we can restore it after losses or PROBE_RTT */
+static void bbr3_save_cwnd(struct sock *sk)
+{
+	struct tcp_sock *tp = tcp_sk(sk);
+	struct bbr3 *bbr = inet_csk_ca(sk);
+
+	if (bbr->prev_ca_state < TCP_CA_Recovery && bbr->mode != BBR3_PROBE_RTT)
+		bbr->prior_cwnd = tcp_snd_cwnd(tp);  /* this cwnd is good enough */
+	else  /* loss recovery or BBR3_PROBE_RTT have temporarily cut cwnd */
+		bbr->prior_cwnd = max(bbr->prior_cwnd, tcp_snd_cwnd(tp));
+}
+
+static void bbr3_cwnd_event(struct sock *sk, enum tcp_ca_event event)
+{
+	struct tcp_sock *tp = tcp_sk(sk);
+	struct bbr3 *bbr = inet_csk_ca(sk);
+
+	if (event == CA_EVENT_TX_START && tp->app_limited) {
+		bbr->idle_restart = 1;
+		/* Avoid pointless buffer overflows: pace at est. bw if we don't
+		 * need more speed (we're restarting from idle and app-limited).
+		 */
+		if (bbr->mode == BBR3_PROBE_BW)
+			bbr3_set_pacing_rate(sk, bbr3_bw(sk), BBR_UNIT);
+		else if (bbr->mode == BBR3_PROBE_RTT)
+			bbr3_check_probe_rtt_done(sk);
+	}
+}
+
+/* Calculate bdp based on min RTT and the estimated bottleneck bandwidth. */
+static u32 bbr3_bdp(struct sock *sk, u32 bw, int gain)
+{
+	struct bbr3 *bbr = inet_csk_ca(sk);
+	u64 w;
+
+	if (unlikely(bbr->min_rtt_us == ~0U))	 /* no valid RTT samples yet? */
+		return TCP_INIT_CWND;  /* be safe: cap at default initial cwnd*/
+
+	w = (u64)bw * bbr->min_rtt_us;
+
+	return (((w * gain) >> BBR_SCALE) + BW_UNIT - 1) / BW_UNIT;
+}
+
+/* Budget enough cwnd to keep TSO/GSO and delayed ACKs from starving us. */
+static u32 bbr3_quantization_budget(struct sock *sk, u32 cwnd)
+{
+	struct bbr3 *bbr = inet_csk_ca(sk);
+
+	/* Allow enough full-sized skbs in flight to utilize end systems. */
+	cwnd += 3 * bbr3_tso_segs_goal(sk);
+
+	/* Reduce delayed ACKs by rounding up cwnd to the next even number. */
+	cwnd = (cwnd + 1) & ~1U;
+
+	/* Ensure probing gets inflight above BDP even for small BDPs. */
+	if (bbr->mode == BBR3_PROBE_BW && bbr->phase == BBR3_BW_PROBE_UP)
+		cwnd += 2;
+
+	return cwnd;
+}
+
+/* Find inflight based on min RTT and the estimated bottleneck bandwidth. */
+static u32 bbr3_inflight(struct sock *sk, u32 bw, int gain)
+{
+	return bbr3_quantization_budget(sk, bbr3_bdp(sk, bw, gain));
+}
+
+/* The inflight we aim for at the estimated bw, capped by cwnd. */
+static u32 bbr3_target_inflight(struct sock *sk)
+{
+	u32 bdp = bbr3_inflight(sk, bbr3_bw(sk), BBR_UNIT);
+
+	return min(bdp, tcp_snd_cwnd(tcp_sk(sk)));
+}
+
+/* Estimate the packets in the network when the next skb will be sent. */
+static u32 bbr3_packets_in_net_at_edt(struct sock *sk, u32 inflight_now)
+{
+	struct tcp_sock *tp = tcp_sk(sk);
+	struct bbr3 *bbr = inet_csk_ca(sk);
+	u64 now_ns, edt_ns, interval_us;
+	u32 interval_delivered, inflight_at_edt;
+
+	now_ns = tp->tcp_clock_cache;
+	edt_ns = max(tp->tcp_wstamp_ns, now_ns);
+	interval_us = div_u64(edt_ns - now_ns, NSEC_PER_USEC);
+	interval_delivered = (u64)bbr3_bw(sk) * interval_us >> BW_SCALE;
+	inflight_at_edt = inflight_now;
+	if (bbr->pacing_gain > BBR_UNIT)              /* increasing inflight */
+		inflight_at_edt += bbr3_tso_segs_goal(sk);  /* include EDT skb */
+	if (interval_delivered >= inflight_at_edt)
+		return 0;
+	return inflight_at_edt - interval_delivered;
+}
+
+/* inflight_hi minus a headroom that leaves space for other flows. */
+static u32 bbr3_inflight_with_headroom(const struct sock *sk)
+{
+	const struct bbr3 *bbr = inet_csk_ca(sk);
+	u32 headroom;
+
+	if (bbr->inflight_hi == ~0U)
+		return ~0U;
+
+	headroom = max(1U, (u32)(((u64)bbr->inflight_hi *
+				  bbr3_inflight_headroom) >> BBR_SCALE));
+	return max(bbr->inflight_hi - headroom, bbr3_cwnd_min_target);
+}
+
+/* Apply the long-term and short-term inflight bounds to cwnd. */
+static u32 bbr3_bound_cwnd_for_inflight_model(struct sock *sk, u32 cwnd)
+{
+	struct bbr3 *bbr = inet_csk_ca(sk);
+	u32 cap = ~0U;
+
+	if (bbr->mode == BBR3_PROBE_BW && bbr->phase != BBR3_BW_PROBE_CRUISE)
+		cap = bbr->inflight_hi;
+	else if (bbr->mode == BBR3_PROBE_RTT || bbr->mode == BBR3_PROBE_BW)
+		cap = bbr3_inflight_with_headroom(sk);
+	cap = min(cap, bbr->inflight_lo);
+	cap = max(cap, bbr3_cwnd_min_target);
+
+	return min(cwnd, cap);
+}
+
+/* Packet conservation on the first round of recovery, as in tcp_bbr.c. */
+static bool bbr3_set_cwnd_to_recover_or_restore(
+	struct sock *sk, const struct rate_sample *rs, u32 acked, u32 *new_cwnd)
+{
+	struct tcp_sock *tp = tcp_sk(sk);
+	struct bbr3 *bbr = inet_csk_ca(sk);
+	u8 prev_state = bbr->prev_ca_state, state = inet_csk(sk)->icsk_ca_state;
+	u32 cwnd = tcp_snd_cwnd(tp);
+
+	if (rs->losses > 0)
+		cwnd = max_t(s32, cwnd - rs->losses, 1);
+
+	if (state == TCP_CA_Recovery && prev_state != TCP_CA_Recovery) {
+		/* Starting 1st round of Recovery, so do packet conservation. */
+		bbr->packet_conservation = 1;
+		bbr->next_rtt_delivered = tp->delivered;  /* start round now */
+		/* Cut unused cwnd from app behavior, TSQ, or TSO deferral: */
+		cwnd = tcp_packets_in_flight(tp) + acked;
+	} else if (prev_state >= TCP_CA_Recovery && state < TCP_CA_Recovery) {
+		/* Exiting loss recovery; restore cwnd saved before recovery. */
+		cwnd = max(cwnd, bbr->prior_cwnd);
+		bbr->packet_conservation = 0;
+	}
+	bbr->prev_ca_state = state;
+
+	if (bbr->packet_conservation) {
+		*new_cwnd = max(cwnd, tcp_packets_in_flight(tp) + acked);
+		return true;	/* yes, using packet conservation */
+	}
+	*new_cwnd = cwnd;
+	return false;
+}
+
+/* Slow-start up toward target cwnd, then apply the inflight bounds. */
+static void bbr3_set_cwnd(struct sock *sk, const struct rate_sample *rs,
+			  u32 acked, u32 bw, int gain)
+{
+	struct tcp_sock *tp = tcp_sk(sk);
+	struct bbr3 *bbr = inet_csk_ca(sk);
+	u32 cwnd = tcp_snd_cwnd(tp), target_cwnd = 0;
+
+	if (!acked)
+		goto done;  /* no packet fully ACKed; just apply caps */
+
+	if (bbr3_set_cwnd_to_recover_or_restore(sk, rs, acked, &cwnd))
+		goto done;
+
+	target_cwnd = bbr3_inflight(sk, bw, gain);
+
+	/* If we're below target cwnd, slow start cwnd toward target cwnd. */
+	if (bbr3_full_bw_reached(sk))  /* only cut cwnd if we filled the pipe */
+		cwnd = min(cwnd + acked, target_cwnd);
+	else if (cwnd < target_cwnd || tp->delivered < TCP_INIT_CWND)
+		cwnd = cwnd + acked;
+	cwnd = max(cwnd, bbr3_cwnd_min_target);
+
+done:
+	cwnd = bbr3_bound_cwnd_for_inflight_model(sk, cwnd);
+	tcp_snd_cwnd_set(tp, min(cwnd, tp->snd_cwnd_clamp));	/* apply global cap */
+	if (bbr->mode == BBR3_PROBE_RTT) {  /* drain queue, refresh min_rtt */
+		u32 probe_rtt_cwnd = max(bbr3_bdp(sk, bw, bbr3_probe_rtt_cwnd_gain),
+					 bbr3_cwnd_min_target);
+
+		tcp_snd_cwnd_set(tp, min(tcp_snd_cwnd(tp), probe_rtt_cwnd));
+	}
+}
+
+/* Start counting delivered, lost and CE marked packets of a new round. */
+static void bbr3_start_round(struct sock *sk)
+{
+	struct tcp_sock *tp = tcp_sk(sk);
+	struct bbr3 *bbr = inet_csk_ca(sk);
+
+	bbr->next_rtt_delivered = tp->delivered;
+	bbr->round_lost = tp->lost;
+	bbr->round_delivered_ce = tp->delivered_ce;
+	bbr->round_inflight = tcp_packets_in_flight(tp);
+}
+
+/* Has the loss rate of this round exceeded bbr3_loss_thresh? */
+static bool bbr3_is_lossy_round(const struct sock *sk, u32 lost)
+{
+	const struct bbr3 *bbr = inet_csk_ca(sk);
+
+	return lost && (u64)lost * BBR_UNIT >
+		       (u64)bbr3_loss_thresh * max(bbr->round_inflight, 1U);
+}
+
+/* Has the CE mark rate of this round exceeded bbr3_ecn_thresh? */
+static bool bbr3_is_marked_round(const struct sock *sk, u32 delivered, u32 ce)
+{
+	return ce && bbr3_ecn_eligible(sk) &&
+	       (u64)ce * BBR_UNIT > (u64)bbr3_ecn_thresh * delivered;
+}
+
+static void bbr3_reset_lower_bounds(struct sock *sk)
+{
+	struct bbr3 *bbr = inet_csk_ca(sk);
+
+	bbr->bw_lo = ~0U;
+	bbr->inflight_lo = ~0U;
+}
+
+/* Age the max bw filter by one probe cycle. */
+static void bbr3_advance_max_bw_filter(struct sock *sk)
+{
+	struct bbr3 *bbr = inet_csk_ca(sk);
+
+	if (!bbr->bw_hi[1])
+		return;  /* no samples in this cycle; remember the last one */
+	bbr->bw_hi[0] = bbr->bw_hi[1];
+	bbr->bw_hi[1] = 0;
+}
+
+/* Randomize the time to the next probe to desynchronize competing flows. */
+static void bbr3_pick_probe_wait(struct sock *sk)
+{
+	struct bbr3 *bbr = inet_csk_ca(sk);
+
+	bbr->rounds_since_probe = get_random_u32_below(2);
+	bbr->probe_wait_us = bbr3_bw_probe_base_us +
+			     get_random_u32_below(bbr3_bw_probe_rand_us);
+}
+
+static void bbr3_set_phase(struct sock *sk, enum bbr3_phase phase)
+{
+	struct tcp_sock *tp = tcp_sk(sk);
+	struct bbr3 *bbr = inet_csk_ca(sk);
+
+	bbr->phase = phase;
+	bbr->cycle_mstamp = tp->delivered_mstamp;
+}
+
+static void bbr3_start_probe_down(struct sock *sk)
+{
+	struct bbr3 *bbr = inet_csk_ca(sk);
+
+	bbr->mode = BBR3_PROBE_BW;
+	bbr->probe_up_cnt = ~0U;
+	bbr3_pick_probe_wait(sk);
+	bbr3_advance_max_bw_filter(sk);
+	bbr3_set_phase(sk, BBR3_BW_PROBE_DOWN);
+}
+
+static void bbr3_start_probe_cruise(struct sock *sk)
+{
+	struct bbr3 *bbr = inet_csk_ca(sk);
+
+	if (bbr->inflight_lo != ~0U)
+		bbr->inflight_lo = min(bbr->inflight_lo, bbr->inflight_hi);
+	bbr3_set_phase(sk, BBR3_BW_PROBE_CRUISE);
+}
+
+static void bbr3_start_probe_refill(struct sock *sk)
+{
+	struct bbr3 *bbr = inet_csk_ca(sk);
+
+	bbr3_reset_lower_bounds(sk);
+	bbr->probe_up_rounds = 0;
+	bbr->probe_up_acked = 0;
+	bbr3_start_round(sk);
+	bbr3_set_phase(sk, BBR3_BW_PROBE_REFILL);
+}
+
+/* Grow inflight_hi slowly at first, then twice as fast every round. */
+static void bbr3_raise_inflight_hi_slope(struct sock *sk)
+{
+	struct bbr3 *bbr = inet_csk_ca(sk);
+	u32 growth_this_round = 1U << bbr->probe_up_rounds;
+
+	bbr->probe_up_rounds = min(bbr->probe_up_rounds + 1, 30);
+	bbr->probe_up_cnt = max(tcp_snd_cwnd(tcp_sk(sk)) / growth_this_round, 1U);
+}
+
+static void bbr3_start_probe_up(struct sock *sk)
+{
+	struct bbr3 *bbr = inet_csk_ca(sk);
+
+	bbr->prev_probe_too_high = 0;
+	bbr->bw_probe_samples = 1;
+	bbr3_start_round(sk);
+	bbr3_set_phase(sk, BBR3_BW_PROBE_UP);
+	bbr3_raise_inflight_hi_slope(sk);
+}
+
+/* Loss or ECN marks show that the last probe pushed inflight too far. */
+static void bbr3_handle_inflight_too_high(struct sock *sk,
+					  const struct rate_sample *rs)
+{
+	struct bbr3 *bbr = inet_csk_ca(sk);
+	u32 target = bbr3_target_inflight(sk);
+
+	bbr->prev_probe_too_high = 1;
+	bbr->bw_probe_samples = 0;
+	if (!rs->is_app_limited)
+		bbr->inflight_hi = max(rs->prior_in_flight,
+				       (u32)(((u64)target * (BBR_UNIT - bbr3_beta)) >>
+					     BBR_SCALE));
+	if (bbr->mode == BBR3_PROBE_BW && bbr->phase == BBR3_BW_PROBE_UP)
+		bbr3_start_probe_down(sk);
+}
+
+/* While probing, at most bbr3_loss_thresh of the round may be lost. */
+static void bbr3_check_inflight_too_high(struct sock *sk,
+					 const struct rate_sample *rs)
+{
+	struct tcp_sock *tp = tcp_sk(sk);
+	struct bbr3 *bbr = inet_csk_ca(sk);
+
+	if (!rs->losses || !bbr->bw_probe_samples ||
+	    !(bbr->mode == BBR3_PROBE_BW && bbr->phase == BBR3_BW_PROBE_UP))
+		return;
+
+	if (bbr3_is_lossy_round(sk, tp->lost - bbr->round_lost))
+		bbr3_handle_inflight_too_high(sk, rs);
+}
+
+/* Cut the short-term bounds after a round with loss or ECN marks. */
+static void bbr3_adapt_lower_bounds(struct sock *sk, bool loss, bool ecn)
+{
+	struct bbr3 *bbr = inet_csk_ca(sk);
+	u32 cwnd = tcp_snd_cwnd(tcp_sk(sk));
+	u32 beta = BBR_UNIT - bbr3_beta;
+
+	if (bbr3_is_probing_bandwidth(sk) || (!loss && !ecn))
+		return;
+
+	if (bbr->bw_lo == ~0U)
+		bbr->bw_lo = bbr3_max_bw(sk);
+	if (bbr->inflight_lo == ~0U)
+		bbr->inflight_lo = cwnd;
+
+	if (loss) {
+		bbr->bw_lo = max(bbr->bw_latest,
+				 (u32)(((u64)bbr->bw_lo * beta) >> BBR_SCALE));
+		bbr->inflight_lo = max(bbr->inflight_latest,
+				       (u32)(((u64)bbr->inflight_lo * beta) >>
+					     BBR_SCALE));
+	}
+	if (ecn) {
+		u32 cut = (u64)bbr->ecn_alpha * bbr3_ecn_factor >> BBR_SCALE;
+		u32 ecn_inflight_lo = (u64)cwnd * (BBR_UNIT - min(cut, BBR_UNIT)) >>
+				      BBR_SCALE;
+
+		bbr->inflight_lo = min(bbr->inflight_lo, ecn_inflight_lo);
+	}
+	bbr->inflight_lo = max(bbr->inflight_lo, bbr3_cwnd_min_target);
+}
+
+/* End of Startup upon a round with many losses or mostly CE marks. */
+static void bbr3_check_startup_too_high(struct sock *sk, bool loss, bool ecn,
+					u32 lost)
+{
+	struct bbr3 *bbr = inet_csk_ca(sk);
+
+	if (bbr3_full_bw_reached(sk) || bbr->mode != BBR3_STARTUP)
+		return;
+	if (!ecn && !(loss && lost >= bbr3_full_loss_cnt))
+		return;
+
+	bbr->full_bw_reached = 1;
+	bbr->inflight_hi = max(bbr3_bdp(sk, bbr3_max_bw(sk), BBR_UNIT),
+			       bbr->inflight_latest);
+}
+
+/* A packet-timed round ended: digest its loss and ECN signals. */
+static void bbr3_round_done(struct sock *sk)
+{
+	struct tcp_sock *tp = tcp_sk(sk);
+	struct bbr3 *bbr = inet_csk_ca(sk);
+	u32 delivered = tp->delivered - bbr->next_rtt_delivered;
+	u32 lost = tp->lost - bbr->round_lost;
+	u32 ce = tp->delivered_ce - bbr->round_delivered_ce;
+	bool loss, ecn;
+
+	if (bbr3_ecn_eligible(sk) && delivered) {
+		u32 ce_ratio = (u64)min(ce, delivered) * BBR_UNIT / delivered;
+
+		bbr->ecn_alpha -= (u64)bbr->ecn_alpha * bbr3_ecn_alpha_gain >>
+				  BBR_SCALE;
+		bbr->ecn_alpha += (u64)ce_ratio * bbr3_ecn_alpha_gain >>
+				  BBR_SCALE;
+	}
+
+	loss = bbr3_is_lossy_round(sk, lost);
+	ecn = bbr3_is_marked_round(sk, delivered, ce);
+
+	bbr3_check_startup_too_high(sk, loss, ecn, lost);
+	if (ecn && bbr->mode == BBR3_PROBE_BW &&
+	    bbr->phase == BBR3_BW_PROBE_UP) {
+		struct rate_sample rs = {
+			.prior_in_flight = bbr->round_inflight,
+		};
+
+		bbr3_handle_inflight_too_high(sk, &rs);
+	}
+	bbr3_adapt_lower_bounds(sk, loss, ecn);
+
+	bbr->bw_latest = 0;
+	bbr->inflight_latest = 0;
+	if (bbr->mode == BBR3_PROBE_BW && bbr->rounds_since_probe < 255)
+		bbr->rounds_since_probe++;
+
+	bbr3_start_round(sk);
+}
+
+/* Estimate the bandwidth based on how fast packets are delivered */
+static void bbr3_update_bw(struct sock *sk, const struct rate_sample *rs)
+{
+	struct bbr3 *bbr = inet_csk_ca(sk);
+	u64 bw;
+
+	bbr->round_start = 0;
+	if (rs->delivered < 0 || rs->interval_us <= 0)
+		return; /* Not a valid observation */
+
+	/* See if we've reached the next RTT */
+	if (!before(rs->prior_delivered, bbr->next_rtt_delivered)) {
+		bbr->round_start = 1;
+		bbr->packet_conservation = 0;
+		bbr3_round_done(sk);
+	}
+
+	bw = div64_long((u64)rs->delivered * BW_UNIT, rs->interval_us);
+
+	bbr->bw_latest = max_t(u32, bbr->bw_latest, bw);
+	bbr->inflight_latest = max_t(u32, bbr->inflight_latest, rs->delivered);
+
+	/* App-limited samples only count if they raise the estimate */
+	if (!rs->is_app_limited || bw >= bbr3_max_bw(sk))
+		bbr->bw_hi[1] = max_t(u32, bbr->bw_hi[1], bw);
+}
+
+/* Push inflight_hi up while the flow actually uses all of it. */
+static void bbr3_probe_inflight_hi_upward(struct sock *sk,
+					  const struct rate_sample *rs)
+{
+	struct tcp_sock *tp = tcp_sk(sk);
+	struct bbr3 *bbr = inet_csk_ca(sk);
+	u32 delta;
+
+	if (bbr->inflight_hi == ~0U || !tcp_is_cwnd_limited(sk) ||
+	    tcp_snd_cwnd(tp) < bbr->inflight_hi)
+		return;
+
+	bbr->probe_up_acked += rs->acked_sacked;
+	if (bbr->probe_up_acked >= bbr->probe_up_cnt) {
+		delta = bbr->probe_up_acked / bbr->probe_up_cnt;
+		bbr->probe_up_acked -= delta * bbr->probe_up_cnt;
+		bbr->inflight_hi += delta;
+	}
+	if (bbr->round_start)
+		bbr3_raise_inflight_hi_slope(sk);
+}
+
+static bool bbr3_has_elapsed_in_phase(const struct sock *sk, u32 interval_us)
+{
+	const struct tcp_sock *tp = tcp_sk(sk);
+	const struct bbr3 *bbr = inet_csk_ca(sk);
+
+	return tcp_stamp_us_delta(tp->delivered_mstamp,
+				  bbr->cycle_mstamp) > interval_us;
+}
+
+/* Probe after the random wait, or once a Reno flow would have the BDP. */
+static bool bbr3_check_time_to_probe_bw(struct sock *sk)
+{
+	struct bbr3 *bbr = inet_csk_ca(sk);
+	u32 rounds = min(bbr3_target_inflight(sk), bbr3_bw_probe_max_rounds);
+
+	if (bbr3_has_elapsed_in_phase(sk, bbr->probe_wait_us) ||
+	    bbr->rounds_since_probe >= rounds) {
+		bbr3_start_probe_refill(sk);
+		return true;
+	}
+	return false;
+}
+
+/* Cruise once the queue of the probe drained to the target inflight. */
+static bool bbr3_check_time_to_cruise(struct sock *sk, u32 inflight, u32 bw)
+{
+	if (inflight > bbr3_inflight_with_headroom(sk))
+		return false;
+
+	return inflight <= bbr3_inflight(sk, bw, BBR_UNIT);
+}
+
+/* Walk through the phases of the PROBE_BW bandwidth probing cycle. */
+static void bbr3_update_cycle_phase(struct sock *sk,
+				    const struct rate_sample *rs)
+{
+	struct bbr3 *bbr = inet_csk_ca(sk);
+	u32 inflight, bw;
+
+	if (!bbr3_full_bw_reached(sk) || bbr->mode != BBR3_PROBE_BW)
+		return;
+
+	bbr3_check_inflight_too_high(sk, rs);
+	inflight = bbr3_packets_in_net_at_edt(sk, rs->prior_in_flight);
+	bw = bbr3_max_bw(sk);
+
+	switch (bbr->phase) {
+	case BBR3_BW_PROBE_DOWN:
+		if (bbr3_check_time_to_probe_bw(sk))
+			return;
+		if (bbr3_check_time_to_cruise(sk, inflight, bw))
+			bbr3_start_probe_cruise(sk);
+		break;
+	case BBR3_BW_PROBE_CRUISE:
+		bbr3_check_time_to_probe_bw(sk);
+		break;
+	case BBR3_BW_PROBE_REFILL:
+		/* After one round of refilling the pipe, probe upward. */
+		if (bbr->round_start)
+			bbr3_start_probe_up(sk);
+		break;
+	case BBR3_BW_PROBE_UP:
+		bbr3_probe_inflight_hi_upward(sk, rs);
+		/* Stop at the last bound if the probe before it was too high,
+		 * otherwise once inflight reached the probing gain.
+		 */
+		if ((bbr->prev_probe_too_high && inflight >= bbr->inflight_hi) ||
+		    (bbr3_has_elapsed_in_phase(sk, bbr->min_rtt_us) &&
+		     inflight >= bbr3_inflight(sk, bw,
+					       bbr3_pacing_gain[BBR3_BW_PROBE_UP])))
+			bbr3_start_probe_down(sk);
+		break;
+	}
+}
+
+static void bbr3_reset_mode(struct sock *sk)
+{
+	struct bbr3 *bbr = inet_csk_ca(sk);
+
+	bbr3_reset_lower_bounds(sk);
+	if (!bbr3_full_bw_reached(sk)) {
+		bbr->mode = BBR3_STARTUP;
+	} else {
+		bbr3_start_probe_down(sk);
+		bbr3_start_probe_cruise(sk);
+	}
+}
+
+/* Estimate when the pipe is full, using the change in delivery rate. */
+static void bbr3_check_full_bw_reached(struct sock *sk,
+				       const struct rate_sample *rs)
+{
+	struct bbr3 *bbr = inet_csk_ca(sk);
+	u32 bw_thresh;
+
+	if (bbr3_full_bw_reached(sk) || !bbr->round_start || rs->is_app_limited)
+		return;
+
+	bw_thresh = (u64)bbr->full_bw * bbr3_full_bw_thresh >> BBR_SCALE;
+	if (bbr3_max_bw(sk) >= bw_thresh) {
+		bbr->full_bw = bbr3_max_bw(sk);
+		bbr->full_bw_cnt = 0;
+		return;
+	}
+	++bbr->full_bw_cnt;
+	bbr->full_bw_reached = bbr->full_bw_cnt >= bbr3_full_bw_cnt;
+}
+
+/* If pipe is probably full, drain the queue and then enter steady-state. */
+static void bbr3_check_drain(struct sock *sk, const struct rate_sample *rs)
+{
+	struct bbr3 *bbr = inet_csk_ca(sk);
+
+	if (bbr->mode == BBR3_STARTUP && bbr3_full_bw_reached(sk)) {
+		bbr->mode = BBR3_DRAIN;	/* drain queue we created */
+		tcp_sk(sk)->snd_ssthresh =
+				bbr3_inflight(sk, bbr3_max_bw(sk), BBR_UNIT);
+	}	/* fall through to check if in-flight is already small: */
+	if (bbr->mode == BBR3_DRAIN &&
+	    bbr3_packets_in_net_at_edt(sk, tcp_packets_in_flight(tcp_sk(sk))) <=
+	    bbr3_inflight(sk, bbr3_max_bw(sk), BBR_UNIT))
+		bbr3_start_probe_down(sk);  /* we estimate queue is drained */
+}
+
+static void bbr3_check_probe_rtt_done(struct sock *sk)
+{
+	struct tcp_sock *tp = tcp_sk(sk);
+	struct bbr3 *bbr = inet_csk_ca(sk);
+
+	if (!(bbr->probe_rtt_done_stamp &&
+	      after(tcp_jiffies32, bbr->probe_rtt_done_stamp)))
+		return;
+
+	/* wait a while until PROBE_RTT */
+	bbr->probe_rtt_min_stamp = tcp_jiffies32;
+	tcp_snd_cwnd_set(tp, max(tcp_snd_cwnd(tp), bbr->prior_cwnd));
+	bbr3_reset_mode(sk);
+}
+
+/* Track the min RTT over 10 seconds for the BDP, and over 5 seconds to
+ * decide when to cut inflight in PROBE_RTT to re-measure it.
+ */
+static void bbr3_update_min_rtt(struct sock *sk, const struct rate_sample *rs)
+{
+	struct tcp_sock *tp = tcp_sk(sk);
+	struct bbr3 *bbr = inet_csk_ca(sk);
+	bool probe_rtt_expired, min_rtt_expired;
+
+	probe_rtt_expired = after(tcp_jiffies32, bbr->probe_rtt_min_stamp +
+				  msecs_to_jiffies(bbr3_probe_rtt_win_ms));
+	if (rs->rtt_us >= 0 &&
+	    (rs->rtt_us < bbr->probe_rtt_min_us ||
+	     (probe_rtt_expired && !rs->is_ack_delayed))) {
+		bbr->probe_rtt_min_us = rs->rtt_us;
+		bbr->probe_rtt_min_stamp = tcp_jiffies32;
+	}
+
+	min_rtt_expired = after(tcp_jiffies32,
+				bbr->min_rtt_stamp + bbr3_min_rtt_win_sec * HZ);
+	if (bbr->probe_rtt_min_us <= bbr->min_rtt_us || min_rtt_expired) {
+		bbr->min_rtt_us = bbr->probe_rtt_min_us;
+		bbr->min_rtt_stamp = bbr->probe_rtt_min_stamp;
+	}
+
+	if (bbr3_probe_rtt_mode_ms > 0 && probe_rtt_expired &&
+	    !bbr->idle_restart && bbr->mode != BBR3_PROBE_RTT) {
+		bbr->mode = BBR3_PROBE_RTT;  /* dip, drain queue */
+		bbr3_save_cwnd(sk);  /* note cwnd so we can restore it */
+		bbr->probe_rtt_done_stamp = 0;
+	}
+
+	if (bbr->mode == BBR3_PROBE_RTT) {
+		u32 probe_rtt_cwnd = max(bbr3_bdp(sk, bbr3_bw(sk),
+						  bbr3_probe_rtt_cwnd_gain),
+					 bbr3_cwnd_min_target);
+
+		/* Ignore low rate samples during this mode. */
+		tp->app_limited =
+			(tp->delivered + tcp_packets_in_flight(tp)) ? : 1;
+		/* Maintain reduced inflight for max(200 ms, 1 round). */
+		if (!bbr->probe_rtt_done_stamp &&
+		    tcp_packets_in_flight(tp) <= probe_rtt_cwnd) {
+			bbr->probe_rtt_done_stamp = tcp_jiffies32 +
+				msecs_to_jiffies(bbr3_probe_rtt_mode_ms);
+			bbr->probe_rtt_round_done = 0;
+			bbr3_start_round(sk);
+		} else if (bbr->probe_rtt_done_stamp) {
+			if (bbr->round_start)
+				bbr->probe_rtt_round_done = 1;
+			if (bbr->probe_rtt_round_done)
+				bbr3_check_probe_rtt_done(sk);
+		}
+	}
+	/* Restart after idle ends only once we process a new S/ACK for data */
+	if (rs->delivered > 0)
+		bbr->idle_restart = 0;
+}
+
+static void bbr3_update_gains(struct sock *sk)
+{
+	struct bbr3 *bbr = inet_csk_ca(sk);
+
+	switch (bbr->mode) {
+	case BBR3_STARTUP:
+		bbr->pacing_gain = bbr3_startup_pacing_gain;
+		bbr->cwnd_gain	 = bbr3_startup_cwnd_gain;
+		break;
+	case BBR3_DRAIN:
+		bbr->pacing_gain = bbr3_drain_gain;	/* slow, to drain */
+		bbr->cwnd_gain	 = bbr3_startup_cwnd_gain;	/* keep cwnd */
+		break;
+	case BBR3_PROBE_BW:
+		bbr->pacing_gain = bbr3_pacing_gain[bbr->phase];
+		bbr->cwnd_gain	 = bbr->phase == BBR3_BW_PROBE_UP ?
+				   bbr3_probe_up_cwnd_gain : bbr3_cwnd_gain;
+		break;
+	case BBR3_PROBE_RTT:
+		bbr->pacing_gain = BBR_UNIT;
+		bbr->cwnd_gain	 = BBR_UNIT;
+		break;
+	}
+}
+
+static void bbr3_update_model(struct sock *sk, const struct rate_sample *rs)
+{
+	bbr3_update_bw(sk, rs);
+	bbr3_update_cycle_phase(sk, rs);
+	bbr3_check_full_bw_reached(sk, rs);
+	bbr3_check_drain(sk, rs);
+	bbr3_update_min_rtt(sk, rs);
+	bbr3_update_gains(sk);
+}
+
+static void bbr3_main(struct sock *sk, u32 ack, int flag,
+		      const struct rate_sample *rs)
+{
+	struct bbr3 *bbr = inet_csk_ca(sk);
+	u32 bw;
+
+	bbr3_update_model(sk, rs);
+
+	bw = bbr3_bw(sk);
+	bbr3_set_pacing_rate(sk, bw, bbr->pacing_gain);
+	bbr3_set_cwnd(sk, rs, rs->acked_sacked, bw, bbr->cwnd_gain);
+}
+
+static void bbr3_init(struct sock *sk)
+{
+	struct tcp_sock *tp = tcp_sk(sk);
+	struct bbr3 *bbr = inet_csk_ca(sk);
+
+	memset(bbr, 0, sizeof(*bbr));
+	tp->snd_ssthresh = TCP_INFINITE_SSTHRESH;
+	bbr->prev_ca_state = TCP_CA_Open;
+	bbr3_start_round(sk);
+
+	bbr->min_rtt_us = tcp_min_rtt(tp);
+	bbr->min_rtt_stamp = tcp_jiffies32;
+	bbr->probe_rtt_min_us = bbr->min_rtt_us;
+	bbr->probe_rtt_min_stamp = tcp_jiffies32;
+
+	bbr3_init_pacing_rate_from_rtt(sk);
+
+	bbr->inflight_hi = ~0U;
+	bbr3_reset_lower_bounds(sk);
+	bbr->probe_up_cnt = ~0U;
+	bbr->ecn_alpha = BBR_UNIT;
+	bbr3_pick_probe_wait(sk);
+	bbr->mode = BBR3_STARTUP;
+	bbr3_update_gains(sk);
+
+	cmpxchg(&sk->sk_pacing_status, SK_PACING_NONE, SK_PACING_NEEDED);
+}
+
+static u32 bbr3_sndbuf_expand(struct sock *sk)
+{
+	/* Provision 3 * cwnd since BBR may slow-start even during recovery. */
+	return 3;
+}
+
+static u32 bbr3_undo_cwnd(struct sock *sk)
+{
+	struct bbr3 *bbr = inet_csk_ca(sk);
+
+	bbr->full_bw = 0;   /* spurious slow-down; reset full pipe detection */
+	bbr->full_bw_cnt = 0;
+	bbr3_reset_lower_bounds(sk);
+	return tcp_snd_cwnd(tcp_sk(sk));
+}
+
+/* Entering loss recovery, so save cwnd for when we exit or undo recovery. */
+static u32 bbr3_ssthresh(struct sock *sk)
+{
+	bbr3_save_cwnd(sk);
+	return tcp_sk(sk)->snd_ssthresh;
+}
+
+static size_t bbr3_get_info(struct sock *sk, u32 ext, int *attr,
+			    union tcp_cc_info *info)
+{
+	if (ext & (1 << (INET_DIAG_BBRINFO - 1)) ||
+	    ext & (1 << (INET_DIAG_VEGASINFO - 1))) {
+		struct tcp_sock *tp = tcp_sk(sk);
+		struct bbr3 *bbr = inet_csk_ca(sk);
+		u64 bw = bbr3_bw(sk);
+
+		bw = bw * tp->mss_cache * USEC_PER_SEC >> BW_SCALE;
+		memset(&info->bbr, 0, sizeof(info->bbr));
+		info->bbr.bbr_bw_lo		= (u32)bw;
+		info->bbr.bbr_bw_hi		= (u32)(bw >> 32);
+		info->bbr.bbr_min_rtt		= bbr->min_rtt_us;
+		info->bbr.bbr_pacing_gain	= bbr->pacing_gain;
+		info->bbr.bbr_cwnd_gain		= bbr->cwnd_gain;
+		*attr = INET_DIAG_BBRINFO;
+		return sizeof(info->bbr);
+	}
+	return 0;
+}
+
+static void bbr3_set_state(struct sock *sk, u8 new_state)
+{
+	struct bbr3 *bbr = inet_csk_ca(sk);
+
+	if (new_state == TCP_CA_Loss) {
+		struct rate_sample rs = {
+			.losses = 1,
+			.prior_in_flight = bbr->round_inflight,
+		};
+
+		bbr->prev_ca_state = TCP_CA_Loss;
+		bbr->full_bw = 0;
+		bbr->round_start = 1;	/* treat RTO like end of a round */
+		/* An RTO while probing means the probe went too far. */
+		if (bbr->mode == BBR3_PROBE_BW && bbr->phase == BBR3_BW_PROBE_UP)
+			bbr3_handle_inflight_too_high(sk, &rs);
+	}
+}
+
+static struct tcp_congestion_ops tcp_bbr3_cong_ops __read_mostly = {
+	.flags		= TCP_CONG_NON_RESTRICTED,
+	.name		= "bbr3",
+	.owner		= THIS_MODULE,
+	.init		= bbr3_init,
+	.cong_control	= bbr3_main,
+	.sndbuf_expand	= bbr3_sndbuf_expand,
+	.undo_cwnd	= bbr3_undo_cwnd,
+	.cwnd_event	= bbr3_cwnd_event,
+	.ssthresh	= bbr3_ssthresh,
+	.min_tso_segs	= bbr3_min_tso_segs,
+	.get_info	= bbr3_get_info,
+	.set_state	= bbr3_set_state,
+};
+
+static int __init bbr3_register(void)
+{
+	BUILD_BUG_ON(sizeof(struct bbr3) > ICSK_CA_PRIV_SIZE);
+	return tcp_register_congestion_control(&tcp_bbr3_cong_ops);
+}
+
+static void __exit bbr3_unregister(void)
+{
+	tcp_unregister_congestion_control(&tcp_bbr3_cong_ops);
+}
+
+module_init(bbr3_register);
+module_exit(bbr3_unregister);
+
+MODULE_LICENSE("Dual BSD/GPL");
+MODULE_DESCRIPTION("TCP BBRv3 (Bottleneck Bandwidth and RTT, loss/ECN bounded)");
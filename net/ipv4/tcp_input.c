@@ -3444,6 +3444,13 @@ static int tcp_clean_rtx_queue(struct sock *sk, const struct sk_buff *ack_skb,
 		if (!fully_acked)
 			break;
 
+		/* Like RTT samples, only trust never retransmitted skbs */
+		if (unlikely(tcp_ca_wants_ack_hints(sk)) &&
+		    !(sacked & TCPCB_RETRANS) &&
+		    skb_hwtstamps(skb)->hwtstamp)
+			tp->ack_hints.tx_hwtstamp =
+				ktime_to_ns(skb_hwtstamps(skb)->hwtstamp);
+
 		tcp_ack_tstamp(sk, skb, ack_skb, prior_snd_una);
 
 		next = skb_rb_next(skb);
@@ -3942,6 +3949,21 @@ static u32 tcp_newly_delivered(struct sock *sk, u32 prior_delivered, int flag)
 	return delivered;
 }
 
+/* The NIC receive time of the ACK is not known if the driver has to be
+ * asked for it, see netdev_get_tstamp().
+ */
+static void tcp_ack_hints_init(struct tcp_sock *tp, const struct sk_buff *skb)
+{
+	struct tcp_ack_hints *hints = &tp->ack_hints;
+
+	if (skb_shinfo(skb)->tx_flags & SKBTX_HW_TSTAMP_NETDEV)
+		hints->rx_hwtstamp = 0;
+	else
+		hints->rx_hwtstamp = ktime_to_ns(skb_hwtstamps(skb)->hwtstamp);
+	hints->tx_hwtstamp = 0;
+	hints->prior_delivered_ce = tp->delivered_ce;
+}
+
 /* This routine deals with incoming acks, but not outgoing ones. */
 static int tcp_ack(struct sock *sk, const struct sk_buff *skb, int flag)
 {
@@ -4004,6 +4026,9 @@ static int tcp_ack(struct sock *sk, const struct sk_buff *skb, int flag)
 	prior_fack = tcp_is_sack(tp) ? tcp_highest_sack_seq(tp) : tp->snd_una;
 	rs.prior_in_flight = tcp_packets_in_flight(tp);
 
+	if (unlikely(tcp_ca_wants_ack_hints(sk)))
+		tcp_ack_hints_init(tp, skb);
+
 	/* ts_recent update must be made after we are sure that the packet
 	 * is in window.
 	 */
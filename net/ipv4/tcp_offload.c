@@ -309,6 +309,70 @@ struct tcphdr *tcp_gro_pull_header(struct sk_buff *skb)
 	return th;
 }
 
+/* A pure ACK carrying only the cumulative ACK, the window and optionally the
+ * aligned timestamp option, i.e. nothing a later ACK of the flow does not
+ * supersede.
+ */
+static bool tcp_gro_ack_mergeable(const struct sk_buff *skb,
+				  const struct tcphdr *th)
+{
+	const __be32 flags = TCP_RESERVED_BITS | TCP_FLAG_AE | TCP_FLAG_CWR |
+			     TCP_FLAG_ECE | TCP_FLAG_URG | TCP_FLAG_ACK |
+			     TCP_FLAG_PSH | TCP_FLAG_RST | TCP_FLAG_SYN |
+			     TCP_FLAG_FIN;
+	unsigned int thlen = th->doff * 4;
+
+	if (!READ_ONCE(dev_net(skb->dev)->ipv4.sysctl_tcp_gro_merge_acks))
+		return false;
+	if (skb_gro_len(skb) || skb_is_gso(skb) || NAPI_GRO_CB(skb)->encap_mark)
+		return false;
+	if ((tcp_flag_word(th) & flags) != TCP_FLAG_ACK)
+		return false;
+	if (thlen == sizeof(*th))
+		return true;
+
+	return thlen == sizeof(*th) + TCPOLEN_TSTAMP_ALIGNED &&
+	       *(__be32 *)(th + 1) == htonl((TCPOPT_NOP << 24) |
+					    (TCPOPT_NOP << 16) |
+					    (TCPOPT_TIMESTAMP << 8) |
+					    TCPOLEN_TIMESTAMP);
+}
+
+/* Let the held pure ACK @p take over the network and TCP headers of @skb, a
+ * later pure ACK of the same flow that advances the cumulative ACK.  The
+ * socket then processes a single stretch ACK, and tcp_rate still counts
+ * everything it acknowledges as delivered through the snd_una advance.
+ * SACK blocks, duplicate ACKs and ECN feedback are never merged.
+ */
+static bool tcp_gro_merge_ack(struct sk_buff *p, struct sk_buff *skb,
+			      struct tcphdr *th, struct tcphdr *th2)
+{
+	unsigned int off = skb_transport_offset(p) - NAPI_GRO_CB(p)->network_offset;
+	unsigned int hlen = off + th->doff * 4;
+	void *nh = (void *)th - off;
+	void *nh2 = (void *)th2 - off;
+
+	if (NAPI_GRO_CB(skb)->flush || NAPI_GRO_CB(p)->count != 1 ||
+	    skb_gro_len(p) || skb_cloned(p) ||
+	    !tcp_gro_ack_mergeable(skb, th) || !tcp_gro_ack_mergeable(p, th2))
+		return false;
+	if (th->doff != th2->doff || th->seq != th2->seq ||
+	    !after(ntohl(th->ack_seq), ntohl(th2->ack_seq)))
+		return false;
+	if (gro_receive_network_flush(th, th2, p) || skb_cmp_decrypted(p, skb))
+		return false;
+
+	/* Both headers carry valid checksums, only a full one must follow */
+	if (p->ip_summed == CHECKSUM_COMPLETE)
+		p->csum = csum_add(csum_sub(p->csum, csum_partial(nh2, hlen, 0)),
+				   csum_partial(nh, hlen, 0));
+	memcpy(nh2, nh, hlen);
+
+	NAPI_GRO_CB(skb)->free = NAPI_GRO_FREE;
+	NAPI_GRO_CB(skb)->same_flow = 1;
+	return true;
+}
+
 struct sk_buff *tcp_gro_receive(struct list_head *head, struct sk_buff *skb,
 				struct tcphdr *th)
 {
@@ -330,6 +394,9 @@ struct sk_buff *tcp_gro_receive(struct list_head *head, struct sk_buff *skb,
 		goto out_check_final;
 
 	th2 = tcp_hdr(p);
+	if (!len && tcp_gro_merge_ack(p, skb, th, th2))
+		return NULL;
+
 	flush = (__force int)(flags & TCP_FLAG_CWR);
 	flush |= (__force int)((flags ^ tcp_flag_word(th2)) &
 		  ~(TCP_FLAG_FIN | TCP_FLAG_PSH));
@@ -379,7 +446,7 @@ struct sk_buff *tcp_gro_receive(struct list_head *head, struct sk_buff *skb,
 	if (unlikely(skb_is_gso(skb)))
 		flush = len != NAPI_GRO_CB(skb)->count * skb_shinfo(skb)->gso_size;
 	else
-		flush = len < mss;
+		flush = len < mss && !tcp_gro_ack_mergeable(skb, th);
 
 	flush |= (__force int)(flags & (TCP_FLAG_URG | TCP_FLAG_PSH |
 					TCP_FLAG_RST | TCP_FLAG_SYN |
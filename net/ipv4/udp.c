@@ -1446,7 +1446,10 @@ int udp_sendmsg(struct sock *sk, struct msghdr *msg, size_t len)
 				   dport, inet->inet_sport, sk->sk_uid);
 
 		security_sk_classify_flow(sk, flowi4_to_flowi_common(fl4));
-		rt = ip_route_output_flow(net, fl4, sk);
+		if (connected)
+			rt = ip_route_output_flow(net, fl4, sk);
+		else
+			rt = ip_route_output_flow_cached(net, fl4, sk);
 		if (IS_ERR(rt)) {
 			err = PTR_ERR(rt);
 			rt = NULL;
@@ -1991,6 +1994,70 @@ struct sk_buff *__skb_recv_udp(struct sock *sk, unsigned int flags,
 }
 EXPORT_SYMBOL(__skb_recv_udp);
 
+/* Max datagrams moved to a recvmmsg() batch per reader_queue lock */
+#define UDP_RX_BATCH	16
+
+static void udp_rx_batch_release(struct sock *sk, struct sk_buff_head *skbs)
+{
+	struct sk_buff_head *queue = &udp_sk(sk)->reader_queue;
+
+	spin_lock_bh(&queue->lock);
+	skb_queue_splice_init(skbs, queue);
+	spin_unlock_bh(&queue->lock);
+
+	/* They were hidden from poll() and other readers while batched */
+	sk->sk_data_ready(sk);
+}
+
+static void udp_rx_batch_fill(struct sock *sk, struct msg_rx_batch *batch)
+{
+	struct sk_buff_head *queue = &udp_sk(sk)->reader_queue;
+	unsigned int nr = min_t(unsigned int, batch->want - 1, UDP_RX_BATCH);
+	struct sk_buff *skb;
+
+	if (skb_queue_empty_lockless(queue))
+		return;
+
+	spin_lock_bh(&queue->lock);
+	while (nr-- && (skb = __skb_dequeue(queue)))
+		__skb_queue_tail(&batch->skbs, skb);
+	spin_unlock_bh(&queue->lock);
+
+	batch->sk = sk;
+	batch->release = udp_rx_batch_release;
+}
+
+/* Like __skb_recv_udp(), but within a recvmmsg() call the datagrams queued
+ * behind the first one are moved to the caller's batch under one lock, and
+ * the following messages are served from there without locking.  Their
+ * memory is released only when they are handed out.
+ */
+struct sk_buff *udp_recv_datagram(struct sock *sk, struct msghdr *msg,
+				  unsigned int flags, int *off, int *err)
+{
+	struct msg_rx_batch *batch = msg->msg_rx_batch;
+	struct sk_buff *skb;
+
+	if (!batch || (flags & MSG_PEEK))
+		return __skb_recv_udp(sk, flags, off, err);
+
+	if (batch->sk == sk) {
+		skb = __skb_dequeue(&batch->skbs);
+		if (skb) {
+			local_bh_disable();
+			udp_skb_destructor(sk, skb);
+			local_bh_enable();
+			return skb;
+		}
+	}
+
+	skb = __skb_recv_udp(sk, flags, off, err);
+	if (skb && batch->want > 1)
+		udp_rx_batch_fill(sk, batch);
+	return skb;
+}
+EXPORT_IPV6_MOD(udp_recv_datagram);
+
 int udp_read_skb(struct sock *sk, skb_read_actor_t recv_actor)
 {
 	struct sk_buff *skb;
@@ -2038,7 +2105,7 @@ int udp_recvmsg(struct sock *sk, struct msghdr *msg, size_t len, int flags,
 
 try_again:
 	off = sk_peek_offset(sk, flags);
-	skb = __skb_recv_udp(sk, flags, &off, &err);
+	skb = udp_recv_datagram(sk, msg, flags, &off, &err);
 	if (!skb)
 		return err;
 
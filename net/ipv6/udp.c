@@ -483,7 +483,7 @@ int udpv6_recvmsg(struct sock *sk, struct msghdr *msg, size_t len,
 
 try_again:
 	off = sk_peek_offset(sk, flags);
-	skb = __skb_recv_udp(sk, flags, &off, &err);
+	skb = udp_recv_datagram(sk, msg, flags, &off, &err);
 	if (!skb)
 		return err;
 
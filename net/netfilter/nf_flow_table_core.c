@@ -3,6 +3,7 @@
 #include <linux/init.h>
 #include <linux/module.h>
 #include <linux/netfilter.h>
+#include <linux/hash.h>
 #include <linux/rhashtable.h>
 #include <linux/netdevice.h>
 #include <net/ip.h>
@@ -316,6 +317,51 @@ unsigned long flow_offload_get_timeout(struct flow_offload *flow)
 	return timeout;
 }
 
+/* Per-CPU front cache of the last flows looked up, indexed by a cheap hash of
+ * the tuple, to save the rhashtable walk for the few flows that carry most of
+ * the traffic. Entries are only valid for the generation they were added in,
+ * which is bumped whenever a flow is unlinked, before it is freed after a
+ * grace period: a stale entry is never used by a reader that could observe
+ * the flow being freed.
+ */
+#define FLOW_OFFLOAD_CACHE_BITS	6
+
+struct flow_offload_cache_entry {
+	const struct nf_flowtable *flow_table;
+	struct flow_offload_tuple_rhash *tuplehash;
+	unsigned long gen;
+};
+
+struct flow_offload_cache {
+	struct flow_offload_cache_entry entry[1 << FLOW_OFFLOAD_CACHE_BITS];
+};
+
+static DEFINE_PER_CPU(struct flow_offload_cache, flow_offload_cache);
+static atomic_long_t flow_offload_cache_gen;
+
+static void flow_offload_cache_invalidate(void)
+{
+	/* Order the rhashtable removal before the new generation, pairs with
+	 * the acquire in flow_offload_lookup(): a reader that sees the new
+	 * generation can't find the removed flow and cache it under that
+	 * generation.
+	 */
+	smp_mb__before_atomic();
+	atomic_long_inc(&flow_offload_cache_gen);
+}
+
+static struct flow_offload_cache_entry *
+flow_offload_cache_slot(const struct flow_offload_tuple *tuple)
+{
+	u32 key = (__force u32)tuple->src_v4.s_addr ^
+		  (__force u32)tuple->dst_v4.s_addr ^
+		  (__force u32)tuple->src_port ^
+		  ((__force u32)tuple->dst_port << 16) ^ tuple->iifidx;
+
+	return this_cpu_ptr(&flow_offload_cache)->entry +
+	       hash_32(key, FLOW_OFFLOAD_CACHE_BITS);
+}
+
 int flow_offload_add(struct nf_flowtable *flow_table, struct flow_offload *flow)
 {
 	int err;
@@ -335,6 +381,7 @@ int flow_offload_add(struct nf_flowtable *flow_table, struct flow_offload *flow)
 		rhashtable_remove_fast(&flow_table->rhashtable,
 				       &flow->tuplehash[0].node,
 				       nf_flow_offload_rhash_params);
+		flow_offload_cache_invalidate();
 		return err;
 	}
 
@@ -377,6 +424,7 @@ static void flow_offload_del(struct nf_flowtable *flow_table,
 	rhashtable_remove_fast(&flow_table->rhashtable,
 			       &flow->tuplehash[FLOW_OFFLOAD_DIR_REPLY].node,
 			       nf_flow_offload_rhash_params);
+	flow_offload_cache_invalidate();
 	flow_offload_free(flow);
 }
 
@@ -392,15 +440,38 @@ struct flow_offload_tuple_rhash *
 flow_offload_lookup(struct nf_flowtable *flow_table,
 		    struct flow_offload_tuple *tuple)
 {
+	struct flow_offload_cache_entry *slot = NULL;
 	struct flow_offload_tuple_rhash *tuplehash;
 	struct flow_offload *flow;
+	unsigned long gen = 0;
 	int dir;
 
+	/* The cache is only usable where this CPU can't be preempted */
+	if (in_softirq()) {
+		slot = flow_offload_cache_slot(tuple);
+		/* Pairs with flow_offload_cache_invalidate(), the rhashtable
+		 * walk below must not see the table as it was before the
+		 * removal that bumped the generation.
+		 */
+		gen = atomic_long_read_acquire(&flow_offload_cache_gen);
+		tuplehash = slot->tuplehash;
+		if (slot->flow_table == flow_table && slot->gen == gen &&
+		    !memcmp(&tuplehash->tuple, tuple,
+			    offsetof(struct flow_offload_tuple, __hash)))
+			goto found;
+	}
+
 	tuplehash = rhashtable_lookup(&flow_table->rhashtable, tuple,
 				      nf_flow_offload_rhash_params);
 	if (!tuplehash)
 		return NULL;
 
+	if (slot) {
+		slot->flow_table = flow_table;
+		slot->tuplehash = tuplehash;
+		slot->gen = gen;
+	}
+found:
 	dir = tuplehash->tuple.dir;
 	flow = container_of(tuplehash, struct flow_offload, tuplehash[dir]);
 	if (test_bit(NF_FLOW_TEARDOWN, &flow->flags))
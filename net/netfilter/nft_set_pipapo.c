@@ -1232,8 +1232,25 @@ static void pipapo_free_scratch(const struct nft_pipapo_match *m, unsigned int c
 static int pipapo_realloc_scratch(struct nft_pipapo_match *clone,
 				  unsigned long bsize_max)
 {
+	struct nft_pipapo_scratch * __percpu *shared = NULL;
 	int i;
 
+	/* The maps are still in use by lookups on the current matching data,
+	 * don't replace them under their feet, get a new set instead.
+	 */
+	if (clone->scratch_shared) {
+		shared = clone->scratch;
+		clone->scratch = alloc_percpu(*clone->scratch);
+		if (!clone->scratch) {
+			clone->scratch = shared;
+			return -ENOMEM;
+		}
+
+		for_each_possible_cpu(i)
+			*per_cpu_ptr(clone->scratch, i) = NULL;
+		clone->scratch_shared = false;
+	}
+
 	for_each_possible_cpu(i) {
 		struct nft_pipapo_scratch *scratch;
 #ifdef NFT_PIPAPO_ALIGN
@@ -1251,7 +1268,17 @@ static int pipapo_realloc_scratch(struct nft_pipapo_match *clone,
 			 * insertion), but the extra space won't be used by any
 			 * CPU as new elements are not inserted and m->bsize_max
 			 * is not updated.
+			 *
+			 * A new set of maps is partially filled though, go
+			 * back to the shared one.
 			 */
+			if (shared) {
+				for_each_possible_cpu(i)
+					pipapo_free_scratch(clone, i);
+				free_percpu(clone->scratch);
+				clone->scratch = shared;
+				clone->scratch_shared = true;
+			}
 			return -ENOMEM;
 		}
 
@@ -1465,15 +1492,12 @@ static struct nft_pipapo_match *pipapo_clone(struct nft_pipapo_match *old)
 	new->field_count = old->field_count;
 	new->bsize_max = old->bsize_max;
 
-	new->scratch = alloc_percpu(*new->scratch);
-	if (!new->scratch)
-		goto out_scratch;
-
-	for_each_possible_cpu(i)
-		*per_cpu_ptr(new->scratch, i) = NULL;
-
-	if (pipapo_realloc_scratch(new, old->bsize_max))
-		goto out_scratch_realloc;
+	/* Lookups run with BHs disabled, so a CPU never uses the maps for the
+	 * old and the new matching data at the same time: share them until
+	 * an insertion needs bigger ones, see pipapo_realloc_scratch().
+	 */
+	new->scratch = old->scratch;
+	new->scratch_shared = true;
 
 	rcu_head_init(&new->rcu);
 
@@ -1490,7 +1514,8 @@ static struct nft_pipapo_match *pipapo_clone(struct nft_pipapo_match *old)
 		if (lt_size < 0)
 			goto out_lt;
 
-		new_lt = kvzalloc(lt_size, GFP_KERNEL_ACCOUNT);
+		/* The whole aligned area is copied over, no need to zero it */
+		new_lt = kvmalloc(lt_size, GFP_KERNEL_ACCOUNT);
 		if (!new_lt)
 			goto out_lt;
 
@@ -1531,11 +1556,6 @@ static struct nft_pipapo_match *pipapo_clone(struct nft_pipapo_match *old)
 		kvfree(dst->lt);
 		dst--;
 	}
-out_scratch_realloc:
-	for_each_possible_cpu(i)
-		pipapo_free_scratch(new, i);
-out_scratch:
-	free_percpu(new->scratch);
 	kfree(new);
 
 	return NULL;
@@ -1812,10 +1832,12 @@ static void pipapo_free_match(struct nft_pipapo_match *m)
 {
 	int i;
 
-	for_each_possible_cpu(i)
-		pipapo_free_scratch(m, i);
+	if (!m->scratch_shared) {
+		for_each_possible_cpu(i)
+			pipapo_free_scratch(m, i);
 
-	free_percpu(m->scratch);
+		free_percpu(m->scratch);
+	}
 	pipapo_free_fields(m);
 
 	kfree(m);
@@ -1857,6 +1879,12 @@ static void nft_pipapo_commit(struct nft_set *set)
 
 	old = rcu_replace_pointer(priv->match, priv->clone,
 				  nft_pipapo_transaction_mutex_held(set));
+
+	/* The new matching data now owns the scratch maps, if shared */
+	if (old && priv->clone->scratch_shared) {
+		old->scratch_shared = true;
+		priv->clone->scratch_shared = false;
+	}
 	priv->clone = NULL;
 
 	if (old)
@@ -2287,6 +2315,7 @@ static int nft_pipapo_init(const struct nft_set *set,
 		return -ENOMEM;
 
 	m->field_count = field_count;
+	m->scratch_shared = false;
 	m->bsize_max = 0;
 
 	m->scratch = alloc_percpu(struct nft_pipapo_scratch *);
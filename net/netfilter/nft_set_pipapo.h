@@ -139,11 +139,13 @@ struct nft_pipapo_scratch {
  * @field_count:	Amount of fields in set
  * @bsize_max:		Maximum lookup table bucket size of all fields, in longs
  * @scratch:		Preallocated per-CPU maps for partial matching results
+ * @scratch_shared:	@scratch belongs to the matching data this was cloned from
  * @rcu:		Matching data is swapped on commits
  * @f:			Fields, with lookup and mapping tables
  */
 struct nft_pipapo_match {
 	u8 field_count;
+	bool scratch_shared;
 	unsigned int bsize_max;
 	struct nft_pipapo_scratch * __percpu *scratch;
 	struct rcu_head rcu;
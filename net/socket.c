@@ -2482,6 +2482,7 @@ int __copy_msghdr(struct msghdr *kmsg,
 
 	kmsg->msg_iocb = NULL;
 	kmsg->msg_ubuf = NULL;
+	kmsg->msg_rx_batch = NULL;
 	return 0;
 }
 
@@ -2814,7 +2815,8 @@ static int ____sys_recvmsg(struct socket *sock, struct msghdr *msg_sys,
 }
 
 static int ___sys_recvmsg(struct socket *sock, struct user_msghdr __user *msg,
-			 struct msghdr *msg_sys, unsigned int flags, int nosec)
+			 struct msghdr *msg_sys, unsigned int flags, int nosec,
+			 struct msg_rx_batch *batch)
 {
 	struct iovec iovstack[UIO_FASTIOV], *iov = iovstack;
 	/* user mode address pointers */
@@ -2824,6 +2826,7 @@ static int ___sys_recvmsg(struct socket *sock, struct user_msghdr __user *msg,
 	err = recvmsg_copy_msghdr(msg_sys, msg, flags, &uaddr, &iov);
 	if (err < 0)
 		return err;
+	msg_sys->msg_rx_batch = batch;
 
 	err = ____sys_recvmsg(sock, msg_sys, msg, uaddr, flags, nosec);
 	kfree(iov);
@@ -2858,7 +2861,7 @@ long __sys_recvmsg(int fd, struct user_msghdr __user *msg, unsigned int flags,
 	if (unlikely(!sock))
 		return -ENOTSOCK;
 
-	return ___sys_recvmsg(sock, msg, &msg_sys, flags, 0);
+	return ___sys_recvmsg(sock, msg, &msg_sys, flags, 0, NULL);
 }
 
 SYSCALL_DEFINE3(recvmsg, int, fd, struct user_msghdr __user *, msg,
@@ -2880,6 +2883,7 @@ static int do_recvmmsg(int fd, struct mmsghdr __user *mmsg,
 	struct mmsghdr __user *entry;
 	struct compat_mmsghdr __user *compat_entry;
 	struct msghdr msg_sys;
+	struct msg_rx_batch batch;
 	struct timespec64 end_time;
 	struct timespec64 timeout64;
 
@@ -2906,15 +2910,22 @@ static int do_recvmmsg(int fd, struct mmsghdr __user *mmsg,
 
 	entry = mmsg;
 	compat_entry = (struct compat_mmsghdr __user *)mmsg;
+	__skb_queue_head_init(&batch.skbs);
+	batch.sk = NULL;
 
 	while (datagrams < vlen) {
+		/*
+		 * Only read ahead what the loop will consume; with a timeout
+		 * it may stop before vlen.
+		 */
+		batch.want = timeout ? 1 : vlen - datagrams;
 		/*
 		 * No need to ask LSM for more than the first datagram.
 		 */
 		if (MSG_CMSG_COMPAT & flags) {
 			err = ___sys_recvmsg(sock, (struct user_msghdr __user *)compat_entry,
 					     &msg_sys, flags & ~MSG_WAITFORONE,
-					     datagrams);
+					     datagrams, &batch);
 			if (err < 0)
 				break;
 			err = __put_user(err, &compat_entry->msg_len);
@@ -2923,7 +2934,7 @@ static int do_recvmmsg(int fd, struct mmsghdr __user *mmsg,
 			err = ___sys_recvmsg(sock,
 					     (struct user_msghdr __user *)entry,
 					     &msg_sys, flags & ~MSG_WAITFORONE,
-					     datagrams);
+					     datagrams, &batch);
 			if (err < 0)
 				break;
 			err = put_user(err, &entry->msg_len);
@@ -2956,6 +2967,7 @@ static int do_recvmmsg(int fd, struct mmsghdr __user *mmsg,
 			break;
 		cond_resched();
 	}
+	msg_rx_batch_release(&batch);
 
 	if (err == 0)
 		return datagrams;
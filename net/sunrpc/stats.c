@@ -249,6 +249,9 @@ static int do_print_stats(struct rpc_clnt *clnt, struct rpc_xprt *xprt, void *se
 	struct seq_file *seq = seqv;
 
 	xprt->ops->print_stats(xprt, seq);
+	seq_printf(seq, "\txprt_latency:\t%lu %llu %ld\n",
+		   xprt->stat.recvs, xprt->stat.rtt_u,
+		   atomic_long_read(&xprt->queuelen));
 	return 0;
 }
 
@@ -313,6 +313,36 @@ static ssize_t rpc_sysfs_xprt_switch_info_show(struct kobject *kobj,
 	return ret;
 }
 
+static ssize_t rpc_sysfs_xprt_switch_policy_show(struct kobject *kobj,
+						 struct kobj_attribute *attr,
+						 char *buf)
+{
+	struct rpc_xprt_switch *xprt_switch =
+		rpc_sysfs_xprt_switch_kobj_get_xprt(kobj);
+	ssize_t ret;
+
+	if (!xprt_switch)
+		return 0;
+	ret = sprintf(buf, "%s\n", rpc_xprt_switch_policy(xprt_switch));
+	xprt_switch_put(xprt_switch);
+	return ret;
+}
+
+static ssize_t rpc_sysfs_xprt_switch_policy_store(struct kobject *kobj,
+						  struct kobj_attribute *attr,
+						  const char *buf, size_t count)
+{
+	struct rpc_xprt_switch *xprt_switch =
+		rpc_sysfs_xprt_switch_kobj_get_xprt(kobj);
+	int ret;
+
+	if (!xprt_switch)
+		return 0;
+	ret = rpc_xprt_switch_set_policy(xprt_switch, buf);
+	xprt_switch_put(xprt_switch);
+	return ret ? ret : count;
+}
+
 static ssize_t rpc_sysfs_xprt_switch_add_xprt_show(struct kobject *kobj,
 						   struct kobj_attribute *attr,
 						   char *buf)
@@ -622,9 +652,14 @@ static struct kobj_attribute rpc_sysfs_xprt_switch_add_xprt =
 	__ATTR(add_xprt, 0644, rpc_sysfs_xprt_switch_add_xprt_show,
 		rpc_sysfs_xprt_switch_add_xprt_store);
 
+static struct kobj_attribute rpc_sysfs_xprt_switch_policy =
+	__ATTR(xprt_switch_policy, 0644, rpc_sysfs_xprt_switch_policy_show,
+		rpc_sysfs_xprt_switch_policy_store);
+
 static struct attribute *rpc_sysfs_xprt_switch_attrs[] = {
 	&rpc_sysfs_xprt_switch_info.attr,
 	&rpc_sysfs_xprt_switch_add_xprt.attr,
+	&rpc_sysfs_xprt_switch_policy.attr,
 	NULL,
 };
 ATTRIBUTE_GROUPS(rpc_sysfs_xprt_switch);
@@ -1220,6 +1220,7 @@ void xprt_complete_rqst(struct rpc_task *task, int copied)
 	struct rpc_xprt *xprt = req->rq_xprt;
 
 	xprt->stat.recvs++;
+	xprt->stat.rtt_u += ktime_to_us(req->rq_rtt);
 
 	xdr_free_bvec(&req->rq_rcv_buf);
 	req->rq_private_buf.bvec = NULL;
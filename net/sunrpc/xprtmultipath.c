@@ -26,6 +26,7 @@ typedef struct rpc_xprt *(*xprt_switch_find_xprt_t)(struct rpc_xprt_switch *xps,
 
 static const struct rpc_xprt_iter_ops rpc_xprt_iter_singular;
 static const struct rpc_xprt_iter_ops rpc_xprt_iter_roundrobin;
+static const struct rpc_xprt_iter_ops rpc_xprt_iter_leastqueued;
 static const struct rpc_xprt_iter_ops rpc_xprt_iter_listall;
 static const struct rpc_xprt_iter_ops rpc_xprt_iter_listoffline;
 
@@ -225,14 +226,61 @@ void xprt_switch_put(struct rpc_xprt_switch *xps)
  * rpc_xprt_switch_set_roundrobin - Set a round-robin policy on rpc_xprt_switch
  * @xps: pointer to struct rpc_xprt_switch
  *
- * Sets a round-robin default policy for iterators acting on xps.
+ * Sets a round-robin default policy for iterators acting on xps, unless
+ * a multipath policy has already been chosen.
  */
 void rpc_xprt_switch_set_roundrobin(struct rpc_xprt_switch *xps)
 {
-	if (READ_ONCE(xps->xps_iter_ops) != &rpc_xprt_iter_roundrobin)
+	if (READ_ONCE(xps->xps_iter_ops) == &rpc_xprt_iter_singular)
 		WRITE_ONCE(xps->xps_iter_ops, &rpc_xprt_iter_roundrobin);
 }
 
+static const struct {
+	const char *name;
+	const struct rpc_xprt_iter_ops *ops;
+} rpc_xprt_switch_policies[] = {
+	{ "singular",	&rpc_xprt_iter_singular },
+	{ "roundrobin",	&rpc_xprt_iter_roundrobin },
+	{ "leastqueued", &rpc_xprt_iter_leastqueued },
+};
+
+/**
+ * rpc_xprt_switch_set_policy - Set the default policy of rpc_xprt_switch
+ * @xps: pointer to struct rpc_xprt_switch
+ * @name: "roundrobin" or "leastqueued"
+ *
+ * Returns zero on success, or -EINVAL if @name isn't a multipath policy.
+ */
+int rpc_xprt_switch_set_policy(struct rpc_xprt_switch *xps, const char *name)
+{
+	int i;
+
+	/* Skip "singular", it is only the policy until a second xprt is added */
+	for (i = 1; i < ARRAY_SIZE(rpc_xprt_switch_policies); i++) {
+		if (sysfs_streq(name, rpc_xprt_switch_policies[i].name)) {
+			WRITE_ONCE(xps->xps_iter_ops,
+				   rpc_xprt_switch_policies[i].ops);
+			return 0;
+		}
+	}
+	return -EINVAL;
+}
+
+/**
+ * rpc_xprt_switch_policy - Return the name of the policy of rpc_xprt_switch
+ * @xps: pointer to struct rpc_xprt_switch
+ */
+const char *rpc_xprt_switch_policy(struct rpc_xprt_switch *xps)
+{
+	const struct rpc_xprt_iter_ops *ops = READ_ONCE(xps->xps_iter_ops);
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(rpc_xprt_switch_policies); i++)
+		if (rpc_xprt_switch_policies[i].ops == ops)
+			return rpc_xprt_switch_policies[i].name;
+	return "unknown";
+}
+
 static
 const struct rpc_xprt_iter_ops *xprt_iter_ops(const struct rpc_xprt_iter *xpi)
 {
@@ -480,6 +528,39 @@ struct rpc_xprt *xprt_iter_next_entry_roundrobin(struct rpc_xprt_iter *xpi)
 			xprt_switch_find_next_entry_roundrobin);
 }
 
+static
+struct rpc_xprt *xprt_switch_find_next_entry_leastqueued(struct rpc_xprt_switch *xps,
+		const struct rpc_xprt *cur)
+{
+	struct list_head *head = &xps->xps_xprt_list;
+	unsigned int i, nxprts = READ_ONCE(xps->xps_nxprts);
+	struct rpc_xprt *xprt, *best = NULL;
+	long queuelen, best_queuelen = LONG_MAX;
+
+	/* Start after the cursor, so that ties are broken round-robin */
+	for (i = 0; i < nxprts; i++) {
+		xprt = __xprt_switch_find_next_entry_roundrobin(head, cur);
+		if (!xprt)
+			break;
+		queuelen = atomic_long_read(&xprt->queuelen);
+		if (queuelen < best_queuelen) {
+			best = xprt;
+			best_queuelen = queuelen;
+			if (!queuelen)
+				break;
+		}
+		cur = xprt;
+	}
+	return best;
+}
+
+static
+struct rpc_xprt *xprt_iter_next_entry_leastqueued(struct rpc_xprt_iter *xpi)
+{
+	return xprt_iter_next_entry_multiple(xpi,
+			xprt_switch_find_next_entry_leastqueued);
+}
+
 static
 struct rpc_xprt *xprt_switch_find_next_entry_all(struct rpc_xprt_switch *xps,
 		const struct rpc_xprt *cur)
@@ -656,6 +737,14 @@ const struct rpc_xprt_iter_ops rpc_xprt_iter_roundrobin = {
 	.xpi_next = xprt_iter_next_entry_roundrobin,
 };
 
+/* Policy for picking the entry with the fewest queued requests */
+static
+const struct rpc_xprt_iter_ops rpc_xprt_iter_leastqueued = {
+	.xpi_rewind = xprt_iter_default_rewind,
+	.xpi_xprt = xprt_iter_current_entry,
+	.xpi_next = xprt_iter_next_entry_leastqueued,
+};
+
 /* Policy for once-through iteration of entries in the rpc_xprt_switch */
 static
 const struct rpc_xprt_iter_ops rpc_xprt_iter_listall = {
@@ -634,6 +634,8 @@ static void unix_sock_destructor(struct sock *sk)
 	struct unix_sock *u = unix_sk(sk);
 
 	skb_queue_purge_reason(&sk->sk_receive_queue, SKB_DROP_REASON_SOCKET_CLOSE);
+	/* MSG_ZEROCOPY completion notifications nobody read */
+	skb_queue_purge(&sk->sk_error_queue);
 
 	DEBUG_NET_WARN_ON_ONCE(refcount_read(&sk->sk_wmem_alloc));
 	DEBUG_NET_WARN_ON_ONCE(!sk_unhashed(sk));
@@ -2239,6 +2241,7 @@ static int queue_oob(struct socket *sock, struct msghdr *msg, struct sock *other
 static int unix_stream_sendmsg(struct socket *sock, struct msghdr *msg,
 			       size_t len)
 {
+	struct ubuf_info *uarg = NULL;
 	struct sock *sk = sock->sk;
 	struct sk_buff *skb = NULL;
 	struct sock *other = NULL;
@@ -2276,11 +2279,31 @@ static int unix_stream_sendmsg(struct socket *sock, struct msghdr *msg,
 	if (READ_ONCE(sk->sk_shutdown) & SEND_SHUTDOWN)
 		goto out_pipe;
 
+	/* The pages of the sender are pinned and handed to the receiver as
+	 * frags, so that the data is only copied once, by the receiver.
+	 */
+	if ((msg->msg_flags & MSG_ZEROCOPY) && len &&
+	    !(msg->msg_flags & MSG_SPLICE_PAGES) &&
+	    sock_flag(sk, SOCK_ZEROCOPY)) {
+		uarg = msg_zerocopy_realloc(sk, len, NULL);
+		if (!uarg) {
+			err = -ENOBUFS;
+			goto out_err;
+		}
+	}
+
 	while (sent < len) {
 		int size = len - sent;
 		int data_len;
 
 		if (unlikely(msg->msg_flags & MSG_SPLICE_PAGES)) {
+			skb = sock_alloc_send_pskb(sk, 0, 0,
+						   msg->msg_flags & MSG_DONTWAIT,
+						   &err, 0);
+		} else if (uarg) {
+			/* Pinned pages are charged to sk_wmem_alloc as well */
+			size = min_t(int, size, (READ_ONCE(sk->sk_sndbuf) >> 1) - 64);
+
 			skb = sock_alloc_send_pskb(sk, 0, 0,
 						   msg->msg_flags & MSG_DONTWAIT,
 						   &err, 0);
@@ -2318,6 +2341,15 @@ static int unix_stream_sendmsg(struct socket *sock, struct msghdr *msg,
 
 			size = err;
 			refcount_add(size, &sk->sk_wmem_alloc);
+		} else if (uarg) {
+			err = __zerocopy_sg_from_iter(msg, NULL, skb,
+						      &msg->msg_iter, size);
+			/* Out of frags: send what fits, the rest goes next */
+			if (err && (err != -EMSGSIZE || !skb->len))
+				goto out_free;
+
+			skb_zcopy_set(skb, uarg, NULL);
+			size = skb->len;
 		} else {
 			skb_put(skb, size - data_len);
 			skb->data_len = data_len;
@@ -2350,6 +2382,7 @@ static int unix_stream_sendmsg(struct socket *sock, struct msghdr *msg,
 	}
 #endif
 
+	net_zcopy_put(uarg);
 	scm_destroy(&scm);
 
 	return sent;
@@ -2363,6 +2396,10 @@ static int unix_stream_sendmsg(struct socket *sock, struct msghdr *msg,
 out_free:
 	consume_skb(skb);
 out_err:
+	if (sent)
+		net_zcopy_put(uarg);
+	else
+		net_zcopy_put_abort(uarg, true);
 	scm_destroy(&scm);
 	return sent ? : err;
 }
@@ -2747,6 +2784,11 @@ static int unix_stream_read_skb(struct sock *sk, skb_read_actor_t recv_actor)
 	}
 #endif
 
+	if (skb_orphan_frags_rx(skb, GFP_ATOMIC)) {
+		kfree_skb(skb);
+		return -ENOMEM;
+	}
+
 	return recv_actor(sk, skb);
 }
 
@@ -2994,6 +3036,11 @@ static int unix_stream_recvmsg(struct socket *sock, struct msghdr *msg,
 	if (prot != &unix_stream_proto)
 		return prot->recvmsg(sk, msg, size, flags, NULL);
 #endif
+	/* MSG_ZEROCOPY completions, reported as SOL_SOCKET/SO_ZEROCOPY */
+	if (unlikely(flags & MSG_ERRQUEUE))
+		return sock_recv_errqueue(sock->sk, msg, size, SOL_SOCKET,
+					  SO_ZEROCOPY);
+
 	return unix_stream_read_generic(&state, true);
 }
 
@@ -3001,6 +3048,10 @@ static int unix_stream_splice_actor(struct sk_buff *skb,
 				    int skip, int chunk,
 				    struct unix_stream_read_state *state)
 {
+	/* The pipe would keep the pages after the sender is notified */
+	if (skb_orphan_frags_rx(skb, GFP_KERNEL))
+		return -ENOMEM;
+
 	return skb_splice_bits(skb, state->socket->sk,
 			       UNIXCB(skb).consumed + skip,
 			       state->pipe, chunk, state->splice_flags);
@@ -3219,7 +3270,8 @@ static __poll_t unix_poll(struct file *file, struct socket *sock, poll_table *wa
 	state = READ_ONCE(sk->sk_state);
 
 	/* exceptional events? */
-	if (READ_ONCE(sk->sk_err))
+	if (READ_ONCE(sk->sk_err) ||
+	    !skb_queue_empty_lockless(&sk->sk_error_queue))
 		mask |= EPOLLERR;
 	if (shutdown == SHUTDOWN_MASK)
 		mask |= EPOLLHUP;
@@ -3669,6 +3721,11 @@ static int __net_init unix_net_init(struct net *net)
 	if (!proc_create_net("unix", 0, net->proc_net, &unix_seq_ops,
 			     sizeof(struct seq_net_private)))
 		goto err_sysctl;
+	/* The GC is not per netns, only show its statistics in init_net */
+	if (net_eq(net, &init_net) &&
+	    !proc_create_net_single("unix_gc", 0444, net->proc_net,
+				    unix_gc_seq_show, NULL))
+		goto err_proc_unix;
 #endif
 
 	net->unx.table.locks = kvmalloc_array(UNIX_HASH_SIZE,
@@ -3694,6 +3751,9 @@ static int __net_init unix_net_init(struct net *net)
 	kvfree(net->unx.table.locks);
 err_proc:
 #ifdef CONFIG_PROC_FS
+	if (net_eq(net, &init_net))
+		remove_proc_entry("unix_gc", net->proc_net);
+err_proc_unix:
 	remove_proc_entry("unix", net->proc_net);
 err_sysctl:
 #endif
@@ -3707,6 +3767,8 @@ static void __net_exit unix_net_exit(struct net *net)
 	kvfree(net->unx.table.buckets);
 	kvfree(net->unx.table.locks);
 	unix_sysctl_unregister(net);
+	if (net_eq(net, &init_net))
+		remove_proc_entry("unix_gc", net->proc_net);
 	remove_proc_entry("unix", net->proc_net);
 }
 
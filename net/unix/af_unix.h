@@ -32,6 +32,10 @@ int unix_prepare_fpl(struct scm_fp_list *fpl);
 void unix_destroy_fpl(struct scm_fp_list *fpl);
 void unix_gc(void);
 void wait_for_unix_gc(struct scm_fp_list *fpl);
+#ifdef CONFIG_PROC_FS
+struct seq_file;
+int unix_gc_seq_show(struct seq_file *seq, void *v);
+#endif
 
 /* SOCK_DIAG */
 long unix_inq_len(struct sock *sk);
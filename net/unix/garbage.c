@@ -65,6 +65,7 @@
 
 #include <linux/fs.h>
 #include <linux/list.h>
+#include <linux/seq_file.h>
 #include <linux/skbuff.h>
 #include <linux/socket.h>
 #include <linux/workqueue.h>
@@ -402,6 +403,24 @@ static bool unix_scc_cyclic(struct list_head *scc)
 static LIST_HEAD(unix_visited_vertices);
 static unsigned long unix_vertex_grouped_index = UNIX_VERTEX_INDEX_MARK2;
 
+/*
+ * Number of dead SCCs found and runs of unix_gc(), and the time spent in it,
+ * shown in /proc/net/unix_gc.
+ */
+static unsigned long gc_cycles_found;
+static unsigned long gc_runs;
+static unsigned long gc_time_us;
+
+#ifdef CONFIG_PROC_FS
+int unix_gc_seq_show(struct seq_file *seq, void *v)
+{
+	seq_printf(seq, "runs %lu\ntime_us %lu\ncycles_found %lu\n",
+		   READ_ONCE(gc_runs), READ_ONCE(gc_time_us),
+		   READ_ONCE(gc_cycles_found));
+	return 0;
+}
+#endif
+
 static void __unix_walk_scc(struct unix_vertex *vertex, unsigned long *last_index,
 			    struct sk_buff_head *hitlist)
 {
@@ -489,10 +508,12 @@ static void __unix_walk_scc(struct unix_vertex *vertex, unsigned long *last_inde
 				scc_dead = unix_vertex_dead(v);
 		}
 
-		if (scc_dead)
+		if (scc_dead) {
 			unix_collect_skb(&scc, hitlist);
-		else if (!unix_graph_maybe_cyclic)
+			WRITE_ONCE(gc_cycles_found, gc_cycles_found + 1);
+		} else if (!unix_graph_maybe_cyclic) {
 			unix_graph_maybe_cyclic = unix_scc_cyclic(&scc);
+		}
 
 		list_del(&scc);
 	}
@@ -524,15 +545,32 @@ static void unix_walk_scc(struct sk_buff_head *hitlist)
 	unix_graph_grouped = true;
 }
 
-static void unix_walk_scc_fast(struct sk_buff_head *hitlist)
+/* SCCs checked by one run of the work before it requeues itself. */
+#define UNIX_GC_SCC_BUDGET	1024
+
+/* unix_walk_scc_fast() ran out of budget and left vertices unvisited. */
+static bool unix_graph_partial;
+
+static bool unix_walk_scc_fast(struct sk_buff_head *hitlist)
 {
-	unix_graph_maybe_cyclic = false;
+	unsigned int budget = UNIX_GC_SCC_BUDGET;
+
+	if (!unix_graph_partial)
+		unix_graph_maybe_cyclic = false;
 
 	while (!list_empty(&unix_unvisited_vertices)) {
 		struct unix_vertex *vertex;
 		struct list_head scc;
 		bool scc_dead = true;
 
+		/* Each SCC is checked on its own, so the walk can be resumed
+		 * as long as no edge is added or removed in the meantime.
+		 */
+		if (!budget--) {
+			unix_graph_partial = true;
+			return false;
+		}
+
 		vertex = list_first_entry(&unix_unvisited_vertices, typeof(*vertex), entry);
 		list_add(&scc, &vertex->scc_entry);
 
@@ -543,27 +581,40 @@ static void unix_walk_scc_fast(struct sk_buff_head *hitlist)
 				scc_dead = unix_vertex_dead(vertex);
 		}
 
-		if (scc_dead)
+		if (scc_dead) {
 			unix_collect_skb(&scc, hitlist);
-		else if (!unix_graph_maybe_cyclic)
+			WRITE_ONCE(gc_cycles_found, gc_cycles_found + 1);
+		} else if (!unix_graph_maybe_cyclic) {
 			unix_graph_maybe_cyclic = unix_scc_cyclic(&scc);
+		}
 
 		list_del(&scc);
 	}
 
 	list_replace_init(&unix_visited_vertices, &unix_unvisited_vertices);
+	unix_graph_partial = false;
+
+	return true;
 }
 
 static bool gc_in_progress;
 
 static void __unix_gc(struct work_struct *work)
 {
+	u64 start = ktime_get_ns();
 	struct sk_buff_head hitlist;
 	struct sk_buff *skb;
+	bool done = true;
 
 	spin_lock(&unix_gc_lock);
 
-	if (!unix_graph_maybe_cyclic) {
+	if (unix_graph_partial && !unix_graph_grouped) {
+		/* The graph changed since the last run, start over. */
+		list_splice_init(&unix_visited_vertices, &unix_unvisited_vertices);
+		unix_graph_partial = false;
+	}
+
+	if (!unix_graph_maybe_cyclic && !unix_graph_partial) {
 		spin_unlock(&unix_gc_lock);
 		goto skip_gc;
 	}
@@ -571,7 +622,7 @@ static void __unix_gc(struct work_struct *work)
 	__skb_queue_head_init(&hitlist);
 
 	if (unix_graph_grouped)
-		unix_walk_scc_fast(&hitlist);
+		done = unix_walk_scc_fast(&hitlist);
 	else
 		unix_walk_scc(&hitlist);
 
@@ -582,8 +633,21 @@ static void __unix_gc(struct work_struct *work)
 			UNIXCB(skb).fp->dead = true;
 	}
 
-	__skb_queue_purge_reason(&hitlist, SKB_DROP_REASON_SOCKET_CLOSE);
+	while ((skb = __skb_dequeue(&hitlist))) {
+		kfree_skb_reason(skb, SKB_DROP_REASON_SOCKET_CLOSE);
+		cond_resched();
+	}
 skip_gc:
+	WRITE_ONCE(gc_runs, gc_runs + 1);
+	WRITE_ONCE(gc_time_us, gc_time_us +
+		   div_u64(ktime_get_ns() - start, NSEC_PER_USEC));
+
+	/* Let senders and other works in, then resume the walk. */
+	if (!done) {
+		queue_work(system_unbound_wq, work);
+		return;
+	}
+
 	WRITE_ONCE(gc_in_progress, false);
 }
 
@@ -601,7 +665,7 @@ void unix_gc(void)
 void wait_for_unix_gc(struct scm_fp_list *fpl)
 {
 	/* If number of inflight sockets is insane,
-	 * force a garbage collect right now.
+	 * kick a garbage collect right now.
 	 *
 	 * Paired with the WRITE_ONCE() in unix_inflight(),
 	 * unix_notinflight(), and __unix_gc().
@@ -610,13 +674,15 @@ void wait_for_unix_gc(struct scm_fp_list *fpl)
 	    !READ_ONCE(gc_in_progress))
 		unix_gc();
 
-	/* Penalise users who want to send AF_UNIX sockets
-	 * but whose sockets have not been received yet.
+	/* Users who want to send AF_UNIX sockets but whose sockets
+	 * have not been received yet do not wait for the GC anymore,
+	 * the number of their inflight fds is bounded by too_many_unix_fds()
+	 * already.  Just make sure that the GC runs.
 	 */
 	if (!fpl || !fpl->count_unix ||
 	    READ_ONCE(fpl->user->unix_inflight) < UNIX_INFLIGHT_SANE_USER)
 		return;
 
-	if (READ_ONCE(gc_in_progress))
-		flush_work(&unix_gc_work);
+	if (!READ_ONCE(gc_in_progress))
+		unix_gc();
 }
@@ -152,6 +152,7 @@ static int xdp_umem_account_pages(struct xdp_umem *umem)
 		XDP_UMEM_UNALIGNED_CHUNK_FLAG | \
 		XDP_UMEM_TX_SW_CSUM | \
 		XDP_UMEM_TX_METADATA_LEN | \
+		XDP_UMEM_TX_RECYCLE | \
 	0)
 
 static int xdp_umem_reg(struct xdp_umem *umem, struct xdp_umem_reg *mr)
@@ -179,6 +180,9 @@ static int xdp_umem_reg(struct xdp_umem *umem, struct xdp_umem_reg *mr)
 	if (!unaligned_chunks && !is_power_of_2(chunk_size))
 		return -EINVAL;
 
+	if (unaligned_chunks && (mr->flags & XDP_UMEM_TX_RECYCLE))
+		return -EINVAL;
+
 	if (!PAGE_ALIGNED(addr)) {
 		/* Memory area has to be page size aligned. For
 		 * simplicity, this might change.
@@ -363,7 +363,14 @@ static int xsk_rcv(struct xdp_sock *xs, struct xdp_buff *xdp)
 		return xsk_rcv_zc(xs, xdp, len);
 	}
 
-	err = __xsk_rcv(xs, xdp, len);
+	if (xs->pool->tx_recycle) {
+		/* xsk_cq_reserve_addr_locked() refills the free list */
+		spin_lock_bh(&xs->pool->rx_lock);
+		err = __xsk_rcv(xs, xdp, len);
+		spin_unlock_bh(&xs->pool->rx_lock);
+	} else {
+		err = __xsk_rcv(xs, xdp, len);
+	}
 	if (!err)
 		xdp_return_buff(xdp);
 	return err;
@@ -442,8 +449,13 @@ bool xsk_tx_peek_desc(struct xsk_buff_pool *pool, struct xdp_desc *desc)
 		 * if there is space in it. This avoids having to implement
 		 * any buffering in the Tx path.
 		 */
-		if (xskq_prod_reserve_addr(pool->cq, desc->addr))
-			goto out;
+		if (xskq_prod_reserve_addr(pool->cq, desc->addr)) {
+			if (!pool->tx_recycle)
+				goto out;
+			xp_recycle_completed(pool);
+			if (xskq_prod_reserve_addr(pool->cq, desc->addr))
+				goto out;
+		}
 
 		xskq_cons_release(xs->tx);
 		rcu_read_unlock();
@@ -501,6 +513,8 @@ u32 xsk_tx_peek_release_desc_batch(struct xsk_buff_pool *pool, u32 nb_pkts)
 	 * packets. This avoids having to implement any buffering in
 	 * the Tx path.
 	 */
+	if (pool->tx_recycle && xskq_prod_nb_free(pool->cq, nb_pkts) < nb_pkts)
+		xp_recycle_completed(pool);
 	nb_pkts = xskq_prod_nb_free(pool->cq, nb_pkts);
 	if (!nb_pkts)
 		goto out;
@@ -537,6 +551,17 @@ static int xsk_cq_reserve_addr_locked(struct xsk_buff_pool *pool, u64 addr)
 	ret = xskq_prod_reserve_addr(pool->cq, addr);
 	spin_unlock_irqrestore(&pool->cq_lock, flags);
 
+	if (ret && pool->tx_recycle) {
+		/* Copy mode Rx allocates under rx_lock with Tx recycling */
+		spin_lock_bh(&pool->rx_lock);
+		xp_recycle_completed(pool);
+		spin_unlock_bh(&pool->rx_lock);
+
+		spin_lock_irqsave(&pool->cq_lock, flags);
+		ret = xskq_prod_reserve_addr(pool->cq, addr);
+		spin_unlock_irqrestore(&pool->cq_lock, flags);
+	}
+
 	return ret;
 }
 
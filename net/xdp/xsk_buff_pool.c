@@ -89,6 +89,7 @@ struct xsk_buff_pool *xp_create_and_assign_umem(struct xdp_sock *xs,
 	pool->addrs = umem->addrs;
 	pool->tx_metadata_len = umem->tx_metadata_len;
 	pool->tx_sw_csum = umem->flags & XDP_UMEM_TX_SW_CSUM;
+	pool->tx_recycle = umem->flags & XDP_UMEM_TX_RECYCLE;
 	spin_lock_init(&pool->rx_lock);
 	INIT_LIST_HEAD(&pool->free_list);
 	INIT_LIST_HEAD(&pool->xskb_list);
@@ -522,6 +523,79 @@ static struct xdp_buff_xsk *xp_get_xskb(struct xsk_buff_pool *pool, u64 addr)
 	return xskb;
 }
 
+/* With XDP_UMEM_TX_RECYCLE, the kernel is both the producer and the consumer
+ * of the completion ring. The producer side keeps using the cached indexes
+ * of the queue, so the consumer side has its own in the pool.
+ */
+static u32 xp_recycle_nb_entries(struct xsk_buff_pool *pool, u32 max)
+{
+	u32 entries = pool->recycle_prod - pool->recycle_cons;
+
+	if (entries >= max)
+		return max;
+
+	pool->recycle_prod = smp_load_acquire(&pool->cq->ring->producer);
+	entries = pool->recycle_prod - pool->recycle_cons;
+
+	return min(entries, max);
+}
+
+static u32 xp_alloc_recycled(struct xsk_buff_pool *pool, struct xdp_buff **xdp,
+			     u32 max)
+{
+	u32 i, nb_entries;
+
+	nb_entries = xp_recycle_nb_entries(pool, max);
+	i = nb_entries;
+	while (i--) {
+		struct xdp_buff_xsk *xskb;
+		u64 addr;
+
+		__xskq_cons_read_addr_unchecked(pool->cq, pool->recycle_cons++,
+						&addr);
+		/* The ring is mapped to user space, do not trust its content */
+		if (unlikely(!xp_check_aligned(pool, &addr))) {
+			pool->cq->invalid_descs++;
+			nb_entries--;
+			continue;
+		}
+
+		xskb = xp_get_xskb(pool, addr);
+		*xdp = &xskb->xdp;
+		xdp++;
+	}
+
+	smp_store_release(&pool->cq->ring->consumer, pool->recycle_cons);
+	return nb_entries;
+}
+
+/* Tx stops when the completion ring is full, and with XDP_UMEM_TX_RECYCLE
+ * only Rx allocation consumes it. When the Tx path runs out of completion
+ * slots, move the completed buffers to the free list, which Rx allocation
+ * takes from first. Must run in the context that allocates Rx buffers, or
+ * under pool->rx_lock in copy mode, where Rx allocates under it too.
+ */
+void xp_recycle_completed(struct xsk_buff_pool *pool)
+{
+	u32 nb_entries;
+
+	nb_entries = xp_recycle_nb_entries(pool, pool->cq->nentries);
+	while (nb_entries--) {
+		u64 addr;
+
+		__xskq_cons_read_addr_unchecked(pool->cq, pool->recycle_cons++,
+						&addr);
+		if (unlikely(!xp_check_aligned(pool, &addr))) {
+			pool->cq->invalid_descs++;
+			continue;
+		}
+
+		xp_free(xp_get_xskb(pool, addr));
+	}
+
+	smp_store_release(&pool->cq->ring->consumer, pool->recycle_cons);
+}
+
 static struct xdp_buff_xsk *__xp_alloc(struct xsk_buff_pool *pool)
 {
 	struct xdp_buff_xsk *xskb;
@@ -531,6 +605,13 @@ static struct xdp_buff_xsk *__xp_alloc(struct xsk_buff_pool *pool)
 	if (pool->free_heads_cnt == 0)
 		return NULL;
 
+	if (pool->tx_recycle) {
+		struct xdp_buff *xdp;
+
+		if (xp_alloc_recycled(pool, &xdp, 1))
+			return container_of(xdp, struct xdp_buff_xsk, xdp);
+	}
+
 	for (;;) {
 		if (!xskq_cons_peek_addr_unchecked(pool->fq, &addr)) {
 			pool->fq->queue_empty_descs++;
@@ -669,6 +750,17 @@ u32 xp_alloc_batch(struct xsk_buff_pool *pool, struct xdp_buff **xdp, u32 max)
 		xdp += nb_entries1;
 	}
 
+	if (pool->tx_recycle) {
+		u32 nb_recycled = xp_alloc_recycled(pool, xdp, max);
+
+		nb_entries1 += nb_recycled;
+		if (nb_recycled == max)
+			return nb_entries1;
+
+		max -= nb_recycled;
+		xdp += nb_recycled;
+	}
+
 	nb_entries2 = xp_alloc_new_from_fq(pool, xdp, max);
 	if (!nb_entries2)
 		pool->fq->queue_empty_descs++;
@@ -685,6 +777,11 @@ bool xp_can_alloc(struct xsk_buff_pool *pool, u32 count)
 		return true;
 
 	req_count = count - pool->free_list_cnt;
+	if (pool->tx_recycle) {
+		req_count -= xp_recycle_nb_entries(pool, req_count);
+		if (!req_count)
+			return true;
+	}
 	avail_count = xskq_cons_nb_entries(pool->fq, req_count);
 	if (!avail_count)
 		pool->fq->queue_empty_descs++;
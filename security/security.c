@@ -157,6 +157,9 @@ struct lsm_static_calls_table
 #undef INIT_LSM_STATIC_CALL
 	};
 
+/* Any inode_permission hook is active, see security_inode_permission_cacheable() */
+DEFINE_STATIC_KEY_FALSE(security_inode_permission_hooked);
+
 static __initdata bool debug;
 #define init_debug(...)						\
 	do {							\
@@ -414,6 +417,8 @@ static void __init lsm_static_call_init(struct security_hook_list *hl)
 					     hl->hook.lsm_func_addr);
 			scall->hl = hl;
 			static_branch_enable(scall->active);
+			if (hl->scalls == static_calls_table.inode_permission)
+				static_branch_enable(&security_inode_permission_hooked);
 			return;
 		}
 		scall++;
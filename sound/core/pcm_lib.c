@@ -8,6 +8,7 @@
 #include <linux/slab.h>
 #include <linux/sched/signal.h>
 #include <linux/time.h>
+#include <linux/hrtimer.h>
 #include <linux/math64.h>
 #include <linux/export.h>
 #include <sound/core.h>
@@ -1940,6 +1941,21 @@ void snd_pcm_period_elapsed(struct snd_pcm_substream *substream)
 }
 EXPORT_SYMBOL(snd_pcm_period_elapsed);
 
+/*
+ * Without period interrupts nothing moves the hardware pointer nor wakes up a
+ * blocked reader or writer of a running stream, so sleep until the missing
+ * frames should have been transferred at the stream rate; the caller then
+ * resyncs the pointer.
+ */
+static void wait_for_frames(struct snd_pcm_runtime *runtime,
+			    snd_pcm_uframes_t frames)
+{
+	ktime_t expires;
+
+	expires = ns_to_ktime(div_u64((u64)frames * NSEC_PER_SEC, runtime->rate));
+	schedule_hrtimeout(&expires, HRTIMER_MODE_REL);
+}
+
 /*
  * Wait until avail_min data becomes available
  * Returns a negative error code if any error occurs during operation.
@@ -1954,7 +1970,8 @@ static int wait_for_avail(struct snd_pcm_substream *substream,
 	wait_queue_entry_t wait;
 	int err = 0;
 	snd_pcm_uframes_t avail = 0;
-	long wait_time, tout;
+	long wait_time, tout = 0;
+	bool timed;
 
 	init_waitqueue_entry(&wait, current);
 	set_current_state(TASK_INTERRUPTIBLE);
@@ -1993,12 +2010,19 @@ static int wait_for_avail(struct snd_pcm_substream *substream,
 		avail = snd_pcm_avail(substream);
 		if (avail >= runtime->twake)
 			break;
+		timed = runtime->no_period_wakeup &&
+			runtime->state == SNDRV_PCM_STATE_RUNNING;
 		snd_pcm_stream_unlock_irq(substream);
 
-		tout = schedule_timeout(wait_time);
+		if (timed)
+			wait_for_frames(runtime, runtime->twake - avail);
+		else
+			tout = schedule_timeout(wait_time);
 
 		snd_pcm_stream_lock_irq(substream);
 		set_current_state(TASK_INTERRUPTIBLE);
+		if (timed && runtime->state == SNDRV_PCM_STATE_RUNNING)
+			snd_pcm_update_hw_ptr(substream);
 		switch (runtime->state) {
 		case SNDRV_PCM_STATE_SUSPENDED:
 			err = -ESTRPIPE;
@@ -2020,6 +2044,8 @@ static int wait_for_avail(struct snd_pcm_substream *substream,
 		case SNDRV_PCM_STATE_PAUSED:
 			continue;
 		}
+		if (runtime->no_period_wakeup)
+			continue;
 		if (!tout) {
 			pcm_dbg(substream->pcm,
 				"%s timeout (DMA or IRQ trouble?)\n",
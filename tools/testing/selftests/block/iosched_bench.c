@@ -0,0 +1,275 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * I/O scheduler latency benchmark.
+ *
+ * Runs one workload against a block device and reports the p50/p99 latency
+ * of its latency sensitive part, and the IOPS of the whole device:
+ *
+ *  readflood: one thread issues synchronous 4k random reads while writer
+ *             threads keep the page cache full of dirty pages, so that
+ *             writeback floods the device with async writes.
+ *  fsync:     threads each write 4k and fdatasync() in a loop; the latency
+ *             of the fdatasync() is measured.
+ *  mixed:     one thread reads sequentially in 128k chunks while the other
+ *             threads issue 4k random reads, which are measured.
+ *
+ * The device is overwritten. iosched_matrix.sh runs all workloads with all
+ * available schedulers on a brd device with a latency profile.
+ *
+ * Usage: iosched_bench [-t seconds] [-j threads] <device> <workload>
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../kselftest.h"
+
+#define SMALL_BS	4096
+#define LARGE_BS	(128 * 1024)
+#define MAX_SAMPLES	(1 << 20)
+
+enum workload { READFLOOD, FSYNC, MIXED };
+
+static const char *dev;
+static enum workload workload;
+static unsigned long long dev_size;
+static atomic_int stop;
+static atomic_ullong nr_ios;
+
+static long long *lat;
+static atomic_int nr_lat;
+
+static unsigned long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void record(unsigned long long start)
+{
+	int i = atomic_fetch_add(&nr_lat, 1);
+
+	if (i < MAX_SAMPLES)
+		lat[i] = now_ns() - start;
+}
+
+static int open_dev(int flags)
+{
+	int fd = open(dev, flags);
+
+	if (fd < 0)
+		ksft_exit_fail_msg("open %s: %s\n", dev, strerror(errno));
+	return fd;
+}
+
+static void *alloc_buf(size_t bs)
+{
+	void *buf;
+
+	if (posix_memalign(&buf, SMALL_BS, bs))
+		ksft_exit_fail_msg("out of memory\n");
+	memset(buf, 0x5a, bs);
+	return buf;
+}
+
+static off_t random_off(unsigned int *seed, size_t bs)
+{
+	return ((unsigned long long)rand_r(seed) * bs) % (dev_size - bs) / bs * bs;
+}
+
+/* Synchronous 4k random reads, always measured. */
+static void *random_reader(void *arg)
+{
+	unsigned int seed = (unsigned long)pthread_self();
+	void *buf = alloc_buf(SMALL_BS);
+	int fd = open_dev(O_RDONLY | O_DIRECT);
+
+	while (!atomic_load(&stop)) {
+		unsigned long long start = now_ns();
+
+		if (pread(fd, buf, SMALL_BS, random_off(&seed, SMALL_BS)) < 0)
+			ksft_exit_fail_msg("read: %s\n", strerror(errno));
+		record(start);
+		atomic_fetch_add(&nr_ios, 1);
+	}
+	close(fd);
+	free(buf);
+	return NULL;
+}
+
+static void *seq_reader(void *arg)
+{
+	void *buf = alloc_buf(LARGE_BS);
+	int fd = open_dev(O_RDONLY | O_DIRECT);
+	off_t off = 0;
+
+	while (!atomic_load(&stop)) {
+		if (off + LARGE_BS > dev_size)
+			off = 0;
+		if (pread(fd, buf, LARGE_BS, off) < 0)
+			ksft_exit_fail_msg("read: %s\n", strerror(errno));
+		off += LARGE_BS;
+		atomic_fetch_add(&nr_ios, 1);
+	}
+	close(fd);
+	free(buf);
+	return NULL;
+}
+
+/* Buffered sequential writes; writeback turns them into async writes. */
+static void *buffered_writer(void *arg)
+{
+	void *buf = alloc_buf(LARGE_BS);
+	int fd = open_dev(O_WRONLY);
+	off_t off = (long)arg * (dev_size / 16) / LARGE_BS * LARGE_BS;
+
+	while (!atomic_load(&stop)) {
+		if (off + LARGE_BS > dev_size)
+			off = 0;
+		if (pwrite(fd, buf, LARGE_BS, off) < 0)
+			ksft_exit_fail_msg("write: %s\n", strerror(errno));
+		off += LARGE_BS;
+	}
+	close(fd);
+	free(buf);
+	return NULL;
+}
+
+static void *fsync_writer(void *arg)
+{
+	unsigned int seed = (unsigned long)pthread_self();
+	void *buf = alloc_buf(SMALL_BS);
+	int fd = open_dev(O_WRONLY);
+
+	while (!atomic_load(&stop)) {
+		unsigned long long start;
+
+		if (pwrite(fd, buf, SMALL_BS, random_off(&seed, SMALL_BS)) < 0)
+			ksft_exit_fail_msg("write: %s\n", strerror(errno));
+		start = now_ns();
+		if (fdatasync(fd))
+			ksft_exit_fail_msg("fdatasync: %s\n", strerror(errno));
+		record(start);
+		atomic_fetch_add(&nr_ios, 2);
+	}
+	close(fd);
+	free(buf);
+	return NULL;
+}
+
+static int cmp_ll(const void *a, const void *b)
+{
+	long long x = *(const long long *)a, y = *(const long long *)b;
+
+	return (x > y) - (x < y);
+}
+
+static long long percentile(int nr, int permille)
+{
+	int idx = (long long)nr * permille / 1000;
+
+	if (idx >= nr)
+		idx = nr - 1;
+	return lat[idx];
+}
+
+int main(int argc, char **argv)
+{
+	static const char * const names[] = { "readflood", "fsync", "mixed" };
+	int seconds = 10, nr_threads = 4, opt, i, nr;
+	unsigned long long start, elapsed;
+	pthread_t *threads;
+	int fd;
+
+	while ((opt = getopt(argc, argv, "t:j:")) != -1) {
+		switch (opt) {
+		case 't':
+			seconds = atoi(optarg);
+			break;
+		case 'j':
+			nr_threads = atoi(optarg);
+			break;
+		default:
+			goto usage;
+		}
+	}
+	if (argc - optind != 2 || seconds < 1 || nr_threads < 1)
+		goto usage;
+
+	dev = argv[optind];
+	for (i = 0; i < 3; i++)
+		if (!strcmp(argv[optind + 1], names[i]))
+			break;
+	if (i == 3)
+		goto usage;
+	workload = i;
+
+	fd = open_dev(O_RDONLY);
+	dev_size = lseek(fd, 0, SEEK_END);
+	close(fd);
+	if (dev_size < 16 * LARGE_BS)
+		ksft_exit_fail_msg("%s is too small\n", dev);
+
+	lat = calloc(MAX_SAMPLES, sizeof(*lat));
+	threads = calloc(nr_threads + 1, sizeof(*threads));
+	if (!lat || !threads)
+		ksft_exit_fail_msg("out of memory\n");
+
+	for (i = 0; i <= nr_threads; i++) {
+		void *(*fn)(void *) = NULL;
+		void *arg = (void *)(long)i;
+
+		switch (workload) {
+		case READFLOOD:
+			fn = i ? buffered_writer : random_reader;
+			break;
+		case FSYNC:
+			fn = i ? fsync_writer : NULL;
+			break;
+		case MIXED:
+			fn = i ? random_reader : seq_reader;
+			break;
+		}
+		if (fn && pthread_create(&threads[i], NULL, fn, arg))
+			ksft_exit_fail_msg("failed to create thread\n");
+	}
+
+	start = now_ns();
+	sleep(seconds);
+	atomic_store(&stop, 1);
+	for (i = 0; i <= nr_threads; i++)
+		if (i || workload != FSYNC)
+			pthread_join(threads[i], NULL);
+	elapsed = now_ns() - start;
+
+	nr = atomic_load(&nr_lat);
+	if (nr > MAX_SAMPLES)
+		nr = MAX_SAMPLES;
+	if (!nr)
+		ksft_exit_fail_msg("no samples\n");
+	qsort(lat, nr, sizeof(*lat), cmp_ll);
+
+	ksft_print_msg("%s: samples=%d p50=%lld p99=%lld [us] iops=%llu\n",
+		       names[workload], nr, percentile(nr, 500) / 1000,
+		       percentile(nr, 990) / 1000,
+		       atomic_load(&nr_ios) * 1000000000ULL / elapsed);
+
+	free(threads);
+	free(lat);
+	return KSFT_PASS;
+
+usage:
+	fprintf(stderr, "Usage: %s [-t seconds] [-j threads] <device> <readflood|fsync|mixed>\n",
+		argv[0]);
+	return KSFT_FAIL;
+}
@@ -0,0 +1,66 @@
+#!/bin/bash
+# SPDX-License-Identifier: GPL-2.0
+#
+# Run the iosched_bench workloads with every available I/O scheduler on a brd
+# ramdisk with a latency profile, e.g.:
+#
+#   ./iosched_matrix.sh -p flushstall -t 20
+#
+# Options are passed to brd as module parameters, except for -t (seconds per
+# run) and -j (threads per run). brd must be a module and not be in use.
+
+set -o pipefail
+
+ksft_skip=4
+PROFILE=bimodal
+SECONDS_PER_RUN=10
+THREADS=4
+BRD_PARAMS="rd_nr=1 rd_size=262144"
+SCHEDULERS="none mq-deadline kyber bfq adios"
+WORKLOADS="readflood fsync mixed"
+
+while getopts "p:t:j:o:" opt; do
+	case $opt in
+	p) PROFILE=$OPTARG ;;
+	t) SECONDS_PER_RUN=$OPTARG ;;
+	j) THREADS=$OPTARG ;;
+	o) BRD_PARAMS="$BRD_PARAMS $OPTARG" ;;
+	*) echo "Usage: $0 [-p profile] [-t seconds] [-j threads] [-o 'brd params']"
+	   exit 1 ;;
+	esac
+done
+
+if [ "$(id -u)" -ne 0 ]; then
+	echo "SKIP: must be run as root"
+	exit $ksft_skip
+fi
+
+if [ -e /sys/module/brd ] && ! modprobe -r brd 2>/dev/null; then
+	echo "SKIP: brd is built in or in use"
+	exit $ksft_skip
+fi
+
+if ! modprobe brd rd_profile="$PROFILE" $BRD_PARAMS; then
+	echo "SKIP: brd does not support latency profiles"
+	exit $ksft_skip
+fi
+trap 'modprobe -r brd' EXIT
+
+DEV=/dev/ram0
+SCHED=/sys/block/ram0/queue/scheduler
+
+for sched in $SCHEDULERS; do
+	modprobe -q "$sched-iosched" 2>/dev/null
+	modprobe -q "$sched" 2>/dev/null
+	if ! echo "$sched" > "$SCHED" 2>/dev/null; then
+		echo "# $sched: not available"
+		continue
+	fi
+	for w in $WORKLOADS; do
+		echo -n "# $PROFILE $sched "
+		./iosched_bench -t "$SECONDS_PER_RUN" -j "$THREADS" "$DEV" "$w" |
+			grep -v '^# Totals' | sed 's/^# //' || exit 1
+	done
+done
+
+exit 0
@@ -7,6 +7,7 @@
 
 #define _GNU_SOURCE
 #include <sys/ioctl.h>
+#include <poll.h>
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <time.h>
@@ -1268,6 +1269,120 @@ TEST(alert_all)
 	close(fd);
 }
 
+TEST(signal_batch)
+{
+	struct ntsync_mutex_args mutex_args;
+	struct ntsync_event_args event_args;
+	struct ntsync_signal_args args = {0};
+	struct ntsync_sem_args sem_args;
+	struct ntsync_signal_op ops[3];
+	int fd, ret, sem, mutex, event;
+	__u32 index;
+
+	fd = open("/dev/ntsync", O_CLOEXEC | O_RDONLY);
+	ASSERT_LE(0, fd);
+
+	sem_args.count = 0;
+	sem_args.max = 2;
+	sem = ioctl(fd, NTSYNC_IOC_CREATE_SEM, &sem_args);
+	EXPECT_LE(0, sem);
+
+	mutex_args.owner = 123;
+	mutex_args.count = 1;
+	mutex = ioctl(fd, NTSYNC_IOC_CREATE_MUTEX, &mutex_args);
+	EXPECT_LE(0, mutex);
+
+	event_args.manual = 1;
+	event_args.signaled = 0;
+	event = ioctl(fd, NTSYNC_IOC_CREATE_EVENT, &event_args);
+	EXPECT_LE(0, event);
+
+	ops[0] = (struct ntsync_signal_op){ sem, NTSYNC_SIGNAL_SEM_RELEASE, 2, 0xdeadbeef };
+	ops[1] = (struct ntsync_signal_op){ mutex, NTSYNC_SIGNAL_MUTEX_UNLOCK, 123, 0xdeadbeef };
+	ops[2] = (struct ntsync_signal_op){ event, NTSYNC_SIGNAL_EVENT_SET, 0, 0xdeadbeef };
+	args.ops = (uintptr_t)ops;
+	args.count = 3;
+	ret = ioctl(fd, NTSYNC_IOC_SIGNAL, &args);
+	EXPECT_EQ(0, ret);
+	EXPECT_EQ(0, ops[0].prev);
+	EXPECT_EQ(1, ops[1].prev);
+	EXPECT_EQ(0, ops[2].prev);
+	check_sem_state(sem, 2, 2);
+	check_mutex_state(mutex, 0, 0);
+	check_event_state(event, 1, 1);
+
+	/* a failing operation undoes the whole batch */
+	ret = ioctl(event, NTSYNC_IOC_EVENT_RESET, &index);
+	EXPECT_EQ(0, ret);
+	ops[0].value = 0;
+	ops[1] = (struct ntsync_signal_op){ event, NTSYNC_SIGNAL_EVENT_SET, 0, 0 };
+	ops[2] = (struct ntsync_signal_op){ sem, NTSYNC_SIGNAL_SEM_RELEASE, 1, 0 };
+	ret = ioctl(fd, NTSYNC_IOC_SIGNAL, &args);
+	EXPECT_EQ(-1, ret);
+	EXPECT_EQ(EOVERFLOW, errno);
+	check_sem_state(sem, 2, 2);
+	check_event_state(event, 0, 1);
+
+	ops[0] = (struct ntsync_signal_op){ mutex, NTSYNC_SIGNAL_SEM_RELEASE, 1, 0 };
+	args.count = 1;
+	ret = ioctl(fd, NTSYNC_IOC_SIGNAL, &args);
+	EXPECT_EQ(-1, ret);
+	EXPECT_EQ(EINVAL, errno);
+
+	args.count = 0;
+	ret = ioctl(fd, NTSYNC_IOC_SIGNAL, &args);
+	EXPECT_EQ(-1, ret);
+	EXPECT_EQ(EINVAL, errno);
+
+	close(event);
+	close(mutex);
+	close(sem);
+
+	close(fd);
+}
+
+TEST(poll_state)
+{
+	struct ntsync_sem_args sem_args;
+	struct pollfd pfd;
+	__u32 count, index;
+	int fd, ret, sem;
+
+	fd = open("/dev/ntsync", O_CLOEXEC | O_RDONLY);
+	ASSERT_LE(0, fd);
+
+	sem_args.count = 0;
+	sem_args.max = 1;
+	sem = ioctl(fd, NTSYNC_IOC_CREATE_SEM, &sem_args);
+	EXPECT_LE(0, sem);
+
+	pfd.fd = sem;
+	pfd.events = POLLIN;
+	ret = poll(&pfd, 1, 0);
+	EXPECT_EQ(0, ret);
+
+	count = 1;
+	ret = release_sem(sem, &count);
+	EXPECT_EQ(0, ret);
+
+	ret = poll(&pfd, 1, 0);
+	EXPECT_EQ(1, ret);
+	EXPECT_EQ(POLLIN, pfd.revents);
+
+	/* poll only reports readiness, it doesn't acquire */
+	check_sem_state(sem, 1, 1);
+
+	ret = wait_any(fd, 1, &sem, 123, &index);
+	EXPECT_EQ(0, ret);
+
+	ret = poll(&pfd, 1, 0);
+	EXPECT_EQ(0, ret);
+
+	close(sem);
+
+	close(fd);
+}
+
 #define STRESS_LOOPS 10000
 #define STRESS_THREADS 4
 
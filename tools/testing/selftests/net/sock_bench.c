@@ -0,0 +1,399 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Socket path benchmark.
+ *
+ * Runs one of the netperf style workloads over TCP or UDP and reports the
+ * p50/p99 round trip latency, the throughput, and the CPU cycles spent in the
+ * kernel and in user space per operation, as counted by perf:
+ *
+ *  tcp_rr:     each thread sends a message and waits for the same amount of
+ *              data back; the round trip is measured.
+ *  tcp_stream: each thread sends messages as fast as possible.
+ *  udp_rr:     like tcp_rr with one datagram each way.
+ *  udp_stream: like tcp_stream with datagrams.
+ *
+ * Without -l or -H, the server side runs in the same process and the
+ * connections go over loopback. With -l, only the server side runs; with
+ * -H, only the client side runs and connects to the given IPv4 address.
+ * sock_bench.sh uses that to run all workloads over loopback and veth.
+ *
+ * Usage: sock_bench [-t seconds] [-j threads] [-m size] [-p port]
+ *                   [-l | -H addr] <workload>
+ */
+
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../kselftest.h"
+
+#define MAX_SAMPLES	(1 << 20)
+#define MAX_MSG		(64 * 1024)
+
+enum workload { TCP_RR, TCP_STREAM, UDP_RR, UDP_STREAM };
+
+static const char * const names[] = {
+	"tcp_rr", "tcp_stream", "udp_rr", "udp_stream"
+};
+
+static enum workload workload;
+static unsigned int msg_size = 1;
+static unsigned short port = 8900;
+static struct in_addr addr;
+static atomic_int stop;
+static atomic_ullong nr_ops;
+static atomic_ullong nr_bytes;
+
+static long long *lat;
+static atomic_int nr_lat;
+
+static unsigned long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void record(unsigned long long start)
+{
+	int i = atomic_fetch_add(&nr_lat, 1);
+
+	if (i < MAX_SAMPLES)
+		lat[i] = now_ns() - start;
+}
+
+static bool is_tcp(void)
+{
+	return workload == TCP_RR || workload == TCP_STREAM;
+}
+
+static bool is_rr(void)
+{
+	return workload == TCP_RR || workload == UDP_RR;
+}
+
+static struct sockaddr_in sin_of(int i)
+{
+	struct sockaddr_in sin = {
+		.sin_family = AF_INET,
+		.sin_addr = addr,
+		/* UDP uses one port per thread, TCP one listener */
+		.sin_port = htons(port + (is_tcp() ? 0 : i)),
+	};
+
+	return sin;
+}
+
+static int new_socket(void)
+{
+	int fd = socket(AF_INET, is_tcp() ? SOCK_STREAM : SOCK_DGRAM, 0);
+	int one = 1;
+
+	if (fd < 0)
+		ksft_exit_fail_msg("socket: %s\n", strerror(errno));
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	if (is_tcp())
+		setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+	return fd;
+}
+
+/* Stream sockets may return short reads, datagram sockets never do. */
+static int recv_msg(int fd, char *buf, struct sockaddr_in *from)
+{
+	socklen_t len = sizeof(*from);
+	unsigned int off = 0;
+	ssize_t ret;
+
+	do {
+		ret = recvfrom(fd, buf + off, msg_size - off, 0,
+			       (struct sockaddr *)from, from ? &len : NULL);
+		if (ret <= 0)
+			return -1;
+		off += ret;
+	} while (is_tcp() && off < msg_size);
+	return 0;
+}
+
+static void *server(void *arg)
+{
+	int fd = (long)arg;
+	char *buf = calloc(1, MAX_MSG);
+	struct sockaddr_in from;
+
+	/* Keep serving until the peer goes away, so that clients never block */
+	for (;;) {
+		if (!is_rr()) {
+			if (recv(fd, buf, MAX_MSG, 0) <= 0)
+				break;
+			continue;
+		}
+		if (recv_msg(fd, buf, is_tcp() ? NULL : &from))
+			break;
+		if (sendto(fd, buf, msg_size, 0, is_tcp() ? NULL : &from,
+			   is_tcp() ? 0 : sizeof(from)) < 0)
+			break;
+	}
+	close(fd);
+	free(buf);
+	return NULL;
+}
+
+static int start_server(int nr_threads, pthread_t *threads)
+{
+	struct sockaddr_in sin = sin_of(0);
+	int i, lfd = -1;
+
+	if (is_tcp()) {
+		lfd = new_socket();
+		if (bind(lfd, (struct sockaddr *)&sin, sizeof(sin)) ||
+		    listen(lfd, nr_threads))
+			ksft_exit_fail_msg("listen: %s\n", strerror(errno));
+	}
+
+	for (i = 0; i < nr_threads; i++) {
+		long fd;
+
+		if (is_tcp())
+			continue;
+		sin = sin_of(i);
+		fd = new_socket();
+		if (bind(fd, (struct sockaddr *)&sin, sizeof(sin)))
+			ksft_exit_fail_msg("bind: %s\n", strerror(errno));
+		if (pthread_create(&threads[i], NULL, server, (void *)fd))
+			ksft_exit_fail_msg("failed to create thread\n");
+	}
+	return lfd;
+}
+
+static void accept_server(int lfd, int nr_threads, pthread_t *threads)
+{
+	int i;
+
+	for (i = 0; i < nr_threads; i++) {
+		long fd = accept(lfd, NULL, NULL);
+
+		if (fd < 0)
+			ksft_exit_fail_msg("accept: %s\n", strerror(errno));
+		if (pthread_create(&threads[i], NULL, server, (void *)fd))
+			ksft_exit_fail_msg("failed to create thread\n");
+	}
+	close(lfd);
+}
+
+static void *client(void *arg)
+{
+	struct sockaddr_in sin = sin_of((long)arg);
+	struct timeval tv = { .tv_usec = 100000 };
+	char *buf = calloc(1, MAX_MSG);
+	int fd = new_socket();
+
+	if (connect(fd, (struct sockaddr *)&sin, sizeof(sin)))
+		ksft_exit_fail_msg("connect: %s\n", strerror(errno));
+	/* A lost datagram must not stall the round trips */
+	if (!is_tcp())
+		setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+	while (!atomic_load(&stop)) {
+		unsigned long long start = now_ns();
+
+		if (send(fd, buf, msg_size, 0) < 0) {
+			/* Datagrams are dropped when the receiver lags */
+			if (!is_tcp() && (errno == ENOBUFS || errno == ECONNREFUSED))
+				continue;
+			ksft_exit_fail_msg("send: %s\n", strerror(errno));
+		}
+		if (is_rr()) {
+			if (recv_msg(fd, buf, NULL)) {
+				if (!is_tcp() && errno == EAGAIN)
+					continue;
+				break;
+			}
+			record(start);
+		}
+		atomic_fetch_add(&nr_ops, 1);
+		atomic_fetch_add(&nr_bytes, msg_size);
+	}
+	close(fd);
+	free(buf);
+	return NULL;
+}
+
+/* Cycles of this process and its threads, in the kernel or in user space */
+static int open_cycles(bool kernel)
+{
+	struct perf_event_attr attr = {
+		.type = PERF_TYPE_HARDWARE,
+		.size = sizeof(attr),
+		.config = PERF_COUNT_HW_CPU_CYCLES,
+		.disabled = 1,
+		.inherit = 1,
+		.exclude_user = kernel,
+		.exclude_kernel = !kernel,
+		.exclude_hv = 1,
+	};
+
+	return syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static unsigned long long read_cycles(int fd)
+{
+	unsigned long long val = 0;
+
+	if (fd < 0 || read(fd, &val, sizeof(val)) != sizeof(val))
+		return 0;
+	return val;
+}
+
+static int cmp_ll(const void *a, const void *b)
+{
+	long long x = *(const long long *)a, y = *(const long long *)b;
+
+	return (x > y) - (x < y);
+}
+
+static long long percentile(int nr, int permille)
+{
+	int idx = (long long)nr * permille / 1000;
+
+	if (idx >= nr)
+		idx = nr - 1;
+	return lat[idx];
+}
+
+int main(int argc, char **argv)
+{
+	int seconds = 10, nr_threads = 1, opt, i, nr, lfd = -1;
+	bool run_server = true, run_client = true;
+	unsigned long long start, elapsed, ops, bytes, kcycles, ucycles;
+	pthread_t *threads;
+	int kfd, ufd;
+
+	addr.s_addr = htonl(INADDR_LOOPBACK);
+	while ((opt = getopt(argc, argv, "t:j:m:p:lH:")) != -1) {
+		switch (opt) {
+		case 't':
+			seconds = atoi(optarg);
+			break;
+		case 'j':
+			nr_threads = atoi(optarg);
+			break;
+		case 'm':
+			msg_size = atoi(optarg);
+			break;
+		case 'p':
+			port = atoi(optarg);
+			break;
+		case 'l':
+			run_client = false;
+			break;
+		case 'H':
+			if (inet_pton(AF_INET, optarg, &addr) != 1)
+				goto usage;
+			run_server = false;
+			break;
+		default:
+			goto usage;
+		}
+	}
+	if (argc - optind != 1 || seconds < 1 || nr_threads < 1 ||
+	    !msg_size || msg_size > MAX_MSG || (!run_server && !run_client))
+		goto usage;
+
+	for (i = 0; i < 4; i++)
+		if (!strcmp(argv[optind], names[i]))
+			break;
+	if (i == 4)
+		goto usage;
+	workload = i;
+
+	lat = calloc(MAX_SAMPLES, sizeof(*lat));
+	threads = calloc(2 * nr_threads, sizeof(*threads));
+	if (!lat || !threads)
+		ksft_exit_fail_msg("out of memory\n");
+
+	/* Inherited by all threads, so the server side is counted as well */
+	kfd = open_cycles(true);
+	ufd = open_cycles(false);
+	if (run_client && (kfd < 0 || ufd < 0))
+		ksft_print_msg("perf cycles not available: %s\n", strerror(errno));
+
+	if (run_server)
+		lfd = start_server(nr_threads, threads);
+
+	if (!run_client) {
+		if (is_tcp())
+			accept_server(lfd, nr_threads, threads);
+		for (i = 0; i < nr_threads; i++)
+			pthread_join(threads[i], NULL);
+		return KSFT_PASS;
+	}
+
+	for (i = 0; i < nr_threads; i++)
+		if (pthread_create(&threads[nr_threads + i], NULL, client,
+				   (void *)(long)i))
+			ksft_exit_fail_msg("failed to create thread\n");
+	if (run_server && is_tcp())
+		accept_server(lfd, nr_threads, threads);
+
+	ioctl(kfd, PERF_EVENT_IOC_ENABLE, 0);
+	ioctl(ufd, PERF_EVENT_IOC_ENABLE, 0);
+	atomic_store(&nr_ops, 0);
+	atomic_store(&nr_bytes, 0);
+	atomic_store(&nr_lat, 0);
+	start = now_ns();
+	sleep(seconds);
+	ops = atomic_load(&nr_ops);
+	bytes = atomic_load(&nr_bytes);
+	elapsed = now_ns() - start;
+	ioctl(kfd, PERF_EVENT_IOC_DISABLE, 0);
+	ioctl(ufd, PERF_EVENT_IOC_DISABLE, 0);
+	kcycles = read_cycles(kfd);
+	ucycles = read_cycles(ufd);
+
+	atomic_store(&stop, 1);
+	for (i = 0; i < nr_threads; i++)
+		pthread_join(threads[nr_threads + i], NULL);
+
+	if (!ops)
+		ksft_exit_fail_msg("no operations\n");
+
+	ksft_print_msg("%s: size=%u threads=%d ops/s=%llu Mbit/s=%llu kcycles/op=%llu ucycles/op=%llu\n",
+		       names[workload], msg_size, nr_threads,
+		       ops * 1000000000ULL / elapsed,
+		       bytes * 8000ULL / elapsed,
+		       kcycles / ops, ucycles / ops);
+
+	nr = atomic_load(&nr_lat);
+	if (nr > MAX_SAMPLES)
+		nr = MAX_SAMPLES;
+	if (nr) {
+		qsort(lat, nr, sizeof(*lat), cmp_ll);
+		ksft_print_msg("%s: samples=%d p50=%lld p99=%lld [us]\n",
+			       names[workload], nr,
+			       percentile(nr, 500) / 1000,
+			       percentile(nr, 990) / 1000);
+	}
+
+	return KSFT_PASS;
+
+usage:
+	fprintf(stderr, "Usage: %s [-t seconds] [-j threads] [-m size] [-p port] [-l | -H addr] <tcp_rr|tcp_stream|udp_rr|udp_stream>\n",
+		argv[0]);
+	return KSFT_FAIL;
+}
@@ -0,0 +1,84 @@
+#!/bin/bash
+# SPDX-License-Identifier: GPL-2.0
+#
+# Run the sock_bench workloads over loopback and over a veth pair between two
+# network namespaces, e.g.:
+#
+#   ./sock_bench.sh -t 10 -j 4 -m "1 1024 65000"
+#
+# -t is the runtime in seconds, -j the number of threads and -m the list of
+# message sizes for each workload.
+
+set -o pipefail
+
+ksft_skip=4
+SECONDS_PER_RUN=5
+THREADS=1
+SIZES="1 1024 16384"
+WORKLOADS="tcp_rr tcp_stream udp_rr udp_stream"
+NS_SRV=sock_bench_srv
+NS_CLI=sock_bench_cli
+
+while getopts "t:j:m:" opt; do
+	case $opt in
+	t) SECONDS_PER_RUN=$OPTARG ;;
+	j) THREADS=$OPTARG ;;
+	m) SIZES=$OPTARG ;;
+	*) echo "Usage: $0 [-t seconds] [-j threads] [-m 'sizes']"
+	   exit 1 ;;
+	esac
+done
+
+if [ "$(id -u)" -ne 0 ]; then
+	echo "SKIP: must be run as root"
+	exit $ksft_skip
+fi
+
+cleanup() {
+	ip netns del "$NS_SRV" 2>/dev/null
+	ip netns del "$NS_CLI" 2>/dev/null
+}
+trap cleanup EXIT
+
+# UDP datagrams must fit the MTU of the veth pair.
+run() {
+	local where=$1 size=$2 w=$3
+
+	if [[ $w == udp_* && $size -gt 1472 ]]; then
+		return 0
+	fi
+	echo "# $where"
+	if [ "$where" = loopback ]; then
+		./sock_bench -t "$SECONDS_PER_RUN" -j "$THREADS" -m "$size" "$w"
+		return
+	fi
+	ip netns exec "$NS_SRV" ./sock_bench -l -j "$THREADS" -m "$size" "$w" &
+	sleep 1
+	ip netns exec "$NS_CLI" ./sock_bench -H 10.0.0.1 -t "$SECONDS_PER_RUN" \
+		-j "$THREADS" -m "$size" "$w"
+	local ret=$?
+	kill %1 2>/dev/null
+	wait 2>/dev/null
+	return $ret
+}
+
+cleanup
+ip netns add "$NS_SRV" || exit $ksft_skip
+ip netns add "$NS_CLI" || exit $ksft_skip
+ip -n "$NS_SRV" link add veth0 type veth peer name veth1 netns "$NS_CLI" || exit $ksft_skip
+ip -n "$NS_SRV" addr add 10.0.0.1/24 dev veth0
+ip -n "$NS_CLI" addr add 10.0.0.2/24 dev veth1
+ip -n "$NS_SRV" link set veth0 up
+ip -n "$NS_CLI" link set veth1 up
+# Let GRO coalesce the stream workloads on the receiving side.
+ip netns exec "$NS_SRV" ethtool -K veth0 gro on 2>/dev/null
+
+for where in loopback veth; do
+	for size in $SIZES; do
+		for w in $WORKLOADS; do
+			run "$where" "$size" "$w" || exit 1
+		done
+	done
+done
+
+exit 0
@@ -0,0 +1,221 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * BORE wakeup latency benchmark.
+ *
+ * A synthetic interactive task sleeps for a short period, wakes up on an
+ * absolute deadline and does a little work, while N CPU hogs saturate the
+ * system. The wakeup-to-run latency is the lateness of the interactive task
+ * with respect to its deadline; its p50/p99/p999 are reported.
+ *
+ * With -b, the benchmark runs twice: once with the burst penalties of its
+ * own cgroup enabled and once disabled, by writing cpu.bore.penalty_scale.
+ * The benchmark must then be started in a non-root cgroup with the cpu
+ * controller enabled.
+ *
+ * Usage: bore_latency_bench [-H hogs] [-n samples] [-p period_us] [-b]
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../kselftest.h"
+
+#define NSEC_PER_SEC	1000000000LL
+#define NSEC_PER_USEC	1000LL
+
+static atomic_int stop_hogs;
+
+static long long ts_to_ns(const struct timespec *ts)
+{
+	return ts->tv_sec * NSEC_PER_SEC + ts->tv_nsec;
+}
+
+static void ns_to_ts(long long ns, struct timespec *ts)
+{
+	ts->tv_sec = ns / NSEC_PER_SEC;
+	ts->tv_nsec = ns % NSEC_PER_SEC;
+}
+
+static void *hog_thread(void *arg)
+{
+	volatile unsigned long spin = 0;
+
+	while (!atomic_load(&stop_hogs))
+		spin++;
+	return NULL;
+}
+
+static int cmp_ll(const void *a, const void *b)
+{
+	long long x = *(const long long *)a, y = *(const long long *)b;
+
+	return (x > y) - (x < y);
+}
+
+static long long percentile(long long *lat, int nr, int permille)
+{
+	int idx = (long long)nr * permille / 1000;
+
+	if (idx >= nr)
+		idx = nr - 1;
+	return lat[idx];
+}
+
+/* Path of cpu.bore.penalty_scale of the cgroup we are running in. */
+static int bore_scale_path(char *buf, size_t len)
+{
+	char line[512];
+	FILE *f;
+	int ret = -1;
+
+	f = fopen("/proc/self/cgroup", "r");
+	if (!f)
+		return -1;
+
+	while (fgets(line, sizeof(line), f)) {
+		/* cgroup v2 entry: "0::/path" */
+		if (strncmp(line, "0::", 3))
+			continue;
+		line[strcspn(line, "\n")] = '\0';
+		snprintf(buf, len, "/sys/fs/cgroup%s/cpu.bore.penalty_scale",
+			 line + 3);
+		ret = access(buf, R_OK | W_OK);
+		break;
+	}
+	fclose(f);
+
+	return ret;
+}
+
+static int bore_scale_rw(const char *path, char *val, size_t len, int write)
+{
+	FILE *f = fopen(path, write ? "w" : "r");
+	int ret = 0;
+
+	if (!f)
+		return -1;
+	if (write)
+		ret = fputs(val, f) < 0 ? -1 : 0;
+	else
+		ret = fgets(val, len, f) ? 0 : -1;
+	if (fclose(f))
+		ret = -1;
+
+	return ret;
+}
+
+static void run(const char *label, int nr_hogs, int nr_samples, long period_us)
+{
+	long long *lat, deadline;
+	struct timespec ts;
+	pthread_t *hogs;
+	int i;
+
+	lat = calloc(nr_samples, sizeof(*lat));
+	hogs = calloc(nr_hogs ? nr_hogs : 1, sizeof(*hogs));
+	if (!lat || !hogs)
+		ksft_exit_fail_msg("out of memory\n");
+
+	atomic_store(&stop_hogs, 0);
+	for (i = 0; i < nr_hogs; i++)
+		if (pthread_create(&hogs[i], NULL, hog_thread, NULL))
+			ksft_exit_fail_msg("failed to create hog thread\n");
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	deadline = ts_to_ns(&ts);
+	for (i = 0; i < nr_samples; i++) {
+		volatile unsigned long work;
+
+		deadline += period_us * NSEC_PER_USEC;
+		ns_to_ts(deadline, &ts);
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+			;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		lat[i] = ts_to_ns(&ts) - deadline;
+
+		/* A short burst, like handling an input event. */
+		for (work = 0; work < 10000; work++)
+			;
+
+		/* Don't let a long stall turn into a burst of late samples. */
+		if (ts_to_ns(&ts) > deadline)
+			deadline = ts_to_ns(&ts);
+	}
+
+	atomic_store(&stop_hogs, 1);
+	for (i = 0; i < nr_hogs; i++)
+		pthread_join(hogs[i], NULL);
+
+	qsort(lat, nr_samples, sizeof(*lat), cmp_ll);
+	ksft_print_msg("%s: hogs=%d samples=%d wakeup latency p50=%lld p99=%lld p999=%lld max=%lld [us]\n",
+		       label, nr_hogs, nr_samples,
+		       percentile(lat, nr_samples, 500) / NSEC_PER_USEC,
+		       percentile(lat, nr_samples, 990) / NSEC_PER_USEC,
+		       percentile(lat, nr_samples, 999) / NSEC_PER_USEC,
+		       lat[nr_samples - 1] / NSEC_PER_USEC);
+
+	free(hogs);
+	free(lat);
+}
+
+int main(int argc, char **argv)
+{
+	int nr_hogs = sysconf(_SC_NPROCESSORS_ONLN), nr_samples = 10000;
+	int both = 0, opt;
+	long period_us = 1000;
+	char path[PATH_MAX], saved[32];
+
+	while ((opt = getopt(argc, argv, "H:n:p:b")) != -1) {
+		switch (opt) {
+		case 'H':
+			nr_hogs = atoi(optarg);
+			break;
+		case 'n':
+			nr_samples = atoi(optarg);
+			break;
+		case 'p':
+			period_us = atol(optarg);
+			break;
+		case 'b':
+			both = 1;
+			break;
+		default:
+			fprintf(stderr, "Usage: %s [-H hogs] [-n samples] [-p period_us] [-b]\n",
+				argv[0]);
+			return KSFT_FAIL;
+		}
+	}
+
+	if (nr_hogs < 0 || nr_samples < 1 || period_us < 1)
+		ksft_exit_fail_msg("invalid arguments\n");
+
+	if (!both) {
+		run("current", nr_hogs, nr_samples, period_us);
+		return KSFT_PASS;
+	}
+
+	if (bore_scale_path(path, sizeof(path)) ||
+	    bore_scale_rw(path, saved, sizeof(saved), 0)) {
+		ksft_print_msg("cpu.bore.penalty_scale not available in this cgroup\n");
+		return KSFT_SKIP;
+	}
+
+	run("bore", nr_hogs, nr_samples, period_us);
+
+	if (bore_scale_rw(path, "0", 0, 1))
+		ksft_exit_fail_msg("failed to disable burst penalties\n");
+	run("no-bore", nr_hogs, nr_samples, period_us);
+
+	if (bore_scale_rw(path, saved, 0, 1))
+		ksft_exit_fail_msg("failed to restore %s\n", path);
+
+	return KSFT_PASS;
+}
@@ -0,0 +1,151 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Wakeup placement microbenchmark.
+ *
+ * Pairs of threads ping-pong through a futex, so that every round trip costs
+ * two wakeups and thus two select_task_rq() calls. Optional CPU hogs load the
+ * system so that the placement scan cannot take its idle fast paths. The
+ * reported number is the average cost per wakeup, which includes the whole
+ * wakeup path; compare runs with and without a given sched feature, e.g.:
+ *
+ *   echo NO_SSS_FAST_PATH > /sys/kernel/debug/sched/features
+ *
+ * Usage: sss_wakeup_bench [-p pairs] [-H hogs] [-n iterations]
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <linux/futex.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../kselftest.h"
+
+struct pair {
+	atomic_int turn;
+	long iterations;
+};
+
+static atomic_int stop_hogs;
+
+static void futex_wait(atomic_int *uaddr, int val)
+{
+	syscall(SYS_futex, uaddr, FUTEX_WAIT_PRIVATE, val, NULL, NULL, 0);
+}
+
+static void futex_wake(atomic_int *uaddr)
+{
+	syscall(SYS_futex, uaddr, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+}
+
+static void pingpong(struct pair *pair, int me)
+{
+	long i;
+
+	for (i = 0; i < pair->iterations; i++) {
+		while (atomic_load(&pair->turn) != me)
+			futex_wait(&pair->turn, !me);
+		atomic_store(&pair->turn, !me);
+		futex_wake(&pair->turn);
+	}
+}
+
+static void *pong_thread(void *arg)
+{
+	pingpong(arg, 1);
+	return NULL;
+}
+
+static void *ping_thread(void *arg)
+{
+	pingpong(arg, 0);
+	return NULL;
+}
+
+static void *hog_thread(void *arg)
+{
+	volatile unsigned long spin = 0;
+
+	while (!atomic_load(&stop_hogs))
+		spin++;
+	return NULL;
+}
+
+static unsigned long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+int main(int argc, char **argv)
+{
+	int nr_pairs = 1, nr_hogs = 0, opt, i;
+	long iterations = 100000;
+	unsigned long long start, elapsed;
+	pthread_t *threads, *hogs;
+	struct pair *pairs;
+
+	while ((opt = getopt(argc, argv, "p:H:n:")) != -1) {
+		switch (opt) {
+		case 'p':
+			nr_pairs = atoi(optarg);
+			break;
+		case 'H':
+			nr_hogs = atoi(optarg);
+			break;
+		case 'n':
+			iterations = atol(optarg);
+			break;
+		default:
+			fprintf(stderr, "Usage: %s [-p pairs] [-H hogs] [-n iterations]\n",
+				argv[0]);
+			return KSFT_FAIL;
+		}
+	}
+
+	if (nr_pairs < 1 || nr_hogs < 0 || iterations < 1)
+		ksft_exit_fail_msg("invalid arguments\n");
+
+	pairs = calloc(nr_pairs, sizeof(*pairs));
+	threads = calloc(nr_pairs * 2, sizeof(*threads));
+	hogs = calloc(nr_hogs ? nr_hogs : 1, sizeof(*hogs));
+	if (!pairs || !threads || !hogs)
+		ksft_exit_fail_msg("out of memory\n");
+
+	for (i = 0; i < nr_hogs; i++)
+		if (pthread_create(&hogs[i], NULL, hog_thread, NULL))
+			ksft_exit_fail_msg("failed to create hog thread\n");
+
+	start = now_ns();
+	for (i = 0; i < nr_pairs; i++) {
+		pairs[i].iterations = iterations;
+		if (pthread_create(&threads[2 * i], NULL, pong_thread, &pairs[i]) ||
+		    pthread_create(&threads[2 * i + 1], NULL, ping_thread, &pairs[i]))
+			ksft_exit_fail_msg("failed to create pingpong thread\n");
+	}
+
+	for (i = 0; i < nr_pairs * 2; i++)
+		pthread_join(threads[i], NULL);
+	elapsed = now_ns() - start;
+
+	atomic_store(&stop_hogs, 1);
+	for (i = 0; i < nr_hogs; i++)
+		pthread_join(hogs[i], NULL);
+
+	ksft_print_msg("pairs=%d hogs=%d iterations=%ld: %.1f ns/wakeup\n",
+		       nr_pairs, nr_hogs, iterations,
+		       (double)elapsed / (2.0 * iterations * nr_pairs));
+
+	free(hogs);
+	free(threads);
+	free(pairs);
+
+	return KSFT_PASS;
+}